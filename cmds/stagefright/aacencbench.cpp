@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "aacencbench"
+#include <inttypes.h>
+#include <math.h>
+#include <utils/Log.h>
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaDefs.h>
+#include <utils/Vector.h>
+
+#include <OMX_Audio.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-c component] [-r rate] [-C channels] [-b bitrate]\n"
+                    "\t\t[-d seconds] [-t threads] [-s frames] [-n runs]\n"
+                    "\tEncodes generated PCM to AAC-LC with 1, 2, 4, ... encoder\n"
+                    "\tthreads and reports the real-time factor (encode time over\n"
+                    "\tduration, below 1 keeps up with a live source) and how far\n"
+                    "\tthe bitrate of each second strays from the average.\n"
+                    "\t[-c] encoder component (default OMX.google.aac.encoder)\n"
+                    "\t[-r] sample rate (default 48000)\n"
+                    "\t[-C] channel count (default 6)\n"
+                    "\t[-b] bitrate (default 64000 per channel)\n"
+                    "\t[-d] seconds of audio (default 60)\n"
+                    "\t[-t] most threads to try (default 4)\n"
+                    "\t[-s] frames per segment, 0 for the encoder's default (default 0)\n"
+                    "\t[-n] runs per thread count, the best one is reported (default 1)\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+struct BenchConfig {
+    const char *mComponentName;
+    int32_t mSampleRate;
+    int32_t mNumChannels;
+    int32_t mBitRate;
+    int32_t mSeconds;
+    int32_t mSegmentFrames;
+};
+
+struct BenchResult {
+    int64_t mElapsedUs;
+    size_t mOutputBytes;
+    Vector<size_t> mBytesPerSecond;
+};
+
+// Deterministic program material: a few partials per channel that drift in
+// pitch, plus some noise, so the psychoacoustic model has work to do.
+static void generatePCM(
+        const BenchConfig &config, int64_t firstFrame, size_t numFrames,
+        int16_t *out) {
+    for (size_t i = 0; i < numFrames; ++i) {
+        double t = (double)(firstFrame + i) / config.mSampleRate;
+        for (int32_t ch = 0; ch < config.mNumChannels; ++ch) {
+            double f = 110.0 * (ch + 1) * (1.0 + 0.1 * sin(0.3 * t));
+            double v = 0.3 * sin(2 * M_PI * f * t)
+                    + 0.15 * sin(2 * M_PI * 3.01 * f * t)
+                    + 0.05 * sin(2 * M_PI * 7.07 * f * t);
+
+            uint32_t x = (uint32_t)((firstFrame + i) * 2654435761u + ch * 40503u);
+            x ^= x >> 15;
+            x *= 2246822519u;
+            x ^= x >> 13;
+            v += 0.02 * ((double)(x & 0xffff) / 32768.0 - 1.0);
+
+            *out++ = (int16_t)(v * 32767);
+        }
+    }
+}
+
+static status_t runEncoder(
+        const sp<ALooper> &looper, const BenchConfig &config, int32_t numThreads,
+        BenchResult *result) {
+    static const int64_t kTimeout = 10000ll;
+
+    sp<AMessage> format = new AMessage;
+    format->setString("mime", MEDIA_MIMETYPE_AUDIO_AAC);
+    format->setInt32("sample-rate", config.mSampleRate);
+    format->setInt32("channel-count", config.mNumChannels);
+    format->setInt32("bitrate", config.mBitRate);
+    format->setInt32("aac-profile", OMX_AUDIO_AACObjectLC);
+    format->setInt32("encode-thread-count", numThreads);
+    format->setInt32("encode-segment-frames", config.mSegmentFrames);
+
+    sp<MediaCodec> codec =
+        MediaCodec::CreateByComponentName(looper, config.mComponentName);
+    if (codec == NULL) {
+        fprintf(stderr, "unable to instantiate %s.\n", config.mComponentName);
+        return UNKNOWN_ERROR;
+    }
+
+    status_t err = codec->configure(
+            format, NULL /* surface */, NULL /* crypto */,
+            MediaCodec::CONFIGURE_FLAG_ENCODE);
+    if (err == OK) {
+        err = codec->start();
+    }
+    if (err != OK) {
+        fprintf(stderr, "unable to start %s (err %d).\n", config.mComponentName, err);
+        codec->release();
+        return err;
+    }
+
+    Vector<sp<ABuffer> > inBuffers;
+    CHECK_EQ(codec->getInputBuffers(&inBuffers), (status_t)OK);
+
+    size_t bytesPerFrame = config.mNumChannels * sizeof(int16_t);
+    int64_t totalFrames = (int64_t)config.mSeconds * config.mSampleRate;
+    int64_t framesQueued = 0;
+
+    result->mOutputBytes = 0;
+    result->mBytesPerSecond.clear();
+    result->mBytesPerSecond.insertAt(
+            (size_t)0 /* item */, 0 /* index */, config.mSeconds + 1);
+
+    bool signalledInputEOS = false;
+    bool sawOutputEOS = false;
+    int64_t startTimeUs = ALooper::GetNowUs();
+
+    while (!sawOutputEOS) {
+        if (!signalledInputEOS) {
+            size_t index;
+            err = codec->dequeueInputBuffer(&index, 0ll);
+            if (err == OK) {
+                const sp<ABuffer> &buffer = inBuffers.itemAt(index);
+                int64_t timeUs = framesQueued * 1000000ll / config.mSampleRate;
+
+                size_t numFrames = buffer->capacity() / bytesPerFrame;
+                if (numFrames > (size_t)(totalFrames - framesQueued)) {
+                    numFrames = totalFrames - framesQueued;
+                }
+                generatePCM(config, framesQueued, numFrames,
+                        (int16_t *)buffer->base());
+                framesQueued += numFrames;
+
+                uint32_t flags = 0;
+                if (framesQueued == totalFrames) {
+                    flags = MediaCodec::BUFFER_FLAG_EOS;
+                    signalledInputEOS = true;
+                }
+
+                err = codec->queueInputBuffer(
+                        index, 0 /* offset */, numFrames * bytesPerFrame,
+                        timeUs, flags);
+                CHECK_EQ(err, (status_t)OK);
+            } else {
+                CHECK_EQ(err, -EAGAIN);
+            }
+        }
+
+        size_t index;
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        err = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags,
+                signalledInputEOS ? kTimeout : 0ll);
+
+        if (err == OK) {
+            if (!(flags & MediaCodec::BUFFER_FLAG_CODECCONFIG)) {
+                result->mOutputBytes += size;
+
+                size_t second = presentationTimeUs / 1000000ll;
+                if (second < result->mBytesPerSecond.size()) {
+                    result->mBytesPerSecond.editItemAt(second) += size;
+                }
+            }
+
+            CHECK_EQ(codec->releaseOutputBuffer(index), (status_t)OK);
+
+            if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+                sawOutputEOS = true;
+            }
+        } else if (err != INFO_OUTPUT_BUFFERS_CHANGED
+                && err != INFO_FORMAT_CHANGED) {
+            CHECK_EQ(err, -EAGAIN);
+        }
+    }
+
+    result->mElapsedUs = ALooper::GetNowUs() - startTimeUs;
+
+    CHECK_EQ(codec->release(), (status_t)OK);
+
+    return OK;
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+
+    BenchConfig config;
+    config.mComponentName = "OMX.google.aac.encoder";
+    config.mSampleRate = 48000;
+    config.mNumChannels = 6;
+    config.mBitRate = -1;
+    config.mSeconds = 60;
+    config.mSegmentFrames = 0;
+    int32_t maxThreads = 4;
+    int numRuns = 1;
+
+    int res;
+    while ((res = getopt(argc, argv, "hc:r:C:b:d:t:s:n:")) >= 0) {
+        switch (res) {
+            case 'c':
+            {
+                config.mComponentName = optarg;
+                break;
+            }
+
+            case 'r':
+            case 'C':
+            case 'b':
+            case 'd':
+            case 't':
+            case 's':
+            case 'n':
+            {
+                int32_t value = atoi(optarg);
+                if (value < (res == 's' ? 0 : 1)) {
+                    usage(me);
+                }
+
+                switch (res) {
+                    case 'r': config.mSampleRate = value; break;
+                    case 'C': config.mNumChannels = value; break;
+                    case 'b': config.mBitRate = value; break;
+                    case 'd': config.mSeconds = value; break;
+                    case 't': maxThreads = value; break;
+                    case 's': config.mSegmentFrames = value; break;
+                    default: numRuns = value; break;
+                }
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 0) {
+        usage(me);
+    }
+
+    if (config.mBitRate < 0) {
+        config.mBitRate = 64000 * config.mNumChannels;
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    sp<ALooper> looper = new ALooper;
+    looper->start();
+
+    printf("%s, %d Hz, %d channels, %d bps, %d s\n\n",
+            config.mComponentName, config.mSampleRate, config.mNumChannels,
+            config.mBitRate, config.mSeconds);
+    printf("%-8s %10s %8s %10s %10s %12s\n",
+            "threads", "encode ms", "rtf", "x realtime", "avg kbps", "worst 1s dev");
+
+    for (int32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        BenchResult best;
+        best.mElapsedUs = -1;
+
+        for (int run = 0; run < numRuns; ++run) {
+            BenchResult result;
+            if (runEncoder(looper, config, numThreads, &result) != OK) {
+                return 1;
+            }
+            if (best.mElapsedUs < 0 || result.mElapsedUs < best.mElapsedUs) {
+                best = result;
+            }
+        }
+
+        double rtf = best.mElapsedUs / (config.mSeconds * 1E6);
+        double avgBitRate = best.mOutputBytes * 8.0 / config.mSeconds;
+
+        // The last second is partial and the first holds the encoder delay,
+        // leave them out.
+        double worstDeviation = 0;
+        for (int32_t i = 1; i + 1 < config.mSeconds; ++i) {
+            double deviation =
+                fabs(best.mBytesPerSecond.itemAt(i) * 8.0 - avgBitRate) / avgBitRate;
+            if (deviation > worstDeviation) {
+                worstDeviation = deviation;
+            }
+        }
+
+        printf("%-8d %10.1f %8.3f %10.2f %10.1f %11.1f%%\n",
+                numThreads, best.mElapsedUs / 1E3, rtf, 1 / rtf,
+                avgBitRate / 1E3, worstDeviation * 100);
+    }
+
+    looper->stop();
+
+    return 0;
+}
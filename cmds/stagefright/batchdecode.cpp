@@ -0,0 +1,410 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "batchdecode"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include "include/SoftOMXBatchCodec.h"
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <utils/Vector.h>
+
+#include <OMX_Audio.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-c component] [-b batch] [-n runs] file\n"
+                    "\tDecodes the first audio track of file once through\n"
+                    "\tMediaCodec and once in-process in batches, and reports\n"
+                    "\tthe time spent per access unit in each.\n"
+                    "\t[-c] decoder component (default picked by mime type)\n"
+                    "\t[-b] access units per batch, 0 for all (default 0)\n"
+                    "\t[-n] runs per path, the best one is reported (default 1)\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+static const size_t kMaxSampleSize = 65536;
+
+struct Stream {
+    sp<AMessage> mFormat;
+    AString mComponentName;
+    Vector<sp<ABuffer> > mCSD;
+    Vector<sp<ABuffer> > mAccessUnits;
+};
+
+struct RunResult {
+    int64_t mElapsedUs;
+    size_t mOutputBytes;
+};
+
+static status_t readStream(
+        const char *path, const char *componentName, Stream *stream) {
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor;
+    if (extractor->setDataSource(NULL /* httpService */, path) != OK) {
+        fprintf(stderr, "unable to instantiate extractor.\n");
+        return UNKNOWN_ERROR;
+    }
+
+    AString mime;
+    size_t i;
+    for (i = 0; i < extractor->countTracks(); ++i) {
+        CHECK_EQ(extractor->getTrackFormat(i, &stream->mFormat), (status_t)OK);
+        CHECK(stream->mFormat->findString("mime", &mime));
+        if (!strncasecmp(mime.c_str(), "audio/", 6)) {
+            break;
+        }
+    }
+    if (i == extractor->countTracks()) {
+        fprintf(stderr, "no audio track.\n");
+        return UNKNOWN_ERROR;
+    }
+    CHECK_EQ(extractor->selectTrack(i), (status_t)OK);
+
+    if (componentName != NULL) {
+        stream->mComponentName = componentName;
+    } else if (!strcasecmp(mime.c_str(), MEDIA_MIMETYPE_AUDIO_AAC)) {
+        stream->mComponentName = "OMX.google.aac.decoder";
+    } else if (!strcasecmp(mime.c_str(), MEDIA_MIMETYPE_AUDIO_MPEG)) {
+        stream->mComponentName = "OMX.google.mp3.decoder";
+    } else {
+        fprintf(stderr, "no default decoder for %s, use -c.\n", mime.c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    size_t j = 0;
+    sp<ABuffer> csd;
+    while (stream->mFormat->findBuffer(StringPrintf("csd-%zu", j).c_str(), &csd)) {
+        stream->mCSD.push(csd);
+        ++j;
+    }
+
+    sp<ABuffer> sample = new ABuffer(kMaxSampleSize);
+    for (;;) {
+        int64_t timeUs;
+        if (extractor->getSampleTime(&timeUs) != OK) {
+            break;
+        }
+
+        CHECK_EQ(extractor->readSampleData(sample), (status_t)OK);
+
+        sp<ABuffer> accessUnit = new ABuffer(sample->size());
+        memcpy(accessUnit->data(), sample->data(), sample->size());
+        accessUnit->meta()->setInt64("timeUs", timeUs);
+        stream->mAccessUnits.push(accessUnit);
+
+        extractor->advance();
+    }
+
+    if (stream->mAccessUnits.isEmpty()) {
+        fprintf(stderr, "no samples.\n");
+        return UNKNOWN_ERROR;
+    }
+
+    return OK;
+}
+
+static status_t runMediaCodec(
+        const sp<ALooper> &looper, const Stream &stream, RunResult *result) {
+    static const int64_t kTimeout = 10000ll;
+
+    sp<MediaCodec> codec = MediaCodec::CreateByComponentName(
+            looper, stream.mComponentName.c_str());
+    if (codec == NULL) {
+        fprintf(stderr, "unable to instantiate %s.\n",
+                stream.mComponentName.c_str());
+        return UNKNOWN_ERROR;
+    }
+
+    status_t err = codec->configure(
+            stream.mFormat, NULL /* surface */, NULL /* crypto */, 0 /* flags */);
+    if (err == OK) {
+        err = codec->start();
+    }
+    if (err != OK) {
+        fprintf(stderr, "unable to start %s (err %d).\n",
+                stream.mComponentName.c_str(), err);
+        codec->release();
+        return err;
+    }
+
+    Vector<sp<ABuffer> > inBuffers;
+    CHECK_EQ(codec->getInputBuffers(&inBuffers), (status_t)OK);
+
+    // MediaCodec queues the csd-* entries of the format itself.
+    size_t numQueued = 0;
+    bool sawOutputEOS = false;
+    result->mOutputBytes = 0;
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+
+    while (!sawOutputEOS) {
+        if (numQueued <= stream.mAccessUnits.size()) {
+            size_t index;
+            err = codec->dequeueInputBuffer(&index, 0ll);
+            if (err == OK) {
+                if (numQueued == stream.mAccessUnits.size()) {
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, 0 /* size */, 0ll /* timeUs */,
+                            MediaCodec::BUFFER_FLAG_EOS);
+                } else {
+                    const sp<ABuffer> &accessUnit =
+                        stream.mAccessUnits.itemAt(numQueued);
+                    const sp<ABuffer> &buffer = inBuffers.itemAt(index);
+                    CHECK_LE(accessUnit->size(), buffer->capacity());
+                    memcpy(buffer->data(), accessUnit->data(), accessUnit->size());
+
+                    int64_t timeUs;
+                    CHECK(accessUnit->meta()->findInt64("timeUs", &timeUs));
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, accessUnit->size(), timeUs,
+                            0 /* flags */);
+                }
+                CHECK_EQ(err, (status_t)OK);
+                ++numQueued;
+            } else {
+                CHECK_EQ(err, -EAGAIN);
+            }
+        }
+
+        size_t index;
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        err = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags,
+                numQueued > stream.mAccessUnits.size() ? kTimeout : 0ll);
+
+        if (err == OK) {
+            result->mOutputBytes += size;
+            CHECK_EQ(codec->releaseOutputBuffer(index), (status_t)OK);
+
+            if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+                sawOutputEOS = true;
+            }
+        } else if (err != INFO_OUTPUT_BUFFERS_CHANGED
+                && err != INFO_FORMAT_CHANGED) {
+            CHECK_EQ(err, -EAGAIN);
+        }
+    }
+
+    result->mElapsedUs = ALooper::GetNowUs() - startTimeUs;
+
+    CHECK_EQ(codec->release(), (status_t)OK);
+
+    return OK;
+}
+
+static status_t runBatch(
+        const Stream &stream, size_t batchSize, RunResult *result) {
+    sp<SoftOMXBatchCodec> codec = new SoftOMXBatchCodec;
+
+    status_t err = codec->init(stream.mComponentName.c_str());
+    if (err != OK) {
+        fprintf(stderr, "unable to instantiate %s.\n",
+                stream.mComponentName.c_str());
+        return err;
+    }
+
+    int32_t isADTS;
+    if (stream.mFormat->findInt32("is-adts", &isADTS) && isADTS) {
+        OMX_AUDIO_PARAM_AACPROFILETYPE profile;
+        profile.nSize = sizeof(profile);
+        profile.nVersion.nVersion = 0x00000101;
+        profile.nPortIndex = 0;
+
+        if (codec->getParameter(OMX_IndexParamAudioAac, &profile)
+                    != OMX_ErrorNone) {
+            fprintf(stderr, "%s does not take ADTS input.\n",
+                    stream.mComponentName.c_str());
+            return ERROR_UNSUPPORTED;
+        }
+
+        profile.eAACStreamFormat = OMX_AUDIO_AACStreamFormatMP4ADTS;
+        CHECK_EQ((int)codec->setParameter(OMX_IndexParamAudioAac, &profile),
+                 (int)OMX_ErrorNone);
+    }
+
+    err = codec->start();
+    if (err != OK) {
+        fprintf(stderr, "unable to start %s (err %d).\n",
+                stream.mComponentName.c_str(), err);
+        return err;
+    }
+
+    Vector<sp<ABuffer> > inputs;
+    for (size_t i = 0; i < stream.mCSD.size(); ++i) {
+        const sp<ABuffer> &src = stream.mCSD.itemAt(i);
+        sp<ABuffer> csd = new ABuffer(src->size());
+        memcpy(csd->data(), src->data(), src->size());
+        csd->meta()->setInt32("csd", true);
+        inputs.push(csd);
+    }
+
+    const Vector<sp<ABuffer> > &accessUnits = stream.mAccessUnits;
+    if (batchSize == 0) {
+        batchSize = accessUnits.size();
+    }
+
+    Vector<sp<ABuffer> > outputs;
+    result->mOutputBytes = 0;
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+
+    for (size_t i = 0; i < accessUnits.size() && err == OK;) {
+        size_t n = accessUnits.size() - i;
+        if (n > batchSize) {
+            n = batchSize;
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+            inputs.push(accessUnits.itemAt(i + j));
+        }
+        i += n;
+
+        err = codec->process(inputs, i == accessUnits.size() /* eos */, &outputs);
+
+        for (size_t j = 0; j < outputs.size(); ++j) {
+            result->mOutputBytes += outputs.itemAt(j)->size();
+        }
+
+        inputs.clear();
+        outputs.clear();
+    }
+
+    result->mElapsedUs = ALooper::GetNowUs() - startTimeUs;
+
+    if (err != OK) {
+        fprintf(stderr, "batch decode failed (err %d).\n", err);
+        return err;
+    }
+
+    return codec->stop();
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    const char *componentName = NULL;
+    size_t batchSize = 0;
+    int numRuns = 1;
+
+    int res;
+    while ((res = getopt(argc, argv, "hc:b:n:")) >= 0) {
+        switch (res) {
+            case 'c':
+            {
+                componentName = optarg;
+                break;
+            }
+
+            case 'b':
+            {
+                int n = atoi(optarg);
+                if (n < 0) {
+                    usage(me);
+                }
+                batchSize = n;
+                break;
+            }
+
+            case 'n':
+            {
+                numRuns = atoi(optarg);
+                if (numRuns < 1) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    DataSource::RegisterDefaultSniffers();
+
+    Stream stream;
+    if (readStream(argv[0], componentName, &stream) != OK) {
+        return 1;
+    }
+
+    sp<ALooper> looper = new ALooper;
+    looper->start();
+
+    printf("%s, %zu access units\n",
+            stream.mComponentName.c_str(), stream.mAccessUnits.size());
+    printf("%-12s %12s %12s %14s\n", "path", "total ms", "us per unit", "output bytes");
+
+    for (int path = 0; path < 2; ++path) {
+        RunResult best;
+        best.mElapsedUs = -1;
+
+        for (int run = 0; run < numRuns; ++run) {
+            RunResult result;
+            status_t err = (path == 0)
+                ? runMediaCodec(looper, stream, &result)
+                : runBatch(stream, batchSize, &result);
+
+            if (err != OK) {
+                return 1;
+            }
+            if (best.mElapsedUs < 0 || result.mElapsedUs < best.mElapsedUs) {
+                best = result;
+            }
+        }
+
+        printf("%-12s %12.2f %12.2f %14zu\n",
+                path == 0 ? "MediaCodec" : "batch",
+                best.mElapsedUs / 1E3,
+                (double)best.mElapsedUs / stream.mAccessUnits.size(),
+                best.mOutputBytes);
+    }
+
+    looper->stop();
+
+    return 0;
+}
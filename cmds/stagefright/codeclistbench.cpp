@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "codeclistbench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/MediaCodecList.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-n runs] [-t type] [-l] [-c]\n"
+                    "\tStarts a new process per run that gets the codec list and\n"
+                    "\tlooks up a decoder, as the first use of a codec in a fresh\n"
+                    "\tprocess does, and reports the time each step took.\n"
+                    "\t[-n] number of runs (default 5)\n"
+                    "\t[-t] type to look up (default video/avc)\n"
+                    "\t[-l] build the list locally, as the media server does,\n"
+                    "\t     instead of using the shared instance\n"
+                    "\t[-c] remove the cache file first, so that the first run\n"
+                    "\t     parses the XML files and queries every codec\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+struct Result {
+    int64_t mListUs;
+    int64_t mLookupUs;
+    int32_t mIndex;
+};
+
+// Runs in the child, which has not talked to binder before.
+static void runChild(const char *type, bool local, int fd) {
+    ProcessState::self()->startThreadPool();
+
+    Result result;
+    int64_t startUs = ALooper::GetNowUs();
+
+    sp<IMediaCodecList> list = local
+        ? MediaCodecList::getLocalInstance() : MediaCodecList::getInstance();
+
+    int64_t listUs = ALooper::GetNowUs();
+    result.mListUs = listUs - startUs;
+
+    result.mIndex = -1;
+    if (list != NULL) {
+        ssize_t index = list->findCodecByType(type, false /* encoder */);
+        if (index >= 0) {
+            sp<MediaCodecInfo> info = list->getCodecInfo(index);
+            CHECK(info != NULL);
+            result.mIndex = index;
+        }
+    }
+    result.mLookupUs = ALooper::GetNowUs() - listUs;
+
+    write(fd, &result, sizeof(result));
+}
+
+static bool runOnce(const char *type, bool local, Result *result) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    } else if (pid == 0) {
+        close(fds[0]);
+        runChild(type, local, fds[1]);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    ssize_t n = read(fds[0], result, sizeof(*result));
+    close(fds[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    return n == (ssize_t)sizeof(*result);
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    int numRuns = 5;
+    const char *type = "video/avc";
+    bool local = false;
+    bool clearCache = false;
+
+    int res;
+    while ((res = getopt(argc, argv, "hn:t:lc")) >= 0) {
+        switch (res) {
+            case 'n':
+            {
+                numRuns = atoi(optarg);
+                if (numRuns < 1) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case 't':
+            {
+                type = optarg;
+                break;
+            }
+
+            case 'l':
+            {
+                local = true;
+                break;
+            }
+
+            case 'c':
+            {
+                clearCache = true;
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 0) {
+        usage(me);
+    }
+
+    if (clearCache && unlink(MediaCodecList::kCachePath) != 0
+            && errno != ENOENT) {
+        fprintf(stderr, "cannot remove %s: %s\n",
+                MediaCodecList::kCachePath, strerror(errno));
+        return 1;
+    }
+
+    printf("%-6s %10s %12s %6s\n", "run", "list ms", "lookup us", "index");
+
+    for (int run = 0; run < numRuns; ++run) {
+        Result result;
+        if (!runOnce(type, local, &result)) {
+            fprintf(stderr, "run %d failed.\n", run);
+            return 1;
+        }
+
+        printf("%-6d %10.2f %12" PRId64 " %6d\n",
+                run, result.mListUs / 1E3, result.mLookupUs, result.mIndex);
+    }
+
+    return 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "colorconvertbench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/ColorConverter.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-n frames] [-t threads]\n"
+                    "\tConverts generated YUV 4:2:0 frames of common sizes to RGB565\n"
+                    "\tand RGBA8888 and reports the time per frame, on one thread and\n"
+                    "\ton as many as the converter picks. The per-pixel loop\n"
+                    "\tColorConverter used to run is timed for comparison, and its\n"
+                    "\toutput is checked against the converter's.\n"
+                    "\t[-n] frames per measurement (default 100)\n"
+                    "\t[-t] most threads, 0 for one per CPU (default 0)\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+struct SourceFormat {
+    OMX_COLOR_FORMATTYPE mFormat;
+    const char *mName;
+};
+
+static const SourceFormat kSourceFormats[] = {
+    { OMX_COLOR_FormatYUV420Planar, "I420" },
+    { OMX_COLOR_FormatYUV420SemiPlanar, "NV12" },
+    { OMX_QCOM_COLOR_FormatYVU420SemiPlanar, "QCOM NV21" },
+    { OMX_TI_COLOR_FormatYUV420PackedSemiPlanar, "TI packed" },
+};
+
+static const struct {
+    size_t mWidth;
+    size_t mHeight;
+} kSizes[] = {
+    { 640, 480 },
+    { 1280, 720 },
+    { 1920, 1080 },
+};
+
+// Smooth gradients with some noise, so that every pixel differs from its
+// neighbours and the chroma covers its whole range.
+static void generateFrame(size_t width, size_t height, uint8_t *data) {
+    uint32_t seed = 1;
+    for (size_t i = 0; i < width * height * 3 / 2; ++i) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (uint8_t)((i % width) + (i / width) * 3 + ((seed >> 16) & 0x1f));
+    }
+}
+
+// The I420 to RGB565 loop ColorConverter ran for every pixel before it had
+// vector kernels.
+static void convertLegacy(
+        const uint8_t *src, size_t width, size_t height, uint16_t *dst) {
+    static uint8_t clip[814];
+    uint8_t *kAdjustedClip = &clip[278];
+    for (signed i = -278; i <= 535; ++i) {
+        kAdjustedClip[i] = (i < 0) ? 0 : (i > 255) ? 255 : (uint8_t)i;
+    }
+
+    const uint8_t *src_y = src;
+    const uint8_t *src_u = src_y + width * height;
+    const uint8_t *src_v = src_u + (width / 2) * (height / 2);
+
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; x += 2) {
+            signed y1 = (signed)src_y[x] - 16;
+            signed y2 = (signed)src_y[x + 1] - 16;
+
+            signed u = (signed)src_u[x / 2] - 128;
+            signed v = (signed)src_v[x / 2] - 128;
+
+            signed u_b = u * 517;
+            signed u_g = -u * 100;
+            signed v_g = -v * 208;
+            signed v_r = v * 409;
+
+            signed tmp1 = y1 * 298;
+            signed b1 = (tmp1 + u_b) / 256;
+            signed g1 = (tmp1 + v_g + u_g) / 256;
+            signed r1 = (tmp1 + v_r) / 256;
+
+            signed tmp2 = y2 * 298;
+            signed b2 = (tmp2 + u_b) / 256;
+            signed g2 = (tmp2 + v_g + u_g) / 256;
+            signed r2 = (tmp2 + v_r) / 256;
+
+            dst[x] = ((kAdjustedClip[r1] >> 3) << 11)
+                | ((kAdjustedClip[g1] >> 2) << 5)
+                | (kAdjustedClip[b1] >> 3);
+
+            dst[x + 1] = ((kAdjustedClip[r2] >> 3) << 11)
+                | ((kAdjustedClip[g2] >> 2) << 5)
+                | (kAdjustedClip[b2] >> 3);
+        }
+
+        src_y += width;
+        if (y & 1) {
+            src_u += width / 2;
+            src_v += width / 2;
+        }
+        dst += width;
+    }
+}
+
+static void printResult(
+        const char *source, const char *dest, const char *threads,
+        size_t width, size_t height, int64_t elapsedUs, int numFrames) {
+    double msPerFrame = elapsedUs / 1E3 / numFrames;
+    printf("%-10s %-9s %-8s %8.3f %10.1f\n",
+            source, dest, threads, msPerFrame,
+            width * height / (msPerFrame * 1E3));
+}
+
+static int64_t timeConversion(
+        ColorConverter *converter, const uint8_t *src, void *dst,
+        size_t width, size_t height, int numFrames) {
+    int64_t startTimeUs = ALooper::GetNowUs();
+    for (int i = 0; i < numFrames; ++i) {
+        CHECK_EQ(converter->convert(
+                    src, width, height, 0, 0, width - 1, height - 1,
+                    dst, width, height, 0, 0, width - 1, height - 1),
+                 (status_t)OK);
+    }
+    return ALooper::GetNowUs() - startTimeUs;
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    int numFrames = 100;
+    int maxThreads = 0;
+
+    int res;
+    while ((res = getopt(argc, argv, "hn:t:")) >= 0) {
+        switch (res) {
+            case 'n':
+            {
+                numFrames = atoi(optarg);
+                if (numFrames < 1) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case 't':
+            {
+                maxThreads = atoi(optarg);
+                if (maxThreads < 0) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 0) {
+        usage(me);
+    }
+
+    char threads[16];
+    if (maxThreads == 0) {
+        strcpy(threads, "auto");
+    } else {
+        snprintf(threads, sizeof(threads), "%d", maxThreads);
+    }
+
+    bool mismatch = false;
+
+    for (size_t s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); ++s) {
+        size_t width = kSizes[s].mWidth;
+        size_t height = kSizes[s].mHeight;
+
+        uint8_t *src = new uint8_t[width * height * 3 / 2];
+        uint8_t *dst = new uint8_t[width * height * 4];
+        uint16_t *reference = new uint16_t[width * height];
+
+        generateFrame(width, height, src);
+
+        printf("%zux%zu\n", width, height);
+        printf("%-10s %-9s %-8s %8s %10s\n",
+                "source", "dest", "threads", "ms/frame", "Mpixel/s");
+
+        int64_t startTimeUs = ALooper::GetNowUs();
+        for (int i = 0; i < numFrames; ++i) {
+            convertLegacy(src, width, height, reference);
+        }
+        printResult("I420", "RGB565", "legacy", width, height,
+                ALooper::GetNowUs() - startTimeUs, numFrames);
+
+        for (size_t f = 0; f < sizeof(kSourceFormats) / sizeof(kSourceFormats[0]); ++f) {
+            for (int rgba = 0; rgba < 2; ++rgba) {
+                ColorConverter converter(
+                        kSourceFormats[f].mFormat,
+                        rgba ? kColorFormatRGBA8888 : OMX_COLOR_Format16bitRGB565);
+                CHECK(converter.isValid());
+
+                converter.setMaxThreads(1);
+                int64_t elapsedUs = timeConversion(
+                        &converter, src, dst, width, height, numFrames);
+                printResult(kSourceFormats[f].mName, rgba ? "RGBA8888" : "RGB565",
+                        "1", width, height, elapsedUs, numFrames);
+
+                if (f == 0 && !rgba
+                        && memcmp(dst, reference, width * height * 2)) {
+                    fprintf(stderr, "I420 to RGB565 differs from the legacy loop.\n");
+                    mismatch = true;
+                }
+
+                converter.setMaxThreads(maxThreads);
+                elapsedUs = timeConversion(
+                        &converter, src, dst, width, height, numFrames);
+                printResult(kSourceFormats[f].mName, rgba ? "RGBA8888" : "RGB565",
+                        threads, width, height, elapsedUs, numFrames);
+            }
+        }
+
+        printf("\n");
+
+        delete[] reference;
+        delete[] dst;
+        delete[] src;
+    }
+
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "decoderbench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <utils/KeyedVector.h>
+#include <utils/Vector.h>
+
+#include <algorithm>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-c component] [-n runs] file\n"
+                    "\tDecodes the first video track of file to byte buffers once per\n"
+                    "\tthreading configuration and reports throughput and per-frame\n"
+                    "\tlatency (queueInputBuffer to dequeueOutputBuffer).\n"
+                    "\t[-c] decoder component (default OMX.google.hevc.decoder)\n"
+                    "\t[-n] runs per configuration, the best one is reported (default 1)\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+struct BenchConfig {
+    const char *mName;
+    int32_t mThreadCount;       // -1 to leave unset
+    int32_t mAutoThreadCount;   // -1 to leave unset
+    int32_t mDecodeAhead;       // -1 to leave unset
+};
+
+static const BenchConfig kConfigs[] = {
+    { "default",            -1, -1, -1 },
+    { "1 thread",            1,  0, -1 },
+    { "2 threads",           2,  0, -1 },
+    { "4 threads",           4,  0, -1 },
+    { "auto",                0,  1, -1 },
+    { "auto, 4 buffers",     0,  1,  4 },
+    { "auto, 16 buffers",    0,  1, 16 },
+};
+
+struct BenchResult {
+    int64_t mNumFrames;
+    double mFps;
+    double mAvgLatencyMs;
+    double mP95LatencyMs;
+};
+
+static status_t runConfig(
+        const sp<ALooper> &looper,
+        const char *path,
+        const char *componentName,
+        const BenchConfig &config,
+        BenchResult *result) {
+    static const int64_t kTimeout = 10000ll;
+
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor;
+    if (extractor->setDataSource(NULL /* httpService */, path) != OK) {
+        fprintf(stderr, "unable to instantiate extractor.\n");
+        return UNKNOWN_ERROR;
+    }
+
+    sp<AMessage> format;
+    size_t i;
+    for (i = 0; i < extractor->countTracks(); ++i) {
+        CHECK_EQ(extractor->getTrackFormat(i, &format), (status_t)OK);
+
+        AString mime;
+        CHECK(format->findString("mime", &mime));
+        if (!strncasecmp(mime.c_str(), "video/", 6)) {
+            break;
+        }
+    }
+    if (i == extractor->countTracks()) {
+        fprintf(stderr, "no video track.\n");
+        return UNKNOWN_ERROR;
+    }
+    CHECK_EQ(extractor->selectTrack(i), (status_t)OK);
+
+    if (config.mThreadCount >= 0) {
+        format->setInt32("thread-count", config.mThreadCount);
+    }
+    if (config.mAutoThreadCount >= 0) {
+        format->setInt32("auto-thread-count", config.mAutoThreadCount);
+    }
+    if (config.mDecodeAhead >= 0) {
+        format->setInt32("decode-ahead-buffers", config.mDecodeAhead);
+    }
+
+    sp<MediaCodec> codec = MediaCodec::CreateByComponentName(looper, componentName);
+    if (codec == NULL) {
+        fprintf(stderr, "unable to instantiate %s.\n", componentName);
+        return UNKNOWN_ERROR;
+    }
+
+    status_t err = codec->configure(
+            format, NULL /* surface */, NULL /* crypto */, 0 /* flags */);
+    if (err == OK) {
+        err = codec->start();
+    }
+    if (err != OK) {
+        fprintf(stderr, "unable to start %s (err %d).\n", componentName, err);
+        codec->release();
+        return err;
+    }
+
+    Vector<sp<ABuffer> > inBuffers;
+    CHECK_EQ(codec->getInputBuffers(&inBuffers), (status_t)OK);
+
+    // Presentation time -> time the input was queued. The decoder may reorder
+    // frames, so match them up by timestamp.
+    KeyedVector<int64_t, int64_t> queuedAtUs;
+    Vector<int64_t> latenciesUs;
+
+    bool signalledInputEOS = false;
+    bool sawOutputEOS = false;
+    int64_t startTimeUs = ALooper::GetNowUs();
+
+    while (!sawOutputEOS) {
+        if (!signalledInputEOS) {
+            size_t index;
+            err = codec->dequeueInputBuffer(&index, 0ll);
+            if (err == OK) {
+                const sp<ABuffer> &buffer = inBuffers.itemAt(index);
+
+                int64_t timeUs;
+                if (extractor->getSampleTime(&timeUs) != OK) {
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, 0 /* size */, 0ll /* timeUs */,
+                            MediaCodec::BUFFER_FLAG_EOS);
+                    CHECK_EQ(err, (status_t)OK);
+                    signalledInputEOS = true;
+                } else {
+                    CHECK_EQ(extractor->readSampleData(buffer), (status_t)OK);
+
+                    queuedAtUs.add(timeUs, ALooper::GetNowUs());
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, buffer->size(), timeUs,
+                            0 /* flags */);
+                    CHECK_EQ(err, (status_t)OK);
+
+                    extractor->advance();
+                }
+            } else {
+                CHECK_EQ(err, -EAGAIN);
+            }
+        }
+
+        size_t index;
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        err = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags,
+                signalledInputEOS ? kTimeout : 0ll);
+
+        if (err == OK) {
+            ssize_t queued = queuedAtUs.indexOfKey(presentationTimeUs);
+            if (size > 0 && queued >= 0) {
+                latenciesUs.push(ALooper::GetNowUs() - queuedAtUs.valueAt(queued));
+                queuedAtUs.removeItemsAt(queued);
+            }
+
+            CHECK_EQ(codec->releaseOutputBuffer(index), (status_t)OK);
+
+            if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+                sawOutputEOS = true;
+            }
+        } else if (err != INFO_OUTPUT_BUFFERS_CHANGED
+                && err != INFO_FORMAT_CHANGED) {
+            CHECK_EQ(err, -EAGAIN);
+        }
+    }
+
+    int64_t elapsedTimeUs = ALooper::GetNowUs() - startTimeUs;
+
+    CHECK_EQ(codec->release(), (status_t)OK);
+
+    result->mNumFrames = latenciesUs.size();
+    result->mFps = result->mNumFrames * 1E6 / elapsedTimeUs;
+    result->mAvgLatencyMs = 0;
+    result->mP95LatencyMs = 0;
+    if (!latenciesUs.isEmpty()) {
+        int64_t *latencies = latenciesUs.editArray();
+        size_t n = latenciesUs.size();
+
+        int64_t sumUs = 0;
+        for (size_t j = 0; j < n; ++j) {
+            sumUs += latencies[j];
+        }
+        std::sort(latencies, latencies + n);
+
+        result->mAvgLatencyMs = sumUs / 1E3 / n;
+        result->mP95LatencyMs = latencies[(n - 1) * 95 / 100] / 1E3;
+    }
+
+    return OK;
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    const char *componentName = "OMX.google.hevc.decoder";
+    int numRuns = 1;
+
+    int res;
+    while ((res = getopt(argc, argv, "hc:n:")) >= 0) {
+        switch (res) {
+            case 'c':
+            {
+                componentName = optarg;
+                break;
+            }
+
+            case 'n':
+            {
+                numRuns = atoi(optarg);
+                if (numRuns < 1) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    DataSource::RegisterDefaultSniffers();
+
+    sp<ALooper> looper = new ALooper;
+    looper->start();
+
+    printf("%-18s %8s %9s %12s %12s\n",
+            "config", "frames", "fps", "avg lat ms", "p95 lat ms");
+
+    for (size_t i = 0; i < sizeof(kConfigs) / sizeof(kConfigs[0]); ++i) {
+        BenchResult best;
+        best.mFps = -1;
+
+        for (int run = 0; run < numRuns; ++run) {
+            BenchResult result;
+            if (runConfig(looper, argv[0], componentName, kConfigs[i], &result) != OK) {
+                return 1;
+            }
+            if (result.mFps > best.mFps) {
+                best = result;
+            }
+        }
+
+        printf("%-18s %8" PRId64 " %9.2f %12.2f %12.2f\n",
+                kConfigs[i].mName, best.mNumFrames, best.mFps,
+                best.mAvgLatencyMs, best.mP95LatencyMs);
+    }
+
+    looper->stop();
+
+    return 0;
+}
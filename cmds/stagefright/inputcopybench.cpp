@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "inputcopybench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <utils/Vector.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-n runs] [-a] file\n"
+                    "\tReads every sample of the first video track of file, once\n"
+                    "\tthrough readSampleData() and advance(), which copy each sample\n"
+                    "\tout of the extractor's own buffer, and once through\n"
+                    "\treadSampleDataAndAdvance(), which reads it in place. Both are\n"
+                    "\tdone into a plain buffer and into the input buffers of a\n"
+                    "\tdecoder, and the time and CPU taken by this process are\n"
+                    "\treported for each.\n"
+                    "\t[-n] runs per mode, the one using the least CPU is reported\n"
+                    "\t     (default 3)\n"
+                    "\t[-a] use the first audio track instead\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+struct Result {
+    size_t mNumSamples;
+    int64_t mNumBytes;
+    int64_t mElapsedUs;
+    int64_t mCpuUs;
+};
+
+static int64_t getCpuTimeUs() {
+    struct rusage usage;
+    CHECK_EQ(getrusage(RUSAGE_SELF, &usage), 0);
+
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ll
+        + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static sp<NuMediaExtractor> openTrack(
+        const char *path, bool audio, sp<AMessage> *format) {
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor;
+    if (extractor->setDataSource(NULL /* httpService */, path) != OK) {
+        fprintf(stderr, "unable to instantiate extractor.\n");
+        return NULL;
+    }
+
+    const char *prefix = audio ? "audio/" : "video/";
+    for (size_t i = 0; i < extractor->countTracks(); ++i) {
+        CHECK_EQ(extractor->getTrackFormat(i, format), (status_t)OK);
+
+        AString mime;
+        CHECK((*format)->findString("mime", &mime));
+        if (!strncasecmp(mime.c_str(), prefix, 6)) {
+            CHECK_EQ(extractor->selectTrack(i), (status_t)OK);
+            return extractor;
+        }
+    }
+
+    fprintf(stderr, "no %s track.\n", audio ? "audio" : "video");
+    return NULL;
+}
+
+// Reads the next sample into |buffer|, the old way or the new one.
+static status_t readSample(
+        const sp<NuMediaExtractor> &extractor, bool inPlace,
+        const sp<ABuffer> &buffer, int64_t *timeUs) {
+    if (inPlace) {
+        size_t trackIndex;
+        sp<MetaData> meta;
+        status_t err =
+            extractor->readSampleDataAndAdvance(buffer, &trackIndex, &meta);
+
+        if (err == OK) {
+            CHECK(meta->findInt64(kKeyTime, timeUs));
+        }
+        return err;
+    }
+
+    status_t err = extractor->getSampleTime(timeUs);
+    if (err != OK) {
+        return err;
+    }
+
+    CHECK_EQ(extractor->readSampleData(buffer), (status_t)OK);
+    extractor->advance();
+
+    return OK;
+}
+
+static bool runExtract(
+        const char *path, bool audio, bool inPlace, Result *result) {
+    sp<AMessage> format;
+    sp<NuMediaExtractor> extractor = openTrack(path, audio, &format);
+    if (extractor == NULL) {
+        return false;
+    }
+
+    int32_t maxInputSize;
+    if (!format->findInt32("max-input-size", &maxInputSize)) {
+        maxInputSize = 1024 * 1024;
+    }
+    sp<ABuffer> buffer = new ABuffer(maxInputSize);
+
+    result->mNumSamples = 0;
+    result->mNumBytes = 0;
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+    int64_t startCpuUs = getCpuTimeUs();
+
+    int64_t timeUs;
+    while (readSample(extractor, inPlace, buffer, &timeUs) == OK) {
+        ++result->mNumSamples;
+        result->mNumBytes += buffer->size();
+    }
+
+    result->mElapsedUs = ALooper::GetNowUs() - startTimeUs;
+    result->mCpuUs = getCpuTimeUs() - startCpuUs;
+
+    return true;
+}
+
+static bool runDecode(
+        const sp<ALooper> &looper, const char *path, bool audio, bool inPlace,
+        Result *result) {
+    static const int64_t kTimeout = 10000ll;
+
+    sp<AMessage> format;
+    sp<NuMediaExtractor> extractor = openTrack(path, audio, &format);
+    if (extractor == NULL) {
+        return false;
+    }
+
+    AString mime;
+    CHECK(format->findString("mime", &mime));
+
+    sp<MediaCodec> codec = MediaCodec::CreateByType(
+            looper, mime.c_str(), false /* encoder */);
+    if (codec == NULL) {
+        fprintf(stderr, "unable to instantiate a decoder for %s.\n", mime.c_str());
+        return false;
+    }
+
+    status_t err = codec->configure(
+            format, NULL /* surface */, NULL /* crypto */, 0 /* flags */);
+    if (err == OK) {
+        err = codec->start();
+    }
+    if (err != OK) {
+        fprintf(stderr, "unable to start the decoder (err %d).\n", err);
+        codec->release();
+        return false;
+    }
+
+    Vector<sp<ABuffer> > inBuffers;
+    CHECK_EQ(codec->getInputBuffers(&inBuffers), (status_t)OK);
+
+    result->mNumSamples = 0;
+    result->mNumBytes = 0;
+
+    bool signalledInputEOS = false;
+    bool sawOutputEOS = false;
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+    int64_t startCpuUs = getCpuTimeUs();
+
+    while (!sawOutputEOS) {
+        if (!signalledInputEOS) {
+            size_t index;
+            err = codec->dequeueInputBuffer(&index, 0ll);
+            if (err == OK) {
+                const sp<ABuffer> &buffer = inBuffers.itemAt(index);
+
+                int64_t timeUs;
+                if (readSample(extractor, inPlace, buffer, &timeUs) != OK) {
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, 0 /* size */, 0ll /* timeUs */,
+                            MediaCodec::BUFFER_FLAG_EOS);
+                    CHECK_EQ(err, (status_t)OK);
+                    signalledInputEOS = true;
+                } else {
+                    ++result->mNumSamples;
+                    result->mNumBytes += buffer->size();
+
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, buffer->size(), timeUs,
+                            0 /* flags */);
+                    CHECK_EQ(err, (status_t)OK);
+                }
+            } else {
+                CHECK_EQ(err, -EAGAIN);
+            }
+        }
+
+        size_t index;
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        err = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags,
+                signalledInputEOS ? kTimeout : 0ll);
+
+        if (err == OK) {
+            CHECK_EQ(codec->releaseOutputBuffer(index), (status_t)OK);
+
+            if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+                sawOutputEOS = true;
+            }
+        } else if (err != INFO_OUTPUT_BUFFERS_CHANGED
+                && err != INFO_FORMAT_CHANGED) {
+            CHECK_EQ(err, -EAGAIN);
+        }
+    }
+
+    result->mElapsedUs = ALooper::GetNowUs() - startTimeUs;
+    result->mCpuUs = getCpuTimeUs() - startCpuUs;
+
+    CHECK_EQ(codec->release(), (status_t)OK);
+
+    return true;
+}
+
+static void printResult(const char *name, const Result &result) {
+    double seconds = result.mElapsedUs / 1E6;
+
+    printf("%-16s %8zu %10.1f %10.1f %10.1f %12.2f %10.1f\n",
+            name, result.mNumSamples, result.mNumBytes / 1E6,
+            result.mElapsedUs / 1E3, result.mCpuUs / 1E3,
+            result.mNumSamples > 0
+                ? (double)result.mCpuUs / result.mNumSamples : 0.0,
+            seconds > 0 ? result.mNumBytes / 1E6 / seconds : 0.0);
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    int numRuns = 3;
+    bool audio = false;
+
+    int res;
+    while ((res = getopt(argc, argv, "hn:a")) >= 0) {
+        switch (res) {
+            case 'n':
+            {
+                numRuns = atoi(optarg);
+                if (numRuns < 1) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case 'a':
+            {
+                audio = true;
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    DataSource::RegisterDefaultSniffers();
+
+    sp<ALooper> looper = new ALooper;
+    looper->start();
+
+    printf("%-16s %8s %10s %10s %10s %12s %10s\n",
+            "mode", "samples", "MB", "ms", "cpu ms", "cpu us/smpl", "MB/s");
+
+    static const struct {
+        const char *mName;
+        bool mDecode;
+        bool mInPlace;
+    } kModes[] = {
+        { "extract, copy",   false, false },
+        { "extract, direct", false, true },
+        { "decode, copy",    true,  false },
+        { "decode, direct",  true,  true },
+    };
+
+    for (size_t i = 0; i < sizeof(kModes) / sizeof(kModes[0]); ++i) {
+        Result best;
+        for (int run = 0; run < numRuns; ++run) {
+            Result result;
+            bool ok = kModes[i].mDecode
+                ? runDecode(looper, argv[0], audio, kModes[i].mInPlace, &result)
+                : runExtract(argv[0], audio, kModes[i].mInPlace, &result);
+
+            if (!ok) {
+                looper->stop();
+                return 1;
+            }
+            if (run == 0 || result.mCpuUs < best.mCpuUs) {
+                best = result;
+            }
+        }
+
+        printResult(kModes[i].mName, best);
+    }
+
+    looper->stop();
+
+    return 0;
+}
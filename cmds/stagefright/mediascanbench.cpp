@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "mediascanbench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/StagefrightMediaScanner.h>
+#include <utils/String8.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-n files] [-f files per directory] [-t threads] directory\n"
+                    "\tGenerates a tree of small media files below directory (which\n"
+                    "\tmust not exist yet) and scans it the way the media provider\n"
+                    "\tdoes, processing every file the scanner reports: on one thread,\n"
+                    "\ton several, and on several again with an index left by the\n"
+                    "\tprevious scan so only changed files are reported. Page cache\n"
+                    "\tis dropped before each scan if possible (needs root).\n"
+                    "\t[-n] number of files (default 10000)\n"
+                    "\t[-f] files per directory (default 50)\n"
+                    "\t[-t] threads for the parallel scans, 0 for one per CPU (default 0)\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+// Reports like the media provider's client, which processes each file it is
+// told about unless its database says it has not changed; here nothing is in
+// the database.
+struct BenchClient : public MediaScannerClient {
+    BenchClient(MediaScanner *scanner)
+        : mScanner(scanner),
+          mNumDirectories(0),
+          mNumFiles(0) {
+    }
+
+    virtual status_t scanFile(const char *path, long long /* lastModified */,
+            long long /* fileSize */, bool isDirectory, bool /* noMedia */) {
+        if (isDirectory) {
+            ++mNumDirectories;
+            return OK;
+        }
+
+        ++mNumFiles;
+        if (mScanner->processFile(path, NULL /* mimeType */, *this)
+                == MEDIA_SCAN_RESULT_ERROR) {
+            return UNKNOWN_ERROR;
+        }
+        return OK;
+    }
+
+    virtual status_t handleStringTag(const char * /* name */, const char * /* value */) {
+        return OK;
+    }
+
+    virtual status_t setMimeType(const char * /* mimeType */) {
+        return OK;
+    }
+
+    MediaScanner *mScanner;
+    size_t mNumDirectories;
+    size_t mNumFiles;
+};
+
+// Files of a few KB, mostly of extensions the scanner opens, spread over
+// directories two levels deep.
+static bool generateTree(const char *root, int numFiles, int filesPerDirectory) {
+    static const char *kExtensions[] = { ".mp3", ".m4a", ".ogg", ".jpg", ".txt" };
+    static const size_t kNumExtensions = sizeof(kExtensions) / sizeof(kExtensions[0]);
+
+    if (mkdir(root, 0755) != 0) {
+        fprintf(stderr, "cannot create %s: %s\n", root, strerror(errno));
+        return false;
+    }
+
+    uint8_t data[4096];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = (uint8_t)(i * 7);
+    }
+
+    int numDirectories = (numFiles + filesPerDirectory - 1) / filesPerDirectory;
+    for (int d = 0; d < numDirectories; ++d) {
+        String8 dir(root);
+        dir.appendFormat("/artist%03d", d / 16);
+        mkdir(dir.string(), 0755);
+        dir.appendFormat("/album%03d", d);
+        if (mkdir(dir.string(), 0755) != 0) {
+            fprintf(stderr, "cannot create %s: %s\n", dir.string(), strerror(errno));
+            return false;
+        }
+
+        for (int f = 0; f < filesPerDirectory && d * filesPerDirectory + f < numFiles; ++f) {
+            String8 path(dir);
+            path.appendFormat("/track%03d%s", f, kExtensions[f % kNumExtensions]);
+
+            int fd = open(path.string(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                fprintf(stderr, "cannot create %s: %s\n", path.string(), strerror(errno));
+                return false;
+            }
+            write(fd, data, 1024 + (f * 97) % (sizeof(data) - 1024));
+            close(fd);
+        }
+    }
+
+    sync();
+    return true;
+}
+
+static bool dropCaches() {
+    int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write(fd, "3", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+static void runScan(
+        const char *name, const char *root, size_t numThreads,
+        const char *indexPath, bool cachesDropped) {
+    if (cachesDropped) {
+        dropCaches();
+    }
+
+    StagefrightMediaScanner scanner;
+    scanner.setMaxThreads(numThreads);
+    scanner.setIndexPath(indexPath);
+
+    BenchClient client(&scanner);
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+    MediaScanResult result = scanner.processDirectory(root, client);
+    int64_t elapsedUs = ALooper::GetNowUs() - startTimeUs;
+
+    CHECK_EQ(result, MEDIA_SCAN_RESULT_OK);
+
+    printf("%-16s %8zu %8zu %10.1f\n",
+            name, client.mNumDirectories, client.mNumFiles, elapsedUs / 1E3);
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    int numFiles = 10000;
+    int filesPerDirectory = 50;
+    int numThreads = 0;
+
+    int res;
+    while ((res = getopt(argc, argv, "hn:f:t:")) >= 0) {
+        switch (res) {
+            case 'n':
+            case 'f':
+            case 't':
+            {
+                int value = atoi(optarg);
+                if (value < (res == 't' ? 0 : 1)) {
+                    usage(me);
+                }
+
+                switch (res) {
+                    case 'n': numFiles = value; break;
+                    case 'f': filesPerDirectory = value; break;
+                    default: numThreads = value; break;
+                }
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage(me);
+    }
+
+    const char *root = argv[0];
+    if (!generateTree(root, numFiles, filesPerDirectory)) {
+        return 1;
+    }
+
+    String8 indexPath(root);
+    indexPath.append(".index");
+    unlink(indexPath.string());
+
+    bool cachesDropped = dropCaches();
+    if (!cachesDropped) {
+        printf("cannot drop the page cache, cold scans run on cached metadata\n");
+    }
+
+    printf("%-16s %8s %8s %10s\n", "scan", "dirs", "files", "ms");
+
+    runScan("cold, 1 thread", root, 1, NULL, cachesDropped);
+    runScan("cold, parallel", root, numThreads, NULL, cachesDropped);
+
+    // The first indexed scan reports everything and writes the index.
+    runScan("index, first", root, numThreads, indexPath.string(), cachesDropped);
+    runScan("index, warm", root, numThreads, indexPath.string(), cachesDropped);
+
+    return 0;
+}
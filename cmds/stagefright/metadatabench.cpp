@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "metadatabench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/FileSource.h>
+#include <media/stagefright/MediaExtractor.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/String8.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-n runs] file ...\n"
+                    "\tExtracts what the media scanner asks for from each file, once\n"
+                    "\twith a full extractor and once with a metadata-only one, and\n"
+                    "\treports the time and the bytes read for each, and whether the\n"
+                    "\ttwo agree. Page cache is dropped before each extraction if\n"
+                    "\tpossible (needs root).\n"
+                    "\t[-n] runs per file and mode, the fastest is reported (default 1)\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+// Passes reads through to another source, counting them.
+struct CountingSource : public DataSource {
+    CountingSource(const sp<DataSource> &source)
+        : mSource(source),
+          mNumReads(0),
+          mBytesRead(0) {
+    }
+
+    virtual status_t initCheck() const {
+        return mSource->initCheck();
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        ssize_t n = mSource->readAt(offset, data, size);
+        ++mNumReads;
+        if (n > 0) {
+            mBytesRead += n;
+        }
+        return n;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        return mSource->getSize(size);
+    }
+
+    virtual uint32_t flags() {
+        return mSource->flags();
+    }
+
+    sp<DataSource> mSource;
+    size_t mNumReads;
+    int64_t mBytesRead;
+};
+
+struct Result {
+    int64_t mElapsedUs;
+    size_t mNumReads;
+    int64_t mBytesRead;
+    String8 mSummary;
+};
+
+static void appendString(const sp<MetaData> &meta, uint32_t key, String8 *out) {
+    const char *value;
+    out->append(meta->findCString(key, &value) ? value : "-");
+    out->append("|");
+}
+
+static void appendInt(const sp<MetaData> &meta, uint32_t key, String8 *out) {
+    int64_t value64;
+    int32_t value32;
+    if (meta->findInt64(key, &value64)) {
+        out->appendFormat("%" PRId64 "|", value64);
+    } else if (meta->findInt32(key, &value32)) {
+        out->appendFormat("%d|", value32);
+    } else {
+        out->append("-|");
+    }
+}
+
+static bool dropCaches() {
+    int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write(fd, "3", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+// Asks the extractor for what StagefrightMetadataRetriever::parseMetaData()
+// does, and sums it up in a string for comparison.
+static bool extract(
+        const char *path, uint32_t flags, bool cachesDropped, Result *result) {
+    if (cachesDropped) {
+        dropCaches();
+    }
+
+    sp<CountingSource> source = new CountingSource(new FileSource(path));
+    if (source->initCheck() != OK) {
+        return false;
+    }
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+
+    sp<MediaExtractor> extractor = MediaExtractor::Create(source, NULL, flags);
+    if (extractor == NULL) {
+        return false;
+    }
+
+    String8 summary;
+
+    sp<MetaData> meta = extractor->getMetaData();
+    if (meta != NULL) {
+        static const uint32_t kFileKeys[] = {
+            kKeyMIMEType, kKeyTitle, kKeyArtist, kKeyAlbum, kKeyAlbumArtist,
+            kKeyComposer, kKeyGenre, kKeyYear, kKeyCDTrackNumber,
+            kKeyDiscNumber, kKeyCompilation, kKeyLocation,
+        };
+        for (size_t i = 0; i < sizeof(kFileKeys) / sizeof(kFileKeys[0]); ++i) {
+            appendString(meta, kFileKeys[i], &summary);
+        }
+    }
+
+    size_t numTracks = extractor->countTracks();
+    for (size_t i = 0; i < numTracks; ++i) {
+        sp<MetaData> trackMeta = extractor->getTrackMetaData(i);
+        if (trackMeta == NULL) {
+            continue;
+        }
+
+        appendString(trackMeta, kKeyMIMEType, &summary);
+        appendInt(trackMeta, kKeyDuration, &summary);
+        appendInt(trackMeta, kKeyWidth, &summary);
+        appendInt(trackMeta, kKeyHeight, &summary);
+        appendInt(trackMeta, kKeyRotation, &summary);
+        appendInt(trackMeta, kKeyBitRate, &summary);
+        appendInt(trackMeta, kKeySampleRate, &summary);
+        appendInt(trackMeta, kKeyChannelCount, &summary);
+    }
+
+    result->mElapsedUs = ALooper::GetNowUs() - startTimeUs;
+    result->mNumReads = source->mNumReads;
+    result->mBytesRead = source->mBytesRead;
+    result->mSummary = summary;
+
+    return true;
+}
+
+static bool extractBest(
+        const char *path, uint32_t flags, int numRuns, bool cachesDropped,
+        Result *best) {
+    for (int run = 0; run < numRuns; ++run) {
+        Result result;
+        if (!extract(path, flags, cachesDropped, &result)) {
+            return false;
+        }
+        if (run == 0 || result.mElapsedUs < best->mElapsedUs) {
+            *best = result;
+        }
+    }
+    return true;
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    int numRuns = 1;
+
+    int res;
+    while ((res = getopt(argc, argv, "hn:")) >= 0) {
+        switch (res) {
+            case 'n':
+            {
+                numRuns = atoi(optarg);
+                if (numRuns < 1) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc < 1) {
+        usage(me);
+    }
+
+    DataSource::RegisterDefaultSniffers();
+
+    bool cachesDropped = dropCaches();
+    if (!cachesDropped) {
+        printf("cannot drop the page cache, files are read from memory\n");
+    }
+
+    printf("%-32s %9s %10s %6s %9s %10s %6s %s\n",
+            "file", "full ms", "full KB", "reads", "meta ms", "meta KB", "reads",
+            "same");
+
+    Result fullTotal = { 0, 0, 0, String8() };
+    Result metaTotal = { 0, 0, 0, String8() };
+    int numFiles = 0;
+    int numDiffering = 0;
+
+    for (int i = 0; i < argc; ++i) {
+        const char *path = argv[i];
+        const char *name = strrchr(path, '/');
+        name = (name != NULL) ? name + 1 : path;
+
+        Result full, meta;
+        if (!extractBest(path, 0, numRuns, cachesDropped, &full)
+                || !extractBest(path, MediaExtractor::kMetaDataOnly, numRuns,
+                        cachesDropped, &meta)) {
+            printf("%-32.32s cannot extract\n", name);
+            continue;
+        }
+
+        bool same = full.mSummary == meta.mSummary;
+        if (!same) {
+            ++numDiffering;
+            ALOGW("%s: full '%s', metadata-only '%s'",
+                    path, full.mSummary.string(), meta.mSummary.string());
+        }
+
+        printf("%-32.32s %9.2f %10.1f %6zu %9.2f %10.1f %6zu %s\n",
+                name, full.mElapsedUs / 1E3, full.mBytesRead / 1024.0,
+                full.mNumReads, meta.mElapsedUs / 1E3, meta.mBytesRead / 1024.0,
+                meta.mNumReads, same ? "yes" : "NO");
+
+        fullTotal.mElapsedUs += full.mElapsedUs;
+        fullTotal.mBytesRead += full.mBytesRead;
+        fullTotal.mNumReads += full.mNumReads;
+        metaTotal.mElapsedUs += meta.mElapsedUs;
+        metaTotal.mBytesRead += meta.mBytesRead;
+        metaTotal.mNumReads += meta.mNumReads;
+        ++numFiles;
+    }
+
+    printf("%-32s %9.2f %10.1f %6zu %9.2f %10.1f %6zu %d/%d\n",
+            "total", fullTotal.mElapsedUs / 1E3, fullTotal.mBytesRead / 1024.0,
+            fullTotal.mNumReads, metaTotal.mElapsedUs / 1E3,
+            metaTotal.mBytesRead / 1024.0, metaTotal.mNumReads,
+            numFiles - numDiffering, numFiles);
+
+    return numDiffering != 0 ? 1 : 0;
+}
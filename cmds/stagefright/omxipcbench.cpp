@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "omxipcbench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <utils/Vector.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-r rate] [-a] file\n"
+                    "\tDecodes the first video track of file with a MediaCodec and\n"
+                    "\treports the buffers exchanged with the component and the\n"
+                    "\tcontext switches this process went through, per second and per\n"
+                    "\tbuffer. Run against a 240 fps clip with -r 240, or against an\n"
+                    "\taudio track of 20 ms frames with -a -r 50, to see the cost of\n"
+                    "\tthe per-buffer traffic to the media server.\n"
+                    "\t[-r] input buffers queued per second (default as fast as\n"
+                    "\t     possible)\n"
+                    "\t[-a] use the first audio track instead\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+struct Result {
+    size_t mNumInputBuffers;
+    size_t mNumOutputBuffers;
+    int64_t mElapsedUs;
+    long mVoluntarySwitches;
+    long mInvoluntarySwitches;
+};
+
+static void getContextSwitches(long *voluntary, long *involuntary) {
+    struct rusage usage;
+    CHECK_EQ(getrusage(RUSAGE_SELF, &usage), 0);
+
+    *voluntary = usage.ru_nvcsw;
+    *involuntary = usage.ru_nivcsw;
+}
+
+static bool runDecode(
+        const sp<ALooper> &looper, const char *path, bool audio, double rate,
+        Result *result) {
+    static const int64_t kTimeout = 10000ll;
+
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor;
+    if (extractor->setDataSource(NULL /* httpService */, path) != OK) {
+        fprintf(stderr, "unable to instantiate extractor.\n");
+        return false;
+    }
+
+    const char *prefix = audio ? "audio/" : "video/";
+    sp<AMessage> format;
+    AString mime;
+    for (size_t i = 0; i < extractor->countTracks(); ++i) {
+        CHECK_EQ(extractor->getTrackFormat(i, &format), (status_t)OK);
+        CHECK(format->findString("mime", &mime));
+        if (!strncasecmp(mime.c_str(), prefix, 6)) {
+            CHECK_EQ(extractor->selectTrack(i), (status_t)OK);
+            break;
+        }
+        format.clear();
+    }
+
+    if (format == NULL) {
+        fprintf(stderr, "no %s track.\n", audio ? "audio" : "video");
+        return false;
+    }
+
+    sp<MediaCodec> codec = MediaCodec::CreateByType(
+            looper, mime.c_str(), false /* encoder */);
+    if (codec == NULL) {
+        fprintf(stderr, "unable to instantiate a decoder for %s.\n", mime.c_str());
+        return false;
+    }
+
+    status_t err = codec->configure(
+            format, NULL /* surface */, NULL /* crypto */, 0 /* flags */);
+    if (err == OK) {
+        err = codec->start();
+    }
+    if (err != OK) {
+        fprintf(stderr, "unable to start the decoder (err %d).\n", err);
+        codec->release();
+        return false;
+    }
+
+    Vector<sp<ABuffer> > inBuffers;
+    CHECK_EQ(codec->getInputBuffers(&inBuffers), (status_t)OK);
+
+    result->mNumInputBuffers = 0;
+    result->mNumOutputBuffers = 0;
+
+    bool signalledInputEOS = false;
+    bool sawOutputEOS = false;
+
+    long voluntary, involuntary;
+    getContextSwitches(&voluntary, &involuntary);
+    int64_t startTimeUs = ALooper::GetNowUs();
+
+    while (!sawOutputEOS) {
+        // With a rate, input buffer n is not queued before n / rate seconds.
+        bool inputDue = !signalledInputEOS
+            && (rate <= 0.0 || ALooper::GetNowUs() - startTimeUs
+                    >= (int64_t)(result->mNumInputBuffers * 1E6 / rate));
+
+        if (inputDue) {
+            size_t index;
+            err = codec->dequeueInputBuffer(&index, 0ll);
+            if (err == OK) {
+                const sp<ABuffer> &buffer = inBuffers.itemAt(index);
+
+                int64_t timeUs;
+                if (extractor->getSampleTime(&timeUs) != OK) {
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, 0 /* size */, 0ll /* timeUs */,
+                            MediaCodec::BUFFER_FLAG_EOS);
+                    CHECK_EQ(err, (status_t)OK);
+                    signalledInputEOS = true;
+                } else {
+                    CHECK_EQ(extractor->readSampleData(buffer), (status_t)OK);
+                    extractor->advance();
+
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, buffer->size(), timeUs,
+                            0 /* flags */);
+                    CHECK_EQ(err, (status_t)OK);
+                    ++result->mNumInputBuffers;
+                }
+            } else {
+                CHECK_EQ(err, -EAGAIN);
+            }
+        }
+
+        size_t index;
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        err = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags,
+                (signalledInputEOS || !inputDue) ? kTimeout : 0ll);
+
+        if (err == OK) {
+            CHECK_EQ(codec->releaseOutputBuffer(index), (status_t)OK);
+            ++result->mNumOutputBuffers;
+
+            if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+                sawOutputEOS = true;
+            }
+        } else if (err != INFO_OUTPUT_BUFFERS_CHANGED
+                && err != INFO_FORMAT_CHANGED) {
+            CHECK_EQ(err, -EAGAIN);
+        }
+    }
+
+    result->mElapsedUs = ALooper::GetNowUs() - startTimeUs;
+
+    long voluntaryEnd, involuntaryEnd;
+    getContextSwitches(&voluntaryEnd, &involuntaryEnd);
+    result->mVoluntarySwitches = voluntaryEnd - voluntary;
+    result->mInvoluntarySwitches = involuntaryEnd - involuntary;
+
+    CHECK_EQ(codec->release(), (status_t)OK);
+
+    return true;
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    double rate = 0.0;
+    bool audio = false;
+
+    int res;
+    while ((res = getopt(argc, argv, "hr:a")) >= 0) {
+        switch (res) {
+            case 'r':
+            {
+                rate = atof(optarg);
+                if (rate <= 0.0) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case 'a':
+            {
+                audio = true;
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    DataSource::RegisterDefaultSniffers();
+
+    sp<ALooper> looper = new ALooper;
+    looper->start();
+
+    Result result;
+    bool ok = runDecode(looper, argv[0], audio, rate, &result);
+
+    looper->stop();
+
+    if (!ok) {
+        return 1;
+    }
+
+    double seconds = result.mElapsedUs / 1E6;
+    size_t numBuffers = result.mNumInputBuffers + result.mNumOutputBuffers;
+
+    printf("%zu input and %zu output buffers in %.1f ms\n",
+            result.mNumInputBuffers, result.mNumOutputBuffers,
+            result.mElapsedUs / 1E3);
+    printf("%-14s %12s %12s\n", "", "per second", "per buffer");
+    printf("%-14s %12.1f %12s\n",
+            "buffers", seconds > 0 ? numBuffers / seconds : 0.0, "");
+    printf("%-14s %12.1f %12.2f\n", "voluntary cs",
+            seconds > 0 ? result.mVoluntarySwitches / seconds : 0.0,
+            numBuffers > 0 ? (double)result.mVoluntarySwitches / numBuffers : 0.0);
+    printf("%-14s %12.1f %12.2f\n", "involuntary cs",
+            seconds > 0 ? result.mInvoluntarySwitches / seconds : 0.0,
+            numBuffers > 0 ? (double)result.mInvoluntarySwitches / numBuffers : 0.0);
+
+    return 0;
+}
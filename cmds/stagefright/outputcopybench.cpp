@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "outputcopybench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <utils/Vector.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-c component] [-n runs] file\n"
+                    "\tDecodes the first video track of file to byte buffers with\n"
+                    "\tthe decoder copying each picture to its output buffer and with\n"
+                    "\tit decoding into the output buffers directly, and reports the\n"
+                    "\tthroughput of both next to the cost of copying one picture.\n"
+                    "\t[-c] decoder component (default OMX.google.h264.decoder)\n"
+                    "\t[-n] runs per mode, the best one is reported (default 3)\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+struct BenchResult {
+    int64_t mNumFrames;
+    size_t mFrameSize;
+    double mFps;
+};
+
+static status_t runMode(
+        const sp<ALooper> &looper,
+        const char *path,
+        const char *componentName,
+        bool directOutput,
+        BenchResult *result) {
+    static const int64_t kTimeout = 10000ll;
+
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor;
+    if (extractor->setDataSource(NULL /* httpService */, path) != OK) {
+        fprintf(stderr, "unable to instantiate extractor.\n");
+        return UNKNOWN_ERROR;
+    }
+
+    sp<AMessage> format;
+    size_t i;
+    for (i = 0; i < extractor->countTracks(); ++i) {
+        CHECK_EQ(extractor->getTrackFormat(i, &format), (status_t)OK);
+
+        AString mime;
+        CHECK(format->findString("mime", &mime));
+        if (!strncasecmp(mime.c_str(), "video/", 6)) {
+            break;
+        }
+    }
+    if (i == extractor->countTracks()) {
+        fprintf(stderr, "no video track.\n");
+        return UNKNOWN_ERROR;
+    }
+    CHECK_EQ(extractor->selectTrack(i), (status_t)OK);
+
+    format->setInt32("direct-output", directOutput);
+
+    sp<MediaCodec> codec = MediaCodec::CreateByComponentName(looper, componentName);
+    if (codec == NULL) {
+        fprintf(stderr, "unable to instantiate %s.\n", componentName);
+        return UNKNOWN_ERROR;
+    }
+
+    status_t err = codec->configure(
+            format, NULL /* surface */, NULL /* crypto */, 0 /* flags */);
+    if (err == OK) {
+        err = codec->start();
+    }
+    if (err != OK) {
+        fprintf(stderr, "unable to start %s (err %d).\n", componentName, err);
+        codec->release();
+        return err;
+    }
+
+    Vector<sp<ABuffer> > inBuffers;
+    CHECK_EQ(codec->getInputBuffers(&inBuffers), (status_t)OK);
+
+    result->mNumFrames = 0;
+    result->mFrameSize = 0;
+
+    bool signalledInputEOS = false;
+    bool sawOutputEOS = false;
+    int64_t startTimeUs = ALooper::GetNowUs();
+
+    while (!sawOutputEOS) {
+        if (!signalledInputEOS) {
+            size_t index;
+            err = codec->dequeueInputBuffer(&index, 0ll);
+            if (err == OK) {
+                const sp<ABuffer> &buffer = inBuffers.itemAt(index);
+
+                int64_t timeUs;
+                if (extractor->getSampleTime(&timeUs) != OK) {
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, 0 /* size */, 0ll /* timeUs */,
+                            MediaCodec::BUFFER_FLAG_EOS);
+                    CHECK_EQ(err, (status_t)OK);
+                    signalledInputEOS = true;
+                } else {
+                    CHECK_EQ(extractor->readSampleData(buffer), (status_t)OK);
+
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, buffer->size(), timeUs,
+                            0 /* flags */);
+                    CHECK_EQ(err, (status_t)OK);
+
+                    extractor->advance();
+                }
+            } else {
+                CHECK_EQ(err, -EAGAIN);
+            }
+        }
+
+        size_t index;
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        err = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags,
+                signalledInputEOS ? kTimeout : 0ll);
+
+        if (err == OK) {
+            if (size > 0) {
+                ++result->mNumFrames;
+                result->mFrameSize = size;
+            }
+
+            CHECK_EQ(codec->releaseOutputBuffer(index), (status_t)OK);
+
+            if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+                sawOutputEOS = true;
+            }
+        } else if (err != INFO_OUTPUT_BUFFERS_CHANGED
+                && err != INFO_FORMAT_CHANGED) {
+            CHECK_EQ(err, -EAGAIN);
+        }
+    }
+
+    int64_t elapsedTimeUs = ALooper::GetNowUs() - startTimeUs;
+
+    CHECK_EQ(codec->release(), (status_t)OK);
+
+    result->mFps = result->mNumFrames * 1E6 / elapsedTimeUs;
+
+    return OK;
+}
+
+// Time to copy one picture of |size| bytes between two buffers larger than
+// the caches, i.e. the per-frame cost direct output saves.
+static double measureCopyUs(size_t size) {
+    static const size_t kNumBuffers = 8;
+    static const int kNumCopies = 64;
+
+    uint8_t *buffers[kNumBuffers];
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        buffers[i] = new uint8_t[size];
+        memset(buffers[i], i, size);
+    }
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+    for (int i = 0; i < kNumCopies; ++i) {
+        memcpy(buffers[(i + 1) % kNumBuffers], buffers[i % kNumBuffers], size);
+    }
+    int64_t elapsedTimeUs = ALooper::GetNowUs() - startTimeUs;
+
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        delete[] buffers[i];
+    }
+
+    return (double)elapsedTimeUs / kNumCopies;
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    const char *componentName = "OMX.google.h264.decoder";
+    int numRuns = 3;
+
+    int res;
+    while ((res = getopt(argc, argv, "hc:n:")) >= 0) {
+        switch (res) {
+            case 'c':
+            {
+                componentName = optarg;
+                break;
+            }
+
+            case 'n':
+            {
+                numRuns = atoi(optarg);
+                if (numRuns < 1) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    DataSource::RegisterDefaultSniffers();
+
+    sp<ALooper> looper = new ALooper;
+    looper->start();
+
+    printf("%-8s %8s %9s %12s %10s\n",
+            "output", "frames", "fps", "ms/frame", "MB/s out");
+
+    BenchResult best[2];
+    for (int direct = 0; direct < 2; ++direct) {
+        best[direct].mFps = -1;
+
+        for (int run = 0; run < numRuns; ++run) {
+            BenchResult result;
+            if (runMode(looper, argv[0], componentName, direct, &result) != OK) {
+                return 1;
+            }
+            if (result.mFps > best[direct].mFps) {
+                best[direct] = result;
+            }
+        }
+
+        printf("%-8s %8" PRId64 " %9.2f %12.3f %10.1f\n",
+                direct ? "direct" : "copy", best[direct].mNumFrames,
+                best[direct].mFps, 1E3 / best[direct].mFps,
+                best[direct].mFrameSize * best[direct].mFps / 1E6);
+    }
+
+    looper->stop();
+
+    size_t frameSize = best[0].mFrameSize;
+    if (frameSize > 0) {
+        double copyUs = measureCopyUs(frameSize);
+        printf("\ncopying one %zu byte picture: %.3f ms (%.1f MB/s)\n",
+                frameSize, copyUs / 1E3, frameSize / copyUs);
+        printf("per-frame time saved by direct output: %.3f ms\n",
+                1E3 / best[0].mFps - 1E3 / best[1].mFps);
+    }
+
+    return 0;
+}
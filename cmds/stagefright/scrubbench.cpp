@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "scrubbench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <unistd.h>
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/FileSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaExtractor.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/OMXClient.h>
+#include <media/stagefright/OMXCodec.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-s start] [-d duration] [-r rate] file\n"
+                    "\tPlays through a stretch of the first video track of file as\n"
+                    "\tfast forward would, once decoding every frame and once with\n"
+                    "\tthe extractor returning sync frames only, and reports the bytes\n"
+                    "\tread, the frames decoded and the time taken for each against\n"
+                    "\tthe time the stretch lasts at the given rate.\n"
+                    "\t[-s] start in seconds (default 0)\n"
+                    "\t[-d] duration in seconds (default 60)\n"
+                    "\t[-r] playback rate (default 8)\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+// Passes reads through to another source, counting them.
+struct CountingSource : public DataSource {
+    CountingSource(const sp<DataSource> &source)
+        : mSource(source),
+          mNumReads(0),
+          mBytesRead(0) {
+    }
+
+    virtual status_t initCheck() const {
+        return mSource->initCheck();
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        ssize_t n = mSource->readAt(offset, data, size);
+        ++mNumReads;
+        if (n > 0) {
+            mBytesRead += n;
+        }
+        return n;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        return mSource->getSize(size);
+    }
+
+    virtual uint32_t flags() {
+        return mSource->flags();
+    }
+
+    sp<DataSource> mSource;
+    size_t mNumReads;
+    int64_t mBytesRead;
+};
+
+struct Result {
+    int64_t mElapsedUs;
+    size_t mNumReads;
+    int64_t mBytesRead;
+    size_t mNumFrames;
+};
+
+static bool runScrub(
+        OMXClient *client, const char *path, bool syncFramesOnly,
+        int64_t startUs, int64_t durationUs, Result *result) {
+    sp<CountingSource> source = new CountingSource(new FileSource(path));
+    if (source->initCheck() != OK) {
+        return false;
+    }
+
+    sp<MediaExtractor> extractor = MediaExtractor::Create(source);
+    if (extractor == NULL) {
+        return false;
+    }
+
+    sp<MediaSource> track;
+    for (size_t i = 0; i < extractor->countTracks(); ++i) {
+        const char *mime;
+        CHECK(extractor->getTrackMetaData(i)->findCString(kKeyMIMEType, &mime));
+        if (!strncasecmp(mime, "video/", 6)) {
+            track = extractor->getTrack(i);
+            break;
+        }
+    }
+
+    if (track == NULL) {
+        fprintf(stderr, "no video track in %s\n", path);
+        return false;
+    }
+
+    sp<MediaSource> decoder = OMXCodec::Create(
+            client->interface(), track->getFormat(), false /* createEncoder */,
+            track, NULL, OMXCodec::kSoftwareCodecsOnly);
+
+    if (decoder == NULL || decoder->start() != OK) {
+        fprintf(stderr, "cannot start a decoder for %s\n", path);
+        return false;
+    }
+
+    // Only what the scrub itself reads is counted.
+    size_t numReads = source->mNumReads;
+    int64_t bytesRead = source->mBytesRead;
+
+    MediaSource::ReadOptions options;
+    options.setSeekTo(startUs, MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC);
+    if (syncFramesOnly) {
+        options.setSyncFramesOnly();
+    }
+
+    result->mNumFrames = 0;
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+    for (;;) {
+        MediaBuffer *buffer;
+        status_t err = decoder->read(&buffer, &options);
+        options.clearSeekTo();
+
+        if (err == INFO_FORMAT_CHANGED) {
+            continue;
+        } else if (err != OK) {
+            CHECK(buffer == NULL);
+            break;
+        }
+
+        int64_t timeUs;
+        CHECK(buffer->meta_data()->findInt64(kKeyTime, &timeUs));
+        if (buffer->range_length() > 0) {
+            ++result->mNumFrames;
+        }
+        buffer->release();
+
+        if (timeUs >= startUs + durationUs) {
+            break;
+        }
+    }
+    result->mElapsedUs = ALooper::GetNowUs() - startTimeUs;
+
+    result->mNumReads = source->mNumReads - numReads;
+    result->mBytesRead = source->mBytesRead - bytesRead;
+
+    decoder->stop();
+
+    return true;
+}
+
+static void printResult(const char *name, const Result &result) {
+    printf("%-12s %10.1f %8zu %8zu %10.1f\n",
+            name, result.mBytesRead / 1024.0, result.mNumReads,
+            result.mNumFrames, result.mElapsedUs / 1E3);
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    double start = 0.0;
+    double duration = 60.0;
+    double rate = 8.0;
+
+    int res;
+    while ((res = getopt(argc, argv, "hs:d:r:")) >= 0) {
+        switch (res) {
+            case 's':
+            case 'd':
+            case 'r':
+            {
+                double value = atof(optarg);
+                if (value < 0.0 || (res != 's' && value == 0.0)) {
+                    usage(me);
+                }
+
+                switch (res) {
+                    case 's': start = value; break;
+                    case 'd': duration = value; break;
+                    default: rate = value; break;
+                }
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+    DataSource::RegisterDefaultSniffers();
+
+    OMXClient client;
+    CHECK_EQ(client.connect(), (status_t)OK);
+
+    int64_t startUs = start * 1E6;
+    int64_t durationUs = duration * 1E6;
+
+    printf("%.1f s from %.1f s at %.1fx, %.1f ms to keep up\n",
+            duration, start, rate, duration * 1E3 / rate);
+    printf("%-12s %10s %8s %8s %10s\n", "mode", "KB read", "reads", "frames", "ms");
+
+    Result result;
+    if (runScrub(&client, argv[0], false, startUs, durationUs, &result)) {
+        printResult("all frames", result);
+    }
+    if (runScrub(&client, argv[0], true, startUs, durationUs, &result)) {
+        printResult("sync only", result);
+    }
+
+    client.disconnect();
+
+    return 0;
+}
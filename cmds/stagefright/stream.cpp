@@ -25,6 +25,7 @@
 #include <media/IStreamSource.h>
 #include <media/mediaplayer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/DataSource.h>
 #include <media/stagefright/MPEG2TSWriter.h>
@@ -39,10 +40,70 @@
 #include <gui/Surface.h>
 
 #include <fcntl.h>
+#include <unistd.h>
 #include <ui/DisplayInfo.h>
 
 using namespace android;
 
+// Hands out the stream at a fixed bitrate, as a live source would, with an
+// optional network stall every so often after which the backlog arrives in
+// a burst.
+struct FeedPacer {
+    FeedPacer()
+        : mBitsPerSec(0),
+          mStallEveryUs(0),
+          mStallUs(0),
+          mStartUs(-1),
+          mNumBytesSent(0),
+          mNextStallUs(0) {
+    }
+
+    void setBitrate(int64_t bitsPerSec) {
+        mBitsPerSec = bitsPerSec;
+    }
+
+    void setStalls(int64_t everyUs, int64_t stallUs) {
+        mStallEveryUs = everyUs;
+        mStallUs = stallUs;
+        mNextStallUs = everyUs;
+    }
+
+    // Blocks until the next numBytes are due.
+    void pace(size_t numBytes) {
+        if (mBitsPerSec <= 0) {
+            return;
+        }
+
+        int64_t nowUs = ALooper::GetNowUs();
+        if (mStartUs < 0) {
+            mStartUs = nowUs;
+        }
+
+        int64_t dueUs = mNumBytesSent * 8000000ll / mBitsPerSec;
+        if (mStartUs + dueUs > nowUs) {
+            usleep(mStartUs + dueUs - nowUs);
+        }
+
+        // the schedule does not move, so what was held back goes out at once
+        if (mStallEveryUs > 0 && dueUs >= mNextStallUs) {
+            usleep(mStallUs);
+            mNextStallUs += mStallEveryUs;
+        }
+
+        mNumBytesSent += numBytes;
+    }
+
+private:
+    int64_t mBitsPerSec;
+    int64_t mStallEveryUs;
+    int64_t mStallUs;
+    int64_t mStartUs;
+    uint64_t mNumBytesSent;
+    int64_t mNextStallUs;
+};
+
+static FeedPacer gPacer;
+
 struct MyStreamSource : public BnStreamSource {
     // Object assumes ownership of fd.
     MyStreamSource(int fd);
@@ -117,6 +178,7 @@ void MyStreamSource::onBufferAvailable(size_t index) {
     if (n <= 0) {
         mListener->issueCommand(IStreamListener::EOS, false /* synchronous */);
     } else {
+        gPacer.pace(n);
         mListener->queueBuffer(index, n);
 
         mNumPacketsSent += n / 188;
@@ -233,6 +295,7 @@ ssize_t MyConvertingStreamSource::writeData(const void *data, size_t size) {
         mCurrentBufferOffset += copy;
 
         if (mCurrentBufferOffset == mem->size()) {
+            gPacer.pace(mCurrentBufferOffset);
             mListener->queueBuffer(mCurrentBufferIndex, mCurrentBufferOffset);
             mCurrentBufferIndex = -1;
         }
@@ -285,6 +348,15 @@ struct MyClient : public BnMediaPlayerClient {
         }
     }
 
+    // Returns true once EOS was reached, false if timeoutUs passed first.
+    bool waitForEOS(int64_t timeoutUs) {
+        Mutex::Autolock autoLock(mLock);
+        if (!mEOS) {
+            mCondition.waitRelative(mLock, timeoutUs * 1000ll);
+        }
+        return mEOS;
+    }
+
 protected:
     virtual ~MyClient() {
     }
@@ -298,16 +370,115 @@ private:
     DISALLOW_EVIL_CONSTRUCTORS(MyClient);
 };
 
+static void usage(const char *me) {
+    fprintf(stderr, "Usage: %s [-l ms] [-s] [-b kbps] [-g every,ms] filename\n"
+                    "\t[-l] play with this target latency, in ms, and report\n"
+                    "\t     the latency reached every second\n"
+                    "\t[-s] with -l, let the player speed up audio to catch up,\n"
+                    "\t     raising its pitch, rather than only skip ahead\n"
+                    "\t[-b] feed the stream at this bitrate, as it would arrive\n"
+                    "\t     live, instead of as fast as the player takes it\n"
+                    "\t[-g] with -b, hold the feed back for the given ms every\n"
+                    "\t     so many seconds of stream, then send it in a burst\n",
+                    me);
+}
+
+static void printLatencyStats(const sp<IMediaPlayer> &player) {
+    Parcel reply;
+    if (player->getParameter(KEY_PARAMETER_LATENCY_STATS, &reply) != OK) {
+        return;
+    }
+
+    int32_t targetMs = reply.readInt32();
+    int32_t latestMs = reply.readInt32();
+    int32_t minMs = reply.readInt32();
+    int32_t maxMs = reply.readInt32();
+    int32_t meanMs = reply.readInt32();
+    int32_t numSamples = reply.readInt32();
+    int32_t stretchedMs = reply.readInt32();
+    int32_t numCatchUps = reply.readInt32();
+    int32_t numAudioDropped = reply.readInt32();
+    int32_t numVideoDropped = reply.readInt32();
+
+    printf("latency %d ms (target %d, min %d, max %d, mean %d over %d),"
+           " sped up %d ms, %d skips, %d audio %d video dropped\n",
+           latestMs, targetMs, minMs, maxMs, meanMs, numSamples,
+           stretchedMs, numCatchUps, numAudioDropped, numVideoDropped);
+}
+
 int main(int argc, char **argv) {
     android::ProcessState::self()->startThreadPool();
 
     DataSource::RegisterDefaultSniffers();
 
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s filename\n", argv[0]);
+    const char *me = argv[0];
+    int32_t latencyTargetMs = 0;
+    bool speedUpAudio = false;
+    int32_t kbps = 0;
+    int32_t stallEverySecs = 0;
+    int32_t stallMs = 0;
+
+    int res;
+    while ((res = getopt(argc, argv, "hl:sb:g:")) >= 0) {
+        switch (res) {
+            case 'l':
+            {
+                latencyTargetMs = atoi(optarg);
+                if (latencyTargetMs <= 0) {
+                    usage(me);
+                    return 1;
+                }
+                break;
+            }
+
+            case 's':
+            {
+                speedUpAudio = true;
+                break;
+            }
+
+            case 'b':
+            {
+                kbps = atoi(optarg);
+                if (kbps <= 0) {
+                    usage(me);
+                    return 1;
+                }
+                break;
+            }
+
+            case 'g':
+            {
+                if (sscanf(optarg, "%d,%d", &stallEverySecs, &stallMs) != 2
+                        || stallEverySecs <= 0 || stallMs <= 0) {
+                    usage(me);
+                    return 1;
+                }
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+                return 1;
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1 || (stallEverySecs > 0 && kbps == 0)
+            || (speedUpAudio && latencyTargetMs == 0)) {
+        usage(me);
         return 1;
     }
 
+    gPacer.setBitrate(kbps * 1000ll);
+    gPacer.setStalls(stallEverySecs * 1000000ll, stallMs * 1000ll);
+
     sp<SurfaceComposerClient> composerClient = new SurfaceComposerClient;
     CHECK_EQ(composerClient->initCheck(), (status_t)OK);
 
@@ -353,16 +524,16 @@ int main(int argc, char **argv) {
     bool usemp4 = property_get("media.stagefright.use-mp4source", prop, NULL) &&
             (!strcmp(prop, "1") || !strcasecmp(prop, "true"));
 
-    size_t len = strlen(argv[1]);
-    if ((!usemp4 && len >= 3 && !strcasecmp(".ts", &argv[1][len - 3])) ||
+    size_t len = strlen(argv[0]);
+    if ((!usemp4 && len >= 3 && !strcasecmp(".ts", &argv[0][len - 3])) ||
         (usemp4 && len >= 4 &&
-         (!strcasecmp(".mp4", &argv[1][len - 4])
-            || !strcasecmp(".3gp", &argv[1][len- 4])
-            || !strcasecmp(".3g2", &argv[1][len- 4])))) {
-        int fd = open(argv[1], O_RDONLY);
+         (!strcasecmp(".mp4", &argv[0][len - 4])
+            || !strcasecmp(".3gp", &argv[0][len- 4])
+            || !strcasecmp(".3g2", &argv[0][len- 4])))) {
+        int fd = open(argv[0], O_RDONLY);
 
         if (fd < 0) {
-            fprintf(stderr, "Failed to open file '%s'.", argv[1]);
+            fprintf(stderr, "Failed to open file '%s'.", argv[0]);
             return 1;
         }
 
@@ -370,7 +541,7 @@ int main(int argc, char **argv) {
     } else {
         printf("Converting file to transport stream for streaming...\n");
 
-        source = new MyConvertingStreamSource(argv[1]);
+        source = new MyConvertingStreamSource(argv[0]);
     }
 
     sp<IMediaPlayer> player =
@@ -378,9 +549,28 @@ int main(int argc, char **argv) {
 
     if (player != NULL && player->setDataSource(source) == NO_ERROR) {
         player->setVideoSurfaceTexture(surface->getIGraphicBufferProducer());
+
+        if (latencyTargetMs > 0) {
+            Parcel request;
+            request.writeInt32(latencyTargetMs);
+            request.writeInt32(speedUpAudio);
+            if (player->setParameter(
+                    KEY_PARAMETER_LATENCY_TARGET_MS, request) != OK) {
+                fprintf(stderr, "player does not support a latency target.\n");
+                latencyTargetMs = 0;
+            }
+        }
+
         player->start();
 
-        client->waitForEOS();
+        if (latencyTargetMs > 0) {
+            while (!client->waitForEOS(1000000ll)) {
+                printLatencyStats(player);
+            }
+            printLatencyStats(player);
+        } else {
+            client->waitForEOS();
+        }
 
         player->stop();
     } else {
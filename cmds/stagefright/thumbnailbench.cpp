@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "thumbnailbench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <binder/ProcessState.h>
+#include <media/mediametadataretriever.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/MediaSource.h>
+#include <private/media/VideoFrame.h>
+
+#include "include/StagefrightMetadataRetriever.h"
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-n thumbnails] [-w width] [-h height] [-c] file\n"
+                    "\tExtracts thumbnails spread evenly over the file: one call per\n"
+                    "\tthumbnail as before, then all of them in one batch, then the\n"
+                    "\tbatch again from the thumbnail cache, and reports the time\n"
+                    "\tper thumbnail for each.\n"
+                    "\t[-n] number of thumbnails (default 20)\n"
+                    "\t[-w] [-h] largest thumbnail wanted (default full size)\n"
+                    "\t[-c] seek to the closest frame instead of the closest sync frame\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+struct Result {
+    int64_t mElapsedUs;
+    size_t mNumFrames;
+    int32_t mWidth;
+    int32_t mHeight;
+};
+
+static void freeFrames(Vector<VideoFrame *> *frames) {
+    for (size_t i = 0; i < frames->size(); ++i) {
+        delete frames->itemAt(i);
+    }
+    frames->clear();
+}
+
+// Opens |path| in a new retriever, as a client would for each request.
+static sp<StagefrightMetadataRetriever> openRetriever(int fd) {
+    sp<StagefrightMetadataRetriever> retriever = new StagefrightMetadataRetriever;
+    if (retriever->setDataSource(fd, 0, 0x7ffffffffffffffLL) != OK) {
+        return NULL;
+    }
+    return retriever;
+}
+
+static void summarize(
+        const Vector<VideoFrame *> &frames, int64_t elapsedUs, Result *result) {
+    result->mElapsedUs = elapsedUs;
+    result->mNumFrames = 0;
+    result->mWidth = result->mHeight = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (frames[i] != NULL) {
+            ++result->mNumFrames;
+            result->mWidth = frames[i]->mWidth;
+            result->mHeight = frames[i]->mHeight;
+        }
+    }
+}
+
+// One retriever and one getFrameAtTime() per time.
+static bool runSingle(
+        int fd, const Vector<int64_t> &timesUs, int option, Result *result) {
+    Vector<VideoFrame *> frames;
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+    for (size_t i = 0; i < timesUs.size(); ++i) {
+        sp<StagefrightMetadataRetriever> retriever = openRetriever(fd);
+        if (retriever == NULL) {
+            freeFrames(&frames);
+            return false;
+        }
+        frames.push(retriever->getFrameAtTime(timesUs[i], option));
+    }
+    summarize(frames, ALooper::GetNowUs() - startTimeUs, result);
+
+    freeFrames(&frames);
+    return true;
+}
+
+// One retriever and one getFramesAtTimes() for all times.
+static bool runBatch(
+        int fd, const Vector<int64_t> &timesUs, int option,
+        int32_t maxWidth, int32_t maxHeight, Result *result) {
+    Vector<VideoFrame *> frames;
+    frames.insertAt((VideoFrame *)NULL, 0, timesUs.size());
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+    sp<StagefrightMetadataRetriever> retriever = openRetriever(fd);
+    if (retriever == NULL) {
+        return false;
+    }
+    status_t err = retriever->getFramesAtTimes(
+            timesUs.array(), timesUs.size(), option, maxWidth, maxHeight,
+            frames.editArray());
+    summarize(frames, ALooper::GetNowUs() - startTimeUs, result);
+
+    freeFrames(&frames);
+    return err == OK;
+}
+
+static void printResult(const char *name, const Result &result) {
+    printf("%-24s %6zu %5dx%-5d %10.2f\n",
+            name, result.mNumFrames, result.mWidth, result.mHeight,
+            result.mNumFrames > 0
+                ? result.mElapsedUs / 1E3 / result.mNumFrames : 0.0);
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    int numThumbnails = 20;
+    int32_t maxWidth = 0;
+    int32_t maxHeight = 0;
+    int option = MediaSource::ReadOptions::SEEK_CLOSEST_SYNC;
+
+    int res;
+    while ((res = getopt(argc, argv, "n:w:h:c")) >= 0) {
+        switch (res) {
+            case 'n':
+            {
+                numThumbnails = atoi(optarg);
+                if (numThumbnails < 1) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case 'w':
+            {
+                maxWidth = atoi(optarg);
+                break;
+            }
+
+            case 'h':
+            {
+                maxHeight = atoi(optarg);
+                break;
+            }
+
+            case 'c':
+            {
+                option = MediaSource::ReadOptions::SEEK_CLOSEST;
+                break;
+            }
+
+            case '?':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    int fd = open(argv[0], O_RDONLY | O_LARGEFILE);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s: %s\n", argv[0], strerror(errno));
+        return 1;
+    }
+
+    int64_t durationUs = 0;
+    {
+        sp<StagefrightMetadataRetriever> retriever = openRetriever(fd);
+        const char *duration = (retriever != NULL)
+            ? retriever->extractMetadata(METADATA_KEY_DURATION) : NULL;
+        if (duration == NULL) {
+            fprintf(stderr, "cannot extract the duration of %s\n", argv[0]);
+            close(fd);
+            return 1;
+        }
+        durationUs = atoll(duration) * 1000ll;
+    }
+
+    // The single calls and the first batch get times of their own so that
+    // neither is served from the thumbnail cache.
+    Vector<int64_t> singleTimesUs, batchTimesUs;
+    for (int i = 0; i < numThumbnails; ++i) {
+        singleTimesUs.push(durationUs * (2 * i + 1) / (2 * numThumbnails + 1));
+        batchTimesUs.push(durationUs * (2 * i + 2) / (2 * numThumbnails + 1));
+    }
+
+    printf("%-24s %6s %11s %10s\n", "mode", "frames", "size", "ms/frame");
+
+    Result result;
+    if (runSingle(fd, singleTimesUs, option, &result)) {
+        printResult("single", result);
+    }
+    if (runBatch(fd, batchTimesUs, option, maxWidth, maxHeight, &result)) {
+        printResult("batch", result);
+    }
+    if (runBatch(fd, batchTimesUs, option, maxWidth, maxHeight, &result)) {
+        printResult("batch, cached", result);
+    }
+
+    close(fd);
+
+    return 0;
+}
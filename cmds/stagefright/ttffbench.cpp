@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ttffbench"
+#include <inttypes.h>
+#include <utils/Log.h>
+
+#include <unistd.h>
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <utils/Vector.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-n runs] [-w ms] [-a] file\n"
+                    "\tPlays the start of the first video track of file again and\n"
+                    "\tagain, as a player would a series of short clips, and reports\n"
+                    "\tfor each run the time from asking for a decoder to getting\n"
+                    "\tits first output buffer, split into creating and starting the\n"
+                    "\tcodec and decoding.\n"
+                    "\t[-n] number of runs (default 10)\n"
+                    "\t[-w] pause between runs in ms (default 0), over 5000 lets\n"
+                    "\t     idle decoders expire\n"
+                    "\t[-a] use the first audio track instead\n",
+                    me);
+
+    exit(1);
+}
+
+namespace android {
+
+struct Result {
+    int64_t mStartUs;
+    int64_t mFirstFrameUs;
+};
+
+static bool runOnce(
+        const sp<ALooper> &looper, const char *path, bool audio,
+        Result *result) {
+    static const int64_t kTimeout = 10000ll;
+
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor;
+    if (extractor->setDataSource(NULL /* httpService */, path) != OK) {
+        fprintf(stderr, "unable to instantiate extractor.\n");
+        return false;
+    }
+
+    const char *prefix = audio ? "audio/" : "video/";
+    sp<AMessage> format;
+    AString mime;
+    for (size_t i = 0; i < extractor->countTracks(); ++i) {
+        CHECK_EQ(extractor->getTrackFormat(i, &format), (status_t)OK);
+        CHECK(format->findString("mime", &mime));
+        if (!strncasecmp(mime.c_str(), prefix, 6)) {
+            CHECK_EQ(extractor->selectTrack(i), (status_t)OK);
+            break;
+        }
+        format.clear();
+    }
+
+    if (format == NULL) {
+        fprintf(stderr, "no %s track.\n", audio ? "audio" : "video");
+        return false;
+    }
+
+    int64_t startTimeUs = ALooper::GetNowUs();
+
+    sp<MediaCodec> codec = MediaCodec::CreateByType(
+            looper, mime.c_str(), false /* encoder */);
+    if (codec == NULL) {
+        fprintf(stderr, "unable to instantiate a decoder for %s.\n", mime.c_str());
+        return false;
+    }
+
+    status_t err = codec->configure(
+            format, NULL /* surface */, NULL /* crypto */, 0 /* flags */);
+    if (err == OK) {
+        err = codec->start();
+    }
+    if (err != OK) {
+        fprintf(stderr, "unable to start the decoder (err %d).\n", err);
+        codec->release();
+        return false;
+    }
+
+    result->mStartUs = ALooper::GetNowUs() - startTimeUs;
+
+    Vector<sp<ABuffer> > inBuffers;
+    CHECK_EQ(codec->getInputBuffers(&inBuffers), (status_t)OK);
+
+    bool signalledInputEOS = false;
+    bool sawOutput = false;
+
+    while (!sawOutput) {
+        if (!signalledInputEOS) {
+            size_t index;
+            err = codec->dequeueInputBuffer(&index, 0ll);
+            if (err == OK) {
+                const sp<ABuffer> &buffer = inBuffers.itemAt(index);
+
+                int64_t timeUs;
+                if (extractor->getSampleTime(&timeUs) != OK) {
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, 0 /* size */, 0ll /* timeUs */,
+                            MediaCodec::BUFFER_FLAG_EOS);
+                    CHECK_EQ(err, (status_t)OK);
+                    signalledInputEOS = true;
+                } else {
+                    CHECK_EQ(extractor->readSampleData(buffer), (status_t)OK);
+                    extractor->advance();
+
+                    err = codec->queueInputBuffer(
+                            index, 0 /* offset */, buffer->size(), timeUs,
+                            0 /* flags */);
+                    CHECK_EQ(err, (status_t)OK);
+                }
+            } else {
+                CHECK_EQ(err, -EAGAIN);
+            }
+        }
+
+        size_t index;
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        err = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags,
+                signalledInputEOS ? kTimeout : 0ll);
+
+        if (err == OK) {
+            CHECK_EQ(codec->releaseOutputBuffer(index), (status_t)OK);
+
+            if (size > 0 || (flags & MediaCodec::BUFFER_FLAG_EOS)) {
+                sawOutput = true;
+            }
+        } else if (err != INFO_OUTPUT_BUFFERS_CHANGED
+                && err != INFO_FORMAT_CHANGED) {
+            CHECK_EQ(err, -EAGAIN);
+        }
+    }
+
+    result->mFirstFrameUs = ALooper::GetNowUs() - startTimeUs;
+
+    CHECK_EQ(codec->release(), (status_t)OK);
+
+    return true;
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+    int numRuns = 10;
+    int pauseMs = 0;
+    bool audio = false;
+
+    int res;
+    while ((res = getopt(argc, argv, "hn:w:a")) >= 0) {
+        switch (res) {
+            case 'n':
+            {
+                numRuns = atoi(optarg);
+                if (numRuns < 1) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case 'w':
+            {
+                pauseMs = atoi(optarg);
+                if (pauseMs < 0) {
+                    usage(me);
+                }
+                break;
+            }
+
+            case 'a':
+            {
+                audio = true;
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    DataSource::RegisterDefaultSniffers();
+
+    sp<ALooper> looper = new ALooper;
+    looper->start();
+
+    printf("%-6s %10s %14s\n", "run", "start ms", "first frame ms");
+
+    int64_t firstUs = 0;
+    int64_t restTotalUs = 0;
+    int64_t restMaxUs = 0;
+
+    for (int run = 0; run < numRuns; ++run) {
+        if (run > 0 && pauseMs > 0) {
+            usleep(pauseMs * 1000ll);
+        }
+
+        Result result;
+        if (!runOnce(looper, argv[0], audio, &result)) {
+            looper->stop();
+            return 1;
+        }
+
+        printf("%-6d %10.2f %14.2f\n",
+                run, result.mStartUs / 1E3, result.mFirstFrameUs / 1E3);
+
+        if (run == 0) {
+            firstUs = result.mFirstFrameUs;
+        } else {
+            restTotalUs += result.mFirstFrameUs;
+            if (result.mFirstFrameUs > restMaxUs) {
+                restMaxUs = result.mFirstFrameUs;
+            }
+        }
+    }
+
+    looper->stop();
+
+    printf("first %.2f ms", firstUs / 1E3);
+    if (numRuns > 1) {
+        printf(", later runs avg %.2f ms max %.2f ms",
+                restTotalUs / 1E3 / (numRuns - 1), restMaxUs / 1E3);
+    }
+    printf("\n");
+
+    return 0;
+}
@@ -19,6 +19,7 @@
 
 #include <cutils/sched_policy.h>
 #include <media/AudioSystem.h>
+#include <media/AudioTimestamp.h>
 #include <media/IAudioRecord.h>
 #include <utils/threads.h>
 
@@ -301,6 +302,22 @@ public:
      */
             status_t    getPosition(uint32_t *position) const;
 
+    /* Return the capture time of a recently read frame.  The timestamp is published in shared
+     * memory by the record thread each time it reads from the HAL, so this does not need a
+     * binder call.
+     *
+     * Parameters:
+     *
+     *  timestamp: On success, the frame position in the same units as getPosition(),
+     *             and the CLOCK_MONOTONIC time at which that frame was captured.
+     *
+     * Returned status (from utils/Errors.h) can be:
+     *  - NO_ERROR: successful operation
+     *  - WOULD_BLOCK: no timestamp has been published yet
+     *  - INVALID_OPERATION: not supported for fast tracks
+     */
+            status_t    getTimestamp(AudioTimestamp& timestamp);
+
     /* Returns a handle on the audio input used by this AudioRecord.
      *
      * Parameters:
@@ -43,6 +43,14 @@ public:
     virtual sp<IMemory>     getFrameAtTime(int64_t timeUs, int option) = 0;
     virtual sp<IMemory>     extractAlbumArt() = 0;
     virtual const char*     extractMetadata(int keyCode) = 0;
+
+    // A frame for each of |timesUs|, NULL where none could be had, decoded
+    // with one codec instance and scaled down to no less than maxWidth x
+    // maxHeight if both are positive.
+    virtual status_t        getFramesAtTimes(
+            const Vector<int64_t> &timesUs, int option,
+            int32_t maxWidth, int32_t maxHeight,
+            Vector<sp<IMemory> > *frames) = 0;
 };
 
 // ----------------------------------------------------------------------------
@@ -23,6 +23,7 @@
 #include <ui/GraphicBuffer.h>
 #include <utils/List.h>
 #include <utils/String8.h>
+#include <utils/Vector.h>
 
 #include <OMX_Core.h>
 #include <OMX_Video.h>
@@ -138,6 +139,29 @@ public:
             OMX_U32 range_offset, OMX_U32 range_length,
             OMX_U32 flags, OMX_TICKS timestamp) = 0;
 
+    // A fillBuffer() or emptyBuffer() call, see submitBuffers().
+    struct BufferOp {
+        enum Type {
+            FILL,
+            EMPTY,
+        };
+
+        Type mType;
+        buffer_id mBuffer;
+
+        // EMPTY only.
+        OMX_U32 mRangeOffset;
+        OMX_U32 mRangeLength;
+        OMX_U32 mFlags;
+        OMX_TICKS mTimestamp;
+    };
+
+    // Makes the fillBuffer() and emptyBuffer() calls in "ops" in order, in
+    // one transaction if the node lives in another process. Stops at the
+    // first call that fails and returns its error.
+    virtual status_t submitBuffers(
+            node_id node, const Vector<BufferOp> &ops) = 0;
+
     virtual status_t getExtensionIndex(
             node_id node,
             const char *parameter_name,
@@ -198,6 +222,11 @@ public:
     DECLARE_META_INTERFACE(OMXObserver);
 
     virtual void onMessage(const omx_message &msg) = 0;
+
+    // Delivers several messages, in order, in one transaction if the
+    // observer lives in another process. By default each is passed to
+    // onMessage().
+    virtual void onMessages(const List<omx_message> &messages);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -43,6 +43,19 @@ public:
     virtual VideoFrame* getFrameAtTime(int64_t timeUs, int option) = 0;
     virtual MediaAlbumArt* extractAlbumArt() = 0;
     virtual const char* extractMetadata(int keyCode) = 0;
+
+    // The frames at each of the |numTimes| |timesUs|, scaled down to no less
+    // than maxWidth x maxHeight if both are positive. Frames that could not
+    // be had are NULL. By default they are got one at a time, unscaled.
+    virtual status_t getFramesAtTimes(
+            const int64_t *timesUs, size_t numTimes, int option,
+            int32_t /* maxWidth */, int32_t /* maxHeight */,
+            VideoFrame **frames) {
+        for (size_t i = 0; i < numTimes; ++i) {
+            frames[i] = getFrameAtTime(timesUs[i], option);
+        }
+        return OK;
+    }
 };
 
 // MediaMetadataRetrieverInterface
@@ -77,6 +77,10 @@ public:
     sp<IMemory> getFrameAtTime(int64_t timeUs, int option);
     sp<IMemory> extractAlbumArt();
     const char* extractMetadata(int keyCode);
+    status_t getFramesAtTimes(
+            const Vector<int64_t> &timesUs, int option,
+            int32_t maxWidth, int32_t maxHeight,
+            Vector<sp<IMemory> > *frames);
 
 private:
     static const sp<IMediaPlayerService>& getService();
@@ -164,7 +164,24 @@ enum media_parameter_keys {
     KEY_PARAMETER_PLAYBACK_RATE_PERMILLE = 1300,                // set only
 
     // Set a Parcel containing the value of a parcelled Java AudioAttribute instance
-    KEY_PARAMETER_AUDIO_ATTRIBUTES = 1400                       // set only
+    KEY_PARAMETER_AUDIO_ATTRIBUTES = 1400,                      // set only
+
+    // Trick play for fast scrubbing: an int32_t, non-zero to have only video
+    // sync frames read and decoded, zero for all frames again.
+    KEY_PARAMETER_VIDEO_SYNC_FRAMES_ONLY = 1500,                // set only
+
+    // Low-latency live playback: an int32_t target for the time from data
+    // arriving at the player to it being presented, in ms, zero to turn off.
+    // The player skips ahead when it falls behind. An optional second int32_t,
+    // non-zero, lets it speed up audio a little instead, which raises its
+    // pitch.
+    KEY_PARAMETER_LATENCY_TARGET_MS = 1600,                     // set only
+
+    // Return a Parcel containing the int32_t target, latest, min, max and mean
+    // latency in ms, the int32_t number of samples taken, the int32_t ms spent
+    // speeding up, and the int32_t number of catch-ups, audio buffers skipped
+    // and video frames skipped.
+    KEY_PARAMETER_LATENCY_STATS = 1700                          // get only
 };
 
 // Keep INVOKE_ID_* in sync with MediaPlayer.java.
@@ -24,8 +24,6 @@
 #include <utils/String8.h>
 #include <pthread.h>
 
-struct dirent;
-
 namespace android {
 
 class MediaScannerClient;
@@ -80,24 +78,37 @@ struct MediaScanner {
 
     void setLocale(const char *locale);
 
+    // processDirectory lists and stats directories on up to this many
+    // threads, 0 (the default) for one per CPU. The client is only ever
+    // called on the thread calling processDirectory, and in the same order
+    // as with a single thread.
+    void setMaxThreads(size_t maxThreads);
+
+    // Keeps the size, modification time and inode of every file
+    // processDirectory reports in an index file at |path|, and from then on
+    // does not report files that are unchanged since. Only for clients that
+    // do not need to be told about every file on every scan, NULL (the
+    // default) reports all of them.
+    void setIndexPath(const char *path);
+
     virtual MediaAlbumArt *extractAlbumArt(int fd) = 0;
 
 protected:
     const char *locale() const;
 
 private:
+    struct Walker;
+
     // current locale (like "ja_JP"), created/destroyed with strdup()/free()
     char *mLocale;
     char *mSkipList;
     int *mSkipIndex;
+    size_t mMaxThreads;
+    // created/destroyed with strdup()/free()
+    char *mIndexPath;
 
-    MediaScanResult doProcessDirectory(
-            char *path, int pathRemaining, MediaScannerClient &client, bool noMedia);
-    MediaScanResult doProcessDirectoryEntry(
-            char *path, int pathRemaining, MediaScannerClient &client, bool noMedia,
-            struct dirent* entry, char* fileSpot);
     void loadSkipList();
-    bool shouldSkipDirectory(char *path);
+    bool shouldSkipDirectory(const char *path) const;
 
 
     MediaScanner(const MediaScanner &);
@@ -40,6 +40,7 @@ enum Event {
     EVENT_RESERVED,
     EVENT_STRING,               // ASCII string, not NUL-terminated
     EVENT_TIMESTAMP,            // clock_gettime(CLOCK_MONOTONIC)
+    EVENT_BINARY,               // BinaryEvent header followed by 0 to kMaxBinaryArgs int32_t
 };
 
 // ---------------------------------------------------------------------------
@@ -50,7 +51,8 @@ struct Entry {
         : mEvent(event), mLength(length), mData(data) { }
     /*virtual*/ ~Entry() { }
 
-    int     readAt(size_t offset) const;
+    // copy the shared memory representation of this entry to dst, and return number of bytes
+    size_t  copyTo(uint8_t *dst) const;
 
 private:
     friend class Writer;
@@ -70,6 +72,15 @@ private:
 //  byte[2+mLength]     duplicate copy of mLength to permit reverse scan
 //  byte[3+mLength]     start of next log entry
 
+// payload of an EVENT_BINARY entry, followed by mArgc int32_t arguments;
+// fields are accessed with memcpy() as the payload is not aligned in the circular buffer
+struct BinaryEvent {
+    int64_t     mTimeNs;    // CLOCK_MONOTONIC at time of logging
+    uint16_t    mId;        // caller-defined event identifier, decoded offline
+    uint8_t     mArgc;      // number of int32_t arguments that follow, 0 <= mArgc <= kMaxBinaryArgs
+    uint8_t     mReserved;
+} __attribute__((packed));
+
 // located in shared memory
 struct Shared {
     Shared() : mRear(0) { }
@@ -81,6 +92,25 @@ struct Shared {
 
 public:
 
+// maximum number of int32_t arguments carried by a binary event
+static const size_t kMaxBinaryArgs = 8;
+
+// Compact export format written by Reader::exportBinary() and parsed by offline tools.
+// All multi-byte fields are in host byte order.
+//  ExportHeader
+//  zero or more entries in the shared memory representation described above,
+//  oldest first, with EVENT_BINARY payloads laid out as a BinaryEvent
+struct ExportHeader {
+    uint32_t    mMagic;     // kExportMagic
+    uint16_t    mVersion;   // kExportVersion
+    uint16_t    mHeaderSize; // sizeof(ExportHeader), to allow appending fields later
+    uint32_t    mLost;      // number of bytes of events lost before the first entry
+    uint32_t    mLength;    // number of bytes of entries that follow the header
+} __attribute__((packed));
+
+static const uint32_t kExportMagic = 0x424c424e;   // "NBLB" in little endian
+static const uint16_t kExportVersion = 1;
+
 // ---------------------------------------------------------------------------
 
 // FIXME Timeline was intended to wrap Writer and Reader, but isn't actually used yet.
@@ -128,6 +158,24 @@ public:
     virtual void    logTimestamp();
     virtual void    logTimestamp(const struct timespec& ts);
 
+    // Binary events are logged without any formatting, and so are suitable for use on
+    // SCHED_FIFO threads.  The caller-defined id and arguments are decoded by Reader::dump(),
+    // or by an offline tool that parses the output of Reader::exportBinary().
+    // At most kMaxBinaryArgs arguments are kept, any others are silently dropped.
+    virtual void    logEventv(uint16_t id, const int32_t *args, size_t argc);
+            void    logEvent(uint16_t id)
+                        { logEventv(id, NULL, 0); }
+            void    logEvent(uint16_t id, int32_t arg0)
+                        { logEventv(id, &arg0, 1); }
+            void    logEvent(uint16_t id, int32_t arg0, int32_t arg1)
+                        { const int32_t args[2] = {arg0, arg1}; logEventv(id, args, 2); }
+            void    logEvent(uint16_t id, int32_t arg0, int32_t arg1, int32_t arg2)
+                        { const int32_t args[3] = {arg0, arg1, arg2}; logEventv(id, args, 3); }
+            void    logEvent(uint16_t id, int32_t arg0, int32_t arg1, int32_t arg2,
+                            int32_t arg3)
+                        { const int32_t args[4] = {arg0, arg1, arg2, arg3};
+                          logEventv(id, args, 4); }
+
     virtual bool    isEnabled() const;
 
     // return value for all of these is the previous isEnabled()
@@ -161,6 +209,7 @@ public:
     virtual void    logvf(const char *fmt, va_list ap);
     virtual void    logTimestamp();
     virtual void    logTimestamp(const struct timespec& ts);
+    virtual void    logEventv(uint16_t id, const int32_t *args, size_t argc);
 
     virtual bool    isEnabled() const;
     virtual bool    setEnabled(bool enabled);
@@ -182,6 +231,11 @@ public:
     virtual ~Reader() { }
 
     void    dump(int fd, size_t indent = 0);
+
+    // Write the entries not yet read to fd in the compact export format, see ExportHeader.
+    // Like dump(), this consumes the entries.
+    status_t exportBinary(int fd);
+
     bool    isIMemory(const sp<IMemory>& iMemory) const;
 
 private:
@@ -194,6 +248,13 @@ private:
 
     void    dumpLine(const String8& timestamp, String8& body);
 
+    // Copy the entries not yet read into a new[] allocated buffer, advance mFront past them,
+    // and return the buffer or NULL if there are none.  On return *avail is the size of the
+    // buffer, *first is the offset of the oldest intact entry within it, and *lost is the
+    // number of bytes of entries overwritten or truncated before *first.
+    // *maxSec is the largest timestamp second seen, or -1 if no timestamps.
+    uint8_t *copyAvailable(size_t *avail, size_t *first, size_t *lost, time_t *maxSec);
+
     static const size_t kSquashTimestamp = 5; // squash this many or more adjacent timestamps
 };
 
@@ -39,6 +39,7 @@
 namespace android {
 
 struct ABuffer;
+struct CodecObserver;
 struct MemoryDealer;
 struct DescribeColorFormatParams;
 
@@ -63,9 +64,7 @@ struct ACodec : public AHierarchicalStateMachine, public CodecBase {
     virtual void signalRequestIDRFrame();
 
     // AHierarchicalStateMachine implements the message handling
-    virtual void onMessageReceived(const sp<AMessage> &msg) {
-        handleMessage(msg);
-    }
+    virtual void onMessageReceived(const sp<AMessage> &msg);
 
     struct PortDescription : public CodecBase::PortDescription {
         size_t countBuffers();
@@ -94,6 +93,11 @@ struct ACodec : public AHierarchicalStateMachine, public CodecBase {
             int width, int height, int rate, int bitrate,
             OMX_VIDEO_AVCPROFILETYPE profile = OMX_VIDEO_AVCProfileBaseline);
 
+    // Instantiates the decoder an ACodec would pick for "mime" in the
+    // background and keeps it idle for a while, so that allocating one
+    // shortly after does not have to wait for it.
+    static void PrewarmDecoder(const char *mime);
+
 protected:
     virtual ~ACodec();
 
@@ -129,6 +133,7 @@ private:
         kWhatSubmitOutputMetaDataBufferIfEOS = 'subm',
         kWhatOMXDied                 = 'OMXd',
         kWhatReleaseCodecInstance    = 'relC',
+        kWhatSubmitBufferOps         = 'subB',
     };
 
     enum {
@@ -187,6 +192,15 @@ private:
     uint32_t mQuirks;
     sp<IOMX> mOMX;
     IOMX::node_id mNode;
+    sp<CodecObserver> mObserver;
+
+    // Whether the component may be handed to the next ACodec asking for it
+    // instead of being freed on shutdown. Only poolable software decoders
+    // start out reusable. Cleared by any error, and by applying any setting
+    // that outlives the configuration, e.g. graphic buffers, metadata mode,
+    // adaptive playback, decoder threading or direct output, since nothing
+    // puts those back to their defaults.
+    bool mComponentReusable;
     sp<MemoryDealer> mDealer[2];
 
     sp<ANativeWindow> mNativeWindow;
@@ -233,6 +247,12 @@ private:
 
     bool mIsVideoRenderingDisabled;
 
+    // With a remote OMX, emptyBuffer()/fillBuffer() calls are collected here
+    // and sent in one submitBuffers() call once the looper is done with the
+    // messages that produced them, see onMessageReceived().
+    bool mBatchBufferOps;
+    Vector<IOMX::BufferOp> mPendingBufferOps;
+
     status_t setCyclicIntraMacroblockRefresh(const sp<AMessage> &msg, int32_t mode);
     status_t allocateBuffersOnPort(OMX_U32 portIndex);
     status_t freeBuffersOnPort(OMX_U32 portIndex);
@@ -324,6 +344,10 @@ private:
 
     status_t setupErrorCorrectionParameters();
 
+    void setVideoDecoderThreading(const sp<AMessage> &msg, bool whileRunning);
+    void setVideoDecoderDirectOutput(const sp<AMessage> &msg);
+    void setAudioEncoderThreading(const sp<AMessage> &msg);
+
     status_t initNativeWindow();
 
     status_t pushBlankBuffersToNativeWindow();
@@ -342,6 +366,12 @@ private:
     void deferMessage(const sp<AMessage> &msg);
     void processDeferredMessages();
 
+    void queueEmptyBuffer(
+            IOMX::buffer_id bufferID, OMX_U32 rangeOffset, OMX_U32 rangeLength,
+            OMX_U32 flags, OMX_TICKS timestamp);
+    void queueFillBuffer(IOMX::buffer_id bufferID);
+    void submitPendingBufferOps();
+
     void sendFormatChange(const sp<AMessage> &reply);
     status_t getPortFormat(OMX_U32 portIndex, sp<AMessage> &notify);
 
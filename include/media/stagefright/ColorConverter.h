@@ -27,12 +27,35 @@
 
 namespace android {
 
+// Destination format with R, G, B and A bytes in memory, alpha opaque. Same
+// value as OMX_COLOR_Format32BitRGBA8888 of later OpenMAX IL headers.
+static const OMX_COLOR_FORMATTYPE kColorFormatRGBA8888 =
+        (OMX_COLOR_FORMATTYPE)0x7F00A000;
+
 struct ColorConverter {
+    enum ColorMatrix {
+        kColorMatrixBT601,
+        kColorMatrixBT709,
+    };
+
     ColorConverter(OMX_COLOR_FORMATTYPE from, OMX_COLOR_FORMATTYPE to);
     ~ColorConverter();
 
     bool isValid() const;
 
+    // Color space of the source, BT.601 limited range by default. Not
+    // supported for OMX_COLOR_FormatCbYCrY.
+    void setSrcColorSpace(ColorMatrix matrix, bool fullRange);
+
+    // Large frames are converted in bands of rows on up to this many
+    // threads, 0 to choose from the number of CPUs. The default of 1 keeps
+    // to the calling thread: band threads are started and joined on every
+    // convert(), which only pays off for large frames converted back to back.
+    void setMaxThreads(size_t maxThreads);
+
+    // The destination crop is the size of the source crop or, for YUV 4:2:0
+    // sources, smaller by the same whole factor both ways, which converts
+    // every factor-th pixel of every factor-th row.
     status_t convert(
             const void *srcBits,
             size_t srcWidth, size_t srcHeight,
@@ -59,11 +82,58 @@ private:
         size_t mCropLeft, mCropTop, mCropRight, mCropBottom;
     };
 
+    // Y'CbCr to R'G'B' in units of 1/256.
+    struct Coefficients {
+        int32_t mYOffset;
+        int32_t mY;
+        int32_t mVToR;
+        int32_t mUToG;
+        int32_t mVToG;
+        int32_t mUToB;
+    };
+
+    // Where the rows of a YUV 4:2:0 source are. The chroma samples of pixel
+    // pair i of a row are mU[i * mChromaStep] and mV[i * mChromaStep].
+    struct YUV420Layout {
+        const uint8_t *mY;
+        const uint8_t *mU;
+        const uint8_t *mV;
+        size_t mYStride;
+        size_t mChromaStride;
+        size_t mChromaStep;
+        size_t mWidth;
+        size_t mHeight;
+
+        // Only every mScale-th pixel of every mScale-th row is converted,
+        // mWidth and mHeight are those of the result.
+        size_t mScale;
+
+        // Write the color computed as blue where red goes and vice versa.
+        bool mSwapRB;
+    };
+
+    struct Band;
+
     OMX_COLOR_FORMATTYPE mSrcFormat, mDstFormat;
     uint8_t *mClip;
+    Coefficients mCoefficients;
+    size_t mMaxThreads;
 
     uint8_t *initClip();
 
+    // The whole factor the destination crop is smaller than the source
+    // crop by, 0 if there is none.
+    static size_t ScaleFactor(const BitmapParams &src, const BitmapParams &dst);
+
+    status_t convertYUV420(
+            const YUV420Layout &layout, const BitmapParams &dst);
+
+    void convertYUV420Rows(
+            const YUV420Layout &layout, const BitmapParams &dst,
+            size_t firstRow, size_t numRows);
+
+    static void *BandThreadWrapper(void *me);
+
     status_t convertCbYCrY(
             const BitmapParams &src, const BitmapParams &dst);
 
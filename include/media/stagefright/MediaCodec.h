@@ -61,6 +61,10 @@ struct MediaCodec : public AHandler {
     static sp<MediaCodec> CreateByComponentName(
             const sp<ALooper> &looper, const char *name, status_t *err = NULL);
 
+    // Gets a decoder for "mime" instantiated in the background, so that a
+    // CreateByType() for it shortly after finds one ready.
+    static void PrewarmByType(const char *mime);
+
     status_t configure(
             const sp<AMessage> &format,
             const sp<Surface> &nativeWindow,
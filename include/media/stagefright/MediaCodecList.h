@@ -51,6 +51,11 @@ struct MediaCodecList : public BnMediaCodecList {
     // to be used by MediaPlayerService alone
     static sp<IMediaCodecList> getLocalInstance();
 
+    // The list as last built from the XML files and the codecs' answers,
+    // loaded by later instances (in any process that can read it) while
+    // the files and the components OMX offers stay the same.
+    static const char *kCachePath;
+
 private:
     class BinderDeathObserver : public IBinder::DeathRecipient {
         void binderDied(const wp<IBinder> &the_late_who __unused);
@@ -82,7 +87,18 @@ private:
     sp<MediaCodecInfo> mCurrentInfo;
     sp<IOMX> mOMX;
 
-    MediaCodecList();
+    // Every XML file read, in order, which the cache is keyed on.
+    Vector<AString> mXMLFiles;
+
+    KeyedVector<AString, size_t> mCodecIndexByName;
+
+    // Indices of the codecs findCodecByType() returns for each lower case
+    // type, decoders first, in list order.
+    KeyedVector<AString, Vector<size_t> > mLegacyCodecsByType[2];
+
+    // With "cacheOnly", fails rather than parse the XML files if the cache
+    // cannot be used.
+    MediaCodecList(bool cacheOnly = false);
     ~MediaCodecList();
 
     status_t initCheck() const;
@@ -109,6 +125,11 @@ private:
 
     status_t initializeCapabilities(const char *type);
 
+    status_t loadCache(const char *path);
+    status_t parseCache(const uint8_t *data, size_t size);
+    void writeCache(const char *path) const;
+    void buildIndex();
+
     DISALLOW_EVIL_CONSTRUCTORS(MediaCodecList);
 };
 
@@ -28,8 +28,17 @@ class MetaData;
 
 class MediaExtractor : public RefBase {
 public:
+    enum CreateFlags {
+        // Read only what describes the content: tracks, their formats and
+        // durations, and the file's tags. Sample indices, seek tables and
+        // embedded pictures are skipped, so the extractor reads little more
+        // than the headers, but it may not be able to provide its tracks.
+        kMetaDataOnly = 1,
+    };
+
     static sp<MediaExtractor> Create(
-            const sp<DataSource> &source, const char *mime = NULL);
+            const sp<DataSource> &source, const char *mime = NULL,
+            uint32_t flags = 0);
 
     virtual size_t countTracks() = 0;
     virtual sp<MediaSource> getTrack(size_t index) = 0;
@@ -59,9 +59,19 @@ struct MediaSource : public virtual RefBase {
     virtual status_t read(
             MediaBuffer **buffer, const ReadOptions *options = NULL) = 0;
 
+    // Like read(), but the sample's data is placed at |data|, which has room
+    // for |capacity| bytes, and its length and meta data are returned in
+    // |*size| and |*meta|. A sample that does not fit fails the call with
+    // ERROR_BUFFER_TOO_SMALL and may be lost. Sources that can read straight
+    // into |data| override this, by default what read() returns is copied.
+    virtual status_t readInto(
+            void *data, size_t capacity, size_t *size, sp<MetaData> *meta,
+            const ReadOptions *options = NULL);
+
     // Options that modify read() behaviour. The default is to
     // a) not request a seek
     // b) not be late, i.e. lateness_us = 0
+    // c) return every sample, not just the sync samples
     struct ReadOptions {
         enum SeekMode {
             SEEK_PREVIOUS_SYNC,
@@ -86,9 +96,16 @@ struct MediaSource : public virtual RefBase {
         void clearNonBlocking();
         bool getNonBlocking() const;
 
+        // Sources that know which samples are sync samples skip all others,
+        // without reading them, for as long as this is set. Others ignore it.
+        void setSyncFramesOnly();
+        void clearSyncFramesOnly();
+        bool getSyncFramesOnly() const;
+
     private:
         enum Options {
-            kSeekTo_Option      = 1,
+            kSeekTo_Option          = 1,
+            kSyncFramesOnly_Option  = 2,
         };
 
         uint32_t mOptions;
@@ -73,6 +73,15 @@ struct NuMediaExtractor : public RefBase {
     status_t getSampleTime(int64_t *sampleTimeUs);
     status_t getSampleMeta(sp<MetaData> *sampleMeta);
 
+    // Reads the current sample into |buffer| and moves on to the next one,
+    // as readSampleData() followed by advance() would, returning the track
+    // the sample belongs to and its meta data. While a single track is
+    // selected and |buffer| can hold its largest sample, the track's source
+    // reads straight into |buffer| instead of into a buffer that is copied.
+    status_t readSampleDataAndAdvance(
+            const sp<ABuffer> &buffer, size_t *trackIndex,
+            sp<MetaData> *sampleMeta);
+
     bool getCachedDuration(int64_t *durationUs, bool *eos) const;
 
 protected:
@@ -89,6 +98,7 @@ private:
         status_t mFinalResult;
         MediaBuffer *mSample;
         int64_t mSampleTimeUs;
+        size_t mMaxSampleSize;  // 0 if unknown
 
         uint32_t mTrackFlags;  // bitmask of "TrackFlags"
     };
@@ -111,6 +121,8 @@ private:
 
     void releaseTrackSamples();
 
+    status_t copySampleData(TrackInfo *info, const sp<ABuffer> &buffer);
+
     bool getTotalBitrate(int64_t *bitRate) const;
     void updateDurationAndBitrate();
 
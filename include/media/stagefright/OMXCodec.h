@@ -248,6 +248,7 @@ private:
     bool mOutputPortSettingsHaveChanged;
     int64_t mSeekTimeUs;
     ReadOptions::SeekMode mSeekMode;
+    bool mSyncFramesOnly;
     int64_t mTargetTimeUs;
     bool mOutputPortSettingsChangedPending;
     sp<SkipCutBuffer> mSkipCutBuffer;
@@ -350,6 +351,9 @@ private:
     bool drainInputBuffer(IOMX::buffer_id buffer);
     void fillOutputBuffer(IOMX::buffer_id buffer);
     bool drainInputBuffer(BufferInfo *info);
+    status_t readSourceBuffer(
+            BufferInfo *info, const MediaSource::ReadOptions &options,
+            MediaBuffer **buffer, sp<MetaData> *meta);
     void fillOutputBuffer(BufferInfo *info);
 
     void drainInputBuffers();
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUDIO_TIMESTAMP_STATE_H
+#define AUDIO_TIMESTAMP_STATE_H
+
+#include <stdint.h>
+
+namespace android {
+
+// Represents the most recent timestamp of an AudioTrack or AudioRecord.  This state is published
+// by the server once per period and read by the client without a binder call.  As this state is
+// too large to be updated atomically without a mutex, and mutexes aren't allowed here, the state
+// is wrapped by a SingleStateQueue.
+struct AudioTimestampState {
+    // do not define constructors, destructors, or virtual methods
+
+    // All fields are fixed width since they are located in shared memory,
+    // and the client and server may have different typedefs for size_t and struct timespec.
+
+    // Playback: frame presented at mTimeNs.  Capture: frame captured at mTimeNs.
+    // In the server's frame count time base, the same as audio_track_cblk_t::mServer.
+    uint32_t    mPosition;
+
+    // Latency of the sink (playback) or source (capture) in milliseconds
+    uint32_t    mLatencyMs;
+
+    // CLOCK_MONOTONIC time corresponding to mPosition
+    int64_t     mTimeNs;
+
+    // Playback: total frames which the server desired but were unavailable.  Capture: 0.
+    uint32_t    mUnderrunFrames;
+
+    // Copy of audio_track_cblk_t::mTimestampGeneration when this state was published;
+    // the client ignores states published before its most recent start, stop, pause or flush.
+    uint32_t    mGeneration;
+};
+
+}   // namespace android
+
+#endif  // AUDIO_TIMESTAMP_STATE_H
@@ -26,6 +26,7 @@
 #include <utils/RefBase.h>
 #include <media/nbaio/roundup.h>
 #include <media/SingleStateQueue.h>
+#include <private/media/AudioTimestampState.h>
 #include <private/media/StaticAudioTrackState.h>
 
 namespace android {
@@ -64,6 +65,8 @@ struct AudioTrackSharedStreaming {
 
 typedef SingleStateQueue<StaticAudioTrackState> StaticAudioTrackSingleStateQueue;
 
+typedef SingleStateQueue<AudioTimestampState> AudioTimestampSingleStateQueue;
+
 struct AudioTrackSharedStatic {
     StaticAudioTrackSingleStateQueue::Shared
                     mSingleStateQueue;
@@ -100,7 +103,9 @@ struct audio_track_cblk_t
                                         // The value should be used "for entertainment purposes only",
                                         // which means don't make important decisions based on it.
 
-                uint32_t    mPad1;      // unused
+    volatile    int32_t     mTimestampGeneration;   // incremented by client on each transition
+                                        // that invalidates the published timestamp,
+                                        // read by server when publishing; see mTimestamp.
 
     volatile    int32_t     mFutex;     // event flag: down (P) by client,
                                         // up (V) by server or binderDied() or interrupt()
@@ -137,6 +142,9 @@ public:
                 } u;
 
                 // Cache line boundary (32 bytes)
+
+                // Published by server each period, read by client; see AudioTimestampState.
+                AudioTimestampSingleStateQueue::Shared mTimestamp;
 };
 
 // ----------------------------------------------------------------------------
@@ -260,8 +268,22 @@ public:
 
     size_t      getFramesFilled();
 
+    // Return the most recent timestamp published by the server, without a binder call.
+    // The position is in the server's time base; see AudioTimestampState.
+    // Returns NO_ERROR, or WOULD_BLOCK if no timestamp has been published yet,
+    // or none since the most recent call to invalidateTimestamp().
+    status_t    getTimestamp(AudioTimestampState *timestamp);
+
+    // Discard the cached timestamp, and any published before this call.
+    // Call after start, stop, pause or flush, once the server has been told of the transition.
+    void        invalidateTimestamp();
+
 private:
     size_t      mEpoch;
+
+    AudioTimestampSingleStateQueue::Observer    mTimestampObserver;
+    AudioTimestampState                         mTimestamp;     // most recent value observed
+    bool                                        mTimestampValid;
 };
 
 // ----------------------------------------------------------------------------
@@ -385,9 +407,20 @@ public:
     //  buffer->mRaw is NULL.
     virtual void        releaseBuffer(Buffer* buffer);
 
+    // The client's current timestamp generation.  Read it before sampling what a timestamp is
+    // computed from, so that a start, stop, pause or flush in between discards that timestamp.
+    uint32_t    getTimestampGeneration() const;
+
+    // Publish a new timestamp to the client; called once per period by the thread loop.
+    // timestamp.mGeneration must be the value getTimestampGeneration() returned beforehand.
+    void        setTimestamp(const AudioTimestampState& timestamp);
+
 protected:
     size_t      mAvailToClient; // estimated frames available to client prior to releaseBuffer()
     int32_t     mFlush;         // our copy of cblk->u.mStreaming.mFlush, for streaming output only
+
+private:
+    AudioTimestampSingleStateQueue::Mutator mTimestampMutator;
 };
 
 // Proxy used by AudioFlinger for servicing AudioTrack
@@ -60,6 +60,7 @@ LOCAL_SRC_FILES:= \
     IAudioPolicyServiceClient.cpp \
     MediaScanner.cpp \
     MediaScannerClient.cpp \
+    MediaScanIndex.cpp \
     CharacterEncodingDetector.cpp \
     IMediaDeathNotifier.cpp \
     MediaProfiles.cpp \
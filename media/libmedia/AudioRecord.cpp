@@ -303,6 +303,8 @@ status_t AudioRecord::start(AudioSystem::sync_event_t event, int triggerSession)
     if (flags & CBLK_INVALID) {
         status = restoreRecord_l("start");
     }
+    // the epoch was reset above; ignore any timestamp published before the restart
+    mProxy->invalidateTimestamp();
 
     if (status != NO_ERROR) {
         ALOGE("start() status %d", status);
@@ -413,6 +415,25 @@ status_t AudioRecord::getPosition(uint32_t *position) const
     return NO_ERROR;
 }
 
+status_t AudioRecord::getTimestamp(AudioTimestamp& timestamp)
+{
+    AutoMutex lock(mLock);
+    // fast tracks are serviced by FastCapture, which does not publish a timestamp
+    if (mFlags & AUDIO_INPUT_FLAG_FAST) {
+        return INVALID_OPERATION;
+    }
+    AudioTimestampState state;
+    status_t status = mProxy->getTimestamp(&state);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    // convert from server time base to client time base, as getPosition()
+    timestamp.mPosition = mProxy->getEpoch() + state.mPosition;
+    timestamp.mTime.tv_sec = state.mTimeNs / 1000000000LL;
+    timestamp.mTime.tv_nsec = state.mTimeNs % 1000000000LL;
+    return NO_ERROR;
+}
+
 uint32_t AudioRecord::getInputFramesLost() const
 {
     // no need to check mActive, because if inactive this will return 0, which is what we want
@@ -701,6 +701,8 @@ status_t AudioTrack::start()
     if (flags & (CBLK_INVALID | CBLK_STREAM_FATAL_ERROR)) {
         status = restoreTrack_l("start");
     }
+    // the server now knows of the transition; ignore any timestamp published before it
+    mProxy->invalidateTimestamp();
 
     if (status != NO_ERROR) {
         ALOGE("start() status %d", status);
@@ -736,6 +738,7 @@ void AudioTrack::stop()
     } else if (mAudioTrack != NULL) {
         mProxy->interrupt();
         mAudioTrack->stop();
+        mProxy->invalidateTimestamp();
     // the playback head position will reset to 0, so if a marker is set, we need
     // to activate it again
         mMarkerReached = false;
@@ -796,6 +799,7 @@ void AudioTrack::flush_l()
     }
     mProxy->flush();
     mAudioTrack->flush();
+    mProxy->invalidateTimestamp();
 }
 
 void AudioTrack::pause()
@@ -814,6 +818,7 @@ void AudioTrack::pause()
     } else {
        mProxy->interrupt();
        mAudioTrack->pause();
+       mProxy->invalidateTimestamp();
     }
     if (isOffloaded_l()) {
         if (mOutput != AUDIO_IO_HANDLE_NONE) {
@@ -2285,10 +2290,20 @@ status_t AudioTrack::getTimestamp(AudioTimestamp& timestamp)
     // To avoid a race, read the presented frames first.  This ensures that presented <= consumed.
     status_t status = NO_ERROR;
     if (!mUseSmallBuf) {
-        status = mAudioTrack->getTimestamp(timestamp);
-        if (status != NO_ERROR) {
-            ALOGV_IF(status != WOULD_BLOCK, "getTimestamp error:%#x", status);
-            return status;
+        // A mixed track reads the timestamp which the mixer thread publishes in the control
+        // block each period.  Until the first one is published, and for offloaded and direct
+        // tracks, ask the server.
+        AudioTimestampState state;
+        if (!isOffloadedOrDirect_l() && mProxy->getTimestamp(&state) == NO_ERROR) {
+            timestamp.mPosition = state.mPosition;
+            timestamp.mTime.tv_sec = state.mTimeNs / 1000000000LL;
+            timestamp.mTime.tv_nsec = state.mTimeNs % 1000000000LL;
+        } else {
+            status = mAudioTrack->getTimestamp(timestamp);
+            if (status != NO_ERROR) {
+                ALOGV_IF(status != WOULD_BLOCK, "getTimestamp error:%#x", status);
+                return status;
+            }
         }
     }
 
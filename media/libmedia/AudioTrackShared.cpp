@@ -36,6 +36,7 @@ audio_track_cblk_t::audio_track_cblk_t()
     mVolumeLR(GAIN_MINIFLOAT_PACKED_UNITY), mSampleRate(0), mSendLevel(0), mFlags(0)
 {
     memset(&u, 0, sizeof(u));
+    memset(&mTimestamp, 0, sizeof(mTimestamp));
 }
 
 // ---------------------------------------------------------------------------
@@ -55,7 +56,8 @@ Proxy::Proxy(audio_track_cblk_t* cblk, void *buffers, size_t frameCount, size_t
 
 ClientProxy::ClientProxy(audio_track_cblk_t* cblk, void *buffers, size_t frameCount,
         size_t frameSize, bool isOut, bool clientInServer)
-    : Proxy(cblk, buffers, frameCount, frameSize, isOut, clientInServer), mEpoch(0)
+    : Proxy(cblk, buffers, frameCount, frameSize, isOut, clientInServer), mEpoch(0),
+      mTimestampObserver(&cblk->mTimestamp), mTimestampValid(false)
 {
 }
 
@@ -359,6 +361,29 @@ size_t ClientProxy::getFramesFilled() {
     return (size_t)filled;
 }
 
+status_t ClientProxy::getTimestamp(AudioTimestampState *timestamp)
+{
+    // poll() only copies out the value if it has changed since the previous poll
+    AudioTimestampState state;
+    if (mTimestampObserver.poll(state) &&
+            state.mGeneration == (uint32_t) mCblk->mTimestampGeneration) {
+        mTimestamp = state;
+        mTimestampValid = true;
+    }
+    if (!mTimestampValid) {
+        return WOULD_BLOCK;
+    }
+    *timestamp = mTimestamp;
+    return NO_ERROR;
+}
+
+void ClientProxy::invalidateTimestamp()
+{
+    mTimestampValid = false;
+    // only the client writes the generation, so a plain read is sufficient here
+    android_atomic_release_store(mCblk->mTimestampGeneration + 1, &mCblk->mTimestampGeneration);
+}
+
 // ---------------------------------------------------------------------------
 
 void AudioTrackClientProxy::flush()
@@ -539,7 +564,7 @@ size_t StaticAudioTrackClientProxy::getBufferPosition()
 ServerProxy::ServerProxy(audio_track_cblk_t* cblk, void *buffers, size_t frameCount,
         size_t frameSize, bool isOut, bool clientInServer)
     : Proxy(cblk, buffers, frameCount, frameSize, isOut, clientInServer),
-      mAvailToClient(0), mFlush(0)
+      mAvailToClient(0), mFlush(0), mTimestampMutator(&cblk->mTimestamp)
 {
 }
 
@@ -694,6 +719,16 @@ void ServerProxy::releaseBuffer(Buffer* buffer)
     buffer->mNonContig = 0;
 }
 
+uint32_t ServerProxy::getTimestampGeneration() const
+{
+    return (uint32_t) android_atomic_acquire_load(&mCblk->mTimestampGeneration);
+}
+
+void ServerProxy::setTimestamp(const AudioTimestampState& timestamp)
+{
+    (void) mTimestampMutator.push(timestamp);
+}
+
 // ---------------------------------------------------------------------------
 
 size_t AudioTrackServerProxy::framesReady()
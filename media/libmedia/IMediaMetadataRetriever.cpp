@@ -68,8 +68,12 @@ enum {
     GET_FRAME_AT_TIME,
     EXTRACT_ALBUM_ART,
     EXTRACT_METADATA,
+    GET_FRAMES_AT_TIMES,
 };
 
+// The most frames one GET_FRAMES_AT_TIMES transaction asks for.
+static const size_t kMaxFramesAtTimes = 64;
+
 class BpMediaMetadataRetriever: public BpInterface<IMediaMetadataRetriever>
 {
 public:
@@ -185,6 +189,43 @@ public:
         }
     }
 
+    status_t getFramesAtTimes(
+            const Vector<int64_t> &timesUs, int option,
+            int32_t maxWidth, int32_t maxHeight,
+            Vector<sp<IMemory> > *frames)
+    {
+        frames->clear();
+        if (timesUs.size() > kMaxFramesAtTimes) {
+            return BAD_VALUE;
+        }
+
+        Parcel data, reply;
+        data.writeInterfaceToken(IMediaMetadataRetriever::getInterfaceDescriptor());
+        data.writeInt32(timesUs.size());
+        for (size_t i = 0; i < timesUs.size(); ++i) {
+            data.writeInt64(timesUs[i]);
+        }
+        data.writeInt32(option);
+        data.writeInt32(maxWidth);
+        data.writeInt32(maxHeight);
+#ifndef DISABLE_GROUP_SCHEDULE_HACK
+        sendSchedPolicy(data);
+#endif
+        remote()->transact(GET_FRAMES_AT_TIMES, data, &reply);
+        status_t ret = reply.readInt32();
+        if (ret != NO_ERROR) {
+            return ret;
+        }
+        for (size_t i = 0; i < timesUs.size(); ++i) {
+            sp<IMemory> frame;
+            if (reply.readInt32()) {
+                frame = interface_cast<IMemory>(reply.readStrongBinder());
+            }
+            frames->push(frame);
+        }
+        return NO_ERROR;
+    }
+
 private:
     KeyedVector<int, String8> mMetadata;
 };
@@ -287,6 +328,44 @@ status_t BnMediaMetadataRetriever::onTransact(
             }
 #ifndef DISABLE_GROUP_SCHEDULE_HACK
             restoreSchedPolicy();
+#endif
+            return NO_ERROR;
+        } break;
+        case GET_FRAMES_AT_TIMES: {
+            CHECK_INTERFACE(IMediaMetadataRetriever, data, reply);
+            size_t numTimes = data.readInt32();
+            if (numTimes > kMaxFramesAtTimes) {
+                reply->writeInt32(BAD_VALUE);
+                return NO_ERROR;
+            }
+            Vector<int64_t> timesUs;
+            for (size_t i = 0; i < numTimes; ++i) {
+                timesUs.push(data.readInt64());
+            }
+            int option = data.readInt32();
+            int32_t maxWidth = data.readInt32();
+            int32_t maxHeight = data.readInt32();
+#ifndef DISABLE_GROUP_SCHEDULE_HACK
+            setSchedPolicy(data);
+#endif
+            Vector<sp<IMemory> > frames;
+            status_t ret = getFramesAtTimes(
+                    timesUs, option, maxWidth, maxHeight, &frames);
+            if (ret == NO_ERROR && frames.size() != numTimes) {
+                ret = UNKNOWN_ERROR;
+            }
+            reply->writeInt32(ret);
+            if (ret == NO_ERROR) {
+                for (size_t i = 0; i < numTimes; ++i) {
+                    // Don't send NULL across the binder interface
+                    reply->writeInt32(frames[i] != 0);
+                    if (frames[i] != 0) {
+                        reply->writeStrongBinder(frames[i]->asBinder());
+                    }
+                }
+            }
+#ifndef DISABLE_GROUP_SCHEDULE_HACK
+            restoreSchedPolicy();
 #endif
             return NO_ERROR;
         } break;
@@ -55,6 +55,8 @@ enum {
     SET_INTERNAL_OPTION,
     UPDATE_GRAPHIC_BUFFER_IN_META,
     CONFIGURE_VIDEO_TUNNEL_MODE,
+    SUBMIT_BUFFERS,
+    OBSERVER_ON_MSGS,
 };
 
 class BpOMX : public BpInterface<IOMX> {
@@ -473,6 +475,26 @@ public:
         return reply.readInt32();
     }
 
+    virtual status_t submitBuffers(
+            node_id node, const Vector<BufferOp> &ops) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IOMX::getInterfaceDescriptor());
+        data.writeInt32((int32_t)node);
+        data.writeInt32(ops.size());
+        for (size_t i = 0; i < ops.size(); ++i) {
+            const BufferOp &op = ops[i];
+            data.writeInt32(op.mType);
+            data.writeInt32((int32_t)op.mBuffer);
+            data.writeInt32(op.mRangeOffset);
+            data.writeInt32(op.mRangeLength);
+            data.writeInt32(op.mFlags);
+            data.writeInt64(op.mTimestamp);
+        }
+        remote()->transact(SUBMIT_BUFFERS, data, &reply);
+
+        return reply.readInt32();
+    }
+
     virtual status_t getExtensionIndex(
             node_id node,
             const char *parameter_name,
@@ -928,6 +950,38 @@ status_t BnOMX::onTransact(
             return NO_ERROR;
         }
 
+        case SUBMIT_BUFFERS:
+        {
+            CHECK_OMX_INTERFACE(IOMX, data, reply);
+
+            node_id node = (node_id)data.readInt32();
+            size_t numOps = data.readInt32();
+
+            // Five 32 bit fields and a 64 bit one per operation.
+            if (numOps > data.dataAvail() / 28) {
+                ALOGE("submitBuffers: %zu operations do not fit %zu bytes",
+                        numOps, data.dataAvail());
+                reply->writeInt32(BAD_VALUE);
+                return NO_ERROR;
+            }
+
+            Vector<BufferOp> ops;
+            ops.resize(numOps);
+            for (size_t i = 0; i < numOps; ++i) {
+                BufferOp &op = ops.editItemAt(i);
+                op.mType = (BufferOp::Type)data.readInt32();
+                op.mBuffer = (buffer_id)data.readInt32();
+                op.mRangeOffset = data.readInt32();
+                op.mRangeLength = data.readInt32();
+                op.mFlags = data.readInt32();
+                op.mTimestamp = data.readInt64();
+            }
+
+            reply->writeInt32(submitBuffers(node, ops));
+
+            return NO_ERROR;
+        }
+
         case GET_EXTENSION_INDEX:
         {
             CHECK_OMX_INTERFACE(IOMX, data, reply);
@@ -969,10 +1023,31 @@ public:
 
         remote()->transact(OBSERVER_ON_MSG, data, &reply, IBinder::FLAG_ONEWAY);
     }
+
+    virtual void onMessages(const List<omx_message> &messages) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IOMXObserver::getInterfaceDescriptor());
+        data.writeInt32(messages.size());
+        for (List<omx_message>::const_iterator it = messages.begin();
+                it != messages.end(); ++it) {
+            data.write(&*it, sizeof(omx_message));
+        }
+
+        ALOGV("onMessages writing %zu messages", messages.size());
+
+        remote()->transact(OBSERVER_ON_MSGS, data, &reply, IBinder::FLAG_ONEWAY);
+    }
 };
 
 IMPLEMENT_META_INTERFACE(OMXObserver, "android.hardware.IOMXObserver");
 
+void IOMXObserver::onMessages(const List<omx_message> &messages) {
+    for (List<omx_message>::const_iterator it = messages.begin();
+            it != messages.end(); ++it) {
+        onMessage(*it);
+    }
+}
+
 status_t BnOMXObserver::onTransact(
     uint32_t code, const Parcel &data, Parcel *reply, uint32_t flags) {
     switch (code) {
@@ -991,6 +1066,29 @@ status_t BnOMXObserver::onTransact(
             return NO_ERROR;
         }
 
+        case OBSERVER_ON_MSGS:
+        {
+            CHECK_OMX_INTERFACE(IOMXObserver, data, reply);
+
+            size_t numMessages = data.readInt32();
+            if (numMessages > data.dataAvail() / sizeof(omx_message)) {
+                return BAD_VALUE;
+            }
+
+            List<omx_message> messages;
+            for (size_t i = 0; i < numMessages; ++i) {
+                omx_message msg;
+                data.read(&msg, sizeof(msg));
+                messages.push_back(msg);
+            }
+
+            ALOGV("onTransact reading %zu messages", numMessages);
+
+            onMessages(messages);
+
+            return NO_ERROR;
+        }
+
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MediaScanIndex"
+#include <utils/Log.h>
+
+#include "MediaScanIndex.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utils/String8.h>
+
+namespace android {
+
+// The file is a header of magic, version and entry count, followed by the
+// entries sorted by path, each a 32-bit path length, the path, then size,
+// modification time and inode as 64-bit and the noMedia flag as a byte.
+// Everything is in host byte order, the file never leaves the device.
+static const uint32_t kMagic = 0x4d534958;  // 'MSIX'
+static const uint32_t kVersion = 1;
+
+MediaScanIndex::MediaScanIndex()
+    : mEntries(NULL),
+      mNumEntries(0),
+      mCapacity(0),
+      mSorted(true) {
+}
+
+MediaScanIndex::~MediaScanIndex() {
+    clear();
+}
+
+void MediaScanIndex::clear() {
+    for (size_t i = 0; i < mNumEntries; ++i) {
+        free(mEntries[i].mPath);
+    }
+    free(mEntries);
+    mEntries = NULL;
+    mNumEntries = 0;
+    mCapacity = 0;
+    mSorted = true;
+}
+
+bool MediaScanIndex::reserve(size_t capacity) {
+    if (capacity <= mCapacity) {
+        return true;
+    }
+
+    size_t newCapacity = mCapacity < 64 ? 64 : mCapacity * 2;
+    if (newCapacity < capacity) {
+        newCapacity = capacity;
+    }
+
+    Entry *entries = (Entry *)realloc(mEntries, newCapacity * sizeof(Entry));
+    if (entries == NULL) {
+        return false;
+    }
+
+    mEntries = entries;
+    mCapacity = newCapacity;
+    return true;
+}
+
+void MediaScanIndex::add(
+        const char *path, int64_t size, int64_t modifiedTime,
+        uint64_t inode, bool noMedia) {
+    if (!reserve(mNumEntries + 1)) {
+        return;
+    }
+
+    Entry *entry = &mEntries[mNumEntries];
+    entry->mPath = strdup(path);
+    if (entry->mPath == NULL) {
+        return;
+    }
+    entry->mSize = size;
+    entry->mModifiedTime = modifiedTime;
+    entry->mInode = inode;
+    entry->mNoMedia = noMedia;
+
+    if (mNumEntries > 0
+            && strcmp(mEntries[mNumEntries - 1].mPath, path) >= 0) {
+        mSorted = false;
+    }
+    ++mNumEntries;
+}
+
+// static
+int MediaScanIndex::CompareEntries(const void *a, const void *b) {
+    return strcmp(((const Entry *)a)->mPath, ((const Entry *)b)->mPath);
+}
+
+void MediaScanIndex::sort() {
+    if (!mSorted) {
+        qsort(mEntries, mNumEntries, sizeof(Entry), CompareEntries);
+        mSorted = true;
+    }
+}
+
+const MediaScanIndex::Entry *MediaScanIndex::find(const char *path) {
+    sort();
+
+    Entry key;
+    key.mPath = const_cast<char *>(path);
+    if (mNumEntries == 0) {
+        return NULL;
+    }
+    return (const Entry *)bsearch(
+            &key, mEntries, mNumEntries, sizeof(Entry), CompareEntries);
+}
+
+void MediaScanIndex::removeTree(const char *directory) {
+    size_t length = strlen(directory);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < mNumEntries; ++i) {
+        if (!strncmp(mEntries[i].mPath, directory, length)) {
+            free(mEntries[i].mPath);
+        } else {
+            mEntries[kept++] = mEntries[i];
+        }
+    }
+    mNumEntries = kept;
+}
+
+void MediaScanIndex::takeEntries(MediaScanIndex *other) {
+    if (!reserve(mNumEntries + other->mNumEntries)) {
+        other->clear();
+        return;
+    }
+
+    memcpy(&mEntries[mNumEntries], other->mEntries,
+            other->mNumEntries * sizeof(Entry));
+    mNumEntries += other->mNumEntries;
+    mSorted = false;
+
+    free(other->mEntries);
+    other->mEntries = NULL;
+    other->mNumEntries = 0;
+    other->mCapacity = 0;
+    other->mSorted = true;
+}
+
+status_t MediaScanIndex::load(const char *path) {
+    clear();
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) != 0 || statbuf.st_size < 12) {
+        close(fd);
+        return BAD_VALUE;
+    }
+
+    size_t fileSize = statbuf.st_size;
+    uint8_t *data = (uint8_t *)malloc(fileSize);
+    if (data == NULL) {
+        close(fd);
+        return NO_MEMORY;
+    }
+
+    size_t offset = 0;
+    while (offset < fileSize) {
+        ssize_t n = read(fd, data + offset, fileSize - offset);
+        if (n <= 0) {
+            break;
+        }
+        offset += n;
+    }
+    close(fd);
+
+    if (offset < fileSize) {
+        free(data);
+        return -EIO;
+    }
+
+    uint32_t header[3];
+    memcpy(header, data, sizeof(header));
+    if (header[0] != kMagic || header[1] != kVersion) {
+        ALOGW("ignoring index '%s' of another version", path);
+        free(data);
+        return BAD_VALUE;
+    }
+
+    static const size_t kEntryFixedSize = 4 + 3 * 8 + 1;
+
+    status_t err = OK;
+    offset = sizeof(header);
+    if (header[2] > (fileSize - offset) / (kEntryFixedSize + 1)) {
+        err = BAD_VALUE;
+    } else if (!reserve(header[2])) {
+        err = NO_MEMORY;
+    }
+    for (uint32_t i = 0; err == OK && i < header[2]; ++i) {
+        uint32_t pathLength;
+        if (fileSize - offset < kEntryFixedSize) {
+            err = BAD_VALUE;
+            break;
+        }
+        memcpy(&pathLength, data + offset, 4);
+        if (pathLength == 0 || fileSize - offset - kEntryFixedSize < pathLength) {
+            err = BAD_VALUE;
+            break;
+        }
+        offset += 4;
+
+        String8 entryPath((const char *)data + offset, pathLength);
+        offset += pathLength;
+
+        int64_t size, modifiedTime;
+        uint64_t inode;
+        memcpy(&size, data + offset, 8);
+        memcpy(&modifiedTime, data + offset + 8, 8);
+        memcpy(&inode, data + offset + 16, 8);
+        bool noMedia = data[offset + 24] != 0;
+        offset += 25;
+
+        add(entryPath.string(), size, modifiedTime, inode, noMedia);
+    }
+
+    free(data);
+
+    if (err != OK) {
+        ALOGW("ignoring damaged index '%s'", path);
+        clear();
+        return err;
+    }
+
+    ALOGV("loaded %zu entries from '%s'", mNumEntries, path);
+    return OK;
+}
+
+status_t MediaScanIndex::save(const char *path) {
+    sort();
+
+    String8 tmpPath(path);
+    tmpPath.append(".tmp");
+
+    FILE *file = fopen(tmpPath.string(), "we");
+    if (file == NULL) {
+        ALOGW("cannot write index '%s': %s", tmpPath.string(), strerror(errno));
+        return -errno;
+    }
+
+    uint32_t header[3] = { kMagic, kVersion, (uint32_t)mNumEntries };
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+    for (size_t i = 0; ok && i < mNumEntries; ++i) {
+        const Entry &entry = mEntries[i];
+        uint32_t pathLength = strlen(entry.mPath);
+        uint8_t noMedia = entry.mNoMedia;
+
+        ok = fwrite(&pathLength, 4, 1, file) == 1
+            && fwrite(entry.mPath, pathLength, 1, file) == 1
+            && fwrite(&entry.mSize, 8, 1, file) == 1
+            && fwrite(&entry.mModifiedTime, 8, 1, file) == 1
+            && fwrite(&entry.mInode, 8, 1, file) == 1
+            && fwrite(&noMedia, 1, 1, file) == 1;
+    }
+
+    if (fflush(file) != 0 || fsync(fileno(file)) != 0) {
+        ok = false;
+    }
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+
+    if (!ok || rename(tmpPath.string(), path) != 0) {
+        ALOGW("cannot write index '%s': %s", path, strerror(errno));
+        unlink(tmpPath.string());
+        return -EIO;
+    }
+
+    ALOGV("saved %zu entries to '%s'", mNumEntries, path);
+    return OK;
+}
+
+}  // namespace android
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MEDIA_SCAN_INDEX_H_
+
+#define MEDIA_SCAN_INDEX_H_
+
+#include <stdint.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+// What MediaScanner knew about each file when it last reported it to its
+// client, kept on disk between scans.
+struct MediaScanIndex {
+    struct Entry {
+        char *mPath;
+        int64_t mSize;
+        int64_t mModifiedTime;
+        uint64_t mInode;
+        bool mNoMedia;
+    };
+
+    MediaScanIndex();
+    ~MediaScanIndex();
+
+    // Replaces the entries with those saved at |path|. A missing or damaged
+    // file, or one written by another version, leaves the index empty.
+    status_t load(const char *path);
+
+    // Writes the entries to |path|, replacing the file atomically.
+    status_t save(const char *path);
+
+    void add(const char *path, int64_t size, int64_t modifiedTime,
+            uint64_t inode, bool noMedia);
+
+    // The entry for |path|, or NULL.
+    const Entry *find(const char *path);
+
+    // Removes the entries for everything below |directory|, which ends in
+    // a '/'.
+    void removeTree(const char *directory);
+
+    // Moves all of |other|'s entries to this index.
+    void takeEntries(MediaScanIndex *other);
+
+    size_t size() const { return mNumEntries; }
+
+private:
+    Entry *mEntries;
+    size_t mNumEntries;
+    size_t mCapacity;
+    bool mSorted;
+
+    void clear();
+    bool reserve(size_t capacity);
+    void sort();
+
+    static int CompareEntries(const void *a, const void *b);
+
+    MediaScanIndex(const MediaScanIndex &);
+    MediaScanIndex &operator=(const MediaScanIndex &);
+};
+
+}  // namespace android
+
+#endif  // MEDIA_SCAN_INDEX_H_
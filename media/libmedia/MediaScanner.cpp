@@ -20,19 +20,28 @@
 #include <utils/Log.h>
 
 #include <media/mediascanner.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+
+#include "MediaScanIndex.h"
 
 #include <sys/stat.h>
 #include <dirent.h>
+#include <unistd.h>
 
 namespace android {
 
+static const size_t kMaxThreads = 8;
+
 MediaScanner::MediaScanner()
-    : mLocale(NULL), mSkipList(NULL), mSkipIndex(NULL) {
+    : mLocale(NULL), mSkipList(NULL), mSkipIndex(NULL), mMaxThreads(0),
+      mIndexPath(NULL) {
     loadSkipList();
 }
 
 MediaScanner::~MediaScanner() {
     setLocale(NULL);
+    setIndexPath(NULL);
     free(mSkipList);
     free(mSkipIndex);
 }
@@ -51,6 +60,20 @@ const char *MediaScanner::locale() const {
     return mLocale;
 }
 
+void MediaScanner::setMaxThreads(size_t maxThreads) {
+    mMaxThreads = maxThreads;
+}
+
+void MediaScanner::setIndexPath(const char *path) {
+    if (mIndexPath) {
+        free(mIndexPath);
+        mIndexPath = NULL;
+    }
+    if (path) {
+        mIndexPath = strdup(path);
+    }
+}
+
 void MediaScanner::loadSkipList() {
     mSkipList = (char *)malloc(PROPERTY_VALUE_MAX * sizeof(char));
     if (mSkipList) {
@@ -78,165 +101,496 @@ void MediaScanner::loadSkipList() {
     }
 }
 
-MediaScanResult MediaScanner::processDirectory(
-        const char *path, MediaScannerClient &client) {
-    int pathLength = strlen(path);
-    if (pathLength >= PATH_MAX) {
-        return MEDIA_SCAN_RESULT_SKIPPED;
+////////////////////////////////////////////////////////////////////////////////
+
+// Lists the directories of a scan on a pool of threads while the thread that
+// called processDirectory reports what they found to the client, walking
+// the tree depth first in readdir order just as a single thread would.
+//
+// Each thread keeps the subdirectories it finds on a queue of its own and
+// lists the most recently found one next, working its way down a subtree,
+// while idle threads take the oldest directories off other threads' queues,
+// which are the biggest subtrees left. When the reporting thread gets to a
+// directory nobody has started on yet it lists it itself instead of waiting
+// for it to come up in a queue.
+struct MediaScanner::Walker {
+    Walker(const MediaScanner *scanner, size_t numThreads);
+    ~Walker();
+
+    // |path| ends in a '/'.
+    MediaScanResult walk(
+            const char *path, int pathRemaining, MediaScannerClient &client,
+            MediaScanIndex *index, MediaScanIndex *seen);
+
+    size_t numUnchanged() const { return mNumUnchanged; }
+
+private:
+    struct Directory;
+
+    struct Entry {
+        String8 mName;
+        bool mIsDirectory;
+        bool mHaveStat;
+        int64_t mSize;
+        int64_t mModifiedTime;
+        uint64_t mInode;
+        Directory *mDirectory;
+    };
+
+    enum State {
+        PENDING,
+        LISTING,
+        LISTED,
+    };
+
+    struct Directory {
+        Directory(const String8 &path, int pathRemaining, bool noMedia)
+            : mPath(path),
+              mPathRemaining(pathRemaining),
+              mNoMedia(noMedia),
+              mFilesNoMedia(noMedia),
+              mState(PENDING),
+              mResult(MEDIA_SCAN_RESULT_OK) {
+        }
+
+        String8 mPath;
+        int mPathRemaining;
+        // The directory itself is reported with mNoMedia, its files with
+        // mFilesNoMedia, which is also set if it holds a ".nomedia" file.
+        bool mNoMedia;
+        bool mFilesNoMedia;
+        State mState;
+        MediaScanResult mResult;
+        Vector<Entry> mEntries;
+    };
+
+    struct ThreadArgs {
+        Walker *mWalker;
+        size_t mQueue;
+    };
+
+    const MediaScanner *mScanner;
+
+    Mutex mLock;
+    Condition mWorkCondition;
+    Condition mListedCondition;
+    bool mDone;
+
+    // One queue per thread, the last one is the reporting thread's.
+    List<Directory *> *mQueues;
+    size_t mNumQueues;
+    ThreadArgs *mThreadArgs;
+    Vector<pthread_t> mThreads;
+
+    // Everything created, freed with the walker.
+    Vector<Directory *> mDirectories;
+
+    size_t mNumUnchanged;
+
+    void listDirectory(Directory *dir, Vector<Directory *> *subdirs);
+    void queueDirectories(size_t queue, const Vector<Directory *> &subdirs);
+    Directory *dequeueDirectory(size_t queue);
+    void waitUntilListed(Directory *dir);
+
+    MediaScanResult report(
+            Directory *dir, MediaScannerClient &client,
+            MediaScanIndex *index, MediaScanIndex *seen);
+
+    static void *ThreadWrapper(void *me);
+    void threadLoop(size_t queue);
+
+    Walker(const Walker &);
+    Walker &operator=(const Walker &);
+};
+
+MediaScanner::Walker::Walker(const MediaScanner *scanner, size_t numThreads)
+    : mScanner(scanner),
+      mDone(false),
+      mQueues(new List<Directory *>[numThreads]),
+      mNumQueues(numThreads),
+      mThreadArgs(new ThreadArgs[numThreads]),
+      mNumUnchanged(0) {
+    for (size_t i = 0; i + 1 < numThreads; ++i) {
+        mThreadArgs[i].mWalker = this;
+        mThreadArgs[i].mQueue = i;
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, ThreadWrapper, &mThreadArgs[i]) != 0) {
+            ALOGW("could only start %zu directory threads", i);
+            break;
+        }
+        mThreads.push(thread);
     }
-    char* pathBuffer = (char *)malloc(PATH_MAX + 1);
-    if (!pathBuffer) {
-        return MEDIA_SCAN_RESULT_ERROR;
+}
+
+MediaScanner::Walker::~Walker() {
+    mLock.lock();
+    mDone = true;
+    mWorkCondition.broadcast();
+    mLock.unlock();
+
+    for (size_t i = 0; i < mThreads.size(); ++i) {
+        pthread_join(mThreads.itemAt(i), NULL);
     }
 
-    int pathRemaining = PATH_MAX - pathLength;
-    strcpy(pathBuffer, path);
-    if (pathLength > 0 && pathBuffer[pathLength - 1] != '/') {
-        pathBuffer[pathLength] = '/';
-        pathBuffer[pathLength + 1] = 0;
-        --pathRemaining;
+    for (size_t i = 0; i < mDirectories.size(); ++i) {
+        delete mDirectories.itemAt(i);
     }
 
-    client.setLocale(locale());
+    delete[] mThreadArgs;
+    delete[] mQueues;
+}
 
-    MediaScanResult result = doProcessDirectory(pathBuffer, pathRemaining, client, false);
+// static
+void *MediaScanner::Walker::ThreadWrapper(void *me) {
+    ThreadArgs *args = static_cast<ThreadArgs *>(me);
+    args->mWalker->threadLoop(args->mQueue);
+    return NULL;
+}
 
-    free(pathBuffer);
+void MediaScanner::Walker::threadLoop(size_t queue) {
+    Mutex::Autolock autoLock(mLock);
 
-    return result;
+    while (!mDone) {
+        Directory *dir = dequeueDirectory(queue);
+        if (dir == NULL) {
+            mWorkCondition.wait(mLock);
+            continue;
+        }
+
+        dir->mState = LISTING;
+
+        Vector<Directory *> subdirs;
+        mLock.unlock();
+        listDirectory(dir, &subdirs);
+        mLock.lock();
+
+        dir->mState = LISTED;
+        queueDirectories(queue, subdirs);
+        mListedCondition.broadcast();
+    }
 }
 
-bool MediaScanner::shouldSkipDirectory(char *path) {
-    if (path && mSkipList && mSkipIndex) {
-        int len = strlen(path);
-        int idx = 0;
-        // track the start position of next path in the comma
-        // separated list obtained from getprop
-        int startPos = 0;
-        while (mSkipIndex[idx] != -1) {
-            // no point to match path name if strlen mismatch
-            if ((len == mSkipIndex[idx])
-                // pick out the path segment from comma separated list
-                // to compare against current path parameter
-                && (strncmp(path, &mSkipList[startPos], len) == 0)) {
-                return true;
+// Called with mLock held.
+void MediaScanner::Walker::queueDirectories(
+        size_t queue, const Vector<Directory *> &subdirs) {
+    for (size_t i = 0; i < subdirs.size(); ++i) {
+        mDirectories.push(subdirs.itemAt(i));
+    }
+
+    if (mThreads.isEmpty() || subdirs.isEmpty()) {
+        return;
+    }
+
+    // Backwards, so that the first subdirectory is the next one this thread
+    // lists, and the last the first one another thread takes.
+    for (size_t i = subdirs.size(); i-- > 0;) {
+        mQueues[queue].push_back(subdirs.itemAt(i));
+    }
+    mWorkCondition.broadcast();
+}
+
+// Called with mLock held. Directories the reporting thread took on itself
+// are still queued, they are dropped here.
+MediaScanner::Walker::Directory *MediaScanner::Walker::dequeueDirectory(
+        size_t queue) {
+    List<Directory *> &own = mQueues[queue];
+    while (!own.empty()) {
+        List<Directory *>::iterator it = --own.end();
+        Directory *dir = *it;
+        own.erase(it);
+        if (dir->mState == PENDING) {
+            return dir;
+        }
+    }
+
+    for (size_t i = 1; i < mNumQueues; ++i) {
+        List<Directory *> &other = mQueues[(queue + i) % mNumQueues];
+        while (!other.empty()) {
+            Directory *dir = *other.begin();
+            other.erase(other.begin());
+            if (dir->mState == PENDING) {
+                return dir;
             }
-            startPos += mSkipIndex[idx] + 1; // extra char for the delimiter
-            idx++;
         }
     }
-    return false;
+
+    return NULL;
 }
 
-MediaScanResult MediaScanner::doProcessDirectory(
-        char *path, int pathRemaining, MediaScannerClient &client, bool noMedia) {
-    // place to copy file or directory name
-    char* fileSpot = path + strlen(path);
-    struct dirent* entry;
+void MediaScanner::Walker::waitUntilListed(Directory *dir) {
+    Mutex::Autolock autoLock(mLock);
 
-    if (shouldSkipDirectory(path)) {
+    while (dir->mState != LISTED) {
+        if (dir->mState == LISTING) {
+            mListedCondition.wait(mLock);
+            continue;
+        }
+
+        dir->mState = LISTING;
+
+        Vector<Directory *> subdirs;
+        mLock.unlock();
+        listDirectory(dir, &subdirs);
+        mLock.lock();
+
+        dir->mState = LISTED;
+        queueDirectories(mNumQueues - 1, subdirs);
+    }
+}
+
+// Runs without mLock, on whichever thread took |dir|.
+void MediaScanner::Walker::listDirectory(
+        Directory *dir, Vector<Directory *> *subdirs) {
+    const char *path = dir->mPath.string();
+
+    if (mScanner->shouldSkipDirectory(path)) {
         ALOGD("Skipping: %s", path);
-        return MEDIA_SCAN_RESULT_OK;
+        return;
     }
 
     // Treat all files as non-media in directories that contain a  ".nomedia" file
-    if (pathRemaining >= 8 /* strlen(".nomedia") */ ) {
-        strcpy(fileSpot, ".nomedia");
-        if (access(path, F_OK) == 0) {
+    if (dir->mPathRemaining >= 8 /* strlen(".nomedia") */ ) {
+        String8 noMediaPath(dir->mPath);
+        noMediaPath.append(".nomedia");
+        if (access(noMediaPath.string(), F_OK) == 0) {
             ALOGV("found .nomedia, setting noMedia flag");
-            noMedia = true;
+            dir->mFilesNoMedia = true;
         }
-
-        // restore path
-        fileSpot[0] = 0;
     }
 
-    DIR* dir = opendir(path);
-    if (!dir) {
+    DIR* d = opendir(path);
+    if (!d) {
         ALOGW("Error opening directory '%s', skipping: %s.", path, strerror(errno));
-        return MEDIA_SCAN_RESULT_SKIPPED;
+        dir->mResult = MEDIA_SCAN_RESULT_SKIPPED;
+        return;
     }
 
-    MediaScanResult result = MEDIA_SCAN_RESULT_OK;
-    while ((entry = readdir(dir))) {
-        if (doProcessDirectoryEntry(path, pathRemaining, client, noMedia, entry, fileSpot)
-                == MEDIA_SCAN_RESULT_ERROR) {
-            result = MEDIA_SCAN_RESULT_ERROR;
-            break;
+    String8 entryPath;
+    struct dirent* entry;
+    struct stat statbuf;
+    while ((entry = readdir(d))) {
+        const char* name = entry->d_name;
+
+        // ignore "." and ".."
+        if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) {
+            continue;
         }
+
+        int nameLength = strlen(name);
+        if (nameLength + 1 > dir->mPathRemaining) {
+            // path too long!
+            continue;
+        }
+        entryPath = dir->mPath;
+        entryPath.append(name);
+
+        int type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            // If the type is unknown, stat() the file instead.
+            // This is sometimes necessary when accessing NFS mounted filesystems, but
+            // could be needed in other cases well.
+            if (stat(entryPath.string(), &statbuf) == 0) {
+                if (S_ISREG(statbuf.st_mode)) {
+                    type = DT_REG;
+                } else if (S_ISDIR(statbuf.st_mode)) {
+                    type = DT_DIR;
+                }
+            } else {
+                ALOGD("stat() failed for %s: %s", entryPath.string(), strerror(errno) );
+            }
+        }
+        if (type != DT_DIR && type != DT_REG) {
+            continue;
+        }
+
+        Entry item;
+        item.mName = name;
+        item.mIsDirectory = type == DT_DIR;
+        item.mHaveStat = stat(entryPath.string(), &statbuf) == 0;
+        item.mSize = item.mHaveStat ? statbuf.st_size : 0;
+        item.mModifiedTime = item.mHaveStat ? statbuf.st_mtime : 0;
+        item.mInode = item.mHaveStat ? statbuf.st_ino : 0;
+        item.mDirectory = NULL;
+
+        if (item.mIsDirectory) {
+            // set noMedia flag on directories with a name that starts with '.'
+            // for example, the Mac ".Trashes" directory
+            bool childNoMedia = dir->mFilesNoMedia || name[0] == '.';
+
+            entryPath.append("/");
+            item.mDirectory = new Directory(
+                    entryPath, dir->mPathRemaining - nameLength - 1, childNoMedia);
+            subdirs->push(item.mDirectory);
+        }
+
+        dir->mEntries.push(item);
     }
-    closedir(dir);
-    return result;
+    closedir(d);
 }
 
-MediaScanResult MediaScanner::doProcessDirectoryEntry(
-        char *path, int pathRemaining, MediaScannerClient &client, bool noMedia,
-        struct dirent* entry, char* fileSpot) {
-    struct stat statbuf;
-    const char* name = entry->d_name;
+MediaScanResult MediaScanner::Walker::walk(
+        const char *path, int pathRemaining, MediaScannerClient &client,
+        MediaScanIndex *index, MediaScanIndex *seen) {
+    Directory *root = new Directory(String8(path), pathRemaining, false);
 
-    // ignore "." and ".."
-    if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) {
-        return MEDIA_SCAN_RESULT_SKIPPED;
-    }
+    mLock.lock();
+    mDirectories.push(root);
+    mLock.unlock();
 
-    int nameLength = strlen(name);
-    if (nameLength + 1 > pathRemaining) {
-        // path too long!
-        return MEDIA_SCAN_RESULT_SKIPPED;
+    return report(root, client, index, seen);
+}
+
+MediaScanResult MediaScanner::Walker::report(
+        Directory *dir, MediaScannerClient &client,
+        MediaScanIndex *index, MediaScanIndex *seen) {
+    waitUntilListed(dir);
+
+    if (dir->mResult != MEDIA_SCAN_RESULT_OK) {
+        return dir->mResult;
     }
-    strcpy(fileSpot, name);
-
-    int type = entry->d_type;
-    if (type == DT_UNKNOWN) {
-        // If the type is unknown, stat() the file instead.
-        // This is sometimes necessary when accessing NFS mounted filesystems, but
-        // could be needed in other cases well.
-        if (stat(path, &statbuf) == 0) {
-            if (S_ISREG(statbuf.st_mode)) {
-                type = DT_REG;
-            } else if (S_ISDIR(statbuf.st_mode)) {
-                type = DT_DIR;
+
+    String8 path;
+    for (size_t i = 0; i < dir->mEntries.size(); ++i) {
+        const Entry &entry = dir->mEntries.itemAt(i);
+        path = dir->mPath;
+        path.append(entry.mName);
+
+        if (entry.mIsDirectory) {
+            // report the directory to the client
+            if (entry.mHaveStat) {
+                status_t status = client.scanFile(path.string(), entry.mModifiedTime, 0,
+                        true /*isDirectory*/, entry.mDirectory->mNoMedia);
+                if (status) {
+                    return MEDIA_SCAN_RESULT_ERROR;
+                }
             }
-        } else {
-            ALOGD("stat() failed for %s: %s", path, strerror(errno) );
-        }
-    }
-    if (type == DT_DIR) {
-        bool childNoMedia = noMedia;
-        // set noMedia flag on directories with a name that starts with '.'
-        // for example, the Mac ".Trashes" directory
-        if (name[0] == '.')
-            childNoMedia = true;
-
-        // report the directory to the client
-        if (stat(path, &statbuf) == 0) {
-            status_t status = client.scanFile(path, statbuf.st_mtime, 0,
-                    true /*isDirectory*/, childNoMedia);
-            if (status) {
+
+            // and now process its contents
+            MediaScanResult result = report(entry.mDirectory, client, index, seen);
+            if (result == MEDIA_SCAN_RESULT_ERROR) {
                 return MEDIA_SCAN_RESULT_ERROR;
             }
+            continue;
         }
 
-        // and now process its contents
-        strcat(fileSpot, "/");
-        MediaScanResult result = doProcessDirectory(path, pathRemaining - nameLength - 1,
-                client, childNoMedia);
-        if (result == MEDIA_SCAN_RESULT_ERROR) {
-            return MEDIA_SCAN_RESULT_ERROR;
+        bool noMedia = dir->mFilesNoMedia;
+
+        if (index != NULL && entry.mHaveStat) {
+            const MediaScanIndex::Entry *known = index->find(path.string());
+            if (known != NULL
+                    && known->mSize == entry.mSize
+                    && known->mModifiedTime == entry.mModifiedTime
+                    && known->mInode == entry.mInode
+                    && known->mNoMedia == noMedia) {
+                seen->add(path.string(), entry.mSize, entry.mModifiedTime,
+                        entry.mInode, noMedia);
+                ++mNumUnchanged;
+                continue;
+            }
         }
-    } else if (type == DT_REG) {
-        stat(path, &statbuf);
-        status_t status = client.scanFile(path, statbuf.st_mtime, statbuf.st_size,
+
+        status_t status = client.scanFile(path.string(), entry.mModifiedTime, entry.mSize,
                 false /*isDirectory*/, noMedia);
         if (status) {
             return MEDIA_SCAN_RESULT_ERROR;
         }
+
+        if (seen != NULL && entry.mHaveStat) {
+            seen->add(path.string(), entry.mSize, entry.mModifiedTime,
+                    entry.mInode, noMedia);
+        }
     }
 
+    // Done with these, there may be many more to come.
+    dir->mEntries.clear();
+
     return MEDIA_SCAN_RESULT_OK;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+MediaScanResult MediaScanner::processDirectory(
+        const char *path, MediaScannerClient &client) {
+    int pathLength = strlen(path);
+    if (pathLength >= PATH_MAX) {
+        return MEDIA_SCAN_RESULT_SKIPPED;
+    }
+    char* pathBuffer = (char *)malloc(PATH_MAX + 1);
+    if (!pathBuffer) {
+        return MEDIA_SCAN_RESULT_ERROR;
+    }
+
+    int pathRemaining = PATH_MAX - pathLength;
+    strcpy(pathBuffer, path);
+    if (pathLength > 0 && pathBuffer[pathLength - 1] != '/') {
+        pathBuffer[pathLength] = '/';
+        pathBuffer[pathLength + 1] = 0;
+        --pathRemaining;
+    }
+
+    client.setLocale(locale());
+
+    size_t numThreads = mMaxThreads;
+    if (numThreads == 0) {
+        long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = numCPUs > 0 ? numCPUs : 1;
+    }
+    if (numThreads > kMaxThreads) {
+        numThreads = kMaxThreads;
+    }
+
+    MediaScanIndex index;
+    MediaScanIndex seen;
+    if (mIndexPath != NULL) {
+        index.load(mIndexPath);
+    }
+
+    MediaScanResult result;
+    {
+        Walker walker(this, numThreads);
+        result = walker.walk(pathBuffer, pathRemaining, client,
+                mIndexPath != NULL ? &index : NULL,
+                mIndexPath != NULL ? &seen : NULL);
+
+        ALOGV("scanned '%s' on %zu threads, %zu files unchanged",
+                pathBuffer, numThreads, walker.numUnchanged());
+    }
+
+    // Only a complete scan knows which files under |path| are gone.
+    if (mIndexPath != NULL && result == MEDIA_SCAN_RESULT_OK) {
+        index.removeTree(pathBuffer);
+        index.takeEntries(&seen);
+        index.save(mIndexPath);
+    }
+
+    free(pathBuffer);
+
+    return result;
+}
+
+bool MediaScanner::shouldSkipDirectory(const char *path) const {
+    if (path && mSkipList && mSkipIndex) {
+        int len = strlen(path);
+        int idx = 0;
+        // track the start position of next path in the comma
+        // separated list obtained from getprop
+        int startPos = 0;
+        while (mSkipIndex[idx] != -1) {
+            // no point to match path name if strlen mismatch
+            if ((len == mSkipIndex[idx])
+                // pick out the path segment from comma separated list
+                // to compare against current path parameter
+                && (strncmp(path, &mSkipList[startPos], len) == 0)) {
+                return true;
+            }
+            startPos += mSkipIndex[idx] + 1; // extra char for the delimiter
+            idx++;
+        }
+    }
+    return false;
+}
+
 MediaAlbumArt *MediaAlbumArt::clone() {
     size_t byte_size = this->size() + sizeof(MediaAlbumArt);
     MediaAlbumArt *result = reinterpret_cast<MediaAlbumArt *>(malloc(byte_size));
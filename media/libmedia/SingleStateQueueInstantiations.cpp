@@ -15,6 +15,7 @@
  */
 
 #include <media/SingleStateQueue.h>
+#include <private/media/AudioTimestampState.h>
 #include <private/media/StaticAudioTrackState.h>
 #include <media/AudioTimestamp.h>
 
@@ -23,6 +24,7 @@
 namespace android {
 
 template class SingleStateQueue<StaticAudioTrackState>; // typedef StaticAudioTrackSingleStateQueue
-template class SingleStateQueue<AudioTimestamp>;        // typedef AudioTimestampSingleStateQueue
+template class SingleStateQueue<AudioTimestamp>;
+template class SingleStateQueue<AudioTimestampState>;   // typedef AudioTimestampSingleStateQueue
 
 }
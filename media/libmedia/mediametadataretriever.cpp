@@ -140,6 +140,21 @@ sp<IMemory> MediaMetadataRetriever::getFrameAtTime(int64_t timeUs, int option)
     return mRetriever->getFrameAtTime(timeUs, option);
 }
 
+status_t MediaMetadataRetriever::getFramesAtTimes(
+        const Vector<int64_t> &timesUs, int option,
+        int32_t maxWidth, int32_t maxHeight,
+        Vector<sp<IMemory> > *frames)
+{
+    ALOGV("getFramesAtTimes: %zu times option(%d)", timesUs.size(), option);
+    Mutex::Autolock _l(mLock);
+    if (mRetriever == 0) {
+        ALOGE("retriever is not initialized");
+        return INVALID_OPERATION;
+    }
+    return mRetriever->getFramesAtTimes(
+            timesUs, option, maxWidth, maxHeight, frames);
+}
+
 const char* MediaMetadataRetriever::extractMetadata(int keyCode)
 {
     ALOGV("extractMetadata(%d)", keyCode);
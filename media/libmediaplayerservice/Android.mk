@@ -18,6 +18,7 @@ LOCAL_SRC_FILES:=               \
     MidiFile.cpp                \
     MidiMetadataRetriever.cpp   \
     RemoteDisplay.cpp           \
+    RenderLedger.cpp            \
     SharedLibrary.cpp           \
     StagefrightPlayer.cpp       \
     StagefrightRecorder.cpp     \
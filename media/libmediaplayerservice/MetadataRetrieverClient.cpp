@@ -76,6 +76,7 @@ void MetadataRetrieverClient::disconnect()
     Mutex::Autolock lock(mLock);
     mRetriever.clear();
     mThumbnail.clear();
+    mThumbnails.clear();
     mAlbumArt.clear();
     IPCThreadState::self()->flushCommands();
 }
@@ -205,20 +206,87 @@ sp<IMemory> MetadataRetrieverClient::getFrameAtTime(int64_t timeUs, int option)
         delete frame;
         return NULL;
     }
-    VideoFrame *frameCopy = static_cast<VideoFrame *>(mThumbnail->pointer());
-    frameCopy->mWidth = frame->mWidth;
-    frameCopy->mHeight = frame->mHeight;
-    frameCopy->mDisplayWidth = frame->mDisplayWidth;
-    frameCopy->mDisplayHeight = frame->mDisplayHeight;
-    frameCopy->mSize = frame->mSize;
-    frameCopy->mRotationAngle = frame->mRotationAngle;
-    ALOGV("rotation: %d", frameCopy->mRotationAngle);
-    frameCopy->mData = (uint8_t *)frameCopy + sizeof(VideoFrame);
-    memcpy(frameCopy->mData, frame->mData, frame->mSize);
+    copyVideoFrame(*frame, mThumbnail->pointer());
     delete frame;  // Fix memory leakage
     return mThumbnail;
 }
 
+// Lays |frame| out at |dst| followed by its data, the way clients of
+// getFrameAtTime() expect it.
+// static
+void MetadataRetrieverClient::copyVideoFrame(const VideoFrame &frame, void *dst)
+{
+    VideoFrame *frameCopy = static_cast<VideoFrame *>(dst);
+    frameCopy->mWidth = frame.mWidth;
+    frameCopy->mHeight = frame.mHeight;
+    frameCopy->mDisplayWidth = frame.mDisplayWidth;
+    frameCopy->mDisplayHeight = frame.mDisplayHeight;
+    frameCopy->mSize = frame.mSize;
+    frameCopy->mRotationAngle = frame.mRotationAngle;
+    ALOGV("rotation: %d", frameCopy->mRotationAngle);
+    frameCopy->mData = (uint8_t *)frameCopy + sizeof(VideoFrame);
+    memcpy(frameCopy->mData, frame.mData, frame.mSize);
+}
+
+status_t MetadataRetrieverClient::getFramesAtTimes(
+        const Vector<int64_t> &timesUs, int option,
+        int32_t maxWidth, int32_t maxHeight,
+        Vector<sp<IMemory> > *frames)
+{
+    ALOGV("getFramesAtTimes: %zu times option(%d) max %dx%d",
+            timesUs.size(), option, maxWidth, maxHeight);
+    Mutex::Autolock lock(mLock);
+    frames->clear();
+    mThumbnails.clear();
+    if (mRetriever == NULL) {
+        ALOGE("retriever is not initialized");
+        return INVALID_OPERATION;
+    }
+
+    size_t numTimes = timesUs.size();
+    VideoFrame **decoded = new VideoFrame *[numTimes];
+    status_t err = mRetriever->getFramesAtTimes(
+            timesUs.array(), numTimes, option, maxWidth, maxHeight, decoded);
+    if (err != OK) {
+        delete[] decoded;
+        return err;
+    }
+
+    // All frames share one heap, each starting 8-byte aligned.
+    size_t heapSize = 0;
+    for (size_t i = 0; i < numTimes; ++i) {
+        if (decoded[i] != NULL) {
+            heapSize += (sizeof(VideoFrame) + decoded[i]->mSize + 7) & ~7;
+        }
+    }
+
+    sp<MemoryHeapBase> heap;
+    if (heapSize > 0) {
+        heap = new MemoryHeapBase(heapSize, 0, "MetadataRetrieverClient");
+        if (heap->getHeapID() < 0) {
+            ALOGE("failed to create a heap of %zu bytes", heapSize);
+            heap.clear();
+        }
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < numTimes; ++i) {
+        sp<IMemory> thumbnail;
+        if (decoded[i] != NULL && heap != NULL) {
+            size_t size = sizeof(VideoFrame) + decoded[i]->mSize;
+            thumbnail = new MemoryBase(heap, offset, size);
+            copyVideoFrame(*decoded[i], thumbnail->pointer());
+            offset += (size + 7) & ~7;
+        }
+        delete decoded[i];
+        frames->push(thumbnail);
+    }
+    delete[] decoded;
+
+    mThumbnails = *frames;
+    return OK;
+}
+
 sp<IMemory> MetadataRetrieverClient::extractAlbumArt()
 {
     ALOGV("extractAlbumArt");
@@ -52,6 +52,10 @@ public:
     virtual sp<IMemory>             getFrameAtTime(int64_t timeUs, int option);
     virtual sp<IMemory>             extractAlbumArt();
     virtual const char*             extractMetadata(int keyCode);
+    virtual status_t                getFramesAtTimes(
+            const Vector<int64_t> &timesUs, int option,
+            int32_t maxWidth, int32_t maxHeight,
+            Vector<sp<IMemory> > *frames);
 
     virtual status_t                dump(int fd, const Vector<String16>& args) const;
 
@@ -68,6 +72,9 @@ private:
     // Keep the shared memory copy of album art and capture frame (for thumbnail)
     sp<IMemory>                            mAlbumArt;
     sp<IMemory>                            mThumbnail;
+    Vector<sp<IMemory> >                   mThumbnails;
+
+    static void copyVideoFrame(const VideoFrame &frame, void *dst);
 };
 
 }; // namespace android
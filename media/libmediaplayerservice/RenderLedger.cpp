@@ -0,0 +1,187 @@
+/*
+ * Copyright 2015, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "RenderLedger"
+#include <utils/Log.h>
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/foundation/AUtils.h>
+
+#include "RenderLedger.h"
+
+namespace android {
+
+// Frames further apart in media time than this are not taken to be consecutive.
+static const int64_t kMaxFrameGapUs = 1000000ll;
+
+// static
+const int64_t RenderLedger::kDriftBucketEdgesUs[kNumDriftBuckets - 1] = {
+    -40000, -20000, -10000, -5000, 5000, 10000, 20000, 40000,
+};
+
+static const char *kDropReasonNames[RenderLedger::kNumDropReasons] = {
+    "shown", "late", "flushed", "skipped",
+};
+
+RenderLedger::RenderLedger()
+    : mNumFrames(0),
+      mDriftSumUs(0),
+      mDriftMinUs(0),
+      mDriftMaxUs(0),
+      mNumJanks(0),
+      mHaveLastShown(false),
+      mLastShownMediaUs(-1),
+      mLastShownVsyncUs(-1) {
+    memset(mNumDropped, 0, sizeof(mNumDropped));
+    memset(mDriftBuckets, 0, sizeof(mDriftBuckets));
+    memset(mIntervalBuckets, 0, sizeof(mIntervalBuckets));
+}
+
+RenderLedger::~RenderLedger() {
+}
+
+void RenderLedger::record(const Frame &frame) {
+    Mutex::Autolock autoLock(mLock);
+
+    mRecentFrames[mNumFrames % kNumRecentFrames] = frame;
+    ++mNumFrames;
+    ++mNumDropped[frame.mDropReason];
+
+    if (frame.mDropReason != DROP_NONE || frame.mVsyncUs < 0) {
+        return;
+    }
+
+    int64_t driftUs = frame.mVsyncUs - frame.mIntendedUs;
+    size_t bucket = 0;
+    while (bucket < kNumDriftBuckets - 1 && driftUs >= kDriftBucketEdgesUs[bucket]) {
+        ++bucket;
+    }
+    ++mDriftBuckets[bucket];
+
+    size_t numShown = mNumDropped[DROP_NONE];
+    if (numShown == 1 || driftUs < mDriftMinUs) {
+        mDriftMinUs = driftUs;
+    }
+    if (numShown == 1 || driftUs > mDriftMaxUs) {
+        mDriftMaxUs = driftUs;
+    }
+    mDriftSumUs += driftUs;
+
+    // A frame is janky if it stays on screen a whole vsync longer or shorter
+    // than its media duration, so the 2-3 cadence of 24fps on 60Hz is not.
+    // Frames dropped in between count as drops, not as jank.
+    int64_t mediaDeltaUs = frame.mMediaTimeUs - mLastShownMediaUs;
+    if (mHaveLastShown && frame.mVsyncPeriodUs > 0
+            && mediaDeltaUs > 0 && mediaDeltaUs <= kMaxFrameGapUs) {
+        int64_t intervalUs = frame.mVsyncUs - mLastShownVsyncUs;
+        int64_t numVsyncs = divRound(intervalUs, frame.mVsyncPeriodUs);
+        if (numVsyncs < 0) {
+            numVsyncs = 0;
+        } else if (numVsyncs > kMaxIntervalVsyncs) {
+            numVsyncs = kMaxIntervalVsyncs;
+        }
+        ++mIntervalBuckets[numVsyncs];
+
+        if (abs(intervalUs - mediaDeltaUs) > frame.mVsyncPeriodUs) {
+            ++mNumJanks;
+        }
+    }
+
+    mHaveLastShown = true;
+    mLastShownMediaUs = frame.mMediaTimeUs;
+    mLastShownVsyncUs = frame.mVsyncUs;
+}
+
+void RenderLedger::restart() {
+    Mutex::Autolock autoLock(mLock);
+    mHaveLastShown = false;
+}
+
+void RenderLedger::dump(AString *out) const {
+    Mutex::Autolock autoLock(mLock);
+
+    size_t numShown = mNumDropped[DROP_NONE];
+    out->append(StringPrintf("  render ledger: %zu frames", mNumFrames));
+    for (size_t i = 0; i < kNumDropReasons; ++i) {
+        out->append(StringPrintf(", %zu %s", mNumDropped[i], kDropReasonNames[i]));
+    }
+    out->append(StringPrintf(", %zu janks\n", mNumJanks));
+
+    if (numShown > 0) {
+        out->append(StringPrintf(
+                "  a/v drift (ms): mean %.2f, min %.2f, max %.2f\n   ",
+                mDriftSumUs / 1E3 / numShown, mDriftMinUs / 1E3, mDriftMaxUs / 1E3));
+        for (size_t i = 0; i < kNumDriftBuckets; ++i) {
+            if (i == 0) {
+                out->append(StringPrintf(" <%" PRId64, kDriftBucketEdgesUs[0] / 1000));
+            } else if (i == kNumDriftBuckets - 1) {
+                out->append(StringPrintf(" >=%" PRId64, kDriftBucketEdgesUs[i - 1] / 1000));
+            } else {
+                out->append(StringPrintf(" [%" PRId64 ",%" PRId64 ")",
+                        kDriftBucketEdgesUs[i - 1] / 1000, kDriftBucketEdgesUs[i] / 1000));
+            }
+            out->append(StringPrintf(":%zu", mDriftBuckets[i]));
+        }
+        out->append("\n  shown for (vsyncs):");
+        for (size_t i = 0; i <= kMaxIntervalVsyncs; ++i) {
+            out->append(StringPrintf(" %zu%s:%zu",
+                    i, i == kMaxIntervalVsyncs ? "+" : "", mIntervalBuckets[i]));
+        }
+        out->append("\n");
+    }
+
+    size_t numRecent = mNumFrames < kNumRecentFrames ? mNumFrames : kNumRecentFrames;
+    if (numRecent == 0) {
+        return;
+    }
+
+    // Times are relative to when the media clock wants the frame shown, and
+    // vsync slots to the first shown frame listed.
+    out->append(StringPrintf("  last %zu frames:\n", numRecent));
+    out->append("    media(ms) sched(ms) release(ms) vsync(ms) slot  reason\n");
+    int64_t firstVsyncUs = -1;
+    for (size_t i = mNumFrames - numRecent; i < mNumFrames; ++i) {
+        const Frame &frame = mRecentFrames[i % kNumRecentFrames];
+        out->append(StringPrintf("    %9.2f", frame.mMediaTimeUs / 1E3));
+        if (frame.mIntendedUs < 0) {
+            out->append(StringPrintf(" %9s %11s %9s %4s", "-", "-", "-", "-"));
+        } else {
+            out->append(StringPrintf(" %9.2f %11.2f",
+                    (frame.mScheduledUs - frame.mIntendedUs) / 1E3,
+                    (frame.mReleaseUs - frame.mIntendedUs) / 1E3));
+            if (frame.mVsyncUs < 0) {
+                out->append(StringPrintf(" %9s %4s", "-", "-"));
+            } else {
+                if (firstVsyncUs < 0) {
+                    firstVsyncUs = frame.mVsyncUs;
+                }
+                out->append(StringPrintf(" %9.2f %4" PRId64,
+                        (frame.mVsyncUs - frame.mIntendedUs) / 1E3,
+                        frame.mVsyncPeriodUs > 0
+                            ? divRound(frame.mVsyncUs - firstVsyncUs, frame.mVsyncPeriodUs)
+                            : 0));
+            }
+        }
+        out->append(StringPrintf("  %s\n", kDropReasonNames[frame.mDropReason]));
+    }
+}
+
+}  // namespace android
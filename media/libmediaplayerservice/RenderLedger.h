@@ -0,0 +1,98 @@
+/*
+ * Copyright 2015, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RENDER_LEDGER_H_
+#define RENDER_LEDGER_H_
+
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+
+#include <media/stagefright/foundation/ABase.h>
+
+namespace android {
+
+struct AString;
+
+// Keeps the timing of the most recent video frames handed to the display,
+// and running histograms of how far each shown frame landed from the media
+// clock (A/V drift) and of the spacing between shown frames (jank).
+// All methods may be called from any thread.
+struct RenderLedger : public RefBase {
+    enum DropReason {
+        DROP_NONE,      // shown
+        DROP_LATE,      // released too late to be shown
+        DROP_FLUSH,     // discarded by a flush, e.g. on seek
+        DROP_CATCH_UP,  // skipped to bring live playback back to its latency
+        kNumDropReasons,
+    };
+
+    // All times are system time in microseconds, -1 if unknown.
+    struct Frame {
+        int64_t mMediaTimeUs;
+        int64_t mIntendedUs;     // when the media clock wants it on screen
+        int64_t mScheduledUs;    // vsync-aligned time the release was timed for
+        int64_t mReleaseUs;      // when it was handed back to the decoder
+        int64_t mVsyncUs;        // vsync it is shown at, -1 if dropped
+        int64_t mVsyncPeriodUs;
+        DropReason mDropReason;
+    };
+
+    RenderLedger();
+
+    void record(const Frame &frame);
+
+    // the next frame does not follow on from the last one shown, e.g. after
+    // a seek or a pause, so the gap between them is not counted as jank
+    void restart();
+
+    void dump(AString *out) const;
+
+    static const size_t kNumRecentFrames = 32;
+
+protected:
+    virtual ~RenderLedger();
+
+private:
+    enum {
+        kNumDriftBuckets = 9,
+        kMaxIntervalVsyncs = 6,  // last bucket holds this many and more
+    };
+    static const int64_t kDriftBucketEdgesUs[kNumDriftBuckets - 1];
+
+    mutable Mutex mLock;
+
+    Frame mRecentFrames[kNumRecentFrames];
+    size_t mNumFrames;           // ever recorded, mod kNumRecentFrames is next slot
+    size_t mNumDropped[kNumDropReasons];
+
+    size_t mDriftBuckets[kNumDriftBuckets];
+    int64_t mDriftSumUs;
+    int64_t mDriftMinUs;
+    int64_t mDriftMaxUs;
+
+    size_t mIntervalBuckets[kMaxIntervalVsyncs + 1];
+    size_t mNumJanks;
+
+    bool mHaveLastShown;
+    int64_t mLastShownMediaUs;
+    int64_t mLastShownVsyncUs;
+
+    DISALLOW_EVIL_CONSTRUCTORS(RenderLedger);
+};
+
+}  // namespace android
+
+#endif  // RENDER_LEDGER_H_
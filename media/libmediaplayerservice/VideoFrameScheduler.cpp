@@ -327,11 +327,16 @@ VideoFrameScheduler::VideoFrameScheduler()
     : mVsyncTime(0),
       mVsyncPeriod(0),
       mVsyncRefreshAt(0),
+      mFixedVsync(false),
       mLastVsyncTime(-1),
       mTimeCorrection(0) {
 }
 
 void VideoFrameScheduler::updateVsync() {
+    if (mFixedVsync) {
+        return;
+    }
+
     mVsyncRefreshAt = systemTime(SYSTEM_TIME_MONOTONIC) + kVsyncRefreshPeriod;
     mVsyncPeriod = 0;
     mVsyncTime = 0;
@@ -382,6 +387,24 @@ nsecs_t VideoFrameScheduler::getVsyncPeriod() {
     return kDefaultVsyncPeriod;
 }
 
+nsecs_t VideoFrameScheduler::getNextVsyncTime(nsecs_t time) {
+    if (mVsyncPeriod == 0) {
+        return time;
+    }
+
+    nsecs_t offset = (time - mVsyncTime) % mVsyncPeriod;
+    if (offset < 0) {
+        offset += mVsyncPeriod;
+    }
+    return offset == 0 ? time : time + mVsyncPeriod - offset;
+}
+
+void VideoFrameScheduler::setFixedVsync(nsecs_t vsyncTime, nsecs_t vsyncPeriod) {
+    mFixedVsync = true;
+    mVsyncTime = vsyncTime;
+    mVsyncPeriod = vsyncPeriod;
+}
+
 nsecs_t VideoFrameScheduler::schedule(nsecs_t renderTime) {
     nsecs_t origRenderTime = renderTime;
 
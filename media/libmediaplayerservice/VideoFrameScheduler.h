@@ -39,6 +39,12 @@ struct VideoFrameScheduler : public RefBase {
     // returns the vsync period for the main display
     nsecs_t getVsyncPeriod();
 
+    // returns the first vsync at or after time, or time if vsync is unknown
+    nsecs_t getNextVsyncTime(nsecs_t time);
+
+    // use the given vsync timing instead of the display's, e.g. to simulate
+    void setFixedVsync(nsecs_t vsyncTime, nsecs_t vsyncPeriod);
+
     void release();
 
     static const size_t kHistorySize = 8;
@@ -82,6 +88,7 @@ private:
     nsecs_t mVsyncTime;        // vsync timing from display
     nsecs_t mVsyncPeriod;
     nsecs_t mVsyncRefreshAt;   // next time to refresh timing info
+    bool mFixedVsync;          // vsync timing was set, never refresh it
 
     nsecs_t mLastVsyncTime;    // estimated vsync time for last frame
     nsecs_t mTimeCorrection;   // running adjustment
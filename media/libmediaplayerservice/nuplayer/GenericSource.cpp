@@ -71,7 +71,8 @@ mBitrate(-1ll),
 mPollBufferingGeneration(0),
 mPendingReadBufferTypes(0),
 mBuffering(false),
-mPrepareBuffering(false) {
+mPrepareBuffering(false),
+mVideoSyncFramesOnly(false) {
 resetDataSource();
 DataSource::RegisterDefaultSniffers();
 }
@@ -1493,6 +1494,13 @@ sp<ABuffer> NuPlayer::GenericSource::mediaBufferToABuffer(
     return ab;
 }
 
+status_t NuPlayer::GenericSource::setVideoSyncFramesOnly(bool syncFramesOnly) {
+    // Taken up by the next read, which may be on the way already.
+    Mutex::Autolock _l(mReadBufferLock);
+    mVideoSyncFramesOnly = syncFramesOnly;
+    return OK;
+}
+
 void NuPlayer::GenericSource::postReadBuffer(media_track_type trackType) {
     Mutex::Autolock _l(mReadBufferLock);
 
@@ -1571,6 +1579,13 @@ void NuPlayer::GenericSource::readBuffer(
         options.setNonBlocking();
     }
 
+    if (trackType == MEDIA_TRACK_TYPE_VIDEO) {
+        Mutex::Autolock _l(mReadBufferLock);
+        if (mVideoSyncFramesOnly) {
+            options.setSyncFramesOnly();
+        }
+    }
+
     for (size_t numBuffers = 0; numBuffers < maxBuffers; ) {
         MediaBuffer *mbuf;
         status_t err = track->mSource->read(&mbuf, &options);
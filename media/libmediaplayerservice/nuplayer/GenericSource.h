@@ -72,6 +72,8 @@ struct NuPlayer::GenericSource : public NuPlayer::Source {
 
     virtual status_t setBuffers(bool audio, Vector<MediaBuffer *> &buffers);
 
+    virtual status_t setVideoSyncFramesOnly(bool syncFramesOnly);
+
 protected:
     virtual ~GenericSource();
 
@@ -148,6 +150,7 @@ private:
     uint32_t mPendingReadBufferTypes;
     bool mBuffering;
     bool mPrepareBuffering;
+    bool mVideoSyncFramesOnly;  // protected by mReadBufferLock
     mutable Mutex mReadBufferLock;
 
     sp<ALooper> mLooper;
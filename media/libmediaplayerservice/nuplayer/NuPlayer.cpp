@@ -42,6 +42,7 @@
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaCodec.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/MetaData.h>
@@ -182,6 +183,7 @@ NuPlayer::NuPlayer()
       mScanSourcesPending(false),
       mScanSourcesGeneration(0),
       mPollDurationGeneration(0),
+      mPollLatencyGeneration(0),
       mTimedTextGeneration(0),
       mFlushingAudio(NONE),
       mFlushingVideo(NONE),
@@ -191,7 +193,10 @@ NuPlayer::NuPlayer()
       mBuffering(false),
       mPlaying(false),
       mPaused(false),
-      mPausedByClient(false) {
+      mPausedByClient(false),
+      mVideoSyncFramesOnly(false),
+      mLatencyTargetUs(0),
+      mLatencySpeedUpAudio(false) {
     clearFlushComplete();
     mPlayerExtendedStats = (PlayerExtendedStats *)ExtendedStats::Create(
             ExtendedStats::PLAYER, "NuPlayer", gettid());
@@ -328,6 +333,19 @@ void NuPlayer::setAudioSink(const sp<MediaPlayerBase::AudioSink> &sink) {
     msg->post();
 }
 
+void NuPlayer::setVideoSyncFramesOnly(bool syncFramesOnly) {
+    sp<AMessage> msg = new AMessage(kWhatSetVideoSyncFramesOnly, id());
+    msg->setInt32("syncFramesOnly", syncFramesOnly);
+    msg->post();
+}
+
+void NuPlayer::setLatencyTarget(int64_t targetUs, bool speedUpAudio) {
+    sp<AMessage> msg = new AMessage(kWhatSetLatencyTarget, id());
+    msg->setInt64("targetUs", targetUs);
+    msg->setInt32("speedUpAudio", speedUpAudio);
+    msg->post();
+}
+
 void NuPlayer::start() {
     PLAYER_STATS(notifyPlaying, true);
     (new AMessage(kWhatStart, id()))->post();
@@ -406,6 +424,9 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
             CHECK(msg->findObject("source", &obj));
             if (obj != NULL) {
                 mSource = static_cast<Source *>(obj.get());
+                if (mVideoSyncFramesOnly) {
+                    mSource->setVideoSyncFramesOnly(true);
+                }
             } else {
                 err = UNKNOWN_ERROR;
             }
@@ -559,6 +580,26 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatPollLatency:
+        {
+            int32_t generation;
+            CHECK(msg->findInt32("generation", &generation));
+
+            if (generation != mPollLatencyGeneration) {
+                // stale
+                break;
+            }
+
+            int64_t arrivalMediaUs, arrivalRealUs;
+            if (mSource != NULL && mRenderer != NULL
+                    && mSource->getLatestArrival(&arrivalMediaUs, &arrivalRealUs) == OK) {
+                mRenderer->updateLatency(arrivalMediaUs, arrivalRealUs);
+            }
+
+            msg->post(100000ll);  // poll again in 100 msecs.
+            break;
+        }
+
         case kWhatSetVideoNativeWindow:
         {
             ALOGV("kWhatSetVideoNativeWindow");
@@ -619,6 +660,44 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatSetVideoSyncFramesOnly:
+        {
+            int32_t syncFramesOnly;
+            CHECK(msg->findInt32("syncFramesOnly", &syncFramesOnly));
+
+            ALOGV("kWhatSetVideoSyncFramesOnly %d", syncFramesOnly);
+
+            mVideoSyncFramesOnly = syncFramesOnly;
+            if (mSource != NULL
+                    && mSource->setVideoSyncFramesOnly(syncFramesOnly) != OK) {
+                ALOGW("source cannot skip to video sync frames");
+            }
+            break;
+        }
+
+        case kWhatSetLatencyTarget:
+        {
+            int64_t targetUs;
+            int32_t speedUpAudio;
+            CHECK(msg->findInt64("targetUs", &targetUs));
+            CHECK(msg->findInt32("speedUpAudio", &speedUpAudio));
+
+            ALOGV("kWhatSetLatencyTarget %lld us, speed up audio %d",
+                    (long long)targetUs, speedUpAudio);
+
+            mLatencyTargetUs = targetUs > 0 ? targetUs : 0;
+            mLatencySpeedUpAudio = speedUpAudio;
+            if (mRenderer != NULL) {
+                mRenderer->setLatencyTarget(mLatencyTargetUs, mLatencySpeedUpAudio);
+
+                cancelPollLatency();
+                if (mLatencyTargetUs > 0) {
+                    schedulePollLatency();
+                }
+            }
+            break;
+        }
+
         case kWhatStart:
         {
             ALOGV("kWhatStart");
@@ -1106,6 +1185,26 @@ status_t NuPlayer::onInstantiateSecureDecoders() {
     return OK;
 }
 
+// Gets the decoders instantiated while the client gets around to start(), by
+// which time they are waiting idle in ACodec's component pool.
+void NuPlayer::prewarmDecoders() {
+    for (int i = 0; i < 2; ++i) {
+        bool audio = (i == 0);
+        if (!audio && (mSourceFlags & Source::FLAG_SECURE)) {
+            // Secure decoders are never kept idle.
+            continue;
+        }
+
+        sp<AMessage> format = mSource->getFormat(audio);
+        AString mime;
+        if (format == NULL || !format->findString("mime", &mime)) {
+            continue;
+        }
+
+        MediaCodec::PrewarmByType(mime.c_str());
+    }
+}
+
 void NuPlayer::onStart() {
     mOffloadAudio = false;
     mOffloadDecodedPCM = false;
@@ -1172,6 +1271,11 @@ void NuPlayer::onStart() {
         mRenderer->setVideoFrameRate(rate);
     }
 
+    if (mLatencyTargetUs > 0) {
+        mRenderer->setLatencyTarget(mLatencyTargetUs, mLatencySpeedUpAudio);
+        schedulePollLatency();
+    }
+
     if (mVideoDecoder != NULL) {
         mVideoDecoder->setRenderer(mRenderer);
     }
@@ -1636,6 +1740,35 @@ void NuPlayer::getStats(int64_t *numFramesTotal, int64_t *numFramesDropped) {
     }
 }
 
+status_t NuPlayer::getLatencyStats(Parcel *reply) {
+    sp<Renderer> renderer = mRenderer;
+    if (renderer == NULL) {
+        return NO_INIT;
+    }
+
+    Renderer::LatencyStats stats;
+    renderer->getLatencyStats(&stats);
+
+    reply->writeInt32((int32_t)(stats.mTargetUs / 1000));
+    reply->writeInt32((int32_t)(stats.mLatestUs / 1000));
+    reply->writeInt32((int32_t)(stats.mMinUs / 1000));
+    reply->writeInt32((int32_t)(stats.mMaxUs / 1000));
+    reply->writeInt32((int32_t)(stats.mMeanUs / 1000));
+    reply->writeInt32(stats.mNumSamples);
+    reply->writeInt32((int32_t)(stats.mStretchedUs / 1000));
+    reply->writeInt32(stats.mNumCatchUps);
+    reply->writeInt32(stats.mNumAudioDropped);
+    reply->writeInt32(stats.mNumVideoDropped);
+    return OK;
+}
+
+void NuPlayer::dumpRenderStats(AString *out) {
+    sp<Renderer> renderer = mRenderer;
+    if (renderer != NULL) {
+        renderer->dumpRenderStats(out);
+    }
+}
+
 sp<MetaData> NuPlayer::getFileMeta() {
     return mSource->getFileFormatMeta();
 }
@@ -1650,6 +1783,16 @@ void NuPlayer::cancelPollDuration() {
     ++mPollDurationGeneration;
 }
 
+void NuPlayer::schedulePollLatency() {
+    sp<AMessage> msg = new AMessage(kWhatPollLatency, id());
+    msg->setInt32("generation", mPollLatencyGeneration);
+    msg->post();
+}
+
+void NuPlayer::cancelPollLatency() {
+    ++mPollLatencyGeneration;
+}
+
 void NuPlayer::processDeferredActions() {
     while (!mDeferredActions.empty()) {
         // We won't execute any deferred actions until we're no longer in
@@ -1720,6 +1863,7 @@ void NuPlayer::performReset() {
     CHECK(mVideoDecoder == NULL);
 
     cancelPollDuration();
+    cancelPollLatency();
 
     ++mScanSourcesGeneration;
     mScanSourcesPending = false;
@@ -1859,6 +2003,8 @@ void NuPlayer::onSourceNotify(const sp<AMessage> &msg) {
                         new FlushDecoderAction(FLUSH_CMD_SHUTDOWN /* audio */,
                                                FLUSH_CMD_SHUTDOWN /* video */));
                 processDeferredActions();
+            } else {
+                prewarmDecoders();
             }
 
             sp<NuPlayerDriver> driver = mDriver.promote();
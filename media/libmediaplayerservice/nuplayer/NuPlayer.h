@@ -34,6 +34,7 @@ namespace android {
 
 struct ABuffer;
 struct AMessage;
+struct AString;
 struct MetaData;
 struct NuPlayerDriver;
 
@@ -71,11 +72,20 @@ struct NuPlayer : public AHandler {
     void seekToAsync(int64_t seekTimeUs, bool needNotify = false);
 
     status_t setVideoScalingMode(int32_t mode);
+
+    // Trick play: while set, the source hands out only the video sync
+    // frames, skipping the rest without reading them where it can.
+    void setVideoSyncFramesOnly(bool syncFramesOnly);
+
+    // Low-latency live playback, see KEY_PARAMETER_LATENCY_TARGET_MS.
+    void setLatencyTarget(int64_t targetUs, bool speedUpAudio);
+    status_t getLatencyStats(Parcel *reply);
     status_t getTrackInfo(Parcel* reply) const;
     status_t getSelectedTrack(int32_t type, Parcel* reply) const;
     status_t selectTrack(size_t trackIndex, bool select, int64_t timeUs);
     status_t getCurrentPosition(int64_t *mediaUs);
     void getStats(int64_t *mNumFramesTotal, int64_t *mNumFramesDropped);
+    void dumpRenderStats(AString *out);
 
     sp<MetaData> getFileMeta();
     int64_t getServerTimeoutUs();
@@ -128,6 +138,9 @@ private:
         kWhatGetTrackInfo               = 'gTrI',
         kWhatGetSelectedTrack           = 'gSel',
         kWhatSelectTrack                = 'selT',
+        kWhatSetVideoSyncFramesOnly     = '=Syn',
+        kWhatSetLatencyTarget           = '=Lat',
+        kWhatPollLatency                = 'polL',
     };
     sp<PlayerExtendedStats> mPlayerExtendedStats;
 
@@ -162,6 +175,7 @@ private:
     int32_t mScanSourcesGeneration;
 
     int32_t mPollDurationGeneration;
+    int32_t mPollLatencyGeneration;
     int32_t mTimedTextGeneration;
 
     enum FlushStatus {
@@ -202,6 +216,12 @@ private:
     // still become true, when we pause internally due to buffering.
     bool mPausedByClient;
 
+    bool mVideoSyncFramesOnly;
+
+    // 0 unless playing live with a target latency.
+    int64_t mLatencyTargetUs;
+    bool mLatencySpeedUpAudio;
+
     inline const sp<DecoderBase> &getDecoder(bool audio) {
         return audio ? mAudioDecoder : mVideoDecoder;
     }
@@ -219,6 +239,7 @@ private:
     status_t instantiateDecoder(bool audio, sp<DecoderBase> *decoder);
 
     status_t onInstantiateSecureDecoders();
+    void prewarmDecoders();
 
     void updateVideoSize(
             const sp<AMessage> &inputFormat,
@@ -244,6 +265,9 @@ private:
     void schedulePollDuration();
     void cancelPollDuration();
 
+    void schedulePollLatency();
+    void cancelPollLatency();
+
     void processDeferredActions();
 
     void performSeek(int64_t seekTimeUs, bool needNotify);
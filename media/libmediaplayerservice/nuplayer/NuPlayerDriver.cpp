@@ -26,6 +26,7 @@
 
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AString.h>
 #include <media/stagefright/foundation/AUtils.h>
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/Utils.h>
@@ -532,13 +533,41 @@ void NuPlayerDriver::setAudioSink(const sp<AudioSink> &audioSink) {
     mAudioSink = audioSink;
 }
 
-status_t NuPlayerDriver::setParameter(
-        int /* key */, const Parcel & /* request */) {
-    return INVALID_OPERATION;
+status_t NuPlayerDriver::setParameter(int key, const Parcel &request) {
+    switch (key) {
+        case KEY_PARAMETER_VIDEO_SYNC_FRAMES_ONLY:
+        {
+            mPlayer->setVideoSyncFramesOnly(request.readInt32() != 0);
+            return OK;
+        }
+
+        case KEY_PARAMETER_LATENCY_TARGET_MS:
+        {
+            int32_t targetMs = request.readInt32();
+            if (targetMs < 0) {
+                return BAD_VALUE;
+            }
+            bool speedUpAudio = false;
+            if (request.dataAvail() >= sizeof(int32_t)) {
+                speedUpAudio = request.readInt32() != 0;
+            }
+            mPlayer->setLatencyTarget(targetMs * 1000ll, speedUpAudio);
+            return OK;
+        }
+
+        default:
+            return INVALID_OPERATION;
+    }
 }
 
-status_t NuPlayerDriver::getParameter(int /* key */, Parcel * /* reply */) {
-    return INVALID_OPERATION;
+status_t NuPlayerDriver::getParameter(int key, Parcel *reply) {
+    switch (key) {
+        case KEY_PARAMETER_LATENCY_STATS:
+            return mPlayer->getLatencyStats(reply);
+
+        default:
+            return INVALID_OPERATION;
+    }
 }
 
 status_t NuPlayerDriver::getMetadata(
@@ -636,6 +665,10 @@ status_t NuPlayerDriver::dump(
                  numFramesTotal == 0
                     ? 0.0 : (double)numFramesDropped / numFramesTotal);
 
+    AString renderStats;
+    mPlayer->dumpRenderStats(&renderStats);
+    fprintf(out, "%s", renderStats.c_str());
+
     fclose(out);
     out = NULL;
 
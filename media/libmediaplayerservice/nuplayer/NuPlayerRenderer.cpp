@@ -29,6 +29,7 @@
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/Utils.h>
 
+#include <RenderLedger.h>
 #include <VideoFrameScheduler.h>
 
 #include <inttypes.h>
@@ -40,6 +41,18 @@ namespace android {
 // is closed to allow the audio DSP to power down.
 static const int64_t kOffloadPauseMaxUs = 10000000ll;
 
+// Low-latency mode: further behind the target than kMinCatchUpExcessUs,
+// playback skips ahead. If the client allows audio to be sped up, above the
+// target by more than kStretchAboveUs audio is played kStretchRatePermille
+// fast until back at the target instead, and playback only skips ahead when
+// further behind than kMaxStretchExcessUs. Readings above kMaxLatencyUs are
+// taken to be a jump in the stream's timestamps rather than a backlog.
+static const int64_t kStretchAboveUs = 40000ll;
+static const int32_t kStretchRatePermille = 1050;
+static const int64_t kMaxStretchExcessUs = 500000ll;
+static const int64_t kMinCatchUpExcessUs = 100000ll;
+static const int64_t kMaxLatencyUs = 10000000ll;
+
 // static
 const NuPlayer::Renderer::PcmInfo NuPlayer::Renderer::AUDIO_PCMINFO_INITIALIZER = {
         AUDIO_CHANNEL_NONE,
@@ -60,6 +73,7 @@ NuPlayer::Renderer::Renderer(
       mNotify(notify),
       mFlags(flags),
       mNumFramesWritten(0),
+      mRenderLedger(new RenderLedger),
       mDrainAudioQueuePending(false),
       mDrainVideoQueuePending(false),
       mAudioQueueGeneration(0),
@@ -90,7 +104,16 @@ NuPlayer::Renderer::Renderer(
       mCurrentPcmInfo(AUDIO_PCMINFO_INITIALIZER),
       mTotalBuffersQueued(0),
       mLastAudioBufferDrained(0),
-      mWakeLock(new AWakeLock()) {
+      mWakeLock(new AWakeLock()),
+      mLatencyTargetUs(0),
+      mCatchUpMediaUs(-1),
+      mAudioStretched(false),
+      mAudioStretchUnsupported(false),
+      mAudioStretchStartedUs(-1),
+      mAudioSpeedUpAllowed(false),
+      mPlaybackRatePermille(1000),
+      mLatencySumUs(0) {
+    memset(&mLatencyStats, 0, sizeof(mLatencyStats));
 
     notify->findObject(MEDIA_EXTENDED_STATS, (sp<RefBase>*)&mPlayerExtendedStats);
 }
@@ -182,6 +205,46 @@ void NuPlayer::Renderer::setVideoFrameRate(float fps) {
     msg->post();
 }
 
+void NuPlayer::Renderer::dumpRenderStats(AString *out) {
+    mRenderLedger->dump(out);
+
+    LatencyStats stats;
+    getLatencyStats(&stats);
+    if (stats.mTargetUs <= 0) {
+        return;
+    }
+    out->append(StringPrintf(
+            "  latency (ms): target %.1f, latest %.1f, min %.1f, max %.1f, mean %.1f"
+            " over %d samples\n",
+            stats.mTargetUs / 1E3, stats.mLatestUs / 1E3, stats.mMinUs / 1E3,
+            stats.mMaxUs / 1E3, stats.mMeanUs / 1E3, stats.mNumSamples));
+    out->append(StringPrintf(
+            "  catch-up: audio sped up for %.1f s, %d skips ahead,"
+            " %d audio buffers and %d video frames skipped\n",
+            stats.mStretchedUs / 1E6, stats.mNumCatchUps,
+            stats.mNumAudioDropped, stats.mNumVideoDropped));
+}
+
+void NuPlayer::Renderer::setLatencyTarget(int64_t targetUs, bool speedUpAudio) {
+    sp<AMessage> msg = new AMessage(kWhatSetLatencyTarget, id());
+    msg->setInt64("targetUs", targetUs);
+    msg->setInt32("speedUpAudio", speedUpAudio);
+    msg->post();
+}
+
+void NuPlayer::Renderer::updateLatency(int64_t arrivalMediaUs, int64_t arrivalRealUs) {
+    sp<AMessage> msg = new AMessage(kWhatUpdateLatency, id());
+    msg->setInt64("mediaUs", arrivalMediaUs);
+    msg->setInt64("realUs", arrivalRealUs);
+    msg->post();
+}
+
+void NuPlayer::Renderer::getLatencyStats(LatencyStats *stats) {
+    Mutex::Autolock autoLock(mLatencyLock);
+    *stats = mLatencyStats;
+    stats->mMeanUs = stats->mNumSamples > 0 ? mLatencySumUs / stats->mNumSamples : 0;
+}
+
 // Called on any threads, except renderer's thread.
 status_t NuPlayer::Renderer::getCurrentPosition(int64_t *mediaUs) {
     {
@@ -234,12 +297,15 @@ status_t NuPlayer::Renderer::getCurrentPositionFromAnchor(
         return NO_INIT;
     }
 
-    int64_t positionUs = (nowUs - mAnchorTimeRealUs) + mAnchorTimeMediaUs;
+    int64_t elapsedUs = nowUs - mAnchorTimeRealUs;
 
     if (mPauseStartedTimeRealUs != -1) {
-        positionUs -= (nowUs - mPauseStartedTimeRealUs);
+        elapsedUs -= (nowUs - mPauseStartedTimeRealUs);
     }
 
+    // media time advances at the playback rate since the anchor was set
+    int64_t positionUs = mAnchorTimeMediaUs + elapsedUs * mPlaybackRatePermille / 1000;
+
     // limit position to the last queued media time (for video only stream
     // position will be discrete as we don't know how long each frame lasts)
     if (mAnchorMaxMediaUs >= 0 && !allowPastQueuedVideo) {
@@ -288,6 +354,11 @@ void NuPlayer::Renderer::setAnchorTime(
     }
 }
 
+int32_t NuPlayer::Renderer::getPlaybackRatePermille() {
+    Mutex::Autolock autoLock(mTimeLock);
+    return mPlaybackRatePermille;
+}
+
 void NuPlayer::Renderer::setVideoLateByUs(int64_t lateUs) {
     Mutex::Autolock autoLock(mTimeLock);
     mVideoLateByUs = lateUs;
@@ -409,8 +480,8 @@ void NuPlayer::Renderer::onMessageReceived(const sp<AMessage> &msg) {
                 // This is how long the audio sink will have data to
                 // play back.
                 int64_t delayUs =
-                    mAudioSink->msecsPerFrame()
-                        * numFramesPendingPlayout * 1000ll;
+                    getAudioMediaDurationUs(numFramesPendingPlayout, mPlaybackRatePermille)
+                        * 1000 / mPlaybackRatePermille;
 
                 // Let's give it more data after about half that time
                 // has elapsed.
@@ -513,6 +584,25 @@ void NuPlayer::Renderer::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatSetLatencyTarget:
+        {
+            int64_t targetUs;
+            int32_t speedUpAudio;
+            CHECK(msg->findInt64("targetUs", &targetUs));
+            CHECK(msg->findInt32("speedUpAudio", &speedUpAudio));
+            onSetLatencyTarget(targetUs, speedUpAudio);
+            break;
+        }
+
+        case kWhatUpdateLatency:
+        {
+            int64_t arrivalMediaUs, arrivalRealUs;
+            CHECK(msg->findInt64("mediaUs", &arrivalMediaUs));
+            CHECK(msg->findInt64("realUs", &arrivalRealUs));
+            onUpdateLatency(arrivalMediaUs, arrivalRealUs);
+            break;
+        }
+
         case kWhatAudioOffloadTearDown:
         {
             onAudioOffloadTearDown(kDueToError);
@@ -624,6 +714,17 @@ size_t NuPlayer::Renderer::fillAudioBuffer(void *buffer, size_t size) {
             break;
         }
 
+        int64_t entryTimeUs;
+        if (entry->mOffset == 0
+                && entry->mBuffer->meta()->findInt64("timeUs", &entryTimeUs)
+                && isBeforeCatchUp(entryTimeUs)) {
+            entry->mNotifyConsumed->post();
+            mAudioQueue.erase(mAudioQueue.begin());
+            entry = NULL;
+            countCatchUpDrop(true /* audio */);
+            continue;
+        }
+
         if (firstEntry && entry->mOffset == 0) {
             firstEntry = false;
             int64_t mediaTimeUs;
@@ -718,6 +819,14 @@ bool NuPlayer::Renderer::onDrainAudioQueue() {
             int32_t eos = 0;
             int32_t bufferSize = 0;
             CHECK(entry->mBuffer->meta()->findInt64("timeUs", &mediaTimeUs));
+            if (isBeforeCatchUp(mediaTimeUs)) {
+                entry->mNotifyConsumed->post();
+                mAudioQueue.erase(mAudioQueue.begin());
+                entry = NULL;
+                countCatchUpDrop(true /* audio */);
+                continue;
+            }
+
             entry->mBuffer->meta()->findInt32("eos", &eos);
             bufferSize = entry->mBuffer->size();
             // Do not update mediaTime if the buffer is empty and EOS buffer
@@ -776,16 +885,26 @@ bool NuPlayer::Renderer::onDrainAudioQueue() {
     }
     mAnchorMaxMediaUs =
         mAnchorTimeMediaUs +
-                (int64_t)(max((long long)mNumFramesWritten - mAnchorNumFramesWritten, 0LL)
-                        * 1000LL * mAudioSink->msecsPerFrame());
+                getAudioMediaDurationUs(
+                        max((long long)mNumFramesWritten - mAnchorNumFramesWritten, 0LL),
+                        mPlaybackRatePermille);
 
     return !mAudioQueue.empty();
 }
 
+// Real time until the audio written so far has played out.
 int64_t NuPlayer::Renderer::getPendingAudioPlayoutDurationUs(int64_t nowUs) {
     int64_t writtenAudioDurationUs =
-        mNumFramesWritten * 1000LL * mAudioSink->msecsPerFrame();
-    return writtenAudioDurationUs - getPlayedOutAudioDurationUs(nowUs);
+        getAudioMediaDurationUs(mNumFramesWritten, mPlaybackRatePermille);
+    return (writtenAudioDurationUs - getPlayedOutAudioDurationUs(nowUs))
+            * 1000 / mPlaybackRatePermille;
+}
+
+// Media time of numFrames. The sink's msecsPerFrame() is scaled by its
+// playback rate.
+int64_t NuPlayer::Renderer::getAudioMediaDurationUs(
+        int64_t numFrames, int32_t ratePermille) {
+    return (int64_t)(numFrames * 1000LL * mAudioSink->msecsPerFrame()) * 1000 / ratePermille;
 }
 
 int64_t NuPlayer::Renderer::getRealTimeUs(int64_t mediaTimeUs, int64_t nowUs) {
@@ -796,7 +915,7 @@ int64_t NuPlayer::Renderer::getRealTimeUs(int64_t mediaTimeUs, int64_t nowUs) {
         // play out video immediately without delay.
         return nowUs;
     }
-    return (mediaTimeUs - currentPositionUs) + nowUs;
+    return (mediaTimeUs - currentPositionUs) * 1000 / mPlaybackRatePermille + nowUs;
 }
 
 void NuPlayer::Renderer::onNewAudioMediaTime(int64_t mediaTimeUs) {
@@ -837,6 +956,16 @@ void NuPlayer::Renderer::postDrainVideoQueue_l() {
     int64_t delayUs;
     int64_t nowUs = ALooper::GetNowUs();
     int64_t realTimeUs;
+
+    int64_t headTimeUs;
+    if (!mPaused && entry.mBuffer->meta()->findInt64("timeUs", &headTimeUs)
+            && isBeforeCatchUp(headTimeUs)) {
+        // skipped without waiting, and without becoming the anchor
+        msg->post();
+        mDrainVideoQueuePending = true;
+        return;
+    }
+
     if (mFlags & FLAG_REAL_TIME) {
         int64_t mediaTimeUs;
         CHECK(entry.mBuffer->meta()->findInt64("timeUs", &mediaTimeUs));
@@ -878,6 +1007,7 @@ void NuPlayer::Renderer::postDrainVideoQueue_l() {
     }
 
     realTimeUs = mVideoScheduler->schedule(realTimeUs * 1000) / 1000;
+    entry.mScheduledRenderUs = realTimeUs;
     int64_t twoVsyncsUs = 2 * (mVideoScheduler->getVsyncPeriod() / 1000);
 
     delayUs = realTimeUs - nowUs;
@@ -913,6 +1043,7 @@ void NuPlayer::Renderer::onDrainVideoQueue() {
     int64_t mediaTimeUs;
     if (mFlags & FLAG_REAL_TIME) {
         CHECK(entry->mBuffer->meta()->findInt64("timeUs", &realTimeUs));
+        mediaTimeUs = realTimeUs;
     } else {
         CHECK(entry->mBuffer->meta()->findInt64("timeUs", &mediaTimeUs));
 
@@ -920,6 +1051,30 @@ void NuPlayer::Renderer::onDrainVideoQueue() {
         realTimeUs = getRealTimeUs(mediaTimeUs, nowUs);
     }
 
+    if (!mPaused && isBeforeCatchUp(mediaTimeUs)) {
+        if (nowUs == -1) {
+            nowUs = ALooper::GetNowUs();
+        }
+        RenderLedger::Frame frame;
+        frame.mMediaTimeUs = mediaTimeUs;
+        frame.mIntendedUs = realTimeUs;
+        frame.mScheduledUs = entry->mScheduledRenderUs;
+        frame.mReleaseUs = nowUs;
+        frame.mVsyncUs = -1;
+        frame.mVsyncPeriodUs = mVideoScheduler->getVsyncPeriod() / 1000;
+        frame.mDropReason = RenderLedger::DROP_CATCH_UP;
+        mRenderLedger->record(frame);
+
+        entry->mNotifyConsumed->setInt32("render", 0);
+        entry->mNotifyConsumed->post();
+        mVideoQueue.erase(mVideoQueue.begin());
+        entry = NULL;
+
+        countCatchUpDrop(false /* audio */);
+        PLAYER_STATS(logFrameDropped);
+        return;
+    }
+
     bool tooLate = false;
 
     if (!mPaused) {
@@ -946,6 +1101,10 @@ void NuPlayer::Renderer::onDrainVideoQueue() {
         }
     }
 
+    if (!mPaused) {
+        recordVideoFrame(*entry, mediaTimeUs, realTimeUs, nowUs, tooLate);
+    }
+
     entry->mNotifyConsumed->setInt64("timestampNs", realTimeUs * 1000ll);
     entry->mNotifyConsumed->setInt32("render", !tooLate);
     entry->mNotifyConsumed->post();
@@ -969,6 +1128,28 @@ void NuPlayer::Renderer::onDrainVideoQueue() {
     }
 }
 
+void NuPlayer::Renderer::recordVideoFrame(
+        const QueueEntry &entry, int64_t mediaTimeUs, int64_t realTimeUs,
+        int64_t nowUs, bool tooLate) {
+    RenderLedger::Frame frame;
+    frame.mMediaTimeUs = mediaTimeUs;
+    frame.mIntendedUs = realTimeUs;
+    frame.mScheduledUs = entry.mScheduledRenderUs;
+    frame.mReleaseUs = nowUs;
+    frame.mVsyncPeriodUs = mVideoScheduler->getVsyncPeriod() / 1000;
+    if (tooLate) {
+        frame.mVsyncUs = -1;
+        frame.mDropReason = RenderLedger::DROP_LATE;
+    } else {
+        // the buffer goes on screen at the first vsync that is after both
+        // its timestamp and its release
+        frame.mVsyncUs = mVideoScheduler->getNextVsyncTime(
+                max(realTimeUs, nowUs) * 1000ll) / 1000;
+        frame.mDropReason = RenderLedger::DROP_NONE;
+    }
+    mRenderLedger->record(frame);
+}
+
 void NuPlayer::Renderer::notifyVideoRenderingStart() {
     sp<AMessage> notify = mNotify->dup();
     notify->setInt32("what", kWhatVideoRenderingStart);
@@ -1016,6 +1197,7 @@ void NuPlayer::Renderer::onQueueBuffer(const sp<AMessage> &msg) {
     entry.mOffset = 0;
     entry.mFinalResult = OK;
     entry.mBufferOrdinal = ++mTotalBuffersQueued;
+    entry.mScheduledRenderUs = -1;
 
     Mutex::Autolock autoLock(mLock);
     if (audio) {
@@ -1026,6 +1208,13 @@ void NuPlayer::Renderer::onQueueBuffer(const sp<AMessage> &msg) {
         postDrainVideoQueue_l();
     }
 
+    // In low-latency mode no queue may hold more than the target, the one
+    // driving the clock skips ahead when it does.
+    if (mLatencyTargetUs > 0 && !mSyncQueues && !mPaused
+            && (audio || !mHasAudio)) {
+        limitQueueSpan_l(audio ? mAudioQueue : mVideoQueue);
+    }
+
     if (!mSyncQueues || mAudioQueue.empty() || mVideoQueue.empty()) {
         return;
     }
@@ -1139,6 +1328,7 @@ void NuPlayer::Renderer::onFlush(const sp<AMessage> &msg) {
          syncQueuesDone_l();
          setPauseStartedTimeRealUs(-1);
          setAnchorTime(-1, -1);
+         mCatchUpMediaUs = -1;
     }
 
     ALOGV("flushing %s", audio ? "audio" : "video");
@@ -1156,6 +1346,7 @@ void NuPlayer::Renderer::onFlush(const sp<AMessage> &msg) {
         }
 
         mDrainAudioQueuePending = false;
+        setAudioStretch(false);
 
         if (offloadingAudio()) {
             mAudioSink->pause();
@@ -1171,6 +1362,7 @@ void NuPlayer::Renderer::onFlush(const sp<AMessage> &msg) {
         if (mVideoScheduler != NULL) {
             mVideoScheduler->restart();
         }
+        mRenderLedger->restart();
 
         prepareForMediaRenderingStart();
     }
@@ -1188,6 +1380,20 @@ void NuPlayer::Renderer::flushQueue(List<QueueEntry> *queue) {
 
         if (entry->mBuffer != NULL) {
             entry->mNotifyConsumed->post();
+
+            int64_t mediaTimeUs;
+            if (queue == &mVideoQueue
+                    && entry->mBuffer->meta()->findInt64("timeUs", &mediaTimeUs)) {
+                RenderLedger::Frame frame;
+                frame.mMediaTimeUs = mediaTimeUs;
+                frame.mIntendedUs = -1;
+                frame.mScheduledUs = -1;
+                frame.mReleaseUs = -1;
+                frame.mVsyncUs = -1;
+                frame.mVsyncPeriodUs = -1;
+                frame.mDropReason = RenderLedger::DROP_FLUSH;
+                mRenderLedger->record(frame);
+            }
         }
 
         queue->erase(queue->begin());
@@ -1278,6 +1484,8 @@ void NuPlayer::Renderer::onPause() {
         mPaused = true;
         setPauseStartedTimeRealUs(ALooper::GetNowUs());
     }
+    mRenderLedger->restart();
+    setAudioStretch(false);
 
     mDrainAudioQueuePending = false;
     mDrainVideoQueuePending = false;
@@ -1329,6 +1537,167 @@ void NuPlayer::Renderer::onSetVideoFrameRate(float fps) {
     mVideoScheduler->init(fps);
 }
 
+void NuPlayer::Renderer::onSetLatencyTarget(int64_t targetUs, bool speedUpAudio) {
+    if (targetUs < 0) {
+        targetUs = 0;
+    }
+    mLatencyTargetUs = targetUs;
+    if (targetUs == 0 || !speedUpAudio) {
+        setAudioStretch(false);
+    }
+    mAudioSpeedUpAllowed = speedUpAudio;
+    if (targetUs == 0) {
+        Mutex::Autolock autoLock(mLock);
+        mCatchUpMediaUs = -1;
+    }
+
+    Mutex::Autolock autoLock(mLatencyLock);
+    mLatencyStats.mTargetUs = targetUs;
+}
+
+void NuPlayer::Renderer::onUpdateLatency(int64_t arrivalMediaUs, int64_t arrivalRealUs) {
+    if (mLatencyTargetUs <= 0 || (mFlags & FLAG_REAL_TIME) || mPaused) {
+        return;
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+    int64_t positionUs;
+    if (getCurrentPositionOnLooper(&positionUs, nowUs) != OK) {
+        return;
+    }
+
+    // how long ago the data now being presented arrived
+    int64_t latencyUs = (nowUs - arrivalRealUs) + (arrivalMediaUs - positionUs);
+    if (latencyUs < 0 || latencyUs > kMaxLatencyUs) {
+        ALOGV("ignoring latency of %.2f secs", latencyUs / 1E6);
+        return;
+    }
+
+    {
+        Mutex::Autolock autoLock(mLatencyLock);
+        if (mLatencyStats.mNumSamples == 0 || latencyUs < mLatencyStats.mMinUs) {
+            mLatencyStats.mMinUs = latencyUs;
+        }
+        if (mLatencyStats.mNumSamples == 0 || latencyUs > mLatencyStats.mMaxUs) {
+            mLatencyStats.mMaxUs = latencyUs;
+        }
+        mLatencyStats.mLatestUs = latencyUs;
+        ++mLatencyStats.mNumSamples;
+        mLatencySumUs += latencyUs;
+
+        if (mAudioStretched) {
+            mLatencyStats.mStretchedUs += nowUs - mAudioStretchStartedUs;
+            mAudioStretchStartedUs = nowUs;
+        }
+    }
+
+    int64_t excessUs = latencyUs - mLatencyTargetUs;
+    bool canStretch = canStretchAudio();
+    if (excessUs > (canStretch ? kMaxStretchExcessUs : kMinCatchUpExcessUs)) {
+        // let the last skip take effect before judging it
+        if (!isBeforeCatchUp(positionUs)) {
+            Mutex::Autolock autoLock(mLock);
+            catchUpTo_l(positionUs + excessUs);
+        }
+    } else if (excessUs > kStretchAboveUs && canStretch) {
+        setAudioStretch(true);
+    } else if (excessUs <= 0) {
+        setAudioStretch(false);
+    }
+}
+
+bool NuPlayer::Renderer::canStretchAudio() const {
+    return mAudioSpeedUpAllowed && mHasAudio && !offloadingAudio()
+            && !mAudioStretchUnsupported;
+}
+
+// There is no time-stretching in the audio path, so this resamples through
+// the sink's playback rate, raising the pitch by the same few percent. That
+// is why it is only done when the client asks for it.
+void NuPlayer::Renderer::setAudioStretch(bool stretch) {
+    if (stretch == mAudioStretched || (stretch && !canStretchAudio())) {
+        return;
+    }
+
+    int32_t ratePermille = stretch ? kStretchRatePermille : 1000;
+    status_t err = mAudioSink->setPlaybackRatePermille(ratePermille);
+    if (err != OK && stretch) {
+        ALOGW("cannot speed up audio to catch up (err %d)", err);
+        mAudioStretchUnsupported = (err == INVALID_OPERATION);
+        return;
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+    {
+        // Move the anchor to now, or to the pause, so that only the time
+        // from here on is extrapolated at the new rate.
+        Mutex::Autolock autoLock(mTimeLock);
+        if (mAnchorTimeMediaUs >= 0) {
+            int64_t realUs =
+                mPauseStartedTimeRealUs != -1 ? mPauseStartedTimeRealUs : nowUs;
+            mAnchorTimeMediaUs +=
+                (realUs - mAnchorTimeRealUs) * mPlaybackRatePermille / 1000;
+            mAnchorTimeRealUs = realUs;
+        }
+        mPlaybackRatePermille = ratePermille;
+    }
+
+    Mutex::Autolock autoLock(mLatencyLock);
+    if (stretch) {
+        mAudioStretchStartedUs = nowUs;
+    } else {
+        mLatencyStats.mStretchedUs += nowUs - mAudioStretchStartedUs;
+    }
+    mAudioStretched = stretch;
+}
+
+void NuPlayer::Renderer::catchUpTo_l(int64_t mediaUs) {
+    if (mediaUs <= mCatchUpMediaUs) {
+        return;
+    }
+
+    ALOGI("catching up live playback to %.2f secs", mediaUs / 1E6);
+    mCatchUpMediaUs = mediaUs;
+    if (!mHasAudio) {
+        // Video alone drives the clock, restart it at the first frame kept.
+        setAnchorTime(-1, -1);
+    }
+    postDrainVideoQueue_l();
+
+    Mutex::Autolock autoLock(mLatencyLock);
+    ++mLatencyStats.mNumCatchUps;
+}
+
+void NuPlayer::Renderer::limitQueueSpan_l(const List<QueueEntry> &queue) {
+    if (queue.empty()) {
+        return;
+    }
+    List<QueueEntry>::const_iterator last = queue.end();
+    --last;
+    if (queue.begin()->mBuffer == NULL || last->mBuffer == NULL) {
+        return;
+    }
+
+    int64_t firstTimeUs, lastTimeUs;
+    if (!queue.begin()->mBuffer->meta()->findInt64("timeUs", &firstTimeUs)
+            || !last->mBuffer->meta()->findInt64("timeUs", &lastTimeUs)) {
+        return;
+    }
+
+    if (lastTimeUs - firstTimeUs > mLatencyTargetUs) {
+        catchUpTo_l(lastTimeUs - mLatencyTargetUs);
+    }
+}
+
+void NuPlayer::Renderer::countCatchUpDrop(bool audio) {
+    Mutex::Autolock autoLock(mLatencyLock);
+    if (audio) {
+        ++mLatencyStats.mNumAudioDropped;
+    } else {
+        ++mLatencyStats.mNumVideoDropped;
+    }
+}
+
 // TODO: Remove unnecessary calls to getPlayedOutAudioDurationUs()
 // as it acquires locks and may query the audio driver.
 //
@@ -1375,8 +1744,10 @@ int64_t NuPlayer::Renderer::getPlayedOutAudioDurationUs(int64_t nowUs) {
 
     // TODO: remove the (int32_t) casting below as it may overflow at 12.4 hours.
     //CHECK_EQ(numFramesPlayed & (1 << 31), 0);  // can't be negative until 12.4 hrs, test
-    int64_t durationUs = (int64_t)((int32_t)numFramesPlayed * 1000LL * mAudioSink->msecsPerFrame())
-            + nowUs - numFramesPlayedAt;
+    // Media time advances at the playback rate since the frames were counted.
+    int32_t ratePermille = getPlaybackRatePermille();
+    int64_t durationUs = getAudioMediaDurationUs((int32_t)numFramesPlayed, ratePermille)
+            + (nowUs - numFramesPlayedAt) * ratePermille / 1000;
     if (durationUs < 0) {
         // Occurs when numFramesPlayed position is very small and the following:
         // (1) In case 1, the time nowUs is computed before getTimestamp() is called and
@@ -1599,6 +1970,8 @@ status_t NuPlayer::Renderer::onOpenAudioSink(
 }
 
 void NuPlayer::Renderer::onCloseAudioSink() {
+    // the sink keeps its rate across reopening
+    setAudioStretch(false);
     mAudioSink->close();
     mCurrentOffloadInfo = AUDIO_INFO_INITIALIZER;
     mCurrentPcmInfo = AUDIO_PCMINFO_INITIALIZER;
@@ -24,6 +24,7 @@ namespace android {
 
 struct ABuffer;
 class  AWakeLock;
+struct RenderLedger;
 struct VideoFrameScheduler;
 
 struct NuPlayer::Renderer : public AHandler {
@@ -61,6 +62,33 @@ struct NuPlayer::Renderer : public AHandler {
 
     void setVideoFrameRate(float fps);
 
+    // Appends the render timing of recent video frames, safe on any thread.
+    void dumpRenderStats(AString *out);
+
+    // Low-latency live playback: keeps the time from data arriving at the
+    // source to it being presented near targetUs by skipping ahead, and by
+    // speeding up audio a little, raising its pitch, if speedUpAudio. 0 turns
+    // it off. Ignored with FLAG_REAL_TIME.
+    void setLatencyTarget(int64_t targetUs, bool speedUpAudio);
+
+    // The newest media time the source has received, and when it did.
+    void updateLatency(int64_t arrivalMediaUs, int64_t arrivalRealUs);
+
+    struct LatencyStats {
+        int64_t mTargetUs;
+        int64_t mLatestUs;
+        int64_t mMinUs;
+        int64_t mMaxUs;
+        int64_t mMeanUs;
+        int32_t mNumSamples;
+        int64_t mStretchedUs;      // time spent with audio sped up
+        int32_t mNumCatchUps;
+        int32_t mNumAudioDropped;  // buffers skipped to catch up
+        int32_t mNumVideoDropped;  // frames skipped to catch up
+    };
+    // Safe on any thread.
+    void getLatencyStats(LatencyStats *stats);
+
     // Following setters and getters are protected by mTimeLock.
     status_t getCurrentPosition(int64_t *mediaUs);
     void setHasMedia(bool audio);
@@ -118,6 +146,8 @@ private:
         kWhatDisableOffloadAudio = 'noOA',
         kWhatEnableOffloadAudio  = 'enOA',
         kWhatSetVideoFrameRate   = 'sVFR',
+        kWhatSetLatencyTarget    = 'sLaT',
+        kWhatUpdateLatency       = 'upLa',
     };
 
     struct QueueEntry {
@@ -126,6 +156,7 @@ private:
         size_t mOffset;
         status_t mFinalResult;
         int32_t mBufferOrdinal;
+        int64_t mScheduledRenderUs;  // vsync-aligned, -1 until drain is posted
     };
 
     static const int64_t kMinPositionUpdateDelayUs;
@@ -139,6 +170,7 @@ private:
     List<QueueEntry> mVideoQueue;
     uint32_t mNumFramesWritten;
     sp<VideoFrameScheduler> mVideoScheduler;
+    sp<RenderLedger> mRenderLedger;
 
     bool mDrainAudioQueuePending;
     bool mDrainVideoQueuePending;
@@ -160,6 +192,7 @@ private:
     bool mHasAudio;
     bool mHasVideo;
     int64_t mPauseStartedTimeRealUs;
+    int32_t mPlaybackRatePermille;  // of the audio sink, media time per real time
 
     Mutex mFlushLock;  // protects the following 2 member vars.
     bool mFlushingAudio;
@@ -198,6 +231,20 @@ private:
     int32_t mLastAudioBufferDrained;
     sp<AWakeLock> mWakeLock;
 
+    // Low-latency mode, modified on only renderer's thread.
+    int64_t mLatencyTargetUs;
+    // Buffers before this media time are skipped, -1 if not catching up.
+    // Written with mLock held, as the offload callback reads it.
+    int64_t mCatchUpMediaUs;
+    bool mAudioStretched;
+    bool mAudioStretchUnsupported;
+    int64_t mAudioStretchStartedUs;
+    bool mAudioSpeedUpAllowed;
+
+    Mutex mLatencyLock;  // protects the following 2 member vars.
+    LatencyStats mLatencyStats;
+    int64_t mLatencySumUs;
+
     status_t getCurrentPositionOnLooper(int64_t *mediaUs);
     status_t getCurrentPositionOnLooper(
             int64_t *mediaUs, int64_t nowUs, bool allowPastQueuedVideo = false);
@@ -210,6 +257,8 @@ private:
     bool onDrainAudioQueue();
     int64_t getPendingAudioPlayoutDurationUs(int64_t nowUs);
     int64_t getPlayedOutAudioDurationUs(int64_t nowUs);
+    int64_t getAudioMediaDurationUs(int64_t numFrames, int32_t ratePermille);
+    int32_t getPlaybackRatePermille();
     void postDrainAudioQueue_l(int64_t delayUs = 0);
 
     void onNewAudioMediaTime(int64_t mediaTimeUs);
@@ -230,6 +279,8 @@ private:
     void onPause();
     void onResume();
     void onSetVideoFrameRate(float fps);
+    void onSetLatencyTarget(int64_t targetUs, bool speedUpAudio);
+    void onUpdateLatency(int64_t arrivalMediaUs, int64_t arrivalRealUs);
     void onAudioOffloadTearDown(AudioOffloadTearDownReason reason);
     status_t onOpenAudioSink(
             const sp<AMessage> &format,
@@ -246,6 +297,19 @@ private:
     void notifyVideoRenderingStart();
     void notifyAudioOffloadTearDown();
 
+    void recordVideoFrame(
+            const QueueEntry &entry, int64_t mediaTimeUs, int64_t realTimeUs,
+            int64_t nowUs, bool tooLate);
+
+    bool canStretchAudio() const;
+    void setAudioStretch(bool stretch);
+    void catchUpTo_l(int64_t mediaUs);
+    void limitQueueSpan_l(const List<QueueEntry> &queue);
+    void countCatchUpDrop(bool audio);
+    bool isBeforeCatchUp(int64_t mediaTimeUs) const {
+        return mCatchUpMediaUs >= 0 && mediaTimeUs < mCatchUpMediaUs;
+    }
+
     void flushQueue(List<QueueEntry> *queue);
     bool dropBufferWhileFlushing(bool audio, const sp<AMessage> &msg);
     void syncQueuesDone_l();
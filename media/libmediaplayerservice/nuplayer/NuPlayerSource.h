@@ -114,10 +114,22 @@ struct NuPlayer::Source : public AHandler {
         return INVALID_OPERATION;
     }
 
+    // See NuPlayer::setVideoSyncFramesOnly().
+    virtual status_t setVideoSyncFramesOnly(bool /* syncFramesOnly */) {
+        return INVALID_OPERATION;
+    }
+
     virtual bool isRealTime() const {
         return false;
     }
 
+    // The newest media time received so far, and the system time it arrived
+    // at, for sources that take live data pushed to them.
+    virtual status_t getLatestArrival(
+            int64_t * /* mediaTimeUs */, int64_t * /* arrivalTimeUs */) {
+        return INVALID_OPERATION;
+    }
+
     virtual int64_t getServerTimeoutUs();
 
 protected:
@@ -26,6 +26,7 @@
 
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MediaSource.h>
 #include <media/stagefright/MetaData.h>
@@ -38,7 +39,10 @@ NuPlayer::StreamingSource::StreamingSource(
     : Source(notify),
       mSource(source),
       mFinalResult(OK),
-      mBuffering(false) {
+      mBuffering(false),
+      mVideoSyncFramesOnly(false),
+      mLatestArrivalMediaUs(-1),
+      mLatestArrivalRealUs(-1) {
 }
 
 NuPlayer::StreamingSource::~StreamingSource() {
@@ -149,6 +153,35 @@ void NuPlayer::StreamingSource::onReadBuffer() {
             }
         }
     }
+
+    updateLatestArrival();
+}
+
+void NuPlayer::StreamingSource::updateLatestArrival() {
+    int64_t latestTimeUs = -1;
+    for (int i = 0; i < 2; ++i) {
+        sp<AnotherPacketSource> source = getSource(i == 0 /* audio */);
+        if (source == NULL) {
+            continue;
+        }
+
+        sp<AMessage> meta = source->getLatestEnqueuedMeta();
+        int64_t timeUs;
+        if (meta != NULL && meta->findInt64("timeUs", &timeUs)
+                && timeUs > latestTimeUs) {
+            latestTimeUs = timeUs;
+        }
+    }
+
+    if (latestTimeUs < 0) {
+        return;
+    }
+
+    Mutex::Autolock _l(mLatestArrivalLock);
+    if (latestTimeUs != mLatestArrivalMediaUs) {
+        mLatestArrivalMediaUs = latestTimeUs;
+        mLatestArrivalRealUs = ALooper::GetNowUs();
+    }
 }
 
 status_t NuPlayer::StreamingSource::postReadBuffer() {
@@ -237,6 +270,11 @@ status_t NuPlayer::StreamingSource::dequeueAccessUnit(
         postReadBuffer();
     }
 
+    if (!audio) {
+        Mutex::Autolock _l(mVideoSyncFramesOnlyLock);
+        source->setSyncFramesOnly(mVideoSyncFramesOnly);
+    }
+
     status_t finalResult;
     if (!source->hasBufferAvailable(&finalResult)) {
         return finalResult == OK ? -EWOULDBLOCK : finalResult;
@@ -255,6 +293,26 @@ status_t NuPlayer::StreamingSource::dequeueAccessUnit(
     return err;
 }
 
+status_t NuPlayer::StreamingSource::setVideoSyncFramesOnly(bool syncFramesOnly) {
+    // The transport stream marks H.264 and MPEG-2 video access units, others
+    // keep flowing in full.
+    Mutex::Autolock _l(mVideoSyncFramesOnlyLock);
+    mVideoSyncFramesOnly = syncFramesOnly;
+    return OK;
+}
+
+status_t NuPlayer::StreamingSource::getLatestArrival(
+        int64_t *mediaTimeUs, int64_t *arrivalTimeUs) {
+    Mutex::Autolock _l(mLatestArrivalLock);
+    if (mLatestArrivalMediaUs < 0) {
+        return -EWOULDBLOCK;
+    }
+
+    *mediaTimeUs = mLatestArrivalMediaUs;
+    *arrivalTimeUs = mLatestArrivalRealUs;
+    return OK;
+}
+
 bool NuPlayer::StreamingSource::isRealTime() const {
     return mSource->flags() & IStreamSource::kFlagIsRealTimeData;
 }
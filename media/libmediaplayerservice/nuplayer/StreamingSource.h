@@ -41,6 +41,10 @@ struct NuPlayer::StreamingSource : public NuPlayer::Source {
 
     virtual bool isRealTime() const;
 
+    virtual status_t setVideoSyncFramesOnly(bool syncFramesOnly);
+
+    virtual status_t getLatestArrival(int64_t *mediaTimeUs, int64_t *arrivalTimeUs);
+
 protected:
     virtual ~StreamingSource();
 
@@ -59,6 +63,16 @@ private:
 
     bool mBuffering;
     Mutex mBufferingLock;
+
+    // Applied to the video packet source as soon as it exists.
+    bool mVideoSyncFramesOnly;
+    Mutex mVideoSyncFramesOnlyLock;
+
+    // Newest media time parsed out of the stream and when it came in.
+    int64_t mLatestArrivalMediaUs;
+    int64_t mLatestArrivalRealUs;
+    Mutex mLatestArrivalLock;
+
     sp<ALooper> mLooper;
 
     void setError(status_t err);
@@ -66,6 +80,7 @@ private:
     bool haveSufficientDataOnAllTracks();
     status_t postReadBuffer();
     void onReadBuffer();
+    void updateLatestArrival();
 
     DISALLOW_EVIL_CONSTRUCTORS(StreamingSource);
 };
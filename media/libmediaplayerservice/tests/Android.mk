@@ -0,0 +1,29 @@
+LOCAL_PATH:= $(call my-dir)
+
+#
+# video frame pacing simulation
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	test-render-pacing.cpp \
+	../RenderLedger.cpp \
+	../VideoFrameScheduler.cpp \
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/media/libmediaplayerservice
+
+LOCAL_SHARED_LIBRARIES := \
+	libbinder \
+	libcutils \
+	libgui \
+	liblog \
+	libstagefright_foundation \
+	libui \
+	libutils \
+
+LOCAL_MODULE:= test-render-pacing
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
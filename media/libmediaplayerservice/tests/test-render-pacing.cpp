@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "test-render-pacing"
+#include <utils/Log.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/AString.h>
+
+#include "RenderLedger.h"
+#include "VideoFrameScheduler.h"
+
+/* Offline video frame pacing simulation.
+ *
+ * Replays the video path of NuPlayer::Renderer (postDrainVideoQueue_l() and
+ * onDrainVideoQueue()) on a virtual clock against a display with a fixed
+ * vsync, using the real VideoFrameScheduler and recording every frame in a
+ * RenderLedger, whose summary is what "dumpsys media.player" shows for a
+ * playing NuPlayer.
+ *
+ * Frames come out of the decoder a little ahead of time, with random jitter
+ * and optional stalls, and the media clock may run fast or slow against the
+ * system clock as an audio clock does. All randomness comes from a seeded
+ * generator, so a run is repeatable and a change to the pacing code can be
+ * compared against the same frame sequence.
+ */
+
+using namespace android;
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-f fps] [-v hz] [-d seconds] [-c ppm] [-j ms]"
+                    " [-s every,ms] [-w ms] [-r seed] [-t] [-n]\n", me);
+    fprintf(stderr, "    -f    video frame rate (default 24)\n");
+    fprintf(stderr, "    -v    display refresh rate (default 60)\n");
+    fprintf(stderr, "    -d    duration of the clip in seconds (default 10)\n");
+    fprintf(stderr, "    -c    media clock error in ppm, positive runs fast (default 0)\n");
+    fprintf(stderr, "    -j    maximum jitter on decoder output, in ms (default 5)\n");
+    fprintf(stderr, "    -s    delay every N-th decoded frame by the given ms\n");
+    fprintf(stderr, "    -w    maximum lateness of the renderer waking up, in ms"
+                    " (default 2)\n");
+    fprintf(stderr, "    -r    random seed (default 1)\n");
+    fprintf(stderr, "    -t    time stamp buffers with the vsync-aligned time\n");
+    fprintf(stderr, "    -n    do not align to vsync, bypass VideoFrameScheduler\n");
+    exit(1);
+}
+
+// Same as NuPlayer::Renderer.
+static const int64_t kMaxLateUs = 40000ll;
+static const int64_t kNumEarlyVsyncs = 2;
+
+// How far ahead of its presentation time the decoder hands out a frame.
+static const int64_t kDecoderLeadUs = 100000ll;
+
+// Small linear congruential generator, so runs do not depend on libc.
+struct Random {
+    Random(uint32_t seed) : mState(seed) {}
+
+    // uniform in [0, maxValue]
+    int64_t next(int64_t maxValue) {
+        mState = mState * 1103515245u + 12345u;
+        if (maxValue <= 0) {
+            return 0;
+        }
+        return (int64_t)((mState >> 8) % (uint32_t)(maxValue + 1));
+    }
+
+private:
+    uint32_t mState;
+};
+
+struct Options {
+    double mFps;
+    double mRefreshRate;
+    double mDurationSecs;
+    double mClockErrorPpm;
+    int64_t mJitterUs;
+    int mStallEvery;
+    int64_t mStallUs;
+    int64_t mWakeUpJitterUs;
+    uint32_t mSeed;
+    bool mTimestampScheduled;
+    bool mAlignToVsync;
+};
+
+static void simulate(const Options &options) {
+    const int64_t vsyncPeriodUs = (int64_t)(1E6 / options.mRefreshRate);
+    const int64_t startUs = 1000000ll;  // system time of media time 0
+    const double clockRate = 1.0 + options.mClockErrorPpm / 1E6;
+
+    sp<VideoFrameScheduler> scheduler = new VideoFrameScheduler;
+    // put the vsync phase somewhere other than on a frame boundary
+    scheduler->setFixedVsync(startUs * 1000ll + vsyncPeriodUs * 1000ll / 3,
+            vsyncPeriodUs * 1000ll);
+    scheduler->init(options.mFps);
+
+    sp<RenderLedger> ledger = new RenderLedger;
+    Random random(options.mSeed);
+
+    size_t numFrames = (size_t)(options.mDurationSecs * options.mFps);
+    int64_t lastQueuedUs = 0;
+    int64_t lastDrainedUs = 0;
+
+    for (size_t i = 0; i < numFrames; ++i) {
+        int64_t mediaTimeUs = (int64_t)(i * 1E6 / options.mFps);
+        int64_t realTimeUs = startUs + (int64_t)(mediaTimeUs / clockRate);
+
+        // the decoder hands frames to the renderer in order
+        int64_t queuedUs = realTimeUs - kDecoderLeadUs + random.next(options.mJitterUs);
+        if (options.mStallEvery > 0 && i > 0 && (i % options.mStallEvery) == 0) {
+            queuedUs += options.mStallUs;
+        }
+        if (queuedUs < lastQueuedUs) {
+            queuedUs = lastQueuedUs;
+        }
+        lastQueuedUs = queuedUs;
+
+        // postDrainVideoQueue_l() runs once the frame is queued and the
+        // previous one has been drained
+        int64_t postedUs = queuedUs > lastDrainedUs ? queuedUs : lastDrainedUs;
+        int64_t scheduledUs = realTimeUs;
+        if (options.mAlignToVsync) {
+            scheduledUs = scheduler->schedule(realTimeUs * 1000ll) / 1000;
+        }
+        int64_t delayUs = scheduledUs - postedUs;
+        int64_t earlyUs = kNumEarlyVsyncs * vsyncPeriodUs;
+        int64_t drainedUs = postedUs + (delayUs > earlyUs ? delayUs - earlyUs : 0)
+                + random.next(options.mWakeUpJitterUs);
+        lastDrainedUs = drainedUs;
+
+        // onDrainVideoQueue()
+        bool tooLate = drainedUs - realTimeUs > kMaxLateUs;
+        int64_t timestampUs = options.mTimestampScheduled ? scheduledUs : realTimeUs;
+
+        RenderLedger::Frame frame;
+        frame.mMediaTimeUs = mediaTimeUs;
+        frame.mIntendedUs = realTimeUs;
+        frame.mScheduledUs = scheduledUs;
+        frame.mReleaseUs = drainedUs;
+        frame.mVsyncPeriodUs = vsyncPeriodUs;
+        if (tooLate) {
+            frame.mVsyncUs = -1;
+            frame.mDropReason = RenderLedger::DROP_LATE;
+        } else {
+            frame.mVsyncUs = scheduler->getNextVsyncTime(
+                    (timestampUs > drainedUs ? timestampUs : drainedUs) * 1000ll) / 1000;
+            frame.mDropReason = RenderLedger::DROP_NONE;
+        }
+        ledger->record(frame);
+    }
+
+    AString out;
+    ledger->dump(&out);
+
+    printf("%.3f fps on %.3f Hz for %.1f s, clock %+.0f ppm, seed %u%s%s\n",
+            options.mFps, options.mRefreshRate, options.mDurationSecs,
+            options.mClockErrorPpm, options.mSeed,
+            options.mAlignToVsync ? "" : ", not vsync aligned",
+            options.mTimestampScheduled ? ", aligned timestamps" : "");
+    printf("%s", out.c_str());
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    options.mFps = 24.0;
+    options.mRefreshRate = 60.0;
+    options.mDurationSecs = 10.0;
+    options.mClockErrorPpm = 0.0;
+    options.mJitterUs = 5000;
+    options.mStallEvery = 0;
+    options.mStallUs = 0;
+    options.mWakeUpJitterUs = 2000;
+    options.mSeed = 1;
+    options.mTimestampScheduled = false;
+    options.mAlignToVsync = true;
+
+    int res;
+    while ((res = getopt(argc, argv, "hf:v:d:c:j:s:w:r:tn")) >= 0) {
+        switch (res) {
+            case 'f':
+            case 'v':
+            case 'd':
+            {
+                double value = atof(optarg);
+                if (value <= 0.0) {
+                    usage(argv[0]);
+                }
+                switch (res) {
+                    case 'f': options.mFps = value; break;
+                    case 'v': options.mRefreshRate = value; break;
+                    default: options.mDurationSecs = value; break;
+                }
+                break;
+            }
+
+            case 'c':
+            {
+                options.mClockErrorPpm = atof(optarg);
+                break;
+            }
+
+            case 'j':
+            case 'w':
+            {
+                double value = atof(optarg);
+                if (value < 0.0) {
+                    usage(argv[0]);
+                }
+                if (res == 'j') {
+                    options.mJitterUs = (int64_t)(value * 1000);
+                } else {
+                    options.mWakeUpJitterUs = (int64_t)(value * 1000);
+                }
+                break;
+            }
+
+            case 's':
+            {
+                double stallMs;
+                if (sscanf(optarg, "%d,%lf", &options.mStallEvery, &stallMs) != 2
+                        || options.mStallEvery <= 0 || stallMs < 0.0) {
+                    usage(argv[0]);
+                }
+                options.mStallUs = (int64_t)(stallMs * 1000);
+                break;
+            }
+
+            case 'r':
+            {
+                options.mSeed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            }
+
+            case 't':
+            {
+                options.mTimestampScheduled = true;
+                break;
+            }
+
+            case 'n':
+            {
+                options.mAlignToVsync = false;
+                break;
+            }
+
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(argv[0]);
+            }
+        }
+    }
+
+    if (optind != argc) {
+        usage(argv[0]);
+    }
+
+    simulate(options);
+
+    return 0;
+}
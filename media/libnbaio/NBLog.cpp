@@ -17,11 +17,13 @@
 #define LOG_TAG "NBLog"
 //#define LOG_NDEBUG 0
 
+#include <errno.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include <new>
 #include <cutils/atomic.h>
 #include <media/nbaio/NBLog.h>
@@ -30,19 +32,17 @@
 
 namespace android {
 
-int NBLog::Entry::readAt(size_t offset) const
+/*static*/ const size_t NBLog::kMaxBinaryArgs;
+/*static*/ const uint32_t NBLog::kExportMagic;
+/*static*/ const uint16_t NBLog::kExportVersion;
+
+size_t NBLog::Entry::copyTo(uint8_t *dst) const
 {
-    // FIXME This is too slow, despite the name it is used during writing
-    if (offset == 0)
-        return mEvent;
-    else if (offset == 1)
-        return mLength;
-    else if (offset < (size_t) (mLength + 2))
-        return ((char *) mData)[offset - 2];
-    else if (offset == (size_t) (mLength + 2))
-        return mLength;
-    else
-        return 0;
+    dst[0] = mEvent;
+    dst[1] = mLength;
+    memcpy(&dst[2], mData, mLength);
+    dst[2 + mLength] = mLength;
+    return mLength + 3;
 }
 
 // ---------------------------------------------------------------------------
@@ -147,6 +147,31 @@ void NBLog::Writer::logTimestamp(const struct timespec& ts)
     log(EVENT_TIMESTAMP, &ts, sizeof(struct timespec));
 }
 
+void NBLog::Writer::logEventv(uint16_t id, const int32_t *args, size_t argc)
+{
+    if (!mEnabled) {
+        return;
+    }
+    if (argc > kMaxBinaryArgs) {
+        argc = kMaxBinaryArgs;
+    }
+    uint8_t buffer[sizeof(BinaryEvent) + kMaxBinaryArgs * sizeof(int32_t)];
+    BinaryEvent header;
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts)) {
+        return;
+    }
+    header.mTimeNs = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    header.mId = id;
+    header.mArgc = argc;
+    header.mReserved = 0;
+    memcpy(buffer, &header, sizeof(header));
+    if (argc > 0) {
+        memcpy(&buffer[sizeof(header)], args, argc * sizeof(int32_t));
+    }
+    log(EVENT_BINARY, buffer, sizeof(header) + argc * sizeof(int32_t));
+}
+
 void NBLog::Writer::log(Event event, const void *data, size_t length)
 {
     if (!mEnabled) {
@@ -158,6 +183,7 @@ void NBLog::Writer::log(Event event, const void *data, size_t length)
     switch (event) {
     case EVENT_STRING:
     case EVENT_TIMESTAMP:
+    case EVENT_BINARY:
         break;
     case EVENT_RESERVED:
     default:
@@ -176,23 +202,17 @@ void NBLog::Writer::log(const NBLog::Entry *entry, bool trusted)
         log(entry->mEvent, entry->mData, entry->mLength);
         return;
     }
+    // mEvent, mLength, data[length], mLength
+    uint8_t temp[255 + 3];
+    size_t need = entry->copyTo(temp);  // need = number of bytes to write
     size_t rear = mRear & (mSize - 1);
     size_t written = mSize - rear;      // written = number of bytes that have been written so far
-    size_t need = entry->mLength + 3;   // mEvent, mLength, data[length], mLength
-                                        // need = number of bytes remaining to write
     if (written > need) {
         written = need;
     }
-    size_t i;
-    // FIXME optimize this using memcpy for the data part of the Entry.
-    // The Entry could have a method copyTo(ptr, offset, size) to optimize the copy.
-    for (i = 0; i < written; ++i) {
-        mShared->mBuffer[rear + i] = entry->readAt(i);
-    }
+    memcpy(&mShared->mBuffer[rear], temp, written);
     if (rear + written == mSize && (need -= written) > 0)  {
-        for (i = 0; i < need; ++i) {
-            mShared->mBuffer[i] = entry->readAt(written + i);
-        }
+        memcpy(mShared->mBuffer, &temp[written], need);
         written += need;
     }
     android_atomic_release_store(mRear += written, &mShared->mRear);
@@ -258,6 +278,13 @@ void NBLog::LockedWriter::logTimestamp(const struct timespec& ts)
     Writer::logTimestamp(ts);
 }
 
+void NBLog::LockedWriter::logEventv(uint16_t id, const int32_t *args, size_t argc)
+{
+    // FIXME should not take the lock until after the clock_gettime() syscall
+    Mutex::Autolock _l(mLock);
+    Writer::logEventv(id, args, argc);
+}
+
 bool NBLog::LockedWriter::isEnabled() const
 {
     Mutex::Autolock _l(mLock);
@@ -283,12 +310,13 @@ NBLog::Reader::Reader(size_t size, const sp<IMemory>& iMemory)
 {
 }
 
-void NBLog::Reader::dump(int fd, size_t indent)
+uint8_t *NBLog::Reader::copyAvailable(size_t *pAvail, size_t *pFirst, size_t *pLost,
+        time_t *pMaxSec)
 {
     int32_t rear = android_atomic_acquire_load(&mShared->mRear);
     size_t avail = rear - mFront;
     if (avail == 0) {
-        return;
+        return NULL;
     }
     size_t lost = 0;
     if (avail > mSize) {
@@ -335,13 +363,42 @@ void NBLog::Reader::dump(int fd, size_t indent)
             if (ts.tv_sec > maxSec) {
                 maxSec = ts.tv_sec;
             }
+        } else if (event == EVENT_BINARY) {
+            BinaryEvent header;
+            if (length < sizeof(header)) {
+                // corrupt
+                break;
+            }
+            memcpy(&header, &copy[i - length - 1], sizeof(header));
+            if (header.mArgc > kMaxBinaryArgs ||
+                    length != sizeof(header) + header.mArgc * sizeof(int32_t)) {
+                // corrupt
+                break;
+            }
         }
         i -= length + 3;
     }
+    *pAvail = avail;
+    *pFirst = i;
+    *pLost = lost + i;
+    *pMaxSec = maxSec;
+    return copy;
+}
+
+void NBLog::Reader::dump(int fd, size_t indent)
+{
+    size_t avail, i, lost;
+    time_t maxSec;
+    uint8_t *copy = copyAvailable(&avail, &i, &lost, &maxSec);
+    if (copy == NULL) {
+        return;
+    }
+    Event event;
+    size_t length;
+    struct timespec ts;
     mFd = fd;
     mIndent = indent;
     String8 timestamp, body;
-    lost += i;
     if (lost > 0) {
         body.appendFormat("warning: lost %zu bytes worth of events", lost);
         // TODO timestamp empty here, only other choice to wait for the first timestamp event in the
@@ -416,6 +473,19 @@ void NBLog::Reader::dump(int fd, size_t indent)
                     (int) (ts.tv_nsec / 1000000));
             deferredTimestamp = true;
             } break;
+        case EVENT_BINARY: {
+            // already checked that length matches the argument count
+            BinaryEvent header;
+            memcpy(&header, data, sizeof(header));
+            body.appendFormat("#%u @%d.%06d", header.mId,
+                    (int) (header.mTimeNs / 1000000000),
+                    (int) ((header.mTimeNs % 1000000000) / 1000));
+            for (size_t k = 0; k < header.mArgc; k++) {
+                int32_t arg;
+                memcpy(&arg, &copy[i + 2 + sizeof(header) + k * sizeof(int32_t)], sizeof(arg));
+                body.appendFormat(" %d", arg);
+            }
+            } break;
         case EVENT_RESERVED:
         default:
             body.appendFormat("warning: unknown event %d", event);
@@ -445,6 +515,47 @@ void NBLog::Reader::dumpLine(const String8& timestamp, String8& body)
     body.clear();
 }
 
+// Writes all of buffer to fd, retrying short and interrupted writes.
+static status_t writeFully(int fd, const void *buffer, size_t size)
+{
+    const uint8_t *p = (const uint8_t *) buffer;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno != 0 ? -errno : UNKNOWN_ERROR;
+        }
+        if (n == 0) {
+            // no progress and no errno to report
+            return INVALID_OPERATION;
+        }
+        p += n;
+        size -= n;
+    }
+    return NO_ERROR;
+}
+
+status_t NBLog::Reader::exportBinary(int fd)
+{
+    size_t avail = 0, first = 0, lost = 0;
+    time_t maxSec;
+    uint8_t *copy = copyAvailable(&avail, &first, &lost, &maxSec);
+    ExportHeader header;
+    header.mMagic = kExportMagic;
+    header.mVersion = kExportVersion;
+    header.mHeaderSize = sizeof(header);
+    header.mLost = lost;
+    header.mLength = avail - first;
+    status_t status = writeFully(fd, &header, sizeof(header));
+    if (status == NO_ERROR && header.mLength > 0) {
+        status = writeFully(fd, &copy[first], header.mLength);
+    }
+    delete[] copy;
+    return status;
+}
+
 bool NBLog::Reader::isIMemory(const sp<IMemory>& iMemory) const
 {
     return iMemory != 0 && mIMemory != 0 && iMemory->pointer() == mIMemory->pointer();
@@ -59,6 +59,8 @@
 #endif
 
 #include <inttypes.h>
+#include <utils/Condition.h>
+#include <utils/Mutex.h>
 #include <utils/Trace.h>
 
 #include <media/stagefright/ACodec.h>
@@ -68,6 +70,7 @@
 #include <media/stagefright/foundation/hexdump.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/AUtils.h>
 #include <media/stagefright/MetaData.h>
@@ -89,6 +92,9 @@
 
 #include "include/ExtendedUtils.h"
 #include "include/avc_utils.h"
+#include "include/AudioEncoderThreading.h"
+#include "include/VideoDecoderDirectOutput.h"
+#include "include/VideoDecoderThreading.h"
 
 #ifdef ENABLE_AV_ENHANCEMENTS
 #include <QCMediaDefs.h>
@@ -158,12 +164,24 @@ struct CodecObserver : public BnOMXObserver {
     CodecObserver() {}
 
     void setNotificationMessage(const sp<AMessage> &msg) {
+        Mutex::Autolock autoLock(mLock);
         mNotify = msg;
     }
 
     // from IOMXObserver
     virtual void onMessage(const omx_message &omx_msg) {
-        sp<AMessage> msg = mNotify->dup();
+        sp<AMessage> notify;
+        {
+            Mutex::Autolock autoLock(mLock);
+            notify = mNotify;
+        }
+
+        if (notify == NULL) {
+            // Not handed to an ACodec yet, or idle in the ComponentPool.
+            return;
+        }
+
+        sp<AMessage> msg = notify->dup();
 
         msg->setInt32("type", omx_msg.type);
         msg->setInt32("node", omx_msg.node);
@@ -214,6 +232,7 @@ protected:
     virtual ~CodecObserver() {}
 
 private:
+    Mutex mLock;
     sp<AMessage> mNotify;
 
     DISALLOW_EVIL_CONSTRUCTORS(CodecObserver);
@@ -221,6 +240,353 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+static void findMatchingComponents(
+        const AString &mime, bool encoder,
+        Vector<OMXCodec::CodecNameAndQuirks> *matchingCodecs) {
+#ifdef ENABLE_AV_ENHANCEMENTS
+    // Call UseQCHWAACEncoder with no arguments to get the correct state since
+    // MediaCodecSource does not pass the output format details when calling
+    // kInit leading to msg passed not having enough details
+    if (!strcasecmp(mime.c_str(), MEDIA_MIMETYPE_AUDIO_AAC)
+        && ExtendedUtils::UseQCHWAACEncoder() && encoder) {
+        //use hw aac encoder
+        ALOGD("use QCOM HW AAC encoder");
+        OMXCodec::findMatchingCodecs(
+                mime.c_str(),
+                encoder, // createEncoder
+                "OMX.qcom.audio.encoder.aac",  // OMX.qcom.audio.encoder.aac
+                0,     // flags
+                matchingCodecs);
+    }
+#ifdef QTI_FLAC_DECODER
+    else if (!strcasecmp(mime.c_str(), MEDIA_MIMETYPE_AUDIO_FLAC) && !encoder) {
+        //use google's raw decoder
+        OMXCodec::findMatchingCodecs(
+                MEDIA_MIMETYPE_AUDIO_RAW,
+                encoder, //createEncoder
+                "OMX.google.raw.decoder",
+                0, //flags
+                matchingCodecs);
+    }
+#endif
+     else
+        OMXCodec::findMatchingCodecs(
+                mime.c_str(),
+                encoder, // createEncoder
+                NULL,  // matchComponentName
+                0,     // flags
+                matchingCodecs);
+#else
+    OMXCodec::findMatchingCodecs(
+                mime.c_str(),
+                encoder, // createEncoder
+                NULL,  // matchComponentName
+                0,     // flags
+                matchingCodecs);
+#endif
+}
+
+// Only the platform's software decoders are pooled. Their state lives in this
+// process, configure() sets every port up again, and ACodec frees instead of
+// pooling any instance it changed a sticky setting on (see
+// ACodec::mComponentReusable). Hardware components are never held idle, as
+// another process may be waiting to allocate them.
+//
+// That leaves out most video playback: hardware decoders, and software ones
+// configured with a surface, which enables graphic buffers and metadata or
+// adaptive playback mode. Pooling those needs a way to put each of these
+// settings back on the component, which OMX does not offer, so they still
+// pay for a new instance on every start.
+static bool isPoolableComponent(const AString &componentName) {
+    return componentName.startsWith("OMX.google.")
+            && componentName.endsWith(".decoder");
+}
+
+// Software decoders in the Loaded state that their ACodec is done with, kept
+// for a while so that the next ACodec asking for the same component can have
+// it without waiting for a new instance. Only a few are kept, each for
+// kIdleTimeoutUs at most.
+struct ComponentPool : public AHandler {
+    static sp<ComponentPool> Get();
+
+    // Takes an idle instance of "componentName" out of the pool, with the
+    // IOMX it lives on and its observer, which is not notifying anyone. If
+    // one is being prewarmed, waits for it rather than allocate a second.
+    bool acquire(
+            const AString &componentName, sp<IOMX> *omx,
+            IOMX::node_id *node, sp<CodecObserver> *observer);
+
+    // Keeps a component in the Loaded state, which must be poolable, making
+    // room for it by freeing the ones idle for longest if needed.
+    void release(
+            const sp<IOMX> &omx, const AString &componentName,
+            IOMX::node_id node, const sp<CodecObserver> &observer);
+
+    // Instantiates the preferred decoder for "mime" on the pool's looper,
+    // unless an idle one is already at hand or it is not poolable.
+    void prewarm(const char *mime);
+
+    // Frees all idle components, returns how many there were.
+    size_t purge();
+
+protected:
+    virtual ~ComponentPool() {}
+
+    virtual void onMessageReceived(const sp<AMessage> &msg);
+
+private:
+    enum {
+        kWhatPrewarm = 'prew',
+        kWhatExpire  = 'expi',
+    };
+
+    static const size_t kMaxIdleComponents = 4;
+    static const int64_t kIdleTimeoutUs = 5000000ll;
+
+    struct Entry {
+        sp<IOMX> mOMX;
+        IOMX::node_id mNode;
+        sp<CodecObserver> mObserver;
+        AString mComponentName;
+        int64_t mIdleSinceUs;
+    };
+
+    static Mutex sLock;
+    static sp<ComponentPool> sInstance;
+
+    Mutex mLock;
+    sp<ALooper> mLooper;
+
+    // Longest idle first.
+    List<Entry> mEntries;
+
+    AString mPrewarmingComponentName;
+    Condition mPrewarmDone;
+
+    ComponentPool() {}
+
+    bool contains_l(const AString &componentName);
+    void onPrewarm(const AString &mime);
+    void onExpire();
+
+    static void freeEntries(const List<Entry> &entries);
+
+    DISALLOW_EVIL_CONSTRUCTORS(ComponentPool);
+};
+
+Mutex ComponentPool::sLock;
+sp<ComponentPool> ComponentPool::sInstance;
+
+// static
+sp<ComponentPool> ComponentPool::Get() {
+    Mutex::Autolock autoLock(sLock);
+
+    if (sInstance == NULL) {
+        sInstance = new ComponentPool;
+
+        sInstance->mLooper = new ALooper;
+        sInstance->mLooper->setName("ComponentPool");
+        sInstance->mLooper->start();
+        sInstance->mLooper->registerHandler(sInstance);
+    }
+
+    return sInstance;
+}
+
+bool ComponentPool::acquire(
+        const AString &componentName, sp<IOMX> *omx,
+        IOMX::node_id *node, sp<CodecObserver> *observer) {
+    Mutex::Autolock autoLock(mLock);
+
+    while (mPrewarmingComponentName == componentName) {
+        mPrewarmDone.wait(mLock);
+    }
+
+    for (List<Entry>::iterator it = mEntries.begin();
+            it != mEntries.end(); ++it) {
+        if (it->mComponentName != componentName
+                || !it->mOMX->asBinder()->isBinderAlive()) {
+            continue;
+        }
+
+        ALOGV("reusing idle %s", componentName.c_str());
+
+        *omx = it->mOMX;
+        *node = it->mNode;
+        *observer = it->mObserver;
+
+        mEntries.erase(it);
+        return true;
+    }
+
+    return false;
+}
+
+void ComponentPool::release(
+        const sp<IOMX> &omx, const AString &componentName,
+        IOMX::node_id node, const sp<CodecObserver> &observer) {
+    CHECK(isPoolableComponent(componentName));
+
+    observer->setNotificationMessage(NULL);
+
+    Entry entry;
+    entry.mOMX = omx;
+    entry.mNode = node;
+    entry.mObserver = observer;
+    entry.mComponentName = componentName;
+    entry.mIdleSinceUs = ALooper::GetNowUs();
+
+    List<Entry> evicted;
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        while (mEntries.size() >= kMaxIdleComponents) {
+            evicted.push_back(*mEntries.begin());
+            mEntries.erase(mEntries.begin());
+        }
+
+        mEntries.push_back(entry);
+    }
+
+    freeEntries(evicted);
+
+    (new AMessage(kWhatExpire, id()))->post(kIdleTimeoutUs);
+}
+
+void ComponentPool::prewarm(const char *mime) {
+    sp<AMessage> msg = new AMessage(kWhatPrewarm, id());
+    msg->setString("mime", mime);
+    msg->post();
+}
+
+size_t ComponentPool::purge() {
+    List<Entry> entries;
+    {
+        Mutex::Autolock autoLock(mLock);
+        entries = mEntries;
+        mEntries.clear();
+    }
+
+    freeEntries(entries);
+
+    return entries.size();
+}
+
+bool ComponentPool::contains_l(const AString &componentName) {
+    for (List<Entry>::iterator it = mEntries.begin();
+            it != mEntries.end(); ++it) {
+        if (it->mComponentName == componentName) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ComponentPool::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatPrewarm:
+        {
+            AString mime;
+            CHECK(msg->findString("mime", &mime));
+
+            onPrewarm(mime);
+            break;
+        }
+
+        case kWhatExpire:
+        {
+            onExpire();
+            break;
+        }
+
+        default:
+            TRESPASS();
+            break;
+    }
+}
+
+void ComponentPool::onPrewarm(const AString &mime) {
+    Vector<OMXCodec::CodecNameAndQuirks> matchingCodecs;
+    findMatchingComponents(mime, false /* encoder */, &matchingCodecs);
+
+    OMXClient client;
+    if (client.connect() != OK) {
+        return;
+    }
+    sp<IOMX> omx = client.interface();
+
+    for (size_t i = 0; i < matchingCodecs.size(); ++i) {
+        AString componentName = matchingCodecs.itemAt(i).mName.string();
+        if (componentName.endsWith(".secure")) {
+            continue;
+        }
+
+        if (!isPoolableComponent(componentName)) {
+            // a less preferred component would not be the one used
+            return;
+        }
+
+        {
+            Mutex::Autolock autoLock(mLock);
+            if (contains_l(componentName)) {
+                return;
+            }
+            mPrewarmingComponentName = componentName;
+        }
+
+        sp<CodecObserver> observer = new CodecObserver;
+        IOMX::node_id node;
+        status_t err = omx->allocateNode(componentName.c_str(), observer, &node);
+        if (err == OK) {
+            ALOGV("prewarmed %s for %s", componentName.c_str(), mime.c_str());
+            release(omx, componentName, node, observer);
+        }
+
+        {
+            Mutex::Autolock autoLock(mLock);
+            mPrewarmingComponentName.clear();
+            mPrewarmDone.broadcast();
+        }
+
+        if (err == OK) {
+            return;
+        }
+    }
+}
+
+void ComponentPool::onExpire() {
+    int64_t nowUs = ALooper::GetNowUs();
+
+    List<Entry> expired;
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        List<Entry>::iterator it = mEntries.begin();
+        while (it != mEntries.end()
+                && nowUs - it->mIdleSinceUs >= kIdleTimeoutUs) {
+            expired.push_back(*it);
+            it = mEntries.erase(it);
+        }
+    }
+
+    freeEntries(expired);
+}
+
+// static
+void ComponentPool::freeEntries(const List<Entry> &entries) {
+    for (List<Entry>::const_iterator it = entries.begin();
+            it != entries.end(); ++it) {
+        ALOGV("freeing idle %s", it->mComponentName.c_str());
+
+        status_t err = it->mOMX->freeNode(it->mNode);
+        ALOGW_IF(err != OK, "failed to free idle %s (err %d)",
+                it->mComponentName.c_str(), err);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 struct ACodec::BaseState : public AState {
     BaseState(ACodec *codec, const sp<AState> &parentState = NULL);
 
@@ -455,6 +821,7 @@ private:
 ACodec::ACodec()
     : mQuirks(0),
       mNode(0),
+      mComponentReusable(false),
       mSentFormat(false),
       mIsEncoder(false),
       mUseMetadataOnEncoderOutput(false),
@@ -474,7 +841,8 @@ ACodec::ACodec()
       mTimePerCaptureUs(-1ll),
       mCreateInputBuffersSuspended(false),
       mTunneled(false),
-      mIsVideoRenderingDisabled(false) {
+      mIsVideoRenderingDisabled(false),
+      mBatchBufferOps(false) {
     mUninitializedState = new UninitializedState(this);
     mLoadedState = new LoadedState(this);
     mLoadedToIdleState = new LoadedToIdleState(this);
@@ -638,6 +1006,18 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
                             (4 + sizeof(buffer_handle_t)) : def.nBufferSize;
 
                     info.mData = new ABuffer(ptr, bufSize);
+                } else if ((mQuirks & requiresAllocateBufferBit)
+                        && mOMX->livesLocally(mNode, getpid())) {
+                    // The component's own buffers can be written and read
+                    // from here, without a backup to copy them through.
+                    mem.clear();
+
+                    void *ptr = NULL;
+                    err = mOMX->allocateBuffer(
+                            mNode, portIndex, def.nBufferSize, &info.mBufferID,
+                            &ptr);
+
+                    info.mData = new ABuffer(ptr, def.nBufferSize);
                 } else if (mQuirks & requiresAllocateBufferBit) {
                     err = mOMX->allocateBufferWithBackup(
                             mNode, portIndex, mem, &info.mBufferID);
@@ -1456,6 +1836,7 @@ status_t ACodec::configureCodec(
                     // allow failure
                     err = OK;
                 } else {
+                    mComponentReusable = false;
                     inputFormat->setInt32("max-width", maxWidth);
                     inputFormat->setInt32("max-height", maxHeight);
                     inputFormat->setInt32("adaptive-playback", true);
@@ -1486,6 +1867,8 @@ status_t ACodec::configureCodec(
                 if (err != OK) {
                     ALOGE("[%s] storeMetaDataInBuffers failed w/ err %d",
                             mComponentName.c_str(), err);
+                } else {
+                    mComponentReusable = false;
                 }
             }
             if (err != OK || preferAdaptive) {
@@ -1526,6 +1909,7 @@ status_t ACodec::configureCodec(
                             mComponentName.c_str(), err);
 
                     if (err == OK) {
+                        mComponentReusable = false;
                         inputFormat->setInt32("max-width", maxWidth);
                         inputFormat->setInt32("max-height", maxHeight);
                         inputFormat->setInt32("adaptive-playback", true);
@@ -1540,6 +1924,7 @@ status_t ACodec::configureCodec(
                               mComponentName.c_str(), err);
                     } else {
                         ALOGV("[%s] storeMetaDataInBuffers succeeded", mComponentName.c_str());
+                        mComponentReusable = false;
                         mStoreMetaDataInOutputBuffers = true;
                         inputFormat->setInt32("adaptive-playback", true);
                     }
@@ -1603,6 +1988,8 @@ status_t ACodec::configureCodec(
             if (err == OK) {
                 const char* componentName = mComponentName.c_str();
                 ExtendedCodec::configureVideoDecoder(msg, mime, mOMX, 0, mNode, componentName);
+                setVideoDecoderThreading(msg, false /* whileRunning */);
+                setVideoDecoderDirectOutput(msg);
             }
         }
 
@@ -1748,6 +2135,9 @@ status_t ACodec::configureCodec(
                     encoder, numChannels, sampleRate, bitRate, aacProfile,
                     isADTS != 0, sbrMode, maxOutputChannelCount, drc,
                     pcmLimiterEnable);
+            if (err == OK && encoder) {
+                setAudioEncoderThreading(msg);
+            }
         }
     } else if (!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_AMR_NB)) {
         err = setupAMRCodec(encoder, false /* isWAMR */, bitRate);
@@ -3387,6 +3777,7 @@ status_t ACodec::setVideoFormatOnPort(
 
 status_t ACodec::initNativeWindow() {
     if (mNativeWindow != NULL) {
+        mComponentReusable = false;
         return mOMX->enableGraphicBuffers(mNode, kPortIndexOutput, OMX_TRUE);
     }
 
@@ -3458,6 +3849,87 @@ bool ACodec::allYourBuffersAreBelongToUs() {
         && allYourBuffersAreBelongToUs(kPortIndexOutput);
 }
 
+void ACodec::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatInputBufferFilled:
+        case kWhatOutputBufferDrained:
+            // These only add to mPendingBufferOps, let whatever else of the
+            // kind is already queued join them.
+            break;
+
+        case kWhatSubmitBufferOps:
+            submitPendingBufferOps();
+            return;
+
+        case kWhatOMXDied:
+            mPendingBufferOps.clear();
+            break;
+
+        default:
+            // Anything else gets to see the buffers where they were sent.
+            submitPendingBufferOps();
+            break;
+    }
+
+    handleMessage(msg);
+}
+
+void ACodec::queueEmptyBuffer(
+        IOMX::buffer_id bufferID, OMX_U32 rangeOffset, OMX_U32 rangeLength,
+        OMX_U32 flags, OMX_TICKS timestamp) {
+    if (!mBatchBufferOps) {
+        CHECK_EQ(mOMX->emptyBuffer(
+                    mNode, bufferID, rangeOffset, rangeLength, flags, timestamp),
+                 (status_t)OK);
+        return;
+    }
+
+    IOMX::BufferOp op;
+    op.mType = IOMX::BufferOp::EMPTY;
+    op.mBuffer = bufferID;
+    op.mRangeOffset = rangeOffset;
+    op.mRangeLength = rangeLength;
+    op.mFlags = flags;
+    op.mTimestamp = timestamp;
+
+    if (mPendingBufferOps.isEmpty()) {
+        (new AMessage(kWhatSubmitBufferOps, id()))->post();
+    }
+    mPendingBufferOps.push(op);
+}
+
+void ACodec::queueFillBuffer(IOMX::buffer_id bufferID) {
+    if (!mBatchBufferOps) {
+        CHECK_EQ(mOMX->fillBuffer(mNode, bufferID), (status_t)OK);
+        return;
+    }
+
+    IOMX::BufferOp op;
+    op.mType = IOMX::BufferOp::FILL;
+    op.mBuffer = bufferID;
+    op.mRangeOffset = 0;
+    op.mRangeLength = 0;
+    op.mFlags = 0;
+    op.mTimestamp = 0;
+
+    if (mPendingBufferOps.isEmpty()) {
+        (new AMessage(kWhatSubmitBufferOps, id()))->post();
+    }
+    mPendingBufferOps.push(op);
+}
+
+void ACodec::submitPendingBufferOps() {
+    if (mPendingBufferOps.isEmpty()) {
+        return;
+    }
+
+    ALOGV("[%s] submitting %zu buffer ops",
+         mComponentName.c_str(), mPendingBufferOps.size());
+
+    CHECK_EQ(mOMX->submitBuffers(mNode, mPendingBufferOps), (status_t)OK);
+    mPendingBufferOps.clear();
+}
+
 void ACodec::deferMessage(const sp<AMessage> &msg) {
     bool wasEmptyBefore = mDeferredQueue.empty();
     mDeferredQueue.push_back(msg);
@@ -3600,6 +4072,11 @@ bool ACodec::describeColorFormat(
             MediaImage::MEDIA_IMAGE_TYPE_UNKNOWN;
 }
 
+// static
+void ACodec::PrewarmDecoder(const char *mime) {
+    ComponentPool::Get()->prewarm(mime);
+}
+
 // static
 bool ACodec::isFlexibleColorFormat(
          const sp<IOMX> &omx, IOMX::node_id node,
@@ -4116,6 +4593,8 @@ void ACodec::sendFormatChange(const sp<AMessage> &reply) {
 }
 
 void ACodec::signalError(OMX_ERRORTYPE error, status_t internalError) {
+    mComponentReusable = false;
+
     sp<AMessage> notify = mNotify->dup();
     notify->setInt32("what", CodecBase::kWhatError);
     ALOGE("signalError(omxError %#x, internalError %d)", error, internalError);
@@ -4371,6 +4850,7 @@ bool ACodec::BaseState::onMessageReceived(const sp<AMessage> &msg) {
         {
             ALOGI("[%s] forcing the release of codec",
                     mCodec->mComponentName.c_str());
+            mCodec->mComponentReusable = false;
             status_t err = mCodec->mOMX->freeNode(mCodec->mNode);
             ALOGE_IF("[%s] failed to release codec instance: err=%d",
                        mCodec->mComponentName.c_str(), err);
@@ -4662,14 +5142,8 @@ void ACodec::BaseState::onInputBufferFilled(const sp<AMessage> &msg) {
                             STATS_PROFILE_FIRST_BUFFER(isVideo));
                 }
 
-                CHECK_EQ(mCodec->mOMX->emptyBuffer(
-                            mCodec->mNode,
-                            bufferID,
-                            0,
-                            buffer->size(),
-                            flags,
-                            timeUs),
-                         (status_t)OK);
+                mCodec->queueEmptyBuffer(
+                        bufferID, 0, buffer->size(), flags, timeUs);
 
                 info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
 
@@ -4695,14 +5169,8 @@ void ACodec::BaseState::onInputBufferFilled(const sp<AMessage> &msg) {
                 ALOGV("[%s] calling emptyBuffer %p signalling EOS",
                      mCodec->mComponentName.c_str(), bufferID);
 
-                CHECK_EQ(mCodec->mOMX->emptyBuffer(
-                            mCodec->mNode,
-                            bufferID,
-                            0,
-                            0,
-                            OMX_BUFFERFLAG_EOS,
-                            0),
-                         (status_t)OK);
+                mCodec->queueEmptyBuffer(
+                        bufferID, 0, 0, OMX_BUFFERFLAG_EOS, 0);
 
                 info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
 
@@ -4967,8 +5435,7 @@ void ACodec::BaseState::onOutputBufferDrained(const sp<AMessage> &msg) {
                     ALOGV("[%s] calling fillBuffer %u",
                          mCodec->mComponentName.c_str(), info->mBufferID);
 
-                    CHECK_EQ(mCodec->mOMX->fillBuffer(mCodec->mNode, info->mBufferID),
-                             (status_t)OK);
+                    mCodec->queueFillBuffer(info->mBufferID);
 
                     info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
                 }
@@ -5002,8 +5469,11 @@ void ACodec::UninitializedState::stateEntered() {
     }
 
     mCodec->mNativeWindow.clear();
+    mCodec->mPendingBufferOps.clear();
+    mCodec->mBatchBufferOps = false;
     mCodec->mNode = NULL;
     mCodec->mOMX.clear();
+    mCodec->mObserver.clear();
     mCodec->mQuirks = 0;
     mCodec->mFlags = 0;
     mCodec->mUseMetadataOnEncoderOutput = 0;
@@ -5119,47 +5589,7 @@ bool ACodec::UninitializedState::onAllocateComponent(const sp<AMessage> &msg) {
             encoder = false;
         }
 
-#ifdef ENABLE_AV_ENHANCEMENTS
-    // Call UseQCHWAACEncoder with no arguments to get the correct state since
-    // MediaCodecSource does not pass the output format details when calling
-    // kInit leading to msg passed not having enough details
-    if (!strcasecmp(mime.c_str(), MEDIA_MIMETYPE_AUDIO_AAC)
-        && ExtendedUtils::UseQCHWAACEncoder() && encoder) {
-        //use hw aac encoder
-        ALOGD("use QCOM HW AAC encoder");
-        OMXCodec::findMatchingCodecs(
-                mime.c_str(),
-                encoder, // createEncoder
-                "OMX.qcom.audio.encoder.aac",  // OMX.qcom.audio.encoder.aac
-                0,     // flags
-                &matchingCodecs);
-    }
-#ifdef QTI_FLAC_DECODER
-    else if (!strcasecmp(mime.c_str(), MEDIA_MIMETYPE_AUDIO_FLAC) && !encoder) {
-        //use google's raw decoder
-        OMXCodec::findMatchingCodecs(
-                MEDIA_MIMETYPE_AUDIO_RAW,
-                encoder, //createEncoder
-                "OMX.google.raw.decoder",
-                0, //flags
-                &matchingCodecs);
-    }
-#endif
-     else
-        OMXCodec::findMatchingCodecs(
-                mime.c_str(),
-                encoder, // createEncoder
-                NULL,  // matchComponentName
-                0,     // flags
-                &matchingCodecs);
-#else
-    OMXCodec::findMatchingCodecs(
-                mime.c_str(),
-                encoder, // createEncoder
-                NULL,  // matchComponentName
-                0,     // flags
-                &matchingCodecs);
-#endif
+        findMatchingComponents(mime, encoder, &matchingCodecs);
     }
 
     sp<CodecObserver> observer = new CodecObserver;
@@ -5171,10 +5601,25 @@ bool ACodec::UninitializedState::onAllocateComponent(const sp<AMessage> &msg) {
         quirks = matchingCodecs.itemAt(matchIndex).mQuirks;
         ExtendedCodec::overrideComponentName(quirks, msg, &componentName, &mime, encoder);
 
+        sp<IOMX> pooledOMX;
+        sp<CodecObserver> pooledObserver;
+        if (ComponentPool::Get()->acquire(
+                    componentName, &pooledOMX, &node, &pooledObserver)) {
+            // Same service as "omx", but the node must be addressed through
+            // the interface it was allocated on.
+            omx = pooledOMX;
+            observer = pooledObserver;
+            break;
+        }
+
         pid_t tid = androidGetTid();
         int prevPriority = androidGetThreadPriority(tid);
         androidSetThreadPriority(tid, ANDROID_PRIORITY_FOREGROUND);
         status_t err = omx->allocateNode(componentName.c_str(), observer, &node);
+        if (err != OK && ComponentPool::Get()->purge() > 0) {
+            // Idle components may be holding on to what this one needs.
+            err = omx->allocateNode(componentName.c_str(), observer, &node);
+        }
         androidSetThreadPriority(tid, prevPriority);
 
         if (err == OK) {
@@ -5213,6 +5658,12 @@ bool ACodec::UninitializedState::onAllocateComponent(const sp<AMessage> &msg) {
     mCodec->mQuirks = quirks;
     mCodec->mOMX = omx;
     mCodec->mNode = node;
+    mCodec->mObserver = observer;
+    // Known from the name alone, also when allocated by name.
+    mCodec->mComponentReusable = !encoder && isPoolableComponent(componentName);
+
+    // Only worth it when each call is a binder transaction.
+    mCodec->mBatchBufferOps = !omx->livesLocally(node, getpid());
 
     {
         sp<AMessage> notify = mCodec->mNotify->dup();
@@ -5262,7 +5713,17 @@ void ACodec::LoadedState::stateEntered() {
 
 void ACodec::LoadedState::onShutdown(bool keepComponentAllocated) {
     if (!keepComponentAllocated) {
-        CHECK_EQ(mCodec->mOMX->freeNode(mCodec->mNode), (status_t)OK);
+        // Encoders may have an input surface attached to the node, tunneled
+        // and secure decoders hold on to resources of the display path.
+        if (mCodec->mComponentReusable
+                && !mCodec->mTunneled
+                && !(mCodec->mFlags & kFlagIsSecure)) {
+            ComponentPool::Get()->release(
+                    mCodec->mOMX, mCodec->mComponentName, mCodec->mNode,
+                    mCodec->mObserver);
+        } else {
+            CHECK_EQ(mCodec->mOMX->freeNode(mCodec->mNode), (status_t)OK);
+        }
 
         mCodec->changeState(mCodec->mUninitializedState);
     }
@@ -5886,6 +6347,8 @@ status_t ACodec::setParameters(const sp<AMessage> &params) {
         }
     }
 
+    setVideoDecoderThreading(params, true /* whileRunning */);
+
     int32_t dummy;
     if (params->findInt32("request-sync", &dummy)) {
         status_t err = requestIDRFrame();
@@ -5899,6 +6362,132 @@ status_t ACodec::setParameters(const sp<AMessage> &params) {
     return OK;
 }
 
+// Passes "thread-count", "auto-thread-count" and (when configuring)
+// "decode-ahead-buffers" to decoders that support the threading extension.
+// These are hints, so decoders without it are not an error.
+void ACodec::setVideoDecoderThreading(const sp<AMessage> &msg, bool whileRunning) {
+    int32_t threadCount, autoThreadCount, decodeAhead;
+    bool haveThreadCount = msg->findInt32("thread-count", &threadCount);
+    bool haveAuto = msg->findInt32("auto-thread-count", &autoThreadCount);
+    bool haveDecodeAhead = !whileRunning
+            && msg->findInt32("decode-ahead-buffers", &decodeAhead);
+    if (!haveThreadCount && !haveAuto && !haveDecodeAhead) {
+        return;
+    }
+
+    OMX_INDEXTYPE index;
+    status_t err = mOMX->getExtensionIndex(
+            mNode, VIDEO_DECODER_THREADING_EXTENSION, &index);
+    if (err != OK) {
+        ALOGI("[%s] does not support decoder threading settings",
+                mComponentName.c_str());
+        return;
+    }
+
+    VideoDecoderThreadingParams params;
+    InitOMXParams(&params);
+    err = mOMX->getConfig(mNode, index, &params, sizeof(params));
+    if (err != OK) {
+        ALOGW("[%s] failed to get decoder threading (err %d)",
+                mComponentName.c_str(), err);
+        return;
+    }
+
+    if (haveThreadCount) {
+        params.nNumCores = threadCount < 0 ? 0 : threadCount;
+    }
+    if (haveAuto) {
+        params.bAutoTune = autoThreadCount ? OMX_TRUE : OMX_FALSE;
+    }
+    if (haveDecodeAhead) {
+        params.nDecodeAhead = decodeAhead < 0 ? 0 : decodeAhead;
+    }
+
+    mComponentReusable = false;
+    if (whileRunning) {
+        err = mOMX->setConfig(mNode, index, &params, sizeof(params));
+    } else {
+        err = mOMX->setParameter(mNode, index, &params, sizeof(params));
+    }
+    if (err != OK) {
+        ALOGW("[%s] failed to set decoder threading: cores %u%s, %u buffers (err %d)",
+                mComponentName.c_str(), params.nNumCores,
+                params.bAutoTune ? " (auto)" : "", params.nDecodeAhead, err);
+    }
+}
+
+// Passes "direct-output" to decoders that can decode straight into their
+// output buffers. Like the threading settings this is a hint.
+void ACodec::setVideoDecoderDirectOutput(const sp<AMessage> &msg) {
+    int32_t directOutput;
+    if (!msg->findInt32("direct-output", &directOutput)) {
+        return;
+    }
+
+    OMX_INDEXTYPE index;
+    status_t err = mOMX->getExtensionIndex(
+            mNode, VIDEO_DECODER_DIRECT_OUTPUT_EXTENSION, &index);
+    if (err != OK) {
+        ALOGI("[%s] does not support direct output", mComponentName.c_str());
+        return;
+    }
+
+    VideoDecoderDirectOutputParams params;
+    InitOMXParams(&params);
+    params.bEnable = directOutput ? OMX_TRUE : OMX_FALSE;
+    mComponentReusable = false;
+    err = mOMX->setParameter(mNode, index, &params, sizeof(params));
+    if (err != OK) {
+        ALOGW("[%s] failed to %s direct output (err %d)", mComponentName.c_str(),
+                directOutput ? "enable" : "disable", err);
+    }
+}
+
+// Passes "encode-thread-count" and "encode-segment-frames" to audio encoders
+// that can encode on several threads. Like the decoder settings these are
+// hints. The keys are separate from the decoders' "thread-count" so that a
+// client tuning its decoders does not turn on segment-parallel encoding.
+void ACodec::setAudioEncoderThreading(const sp<AMessage> &msg) {
+    int32_t threadCount, segmentFrames;
+    bool haveThreadCount = msg->findInt32("encode-thread-count", &threadCount);
+    bool haveSegmentFrames = msg->findInt32("encode-segment-frames", &segmentFrames);
+    if (!haveThreadCount && !haveSegmentFrames) {
+        return;
+    }
+
+    OMX_INDEXTYPE index;
+    status_t err = mOMX->getExtensionIndex(
+            mNode, AUDIO_ENCODER_THREADING_EXTENSION, &index);
+    if (err != OK) {
+        ALOGI("[%s] does not support encoder threading settings",
+                mComponentName.c_str());
+        return;
+    }
+
+    AudioEncoderThreadingParams params;
+    InitOMXParams(&params);
+    err = mOMX->getParameter(mNode, index, &params, sizeof(params));
+    if (err != OK) {
+        ALOGW("[%s] failed to get encoder threading (err %d)",
+                mComponentName.c_str(), err);
+        return;
+    }
+
+    if (haveThreadCount) {
+        params.nNumThreads = threadCount < 0 ? 0 : threadCount;
+    }
+    if (haveSegmentFrames) {
+        params.nSegmentFrames = segmentFrames < 0 ? 0 : segmentFrames;
+    }
+
+    err = mOMX->setParameter(mNode, index, &params, sizeof(params));
+    if (err != OK) {
+        ALOGW("[%s] failed to set encoder threading: %u threads, %u frames "
+                "per segment (err %d)", mComponentName.c_str(),
+                params.nNumThreads, params.nSegmentFrames, err);
+    }
+}
+
 void ACodec::onSignalEndOfInputStream() {
     sp<AMessage> notify = mNotify->dup();
     notify->setInt32("what", CodecBase::kWhatSignaledInputEOS);
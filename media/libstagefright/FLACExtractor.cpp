@@ -77,7 +77,9 @@ public:
         const sp<DataSource> &dataSource,
         // If metadata pointers aren't provided, we don't fill them
         const sp<MetaData> &fileMetadata = 0,
-        const sp<MetaData> &trackMetadata = 0);
+        const sp<MetaData> &trackMetadata = 0,
+        // Leave pictures out of the file metadata
+        bool metaDataOnly = false);
 
     status_t initCheck() const {
         return mInitCheck;
@@ -117,6 +119,7 @@ private:
     sp<DataSource> mDataSource;
     sp<MetaData> mFileMetadata;
     sp<MetaData> mTrackMetadata;
+    bool mMetaDataOnly;
     bool mInitCheck;
 
     // media buffers
@@ -352,7 +355,7 @@ void FLACParser::metadataCallback(const FLAC__StreamMetadata *metadata)
             vce = &vc->comments[i];
             if (mFileMetadata != 0 && vce->entry != NULL) {
                 parseVorbisComment(mFileMetadata, (const char *) vce->entry,
-                        vce->length);
+                        vce->length, mMetaDataOnly);
             }
         }
         }
@@ -485,10 +488,12 @@ static void copyTrespass(
 FLACParser::FLACParser(
         const sp<DataSource> &dataSource,
         const sp<MetaData> &fileMetadata,
-        const sp<MetaData> &trackMetadata)
+        const sp<MetaData> &trackMetadata,
+        bool metaDataOnly)
     : mDataSource(dataSource),
       mFileMetadata(fileMetadata),
       mTrackMetadata(trackMetadata),
+      mMetaDataOnly(metaDataOnly),
       mInitCheck(false),
       mMaxBufferSize(0),
       mGroup(NULL),
@@ -532,8 +537,10 @@ status_t FLACParser::init()
     FLAC__stream_decoder_set_metadata_ignore_all(mDecoder);
     FLAC__stream_decoder_set_metadata_respond(
             mDecoder, FLAC__METADATA_TYPE_STREAMINFO);
-    FLAC__stream_decoder_set_metadata_respond(
-            mDecoder, FLAC__METADATA_TYPE_PICTURE);
+    if (!mMetaDataOnly) {
+        FLAC__stream_decoder_set_metadata_respond(
+                mDecoder, FLAC__METADATA_TYPE_PICTURE);
+    }
     FLAC__stream_decoder_set_metadata_respond(
             mDecoder, FLAC__METADATA_TYPE_VORBIS_COMMENT);
     FLAC__StreamDecoderInitStatus initStatus;
@@ -786,8 +793,9 @@ status_t FLACSource::init()
 // FLACExtractor
 
 FLACExtractor::FLACExtractor(
-        const sp<DataSource> &dataSource)
+        const sp<DataSource> &dataSource, bool metaDataOnly)
     : mDataSource(dataSource),
+      mMetaDataOnly(metaDataOnly),
       mInitCheck(false)
 {
     ALOGV("FLACExtractor::FLACExtractor");
@@ -825,7 +833,8 @@ status_t FLACExtractor::init()
     mFileMetadata = new MetaData;
     mTrackMetadata = new MetaData;
     // FLACParser will fill in the metadata for us
-    mParser = new FLACParser(mDataSource, mFileMetadata, mTrackMetadata);
+    mParser = new FLACParser(
+            mDataSource, mFileMetadata, mTrackMetadata, mMetaDataOnly);
     return mParser->initCheck();
 }
 
@@ -247,9 +247,11 @@ private:
 };
 
 MP3Extractor::MP3Extractor(
-        const sp<DataSource> &source, const sp<AMessage> &meta)
+        const sp<DataSource> &source, const sp<AMessage> &meta,
+        bool metaDataOnly)
     : mInitCheck(NO_INIT),
       mDataSource(source),
+      mMetaDataOnly(metaDataOnly),
       mFirstFramePos(-1),
       mFixedHeader(0) {
     off64_t pos = 0;
@@ -350,6 +352,11 @@ MP3Extractor::MP3Extractor(
 
     mInitCheck = OK;
 
+    if (mMetaDataOnly) {
+        // Gapless playback info is of no use without playback.
+        return;
+    }
+
     // Get iTunes-style gapless info if present.
     // When getting the id3 tag, skip the V1 tags to prevent the source cache
     // from being iterated to the end of the file.
@@ -590,7 +597,7 @@ sp<MetaData> MP3Extractor::getMetaData() {
 
     meta->setCString(kKeyMIMEType, "audio/mpeg");
 
-    ID3 id3(mDataSource);
+    ID3 id3(mDataSource, false /* ignoreV1 */, 0 /* offset */, mMetaDataOnly);
 
     if (!id3.isValid()) {
         return meta;
@@ -109,6 +109,9 @@ public:
     virtual sp<MetaData> getFormat();
 
     virtual status_t read(MediaBuffer **buffer, const ReadOptions *options = NULL);
+    virtual status_t readInto(
+            void *data, size_t capacity, size_t *size, sp<MetaData> *meta,
+            const ReadOptions *options = NULL);
     virtual status_t fragmentedRead(MediaBuffer **buffer, const ReadOptions *options = NULL);
 
 protected:
@@ -161,6 +164,11 @@ private:
 
     uint8_t *mSrcBuffer;
 
+    // Wraps the caller's memory during readInto(), read_l() then uses it
+    // instead of a buffer from mGroup.
+    MediaBuffer *mClientBuffer;
+
+    status_t read_l(MediaBuffer **buffer, const ReadOptions *options);
     size_t parseNALSize(const uint8_t *data) const;
     status_t parseChunk(off64_t *offset);
     status_t parseTrackFragmentHeader(off64_t offset, off64_t size);
@@ -441,9 +449,20 @@ static bool AdjustChannelsAndRate(uint32_t fourcc, uint32_t *channels, uint32_t
     return false;
 }
 
-MPEG4Extractor::MPEG4Extractor(const sp<DataSource> &source)
+// The boxes SampleTable::isValid() requires. A metadata-only extractor loads
+// only some of them, so verifyTrack() checks that they were all found.
+enum {
+    kChunkOffsetBox     = 1,
+    kSampleToChunkBox   = 2,
+    kSampleSizeBox      = 4,
+    kTimeToSampleBox    = 8,
+    kSampleTableBoxes   = 15,
+};
+
+MPEG4Extractor::MPEG4Extractor(const sp<DataSource> &source, bool metaDataOnly)
     : mMoofOffset(0),
       mDataSource(source),
+      mMetaDataOnly(metaDataOnly),
       mInitCheck(NO_INIT),
       mHasVideo(false),
       mHeaderTimescale(0),
@@ -549,7 +568,7 @@ sp<MetaData> MPEG4Extractor::getTrackMetaData(
                     track->meta->setInt64(
                             kKeyThumbnailTime, duration / 4);
                 }
-            } else {
+            } else if (!mMetaDataOnly) {
                 uint32_t sampleIndex;
                 uint32_t sampleTime;
                 if (track->sampleTable->findThumbnailSample(&sampleIndex) == OK
@@ -961,9 +980,10 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
             if (chunk_type == FOURCC('s', 't', 'b', 'l')) {
                 ALOGV("sampleTable chunk is %" PRIu64 " bytes long.", chunk_size);
 
-                if (mDataSource->flags()
-                        & (DataSource::kWantsPrefetching
-                            | DataSource::kIsCachingDataSource)) {
+                if (!mMetaDataOnly
+                        && (mDataSource->flags()
+                            & (DataSource::kWantsPrefetching
+                                | DataSource::kIsCachingDataSource))) {
                     sp<MPEG4DataSource> cachedSource =
                         new MPEG4DataSource(mDataSource);
 
@@ -991,6 +1011,7 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
                 track->meta = new MetaData;
                 track->includes_expensive_metadata = false;
                 track->skipTrack = false;
+                track->sampleTableBoxes = 0;
                 track->timescale = 0;
                 track->meta->setCString(kKeyMIMEType, "application/octet-stream");
             }
@@ -1589,11 +1610,19 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
                 return err;
             }
 
+            mLastTrack->sampleTableBoxes |= kChunkOffsetBox;
             break;
         }
 
         case FOURCC('s', 't', 's', 'c'):
         {
+            mLastTrack->sampleTableBoxes |= kSampleToChunkBox;
+
+            if (mMetaDataOnly) {
+                *offset += chunk_size;
+                break;
+            }
+
             status_t err =
                 mLastTrack->sampleTable->setSampleToChunkParams(
                         data_offset, chunk_data_size);
@@ -1620,11 +1649,17 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
                 return err;
             }
 
-            size_t max_size;
-            err = mLastTrack->sampleTable->getMaxSampleSize(&max_size);
+            mLastTrack->sampleTableBoxes |= kSampleSizeBox;
 
-            if (err != OK) {
-                return err;
+            // Finding the largest sample reads the whole table, a
+            // metadata-only extractor settles for the estimate below.
+            size_t max_size = 0;
+            if (!mMetaDataOnly) {
+                err = mLastTrack->sampleTable->getMaxSampleSize(&max_size);
+
+                if (err != OK) {
+                    return err;
+                }
             }
 
             if (max_size != 0) {
@@ -1681,6 +1716,12 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
         {
             *offset += chunk_size;
 
+            mLastTrack->sampleTableBoxes |= kTimeToSampleBox;
+
+            if (mMetaDataOnly) {
+                break;
+            }
+
             status_t err =
                 mLastTrack->sampleTable->setTimeToSampleParams(
                         data_offset, chunk_data_size);
@@ -1696,6 +1737,10 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
         {
             *offset += chunk_size;
 
+            if (mMetaDataOnly) {
+                break;
+            }
+
             status_t err =
                 mLastTrack->sampleTable->setCompositionTimeToSampleParams(
                         data_offset, chunk_data_size);
@@ -1717,7 +1762,7 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
             // available in this block, sometimes 0, which is undesired.
             const char *mime;
             CHECK(mLastTrack->meta->findCString(kKeyMIMEType, &mime));
-            if (strncasecmp("audio/", mime, 6)) {
+            if (!mMetaDataOnly && strncasecmp("audio/", mime, 6)) {
                 status_t err =
                     mLastTrack->sampleTable->setSyncSampleParams(
                             data_offset, chunk_data_size);
@@ -2133,7 +2178,7 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
         {
             *offset += chunk_size;
 
-            if (mFileMetaData != NULL) {
+            if (mFileMetaData != NULL && !mMetaDataOnly) {
                 ALOGV("chunk_data_size = %lld and data_offset = %lld",
                         chunk_data_size, data_offset);
                 sp<ABuffer> buffer = new ABuffer(chunk_data_size + 1);
@@ -2420,6 +2465,11 @@ status_t MPEG4Extractor::parseITunesMetaData(off64_t offset, size_t size) {
         return ERROR_MALFORMED;
     }
 
+    if (mMetaDataOnly && mPath[4] == FOURCC('c', 'o', 'v', 'r')) {
+        // Don't read the picture.
+        return OK;
+    }
+
     uint8_t *buffer = new (std::nothrow) uint8_t[size + 1];
     if (buffer == NULL) {
         return ERROR_MALFORMED;
@@ -2717,7 +2767,7 @@ status_t MPEG4Extractor::parse3GPPMetaData(off64_t offset, size_t size, int dept
 }
 
 void MPEG4Extractor::parseID3v2MetaData(off64_t offset) {
-    ID3 id3(mDataSource, true /* ignorev1 */, offset);
+    ID3 id3(mDataSource, true /* ignorev1 */, offset, mMetaDataOnly);
 
     if (id3.isValid()) {
         struct Map {
@@ -2774,7 +2824,7 @@ void MPEG4Extractor::parseID3v2MetaData(off64_t offset) {
 
 sp<MediaSource> MPEG4Extractor::getTrack(size_t index) {
     status_t err;
-    if ((err = readMetaData()) != OK) {
+    if (mMetaDataOnly || (err = readMetaData()) != OK) {
         return NULL;
     }
 
@@ -2812,7 +2862,6 @@ sp<MediaSource> MPEG4Extractor::getTrack(size_t index) {
             mSidxEntries, trex, mMoofOffset);
 }
 
-// static
 status_t MPEG4Extractor::verifyTrack(Track *track) {
     const char *mime;
     CHECK(track->meta->findCString(kKeyMIMEType, &mime));
@@ -2838,7 +2887,12 @@ status_t MPEG4Extractor::verifyTrack(Track *track) {
         }
     }
 
-    if (track->sampleTable == NULL || !track->sampleTable->isValid()) {
+    bool sampleTableValid = track->sampleTable != NULL
+            && (mMetaDataOnly
+                ? track->sampleTableBoxes == kSampleTableBoxes
+                : track->sampleTable->isValid());
+
+    if (!sampleTableValid) {
         // Make sure we have all the metadata we need.
         ALOGE("stbl atom missing/invalid.");
         return ERROR_MALFORMED;
@@ -3192,7 +3246,8 @@ MPEG4Source::MPEG4Source(
       mGroup(NULL),
       mBuffer(NULL),
       mWantsNALFragments(false),
-      mSrcBuffer(NULL) {
+      mSrcBuffer(NULL),
+      mClientBuffer(NULL) {
 #ifdef DOLBY_UDC
       DLOGD("@DDP MPEG4Source::MPEG4Source");
 #endif // DOLBY_END
@@ -3886,6 +3941,52 @@ status_t MPEG4Source::read(
         return fragmentedRead(out, options);
     }
 
+    return read_l(out, options);
+}
+
+status_t MPEG4Source::readInto(
+        void *data, size_t capacity, size_t *size, sp<MetaData> *meta,
+        const ReadOptions *options) {
+    if (mFirstMoofOffset > 0 || mWantsNALFragments) {
+        // Fragments are read through their own path, and NAL fragments
+        // point into a sample that has to be kept around between reads.
+        return MediaSource::readInto(data, capacity, size, meta, options);
+    }
+
+    Mutex::Autolock autoLock(mLock);
+
+    CHECK(mStarted);
+    CHECK(mBuffer == NULL);
+
+    mClientBuffer = new MediaBuffer(data, capacity);
+
+    MediaBuffer *buffer;
+    status_t err = read_l(&buffer, options);
+
+    if (mClientBuffer != NULL) {
+        // read_l() failed before it got to use it.
+        mClientBuffer->release();
+        mClientBuffer = NULL;
+    }
+
+    if (err != OK) {
+        return err;
+    }
+
+    CHECK_EQ(buffer->data(), data);
+    CHECK_EQ(buffer->range_offset(), 0u);
+
+    *size = buffer->range_length();
+    *meta = buffer->meta_data();
+
+    buffer->release();
+    buffer = NULL;
+
+    return OK;
+}
+
+status_t MPEG4Source::read_l(
+        MediaBuffer **out, const ReadOptions *options) {
     *out = NULL;
 
     int64_t targetSampleTimeUs = -1;
@@ -3980,6 +4081,17 @@ status_t MPEG4Source::read(
     if (mBuffer == NULL) {
         newBuffer = true;
 
+        if (options && options->getSyncFramesOnly()) {
+            // Step over everything up to the next entry in 'stss', none of
+            // it is read.
+            status_t err = mSampleTable->findNextSyncSample(
+                    mCurrentSampleIndex, &mCurrentSampleIndex);
+
+            if (err != OK) {
+                return err;
+            }
+        }
+
         status_t err =
             mSampleTable->getMetaDataForSample(
                     mCurrentSampleIndex, &offset, &size, &cts, &isSyncSample, &stts);
@@ -3988,16 +4100,31 @@ status_t MPEG4Source::read(
             return err;
         }
 
-        err = mGroup->acquire_buffer(&mBuffer);
+        if (mClientBuffer != NULL) {
+            mBuffer = mClientBuffer;
+            mClientBuffer = NULL;
+        } else {
+            err = mGroup->acquire_buffer(&mBuffer);
 
-        if (err != OK) {
-            CHECK(mBuffer == NULL);
-            return err;
+            if (err != OK) {
+                CHECK(mBuffer == NULL);
+                return err;
+            }
         }
     }
 
     if ((!mIsAVC && !mIsHEVC) || mWantsNALFragments) {
         if (newBuffer) {
+            if (size > mBuffer->size()) {
+                ALOGE("sample of %zu bytes does not fit a buffer of %zu",
+                      size, mBuffer->size());
+
+                mBuffer->release();
+                mBuffer = NULL;
+
+                return ERROR_BUFFER_TOO_SMALL;
+            }
+
             ssize_t num_bytes_read =
                 mDataSource->readAt(offset, (uint8_t *)mBuffer->data(), size);
 
@@ -4076,7 +4203,21 @@ status_t MPEG4Source::read(
         ssize_t num_bytes_read = 0;
         int32_t drm = 0;
         bool usesDRM = (mFormat->findInt32(kKeyIsDRM, &drm) && drm != 0);
-        if (usesDRM) {
+
+        // 4 byte lengths are replaced by start codes where they are, so only
+        // shorter ones need the sample read aside first.
+        bool inPlace = usesDRM || mNALLengthSize == 4;
+        if (inPlace) {
+            if (size > mBuffer->size()) {
+                ALOGE("sample of %zu bytes does not fit a buffer of %zu",
+                      size, mBuffer->size());
+
+                mBuffer->release();
+                mBuffer = NULL;
+
+                return ERROR_BUFFER_TOO_SMALL;
+            }
+
             num_bytes_read =
                 mDataSource->readAt(offset, (uint8_t*)mBuffer->data(), size);
         } else {
@@ -4094,6 +4235,47 @@ status_t MPEG4Source::read(
             CHECK(mBuffer != NULL);
             mBuffer->set_range(0, size);
 
+        } else if (inPlace) {
+            uint8_t *data = (uint8_t *)mBuffer->data();
+            size_t srcOffset = 0;
+            size_t dstOffset = 0;
+
+            while (srcOffset < size) {
+                bool isMalFormed = (srcOffset + 4 > size);
+                size_t nalLength = 0;
+                if (!isMalFormed) {
+                    nalLength = U32_AT(&data[srcOffset]);
+                    srcOffset += 4;
+                    isMalFormed = nalLength > size - srcOffset;
+                }
+
+                if (isMalFormed) {
+                    ALOGE("Video is malformed");
+                    mBuffer->release();
+                    mBuffer = NULL;
+                    return ERROR_MALFORMED;
+                }
+
+                if (nalLength == 0) {
+                    continue;
+                }
+
+                // Only empty NAL units, which are dropped, leave a gap to
+                // close.
+                if (dstOffset + 4 != srcOffset) {
+                    memmove(&data[dstOffset + 4], &data[srcOffset], nalLength);
+                }
+
+                data[dstOffset++] = 0;
+                data[dstOffset++] = 0;
+                data[dstOffset++] = 0;
+                data[dstOffset++] = 1;
+                srcOffset += nalLength;
+                dstOffset += nalLength;
+            }
+            CHECK_EQ(srcOffset, size);
+            CHECK(mBuffer != NULL);
+            mBuffer->set_range(0, dstOffset);
         } else {
             uint8_t *dstData = (uint8_t *)mBuffer->data();
             size_t srcOffset = 0;
@@ -4119,7 +4301,13 @@ status_t MPEG4Source::read(
                     continue;
                 }
 
-                CHECK(dstOffset + 4 <= mBuffer->size());
+                if (dstOffset + 4 + nalLength > mBuffer->size()) {
+                    ALOGE("sample does not fit a buffer of %zu bytes once "
+                          "start codes are added", mBuffer->size());
+                    mBuffer->release();
+                    mBuffer = NULL;
+                    return ERROR_BUFFER_TOO_SMALL;
+                }
 
                 dstData[dstOffset++] = 0;
                 dstData[dstOffset++] = 0;
@@ -4225,6 +4413,16 @@ status_t MPEG4Source::fragmentedRead(
     if (mBuffer == NULL) {
         newBuffer = true;
 
+        if (options && options->getSyncFramesOnly()
+                && mCurrentSampleIndex > 0) {
+            // Only the first sample of a fragment is taken to be a sync
+            // sample (see below), skip to the next fragment.
+            while (mCurrentSampleIndex < mCurrentSamples.size()) {
+                mCurrentTime += mCurrentSamples[mCurrentSampleIndex].duration;
+                ++mCurrentSampleIndex;
+            }
+        }
+
         if (mCurrentSampleIndex >= mCurrentSamples.size()) {
             // move to next fragment if there is one
             if (mNextMoofOffset <= mCurrentMoofOffset) {
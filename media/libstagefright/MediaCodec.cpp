@@ -137,6 +137,11 @@ sp<MediaCodec> MediaCodec::CreateByComponentName(
     return ret == OK ? codec : NULL; // NULL deallocates codec.
 }
 
+// static
+void MediaCodec::PrewarmByType(const char *mime) {
+    ACodec::PrewarmDecoder(mime);
+}
+
 MediaCodec::MediaCodec(const sp<ALooper> &looper)
     : mState(UNINITIALIZED),
       mLooper(looper),
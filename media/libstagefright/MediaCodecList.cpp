@@ -18,7 +18,15 @@
 #define LOG_TAG "MediaCodecList"
 #include <utils/Log.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cutils/properties.h>
+
 #include <binder/IServiceManager.h>
+#include <binder/Parcel.h>
 
 #include <media/IMediaCodecList.h>
 #include <media/IMediaPlayerService.h>
@@ -74,6 +82,14 @@ void MediaCodecList::BinderDeathObserver::binderDied(const wp<IBinder> &who __un
 sp<IMediaCodecList> MediaCodecList::getInstance() {
     Mutex::Autolock _l(sRemoteInitMutex);
     if (sRemoteList == NULL) {
+        // A list of our own loaded from the cache saves a binder transaction
+        // per lookup.
+        sp<MediaCodecList> cachedList = new MediaCodecList(true /* cacheOnly */);
+        if (cachedList->initCheck() == OK) {
+            sRemoteList = cachedList;
+            return sRemoteList;
+        }
+
         sp<IBinder> binder =
             defaultServiceManager()->getService(String16("media.player"));
         sp<IMediaPlayerService> service =
@@ -93,9 +109,280 @@ sp<IMediaCodecList> MediaCodecList::getInstance() {
     return sRemoteList;
 }
 
-MediaCodecList::MediaCodecList()
+// static
+const char *MediaCodecList::kCachePath = "/data/misc/media/media_codecs.cache";
+
+MediaCodecList::MediaCodecList(bool cacheOnly)
     : mInitCheck(NO_INIT) {
-    parseTopLevelXMLFile("/etc/media_codecs.xml");
+    // Checking the cache neither connects to OMX nor reads the XML files
+    // unless the cache file itself can be read.
+    if (loadCache(kCachePath) != OK) {
+        if (cacheOnly) {
+            return;
+        }
+
+        parseTopLevelXMLFile("/etc/media_codecs.xml");
+
+        if (mInitCheck == OK) {
+            writeCache(kCachePath);
+        }
+    }
+
+    buildIndex();
+}
+
+// The cache file is a CacheHeader followed by a parcel holding the XML file
+// names and then the MediaCodecInfos, as they are sent over binder.
+struct CacheHeader {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint64_t mKey;
+    uint64_t mDataSize;
+};
+
+static const uint32_t kCacheMagic = 'MCLc';
+// Bump whenever the layout of the cache or the parcel form of MediaCodecInfo
+// changes.
+static const uint32_t kCacheVersion = 2;
+
+// The libraries OMXMaster loads components from, besides those built into
+// the system image.  See OMXMaster::addVendorPlugin().
+static const char *kOMXPluginPaths[] = {
+    "/vendor/lib/libstagefrighthw.so",
+    "/system/lib/libstagefrighthw.so",
+};
+
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size) {
+    // 64 bit FNV-1a
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hashFileIdentity(uint64_t hash, const char *path) {
+    hash = hashBytes(hash, path, strlen(path) + 1);
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        // a library that is missing now may be present later
+        return hashBytes(hash, "-", 1);
+    }
+    uint64_t identity[] = {
+        (uint64_t)st.st_dev, (uint64_t)st.st_ino, (uint64_t)st.st_size,
+        (uint64_t)st.st_mtime, (uint64_t)st.st_ctime,
+    };
+    return hashBytes(hash, identity, sizeof(identity));
+}
+
+// Hashes what decides the list: the build, the OMX plugin libraries that
+// supply the components, and the names and contents of the XML files.
+static status_t computeCacheKey(const Vector<AString> &files, uint64_t *key) {
+    uint64_t hash = 14695981039346656037ull;
+
+    hash = hashBytes(hash, &kCacheVersion, sizeof(kCacheVersion));
+
+    char fingerprint[PROPERTY_VALUE_MAX];
+    property_get("ro.build.fingerprint", fingerprint, "");
+    hash = hashBytes(hash, fingerprint, strlen(fingerprint) + 1);
+
+    for (size_t i = 0; i < ARRAY_SIZE(kOMXPluginPaths); ++i) {
+        hash = hashFileIdentity(hash, kOMXPluginPaths[i]);
+    }
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        const AString &path = files.itemAt(i);
+        hash = hashBytes(hash, path.c_str(), path.size() + 1);
+
+        FILE *file = fopen(path.c_str(), "r");
+        if (file == NULL) {
+            return NAME_NOT_FOUND;
+        }
+
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            hash = hashBytes(hash, buffer, n);
+        }
+
+        bool failed = ferror(file);
+        fclose(file);
+        if (failed) {
+            return ERROR_IO;
+        }
+    }
+
+    *key = hash;
+    return OK;
+}
+
+status_t MediaCodecList::loadCache(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NAME_NOT_FOUND;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CacheHeader)) {
+        close(fd);
+        return ERROR_MALFORMED;
+    }
+
+    size_t size = st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return ERROR_IO;
+    }
+
+    status_t err = parseCache(static_cast<const uint8_t *>(data), size);
+    munmap(data, size);
+
+    if (err != OK) {
+        ALOGI("not using %s (err %d)", path, err);
+        mXMLFiles.clear();
+        mCodecInfos.clear();
+        return err;
+    }
+
+    ALOGV("loaded %zu codecs from %s", mCodecInfos.size(), path);
+    mInitCheck = OK;
+    return OK;
+}
+
+status_t MediaCodecList::parseCache(const uint8_t *data, size_t size) {
+    CacheHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    if (header.mMagic != kCacheMagic || header.mVersion != kCacheVersion
+            || header.mDataSize != size - sizeof(header)) {
+        return ERROR_MALFORMED;
+    }
+
+    Parcel parcel;
+    parcel.setData(data + sizeof(header), header.mDataSize);
+
+    size_t numFiles = static_cast<size_t>(parcel.readInt32());
+    if (numFiles > parcel.dataAvail()) {
+        return ERROR_MALFORMED;
+    }
+    for (size_t i = 0; i < numFiles; ++i) {
+        mXMLFiles.push_back(AString::FromParcel(parcel));
+    }
+
+    uint64_t key;
+    status_t err = computeCacheKey(mXMLFiles, &key);
+    if (err != OK) {
+        return err;
+    } else if (key != header.mKey) {
+        // The build, the OMX libraries or the files have changed since.
+        return ERROR_MALFORMED;
+    }
+
+    size_t numCodecs = static_cast<size_t>(parcel.readInt32());
+    if (numCodecs > parcel.dataAvail()) {
+        return ERROR_MALFORMED;
+    }
+    for (size_t i = 0; i < numCodecs; ++i) {
+        sp<MediaCodecInfo> info = MediaCodecInfo::FromParcel(parcel);
+        if (info == NULL) {
+            return ERROR_MALFORMED;
+        }
+        mCodecInfos.push_back(info);
+    }
+
+    return OK;
+}
+
+void MediaCodecList::writeCache(const char *path) const {
+    CacheHeader header;
+    header.mMagic = kCacheMagic;
+    header.mVersion = kCacheVersion;
+    if (computeCacheKey(mXMLFiles, &header.mKey) != OK) {
+        return;
+    }
+
+    Parcel parcel;
+    parcel.writeInt32(mXMLFiles.size());
+    for (size_t i = 0; i < mXMLFiles.size(); ++i) {
+        mXMLFiles.itemAt(i).writeToParcel(&parcel);
+    }
+    parcel.writeInt32(mCodecInfos.size());
+    for (size_t i = 0; i < mCodecInfos.size(); ++i) {
+        mCodecInfos.itemAt(i)->writeToParcel(&parcel);
+    }
+    header.mDataSize = parcel.dataSize();
+
+    // Readers only ever see a complete file.
+    AString tmpPath = path;
+    tmpPath.append(".tmp");
+
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        ALOGV("cannot create %s: %s", tmpPath.c_str(), strerror(errno));
+        return;
+    }
+
+    bool ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)
+        && write(fd, parcel.data(), parcel.dataSize())
+                == (ssize_t)parcel.dataSize();
+    close(fd);
+
+    if (!ok || rename(tmpPath.c_str(), path) != 0) {
+        ALOGW("failed to write %s", path);
+        unlink(tmpPath.c_str());
+    }
+}
+
+static bool isAdvancedCodec(const sp<MediaCodecInfo::Capabilities> &caps) {
+    static const char *advancedFeatures[] = {
+        "feature-secure-playback",
+        "feature-tunneled-playback",
+    };
+
+    const sp<AMessage> &details = caps->getDetails();
+    for (size_t ix = 0; ix < ARRAY_SIZE(advancedFeatures); ix++) {
+        int32_t required;
+        if (details->findInt32(advancedFeatures[ix], &required) &&
+                required != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MediaCodecList::buildIndex() {
+    for (size_t i = 0; i < mCodecInfos.size(); ++i) {
+        const MediaCodecInfo &info = *mCodecInfos.itemAt(i).get();
+
+        if (mCodecIndexByName.indexOfKey(info.mName) < 0) {
+            mCodecIndexByName.add(info.mName, i);
+        }
+
+        KeyedVector<AString, Vector<size_t> > &byType =
+            mLegacyCodecsByType[info.mIsEncoder ? 1 : 0];
+
+        for (size_t j = 0; j < info.mCaps.size(); ++j) {
+            if (isAdvancedCodec(info.mCaps.valueAt(j))) {
+                continue;
+            }
+
+            AString type = info.mCaps.keyAt(j);
+            type.tolower();
+
+            ssize_t index = byType.indexOfKey(type);
+            if (index < 0) {
+                index = byType.add(type, Vector<size_t>());
+            }
+            Vector<size_t> &indices = byType.editValueAt(index);
+            if (indices.isEmpty() || indices.itemAt(indices.size() - 1) != i) {
+                indices.push_back(i);
+            }
+        }
+    }
 }
 
 void MediaCodecList::parseTopLevelXMLFile(const char *codecs_xml) {
@@ -210,6 +497,8 @@ void MediaCodecList::parseXMLFile(const char *path) {
         return;
     }
 
+    mXMLFiles.push_back(path);
+
     XML_Parser parser = ::XML_ParserCreate(NULL);
     CHECK(parser != NULL);
 
@@ -589,36 +878,21 @@ status_t MediaCodecList::addTypeFromAttributes(const char **attrs) {
 // legacy method for non-advanced codecs
 ssize_t MediaCodecList::findCodecByType(
         const char *type, bool encoder, size_t startIndex) const {
-    static const char *advancedFeatures[] = {
-        "feature-secure-playback",
-        "feature-tunneled-playback",
-    };
+    AString key = type;
+    key.tolower();
 
-    size_t numCodecs = mCodecInfos.size();
-    for (; startIndex < numCodecs; ++startIndex) {
-        const MediaCodecInfo &info = *mCodecInfos.itemAt(startIndex).get();
-
-        if (info.isEncoder() != encoder) {
-            continue;
-        }
-        sp<MediaCodecInfo::Capabilities> capabilities = info.getCapabilitiesFor(type);
-        if (capabilities == NULL) {
-            continue;
-        }
-        const sp<AMessage> &details = capabilities->getDetails();
+    const KeyedVector<AString, Vector<size_t> > &byType =
+        mLegacyCodecsByType[encoder ? 1 : 0];
 
-        int32_t required;
-        bool isAdvanced = false;
-        for (size_t ix = 0; ix < ARRAY_SIZE(advancedFeatures); ix++) {
-            if (details->findInt32(advancedFeatures[ix], &required) &&
-                    required != 0) {
-                isAdvanced = true;
-                break;
-            }
-        }
+    ssize_t index = byType.indexOfKey(key);
+    if (index < 0) {
+        return -ENOENT;
+    }
 
-        if (!isAdvanced) {
-            return startIndex;
+    const Vector<size_t> &indices = byType.valueAt(index);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (indices.itemAt(i) >= startIndex) {
+            return indices.itemAt(i);
         }
     }
 
@@ -845,15 +1119,12 @@ status_t MediaCodecList::addFeature(const char **attrs) {
 }
 
 ssize_t MediaCodecList::findCodecByName(const char *name) const {
-    for (size_t i = 0; i < mCodecInfos.size(); ++i) {
-        const MediaCodecInfo &info = *mCodecInfos.itemAt(i).get();
-
-        if (info.mName == name) {
-            return i;
-        }
+    ssize_t index = mCodecIndexByName.indexOfKey(AString(name));
+    if (index < 0) {
+        return -ENOENT;
     }
 
-    return -ENOENT;
+    return mCodecIndexByName.valueAt(index);
 }
 
 size_t MediaCodecList::countCodecs() const {
@@ -14,7 +14,10 @@
  * limitations under the License.
  */
 
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
 
 namespace android {
 
@@ -22,6 +25,36 @@ MediaSource::MediaSource() {}
 
 MediaSource::~MediaSource() {}
 
+status_t MediaSource::readInto(
+        void *data, size_t capacity, size_t *size, sp<MetaData> *meta,
+        const ReadOptions *options) {
+    MediaBuffer *buffer;
+    status_t err = read(&buffer, options);
+
+    if (err != OK) {
+        return err;
+    }
+
+    size_t length = buffer->range_length();
+    if (length > capacity) {
+        buffer->release();
+        return ERROR_BUFFER_TOO_SMALL;
+    }
+
+    memcpy(data,
+           (const uint8_t *)buffer->data() + buffer->range_offset(),
+           length);
+
+    *size = length;
+
+    // The buffer's own meta data is cleared once it is back in its group.
+    *meta = new MetaData(*buffer->meta_data().get());
+
+    buffer->release();
+
+    return OK;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 MediaSource::ReadOptions::ReadOptions() {
@@ -74,4 +107,16 @@ int64_t MediaSource::ReadOptions::getLateBy() const {
     return mLatenessUs;
 }
 
+void MediaSource::ReadOptions::setSyncFramesOnly() {
+    mOptions |= kSyncFramesOnly_Option;
+}
+
+void MediaSource::ReadOptions::clearSyncFramesOnly() {
+    mOptions &= ~kSyncFramesOnly_Option;
+}
+
+bool MediaSource::ReadOptions::getSyncFramesOnly() const {
+    return (mOptions & kSyncFramesOnly_Option) != 0;
+}
+
 }  // namespace android
@@ -304,6 +304,14 @@ status_t NuMediaExtractor::selectTrack(size_t index) {
     info->mSampleTimeUs = -1ll;
     info->mTrackFlags = 0;
 
+    int32_t maxSampleSize;
+    if (info->mSource->getFormat()->findInt32(kKeyMaxInputSize, &maxSampleSize)
+            && maxSampleSize > 0) {
+        info->mMaxSampleSize = maxSampleSize;
+    } else {
+        info->mMaxSampleSize = 0;
+    }
+
     if (!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_VORBIS)) {
         info->mTrackFlags |= kIsVorbis;
     }
@@ -462,6 +470,11 @@ status_t NuMediaExtractor::readSampleData(const sp<ABuffer> &buffer) {
 
     TrackInfo *info = &mSelectedTracks.editItemAt(minIndex);
 
+    return copySampleData(info, buffer);
+}
+
+status_t NuMediaExtractor::copySampleData(
+        TrackInfo *info, const sp<ABuffer> &buffer) {
     size_t sampleSize = info->mSample->range_length();
 
     if (info->mTrackFlags & kIsVorbis) {
@@ -497,6 +510,93 @@ status_t NuMediaExtractor::readSampleData(const sp<ABuffer> &buffer) {
     return OK;
 }
 
+status_t NuMediaExtractor::readSampleDataAndAdvance(
+        const sp<ABuffer> &buffer, size_t *trackIndex,
+        sp<MetaData> *sampleMeta) {
+    Mutex::Autolock autoLock(mLock);
+
+    *sampleMeta = NULL;
+
+    TrackInfo *info = NULL;
+    if (mSelectedTracks.size() == 1) {
+        info = &mSelectedTracks.editItemAt(0);
+    }
+
+    // With a single track there is nothing to order samples by, so the next
+    // one need not be read ahead and can go straight into |buffer|.
+    size_t capacity = buffer->capacity();
+    if (info != NULL && (info->mTrackFlags & kIsVorbis)) {
+        capacity = capacity > sizeof(int32_t) ? capacity - sizeof(int32_t) : 0;
+    }
+
+    if (info != NULL && info->mSample == NULL && info->mMaxSampleSize > 0
+            && info->mMaxSampleSize <= capacity) {
+        if (info->mFinalResult != OK) {
+            return ERROR_END_OF_STREAM;
+        }
+
+        size_t size;
+        sp<MetaData> meta;
+        status_t err = info->mSource->readInto(
+                buffer->base(), capacity, &size, &meta);
+
+        if (err != OK) {
+            info->mFinalResult = err;
+
+            if (err != ERROR_END_OF_STREAM) {
+                ALOGW("read on track %zu failed with error %d",
+                      info->mTrackIndex, err);
+            }
+
+            return ERROR_END_OF_STREAM;
+        }
+
+        if (info->mTrackFlags & kIsVorbis) {
+            int32_t numPageSamples;
+            if (!meta->findInt32(kKeyValidSamples, &numPageSamples)) {
+                numPageSamples = -1;
+            }
+
+            memcpy(buffer->base() + size,
+                   &numPageSamples,
+                   sizeof(numPageSamples));
+
+            size += sizeof(numPageSamples);
+        }
+
+        buffer->setRange(0, size);
+
+        *trackIndex = info->mTrackIndex;
+        *sampleMeta = meta;
+
+        return OK;
+    }
+
+    ssize_t minIndex = fetchTrackSamples();
+
+    if (minIndex < 0) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    info = &mSelectedTracks.editItemAt(minIndex);
+
+    status_t err = copySampleData(info, buffer);
+    if (err != OK) {
+        return err;
+    }
+
+    *trackIndex = info->mTrackIndex;
+
+    // The sample's own meta data is cleared once it is released.
+    *sampleMeta = new MetaData(*info->mSample->meta_data().get());
+
+    info->mSample->release();
+    info->mSample = NULL;
+    info->mSampleTimeUs = -1ll;
+
+    return OK;
+}
+
 status_t NuMediaExtractor::getSampleTrackIndex(size_t *trackIndex) {
     Mutex::Autolock autoLock(mLock);
 
@@ -1724,6 +1724,7 @@ OMXCodec::OMXCodec(
       mOutputPortSettingsHaveChanged(false),
       mSeekTimeUs(-1),
       mSeekMode(ReadOptions::SEEK_CLOSEST_SYNC),
+      mSyncFramesOnly(false),
       mTargetTimeUs(-1),
       mOutputPortSettingsChangedPending(false),
       mSkipCutBuffer(NULL),
@@ -3537,6 +3538,7 @@ bool OMXCodec::drainInputBuffer(BufferInfo *info) {
 
     for (;;) {
         MediaBuffer *srcBuffer;
+        sp<MetaData> srcMeta;
         if (mSeekTimeUs >= 0) {
             if (mLeftOverBuffer) {
                 mLeftOverBuffer->release();
@@ -3544,17 +3546,20 @@ bool OMXCodec::drainInputBuffer(BufferInfo *info) {
             }
 
             MediaSource::ReadOptions options;
+            if (mSyncFramesOnly) {
+                options.setSyncFramesOnly();
+            }
             options.setSeekTo(mSeekTimeUs, mSeekMode);
 
             mSeekTimeUs = -1;
             mSeekMode = ReadOptions::SEEK_CLOSEST_SYNC;
             mBufferFilled.signal();
 
-            err = mSource->read(&srcBuffer, &options);
+            err = readSourceBuffer(info, options, &srcBuffer, &srcMeta);
 
             if (err == OK) {
                 int64_t targetTimeUs;
-                if (srcBuffer->meta_data()->findInt64(
+                if (srcMeta->findInt64(
                             kKeyTargetTime, &targetTimeUs)
                         && targetTimeUs >= 0) {
                     CODEC_LOGV("targetTimeUs = %lld us", targetTimeUs);
@@ -3565,11 +3570,16 @@ bool OMXCodec::drainInputBuffer(BufferInfo *info) {
             }
         } else if (mLeftOverBuffer) {
             srcBuffer = mLeftOverBuffer;
+            srcMeta = srcBuffer->meta_data();
             mLeftOverBuffer = NULL;
 
             err = OK;
         } else {
-            err = mSource->read(&srcBuffer);
+            MediaSource::ReadOptions options;
+            if (mSyncFramesOnly) {
+                options.setSyncFramesOnly();
+            }
+            err = readSourceBuffer(info, options, &srcBuffer, &srcMeta);
         }
 
         if (err != OK) {
@@ -3621,7 +3631,7 @@ bool OMXCodec::drainInputBuffer(BufferInfo *info) {
 
                 CHECK(info->mMediaBuffer == NULL);
                 info->mMediaBuffer = srcBuffer;
-        } else {
+        } else if (srcBuffer->data() != (uint8_t *)info->mData + offset) {
             CHECK(srcBuffer->data() != NULL) ;
             memcpy((uint8_t *)info->mData + offset,
                     (const uint8_t *)srcBuffer->data()
@@ -3630,7 +3640,7 @@ bool OMXCodec::drainInputBuffer(BufferInfo *info) {
         }
 
         int64_t lastBufferTimeUs;
-        CHECK(srcBuffer->meta_data()->findInt64(kKeyTime, &lastBufferTimeUs));
+        CHECK(srcMeta->findInt64(kKeyTime, &lastBufferTimeUs));
         CHECK(lastBufferTimeUs >= 0);
 
         PLAYER_STATS(logBitRate, srcBuffer->range_length(), lastBufferTimeUs);
@@ -3650,7 +3660,7 @@ bool OMXCodec::drainInputBuffer(BufferInfo *info) {
             CHECK_GE(info->mSize, offset + sizeof(int32_t));
 
             int32_t numPageSamples;
-            if (!srcBuffer->meta_data()->findInt32(
+            if (!srcMeta->findInt32(
                         kKeyValidSamples, &numPageSamples)) {
                 numPageSamples = -1;
             }
@@ -3740,6 +3750,39 @@ bool OMXCodec::drainInputBuffer(BufferInfo *info) {
     return true;
 }
 
+status_t OMXCodec::readSourceBuffer(
+        BufferInfo *info, const MediaSource::ReadOptions &options,
+        MediaBuffer **buffer, sp<MetaData> *meta) {
+    // A decoder fed one source buffer per input buffer has the source read
+    // straight into the input buffer, what is returned then only describes
+    // the data there.
+    bool inPlace = info != NULL
+        && !mIsEncoder
+        && !(mFlags & (kUseSecureInputBuffers | kStoreMetaDataInVideoBuffers))
+        && !(mQuirks & kSupportsMultipleFramesPerInputBuffer)
+        && strcasecmp(MEDIA_MIMETYPE_AUDIO_VORBIS, mMIME);
+
+    if (!inPlace) {
+        status_t err = mSource->read(buffer, &options);
+        if (err == OK) {
+            *meta = (*buffer)->meta_data();
+        }
+        return err;
+    }
+
+    size_t size;
+    status_t err = mSource->readInto(info->mData, info->mSize, &size, meta, &options);
+
+    if (err != OK) {
+        *buffer = NULL;
+        return err;
+    }
+
+    *buffer = new MediaBuffer(info->mData, size);
+
+    return OK;
+}
+
 void OMXCodec::fillOutputBuffer(BufferInfo *info) {
     CHECK_EQ((int)info->mStatus, (int)OWNED_BY_US);
 
@@ -4409,6 +4452,9 @@ status_t OMXCodec::read(
         seeking = true;
     }
 
+    // Passed on to the source with every read from now on.
+    mSyncFramesOnly = options != NULL && options->getSyncFramesOnly();
+
     if (mInitialBufferSubmit) {
         mInitialBufferSubmit = false;
 
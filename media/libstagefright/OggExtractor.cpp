@@ -66,7 +66,7 @@ private:
 };
 
 struct MyVorbisExtractor {
-    MyVorbisExtractor(const sp<DataSource> &source);
+    MyVorbisExtractor(const sp<DataSource> &source, bool metaDataOnly);
     virtual ~MyVorbisExtractor();
 
     sp<MetaData> getFormat() const;
@@ -100,6 +100,7 @@ private:
     };
 
     sp<DataSource> mSource;
+    bool mMetaDataOnly;
     off64_t mOffset;
     Page mCurrentPage;
     uint64_t mPrevGranulePosition;
@@ -209,8 +210,10 @@ status_t OggSource::read(
 
 ////////////////////////////////////////////////////////////////////////////////
 
-MyVorbisExtractor::MyVorbisExtractor(const sp<DataSource> &source)
+MyVorbisExtractor::MyVorbisExtractor(
+        const sp<DataSource> &source, bool metaDataOnly)
     : mSource(source),
+      mMetaDataOnly(metaDataOnly),
       mOffset(0),
       mPrevGranulePosition(0),
       mCurrentPageSize(0),
@@ -653,7 +656,10 @@ status_t MyVorbisExtractor::init() {
 
         mMeta->setInt64(kKeyDuration, durationUs);
 
-        buildTableOfContents();
+        if (!mMetaDataOnly) {
+            // This reads the header of every page in the file.
+            buildTableOfContents();
+        }
     }
 
     return OK;
@@ -825,13 +831,14 @@ void MyVorbisExtractor::parseFileMetaData() {
     for (int i = 0; i < mVc.comments; ++i) {
         const char *comment = mVc.user_comments[i];
         size_t commentLength = mVc.comment_lengths[i];
-        parseVorbisComment(mFileMeta, comment, commentLength);
+        parseVorbisComment(mFileMeta, comment, commentLength, mMetaDataOnly);
         //ALOGI("comment #%d: '%s'", i + 1, mVc.user_comments[i]);
     }
 }
 
 void parseVorbisComment(
-        const sp<MetaData> &fileMeta, const char *comment, size_t commentLength)
+        const sp<MetaData> &fileMeta, const char *comment, size_t commentLength,
+        bool metaDataOnly)
 {
     struct {
         const char *const mTag;
@@ -859,10 +866,12 @@ void parseVorbisComment(
             if (!strncasecmp(kMap[j].mTag, comment, tagLen)
                     && comment[tagLen] == '=') {
                 if (kMap[j].mKey == kKeyAlbumArt) {
-                    extractAlbumArt(
-                            fileMeta,
-                            &comment[tagLen + 1],
-                            commentLength - tagLen - 1);
+                    if (!metaDataOnly) {
+                        extractAlbumArt(
+                                fileMeta,
+                                &comment[tagLen + 1],
+                                commentLength - tagLen - 1);
+                    }
                 } else if (kMap[j].mKey == kKeyAutoLoop) {
                     if (!strcasecmp(&comment[tagLen + 1], "true")) {
                         fileMeta->setInt32(kKeyAutoLoop, true);
@@ -1017,11 +1026,11 @@ exit:
 
 ////////////////////////////////////////////////////////////////////////////////
 
-OggExtractor::OggExtractor(const sp<DataSource> &source)
+OggExtractor::OggExtractor(const sp<DataSource> &source, bool metaDataOnly)
     : mDataSource(source),
       mInitCheck(NO_INIT),
       mImpl(NULL) {
-    mImpl = new MyVorbisExtractor(mDataSource);
+    mImpl = new MyVorbisExtractor(mDataSource, metaDataOnly);
     mInitCheck = mImpl->seekToOffset(0);
 
     if (mInitCheck == OK) {
@@ -703,6 +703,37 @@ status_t SampleTable::findSyncSampleNear(
     return OK;
 }
 
+status_t SampleTable::findNextSyncSample(
+        uint32_t start_sample_index, uint32_t *sample_index) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mSyncSampleOffset < 0 || mNumSyncSamples == 0) {
+        // All samples are sync-samples. An empty table would leave nothing
+        // to return at all, so it is taken to mean the same.
+        *sample_index = start_sample_index;
+        return OK;
+    }
+
+    uint32_t left = 0;
+    uint32_t right_plus_one = mNumSyncSamples;
+    while (left < right_plus_one) {
+        uint32_t center = left + (right_plus_one - left) / 2;
+
+        if (mSyncSamples[center] < start_sample_index) {
+            left = center + 1;
+        } else {
+            right_plus_one = center;
+        }
+    }
+
+    if (left == mNumSyncSamples) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    *sample_index = mSyncSamples[left];
+    return OK;
+}
+
 status_t SampleTable::findThumbnailSample(uint32_t *sample_index) {
     Mutex::Autolock autoLock(mLock);
 
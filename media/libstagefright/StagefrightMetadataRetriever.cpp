@@ -18,8 +18,11 @@
 #define LOG_TAG "StagefrightMetadataRetriever"
 
 #include <inttypes.h>
+#include <sys/stat.h>
 
 #include <utils/Log.h>
+#include <utils/List.h>
+#include <utils/Mutex.h>
 
 #include "include/StagefrightMetadataRetriever.h"
 
@@ -38,8 +41,109 @@
 
 namespace android {
 
+// Thumbnails decoded by any retriever in the process, most recently used
+// first, up to kMaxNumBytes of frame data.
+struct ThumbnailCache {
+    ThumbnailCache() : mNumBytes(0) {}
+
+    // A copy of the frame for the request, or NULL.
+    VideoFrame *find(
+            const String8 &sourceId, int64_t timeUs, int option,
+            int32_t maxWidth, int32_t maxHeight);
+
+    void add(
+            const String8 &sourceId, int64_t timeUs, int option,
+            int32_t maxWidth, int32_t maxHeight, const VideoFrame &frame);
+
+private:
+    static const size_t kMaxNumBytes = 4 * 1024 * 1024;
+
+    struct Entry {
+        String8 mSourceId;
+        int64_t mTimeUs;
+        int mOption;
+        int32_t mMaxWidth;
+        int32_t mMaxHeight;
+        VideoFrame *mFrame;
+    };
+
+    Mutex mLock;
+    List<Entry> mEntries;
+    size_t mNumBytes;
+
+    DISALLOW_EVIL_CONSTRUCTORS(ThumbnailCache);
+};
+
+VideoFrame *ThumbnailCache::find(
+        const String8 &sourceId, int64_t timeUs, int option,
+        int32_t maxWidth, int32_t maxHeight) {
+    Mutex::Autolock autoLock(mLock);
+
+    for (List<Entry>::iterator it = mEntries.begin();
+            it != mEntries.end(); ++it) {
+        if (it->mTimeUs == timeUs && it->mOption == option
+                && it->mMaxWidth == maxWidth && it->mMaxHeight == maxHeight
+                && it->mSourceId == sourceId) {
+            Entry entry = *it;
+            mEntries.erase(it);
+            mEntries.push_front(entry);
+            return new VideoFrame(*entry.mFrame);
+        }
+    }
+
+    return NULL;
+}
+
+void ThumbnailCache::add(
+        const String8 &sourceId, int64_t timeUs, int option,
+        int32_t maxWidth, int32_t maxHeight, const VideoFrame &frame) {
+    if (frame.mSize > kMaxNumBytes / 2) {
+        return;
+    }
+
+    Entry entry;
+    entry.mSourceId = sourceId;
+    entry.mTimeUs = timeUs;
+    entry.mOption = option;
+    entry.mMaxWidth = maxWidth;
+    entry.mMaxHeight = maxHeight;
+    entry.mFrame = new VideoFrame(frame);
+
+    Mutex::Autolock autoLock(mLock);
+
+    mEntries.push_front(entry);
+    mNumBytes += frame.mSize;
+
+    while (mNumBytes > kMaxNumBytes) {
+        List<Entry>::iterator it = --mEntries.end();
+        mNumBytes -= it->mFrame->mSize;
+        delete it->mFrame;
+        mEntries.erase(it);
+    }
+}
+
+static ThumbnailCache gThumbnailCache;
+
+// Identifies the content of a local file for gThumbnailCache, the empty
+// string for anything else.
+static String8 sourceIdForFile(
+        int fd, const char *path, int64_t offset, int64_t length) {
+    struct stat st;
+    if ((fd >= 0 ? fstat(fd, &st) : stat(path, &st)) != 0
+            || !S_ISREG(st.st_mode)) {
+        return String8();
+    }
+
+    String8 id;
+    id.appendFormat("%llu:%llu:%lld:%lld:%" PRId64 ":%" PRId64,
+            (unsigned long long)st.st_dev, (unsigned long long)st.st_ino,
+            (long long)st.st_size, (long long)st.st_mtime, offset, length);
+    return id;
+}
+
 StagefrightMetadataRetriever::StagefrightMetadataRetriever()
-    : mParsedMetaData(false),
+    : mMetaDataOnly(false),
+      mParsedMetaData(false),
       mAlbumArt(NULL) {
     ALOGV("StagefrightMetadataRetriever()");
 
@@ -68,13 +172,18 @@ status_t StagefrightMetadataRetriever::setDataSource(
     mAlbumArt = NULL;
 
     mSource = DataSource::CreateFromURI(httpService, uri, headers);
+    mSourceId.clear();
 
     if (mSource == NULL) {
         ALOGE("Unable to create data source for '%s'.", uri);
         return UNKNOWN_ERROR;
     }
 
-    mExtractor = MediaExtractor::Create(mSource);
+    // Most clients only want the metadata, frames and album art get a full
+    // extractor once they are asked for.
+    mExtractor = MediaExtractor::Create(
+            mSource, NULL /* mime */, MediaExtractor::kMetaDataOnly);
+    mMetaDataOnly = true;
 
     if (mExtractor == NULL) {
         ALOGE("Unable to instantiate an extractor for '%s'.", uri);
@@ -84,6 +193,12 @@ status_t StagefrightMetadataRetriever::setDataSource(
         return UNKNOWN_ERROR;
     }
 
+    if (!strncasecmp("file://", uri, 7)) {
+        mSourceId = sourceIdForFile(-1, uri + 7, 0, -1);
+    } else if (uri[0] == '/') {
+        mSourceId = sourceIdForFile(-1, uri, 0, -1);
+    }
+
     return OK;
 }
 
@@ -103,6 +218,7 @@ status_t StagefrightMetadataRetriever::setDataSource(
     mAlbumArt = NULL;
 
     mSource = new FileSource(fd, offset, length);
+    mSourceId.clear();
 
     status_t err;
     if ((err = mSource->initCheck()) != OK) {
@@ -111,7 +227,9 @@ status_t StagefrightMetadataRetriever::setDataSource(
         return err;
     }
 
-    mExtractor = MediaExtractor::Create(mSource);
+    mExtractor = MediaExtractor::Create(
+            mSource, NULL /* mime */, MediaExtractor::kMetaDataOnly);
+    mMetaDataOnly = true;
 
     if (mExtractor == NULL) {
         mSource.clear();
@@ -119,9 +237,24 @@ status_t StagefrightMetadataRetriever::setDataSource(
         return UNKNOWN_ERROR;
     }
 
+    mSourceId = sourceIdForFile(fd, NULL, offset, length);
+
     return OK;
 }
 
+// A requested frame, sorted by time for decoding.
+struct FrameRequest {
+    int64_t mTimeUs;
+    size_t mIndex;
+};
+
+static int compareFrameRequests(const FrameRequest *a, const FrameRequest *b) {
+    if (a->mTimeUs != b->mTimeUs) {
+        return a->mTimeUs < b->mTimeUs ? -1 : 1;
+    }
+    return a->mIndex < b->mIndex ? -1 : a->mIndex > b->mIndex;
+}
+
 static bool isYUV420PlanarSupported(
             OMXClient *client,
             const sp<MetaData> &trackMeta) {
@@ -147,57 +280,25 @@ static bool isYUV420PlanarSupported(
     return false;
 }
 
-static VideoFrame *extractVideoFrameWithCodecFlags(
-        OMXClient *client,
+// Seeks |decoder| to |frameTimeUs| and converts the frame it lands on.
+static VideoFrame *readVideoFrame(
+        const sp<MediaSource> &decoder,
         const sp<MetaData> &trackMeta,
-        const sp<MediaSource> &source,
-        uint32_t flags,
         int64_t frameTimeUs,
-        int seekMode) {
-
-    sp<MetaData> format = source->getFormat();
-
-    // XXX:
-    // Once all vendors support OMX_COLOR_FormatYUV420Planar, we can
-    // remove this check and always set the decoder output color format
-    // skip this check for software decoders
-    if (!(flags & OMXCodec::kSoftwareCodecsOnly)) {
-        if (isYUV420PlanarSupported(client, trackMeta)) {
-            format->setInt32(kKeyColorFormat, OMX_COLOR_FormatYUV420Planar);
-        }
-    }
-
-    sp<MediaSource> decoder =
-        OMXCodec::Create(
-                client->interface(), format, false, source,
-                NULL, flags | OMXCodec::kClientNeedsFramebuffer);
-
-    if (decoder.get() == NULL) {
-        ALOGV("unable to instantiate video decoder.");
-
-        return NULL;
-    }
-
-    status_t err = decoder->start();
-    if (err != OK) {
-        ALOGW("OMXCodec::start returned error %d (0x%08x)\n", err, err);
-        return NULL;
-    }
-
+        MediaSource::ReadOptions::SeekMode mode,
+        int32_t maxWidth,
+        int32_t maxHeight) {
     // Read one output buffer, ignore format change notifications
     // and spurious empty buffers.
 
     MediaSource::ReadOptions options;
-    if (seekMode < MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC ||
-        seekMode > MediaSource::ReadOptions::SEEK_CLOSEST) {
 
-        ALOGE("Unknown seek mode: %d", seekMode);
-        return NULL;
+    // Unless the exact frame is wanted, the extractor skips everything
+    // between sync frames without reading it.
+    if (mode != MediaSource::ReadOptions::SEEK_CLOSEST) {
+        options.setSyncFramesOnly();
     }
 
-    MediaSource::ReadOptions::SeekMode mode =
-            static_cast<MediaSource::ReadOptions::SeekMode>(seekMode);
-
     int64_t thumbNailTime;
     if (frameTimeUs < 0) {
         if (!trackMeta->findInt64(kKeyThumbnailTime, &thumbNailTime)
@@ -210,6 +311,7 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
         options.setSeekTo(frameTimeUs, mode);
     }
 
+    status_t err;
     MediaBuffer *buffer = NULL;
     do {
         if (buffer != NULL) {
@@ -225,7 +327,6 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
         CHECK(buffer == NULL);
 
         ALOGV("decoding frame failed.");
-        decoder->stop();
 
         return NULL;
     }
@@ -241,8 +342,6 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
         buffer->release();
         buffer = NULL;
 
-        decoder->stop();
-
         return NULL;
     }
 
@@ -278,25 +377,40 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
         rotationAngle = 0;  // By default, no rotation
     }
 
+    int32_t srcFormat;
+    CHECK(meta->findInt32(kKeyColorFormat, &srcFormat));
+
+    // ColorConverter scales YUV 4:2:0 down by whole factors, use the largest
+    // that leaves the frame no smaller than asked for.
+    int32_t scale = 1;
+    int32_t cropWidth = crop_right - crop_left + 1;
+    int32_t cropHeight = crop_bottom - crop_top + 1;
+    if (maxWidth > 0 && maxHeight > 0 && srcFormat != OMX_COLOR_FormatCbYCrY) {
+        scale = cropWidth / maxWidth;
+        if (cropHeight / maxHeight < scale) {
+            scale = cropHeight / maxHeight;
+        }
+        if (scale < 1) {
+            scale = 1;
+        }
+    }
+
     VideoFrame *frame = new VideoFrame;
-    frame->mWidth = crop_right - crop_left + 1;
-    frame->mHeight = crop_bottom - crop_top + 1;
-    frame->mDisplayWidth = frame->mWidth;
-    frame->mDisplayHeight = frame->mHeight;
+    frame->mWidth = cropWidth / scale;
+    frame->mHeight = cropHeight / scale;
     frame->mSize = frame->mWidth * frame->mHeight * 2;
     frame->mData = new uint8_t[frame->mSize];
     frame->mRotationAngle = rotationAngle;
 
     int32_t displayWidth, displayHeight;
-    if (meta->findInt32(kKeyDisplayWidth, &displayWidth)) {
-        frame->mDisplayWidth = displayWidth;
+    if (!meta->findInt32(kKeyDisplayWidth, &displayWidth)) {
+        displayWidth = cropWidth;
     }
-    if (meta->findInt32(kKeyDisplayHeight, &displayHeight)) {
-        frame->mDisplayHeight = displayHeight;
+    if (!meta->findInt32(kKeyDisplayHeight, &displayHeight)) {
+        displayHeight = cropHeight;
     }
-
-    int32_t srcFormat;
-    CHECK(meta->findInt32(kKeyColorFormat, &srcFormat));
+    frame->mDisplayWidth = displayWidth / scale;
+    frame->mDisplayHeight = displayHeight / scale;
 
     ColorConverter converter(
             (OMX_COLOR_FORMATTYPE)srcFormat, OMX_COLOR_Format16bitRGB565);
@@ -310,6 +424,28 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
                 frame->mWidth,
                 frame->mHeight,
                 0, 0, frame->mWidth - 1, frame->mHeight - 1);
+
+        if (err == ERROR_UNSUPPORTED && scale > 1) {
+            // Odd crops and such cannot be scaled, return the full frame.
+            ALOGV("cannot scale by %d, converting at full size", scale);
+
+            delete[] frame->mData;
+            frame->mWidth = cropWidth;
+            frame->mHeight = cropHeight;
+            frame->mDisplayWidth = displayWidth;
+            frame->mDisplayHeight = displayHeight;
+            frame->mSize = frame->mWidth * frame->mHeight * 2;
+            frame->mData = new uint8_t[frame->mSize];
+
+            err = converter.convert(
+                    (const uint8_t *)buffer->data() + buffer->range_offset(),
+                    width, height,
+                    crop_left, crop_top, crop_right, crop_bottom,
+                    frame->mData,
+                    frame->mWidth,
+                    frame->mHeight,
+                    0, 0, frame->mWidth - 1, frame->mHeight - 1);
+        }
     } else {
         ALOGE("Unable to instantiate color conversion from format 0x%08x to "
               "RGB565",
@@ -321,8 +457,6 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
     buffer->release();
     buffer = NULL;
 
-    decoder->stop();
-
     if (err != OK) {
         ALOGE("Colorconverter failed to convert frame.");
 
@@ -333,27 +467,153 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
     return frame;
 }
 
+// Decodes the frames of |requests| that are still NULL in |frames| with one
+// instance of the decoder. Fails only if the decoder could not be started.
+static status_t extractVideoFramesWithCodecFlags(
+        OMXClient *client,
+        const sp<MetaData> &trackMeta,
+        const sp<MediaSource> &source,
+        uint32_t flags,
+        const Vector<FrameRequest> &requests,
+        MediaSource::ReadOptions::SeekMode mode,
+        int32_t maxWidth,
+        int32_t maxHeight,
+        VideoFrame **frames) {
+
+    sp<MetaData> format = source->getFormat();
+
+    // XXX:
+    // Once all vendors support OMX_COLOR_FormatYUV420Planar, we can
+    // remove this check and always set the decoder output color format
+    // skip this check for software decoders
+    if (!(flags & OMXCodec::kSoftwareCodecsOnly)) {
+        if (isYUV420PlanarSupported(client, trackMeta)) {
+            format->setInt32(kKeyColorFormat, OMX_COLOR_FormatYUV420Planar);
+        }
+    }
+
+    // Unless the exact frame is wanted, the sync frame a seek lands on is
+    // all that is decoded; samples the codec would read ahead are thrown
+    // away by the next seek, even if they are sync frames too.
+    if (mode != MediaSource::ReadOptions::SEEK_CLOSEST) {
+        flags |= OMXCodec::kOnlySubmitOneInputBufferAtOneTime;
+    }
+
+    sp<MediaSource> decoder =
+        OMXCodec::Create(
+                client->interface(), format, false, source,
+                NULL, flags | OMXCodec::kClientNeedsFramebuffer);
+
+    if (decoder.get() == NULL) {
+        ALOGV("unable to instantiate video decoder.");
+
+        return UNKNOWN_ERROR;
+    }
+
+    status_t err = decoder->start();
+    if (err != OK) {
+        ALOGW("OMXCodec::start returned error %d (0x%08x)\n", err, err);
+        return err;
+    }
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const FrameRequest &request = requests[i];
+        if (frames[request.mIndex] != NULL) {
+            continue;
+        }
+
+        // The same time asked for twice is decoded once.
+        if (i > 0 && requests[i - 1].mTimeUs == request.mTimeUs) {
+            VideoFrame *previous = frames[requests[i - 1].mIndex];
+            if (previous != NULL) {
+                frames[request.mIndex] = new VideoFrame(*previous);
+            }
+            continue;
+        }
+
+        frames[request.mIndex] = readVideoFrame(
+                decoder, trackMeta, request.mTimeUs, mode, maxWidth, maxHeight);
+    }
+
+    decoder->stop();
+
+    return OK;
+}
+
 VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
         int64_t timeUs, int option) {
 
     ALOGV("getFrameAtTime: %" PRId64 " us option: %d", timeUs, option);
 
+    VideoFrame *frame = NULL;
+    getFramesAtTimes(&timeUs, 1, option, 0 /* maxWidth */, 0 /* maxHeight */,
+            &frame);
+
+    return frame;
+}
+
+status_t StagefrightMetadataRetriever::getFramesAtTimes(
+        const int64_t *timesUs, size_t numTimes, int option,
+        int32_t maxWidth, int32_t maxHeight, VideoFrame **frames) {
+
+    ALOGV("getFramesAtTimes: %zu times option: %d max %dx%d",
+            numTimes, option, maxWidth, maxHeight);
+
+    for (size_t i = 0; i < numTimes; ++i) {
+        frames[i] = NULL;
+    }
+
     if (mExtractor.get() == NULL) {
         ALOGV("no extractor.");
-        return NULL;
+        return NO_INIT;
+    }
+
+    if (option < MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC ||
+        option > MediaSource::ReadOptions::SEEK_CLOSEST) {
+
+        ALOGE("Unknown seek mode: %d", option);
+        return BAD_VALUE;
+    }
+
+    MediaSource::ReadOptions::SeekMode mode =
+            static_cast<MediaSource::ReadOptions::SeekMode>(option);
+
+    Vector<FrameRequest> requests;
+    for (size_t i = 0; i < numTimes; ++i) {
+        if (!mSourceId.isEmpty()) {
+            frames[i] = gThumbnailCache.find(
+                    mSourceId, timesUs[i], option, maxWidth, maxHeight);
+        }
+        if (frames[i] == NULL) {
+            FrameRequest request;
+            request.mTimeUs = timesUs[i];
+            request.mIndex = i;
+            requests.push(request);
+        }
+    }
+
+    if (requests.isEmpty()) {
+        return OK;
+    }
+
+    // Seeking forward only lets the extractor read on where it can.
+    requests.sort(compareFrameRequests);
+
+    if (createFullExtractor() != OK) {
+        return UNKNOWN_ERROR;
     }
 
     sp<MetaData> fileMeta = mExtractor->getMetaData();
 
     if (fileMeta == NULL) {
         ALOGV("extractor doesn't publish metadata, failed to initialize?");
-        return NULL;
+        return UNKNOWN_ERROR;
     }
 
     int32_t drm = 0;
     if (fileMeta->findInt32(kKeyIsDRM, &drm) && drm != 0) {
         ALOGE("frame grab not allowed.");
-        return NULL;
+        return PERMISSION_DENIED;
     }
 
     size_t n = mExtractor->countTracks();
@@ -371,7 +631,7 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
 
     if (i == n) {
         ALOGV("no video track found.");
-        return NULL;
+        return ERROR_UNSUPPORTED;
     }
 
     sp<MetaData> trackMeta = mExtractor->getTrackMetaData(
@@ -381,7 +641,7 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
 
     if (source.get() == NULL) {
         ALOGV("unable to instantiate video track.");
-        return NULL;
+        return UNKNOWN_ERROR;
     }
 
     const void *data;
@@ -392,26 +652,40 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
         mAlbumArt = MediaAlbumArt::fromData(dataSize, data);
     }
 
-    VideoFrame *frame =
-        extractVideoFrameWithCodecFlags(
-                &mClient, trackMeta, source, OMXCodec::kSoftwareCodecsOnly,
-                timeUs, option);
+    extractVideoFramesWithCodecFlags(
+            &mClient, trackMeta, source, OMXCodec::kSoftwareCodecsOnly,
+            requests, mode, maxWidth, maxHeight, frames);
 
-    if (frame == NULL) {
-        ALOGV("Software decoder failed to extract thumbnail, "
-             "trying hardware decoder.");
+    for (size_t j = 0; j < requests.size(); ++j) {
+        if (frames[requests[j].mIndex] == NULL) {
+            ALOGV("Software decoder failed to extract thumbnail, "
+                 "trying hardware decoder.");
 
-        frame = extractVideoFrameWithCodecFlags(&mClient, trackMeta, source, 0,
-                        timeUs, option);
+            extractVideoFramesWithCodecFlags(
+                    &mClient, trackMeta, source, 0,
+                    requests, mode, maxWidth, maxHeight, frames);
+            break;
+        }
     }
 
-    return frame;
+    if (!mSourceId.isEmpty()) {
+        for (size_t j = 0; j < requests.size(); ++j) {
+            const FrameRequest &request = requests[j];
+            if (frames[request.mIndex] != NULL) {
+                gThumbnailCache.add(
+                        mSourceId, request.mTimeUs, option,
+                        maxWidth, maxHeight, *frames[request.mIndex]);
+            }
+        }
+    }
+
+    return OK;
 }
 
 MediaAlbumArt *StagefrightMetadataRetriever::extractAlbumArt() {
     ALOGV("extractAlbumArt (extractor: %s)", mExtractor.get() != NULL ? "YES" : "NO");
 
-    if (mExtractor == NULL) {
+    if (mExtractor == NULL || createFullExtractor() != OK) {
         return NULL;
     }
 
@@ -448,6 +722,29 @@ const char *StagefrightMetadataRetriever::extractMetadata(int keyCode) {
     return mMetaData.valueAt(index).string();
 }
 
+// Replaces a metadata-only extractor with one that provides the tracks and
+// the album art.
+status_t StagefrightMetadataRetriever::createFullExtractor() {
+    if (!mMetaDataOnly) {
+        return OK;
+    }
+
+    sp<MediaExtractor> extractor = MediaExtractor::Create(mSource);
+    if (extractor == NULL) {
+        ALOGE("Unable to instantiate a full extractor.");
+        return UNKNOWN_ERROR;
+    }
+
+    mExtractor = extractor;
+    mMetaDataOnly = false;
+
+    // Parse again so that the album art is found.
+    mParsedMetaData = false;
+    mMetaData.clear();
+
+    return OK;
+}
+
 void StagefrightMetadataRetriever::parseMetaData() {
     sp<MetaData> meta = mExtractor->getMetaData();
 
@@ -21,11 +21,47 @@
 #include "SoftAACEncoder2.h"
 #include <OMX_AudioExt.h>
 
+#include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/hexdump.h>
 
+#include <pthread.h>
+#include <unistd.h>
+
 namespace android {
 
+// A run of input frames encoded on a worker's encoder instance, which is
+// reset first. The encoder output for the leading mNumPreRoll frames only
+// brings the instance's state (MDCT overlap, block switching, psychoacoustic
+// model) up to where a single encoder would be, and is dropped. The frames
+// after the mNumFrames output ones are there in case the encoder lags its
+// input; they are not fed once enough access units have come out.
+struct SoftAACEncoder2::Segment {
+    Vector<sp<ABuffer> > mFrames;
+    size_t mNumPreRoll;
+    size_t mNumFrames;
+    bool mFinal;
+
+    // Written by the worker, read once mDone is set.
+    Vector<sp<ABuffer> > mAccessUnits;
+    bool mFailed;
+
+    // Guarded by mLock.
+    bool mStarted;
+    bool mDone;
+
+    // Component thread only.
+    size_t mNumSent;
+};
+
+struct SoftAACEncoder2::Worker {
+    SoftAACEncoder2 *mOwner;
+    HANDLE_AACENCODER mEncoder;
+    size_t mMaxOutputSize;
+    pthread_t mThread;
+};
+
 template<class T>
 static void InitOMXParams(T *params) {
     params->nSize = sizeof(T);
@@ -53,13 +89,20 @@ SoftAACEncoder2::SoftAACEncoder2(
       mInputFrame(NULL),
       mInputTimeUs(-1ll),
       mSawInputEOS(false),
-      mSignalledError(false) {
+      mSignalledError(false),
+      mRequestedThreads(1),
+      mSegmentFrames(kDefaultSegmentFrames),
+      mNumPreRollFrames(0),
+      mStopWorkers(false) {
     initPorts();
     CHECK_EQ(initEncoder(), (status_t)OK);
     setAudioParams();
 }
 
 SoftAACEncoder2::~SoftAACEncoder2() {
+    stopWorkers();
+    discardSegments();
+
     aacEncClose(&mAACEncoder);
 
     delete[] mInputFrame;
@@ -117,7 +160,7 @@ status_t SoftAACEncoder2::initEncoder() {
 
 OMX_ERRORTYPE SoftAACEncoder2::internalGetParameter(
         OMX_INDEXTYPE index, OMX_PTR params) {
-    switch (index) {
+    switch ((int)index) {
         case OMX_IndexParamAudioPortFormat:
         {
             OMX_AUDIO_PARAM_PORTFORMATTYPE *formatParams =
@@ -220,6 +263,20 @@ OMX_ERRORTYPE SoftAACEncoder2::internalGetParameter(
             return OMX_ErrorNone;
         }
 
+        case kThreadingIndex:
+        {
+            AudioEncoderThreadingParams *threadingParams =
+                (AudioEncoderThreadingParams *)params;
+            if (threadingParams->nSize != sizeof(AudioEncoderThreadingParams)) {
+                return OMX_ErrorUndefined;
+            }
+
+            threadingParams->nNumThreads = mRequestedThreads;
+            threadingParams->nSegmentFrames = mSegmentFrames;
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return SimpleSoftOMXComponent::internalGetParameter(index, params);
     }
@@ -227,7 +284,7 @@ OMX_ERRORTYPE SoftAACEncoder2::internalGetParameter(
 
 OMX_ERRORTYPE SoftAACEncoder2::internalSetParameter(
         OMX_INDEXTYPE index, const OMX_PTR params) {
-    switch (index) {
+    switch ((int)index) {
         case OMX_IndexParamStandardComponentRole:
         {
             const OMX_PARAM_COMPONENTROLETYPE *roleParams =
@@ -323,11 +380,39 @@ OMX_ERRORTYPE SoftAACEncoder2::internalSetParameter(
             return OMX_ErrorNone;
         }
 
+        case kThreadingIndex:
+        {
+            const AudioEncoderThreadingParams *threadingParams =
+                (const AudioEncoderThreadingParams *)params;
+            if (threadingParams->nSize != sizeof(AudioEncoderThreadingParams)) {
+                return OMX_ErrorUndefined;
+            }
+
+            mRequestedThreads = threadingParams->nNumThreads;
+            mSegmentFrames = threadingParams->nSegmentFrames;
+            if (mSegmentFrames == 0) {
+                mSegmentFrames = kDefaultSegmentFrames;
+            }
+            ALOGV("threading: %zu threads, %zu frames per segment",
+                    mRequestedThreads, mSegmentFrames);
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return SimpleSoftOMXComponent::internalSetParameter(index, params);
     }
 }
 
+OMX_ERRORTYPE SoftAACEncoder2::getExtensionIndex(
+        const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, AUDIO_ENCODER_THREADING_EXTENSION)) {
+        *(int32_t *)index = kThreadingIndex;
+        return OMX_ErrorNone;
+    }
+    return SimpleSoftOMXComponent::getExtensionIndex(name, index);
+}
+
 static CHANNEL_MODE getChannelMode(OMX_U32 nChannels) {
     CHANNEL_MODE chMode = MODE_INVALID;
     switch (nChannels) {
@@ -366,32 +451,38 @@ status_t SoftAACEncoder2::setAudioParams() {
     ALOGV("setAudioParams: %u Hz, %u channels, %u bps, %i sbr mode, %i sbr ratio",
          mSampleRate, mNumChannels, mBitRate, mSBRMode, mSBRRatio);
 
-    if (AACENC_OK != aacEncoder_SetParam(mAACEncoder, AACENC_AOT,
+    return configureEncoder(mAACEncoder);
+}
+
+// Applies the current settings to |encoder|, which is the component's own
+// encoder or one of the workers'.
+status_t SoftAACEncoder2::configureEncoder(HANDLE_AACENCODER encoder) {
+    if (AACENC_OK != aacEncoder_SetParam(encoder, AACENC_AOT,
             getAOTFromProfile(mAACProfile))) {
         ALOGE("Failed to set AAC encoder parameters");
         return UNKNOWN_ERROR;
     }
 
-    if (AACENC_OK != aacEncoder_SetParam(mAACEncoder, AACENC_SAMPLERATE, mSampleRate)) {
+    if (AACENC_OK != aacEncoder_SetParam(encoder, AACENC_SAMPLERATE, mSampleRate)) {
         ALOGE("Failed to set AAC encoder parameters");
         return UNKNOWN_ERROR;
     }
-    if (AACENC_OK != aacEncoder_SetParam(mAACEncoder, AACENC_BITRATE, mBitRate)) {
+    if (AACENC_OK != aacEncoder_SetParam(encoder, AACENC_BITRATE, mBitRate)) {
         ALOGE("Failed to set AAC encoder parameters");
         return UNKNOWN_ERROR;
     }
-    if (AACENC_OK != aacEncoder_SetParam(mAACEncoder, AACENC_CHANNELMODE,
+    if (AACENC_OK != aacEncoder_SetParam(encoder, AACENC_CHANNELMODE,
             getChannelMode(mNumChannels))) {
         ALOGE("Failed to set AAC encoder parameters");
         return UNKNOWN_ERROR;
     }
-    if (AACENC_OK != aacEncoder_SetParam(mAACEncoder, AACENC_TRANSMUX, TT_MP4_RAW)) {
+    if (AACENC_OK != aacEncoder_SetParam(encoder, AACENC_TRANSMUX, TT_MP4_RAW)) {
         ALOGE("Failed to set AAC encoder parameters");
         return UNKNOWN_ERROR;
     }
 
     if (mSBRMode != -1 && mAACProfile == OMX_AUDIO_AACObjectELD) {
-        if (AACENC_OK != aacEncoder_SetParam(mAACEncoder, AACENC_SBR_MODE, mSBRMode)) {
+        if (AACENC_OK != aacEncoder_SetParam(encoder, AACENC_SBR_MODE, mSBRMode)) {
             ALOGE("Failed to set AAC encoder parameters");
             return UNKNOWN_ERROR;
         }
@@ -403,7 +494,7 @@ status_t SoftAACEncoder2::setAudioParams() {
        1: Downsampled SBR (default for ELD)
        2: Dualrate SBR (default for HE-AAC)
      */
-    if (AACENC_OK != aacEncoder_SetParam(mAACEncoder, AACENC_SBR_RATIO, mSBRRatio)) {
+    if (AACENC_OK != aacEncoder_SetParam(encoder, AACENC_SBR_RATIO, mSBRRatio)) {
         ALOGE("Failed to set AAC encoder parameters");
         return UNKNOWN_ERROR;
     }
@@ -411,12 +502,78 @@ status_t SoftAACEncoder2::setAudioParams() {
     return OK;
 }
 
+// Copies input into |frame| until it holds |size| bytes, padding the last
+// frame with silence at the end of stream. Returns false if the input runs
+// out first.
+bool SoftAACEncoder2::fillInputFrame(uint8_t *frame, size_t size) {
+    List<BufferInfo *> &inQueue = getPortQueue(0);
+
+    while (mInputSize < size) {
+        // As long as there's still input data to be read we
+        // will drain "kNumSamplesPerFrame * mNumChannels" samples
+        // into |frame| and then encode those
+        // as a unit into an output buffer.
+
+        if (mSawInputEOS || inQueue.empty()) {
+            return false;
+        }
+
+        BufferInfo *inInfo = *inQueue.begin();
+        OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
+
+        const void *inData = inHeader->pBuffer + inHeader->nOffset;
+
+        size_t copy = size - mInputSize;
+        if (copy > inHeader->nFilledLen) {
+            copy = inHeader->nFilledLen;
+        }
+
+        if (mInputSize == 0) {
+            mInputTimeUs = inHeader->nTimeStamp;
+        }
+
+        memcpy(frame + mInputSize, inData, copy);
+        mInputSize += copy;
+
+        inHeader->nOffset += copy;
+        inHeader->nFilledLen -= copy;
+
+        // "Time" on the input buffer has in effect advanced by the
+        // number of audio frames we just advanced nOffset by.
+        inHeader->nTimeStamp +=
+            (copy * 1000000ll / mSampleRate)
+                / (mNumChannels * sizeof(int16_t));
+
+        if (inHeader->nFilledLen == 0) {
+            if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
+                mSawInputEOS = true;
+
+                // Pad any remaining data with zeroes.
+                memset(frame + mInputSize,
+                       0,
+                       size - mInputSize);
+
+                mInputSize = size;
+            }
+
+            inQueue.erase(inQueue.begin());
+            inInfo->mOwnedByUs = false;
+            notifyEmptyBufferDone(inHeader);
+
+            inData = NULL;
+            inHeader = NULL;
+            inInfo = NULL;
+        }
+    }
+
+    return true;
+}
+
 void SoftAACEncoder2::onQueueFilled(OMX_U32 /* portIndex */) {
     if (mSignalledError) {
         return;
     }
 
-    List<BufferInfo *> &inQueue = getPortQueue(0);
     List<BufferInfo *> &outQueue = getPortQueue(1);
 
     if (!mSentCodecSpecificData) {
@@ -461,6 +618,18 @@ void SoftAACEncoder2::onQueueFilled(OMX_U32 /* portIndex */) {
         notifyFillBufferDone(outHeader);
 
         mSentCodecSpecificData = true;
+
+        size_t numThreads = chooseNumThreads();
+        if (numThreads > 1) {
+            if (startWorkers(numThreads) != OK) {
+                ALOGW("Unable to start %zu encoder threads, encoding on one",
+                        numThreads);
+                stopWorkers();
+            } else {
+                ALOGI("Encoding segments of %zu frames on %zu threads",
+                        mSegmentFrames, numThreads);
+            }
+        }
     }
 
     size_t numBytesPerInputFrame =
@@ -471,69 +640,20 @@ void SoftAACEncoder2::onQueueFilled(OMX_U32 /* portIndex */) {
         numBytesPerInputFrame = 512;
     }
 
+    if (!mWorkers.isEmpty()) {
+        onQueueFilledParallel(numBytesPerInputFrame);
+        return;
+    }
+
     for (;;) {
         // We do the following until we run out of buffers.
 
-        while (mInputSize < numBytesPerInputFrame) {
-            // As long as there's still input data to be read we
-            // will drain "kNumSamplesPerFrame * mNumChannels" samples
-            // into the "mInputFrame" buffer and then encode those
-            // as a unit into an output buffer.
-
-            if (mSawInputEOS || inQueue.empty()) {
-                return;
-            }
-
-            BufferInfo *inInfo = *inQueue.begin();
-            OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
-
-            const void *inData = inHeader->pBuffer + inHeader->nOffset;
-
-            size_t copy = numBytesPerInputFrame - mInputSize;
-            if (copy > inHeader->nFilledLen) {
-                copy = inHeader->nFilledLen;
-            }
-
-            if (mInputFrame == NULL) {
-                mInputFrame = new int16_t[numBytesPerInputFrame / sizeof(int16_t)];
-            }
-
-            if (mInputSize == 0) {
-                mInputTimeUs = inHeader->nTimeStamp;
-            }
-
-            memcpy((uint8_t *)mInputFrame + mInputSize, inData, copy);
-            mInputSize += copy;
-
-            inHeader->nOffset += copy;
-            inHeader->nFilledLen -= copy;
-
-            // "Time" on the input buffer has in effect advanced by the
-            // number of audio frames we just advanced nOffset by.
-            inHeader->nTimeStamp +=
-                (copy * 1000000ll / mSampleRate)
-                    / (mNumChannels * sizeof(int16_t));
-
-            if (inHeader->nFilledLen == 0) {
-                if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
-                    mSawInputEOS = true;
-
-                    // Pad any remaining data with zeroes.
-                    memset((uint8_t *)mInputFrame + mInputSize,
-                           0,
-                           numBytesPerInputFrame - mInputSize);
-
-                    mInputSize = numBytesPerInputFrame;
-                }
-
-                inQueue.erase(inQueue.begin());
-                inInfo->mOwnedByUs = false;
-                notifyEmptyBufferDone(inHeader);
+        if (mInputFrame == NULL) {
+            mInputFrame = new int16_t[numBytesPerInputFrame / sizeof(int16_t)];
+        }
 
-                inData = NULL;
-                inHeader = NULL;
-                inInfo = NULL;
-            }
+        if (!fillInputFrame((uint8_t *)mInputFrame, numBytesPerInputFrame)) {
+            return;
         }
 
         // At this  point we have all the input data necessary to encode
@@ -642,6 +762,435 @@ void SoftAACEncoder2::onQueueFilled(OMX_U32 /* portIndex */) {
     }
 }
 
+static size_t GetCPUCoreCount() {
+    long cpuCoreCount = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    // _SC_NPROC_ONLN must be defined...
+    cpuCoreCount = sysconf(_SC_NPROC_ONLN);
+#endif
+    CHECK(cpuCoreCount >= 1);
+    return (size_t)cpuCoreCount;
+}
+
+size_t SoftAACEncoder2::chooseNumThreads() const {
+    // SBR, PS and the low delay profiles carry more state from frame to frame
+    // than a few frames of pre-roll reliably rebuild, and ELD is fed in
+    // partial frames; those are always encoded on the component thread.
+    if (getAOTFromProfile(mAACProfile) != AOT_AAC_LC) {
+        return 1;
+    }
+
+    size_t numThreads = mRequestedThreads;
+    if (numThreads == 0) {
+        numThreads = GetCPUCoreCount();
+    }
+    if (numThreads > kMaxNumThreads) {
+        numThreads = kMaxNumThreads;
+    }
+    return numThreads;
+}
+
+status_t SoftAACEncoder2::startWorkers(size_t numThreads) {
+    CHECK(mWorkers.isEmpty());
+
+    mStopWorkers = false;
+
+    for (size_t i = 0; i < numThreads; ++i) {
+        Worker *worker = new Worker;
+        worker->mOwner = this;
+        worker->mEncoder = NULL;
+
+        AACENC_InfoStruct encInfo;
+        if (AACENC_OK != aacEncOpen(&worker->mEncoder, 0, 0)
+                || configureEncoder(worker->mEncoder) != OK
+                || AACENC_OK != aacEncEncode(worker->mEncoder, NULL, NULL, NULL, NULL)
+                || AACENC_OK != aacEncInfo(worker->mEncoder, &encInfo)) {
+            aacEncClose(&worker->mEncoder);
+            delete worker;
+            return UNKNOWN_ERROR;
+        }
+        worker->mMaxOutputSize = encInfo.maxOutBufBytes;
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+        int res = pthread_create(&worker->mThread, &attr, WorkerThreadWrapper, worker);
+        pthread_attr_destroy(&attr);
+
+        if (res != 0) {
+            aacEncClose(&worker->mEncoder);
+            delete worker;
+            return UNKNOWN_ERROR;
+        }
+
+        mWorkers.push(worker);
+    }
+
+    ALOGV("encoding on %zu threads, %zu frames per segment",
+            numThreads, mSegmentFrames);
+
+    return OK;
+}
+
+void SoftAACEncoder2::stopWorkers() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mStopWorkers = true;
+        mWorkCondition.broadcast();
+    }
+
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        Worker *worker = mWorkers.itemAt(i);
+        pthread_join(worker->mThread, NULL);
+        aacEncClose(&worker->mEncoder);
+        delete worker;
+    }
+    mWorkers.clear();
+}
+
+// static
+void *SoftAACEncoder2::WorkerThreadWrapper(void *me) {
+    Worker *worker = static_cast<Worker *>(me);
+    worker->mOwner->workerLoop(worker);
+    return NULL;
+}
+
+void SoftAACEncoder2::workerLoop(Worker *worker) {
+    Mutex::Autolock autoLock(mLock);
+    for (;;) {
+        while (!mStopWorkers && mPendingSegments.empty()) {
+            mWorkCondition.wait(mLock);
+        }
+        if (mStopWorkers) {
+            break;
+        }
+
+        Segment *segment = *mPendingSegments.begin();
+        mPendingSegments.erase(mPendingSegments.begin());
+        segment->mStarted = true;
+
+        mLock.unlock();
+        bool success = encodeSegment(worker, segment);
+        mLock.lock();
+
+        segment->mFailed = !success;
+        segment->mDone = true;
+        mDoneCondition.broadcast();
+    }
+}
+
+bool SoftAACEncoder2::encodeSegment(Worker *worker, Segment *segment) {
+    HANDLE_AACENCODER encoder = worker->mEncoder;
+
+    // Start from the same state a freshly configured encoder has.
+    if (AACENC_OK != aacEncoder_SetParam(
+            encoder, AACENC_CONTROL_STATE, AACENC_INIT_ALL)) {
+        return false;
+    }
+
+    size_t numAccessUnits = segment->mNumPreRoll + segment->mNumFrames;
+    size_t numEncoded = 0;
+    sp<ABuffer> accessUnit;
+
+    for (size_t i = 0;
+            i < segment->mFrames.size() && numEncoded < numAccessUnits; ++i) {
+        const sp<ABuffer> &frame = segment->mFrames.itemAt(i);
+
+        AACENC_InArgs inargs;
+        AACENC_OutArgs outargs;
+        memset(&inargs, 0, sizeof(inargs));
+        inargs.numInSamples = frame->size() / sizeof(int16_t);
+
+        void* inBuffer[]        = { frame->data() };
+        INT   inBufferIds[]     = { IN_AUDIO_DATA };
+        INT   inBufferSize[]    = { (INT)frame->size() };
+        INT   inBufferElSize[]  = { sizeof(int16_t) };
+
+        AACENC_BufDesc inBufDesc;
+        inBufDesc.numBufs           = sizeof(inBuffer) / sizeof(void*);
+        inBufDesc.bufs              = (void**)&inBuffer;
+        inBufDesc.bufferIdentifiers = inBufferIds;
+        inBufDesc.bufSizes          = inBufferSize;
+        inBufDesc.bufElSizes        = inBufferElSize;
+
+        void* outBuffer[]       = { NULL };
+        INT   outBufferIds[]    = { OUT_BITSTREAM_DATA };
+        INT   outBufferSize[]   = { (INT)worker->mMaxOutputSize };
+        INT   outBufferElSize[] = { sizeof(UCHAR) };
+
+        AACENC_BufDesc outBufDesc;
+        outBufDesc.numBufs           = sizeof(outBuffer) / sizeof(void*);
+        outBufDesc.bufs              = (void**)&outBuffer;
+        outBufDesc.bufferIdentifiers = outBufferIds;
+        outBufDesc.bufSizes          = outBufferSize;
+        outBufDesc.bufElSizes        = outBufferElSize;
+
+        do {
+            if (accessUnit == NULL) {
+                accessUnit = new ABuffer(worker->mMaxOutputSize);
+            }
+            outBuffer[0] = accessUnit->data();
+
+            memset(&outargs, 0, sizeof(outargs));
+            if (AACENC_OK != aacEncEncode(
+                    encoder, &inBufDesc, &outBufDesc, &inargs, &outargs)) {
+                return false;
+            }
+
+            if (outargs.numOutBytes > 0) {
+                // Pre-roll output is encoded into the same buffer again.
+                if (numEncoded >= segment->mNumPreRoll) {
+                    accessUnit->setRange(0, outargs.numOutBytes);
+                    segment->mAccessUnits.push(accessUnit);
+                    accessUnit.clear();
+                }
+                ++numEncoded;
+            }
+
+            if (outargs.numInSamples > 0) {
+                inBuffer[0] = (int16_t *)inBuffer[0] + outargs.numInSamples;
+                inBufferSize[0] -= outargs.numInSamples * sizeof(int16_t);
+                inargs.numInSamples -= outargs.numInSamples;
+            }
+        } while (inargs.numInSamples > 0 && numEncoded < numAccessUnits);
+    }
+
+    return true;
+}
+
+// With several threads the input is cut into segments of mSegmentFrames
+// frames that are encoded concurrently, each by a worker's own encoder
+// instance configured like the component's, and output in order. Every
+// instance runs the same rate control at the same bitrate over its segment,
+// so the stream keeps to the configured bitrate; only the bit reservoir is
+// not carried across segment boundaries.
+void SoftAACEncoder2::onQueueFilledParallel(size_t numBytesPerInputFrame) {
+    List<BufferInfo *> &outQueue = getPortQueue(1);
+
+    // Bounds the input read ahead of the output.
+    const size_t maxNumSegments = 2 * mWorkers.size();
+
+    for (;;) {
+        if (!drainSegments()) {
+            return;
+        }
+
+        bool haveFrame = false;
+        if (mSegments.size() < maxNumSegments) {
+            if (mCurrentFrame == NULL) {
+                mCurrentFrame = new ABuffer(numBytesPerInputFrame);
+            }
+            haveFrame = fillInputFrame(
+                    mCurrentFrame->data(), numBytesPerInputFrame);
+        }
+
+        if (haveFrame) {
+            mCurrentFrame->meta()->setInt64("timeUs", mInputTimeUs);
+            mFrames.push(mCurrentFrame);
+            mCurrentFrame.clear();
+            mInputSize = 0;
+
+            if (mFrames.size() >= mNumPreRollFrames
+                    + mSegmentFrames + kLookAheadFrames) {
+                queueSegment(false /* flush */);
+            }
+            if (mSawInputEOS) {
+                while (mFrames.size() > mNumPreRollFrames) {
+                    queueSegment(true /* flush */);
+                }
+            }
+            continue;
+        }
+
+        // Without more input the encoders only need to be waited for when
+        // the read-ahead is used up or the stream has ended; otherwise the
+        // output goes out the next time input arrives.
+        if (mSegments.empty() || outQueue.empty()
+                || (!mSawInputEOS && mSegments.size() < maxNumSegments)) {
+            return;
+        }
+
+        waitForSegment(*mSegments.begin());
+    }
+}
+
+// Cuts the next segment off the front of mFrames, keeping its last frames as
+// the pre-roll of the one after. |flush| allows a short segment without
+// look-ahead at the end of stream.
+void SoftAACEncoder2::queueSegment(bool flush) {
+    size_t numFrames = mFrames.size() - mNumPreRollFrames;
+    if (numFrames > mSegmentFrames) {
+        numFrames = mSegmentFrames;
+    }
+    CHECK(flush || numFrames == mSegmentFrames);
+
+    size_t end = mNumPreRollFrames + numFrames;
+    size_t endWithLookAhead = end + kLookAheadFrames;
+    if (endWithLookAhead > mFrames.size()) {
+        endWithLookAhead = mFrames.size();
+    }
+
+    Segment *segment = new Segment;
+    for (size_t i = 0; i < endWithLookAhead; ++i) {
+        segment->mFrames.push(mFrames.itemAt(i));
+    }
+    segment->mNumPreRoll = mNumPreRollFrames;
+    segment->mNumFrames = numFrames;
+    segment->mFinal = mSawInputEOS && end == mFrames.size();
+    segment->mFailed = false;
+    segment->mStarted = false;
+    segment->mDone = false;
+    segment->mNumSent = 0;
+
+    size_t numPreRoll = kPreRollFrames;
+    if (numPreRoll > end) {
+        numPreRoll = end;
+    }
+    mFrames.removeItemsAt(0, end - numPreRoll);
+    mNumPreRollFrames = numPreRoll;
+
+    if (segment->mFinal) {
+        mFrames.clear();
+        mNumPreRollFrames = 0;
+    }
+
+    mSegments.push_back(segment);
+
+    Mutex::Autolock autoLock(mLock);
+    mPendingSegments.push_back(segment);
+    mWorkCondition.signal();
+}
+
+// Sends the access units of finished segments in order, as far as there are
+// output buffers. Returns false after signalling an error.
+bool SoftAACEncoder2::drainSegments() {
+    List<BufferInfo *> &outQueue = getPortQueue(1);
+
+    while (!mSegments.empty()) {
+        Segment *segment = *mSegments.begin();
+        {
+            Mutex::Autolock autoLock(mLock);
+            if (!segment->mDone) {
+                break;
+            }
+        }
+
+        if (segment->mFailed) {
+            ALOGE("Failed to encode segment");
+            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+            mSignalledError = true;
+            return false;
+        }
+
+        // The end of stream goes out even if the last segment came out empty.
+        size_t numOutputs = segment->mAccessUnits.size();
+        if (segment->mFinal && numOutputs == 0) {
+            numOutputs = 1;
+        }
+
+        while (segment->mNumSent < numOutputs && !outQueue.empty()) {
+            size_t index = segment->mNumSent;
+
+            BufferInfo *outInfo = *outQueue.begin();
+            OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
+
+            outHeader->nFilledLen = 0;
+            if (index < segment->mAccessUnits.size()) {
+                const sp<ABuffer> &accessUnit = segment->mAccessUnits.itemAt(index);
+                if (accessUnit->size() > outHeader->nAllocLen - outHeader->nOffset) {
+                    ALOGE("Output buffer too small for %zu bytes", accessUnit->size());
+                    notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+                    mSignalledError = true;
+                    return false;
+                }
+                memcpy(outHeader->pBuffer + outHeader->nOffset,
+                       accessUnit->data(), accessUnit->size());
+                outHeader->nFilledLen = accessUnit->size();
+            }
+
+            outHeader->nFlags = OMX_BUFFERFLAG_ENDOFFRAME;
+            if (segment->mFinal && index + 1 == numOutputs) {
+                outHeader->nFlags = OMX_BUFFERFLAG_EOS;
+            }
+
+            int64_t timeUs;
+            const sp<ABuffer> &frame = segment->mFrames.itemAt(
+                    segment->mNumPreRoll + (index < segment->mNumFrames ? index : 0));
+            CHECK(frame->meta()->findInt64("timeUs", &timeUs));
+            outHeader->nTimeStamp = timeUs;
+
+            outQueue.erase(outQueue.begin());
+            outInfo->mOwnedByUs = false;
+            notifyFillBufferDone(outHeader);
+
+            ++segment->mNumSent;
+        }
+
+        if (segment->mNumSent < numOutputs) {
+            break;
+        }
+
+        mSegments.erase(mSegments.begin());
+        delete segment;
+    }
+
+    return true;
+}
+
+void SoftAACEncoder2::waitForSegment(Segment *segment) {
+    Mutex::Autolock autoLock(mLock);
+    while (!segment->mDone) {
+        mDoneCondition.wait(mLock);
+    }
+}
+
+// Drops all queued input and output. Segments a worker has started on are
+// waited for, the others never get to one.
+void SoftAACEncoder2::discardSegments() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mPendingSegments.clear();
+    }
+
+    while (!mSegments.empty()) {
+        Segment *segment = *mSegments.begin();
+        bool started;
+        {
+            Mutex::Autolock autoLock(mLock);
+            started = segment->mStarted;
+        }
+        if (started) {
+            waitForSegment(segment);
+        }
+        mSegments.erase(mSegments.begin());
+        delete segment;
+    }
+
+    mFrames.clear();
+    mNumPreRollFrames = 0;
+    mCurrentFrame.clear();
+}
+
+void SoftAACEncoder2::onPortFlushCompleted(OMX_U32 portIndex) {
+    if (portIndex == 0) {
+        discardSegments();
+        mInputSize = 0;
+        mSawInputEOS = false;
+    }
+}
+
+void SoftAACEncoder2::onReset() {
+    stopWorkers();
+    discardSegments();
+
+    mSentCodecSpecificData = false;
+    mInputSize = 0;
+    mSawInputEOS = false;
+    mSignalledError = false;
+}
+
 }  // namespace android
 
 android::SoftOMXComponent *createSoftOMXComponent(
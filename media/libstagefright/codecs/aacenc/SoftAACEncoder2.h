@@ -19,11 +19,17 @@
 #define SOFT_AAC_ENCODER_2_H_
 
 #include "SimpleSoftOMXComponent.h"
+#include "AudioEncoderThreading.h"
+
+#include <utils/threads.h>
+#include <utils/Vector.h>
 
 #include "aacenc_lib.h"
 
 namespace android {
 
+struct ABuffer;
+
 struct SoftAACEncoder2 : public SimpleSoftOMXComponent {
     SoftAACEncoder2(
             const char *name,
@@ -40,14 +46,27 @@ protected:
     virtual OMX_ERRORTYPE internalSetParameter(
             OMX_INDEXTYPE index, const OMX_PTR params);
 
+    virtual OMX_ERRORTYPE getExtensionIndex(
+            const char *name, OMX_INDEXTYPE *index);
+
     virtual void onQueueFilled(OMX_U32 portIndex);
+    virtual void onPortFlushCompleted(OMX_U32 portIndex);
+    virtual void onReset();
 
 private:
     enum {
         kNumBuffers             = 4,
-        kNumSamplesPerFrame     = 1024
+        kNumSamplesPerFrame     = 1024,
+        kThreadingIndex         = kPrepareForAdaptivePlaybackIndex + 1,
+        kMaxNumThreads          = 8,
+        kDefaultSegmentFrames   = 32,
+        kPreRollFrames          = 3,
+        kLookAheadFrames        = 2,
     };
 
+    struct Segment;
+    struct Worker;
+
     HANDLE_AACENCODER mAACEncoder;
 
     OMX_U32 mNumChannels;
@@ -66,10 +85,42 @@ private:
 
     bool mSignalledError;
 
+    // Segment-parallel encoding, see onQueueFilledParallel(). Off (one
+    // thread) unless set through kThreadingIndex.
+    size_t mRequestedThreads;
+    size_t mSegmentFrames;
+    Vector<Worker *> mWorkers;
+    sp<ABuffer> mCurrentFrame;
+    Vector<sp<ABuffer> > mFrames;
+    size_t mNumPreRollFrames;
+    List<Segment *> mSegments;
+
+    Mutex mLock;
+    Condition mWorkCondition;
+    Condition mDoneCondition;
+    List<Segment *> mPendingSegments;
+    bool mStopWorkers;
+
     void initPorts();
     status_t initEncoder();
 
     status_t setAudioParams();
+    status_t configureEncoder(HANDLE_AACENCODER encoder);
+
+    bool fillInputFrame(uint8_t *frame, size_t size);
+
+    size_t chooseNumThreads() const;
+    status_t startWorkers(size_t numThreads);
+    void stopWorkers();
+    static void *WorkerThreadWrapper(void *me);
+    void workerLoop(Worker *worker);
+    bool encodeSegment(Worker *worker, Segment *segment);
+
+    void onQueueFilledParallel(size_t numBytesPerInputFrame);
+    void queueSegment(bool flush);
+    bool drainSegments();
+    void waitForSegment(Segment *segment);
+    void discardSegments();
 
     DISALLOW_EVIL_CONSTRUCTORS(SoftAACEncoder2);
 };
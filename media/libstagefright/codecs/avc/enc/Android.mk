@@ -11,10 +11,12 @@ LOCAL_SRC_FILES := \
     src/intra_est.cpp \
     src/motion_comp.cpp \
     src/motion_est.cpp \
+    src/motion_est_mt.cpp \
     src/rate_control.cpp \
     src/residual.cpp \
     src/sad.cpp \
     src/sad_halfpel.cpp \
+    src/sad_simd.cpp \
     src/slice.cpp \
     src/vlc_encode.cpp
 
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Encodes a raw YUV 4:2:0 planar file once per thread count, with the C and
+// optionally with the SSE2/NEON motion search kernels, and reports the encoding
+// speed, the share of it spent in frame level motion estimation, the bitrate and
+// PSNR of each run. The bitstream must not depend on the number of motion search
+// threads nor on the kernels, so every run is also compared with the first one;
+// the exit status is non-zero if they differ.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "avcenc_api.h"
+
+static const int kMaxRuns = 16;
+static const int kMaxDpbFrames = 17;
+
+struct Dpb {
+    uint8_t *frames[kMaxDpbFrames];
+    int numFrames;
+};
+
+static void *MallocCb(void * /* userData */, int32 size, int /* attrs */) {
+    void *ptr = malloc(size);
+    if (ptr != NULL) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+static void FreeCb(void * /* userData */, void *ptr) {
+    free(ptr);
+}
+
+static int DpbAllocCb(void *userData, uint sizeInMbs, uint numBuffers) {
+    Dpb *dpb = (Dpb *) userData;
+    if (numBuffers > (uint) kMaxDpbFrames) {
+        return 0;
+    }
+    for (int i = 0; i < dpb->numFrames; i++) {
+        free(dpb->frames[i]);
+    }
+    for (uint i = 0; i < numBuffers; i++) {
+        dpb->frames[i] = (uint8_t *) malloc((sizeInMbs << 7) * 3);
+    }
+    dpb->numFrames = numBuffers;
+    return 1;
+}
+
+static int FrameBindCb(void *userData, int index, uint8 **yuv) {
+    Dpb *dpb = (Dpb *) userData;
+    if (index < 0 || index >= dpb->numFrames) {
+        return 0;
+    }
+    *yuv = dpb->frames[index];
+    return 1;
+}
+
+static void FrameUnbindCb(void * /* userData */, int /* index */) {
+}
+
+static int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct Result {
+    int threads;
+    bool simd;
+    int frames;
+    int64_t encodeNs;
+    int64_t motionNs;   // PVAVCEncSetInput, which runs AVCMotionEstimation
+    size_t bytes;
+    double sse;
+    uint8_t *stream;
+};
+
+static double SumSquaredError(const uint8_t *a, int aPitch, const uint8_t *b, int bPitch,
+        int width, int height) {
+    double sse = 0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int d = a[y * aPitch + x] - b[y * bPitch + x];
+            sse += d * d;
+        }
+    }
+    return sse;
+}
+
+static bool encode(const uint8_t *yuv, int numFrames, int width, int height,
+        int bitrate, int fps, int threads, bool simd, Result *result) {
+    const size_t frameSize = width * height * 3 / 2;
+    const size_t streamCapacity = frameSize * numFrames + 1024;
+
+    Dpb dpb;
+    memset(&dpb, 0, sizeof(dpb));
+
+    AVCHandle handle;
+    memset(&handle, 0, sizeof(handle));
+    handle.userData = &dpb;
+    handle.CBAVC_DPBAlloc = DpbAllocCb;
+    handle.CBAVC_FrameBind = FrameBindCb;
+    handle.CBAVC_FrameUnbind = FrameUnbindCb;
+    handle.CBAVC_Malloc = MallocCb;
+    handle.CBAVC_Free = FreeCb;
+
+    // same settings as SoftAVCEncoder
+    AVCEncParams params;
+    memset(&params, 0, sizeof(params));
+    params.rate_control = AVC_ON;
+    params.init_CBP_removal_delay = 1600;
+    params.auto_scd = AVC_ON;
+    params.out_of_band_param_set = AVC_ON;
+    params.poc_type = 2;
+    params.log2_max_poc_lsb_minus_4 = 12;
+    params.num_ref_frame = 1;
+    params.num_slice_group = 1;
+    params.db_filter = AVC_ON;
+    params.constrained_intra_pred = AVC_OFF;
+    params.data_par = AVC_OFF;
+    params.fullsearch = AVC_OFF;
+    params.search_range = 16;
+    params.sub_pel = AVC_OFF;
+    params.submb_pred = AVC_OFF;
+    params.rdopt_mode = AVC_OFF;
+    params.bidir_pred = AVC_OFF;
+    params.use_overrun_buffer = AVC_OFF;
+    params.width = width;
+    params.height = height;
+    params.bitrate = bitrate;
+    params.frame_rate = 1000 * fps;
+    params.CPB_size = bitrate >> 1;
+    params.idr_period = fps;
+    params.profile = AVC_BASELINE;
+    params.level = AVC_LEVEL3_1;
+    params.num_threads = threads;
+    params.disable_simd = simd ? AVC_OFF : AVC_ON;
+
+    int numMbs = (width / 16) * (height / 16);
+    uint *sliceGroup = (uint *) calloc(numMbs, sizeof(uint));
+    params.slice_group = sliceGroup;
+
+    memset(result, 0, sizeof(*result));
+    result->threads = threads;
+    result->simd = simd;
+    result->stream = (uint8_t *) malloc(streamCapacity);
+
+    AVCEnc_Status status = PVAVCEncInitialize(&handle, &params, NULL, NULL);
+    if (status != AVCENC_SUCCESS) {
+        fprintf(stderr, "PVAVCEncInitialize failed: %d\n", status);
+        PVAVCCleanUpEncoder(&handle);
+        free(sliceGroup);
+        return false;
+    }
+
+    // SPS and PPS
+    for (;;) {
+        uint size = streamCapacity - result->bytes;
+        int type;
+        status = PVAVCEncodeNAL(&handle, result->stream + result->bytes, &size, &type);
+        if (status != AVCENC_SUCCESS) {
+            break;
+        }
+        result->bytes += size;
+    }
+
+    bool ok = true;
+    for (int n = 0; n < numFrames && ok; n++) {
+        AVCFrameIO input;
+        memset(&input, 0, sizeof(input));
+        input.height = height;
+        input.pitch = width;
+        input.coding_timestamp = n * 1000 / fps;
+        input.disp_order = n;
+        input.YCbCr[0] = (uint8 *) yuv + n * frameSize;
+        input.YCbCr[1] = input.YCbCr[0] + width * height;
+        input.YCbCr[2] = input.YCbCr[1] + (width * height >> 2);
+
+        int64_t start = nowNs();
+        status = PVAVCEncSetInput(&handle, &input);
+        int64_t motionNs = nowNs() - start;
+        result->motionNs += motionNs;
+        if (status != AVCENC_SUCCESS && status != AVCENC_NEW_IDR) {
+            // skipped by rate control
+            result->encodeNs += motionNs;
+            continue;
+        }
+        do {
+            uint size = streamCapacity - result->bytes;
+            int type;
+            status = PVAVCEncodeNAL(&handle, result->stream + result->bytes, &size, &type);
+            if (status == AVCENC_SUCCESS || status == AVCENC_PICTURE_READY) {
+                result->bytes += size;
+            } else if (status != AVCENC_SKIPPED_PICTURE) {
+                fprintf(stderr, "PVAVCEncodeNAL failed: %d\n", status);
+                ok = false;
+            }
+        } while (status == AVCENC_SUCCESS);
+        result->encodeNs += nowNs() - start;
+        if (status != AVCENC_PICTURE_READY) {
+            continue;
+        }
+        result->frames++;
+
+        AVCFrameIO recon;
+        if (PVAVCEncGetRecon(&handle, &recon) == AVCENC_SUCCESS) {
+            result->sse += SumSquaredError(input.YCbCr[0], width, recon.YCbCr[0], recon.pitch,
+                    width, height);
+            PVAVCEncReleaseRecon(&handle, &recon);
+        }
+    }
+
+    PVAVCCleanUpEncoder(&handle);
+    for (int i = 0; i < dpb.numFrames; i++) {
+        free(dpb.frames[i]);
+    }
+    free(sliceGroup);
+    return ok;
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s -w width -h height [-n frames] [-b bitrate] [-r fps] [-t threads,...] [-s]"
+            " in.yuv\n"
+            "    -w, -h  frame size, multiples of 16\n"
+            "    -n      number of frames to encode, default all\n"
+            "    -b      bitrate in bits per second, default 2000000\n"
+            "    -r      frame rate, default 30\n"
+            "    -t      comma separated motion search thread counts, default 1,2,4\n"
+            "    -s      also encode with the SIMD kernels, after the C ones\n",
+            me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int width = 0;
+    int height = 0;
+    int maxFrames = 0;
+    int bitrate = 2000000;
+    int fps = 30;
+    int threads[kMaxRuns] = { 1, 2, 4 };
+    int numRuns = 3;
+    bool simd = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:h:n:b:r:t:s")) != -1) {
+        switch (opt) {
+        case 'w':
+            width = atoi(optarg);
+            break;
+        case 'h':
+            height = atoi(optarg);
+            break;
+        case 'n':
+            maxFrames = atoi(optarg);
+            break;
+        case 'b':
+            bitrate = atoi(optarg);
+            break;
+        case 'r':
+            fps = atoi(optarg);
+            break;
+        case 't': {
+            numRuns = 0;
+            for (char *s = strtok(optarg, ","); s != NULL && numRuns < kMaxRuns / 2;
+                    s = strtok(NULL, ",")) {
+                threads[numRuns++] = atoi(s);
+            }
+            break;
+        }
+        case 's':
+            simd = true;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind + 1 != argc || width <= 0 || height <= 0 || width % 16 || height % 16
+            || fps <= 0 || numRuns == 0) {
+        usage(argv[0]);
+    }
+
+    FILE *in = fopen(argv[optind], "rb");
+    if (in == NULL) {
+        fprintf(stderr, "cannot open %s\n", argv[optind]);
+        return 1;
+    }
+    fseek(in, 0, SEEK_END);
+    long fileSize = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    const size_t frameSize = width * height * 3 / 2;
+    int numFrames = fileSize / frameSize;
+    if (maxFrames > 0 && maxFrames < numFrames) {
+        numFrames = maxFrames;
+    }
+    if (numFrames == 0) {
+        fprintf(stderr, "%s is smaller than one frame\n", argv[optind]);
+        return 1;
+    }
+    uint8_t *yuv = (uint8_t *) malloc(numFrames * frameSize);
+    if (fread(yuv, frameSize, numFrames, in) != (size_t) numFrames) {
+        fprintf(stderr, "cannot read %s\n", argv[optind]);
+        return 1;
+    }
+    fclose(in);
+
+    printf("%dx%d, %d frames, %d bps at %d fps\n", width, height, numFrames, bitrate, fps);
+    printf("threads kernels      fps  speedup    ME%%     kbps  Y-PSNR  bitstream\n");
+
+    Result results[kMaxRuns];
+    int totalRuns = simd ? numRuns * 2 : numRuns;
+    bool identical = true;
+    for (int r = 0; r < totalRuns; r++) {
+        if (!encode(yuv, numFrames, width, height, bitrate, fps, threads[r % numRuns],
+                r >= numRuns, &results[r])) {
+            return 1;
+        }
+        const Result &res = results[r];
+        double seconds = res.encodeNs / 1e9;
+        double kbps = res.bytes * 8. * fps / numFrames / 1000.;
+        double mse = res.sse / ((double) width * height * (res.frames ? res.frames : 1));
+        double psnr = mse > 0 ? 10 * log10(255. * 255. / mse) : 99.;
+        bool same = res.bytes == results[0].bytes
+                && !memcmp(res.stream, results[0].stream, res.bytes);
+        identical = identical && same;
+        printf("%7d %7s %8.1f %7.2fx %5.1f%% %8.1f %7.2f  %s\n", res.threads,
+                res.simd ? "SIMD" : "C", res.frames / seconds,
+                (double) results[0].encodeNs / res.encodeNs,
+                100. * res.motionNs / res.encodeNs, kbps, psnr,
+                r == 0 ? "reference" : same ? "identical" : "DIFFERENT");
+    }
+
+    for (int r = 0; r < totalRuns; r++) {
+        free(results[r].stream);
+    }
+    free(yuv);
+    return identical ? 0 : 1;
+}
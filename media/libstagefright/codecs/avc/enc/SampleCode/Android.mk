@@ -0,0 +1,26 @@
+LOCAL_PATH := $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    AVCEncBench.cpp
+
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE := AVCEncBench
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/../src \
+    $(LOCAL_PATH)/../../common/include
+
+LOCAL_CFLAGS := \
+    -DOSCL_IMPORT_REF= -DOSCL_UNUSED_ARG= -DOSCL_EXPORT_REF=
+
+LOCAL_STATIC_LIBRARIES := \
+    libstagefright_avcenc
+
+LOCAL_SHARED_LIBRARIES := \
+    libstagefright_avc_common
+
+LOCAL_CFLAGS += -Werror
+
+include $(BUILD_EXECUTABLE)
@@ -138,6 +138,7 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncInitialize(AVCHandle *avcHandle, AVCEncPar
     video->currFS = NULL;
     encvid->currInput = NULL;
     video->prevRefPic = NULL;
+    encvid->meThreadPool = NULL;
 
     /* now read encParams, and allocate dimension-dependent variables */
     /* such as mblock */
@@ -206,6 +207,11 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncInitialize(AVCHandle *avcHandle, AVCEncPar
         return AVCENC_MEMORY_FAIL;
     }
 
+    if (AVCENC_SUCCESS != InitMotionEstThreads(avcHandle, encParam->num_threads))
+    {
+        return AVCENC_MEMORY_FAIL;
+    }
+
     if (AVCENC_SUCCESS != InitRateControlModule(avcHandle))
     {
         return AVCENC_MEMORY_FAIL;
@@ -222,6 +228,19 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncInitialize(AVCHandle *avcHandle, AVCEncPar
     encvid->functionPointer->SAD_MB_HalfPel[1] = &AVCSAD_MB_HalfPel_Cxh;
     encvid->functionPointer->SAD_MB_HalfPel[2] = &AVCSAD_MB_HalfPel_Cyh;
     encvid->functionPointer->SAD_MB_HalfPel[3] = &AVCSAD_MB_HalfPel_Cxhyh;
+    encvid->functionPointer->Cost_I16 = &cost_i16;
+
+#ifdef AVCENC_HAVE_SIMD
+    /* SSE2 is part of every x86 ABI and NEON of arm64 and armv7-a-neon builds */
+    if (encParam->disable_simd != AVC_ON)
+    {
+        encvid->functionPointer->SAD_Macroblock = &AVCSAD_Macroblock_SIMD;
+        encvid->functionPointer->SAD_MB_HalfPel[1] = &AVCSAD_MB_HalfPel_SIMDxh;
+        encvid->functionPointer->SAD_MB_HalfPel[2] = &AVCSAD_MB_HalfPel_SIMDyh;
+        encvid->functionPointer->SAD_MB_HalfPel[3] = &AVCSAD_MB_HalfPel_SIMDxhyh;
+        encvid->functionPointer->Cost_I16 = &cost_i16_SIMD;
+    }
+#endif
 
     /* initialize timing control */
     encvid->modTimeRef = 0;     /* ALWAYS ASSUME THAT TIMESTAMP START FROM 0 !!!*/
@@ -596,6 +615,8 @@ OSCL_EXPORT_REF void    PVAVCCleanUpEncoder(AVCHandle *avcHandle)
 
     if (encvid != NULL)
     {
+        CleanMotionEstThreads(avcHandle);
+
         CleanMotionSearchModule(avcHandle);
 
         CleanupRateControlModule(avcHandle);
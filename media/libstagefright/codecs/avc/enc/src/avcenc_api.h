@@ -158,6 +158,12 @@ typedef struct tagAVCEncParam
 
     AVCFlag use_overrun_buffer;  /* do not throw away the frame if output buffer is not big enough.
                                     copy excess bits to the overrun buffer */
+
+    int num_threads; /* number of threads sharing the motion search, 0 or 1 to search on the
+                        encoding thread only. The bitstream does not depend on it. */
+
+    AVCFlag disable_simd; /* use the C motion search kernels even where SSE2 or NEON ones are
+                             built, for comparison. The bitstream does not depend on it. */
 } AVCEncParams;
 
 
@@ -336,6 +336,7 @@ typedef struct tagAVCEncFuncPtr
 
     int (*SAD_MB_HalfPel[4])(uint8*, uint8*, int, void *);
     int (*SAD_Macroblock)(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
+    int (*Cost_I16)(uint8 *org, int org_pitch, uint8 *pred, int min_cost);
 
 } AVCEncFuncPtr;
 
@@ -460,6 +461,9 @@ typedef struct tagEncObject
     /* Function pointers */
     AVCEncFuncPtr *functionPointer; /* store pointers to platform specific functions */
 
+    /* motion search threads, NULL when the search runs on the encoding thread only */
+    struct tagMEThreadPool *meThreadPool;
+
     /* Application control data */
     AVCHandle *avcHandle;
 
@@ -29,6 +29,11 @@ This file contains declarations of internal functions for AVC decoder library.
 #include "avcenc_int.h"
 #endif
 
+/* SSE2 or NEON versions of the motion search kernels are built, see sad_simd.cpp */
+#if defined(__SSE2__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define AVCENC_HAVE_SIMD
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -494,6 +499,14 @@ extern "C"
     */
     void CleanMotionSearchModule(AVCHandle *avcHandle);
 
+    /**
+    Point the half-pel and quarter-pel candidate arrays into the subpel_pred scratch memory
+    of the given encoder object.
+    \param "encvid" "Pointer to AVCEncObject."
+    \return "void."
+    */
+    void InitSubpelCandidates(AVCEncObject *encvid);
+
 
     /**
     This function performs motion estimation of all macroblocks in a frame during the InitFrame.
@@ -504,6 +517,55 @@ extern "C"
     */
     void AVCMotionEstimation(AVCEncObject *encvid);
 
+    /**
+    This function performs motion estimation of one row of macroblocks for one pass of
+    AVCMotionEstimation.
+    \param "encvid" "Pointer to AVCEncObject, with scratch memory private to the calling thread."
+    \param "j"      "Macroblock row."
+    \param "start_i" "First column of the pass, the row start is derived from it for a checkerboard pass."
+    \param "incr_i" "Column increment, 2 for a checkerboard pass."
+    \param "type_pred" "Type of candidate selection for the pass."
+    \param "rowProgress" "Per-row count of finished columns to wait on, NULL for a single thread."
+    \param "NumIntraSearch" "Number of MBs to be intra searched, accumulated."
+    \param "totalSAD" "Sum of the MB SADs for rate control, accumulated."
+    \return "void"
+    */
+    void AVCMotionEstimationRow(AVCEncObject *encvid, int j, int start_i, int incr_i,
+                                int type_pred, volatile int *rowProgress,
+                                int *NumIntraSearch, int *totalSAD);
+
+    /*-------------- motion_est_mt.c ---------------*/
+
+    /**
+    Start the threads that share the motion search with the encoding thread.
+    \param "avcHandle" "Pointer to AVCHandle."
+    \param "numThreads" "Total number of threads including the encoding thread, 0 or 1 for none."
+    \return "AVCENC_SUCCESS or AVCENC_MEMORY_FAIL."
+    */
+    AVCEnc_Status InitMotionEstThreads(AVCHandle *avcHandle, int numThreads);
+
+    /**
+    Stop the motion search threads and free their memory.
+    \param "avcHandle" "Pointer to AVCHandle."
+    \return "void."
+    */
+    void CleanMotionEstThreads(AVCHandle *avcHandle);
+
+    /**
+    This function runs one pass of the motion estimation over all macroblock rows, spread
+    over the motion search threads when there are any. Rows are handed out top to bottom and
+    each row trails the one above, so the result does not depend on the number of threads.
+    \param "encvid" "Pointer to AVCEncObject."
+    \param "start_i" "First column of the pass."
+    \param "incr_i" "Column increment."
+    \param "type_pred" "Type of candidate selection for the pass."
+    \param "NumIntraSearch" "Number of MBs to be intra searched, accumulated."
+    \param "totalSAD" "Sum of the MB SADs for rate control, accumulated."
+    \return "void"
+    */
+    void AVCMotionEstimationPass(AVCEncObject *encvid, int start_i, int incr_i, int type_pred,
+                                 int *NumIntraSearch, int *totalSAD);
+
     /**
     This function performs repetitive edge padding to the reference picture by adding 16 pixels
     around the luma and 8 pixels around the chromas.
@@ -650,12 +712,13 @@ extern "C"
 
     /**
     This function calculates the SATD of a subpel candidate.
+    \param "encvid" "Pointer to AVCEncObject, for the SAD function."
     \param "cand"   "Pointer to a candidate."
     \param "cur"    "Pointer to the current block."
     \param "dmin"   "Min-so-far SATD."
     \return "Sum of Absolute Transformed Difference."
     */
-    int SATD_MB(uint8 *cand, uint8 *cur, int dmin);
+    int SATD_MB(AVCEncObject *encvid, uint8 *cand, uint8 *cur, int dmin);
 
     /*------------- rate_control.c -------------------*/
 
@@ -805,6 +868,17 @@ extern "C"
     int AVCSAD_MB_HalfPel_Cxh(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
     int AVCSAD_Macroblock_C(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
 
+    /*------------- sad_simd.c ----------------------*/
+
+#ifdef AVCENC_HAVE_SIMD
+    /* same results as the C versions, selected in PVAVCEncInitialize */
+    int AVCSAD_MB_HalfPel_SIMDxhyh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info);
+    int AVCSAD_MB_HalfPel_SIMDyh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info);
+    int AVCSAD_MB_HalfPel_SIMDxh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info);
+    int AVCSAD_Macroblock_SIMD(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
+    int cost_i16_SIMD(uint8 *org, int org_pitch, uint8 *pred, int min_cost);
+#endif
+
 #ifdef HTFM /*  3/2/1, Hypothesis Testing Fast Matching */
     int AVCSAD_MB_HP_HTFM_Collectxhyh(uint8 *ref, uint8 *blk, int dmin_x, void *extra_info);
     int AVCSAD_MB_HP_HTFM_Collectyh(uint8 *ref, uint8 *blk, int dmin_x, void *extra_info);
@@ -438,7 +438,7 @@ void find_cost_16x16(AVCEncObject *encvid, uint8 *orgY, int *min_cost)
     /* evaluate vertical mode */
     if (video->intraAvailB)
     {
-        cost = cost_i16(orgY, org_pitch, encvid->pred_i16[AVC_I16_Vertical], *min_cost);
+        cost = encvid->functionPointer->Cost_I16(orgY, org_pitch, encvid->pred_i16[AVC_I16_Vertical], *min_cost);
         if (cost < *min_cost)
         {
             *min_cost = cost;
@@ -452,7 +452,7 @@ void find_cost_16x16(AVCEncObject *encvid, uint8 *orgY, int *min_cost)
     /* evaluate horizontal mode */
     if (video->intraAvailA)
     {
-        cost = cost_i16(orgY, org_pitch, encvid->pred_i16[AVC_I16_Horizontal], *min_cost);
+        cost = encvid->functionPointer->Cost_I16(orgY, org_pitch, encvid->pred_i16[AVC_I16_Horizontal], *min_cost);
         if (cost < *min_cost)
         {
             *min_cost = cost;
@@ -463,7 +463,7 @@ void find_cost_16x16(AVCEncObject *encvid, uint8 *orgY, int *min_cost)
     }
 
     /* evaluate DC mode */
-    cost = cost_i16(orgY, org_pitch, encvid->pred_i16[AVC_I16_DC], *min_cost);
+    cost = encvid->functionPointer->Cost_I16(orgY, org_pitch, encvid->pred_i16[AVC_I16_DC], *min_cost);
     if (cost < *min_cost)
     {
         *min_cost = cost;
@@ -475,7 +475,7 @@ void find_cost_16x16(AVCEncObject *encvid, uint8 *orgY, int *min_cost)
     /* evaluate plane mode */
     if (video->intraAvailA && video->intraAvailB && video->intraAvailD)
     {
-        cost = cost_i16(orgY, org_pitch, encvid->pred_i16[AVC_I16_Plane], *min_cost);
+        cost = encvid->functionPointer->Cost_I16(orgY, org_pitch, encvid->pred_i16[AVC_I16_Plane], *min_cost);
         if (cost < *min_cost)
         {
             *min_cost = cost;
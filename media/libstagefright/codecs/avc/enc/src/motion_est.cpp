@@ -15,6 +15,7 @@
  * and limitations under the License.
  * -------------------------------------------------------------------
  */
+#include <sched.h>
 #include "avcenc_lib.h"
 
 #define MIN_GOP     1   /* minimum size of GOP, 1/23/01, need to be tested */
@@ -75,7 +76,6 @@ AVCEnc_Status InitMotionSearchModule(AVCHandle *avcHandle)
     int temp_bits = 0;
     uint8 *mvbits;
     int bits, imax, imin, i;
-    uint8* subpel_pred = (uint8*) encvid->subpel_pred; // all 16 sub-pel positions
 
 
     while (number_of_subpel_positions > 0)
@@ -106,6 +106,16 @@ AVCEnc_Status InitMotionSearchModule(AVCHandle *avcHandle)
         for (i = imin; i < imax; i++)   mvbits[-i] = mvbits[i] = bits;
     }
 
+    InitSubpelCandidates(encvid);
+
+    return AVCENC_SUCCESS;
+}
+
+/* Point the half-pel and quarter-pel candidates into encvid->subpel_pred */
+void InitSubpelCandidates(AVCEncObject *encvid)
+{
+    uint8* subpel_pred = (uint8*) encvid->subpel_pred; // all 16 sub-pel positions
+
     /* initialize half-pel search */
     encvid->hpel_cand[0] = subpel_pred + REF_CENTER;
     encvid->hpel_cand[1] = subpel_pred + V2Q_H0Q * SUBPEL_PRED_BLK_SIZE + 1 ;
@@ -165,8 +175,7 @@ AVCEnc_Status InitMotionSearchModule(AVCHandle *avcHandle)
     encvid->bilin_base[8][2] = subpel_pred + V2Q_H0Q * SUBPEL_PRED_BLK_SIZE;
     encvid->bilin_base[8][3] = subpel_pred + V2Q_H2Q * SUBPEL_PRED_BLK_SIZE;
 
-
-    return AVCENC_SUCCESS;
+    return ;
 }
 
 /* Clean-up memory */
@@ -232,45 +241,167 @@ bool IntraDecisionABE(int *min_cost, uint8 *cur, int pitch, bool ave)
     return intra;
 }
 
-/******* main function for macroblock prediction for the entire frame ***/
-/* if turns out to be IDR frame, set video->nal_unit_type to AVC_NALTYPE_IDR */
-void AVCMotionEstimation(AVCEncObject *encvid)
+/******* motion search for one row of macroblocks ***/
+/* rowProgress is NULL when rows are searched in raster order on one thread.
+   Otherwise each row waits until the row above has finished the macroblocks
+   up to its top-right neighbor, which are the only macroblocks of the
+   current pass the candidate selection reads, and the result is the same as
+   the single-threaded search. */
+void AVCMotionEstimationRow(AVCEncObject *encvid, int j, int start_i, int incr_i,
+                            int type_pred, volatile int *rowProgress,
+                            int *NumIntraSearch, int *totalSAD)
 {
     AVCCommonObj *video = encvid->common;
-    int slice_type = video->slice_type;
     AVCFrameIO *currInput = encvid->currInput;
-    AVCPictureData *refPic = video->RefPicList0[0];
-    int i, j, k;
+    int i, k;
     int mbwidth = video->PicWidthInMbs;
     int mbheight = video->PicHeightInMbs;
-    int totalMB = video->PicSizeInMbs;
     int pitch = currInput->pitch;
     AVCMacroblock *currMB, *mblock = video->mblock;
     AVCMV *mot_mb_16x16, *mot16x16 = encvid->mot16x16;
-    // AVCMV *mot_mb_16x8, *mot_mb_8x16, *mot_mb_8x8, etc;
     AVCRateControl *rateCtrl = encvid->rateCtrl;
     uint8 *intraSearch = encvid->intraSearch;
     uint FS_en = encvid->fullsearch_enable;
+    int mbnum, offset, needed;
+    uint8 *cur, *best_cand[5];
+    int abe_cost;
+    int hp_guess = 0;
+    uint32 mv_uint32;
+
+    if (incr_i > 1) /* checkerboard, toggle 0 and 1 every row */
+    {
+        start_i = (start_i + 1 + j) & 1;
+    }
+
+    offset = pitch * (j << 4) + (start_i << 4);
+
+    mbnum = j * mbwidth + start_i;
+
+    for (i = start_i; i < mbwidth; i += incr_i)
+    {
+        if (rowProgress != NULL && j > 0)
+        {
+            needed = (i + 2 < mbwidth) ? (i + 2) : mbwidth;
+            while (__atomic_load_n(&rowProgress[j-1], __ATOMIC_ACQUIRE) < needed)
+            {
+                sched_yield();
+            }
+        }
+
+        video->mbNum = mbnum;
+        video->currMB = currMB = mblock + mbnum;
+        mot_mb_16x16 = mot16x16 + mbnum;
+
+        cur = currInput->YCbCr[0] + offset;
+
+        if (currMB->mb_intra == 0) /* for INTER mode */
+        {
+#if defined(HTFM)
+            HTFMPrepareCurMB_AVC(encvid, &encvid->htfm_stat, cur, pitch);
+#else
+            AVCPrepareCurMB(encvid, cur, pitch);
+#endif
+            /************************************************************/
+            /******** full-pel 1MV search **********************/
+
+            AVCMBMotionSearch(encvid, cur, best_cand, i << 4, j << 4, type_pred,
+                              FS_en, &hp_guess);
+
+            abe_cost = encvid->min_cost[mbnum] = mot_mb_16x16->sad;
+
+            /* set mbMode and MVs */
+            currMB->mbMode = AVC_P16;
+            currMB->MBPartPredMode[0][0] = AVC_Pred_L0;
+            mv_uint32 = ((mot_mb_16x16->y) << 16) | ((mot_mb_16x16->x) & 0xffff);
+            for (k = 0; k < 32; k += 2)
+            {
+                currMB->mvL0[k>>1] = mv_uint32;
+            }
+
+            /* make a decision whether it should be tested for intra or not */
+            if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
+            {
+                if (false == IntraDecisionABE(&abe_cost, cur, pitch, true))
+                {
+                    intraSearch[mbnum] = 0;
+                }
+                else
+                {
+                    (*NumIntraSearch)++;
+                    rateCtrl->MADofMB[mbnum] = abe_cost;
+                }
+            }
+            else // boundary MBs, always do intra search
+            {
+                (*NumIntraSearch)++;
+            }
+
+            *totalSAD += (int) rateCtrl->MADofMB[mbnum];//mot_mb_16x16->sad;
+        }
+        else    /* INTRA update, use for prediction */
+        {
+            mot_mb_16x16[0].x = mot_mb_16x16[0].y = 0;
+
+            /* reset all other MVs to zero */
+            /* mot_mb_16x8, mot_mb_8x16, mot_mb_8x8, etc. */
+            abe_cost = encvid->min_cost[mbnum] = 0x7FFFFFFF;  /* max value for int */
+
+            if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
+            {
+                IntraDecisionABE(&abe_cost, cur, pitch, false);
+
+                rateCtrl->MADofMB[mbnum] = abe_cost;
+                *totalSAD += abe_cost;
+            }
+
+            (*NumIntraSearch)++ ;
+            /* cannot do I16 prediction here because it needs full decoding. */
+            // intraSearch[mbnum] = 1;
+
+        }
+
+        if (rowProgress != NULL)
+        {
+            __atomic_store_n(&rowProgress[j], i + 1, __ATOMIC_RELEASE);
+        }
+
+        mbnum += incr_i;
+        offset += (incr_i << 4);
+
+    } /* for i */
+
+    if (rowProgress != NULL)
+    {
+        __atomic_store_n(&rowProgress[j], mbwidth, __ATOMIC_RELEASE);
+    }
+
+    return ;
+}
+
+/******* main function for macroblock prediction for the entire frame ***/
+/* if turns out to be IDR frame, set video->nal_unit_type to AVC_NALTYPE_IDR */
+void AVCMotionEstimation(AVCEncObject *encvid)
+{
+    AVCCommonObj *video = encvid->common;
+    int slice_type = video->slice_type;
+    AVCPictureData *refPic = video->RefPicList0[0];
+    int i;
+    int totalMB = video->PicSizeInMbs;
+    AVCMacroblock *mblock = video->mblock;
+    AVCRateControl *rateCtrl = encvid->rateCtrl;
+    uint8 *intraSearch = encvid->intraSearch;
 
     int NumIntraSearch, start_i, numLoop, incr_i;
-    int mbnum, offset;
-    uint8 *cur, *best_cand[5];
     int totalSAD = 0;   /* average SAD for rate control */
     int type_pred;
-    int abe_cost;
 
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/  /* 2/28/01 */
     int collect = 0;
-    HTFM_Stat htfm_stat;
     double newvar[16];
     double exp_lamda[15];
     /*********************************/
 #endif
-    int hp_guess = 0;
-    uint32 mv_uint32;
-
-    offset = 0;
 
     if (slice_type == AVC_I_SLICE)
     {
@@ -309,7 +440,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     encvid->sad_extra_info = NULL;
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/
-    InitHTFM(video, &htfm_stat, newvar, &collect);
+    InitHTFM(video, &encvid->htfm_stat, newvar, &collect);
     /*********************************/
 #endif
 
@@ -336,94 +467,8 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     NumIntraSearch = 0; // to be intra searched in the encoding loop.
     while (numLoop--)
     {
-        for (j = 0; j < mbheight; j++)
-        {
-            if (incr_i > 1)
-                start_i = (start_i == 0 ? 1 : 0) ; /* toggle 0 and 1 */
-
-            offset = pitch * (j << 4) + (start_i << 4);
-
-            mbnum = j * mbwidth + start_i;
-
-            for (i = start_i; i < mbwidth; i += incr_i)
-            {
-                video->mbNum = mbnum;
-                video->currMB = currMB = mblock + mbnum;
-                mot_mb_16x16 = mot16x16 + mbnum;
-
-                cur = currInput->YCbCr[0] + offset;
-
-                if (currMB->mb_intra == 0) /* for INTER mode */
-                {
-#if defined(HTFM)
-                    HTFMPrepareCurMB_AVC(encvid, &htfm_stat, cur, pitch);
-#else
-                    AVCPrepareCurMB(encvid, cur, pitch);
-#endif
-                    /************************************************************/
-                    /******** full-pel 1MV search **********************/
-
-                    AVCMBMotionSearch(encvid, cur, best_cand, i << 4, j << 4, type_pred,
-                                      FS_en, &hp_guess);
-
-                    abe_cost = encvid->min_cost[mbnum] = mot_mb_16x16->sad;
-
-                    /* set mbMode and MVs */
-                    currMB->mbMode = AVC_P16;
-                    currMB->MBPartPredMode[0][0] = AVC_Pred_L0;
-                    mv_uint32 = ((mot_mb_16x16->y) << 16) | ((mot_mb_16x16->x) & 0xffff);
-                    for (k = 0; k < 32; k += 2)
-                    {
-                        currMB->mvL0[k>>1] = mv_uint32;
-                    }
-
-                    /* make a decision whether it should be tested for intra or not */
-                    if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
-                    {
-                        if (false == IntraDecisionABE(&abe_cost, cur, pitch, true))
-                        {
-                            intraSearch[mbnum] = 0;
-                        }
-                        else
-                        {
-                            NumIntraSearch++;
-                            rateCtrl->MADofMB[mbnum] = abe_cost;
-                        }
-                    }
-                    else // boundary MBs, always do intra search
-                    {
-                        NumIntraSearch++;
-                    }
-
-                    totalSAD += (int) rateCtrl->MADofMB[mbnum];//mot_mb_16x16->sad;
-                }
-                else    /* INTRA update, use for prediction */
-                {
-                    mot_mb_16x16[0].x = mot_mb_16x16[0].y = 0;
-
-                    /* reset all other MVs to zero */
-                    /* mot_mb_16x8, mot_mb_8x16, mot_mb_8x8, etc. */
-                    abe_cost = encvid->min_cost[mbnum] = 0x7FFFFFFF;  /* max value for int */
-
-                    if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
-                    {
-                        IntraDecisionABE(&abe_cost, cur, pitch, false);
-
-                        rateCtrl->MADofMB[mbnum] = abe_cost;
-                        totalSAD += abe_cost;
-                    }
-
-                    NumIntraSearch++ ;
-                    /* cannot do I16 prediction here because it needs full decoding. */
-                    // intraSearch[mbnum] = 1;
-
-                }
-
-                mbnum += incr_i;
-                offset += (incr_i << 4);
-
-            } /* for i */
-        } /* for j */
+        /* rows are distributed over the motion search threads, if any */
+        AVCMotionEstimationPass(encvid, start_i, incr_i, type_pred, &NumIntraSearch, &totalSAD);
 
         /* since we cannot do intra/inter decision here, the SCD has to be
         based on other criteria such as motion vectors coherency or the SAD */
@@ -464,7 +509,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     if (collect)
     {
         collect = 0;
-        UpdateHTFM(encvid, newvar, exp_lamda, &htfm_stat);
+        UpdateHTFM(encvid, newvar, exp_lamda, &encvid->htfm_stat);
     }
     /*********************************/
 #endif
@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <pthread.h>
+#include "avcenc_lib.h"
+
+/* Motion estimation on a wavefront of threads.
+
+   The slices of a frame share the bitstream and the encoder state, so they cannot
+   be encoded in parallel; motion estimation however is done for the whole frame up
+   front in AVCMotionEstimation and does not write the bitstream. Each pass of it is
+   spread over the threads a row at a time, the encoding thread taking part. A row
+   only depends on the row above up to the top-right neighbor, see
+   AVCMotionEstimationRow, so the motion vectors, costs and the intra search map are
+   the same as with a single thread, and so are rate control and the bitstream. */
+
+#define MAX_ME_THREADS  16
+
+typedef struct tagMEThread
+{
+    struct tagMEThreadPool *pool;
+    pthread_t thread;
+
+    /* private copies, for the per-MB scratch memory and current MB */
+    AVCEncObject encvid;
+    AVCCommonObj video;
+
+    /* statistics of the rows searched in the current pass */
+    int NumIntraSearch;
+    int totalSAD;
+} METhread;
+
+typedef struct tagMEThreadPool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t startCond;   /* a pass is ready, or exit */
+    pthread_cond_t doneCond;    /* the last thread finished the pass */
+    int generation;             /* incremented for every pass */
+    int numBusy;                /* threads still working on the pass */
+    bool exit;
+
+    /* the current pass */
+    int start_i;
+    int incr_i;
+    int type_pred;
+    int nextRow;                /* next row to hand out */
+    int *rowProgress;           /* number of columns finished in each row */
+
+    int numThreads;             /* not including the encoding thread */
+    METhread *threads;
+} METhreadPool;
+
+/* Search rows until there are none left. Rows are handed out in increasing order,
+   so the row waited on has always been taken by a running thread. */
+static void SearchRows(METhreadPool *pool, AVCEncObject *encvid, int *NumIntraSearch,
+                       int *totalSAD)
+{
+    int mbheight = encvid->common->PicHeightInMbs;
+    int j;
+
+    while ((j = __atomic_fetch_add(&pool->nextRow, 1, __ATOMIC_RELAXED)) < mbheight)
+    {
+        AVCMotionEstimationRow(encvid, j, pool->start_i, pool->incr_i, pool->type_pred,
+                               pool->rowProgress, NumIntraSearch, totalSAD);
+    }
+}
+
+static void *METhreadLoop(void *arg)
+{
+    METhread *me = (METhread*) arg;
+    METhreadPool *pool = me->pool;
+    int generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->exit && pool->generation == generation)
+        {
+            pthread_cond_wait(&pool->startCond, &pool->lock);
+        }
+        if (pool->exit)
+        {
+            break;
+        }
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        SearchRows(pool, &me->encvid, &me->NumIntraSearch, &me->totalSAD);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->numBusy == 0)
+        {
+            pthread_cond_signal(&pool->doneCond);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+AVCEnc_Status InitMotionEstThreads(AVCHandle *avcHandle, int numThreads)
+{
+    AVCEncObject *encvid = (AVCEncObject*) avcHandle->AVCObject;
+    AVCCommonObj *video = encvid->common;
+    void *userData = avcHandle->userData;
+    METhreadPool *pool;
+    int i;
+
+    encvid->meThreadPool = NULL;
+
+    if (numThreads > MAX_ME_THREADS)
+    {
+        numThreads = MAX_ME_THREADS;
+    }
+    if (numThreads > (int) video->PicHeightInMbs)
+    {
+        numThreads = video->PicHeightInMbs;
+    }
+    if (numThreads <= 1)
+    {
+        return AVCENC_SUCCESS;
+    }
+
+    pool = (METhreadPool*) avcHandle->CBAVC_Malloc(userData, sizeof(METhreadPool), DEFAULT_ATTR);
+    if (pool == NULL)
+    {
+        return AVCENC_MEMORY_FAIL;
+    }
+    memset(pool, 0, sizeof(METhreadPool));
+
+    pool->rowProgress = (int*) avcHandle->CBAVC_Malloc(userData, sizeof(int) * video->PicHeightInMbs,
+                        DEFAULT_ATTR);
+    pool->threads = (METhread*) avcHandle->CBAVC_Malloc(userData, sizeof(METhread) * (numThreads - 1),
+                    DEFAULT_ATTR);
+    if (pool->rowProgress == NULL || pool->threads == NULL)
+    {
+        if (pool->rowProgress)
+        {
+            avcHandle->CBAVC_Free(userData, pool->rowProgress);
+        }
+        if (pool->threads)
+        {
+            avcHandle->CBAVC_Free(userData, pool->threads);
+        }
+        avcHandle->CBAVC_Free(userData, pool);
+        return AVCENC_MEMORY_FAIL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->startCond, NULL);
+    pthread_cond_init(&pool->doneCond, NULL);
+
+    /* from here on CleanMotionEstThreads undoes whatever was done */
+    encvid->meThreadPool = pool;
+
+    for (i = 0; i < numThreads - 1; i++)
+    {
+        pool->threads[i].pool = pool;
+        if (pthread_create(&pool->threads[i].thread, NULL, METhreadLoop, &pool->threads[i]) != 0)
+        {
+            break;
+        }
+        pool->numThreads++;
+    }
+
+    if (pool->numThreads == 0)
+    {
+        CleanMotionEstThreads(avcHandle);
+    }
+
+    return AVCENC_SUCCESS;
+}
+
+void CleanMotionEstThreads(AVCHandle *avcHandle)
+{
+    AVCEncObject *encvid = (AVCEncObject*) avcHandle->AVCObject;
+    METhreadPool *pool = encvid->meThreadPool;
+    void *userData = avcHandle->userData;
+    int i;
+
+    if (pool == NULL)
+    {
+        return ;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->exit = true;
+    pthread_cond_broadcast(&pool->startCond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->numThreads; i++)
+    {
+        pthread_join(pool->threads[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&pool->doneCond);
+    pthread_cond_destroy(&pool->startCond);
+    pthread_mutex_destroy(&pool->lock);
+
+    avcHandle->CBAVC_Free(userData, pool->threads);
+    avcHandle->CBAVC_Free(userData, pool->rowProgress);
+    avcHandle->CBAVC_Free(userData, pool);
+
+    encvid->meThreadPool = NULL;
+
+    return ;
+}
+
+void AVCMotionEstimationPass(AVCEncObject *encvid, int start_i, int incr_i, int type_pred,
+                             int *NumIntraSearch, int *totalSAD)
+{
+    METhreadPool *pool = encvid->meThreadPool;
+    int mbheight = encvid->common->PicHeightInMbs;
+    METhread *me;
+    int i, j;
+
+    if (pool == NULL)
+    {
+        for (j = 0; j < mbheight; j++)
+        {
+            AVCMotionEstimationRow(encvid, j, start_i, incr_i, type_pred, NULL,
+                                   NumIntraSearch, totalSAD);
+        }
+        return ;
+    }
+
+    /* the threads are idle, refresh their copies of the frame state */
+    for (i = 0; i < pool->numThreads; i++)
+    {
+        me = &pool->threads[i];
+        memcpy(&me->encvid, encvid, sizeof(AVCEncObject));
+        memcpy(&me->video, encvid->common, sizeof(AVCCommonObj));
+        me->encvid.common = &me->video;
+        InitSubpelCandidates(&me->encvid);
+        me->NumIntraSearch = 0;
+        me->totalSAD = 0;
+    }
+
+    memset(pool->rowProgress, 0, sizeof(int) * mbheight);
+    pool->start_i = start_i;
+    pool->incr_i = incr_i;
+    pool->type_pred = type_pred;
+    pool->nextRow = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->numBusy = pool->numThreads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->startCond);
+    pthread_mutex_unlock(&pool->lock);
+
+    SearchRows(pool, encvid, NumIntraSearch, totalSAD);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->numBusy > 0)
+    {
+        pthread_cond_wait(&pool->doneCond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->numThreads; i++)
+    {
+        *NumIntraSearch += pool->threads[i].NumIntraSearch;
+        *totalSAD += pool->threads[i].totalSAD;
+    }
+
+    return ;
+}
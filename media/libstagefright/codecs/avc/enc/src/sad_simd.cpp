@@ -0,0 +1,387 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "avcenc_lib.h"
+
+#ifdef AVCENC_HAVE_SIMD
+
+/* SSE2 and NEON versions of the motion search SAD kernels and of the I16 SATD cost.
+
+   They have to return exactly what the C versions return, the encoder decisions
+   and so the bitstream depend on it: the SADs drop out after the same macroblock
+   row as the C code once they exceed dmin, the half-pel averages use the same
+   rounding, and the SATD drops out after the same group of four rows. A 16 pixel
+   row fills a 128-bit register, so wider vectors would only help by giving up
+   the per-row drop out. */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#else
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSE2__)
+
+static inline int sad_row16(const uint8 *ref, const uint8 *blk)
+{
+    __m128i sad = _mm_sad_epu8(_mm_loadu_si128((const __m128i*)ref),
+                               _mm_loadu_si128((const __m128i*)blk));
+    return _mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4);
+}
+
+static inline int sad_row16_avg2(const uint8 *p1, const uint8 *p2, const uint8 *blk)
+{
+    /* pavgb is (a + b + 1) >> 1 */
+    __m128i avg = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)p1),
+                               _mm_loadu_si128((const __m128i*)p2));
+    __m128i sad = _mm_sad_epu8(avg, _mm_loadu_si128((const __m128i*)blk));
+    return _mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4);
+}
+
+static inline int sad_row16_avg4(const uint8 *p1, const uint8 *p3, const uint8 *blk)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    __m128i a = _mm_loadu_si128((const __m128i*)p1);
+    __m128i b = _mm_loadu_si128((const __m128i*)(p1 + 1));
+    __m128i c = _mm_loadu_si128((const __m128i*)p3);
+    __m128i d = _mm_loadu_si128((const __m128i*)(p3 + 1));
+    __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+                               _mm_add_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(d, zero)));
+    __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)),
+                               _mm_add_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(d, zero)));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+    __m128i sad = _mm_sad_epu8(_mm_packus_epi16(lo, hi), _mm_loadu_si128((const __m128i*)blk));
+    return _mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4);
+}
+
+#else /* NEON */
+
+static inline int hsum_u16(uint16x8_t v)
+{
+    uint64x2_t s = vpaddlq_u32(vpaddlq_u16(v));
+    return (int)(vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1));
+}
+
+static inline int sad_row16(const uint8 *ref, const uint8 *blk)
+{
+    return hsum_u16(vpaddlq_u8(vabdq_u8(vld1q_u8(ref), vld1q_u8(blk))));
+}
+
+static inline int sad_row16_avg2(const uint8 *p1, const uint8 *p2, const uint8 *blk)
+{
+    /* vrhadd is (a + b + 1) >> 1 */
+    uint8x16_t avg = vrhaddq_u8(vld1q_u8(p1), vld1q_u8(p2));
+    return hsum_u16(vpaddlq_u8(vabdq_u8(avg, vld1q_u8(blk))));
+}
+
+static inline int sad_row16_avg4(const uint8 *p1, const uint8 *p3, const uint8 *blk)
+{
+    uint8x16_t a = vld1q_u8(p1);
+    uint8x16_t b = vld1q_u8(p1 + 1);
+    uint8x16_t c = vld1q_u8(p3);
+    uint8x16_t d = vld1q_u8(p3 + 1);
+    uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(a), vget_low_u8(b)),
+                              vaddl_u8(vget_low_u8(c), vget_low_u8(d)));
+    uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(a), vget_high_u8(b)),
+                              vaddl_u8(vget_high_u8(c), vget_high_u8(d)));
+    /* vrshrn by 2 is (x + 2) >> 2 */
+    uint8x16_t avg = vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2));
+    return hsum_u16(vpaddlq_u8(vabdq_u8(avg, vld1q_u8(blk))));
+}
+
+#endif
+
+int AVCSAD_Macroblock_SIMD(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info)
+{
+    (void)(extra_info);
+
+    int dmin = (uint32)dmin_lx >> 16;
+    int lx = dmin_lx & 0xFFFF;
+    int sad = 0;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        sad += sad_row16(ref, blk);
+        if (sad > dmin)
+            return sad;
+        ref += lx;
+        blk += 16;
+    }
+    return sad;
+}
+
+int AVCSAD_MB_HalfPel_SIMDxhyh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info)
+{
+    (void)(extra_info);
+
+    int dmin = (uint32)dmin_rx >> 16;
+    int rx = dmin_rx & 0xFFFF;
+    int sad = 0;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        sad += sad_row16_avg4(ref, ref + rx, blk);
+        if (sad > dmin)
+            return sad;
+        ref += rx;
+        blk += 16;
+    }
+    return sad;
+}
+
+int AVCSAD_MB_HalfPel_SIMDyh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info)
+{
+    (void)(extra_info);
+
+    int dmin = (uint32)dmin_rx >> 16;
+    int rx = dmin_rx & 0xFFFF;
+    int sad = 0;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        sad += sad_row16_avg2(ref, ref + rx, blk);
+        if (sad > dmin)
+            return sad;
+        ref += rx;
+        blk += 16;
+    }
+    return sad;
+}
+
+int AVCSAD_MB_HalfPel_SIMDxh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info)
+{
+    (void)(extra_info);
+
+    int dmin = (uint32)dmin_rx >> 16;
+    int rx = dmin_rx & 0xFFFF;
+    int sad = 0;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        sad += sad_row16_avg2(ref, ref + 1, blk);
+        if (sad > dmin)
+            return sad;
+        ref += rx;
+        blk += 16;
+    }
+    return sad;
+}
+
+/* Sum of the absolute 4x4 Hadamard coefficients of four rows of 16 residues, except
+   the DC coefficients, which are returned in dc[] for the second stage transform.
+   The columns are transformed first here and the rows first in cost_i16, this gives
+   the same coefficients up to their sign and position. */
+#if defined(__SSE2__)
+
+static inline __m128i hadamard_rows4(__m128i v)
+{
+    /* lanes 4k..4k+3 hold a row of one 4x4 block */
+    const __m128i sign1 = _mm_setr_epi16(1, 1, -1, -1, 1, 1, -1, -1);
+    const __m128i sign2 = _mm_setr_epi16(1, -1, 1, -1, 1, -1, 1, -1);
+    __m128i rev = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3)),
+                                      _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_add_epi16(_mm_mullo_epi16(v, sign1), rev);
+    __m128i swap = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)),
+                                       _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_add_epi16(_mm_mullo_epi16(v, sign2), swap);
+}
+
+static inline __m128i abs_sum(__m128i acc, __m128i v)
+{
+    v = _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+    return _mm_add_epi32(acc, _mm_madd_epi16(v, _mm_set1_epi16(1)));
+}
+
+static int satd_band16(uint8 *org, int org_pitch, uint8 *pred, int16 dc[4])
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i noDC = _mm_setr_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    __m128i lo[4], hi[4];
+    __m128i acc = zero;
+    int r;
+
+    for (r = 0; r < 4; r++)
+    {
+        __m128i o = _mm_loadu_si128((const __m128i*)(org + r * org_pitch));
+        __m128i p = _mm_loadu_si128((const __m128i*)(pred + (r << 4)));
+        lo[r] = _mm_sub_epi16(_mm_unpacklo_epi8(o, zero), _mm_unpacklo_epi8(p, zero));
+        hi[r] = _mm_sub_epi16(_mm_unpackhi_epi8(o, zero), _mm_unpackhi_epi8(p, zero));
+    }
+
+#define COLUMNS(x)                                          \
+    {                                                       \
+        __m128i s0 = _mm_add_epi16(x[0], x[3]);             \
+        __m128i s1 = _mm_add_epi16(x[1], x[2]);             \
+        __m128i d0 = _mm_sub_epi16(x[0], x[3]);             \
+        __m128i d1 = _mm_sub_epi16(x[1], x[2]);             \
+        x[0] = hadamard_rows4(_mm_add_epi16(s0, s1));       \
+        x[1] = hadamard_rows4(_mm_sub_epi16(s0, s1));       \
+        x[2] = hadamard_rows4(_mm_add_epi16(d0, d1));       \
+        x[3] = hadamard_rows4(_mm_sub_epi16(d0, d1));       \
+    }
+    COLUMNS(lo)
+    COLUMNS(hi)
+#undef COLUMNS
+
+    dc[0] = _mm_extract_epi16(lo[0], 0);
+    dc[1] = _mm_extract_epi16(lo[0], 4);
+    dc[2] = _mm_extract_epi16(hi[0], 0);
+    dc[3] = _mm_extract_epi16(hi[0], 4);
+    lo[0] = _mm_and_si128(lo[0], noDC);
+    hi[0] = _mm_and_si128(hi[0], noDC);
+
+    for (r = 0; r < 4; r++)
+    {
+        acc = abs_sum(acc, lo[r]);
+        acc = abs_sum(acc, hi[r]);
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+}
+
+#else /* NEON */
+
+static inline int16x8_t hadamard_rows4(int16x8_t v)
+{
+    /* lanes 4k..4k+3 hold a row of one 4x4 block */
+    static const int16 kSign1[8] = { 1, 1, -1, -1, 1, 1, -1, -1 };
+    static const int16 kSign2[8] = { 1, -1, 1, -1, 1, -1, 1, -1 };
+    v = vaddq_s16(vmulq_s16(v, vld1q_s16(kSign1)), vrev64q_s16(v));
+    return vaddq_s16(vmulq_s16(v, vld1q_s16(kSign2)), vrev32q_s16(v));
+}
+
+static int satd_band16(uint8 *org, int org_pitch, uint8 *pred, int16 dc[4])
+{
+    static const uint16 kNoDC[8] = { 0, 0xFFFF, 0xFFFF, 0xFFFF, 0, 0xFFFF, 0xFFFF, 0xFFFF };
+    int16x8_t lo[4], hi[4];
+    uint32x4_t acc = vdupq_n_u32(0);
+    uint64x2_t sum;
+    int r;
+
+    for (r = 0; r < 4; r++)
+    {
+        uint8x16_t o = vld1q_u8(org + r * org_pitch);
+        uint8x16_t p = vld1q_u8(pred + (r << 4));
+        lo[r] = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(o), vget_low_u8(p)));
+        hi[r] = vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(o), vget_high_u8(p)));
+    }
+
+#define COLUMNS(x)                                          \
+    {                                                       \
+        int16x8_t s0 = vaddq_s16(x[0], x[3]);               \
+        int16x8_t s1 = vaddq_s16(x[1], x[2]);               \
+        int16x8_t d0 = vsubq_s16(x[0], x[3]);               \
+        int16x8_t d1 = vsubq_s16(x[1], x[2]);               \
+        x[0] = hadamard_rows4(vaddq_s16(s0, s1));           \
+        x[1] = hadamard_rows4(vsubq_s16(s0, s1));           \
+        x[2] = hadamard_rows4(vaddq_s16(d0, d1));           \
+        x[3] = hadamard_rows4(vsubq_s16(d0, d1));           \
+    }
+    COLUMNS(lo)
+    COLUMNS(hi)
+#undef COLUMNS
+
+    dc[0] = vgetq_lane_s16(lo[0], 0);
+    dc[1] = vgetq_lane_s16(lo[0], 4);
+    dc[2] = vgetq_lane_s16(hi[0], 0);
+    dc[3] = vgetq_lane_s16(hi[0], 4);
+    lo[0] = vreinterpretq_s16_u16(vandq_u16(vreinterpretq_u16_s16(lo[0]), vld1q_u16(kNoDC)));
+    hi[0] = vreinterpretq_s16_u16(vandq_u16(vreinterpretq_u16_s16(hi[0]), vld1q_u16(kNoDC)));
+
+    for (r = 0; r < 4; r++)
+    {
+        acc = vpadalq_u16(acc, vreinterpretq_u16_s16(vabsq_s16(lo[r])));
+        acc = vpadalq_u16(acc, vreinterpretq_u16_s16(vabsq_s16(hi[r])));
+    }
+    sum = vpaddlq_u32(acc);
+    return (int)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+}
+
+#endif
+
+/* same as cost_i16 */
+int cost_i16_SIMD(uint8 *org, int org_pitch, uint8 *pred, int min_cost)
+{
+    int16 dc[4][4];
+    int cost = 0;
+    int j, k;
+    int m0, m1, m2, m3;
+
+    for (j = 0; j < 4; j++)
+    {
+        cost += satd_band16(org, org_pitch, pred, dc[j]);
+        if ((cost >> 1) > min_cost) /* early drop out */
+        {
+            return (cost >> 1);
+        }
+        org += (org_pitch << 2);
+        pred += 64;
+    }
+
+    /* Hadamard of the DC coefficient, as in cost_i16 */
+    for (j = 0; j < 4; j++)
+    {
+        m0 = dc[j][0];
+        m3 = dc[j][3];
+        m0 >>= 2;
+        m0 += (m3 >> 2);
+        m3 = m0 - (m3 >> 1);
+        m1 = dc[j][1];
+        m2 = dc[j][2];
+        m1 >>= 2;
+        m1 += (m2 >> 2);
+        m2 = m1 - (m2 >> 1);
+        dc[j][0] = (m0 + m1);
+        dc[j][2] = (m0 - m1);
+        dc[j][1] = (m2 + m3);
+        dc[j][3] = (m3 - m2);
+    }
+
+    for (k = 0; k < 4; k++)
+    {
+        m0 = dc[0][k];
+        m3 = dc[3][k];
+        m0 += m3;
+        m3 = m0 - (m3 << 1);
+        m1 = dc[1][k];
+        m2 = dc[2][k];
+        m1 += m2;
+        m2 = m1 - (m2 << 1);
+        m0 = m0 + m1;
+        cost += ((m0 >= 0) ? m0 : -m0);
+        m1 = m0 - (m1 << 1);
+        cost += ((m1 >= 0) ? m1 : -m1);
+        m3 = m2 + m3;
+        cost += ((m3 >= 0) ? m3 : -m3);
+        m2 = m3 - (m2 << 1);
+        cost += ((m2 >= 0) ? m2 : -m2);
+
+        if ((cost >> 1) > min_cost) /* early drop out */
+        {
+            return (cost >> 1);
+        }
+    }
+
+    return (cost >> 1);
+}
+
+#endif /* AVCENC_HAVE_SIMD */
@@ -70,6 +70,9 @@ SoftHEVC::SoftHEVC(
             320 /* width */, 240 /* height */, callbacks,
             appData, component),
       mMemRecords(NULL),
+      mRequestedCores(0),
+      mAutoTuneCores(false),
+      mThreadingChanged(false),
       mFlushOutBuffer(NULL),
       mOmxColorFormat(OMX_COLOR_FormatYUV420Planar),
       mIvColorFormat(IV_YUV_420P),
@@ -195,10 +198,45 @@ status_t SoftHEVC::resetDecoder() {
     return OK;
 }
 
+/* Called with mThreadingLock held */
+size_t SoftHEVC::chooseNumCores() {
+    size_t numCores = mRequestedCores;
+    if (numCores == 0) {
+        numCores = GetCPUCoreCount();
+    }
+
+    if (mAutoTuneCores) {
+        /* The decoder splits a picture into jobs of CTB rows. Small pictures
+         * have too few rows to keep more threads busy, the extra threads only
+         * add synchronization overhead */
+        size_t sizeY = (size_t)mWidth * mHeight;
+        size_t maxCores;
+        if (sizeY <= 352 * 288) {
+            maxCores = 1;
+        } else if (sizeY <= 960 * 540) {
+            maxCores = 2;
+        } else if (sizeY <= 1280 * 720) {
+            maxCores = 3;
+        } else {
+            maxCores = 4;
+        }
+        numCores = min(numCores, maxCores);
+    }
+
+    return numCores;
+}
+
 status_t SoftHEVC::setNumCores() {
     ivdext_ctl_set_num_cores_ip_t s_set_cores_ip;
     ivdext_ctl_set_num_cores_op_t s_set_cores_op;
     IV_API_CALL_STATUS_T status;
+
+    {
+        Mutex::Autolock autoLock(mThreadingLock);
+        mNumCores = chooseNumCores();
+        mThreadingChanged = false;
+    }
+
     s_set_cores_ip.e_cmd = IVD_CMD_VIDEO_CTL;
     s_set_cores_ip.e_sub_cmd = IVDEXT_CMD_CTL_SET_NUM_CORES;
     s_set_cores_ip.u4_num_cores = MIN(mNumCores, CODEC_MAX_NUM_CORES);
@@ -215,6 +253,16 @@ status_t SoftHEVC::setNumCores() {
     return OK;
 }
 
+void SoftHEVC::applyThreadingChange() {
+    {
+        Mutex::Autolock autoLock(mThreadingLock);
+        if (!mThreadingChanged) {
+            return;
+        }
+    }
+    setNumCores();
+}
+
 status_t SoftHEVC::setFlushMode() {
     IV_API_CALL_STATUS_T status;
     ivd_ctl_flush_ip_t s_video_flush_ip;
@@ -248,8 +296,6 @@ status_t SoftHEVC::initDecoder() {
     UWORD32 u4_share_disp_buf;
     WORD32 i4_level;
 
-    mNumCores = GetCPUCoreCount();
-
     /* Initialize number of ref and reorder modes (for HEVC) */
     u4_num_reorder_frames = 16;
     u4_num_ref_frames = 16;
@@ -468,7 +514,54 @@ void SoftHEVC::onReset() {
     resetPlugin();
 }
 
+OMX_ERRORTYPE SoftHEVC::internalGetParameter(OMX_INDEXTYPE index, OMX_PTR params) {
+    switch ((int)index) {
+        case kThreadingIndex:
+        {
+            VideoDecoderThreadingParams *threadingParams =
+                (VideoDecoderThreadingParams *)params;
+            if (threadingParams->nSize != sizeof(VideoDecoderThreadingParams)) {
+                return OMX_ErrorUndefined;
+            }
+
+            Mutex::Autolock autoLock(mThreadingLock);
+            threadingParams->nNumCores = mRequestedCores;
+            threadingParams->bAutoTune = mAutoTuneCores ? OMX_TRUE : OMX_FALSE;
+            threadingParams->nDecodeAhead =
+                editPortInfo(kInputPortIndex)->mDef.nBufferCountMin;
+            return OMX_ErrorNone;
+        }
+
+        default:
+            return SoftVideoDecoderOMXComponent::internalGetParameter(index, params);
+    }
+}
+
 OMX_ERRORTYPE SoftHEVC::internalSetParameter(OMX_INDEXTYPE index, const OMX_PTR params) {
+    if ((int)index == kThreadingIndex) {
+        const VideoDecoderThreadingParams *threadingParams =
+            (const VideoDecoderThreadingParams *)params;
+        if (threadingParams->nSize != sizeof(VideoDecoderThreadingParams)) {
+            return OMX_ErrorUndefined;
+        }
+
+        OMX_U32 numBuffers = threadingParams->nDecodeAhead;
+        if (numBuffers == 0) {
+            numBuffers = kNumBuffers;
+        }
+        if (numBuffers < kMinNumBuffers || numBuffers > kMaxNumBuffers) {
+            return OMX_ErrorBadParameter;
+        }
+
+        for (OMX_U32 port = 0; port <= kMaxPortIndex; ++port) {
+            OMX_PARAM_PORTDEFINITIONTYPE *def = &editPortInfo(port)->mDef;
+            def->nBufferCountMin = numBuffers;
+            def->nBufferCountActual = numBuffers;
+        }
+
+        return setConfig(index, params);
+    }
+
     const uint32_t oldWidth = mWidth;
     const uint32_t oldHeight = mHeight;
     OMX_ERRORTYPE ret = SoftVideoDecoderOMXComponent::internalSetParameter(index, params);
@@ -478,6 +571,40 @@ OMX_ERRORTYPE SoftHEVC::internalSetParameter(OMX_INDEXTYPE index, const OMX_PTR
     return ret;
 }
 
+OMX_ERRORTYPE SoftHEVC::getConfig(OMX_INDEXTYPE index, OMX_PTR params) {
+    if ((int)index == kThreadingIndex) {
+        return internalGetParameter(index, params);
+    }
+    return SoftVideoDecoderOMXComponent::getConfig(index, params);
+}
+
+OMX_ERRORTYPE SoftHEVC::setConfig(OMX_INDEXTYPE index, const OMX_PTR params) {
+    if ((int)index == kThreadingIndex) {
+        const VideoDecoderThreadingParams *threadingParams =
+            (const VideoDecoderThreadingParams *)params;
+        if (threadingParams->nSize != sizeof(VideoDecoderThreadingParams)) {
+            return OMX_ErrorUndefined;
+        }
+
+        Mutex::Autolock autoLock(mThreadingLock);
+        mRequestedCores = threadingParams->nNumCores;
+        mAutoTuneCores = threadingParams->bAutoTune;
+        mThreadingChanged = true;
+        ALOGV("threading: cores %zu%s", mRequestedCores,
+                mAutoTuneCores ? ", auto-tune" : "");
+        return OMX_ErrorNone;
+    }
+    return SoftVideoDecoderOMXComponent::setConfig(index, params);
+}
+
+OMX_ERRORTYPE SoftHEVC::getExtensionIndex(const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, VIDEO_DECODER_THREADING_EXTENSION)) {
+        *(int32_t*)index = kThreadingIndex;
+        return OMX_ErrorNone;
+    }
+    return SoftVideoDecoderOMXComponent::getExtensionIndex(name, index);
+}
+
 void SoftHEVC::setDecodeArgs(ivd_video_decode_ip_t *ps_dec_ip,
         ivd_video_decode_op_t *ps_dec_op,
         OMX_BUFFERHEADERTYPE *inHeader,
@@ -565,6 +692,11 @@ void SoftHEVC::onQueueFilled(OMX_U32 portIndex) {
         setFlushMode();
     }
 
+    /* Pick up a new number of cores set through setConfig() */
+    if (!mInitNeeded) {
+        applyThreadingChange();
+    }
+
     while (!outQueue.empty()) {
         BufferInfo *inInfo;
         OMX_BUFFERHEADERTYPE *inHeader;
@@ -19,6 +19,7 @@
 #define SOFT_HEVC_H_
 
 #include "SoftVideoDecoderOMXComponent.h"
+#include "VideoDecoderThreading.h"
 #include <sys/time.h>
 
 namespace android {
@@ -62,11 +63,22 @@ protected:
     virtual void onQueueFilled(OMX_U32 portIndex);
     virtual void onPortFlushCompleted(OMX_U32 portIndex);
     virtual void onReset();
+    virtual OMX_ERRORTYPE internalGetParameter(OMX_INDEXTYPE index, OMX_PTR params);
     virtual OMX_ERRORTYPE internalSetParameter(OMX_INDEXTYPE index, const OMX_PTR params);
+    virtual OMX_ERRORTYPE getConfig(OMX_INDEXTYPE index, OMX_PTR params);
+    virtual OMX_ERRORTYPE setConfig(OMX_INDEXTYPE index, const OMX_PTR params);
+    virtual OMX_ERRORTYPE getExtensionIndex(const char *name, OMX_INDEXTYPE *index);
 private:
-    // Number of input and output buffers
+    // Default number of input and output buffers, and the range allowed
+    // through VideoDecoderThreadingParams::nDecodeAhead
     enum {
-        kNumBuffers = 8
+        kNumBuffers = 8,
+        kMinNumBuffers = 2,
+        kMaxNumBuffers = 32,
+    };
+
+    enum {
+        kThreadingIndex = kPrepareForAdaptivePlaybackIndex + 1,
     };
 
     iv_obj_t *mCodecCtx;         // Codec context
@@ -75,6 +87,14 @@ private:
 
     size_t mNumCores;            // Number of cores to be uesd by the codec
 
+    // Threading settings, see VideoDecoderThreadingParams. setConfig() may be
+    // called while onQueueFilled() is decoding, so it only stores them under
+    // mThreadingLock and they are applied before the next decode call.
+    Mutex mThreadingLock;
+    size_t mRequestedCores;      // 0 for one per online CPU
+    bool mAutoTuneCores;
+    bool mThreadingChanged;
+
     struct timeval mTimeStart;   // Time at the start of decode()
     struct timeval mTimeEnd;     // Time at the end of decode()
 
@@ -106,7 +126,9 @@ private:
     status_t setFlushMode();
     status_t setParams(size_t stride);
     void logVersion();
+    size_t chooseNumCores();
     status_t setNumCores();
+    void applyThreadingChange();
     status_t resetDecoder();
     status_t resetPlugin();
     status_t reInitDecoder();
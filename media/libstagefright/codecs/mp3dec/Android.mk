@@ -52,6 +52,17 @@ LOCAL_CFLAGS := \
 
 LOCAL_CFLAGS += -Werror
 
+# Vector versions of the synthesis filterbank, IMDCT and alias reduction,
+# bit exact with the C code (see src/pv_mp3dec_simd_op.h). 32 bit ARM uses
+# the assembly versions above instead.
+ifeq ($(TARGET_ARCH),x86_64)
+LOCAL_CFLAGS += -DPV_MP3DEC_SSE4_1 -msse4.1
+endif
+
+ifeq ($(TARGET_ARCH),arm64)
+LOCAL_CFLAGS += -DPV_MP3DEC_NEON
+endif
+
 LOCAL_MODULE := libstagefright_mp3dec
 
 LOCAL_ARM_MODE := arm
@@ -0,0 +1,56 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pv_mp3dec_simd_op.h
+
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ This file select the associated vector functions with the ARCH.
+
+ Each function works on four int32 lanes and gives in every lane exactly
+ the result of the scalar function of the same name in pv_mp3dec_fxd_op.h,
+ so the vector code paths are bit exact with the C code paths.
+
+ PV_MP3DEC_SIMD is defined when a vector implementation is available.
+
+------------------------------------------------------------------------------
+*/
+
+#ifndef PV_MP3DEC_SIMD_OP_H
+#define PV_MP3DEC_SIMD_OP_H
+
+#include "pvmp3_audio_type_defs.h"
+
+
+#if defined(PV_MP3DEC_SSE4_1)
+
+#include "pv_mp3dec_simd_op_sse41.h"
+
+#elif defined(PV_MP3DEC_NEON)
+
+#include "pv_mp3dec_simd_op_neon.h"
+
+#endif
+
+
+#endif  /* PV_MP3DEC_SIMD_OP_H */
@@ -0,0 +1,165 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pv_mp3dec_simd_op_neon.h
+
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ NEON vector functions. vqdmulh rounds and saturates differently from the
+ C code, so the products are formed with vmull and narrowed.
+
+------------------------------------------------------------------------------
+*/
+
+#ifndef PV_MP3DEC_SIMD_OP_NEON_H
+#define PV_MP3DEC_SIMD_OP_NEON_H
+
+#include <arm_neon.h>
+
+#include "pvmp3_audio_type_defs.h"
+
+#define PV_MP3DEC_SIMD
+
+typedef int32x4_t vec_int32;
+
+
+static inline vec_int32 vec_dup(int32 a)
+{
+    return vdupq_n_s32(a);
+}
+
+static inline vec_int32 vec_load(const int32 *p)
+{
+    return vld1q_s32(p);
+}
+
+/* p[3], p[2], p[1], p[0] */
+static inline vec_int32 vec_load_rev(const int32 *p)
+{
+    int32x4_t a = vrev64q_s32(vld1q_s32(p));
+    return vcombine_s32(vget_high_s32(a), vget_low_s32(a));
+}
+
+static inline void vec_store(int32 *p, vec_int32 a)
+{
+    vst1q_s32(p, a);
+}
+
+/* p[0] = a[3], ... p[3] = a[0] */
+static inline void vec_store_rev(int32 *p, vec_int32 a)
+{
+    a = vrev64q_s32(a);
+    vst1q_s32(p, vcombine_s32(vget_high_s32(a), vget_low_s32(a)));
+}
+
+static inline vec_int32 vec_add(vec_int32 a, vec_int32 b)
+{
+    return vaddq_s32(a, b);
+}
+
+static inline vec_int32 vec_sub(vec_int32 a, vec_int32 b)
+{
+    return vsubq_s32(a, b);
+}
+
+static inline vec_int32 vec_shl1(vec_int32 a)
+{
+    return vshlq_n_s32(a, 1);
+}
+
+/* (a * b) >> 32, lane by lane */
+static inline vec_int32 vec_mul32_Q32(vec_int32 a, vec_int32 b)
+{
+    int64x2_t lo = vmull_s32(vget_low_s32(a), vget_low_s32(b));
+    int64x2_t hi = vmull_s32(vget_high_s32(a), vget_high_s32(b));
+    return vcombine_s32(vshrn_n_s64(lo, 32), vshrn_n_s64(hi, 32));
+}
+
+/* low 32 bits of (a * b) >> 28, lane by lane */
+static inline vec_int32 vec_mul32_Q28(vec_int32 a, vec_int32 b)
+{
+    int64x2_t lo = vmull_s32(vget_low_s32(a), vget_low_s32(b));
+    int64x2_t hi = vmull_s32(vget_high_s32(a), vget_high_s32(b));
+    return vcombine_s32(vshrn_n_s64(lo, 28), vshrn_n_s64(hi, 28));
+}
+
+/* low 32 bits of (a * b) >> 27, lane by lane */
+static inline vec_int32 vec_mul32_Q27(vec_int32 a, vec_int32 b)
+{
+    int64x2_t lo = vmull_s32(vget_low_s32(a), vget_low_s32(b));
+    int64x2_t hi = vmull_s32(vget_high_s32(a), vget_high_s32(b));
+    return vcombine_s32(vshrn_n_s64(lo, 27), vshrn_n_s64(hi, 27));
+}
+
+static inline vec_int32 vec_mac32_Q32(vec_int32 L_add, vec_int32 a, vec_int32 b)
+{
+    return vaddq_s32(L_add, vec_mul32_Q32(a, b));
+}
+
+static inline vec_int32 vec_msb32_Q32(vec_int32 L_sub, vec_int32 a, vec_int32 b)
+{
+    return vsubq_s32(L_sub, vec_mul32_Q32(a, b));
+}
+
+
+/*
+ * Sum of (a * b) >> 32 terms. The high words of the 64 bit products are
+ * added where they are and only gathered at the end.
+ */
+typedef struct
+{
+    int32x4_t lo;
+    int32x4_t hi;
+} vec_acc32_Q32;
+
+static inline void vec_acc_init(vec_acc32_Q32 *acc, int32 L_add)
+{
+    int32x2_t init = vset_lane_s32(L_add, vdup_n_s32(0), 1);
+    acc->lo = vcombine_s32(init, init);
+    acc->hi = acc->lo;
+}
+
+static inline void vec_acc_mac32_Q32(vec_acc32_Q32 *acc, vec_int32 a, vec_int32 b)
+{
+    acc->lo = vaddq_s32(acc->lo, vreinterpretq_s32_s64(
+                  vmull_s32(vget_low_s32(a), vget_low_s32(b))));
+    acc->hi = vaddq_s32(acc->hi, vreinterpretq_s32_s64(
+                  vmull_s32(vget_high_s32(a), vget_high_s32(b))));
+}
+
+static inline void vec_acc_msb32_Q32(vec_acc32_Q32 *acc, vec_int32 a, vec_int32 b)
+{
+    acc->lo = vsubq_s32(acc->lo, vreinterpretq_s32_s64(
+                  vmull_s32(vget_low_s32(a), vget_low_s32(b))));
+    acc->hi = vsubq_s32(acc->hi, vreinterpretq_s32_s64(
+                  vmull_s32(vget_high_s32(a), vget_high_s32(b))));
+}
+
+static inline vec_int32 vec_acc_result(const vec_acc32_Q32 *acc)
+{
+    /* high words are lanes 1, 3 */
+    return vuzpq_s32(acc->lo, acc->hi).val[1];
+}
+
+
+#endif  /* PV_MP3DEC_SIMD_OP_NEON_H */
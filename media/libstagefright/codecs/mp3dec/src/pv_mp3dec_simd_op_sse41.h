@@ -0,0 +1,193 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pv_mp3dec_simd_op_sse41.h
+
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ SSE4.1 vector functions. They rely on the signed 32x32->64 bit multiply
+ of SSE4.1; with SSE2 alone the sign fix-up of the unsigned multiply
+ makes them slower than the C code.
+
+------------------------------------------------------------------------------
+*/
+
+#ifndef PV_MP3DEC_SIMD_OP_SSE41_H
+#define PV_MP3DEC_SIMD_OP_SSE41_H
+
+#ifndef __SSE4_1__
+#error "PV_MP3DEC_SSE4_1 needs SSE4.1 code generation (-msse4.1)"
+#endif
+
+#include <smmintrin.h>
+
+#include "pvmp3_audio_type_defs.h"
+
+#define PV_MP3DEC_SIMD
+
+typedef __m128i vec_int32;
+
+
+static inline vec_int32 vec_dup(int32 a)
+{
+    return _mm_set1_epi32(a);
+}
+
+static inline vec_int32 vec_load(const int32 *p)
+{
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+/* p[3], p[2], p[1], p[0] */
+static inline vec_int32 vec_load_rev(const int32 *p)
+{
+    return _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)p),
+                             _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+static inline void vec_store(int32 *p, vec_int32 a)
+{
+    _mm_storeu_si128((__m128i *)p, a);
+}
+
+/* p[0] = a[3], ... p[3] = a[0] */
+static inline void vec_store_rev(int32 *p, vec_int32 a)
+{
+    _mm_storeu_si128((__m128i *)p, _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 1, 2, 3)));
+}
+
+static inline vec_int32 vec_add(vec_int32 a, vec_int32 b)
+{
+    return _mm_add_epi32(a, b);
+}
+
+static inline vec_int32 vec_sub(vec_int32 a, vec_int32 b)
+{
+    return _mm_sub_epi32(a, b);
+}
+
+static inline vec_int32 vec_shl1(vec_int32 a)
+{
+    return _mm_add_epi32(a, a);
+}
+
+/*
+ * 64 bit products of lanes 0, 2 (even) and lanes 1, 3 (odd) of a and b
+ */
+static inline void vec_mul64(vec_int32 a, vec_int32 b,
+                             __m128i *even, __m128i *odd)
+{
+    *even = _mm_mul_epi32(a, b);
+    *odd  = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+}
+
+/* (a * b) >> 32, lane by lane */
+static inline vec_int32 vec_mul32_Q32(vec_int32 a, vec_int32 b)
+{
+    __m128i even, odd;
+    vec_mul64(a, b, &even, &odd);
+    return _mm_or_si128(_mm_srli_epi64(even, 32),
+                        _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+}
+
+/* low 32 bits of (a * b) >> n, lane by lane, 0 < n < 32 */
+static inline vec_int32 vec_mul32_Qn(vec_int32 a, vec_int32 b, const int n)
+{
+    __m128i even, odd;
+    vec_mul64(a, b, &even, &odd);
+    return _mm_or_si128(_mm_and_si128(_mm_srli_epi64(even, n),
+                                      _mm_set_epi32(0, -1, 0, -1)),
+                        _mm_and_si128(_mm_slli_epi64(odd, 32 - n),
+                                      _mm_set_epi32(-1, 0, -1, 0)));
+}
+
+static inline vec_int32 vec_mul32_Q28(vec_int32 a, vec_int32 b)
+{
+    return vec_mul32_Qn(a, b, 28);
+}
+
+static inline vec_int32 vec_mul32_Q27(vec_int32 a, vec_int32 b)
+{
+    return vec_mul32_Qn(a, b, 27);
+}
+
+static inline vec_int32 vec_mac32_Q32(vec_int32 L_add, vec_int32 a, vec_int32 b)
+{
+    return _mm_add_epi32(L_add, vec_mul32_Q32(a, b));
+}
+
+static inline vec_int32 vec_msb32_Q32(vec_int32 L_sub, vec_int32 a, vec_int32 b)
+{
+    return _mm_sub_epi32(L_sub, vec_mul32_Q32(a, b));
+}
+
+
+/*
+ * Sum of (a * b) >> 32 terms. The high words of the 64 bit products are
+ * added where they are and only gathered at the end.
+ */
+typedef struct
+{
+    __m128i even;
+    __m128i odd;
+} vec_acc32_Q32;
+
+static inline void vec_acc_init(vec_acc32_Q32 *acc, int32 L_add)
+{
+    acc->even = _mm_set_epi32(L_add, 0, L_add, 0);
+    acc->odd  = acc->even;
+}
+
+static inline void vec_acc_products(vec_int32 a, vec_int32 b,
+                                    __m128i *even, __m128i *odd)
+{
+    *even = _mm_mul_epi32(a, b);
+    *odd  = _mm_mul_epi32(_mm_shuffle_epi32(a, _MM_SHUFFLE(3, 3, 1, 1)),
+                          _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 3, 1, 1)));
+}
+
+static inline void vec_acc_mac32_Q32(vec_acc32_Q32 *acc, vec_int32 a, vec_int32 b)
+{
+    __m128i even, odd;
+    vec_acc_products(a, b, &even, &odd);
+    acc->even = _mm_add_epi32(acc->even, even);
+    acc->odd  = _mm_add_epi32(acc->odd, odd);
+}
+
+static inline void vec_acc_msb32_Q32(vec_acc32_Q32 *acc, vec_int32 a, vec_int32 b)
+{
+    __m128i even, odd;
+    vec_acc_products(a, b, &even, &odd);
+    acc->even = _mm_sub_epi32(acc->even, even);
+    acc->odd  = _mm_sub_epi32(acc->odd, odd);
+}
+
+static inline vec_int32 vec_acc_result(const vec_acc32_Q32 *acc)
+{
+    /* high words of even are lanes 1, 3, of odd lanes 1, 3 */
+    return _mm_or_si128(_mm_srli_epi64(acc->even, 32),
+                        _mm_and_si128(acc->odd, _mm_set_epi32(-1, 0, -1, 0)));
+}
+
+
+#endif  /* PV_MP3DEC_SIMD_OP_SSE41_H */
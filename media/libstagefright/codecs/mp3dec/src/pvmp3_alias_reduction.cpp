@@ -94,6 +94,7 @@ Input
 
 #include "pvmp3_alias_reduction.h"
 #include "pv_mp3dec_fxd_op.h"
+#include "pv_mp3dec_simd_op.h"
 
 
 /*----------------------------------------------------------------------------
@@ -159,15 +160,18 @@ void pvmp3_alias_reduction(int32 *input_buffer,         /* Ptr to spec values of
                            int32  *used_freq_lines,
                            mp3Header *info)
 {
-    int32 *ptr1;
     int32 *ptr2;
+#ifndef PV_MP3DEC_SIMD
+    int32 *ptr1;
     int32 *ptr3;
     int32 *ptr4;
     const int32 *ptr_csi;
     const int32 *ptr_csa;
+    int32 i;
+#endif
     int32  sblim;
 
-    int32 i, j;
+    int32 j;
 
     *used_freq_lines = fxp_mul32_Q32(*used_freq_lines << 16, (int32)(0x7FFFFFFF / (float)18 - 1.0f)) >> 15;
 
@@ -195,6 +199,35 @@ void pvmp3_alias_reduction(int32 *input_buffer,         /* Ptr to spec values of
     }
 
 
+#ifdef PV_MP3DEC_SIMD
+
+    /*
+     *  The 8 butterflies of a pair of sub-bands, 4 at a time
+     */
+    vec_int32 csi1 = vec_load(&c_signal[0]);
+    vec_int32 csi2 = vec_load(&c_signal[4]);
+    vec_int32 csa1 = vec_load(&c_alias[0]);
+    vec_int32 csa2 = vec_load(&c_alias[4]);
+
+    ptr2 = &input_buffer[18];
+
+    for (j = sblim; j != 0; j--)
+    {
+        vec_int32 x = vec_shl1(vec_load_rev(&ptr2[-4]));
+        vec_int32 y = vec_shl1(vec_load(&ptr2[0]));
+        vec_store_rev(&ptr2[-4], vec_msb32_Q32(vec_mul32_Q32(x, csi1), y, csa1));
+        vec_store(&ptr2[0], vec_mac32_Q32(vec_mul32_Q32(y, csi1), x, csa1));
+
+        x = vec_shl1(vec_load_rev(&ptr2[-8]));
+        y = vec_shl1(vec_load(&ptr2[4]));
+        vec_store_rev(&ptr2[-8], vec_msb32_Q32(vec_mul32_Q32(x, csi2), y, csa2));
+        vec_store(&ptr2[4], vec_mac32_Q32(vec_mul32_Q32(y, csi2), x, csa2));
+
+        ptr2 += FILTERBANK_BANDS;
+    }
+
+#else
+
     ptr3 = &input_buffer[17];
     ptr4 = &input_buffer[18];
     ptr_csi = c_signal;
@@ -258,4 +291,6 @@ void pvmp3_alias_reduction(int32 *input_buffer,         /* Ptr to spec values of
         }
     }
 
+#endif  /* PV_MP3DEC_SIMD */
+
 }
@@ -70,6 +70,7 @@ Returns
 
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_mdct_18.h"
+#include "pv_mp3dec_simd_op.h"
 
 
 /*----------------------------------------------------------------------------
@@ -147,7 +148,32 @@ void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window)
     int32 *pt_vec_o = &vec[17];
 
 
+#ifdef PV_MP3DEC_SIMD
+
+    /*
+     *  First 8 of the 9 butterflies below, 4 at a time
+     */
+    for (i = 0; i < 8; i += 4)
+    {
+        vec_int32 vtmp  = vec_load(&vec[i]);
+        vec_int32 vtmp1 = vec_load_rev(&vec[14 - i]);
+        vtmp  = vec_mul32_Q32(vec_shl1(vtmp), vec_load(&cosTerms_1_ov_cos_phi[i]));
+        vtmp1 = vec_mul32_Q27(vtmp1, vec_load_rev(&cosTerms_1_ov_cos_phi[14 - i]));
+        vec_store(&vec[i], vec_add(vtmp, vtmp1));
+        vec_store_rev(&vec[14 - i],
+                      vec_mul32_Q28(vec_sub(vtmp, vtmp1), vec_load(&cosTerms_dct18[i])));
+    }
+
+    pt_vec       += 8;
+    pt_vec_o     -= 8;
+    pt_cos       += 8;
+    pt_cos_x     -= 8;
+    pt_cos_split += 8;
+
+    for (i = 1; i != 0; i--)
+#else
     for (i = 9; i != 0; i--)
+#endif
     {
         tmp  = *(pt_vec);
         tmp1 = *(pt_vec_o);
@@ -243,6 +269,31 @@ void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window)
 
     /* next iteration overlap */
 
+#ifdef PV_MP3DEC_SIMD
+
+    /*
+     *  history[k]   = history[8-k] * window[18+k]
+     *  history[9+k] = history[k]   * window[27+k], k = 0..8
+     */
+    {
+        vec_int32 hist0 = vec_shl1(vec_load(&history[0]));
+        vec_int32 hist4 = vec_shl1(vec_load(&history[4]));
+        vec_int32 rev5  = vec_shl1(vec_load_rev(&history[5]));
+        vec_int32 rev1  = vec_shl1(vec_load_rev(&history[1]));
+
+        tmp  = history[0] << 1;
+        tmp1 = history[8] << 1;
+
+        vec_store(&history[ 0], vec_mul32_Q32(rev5,  vec_load(&window[18])));
+        vec_store(&history[ 4], vec_mul32_Q32(rev1,  vec_load(&window[22])));
+        history[ 8] = fxp_mul32_Q32(tmp,  window[26]);
+        vec_store(&history[ 9], vec_mul32_Q32(hist0, vec_load(&window[27])));
+        vec_store(&history[13], vec_mul32_Q32(hist4, vec_load(&window[31])));
+        history[17] = fxp_mul32_Q32(tmp1, window[35]);
+    }
+
+#else
+
     tmp1 = history[ 8];
     tmp3 = history[ 7];
     tmp2 = history[ 1];
@@ -284,6 +335,8 @@ void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window)
     history[12] = fxp_mul32_Q32(tmp2, window[30]);
     history[ 6] = fxp_mul32_Q32(tmp,  window[24]);
     history[11] = fxp_mul32_Q32(tmp,  window[29]);
+
+#endif  /* PV_MP3DEC_SIMD */
 }
 
 #endif // If not assembly
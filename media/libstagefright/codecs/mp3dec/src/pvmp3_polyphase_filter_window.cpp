@@ -75,6 +75,7 @@ Input
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_dec_defs.h"
 #include "pvmp3_tables.h"
+#include "pv_mp3dec_simd_op.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -121,6 +122,64 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
     const int32 *winPtr = pqmfSynthWin;
     int32 i;
 
+#ifdef PV_MP3DEC_SIMD
+
+    /*
+     *  Same computation as below, for four consecutive sub-bands j at a time
+     */
+    static const int32 first_band[4] = { 1, 5, 9, 12 };
+    const int32 *winPtrV = pqmfSynthWinInterleaved;
+
+    for (int16 g = 0; g < 4; g++)
+    {
+        int32 j = first_band[g];
+        int32 *pt_1 = &synth_buffer[(SUBBANDS_NUMBER >> 1) + j];
+        int32 *pt_2 = &synth_buffer[(SUBBANDS_NUMBER >> 1) - j - 3];
+        vec_acc32_Q32 vsum1;
+        vec_acc32_Q32 vsum2;
+        vec_acc_init(&vsum1, 0x00000020);
+        vec_acc_init(&vsum2, 0x00000020);
+
+        for (i = 0; i < 16; i += 4)
+        {
+            vec_int32 temp1 = vec_load(&pt_1[ SUBBANDS_NUMBER*(i>>1)]);
+            vec_int32 temp3 = vec_load_rev(&pt_2[ SUBBANDS_NUMBER*(15 - (i>>1))]);
+            vec_int32 temp2 = vec_load_rev(&pt_2[ SUBBANDS_NUMBER*((i>>1) + 1)]);
+            vec_int32 temp4 = vec_load(&pt_1[ SUBBANDS_NUMBER*(14 - (i>>1))]);
+            vec_int32 win0  = vec_load(&winPtrV[ 0]);
+            vec_int32 win1  = vec_load(&winPtrV[ 4]);
+            vec_int32 win2  = vec_load(&winPtrV[ 8]);
+            vec_int32 win3  = vec_load(&winPtrV[12]);
+
+            vec_acc_mac32_Q32(&vsum1, temp1, win0);
+            vec_acc_mac32_Q32(&vsum2, temp3, win0);
+            vec_acc_mac32_Q32(&vsum2, temp1, win1);
+            vec_acc_msb32_Q32(&vsum1, temp3, win1);
+            vec_acc_mac32_Q32(&vsum1, temp2, win2);
+            vec_acc_msb32_Q32(&vsum2, temp4, win2);
+            vec_acc_mac32_Q32(&vsum2, temp2, win3);
+            vec_acc_mac32_Q32(&vsum1, temp4, win3);
+
+            winPtrV += 16;
+        }
+
+        int32 sums1[4];
+        int32 sums2[4];
+        vec_store(sums1, vec_acc_result(&vsum1));
+        vec_store(sums2, vec_acc_result(&vsum2));
+
+        for (i = 0; i < 4; i++)
+        {
+            int32 k = (j + i) << (numChannels - 1);
+            outPcm[k] = saturate16(sums1[i] >> 6);
+            outPcm[(numChannels<<5) - k] = saturate16(sums2[i] >> 6);
+        }
+    }
+
+    winPtr += ((SUBBANDS_NUMBER >> 1) - 1) << 4;
+
+#else
+
 
     for (int16 j = 1; j < SUBBANDS_NUMBER / 2; j++)
     {
@@ -200,7 +259,7 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
         outPcm[(numChannels<<5) - k] = saturate16(sum2 >> 6);
     }
 
-
+#endif  /* PV_MP3DEC_SIMD */
 
     sum1 = 0x00000020;
     sum2 = 0x00000020;
@@ -92,6 +92,7 @@ extern "C"
     extern const  mp3_scaleFactorBandIndex mp3_sfBandIndex[9];
     extern const int32 mp3_shortwindBandWidths[9][13];
     extern const int32 pqmfSynthWin[(HAN_SIZE/2) + 8];
+    extern const int32 pqmfSynthWinInterleaved[4*16*4];
 
 
     extern const uint16 huffTable_1[];
@@ -26,6 +26,7 @@ LOCAL_SRC_FILES := \
 	./source/h264bsd_dpb.c \
 	./source/h264bsd_image.c \
 	./source/h264bsd_deblocking.c \
+	./source/h264bsd_filter_thread.c \
 	./source/h264bsd_conceal.c \
 	./source/h264bsd_vui.c \
 	./source/h264bsd_pic_order_cnt.c \
@@ -97,6 +98,11 @@ ifeq ($(TARGET_ARCH),arm)
   endif
 endif
 
+ifneq ($(filter x86 x86_64,$(TARGET_ARCH)),)
+    LOCAL_CFLAGS     += -DH264DEC_SSE2
+    LOCAL_SRC_FILES  += ./source/h264bsd_reconstruct_sse2.c
+endif
+
 LOCAL_SHARED_LIBRARIES := \
 	libstagefright libstagefright_omx libstagefright_foundation libutils liblog \
 
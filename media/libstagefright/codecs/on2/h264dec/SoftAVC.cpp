@@ -21,10 +21,13 @@
 #include "SoftAVC.h"
 
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AUtils.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MediaErrors.h>
 #include <media/IOMX.h>
 
+#include <unistd.h>
+
 
 namespace android {
 
@@ -63,7 +66,11 @@ SoftAVC::SoftAVC(
       mPicId(0),
       mHeadersDecoded(false),
       mEOSStatus(INPUT_DATA_AVAILABLE),
-      mSignalledError(false) {
+      mSignalledError(false),
+      mDirectOutput(false),
+      mDpbSize(0),
+      mNumDirectPictures(0),
+      mNumCopiedPictures(0) {
     const size_t kMinCompressionRatio = 2;
     const size_t kMaxOutputBufferSize = 2048 * 2048 * 3 / 2;
     initPorts(
@@ -93,10 +100,49 @@ SoftAVC::~SoftAVC() {
 
 status_t SoftAVC::initDecoder() {
     // Force decoder to output buffers in display order.
-    if (H264SwDecInit(&mHandle, 0) == H264SWDEC_OK) {
-        return OK;
+    if (H264SwDecInit(&mHandle, 0) != H264SWDEC_OK) {
+        return UNKNOWN_ERROR;
     }
-    return UNKNOWN_ERROR;
+    setDeblockingThread();
+    return OK;
+}
+
+// Deblock on a second core while the picture is being decoded, only when the
+// client has opted in to direct output. The output does not depend on it, so
+// failing to create the thread is not an error.
+void SoftAVC::setDeblockingThread() {
+    u32 enable = mDirectOutput && sysconf(_SC_NPROCESSORS_ONLN) > 1;
+    if (H264SwDecSetDeblockingThread(mHandle, enable) != H264SWDEC_OK) {
+        ALOGW("Failed to %s the deblocking thread", enable ? "create" : "stop");
+    }
+}
+
+bool SoftAVC::useDirectOutput() const {
+    return mDirectOutput && !mIsAdaptive;
+}
+
+// Lets the decoder decode the next pictures into any of the output buffers
+// we own that it does not still use for an earlier picture.
+void SoftAVC::setPictureBuffers() {
+    if (!useDirectOutput()) {
+        return;
+    }
+
+    List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
+    u8 *buffers[kMaxNumOutputBuffers];
+    u32 numBuffers = 0;
+    u32 bufferSize = 0;
+    for (List<BufferInfo *>::iterator it = outQueue.begin();
+            it != outQueue.end() && numBuffers < kMaxNumOutputBuffers; ++it) {
+        OMX_BUFFERHEADERTYPE *outHeader = (*it)->mHeader;
+        if (numBuffers == 0 || outHeader->nAllocLen < bufferSize) {
+            bufferSize = outHeader->nAllocLen;
+        }
+        buffers[numBuffers++] = outHeader->pBuffer;
+    }
+
+    CHECK(H264SwDecSetPictureBuffers(mHandle, buffers, numBuffers, bufferSize)
+            == H264SWDEC_OK);
 }
 
 void SoftAVC::onQueueFilled(OMX_U32 /* portIndex */) {
@@ -121,7 +167,7 @@ void SoftAVC::onQueueFilled(OMX_U32 /* portIndex */) {
     H264SwDecRet ret = H264SWDEC_PIC_RDY;
     bool portWillReset = false;
     while ((mEOSStatus != INPUT_DATA_AVAILABLE || !inQueue.empty())
-            && outQueue.size() == kNumOutputBuffers) {
+            && outQueue.size() >= kNumOutputBuffers) {
 
         if (mEOSStatus == INPUT_EOS_SEEN) {
             drainAllOutputBuffers(true /* eos */);
@@ -152,6 +198,9 @@ void SoftAVC::onQueueFilled(OMX_U32 /* portIndex */) {
         H264SwDecPicture decodedPicture;
 
         while (inPicture.dataLen > 0) {
+            if (!portWillReset) {
+                setPictureBuffers();
+            }
             ret = H264SwDecDecode(mHandle, &inPicture, &outPicture);
             if (ret == H264SWDEC_HDRS_RDY_BUFF_NOT_EMPTY ||
                 ret == H264SWDEC_PIC_RDY_BUFF_NOT_EMPTY) {
@@ -162,11 +211,34 @@ void SoftAVC::onQueueFilled(OMX_U32 /* portIndex */) {
                     H264SwDecInfo decoderInfo;
                     CHECK(H264SwDecGetInfo(mHandle, &decoderInfo) == H264SWDEC_OK);
 
+                    // The client may free the output buffers as soon as it
+                    // learns about new settings, so move the pictures the
+                    // decoder still needs out of them first.
+                    if (useDirectOutput()) {
+                        CHECK(H264SwDecReleasePictureBuffers(mHandle) == H264SWDEC_OK);
+                    }
+                    mDpbSize = decoderInfo.dpbSize;
+
                     SoftVideoDecoderOMXComponent::CropSettingsMode cropSettingsMode =
                         handleCropParams(decoderInfo);
                     handlePortSettingsChange(
                             &portWillReset, decoderInfo.picWidth, decoderInfo.picHeight,
                             cropSettingsMode);
+
+                    // Direct output needs a buffer for every picture the
+                    // decoder may hold on to, ask for more if the size alone
+                    // did not already cause a port reset.
+                    if (!portWillReset && useDirectOutput()) {
+                        OMX_PARAM_PORTDEFINITIONTYPE *outDef =
+                            &editPortInfo(kOutputPortIndex)->mDef;
+                        OMX_U32 numBuffers = outDef->nBufferCountActual;
+                        updatePortDefinitions(false /* updateCrop */);
+                        if (outDef->nBufferCountActual != numBuffers) {
+                            notify(OMX_EventPortSettingsChanged, kOutputPortIndex, 0, NULL);
+                            mOutputPortSettingsChange = AWAITING_DISABLED;
+                            portWillReset = true;
+                        }
+                    }
                 }
             } else {
                 if (portWillReset) {
@@ -242,24 +314,64 @@ void SoftAVC::saveFirstOutputBuffer(int32_t picId, uint8_t *data) {
     memcpy(mFirstPicture, data, pictureSize);
 }
 
+// Finds the output buffer for the picture at |data| in the queue: the buffer
+// the picture was decoded into if we own it, otherwise the first one the
+// decoder does not use. Returns the end of the queue if there is none.
+List<SimpleSoftOMXComponent::BufferInfo *>::iterator SoftAVC::findOutputBuffer(
+        const uint8_t *data) {
+    List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
+    List<BufferInfo *>::iterator freeIt = outQueue.end();
+    for (List<BufferInfo *>::iterator it = outQueue.begin(); it != outQueue.end(); ++it) {
+        const uint8_t *buffer = (*it)->mHeader->pBuffer;
+        if (buffer == data) {
+            freeIt = it;
+            break;
+        }
+
+        u32 inUse;
+        CHECK(H264SwDecPictureBufferInUse(mHandle, buffer, &inUse) == H264SWDEC_OK);
+        if (!inUse && freeIt == outQueue.end()) {
+            freeIt = it;
+        }
+    }
+
+    return freeIt;
+}
+
 void SoftAVC::drainOneOutputBuffer(int32_t picId, uint8_t* data) {
     List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
-    BufferInfo *outInfo = *outQueue.begin();
-    outQueue.erase(outQueue.begin());
+    List<BufferInfo *>::iterator it = findOutputBuffer(data);
+    if (it == outQueue.end()) {
+        // All the buffers we own hold pictures the decoder still needs. This
+        // is rare, so rather than waiting for more buffers have it copy them
+        // to its own memory.
+        CHECK(H264SwDecReleasePictureBuffers(mHandle) == H264SWDEC_OK);
+        it = findOutputBuffer(data);
+    }
+    CHECK(it != outQueue.end());
+    BufferInfo *outInfo = *it;
+    outQueue.erase(it);
     OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
     OMX_BUFFERHEADERTYPE *header = mPicToHeaderMap.valueFor(picId);
     outHeader->nTimeStamp = header->nTimeStamp;
     outHeader->nFlags = header->nFlags;
     outHeader->nFilledLen = mWidth * mHeight * 3 / 2;
 
-    uint8_t *dst = outHeader->pBuffer + outHeader->nOffset;
-    const uint8_t *srcY = data;
-    const uint8_t *srcU = srcY + mWidth * mHeight;
-    const uint8_t *srcV = srcU + mWidth * mHeight / 4;
-    size_t srcYStride = mWidth;
-    size_t srcUStride = mWidth / 2;
-    size_t srcVStride = srcUStride;
-    copyYV12FrameToOutputBuffer(dst, srcY, srcU, srcV, srcYStride, srcUStride, srcVStride);
+    if (outHeader->pBuffer == data) {
+        // Decoded in place, the layout is that of the output buffer
+        outHeader->nOffset = 0;
+        ++mNumDirectPictures;
+    } else {
+        uint8_t *dst = outHeader->pBuffer + outHeader->nOffset;
+        const uint8_t *srcY = data;
+        const uint8_t *srcU = srcY + mWidth * mHeight;
+        const uint8_t *srcV = srcU + mWidth * mHeight / 4;
+        size_t srcYStride = mWidth;
+        size_t srcUStride = mWidth / 2;
+        size_t srcVStride = srcUStride;
+        copyYV12FrameToOutputBuffer(dst, srcY, srcU, srcV, srcYStride, srcUStride, srcVStride);
+        ++mNumCopiedPictures;
+    }
 
     mPicToHeaderMap.removeItem(picId);
     delete header;
@@ -310,6 +422,97 @@ void SoftAVC::onPortFlushCompleted(OMX_U32 portIndex) {
 void SoftAVC::onReset() {
     SoftVideoDecoderOMXComponent::onReset();
     mSignalledError = false;
+
+    ALOGV("%zu pictures output in place, %zu copied",
+            mNumDirectPictures, mNumCopiedPictures);
+    mNumDirectPictures = 0;
+    mNumCopiedPictures = 0;
+
+    if (!mDirectOutput) {
+        return;
+    }
+
+    // The output buffers have been freed by now, but the decoder may still
+    // refer to them for reference pictures. Start over with a new one.
+    H264SwDecRelease(mHandle);
+    mHandle = NULL;
+    CHECK_EQ(initDecoder(), (status_t)OK);
+
+    while (mPicToHeaderMap.size() != 0) {
+        OMX_BUFFERHEADERTYPE *header = mPicToHeaderMap.editValueAt(0);
+        mPicToHeaderMap.removeItemsAt(0);
+        delete header;
+    }
+    delete[] mFirstPicture;
+    mFirstPicture = NULL;
+    mFirstPictureId = -1;
+    mHeadersDecoded = false;
+    mEOSStatus = INPUT_DATA_AVAILABLE;
+    mDpbSize = 0;
+}
+
+OMX_ERRORTYPE SoftAVC::internalGetParameter(OMX_INDEXTYPE index, OMX_PTR params) {
+    switch ((int)index) {
+        case kDirectOutputIndex:
+        {
+            VideoDecoderDirectOutputParams *directParams =
+                (VideoDecoderDirectOutputParams *)params;
+            if (directParams->nSize != sizeof(VideoDecoderDirectOutputParams)) {
+                return OMX_ErrorUndefined;
+            }
+
+            directParams->bEnable = mDirectOutput ? OMX_TRUE : OMX_FALSE;
+            return OMX_ErrorNone;
+        }
+
+        default:
+            return SoftVideoDecoderOMXComponent::internalGetParameter(index, params);
+    }
+}
+
+OMX_ERRORTYPE SoftAVC::internalSetParameter(OMX_INDEXTYPE index, const OMX_PTR params) {
+    switch ((int)index) {
+        case kDirectOutputIndex:
+        {
+            const VideoDecoderDirectOutputParams *directParams =
+                (const VideoDecoderDirectOutputParams *)params;
+            if (directParams->nSize != sizeof(VideoDecoderDirectOutputParams)) {
+                return OMX_ErrorUndefined;
+            }
+
+            mDirectOutput = directParams->bEnable;
+            setDeblockingThread();
+            updatePortDefinitions(false /* updateCrop */);
+            return OMX_ErrorNone;
+        }
+
+        default:
+            return SoftVideoDecoderOMXComponent::internalSetParameter(index, params);
+    }
+}
+
+OMX_ERRORTYPE SoftAVC::getExtensionIndex(const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, VIDEO_DECODER_DIRECT_OUTPUT_EXTENSION)) {
+        *(int32_t*)index = kDirectOutputIndex;
+        return OMX_ErrorNone;
+    }
+    return SoftVideoDecoderOMXComponent::getExtensionIndex(name, index);
+}
+
+void SoftAVC::updatePortDefinitions(bool updateCrop, bool updateInputSize) {
+    SoftVideoDecoderOMXComponent::updatePortDefinitions(updateCrop, updateInputSize);
+
+    OMX_PARAM_PORTDEFINITIONTYPE *def = &editPortInfo(kOutputPortIndex)->mDef;
+    def->nBufferCountMin = kNumOutputBuffers;
+    if (useDirectOutput()) {
+        // Room for the pictures the decoder holds for reference and
+        // reordering, the one being decoded and the one the client is
+        // displaying.
+        def->nBufferCountMin =
+            min(mDpbSize + kNumOutputBuffers, (uint32_t)kMaxNumOutputBuffers);
+        def->nBufferSize += kPictureBufferPadding;
+    }
+    def->nBufferCountActual = max(def->nBufferCountActual, def->nBufferCountMin);
 }
 
 }  // namespace android
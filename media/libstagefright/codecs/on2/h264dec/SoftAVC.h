@@ -19,6 +19,7 @@
 #define SOFT_AVC_H_
 
 #include "SoftVideoDecoderOMXComponent.h"
+#include "VideoDecoderDirectOutput.h"
 #include <utils/KeyedVector.h>
 
 #include "H264SwDecApi.h"
@@ -38,11 +39,25 @@ protected:
     virtual void onQueueFilled(OMX_U32 portIndex);
     virtual void onPortFlushCompleted(OMX_U32 portIndex);
     virtual void onReset();
+    virtual OMX_ERRORTYPE internalGetParameter(OMX_INDEXTYPE index, OMX_PTR params);
+    virtual OMX_ERRORTYPE internalSetParameter(OMX_INDEXTYPE index, const OMX_PTR params);
+    virtual OMX_ERRORTYPE getExtensionIndex(const char *name, OMX_INDEXTYPE *index);
+    virtual void updatePortDefinitions(bool updateCrop = true, bool updateInputSize = false);
 
 private:
     enum {
         kNumInputBuffers  = 8,
         kNumOutputBuffers = 2,
+        kMaxNumOutputBuffers = 32,
+    };
+
+    enum {
+        kDirectOutputIndex = kPrepareForAdaptivePlaybackIndex + 1,
+    };
+
+    // The decoder may read this many bytes past the end of a picture
+    enum {
+        kPictureBufferPadding = 32,
     };
 
     enum EOSStatus {
@@ -69,7 +84,21 @@ private:
 
     bool mSignalledError;
 
+    // Decode straight into the output buffers, see VideoDecoderDirectOutput.h.
+    // Off unless the client asks for it with "direct-output", which also
+    // turns on the deblocking thread.
+    // Not done in adaptive playback mode where the buffer layout is that of
+    // the largest frame size rather than that of the picture.
+    bool mDirectOutput;
+    uint32_t mDpbSize;          // Pictures the decoder may hold on to
+    size_t mNumDirectPictures;  // Pictures output without a copy
+    size_t mNumCopiedPictures;
+
     status_t initDecoder();
+    void setDeblockingThread();
+    bool useDirectOutput() const;
+    void setPictureBuffers();
+    List<BufferInfo *>::iterator findOutputBuffer(const uint8_t *data);
     void drainAllOutputBuffers(bool eos);
     void drainOneOutputBuffer(int32_t picId, uint8_t *data);
     void saveFirstOutputBuffer(int32_t pidId, uint8_t *data);
@@ -126,6 +126,9 @@ extern "C"
         u32 parHeight;
         u32 croppingFlag;
         CropParams cropParams;
+        u32 dpbSize;            /* Number of decoded pictures the decoder may
+                                   hold for reference and reordering, not
+                                   counting the one being decoded */
     } H264SwDecInfo;
 
     /* Version information */
@@ -146,6 +149,9 @@ extern "C"
     H264SwDecRet H264SwDecInit(H264SwDecInst *decInst,
                                u32            noOutputReordering);
 
+    H264SwDecRet H264SwDecSetDeblockingThread(H264SwDecInst decInst,
+                                              u32           enable);
+
     H264SwDecRet H264SwDecNextPicture(H264SwDecInst     decInst,
                                       H264SwDecPicture *pOutput,
                                       u32               endOfStream);
@@ -153,6 +159,17 @@ extern "C"
     H264SwDecRet H264SwDecGetInfo(H264SwDecInst decInst,
                                   H264SwDecInfo *pDecInfo);
 
+    H264SwDecRet H264SwDecSetPictureBuffers(H264SwDecInst decInst,
+                                            u8          **pBuffers,
+                                            u32           numBuffers,
+                                            u32           bufferSize);
+
+    H264SwDecRet H264SwDecPictureBufferInUse(H264SwDecInst decInst,
+                                             const u8     *pBuffer,
+                                             u32          *pInUse);
+
+    H264SwDecRet H264SwDecReleasePictureBuffers(H264SwDecInst decInst);
+
     void  H264SwDecRelease(H264SwDecInst decInst);
 
     H264SwDecApiVersion H264SwDecGetAPIVersion(void);
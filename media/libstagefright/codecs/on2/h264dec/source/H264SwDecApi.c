@@ -24,7 +24,11 @@
      4. Local function prototypes
      5. Functions
           H264SwDecInit
+          H264SwDecSetDeblockingThread
           H264SwDecGetInfo
+          H264SwDecSetPictureBuffers
+          H264SwDecPictureBufferInUse
+          H264SwDecReleasePictureBuffers
           H264SwDecRelease
           H264SwDecDecode
           H264SwDecGetAPIVersion
@@ -49,7 +53,7 @@
 ------------------------------------------------------------------------------*/
 
 #define H264SWDEC_MAJOR_VERSION 2
-#define H264SWDEC_MINOR_VERSION 3
+#define H264SWDEC_MINOR_VERSION 4
 
 /*------------------------------------------------------------------------------
     2. External compiler flags
@@ -178,6 +182,68 @@ H264SwDecRet H264SwDecInit(H264SwDecInst *decInst, u32 noOutputReordering)
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: H264SwDecSetDeblockingThread()
+
+        Functional description:
+            Enable or disable deblocking filtering on a separate thread. The
+            filter then runs one macroblock row behind the decoding of each
+            picture instead of after it. Decoded pictures are identical,
+            except that pictures needing error concealment may differ since
+            part of them can be filtered before the errors are detected.
+            Shall not be called while a picture is partially decoded, i.e.
+            only before the first call to H264SwDecDecode or after it has
+            returned a picture.
+
+        Inputs:
+            decInst     decoder instance
+            enable      non-zero to use a deblocking thread
+
+        Outputs:
+            none
+
+        Returns:
+            H264SWDEC_OK            success
+            H264SWDEC_PARAM_ERR     invalid parameters or picture in progress
+            H264SWDEC_MEMFAIL       failed to create the thread
+
+------------------------------------------------------------------------------*/
+
+H264SwDecRet H264SwDecSetDeblockingThread(H264SwDecInst decInst, u32 enable)
+{
+
+    decContainer_t *pDecCont;
+
+    DEC_API_TRC("H264SwDecSetDeblockingThread#");
+
+    if (decInst == NULL)
+    {
+        DEC_API_TRC("H264SwDecSetDeblockingThread# ERROR: decInst == NULL");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    pDecCont = (decContainer_t*)decInst;
+
+    if (pDecCont->storage.picStarted)
+    {
+        DEC_API_TRC("H264SwDecSetDeblockingThread# ERROR: picture in progress");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    if (h264bsdSetFilterThread(&pDecCont->storage,
+            enable ? HANTRO_TRUE : HANTRO_FALSE) != HANTRO_OK)
+    {
+        DEC_API_TRC("H264SwDecSetDeblockingThread# ERROR: thread creation failed");
+        return(H264SWDEC_MEMFAIL);
+    }
+
+    DEC_API_TRC("H264SwDecSetDeblockingThread# OK");
+
+    return(H264SWDEC_OK);
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: H264SwDecGetInfo()
@@ -249,12 +315,183 @@ H264SwDecRet H264SwDecGetInfo(H264SwDecInst decInst, H264SwDecInfo *pDecInfo)
     /* profile */
     pDecInfo->profile = h264bsdProfile(pStorage);
 
+    pDecInfo->dpbSize = h264bsdDpbSize(pStorage);
+
     DEC_API_TRC("H264SwDecGetInfo# OK");
 
     return(H264SWDEC_OK);
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: H264SwDecSetPictureBuffers()
+
+        Functional description:
+            Provide picture buffers the decoder may decode pictures into
+            instead of its own memory, so that output pictures need not be
+            copied. Pictures are stored in the same format as the ones
+            returned by H264SwDecNextPicture. Buffers shall be 16-byte
+            aligned and bufferSize shall be at least picture size in bytes
+            (picWidth * picHeight * 3 / 2) + 32, others are not used.
+
+            The buffers replace the ones of the previous call. The decoder
+            keeps using a buffer of an earlier call for a picture it holds
+            for reference or display until the picture is no longer needed
+            (see H264SwDecPictureBufferInUse), or until
+            H264SwDecReleasePictureBuffers is called, and the application
+            shall not write to or free it before that. Buffers returned by
+            H264SwDecNextPicture may still be used for reference and shall
+            be treated as read-only. The buffers are forgotten when a new
+            sequence parameter set is activated.
+
+        Inputs:
+            decInst     decoder instance
+            pBuffers    array of numBuffers buffers
+            numBuffers  number of buffers, 0 to stop using application
+                        buffers for new pictures
+            bufferSize  size of each of the buffers in bytes
+
+        Outputs:
+            none
+
+        Returns:
+            H264SWDEC_OK            success
+            H264SWDEC_PARAM_ERR     invalid parameters
+
+------------------------------------------------------------------------------*/
+
+H264SwDecRet H264SwDecSetPictureBuffers(H264SwDecInst decInst,
+    u8 **pBuffers, u32 numBuffers, u32 bufferSize)
+{
+
+    decContainer_t *pDecCont;
+
+    DEC_API_TRC("H264SwDecSetPictureBuffers#");
+
+    if (decInst == NULL || (pBuffers == NULL && numBuffers))
+    {
+        DEC_API_TRC("H264SwDecSetPictureBuffers# ERROR: decInst or pBuffers is NULL");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    pDecCont = (decContainer_t*)decInst;
+
+    h264bsdSetDpbExtPics(pDecCont->storage.dpb, pBuffers, numBuffers,
+        bufferSize);
+
+    DEC_API_TRC("H264SwDecSetPictureBuffers# OK");
+
+    return(H264SWDEC_OK);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: H264SwDecPictureBufferInUse()
+
+        Functional description:
+            Check if the decoder uses a buffer given to
+            H264SwDecSetPictureBuffers, i.e. it holds a picture needed for
+            reference, a picture not yet returned by H264SwDecNextPicture or
+            the picture being decoded.
+
+        Inputs:
+            decInst     decoder instance
+            pBuffer     buffer to check
+
+        Outputs:
+            pInUse      non-zero if the buffer is in use
+
+        Returns:
+            H264SWDEC_OK            success
+            H264SWDEC_PARAM_ERR     invalid parameters
+
+------------------------------------------------------------------------------*/
+
+H264SwDecRet H264SwDecPictureBufferInUse(H264SwDecInst decInst,
+    const u8 *pBuffer, u32 *pInUse)
+{
+
+    storage_t *pStorage;
+
+    DEC_API_TRC("H264SwDecPictureBufferInUse#");
+
+    if (decInst == NULL || pInUse == NULL)
+    {
+        DEC_API_TRC("H264SwDecPictureBufferInUse# ERROR: decInst or pInUse is NULL");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    pStorage = &(((decContainer_t *)decInst)->storage);
+
+    *pInUse = h264bsdDpbPicInUse(pStorage->dpb, pBuffer);
+    if (pStorage->picStarted && pStorage->currImage->data == pBuffer)
+        *pInUse = HANTRO_TRUE;
+
+    DEC_API_TRC("H264SwDecPictureBufferInUse# OK");
+
+    return(H264SWDEC_OK);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: H264SwDecReleasePictureBuffers()
+
+        Functional description:
+            Stop using the buffers given to H264SwDecSetPictureBuffers.
+            Pictures the decoder still needs, including a partially decoded
+            one, are copied to its own memory, after which the application
+            may free or reuse all the buffers.
+
+        Inputs:
+            decInst     decoder instance
+
+        Outputs:
+            none
+
+        Returns:
+            H264SWDEC_OK            success
+            H264SWDEC_PARAM_ERR     invalid parameters
+
+------------------------------------------------------------------------------*/
+
+H264SwDecRet H264SwDecReleasePictureBuffers(H264SwDecInst decInst)
+{
+
+    storage_t *pStorage;
+    u32 inProgress;
+
+    DEC_API_TRC("H264SwDecReleasePictureBuffers#");
+
+    if (decInst == NULL)
+    {
+        DEC_API_TRC("H264SwDecReleasePictureBuffers# ERROR: decInst == NULL");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    pStorage = &(((decContainer_t *)decInst)->storage);
+
+    /* picture being decoded, if its memory has already been allocated */
+    inProgress = pStorage->picStarted && pStorage->dpb->currentOut &&
+        pStorage->currImage->data == pStorage->dpb->currentOut->data;
+
+    /* the deblocking thread may be filtering it */
+    if (inProgress && pStorage->filterThread)
+        h264bsdFilterThreadSync(pStorage->filterThread);
+
+    h264bsdReleaseDpbExtPics(pStorage->dpb, inProgress);
+
+    if (inProgress)
+        pStorage->currImage->data = pStorage->dpb->currentOut->data;
+
+    DEC_API_TRC("H264SwDecReleasePictureBuffers# OK");
+
+    return(H264SWDEC_OK);
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: H264SwDecRelease()
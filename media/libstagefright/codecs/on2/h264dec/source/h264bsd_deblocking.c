@@ -24,6 +24,7 @@
      4. Local function prototypes
      5. Functions
           h264bsdFilterPicture
+          h264bsdFilterRows
           FilterVerLumaEdge
           FilterHorLumaEdge
           FilterHorLuma
@@ -40,6 +41,12 @@
           GetChromaEdgeThresholds
           FilterLuma
           FilterChroma
+          FilterHorLumaHalf
+          LoadRow
+          StoreRow
+          AbsLess
+          Clip3
+          Select
 
 ------------------------------------------------------------------------------*/
 
@@ -59,6 +66,10 @@
 #include "armVC.h"
 #endif /* H264DEC_OMXDL */
 
+#ifdef H264DEC_SSE2
+#include <emmintrin.h>
+#endif /* H264DEC_SSE2 */
+
 /*------------------------------------------------------------------------------
     2. External compiler flags
 --------------------------------------------------------------------------------
@@ -190,6 +201,16 @@ static void FilterHorChromaEdge( u8 *data, u32 bS, edgeThreshold_t *thresholds,
 static void FilterHorChroma( u8 *data, u32 bS, edgeThreshold_t *thresholds,
   i32 imageWidth);
 
+#ifdef H264DEC_SSE2
+static void FilterHorLumaHalf(u8 *data, u32 bS, edgeThreshold_t *thresholds,
+  i32 imageWidth);
+static __m128i LoadRow(const u8 *data);
+static void StoreRow(u8 *data, __m128i row);
+static __m128i AbsLess(__m128i a, __m128i b, __m128i threshold);
+static __m128i Clip3(__m128i lo, __m128i hi, __m128i value);
+static __m128i Select(__m128i mask, __m128i a, __m128i b);
+#endif /* H264DEC_SSE2 */
+
 static void GetLumaEdgeThresholds(
   edgeThreshold_t *thresholds,
   mbStorage_t *mb,
@@ -551,12 +572,7 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
     Function: h264bsdFilterPicture
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
+          Perform deblocking filtering for a picture, see h264bsdFilterRows.
 
         Inputs:
           image         pointer to image to be filtered
@@ -570,12 +586,59 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
           none
 
 ------------------------------------------------------------------------------*/
-#ifndef H264DEC_OMXDL
+
 void h264bsdFilterPicture(
   image_t *image,
   mbStorage_t *mb)
 {
 
+/* Code */
+
+    ASSERT(image);
+
+    h264bsdFilterRows(image, mb, 0, image->height);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterRows
+
+        Functional description:
+          Perform deblocking filtering for macroblock rows [firstRow, lastRow)
+          of a picture. Filter does not copy the original picture anywhere
+          but filtering is performed directly on the original image.
+          Parameters controlling the filtering process are computed based on
+          information in macroblock structures of the filtered macroblock,
+          macroblock above and macroblock on the left of the filtered one.
+
+          Rows have to be filtered in order, each row modifies the bottom
+          lines of pixels of the row above. Intra prediction of a row reads
+          the unfiltered last line of pixels of the row above it, so a row
+          can be filtered as soon as the row below it has been decoded.
+
+        Inputs:
+          image         pointer to image to be filtered
+          mb            pointer to macroblock data structure of the top-left
+                        macroblock of the picture
+          firstRow      first macroblock row to filter
+          lastRow       macroblock row after the last one to filter
+
+        Outputs:
+          image         filtered image stored here
+
+        Returns:
+          none
+
+------------------------------------------------------------------------------*/
+#ifndef H264DEC_OMXDL
+void h264bsdFilterRows(
+  image_t *image,
+  mbStorage_t *mb,
+  u32 firstRow,
+  u32 lastRow)
+{
+
 /* Variables */
 
     u32 flags;
@@ -598,9 +661,12 @@ void h264bsdFilterPicture(
     data = image->data;
     picSizeInMbs = picWidthInMbs * image->height;
 
-    pMb = mb;
+    ASSERT(firstRow <= lastRow);
+    ASSERT(lastRow <= image->height);
+
+    pMb = mb + firstRow * picWidthInMbs;
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    for (mbRow = firstRow, mbCol = 0; mbRow < lastRow; pMb++)
     {
         flags = GetMbFilteringFlags(pMb);
 
@@ -817,6 +883,7 @@ void FilterHorLumaEdge(
     }
 }
 
+#ifndef H264DEC_SSE2
 /*------------------------------------------------------------------------------
 
     Function: FilterHorLuma
@@ -930,6 +997,7 @@ void FilterHorLuma(
     }
 
 }
+#endif /* H264DEC_SSE2 */
 
 /*------------------------------------------------------------------------------
 
@@ -1053,6 +1121,7 @@ void FilterHorChromaEdge(
     }
 }
 
+#ifndef H264DEC_SSE2
 /*------------------------------------------------------------------------------
 
     Function: FilterHorChroma
@@ -1119,7 +1188,7 @@ void FilterHorChroma(
     }
 
 }
-
+#endif /* H264DEC_SSE2 */
 
 /*------------------------------------------------------------------------------
 
@@ -1735,24 +1804,328 @@ void FilterChroma(
     }
 }
 
+#ifdef H264DEC_SSE2
+/*------------------------------------------------------------------------------
+
+    Function: FilterHorLuma
+
+        Functional description:
+            SSE2 version, filter all four successive horizontal 4-pixel luma
+            edges. The 16 pixels are filtered as two halves of 8 in 16-bit
+            lanes, the results are identical to those of the C version.
+
+------------------------------------------------------------------------------*/
+void FilterHorLuma(
+  u8 *data,
+  u32 bS,
+  edgeThreshold_t *thresholds,
+  i32 imageWidth)
+{
+
+/* Code */
+
+    ASSERT(data);
+    ASSERT(bS <= 4);
+    ASSERT(thresholds);
+
+    FilterHorLumaHalf(data, bS, thresholds, imageWidth);
+    FilterHorLumaHalf(data + 8, bS, thresholds, imageWidth);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterHorLumaHalf
+
+        Functional description:
+            Filter 8 pixels of a horizontal luma edge.
+
+------------------------------------------------------------------------------*/
+void FilterHorLumaHalf(
+  u8 *data,
+  u32 bS,
+  edgeThreshold_t *thresholds,
+  i32 imageWidth)
+{
+
+/* Variables */
+
+    __m128i p3, p2, p1, p0, q0, q1, q2, q3;
+    __m128i alpha, beta, filter, filterP, filterQ;
+    __m128i tc, delta, tmp;
+    __m128i newP2, newP1, newP0, newQ0, newQ1, newQ2;
+
+/* Code */
+
+    p2 = LoadRow(data - imageWidth*3);
+    p1 = LoadRow(data - imageWidth*2);
+    p0 = LoadRow(data - imageWidth);
+    q0 = LoadRow(data);
+    q1 = LoadRow(data + imageWidth);
+    q2 = LoadRow(data + imageWidth*2);
+
+    alpha = _mm_set1_epi16((i16)thresholds->alpha);
+    beta = _mm_set1_epi16((i16)thresholds->beta);
+
+    filter = _mm_and_si128(AbsLess(p0, q0, alpha),
+        _mm_and_si128(AbsLess(p1, p0, beta), AbsLess(q1, q0, beta)));
+    if (!_mm_movemask_epi8(filter))
+        return;
+
+    if (bS < 4)
+    {
+        filterP = _mm_and_si128(filter, AbsLess(p2, p0, beta));
+        filterQ = _mm_and_si128(filter, AbsLess(q2, q0, beta));
+
+        /* (p0 + q0 + 1) >> 1 */
+        tmp = _mm_avg_epu16(p0, q0);
+        tc = _mm_set1_epi16((i16)thresholds->tc0[bS-1]);
+
+        newP1 = _mm_srai_epi16(_mm_sub_epi16(_mm_add_epi16(p2, tmp),
+                    _mm_slli_epi16(p1, 1)), 1);
+        newP1 = _mm_add_epi16(p1,
+                    Clip3(_mm_sub_epi16(_mm_setzero_si128(), tc), tc, newP1));
+        newQ1 = _mm_srai_epi16(_mm_sub_epi16(_mm_add_epi16(q2, tmp),
+                    _mm_slli_epi16(q1, 1)), 1);
+        newQ1 = _mm_add_epi16(q1,
+                    Clip3(_mm_sub_epi16(_mm_setzero_si128(), tc), tc, newQ1));
+
+        /* tc is incremented for each of p1 and q1 that is filtered, the
+         * masks are -1 for those lanes */
+        tc = _mm_sub_epi16(_mm_sub_epi16(tc, filterP), filterQ);
+        delta = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(q0, p0), 2),
+                    _mm_sub_epi16(p1, q1));
+        delta = _mm_srai_epi16(_mm_add_epi16(delta, _mm_set1_epi16(4)), 3);
+        delta = Clip3(_mm_sub_epi16(_mm_setzero_si128(), tc), tc, delta);
+
+        StoreRow(data - imageWidth*2, Select(filterP, newP1, p1));
+        StoreRow(data - imageWidth,
+            Select(filter, _mm_add_epi16(p0, delta), p0));
+        StoreRow(data, Select(filter, _mm_sub_epi16(q0, delta), q0));
+        StoreRow(data + imageWidth, Select(filterQ, newQ1, q1));
+    }
+    else
+    {
+        p3 = LoadRow(data - imageWidth*4);
+        q3 = LoadRow(data + imageWidth*3);
+
+        /* strong filtering of a side needs |p0-q0| < (alpha >> 2) + 2 */
+        tmp = AbsLess(p0, q0, _mm_set1_epi16(
+                    (i16)((thresholds->alpha >> 2) + 2)));
+        filterP = _mm_and_si128(_mm_and_si128(filter, tmp),
+                    AbsLess(p2, p0, beta));
+        filterQ = _mm_and_si128(_mm_and_si128(filter, tmp),
+                    AbsLess(q2, q0, beta));
+
+        /* p side, tmp = p1 + p0 + q0 */
+        tmp = _mm_add_epi16(_mm_add_epi16(p1, p0), q0);
+        newP0 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(p2, q1),
+                    _mm_add_epi16(_mm_slli_epi16(tmp, 1), _mm_set1_epi16(4))),
+                    3);
+        newP1 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(p2, tmp),
+                    _mm_set1_epi16(2)), 2);
+        newP2 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+                    _mm_slli_epi16(p3, 1), _mm_add_epi16(p2,
+                    _mm_slli_epi16(p2, 1))), _mm_add_epi16(tmp,
+                    _mm_set1_epi16(4))), 3);
+        /* (2 * p1 + p0 + q1 + 2) >> 2 */
+        tmp = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+                    _mm_slli_epi16(p1, 1), p0), _mm_add_epi16(q1,
+                    _mm_set1_epi16(2))), 2);
+        newP0 = Select(filterP, newP0, tmp);
+
+        /* q side, tmp = p0 + q0 + q1 */
+        tmp = _mm_add_epi16(_mm_add_epi16(p0, q0), q1);
+        newQ0 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(p1, q2),
+                    _mm_add_epi16(_mm_slli_epi16(tmp, 1), _mm_set1_epi16(4))),
+                    3);
+        newQ1 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(q2, tmp),
+                    _mm_set1_epi16(2)), 2);
+        newQ2 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+                    _mm_slli_epi16(q3, 1), _mm_add_epi16(q2,
+                    _mm_slli_epi16(q2, 1))), _mm_add_epi16(tmp,
+                    _mm_set1_epi16(4))), 3);
+        /* (2 * q1 + q0 + p1 + 2) >> 2 */
+        tmp = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+                    _mm_slli_epi16(q1, 1), q0), _mm_add_epi16(p1,
+                    _mm_set1_epi16(2))), 2);
+        newQ0 = Select(filterQ, newQ0, tmp);
+
+        StoreRow(data - imageWidth*3, Select(filterP, newP2, p2));
+        StoreRow(data - imageWidth*2, Select(filterP, newP1, p1));
+        StoreRow(data - imageWidth, Select(filter, newP0, p0));
+        StoreRow(data, Select(filter, newQ0, q0));
+        StoreRow(data + imageWidth, Select(filterQ, newQ1, q1));
+        StoreRow(data + imageWidth*2, Select(filterQ, newQ2, q2));
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterHorChroma
+
+        Functional description:
+            SSE2 version, filter all four successive horizontal 2-pixel chroma
+            edges.
+
+------------------------------------------------------------------------------*/
+void FilterHorChroma(
+  u8 *data,
+  u32 bS,
+  edgeThreshold_t *thresholds,
+  i32 width)
+{
+
+/* Variables */
+
+    __m128i p1, p0, q0, q1;
+    __m128i filter, beta, tc, delta, newP0, newQ0;
+
+/* Code */
+
+    ASSERT(data);
+    ASSERT(bS <= 4);
+    ASSERT(thresholds);
+
+    p1 = LoadRow(data - width*2);
+    p0 = LoadRow(data - width);
+    q0 = LoadRow(data);
+    q1 = LoadRow(data + width);
+
+    beta = _mm_set1_epi16((i16)thresholds->beta);
+    filter = _mm_and_si128(
+        AbsLess(p0, q0, _mm_set1_epi16((i16)thresholds->alpha)),
+        _mm_and_si128(AbsLess(p1, p0, beta), AbsLess(q1, q0, beta)));
+    if (!_mm_movemask_epi8(filter))
+        return;
+
+    if (bS < 4)
+    {
+        tc = _mm_set1_epi16((i16)(thresholds->tc0[bS-1] + 1));
+        delta = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(q0, p0), 2),
+                    _mm_sub_epi16(p1, q1));
+        delta = _mm_srai_epi16(_mm_add_epi16(delta, _mm_set1_epi16(4)), 3);
+        delta = Clip3(_mm_sub_epi16(_mm_setzero_si128(), tc), tc, delta);
+        newP0 = _mm_add_epi16(p0, delta);
+        newQ0 = _mm_sub_epi16(q0, delta);
+    }
+    else
+    {
+        /* (2 * p1 + p0 + q1 + 2) >> 2 and (2 * q1 + q0 + p1 + 2) >> 2 */
+        delta = _mm_add_epi16(_mm_add_epi16(p1, q1), _mm_set1_epi16(2));
+        newP0 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(p1, p0), delta), 2);
+        newQ0 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(q1, q0), delta), 2);
+    }
+
+    StoreRow(data - width, Select(filter, newP0, p0));
+    StoreRow(data, Select(filter, newQ0, q0));
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: LoadRow
+
+        Functional description:
+            Load 8 pixels to 16-bit lanes.
+
+------------------------------------------------------------------------------*/
+__m128i LoadRow(const u8 *data)
+{
+    return(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)data),
+        _mm_setzero_si128()));
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: StoreRow
+
+        Functional description:
+            Store 8 pixels from 16-bit lanes, clipped to [0, 255].
+
+------------------------------------------------------------------------------*/
+void StoreRow(u8 *data, __m128i row)
+{
+    _mm_storel_epi64((__m128i*)data, _mm_packus_epi16(row, row));
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: AbsLess
+
+        Functional description:
+            Mask of the lanes where |a - b| < threshold.
+
+------------------------------------------------------------------------------*/
+__m128i AbsLess(__m128i a, __m128i b, __m128i threshold)
+{
+
+/* Variables */
+
+    __m128i diff;
+
+/* Code */
+
+    diff = _mm_sub_epi16(a, b);
+    diff = _mm_max_epi16(diff, _mm_sub_epi16(_mm_setzero_si128(), diff));
+
+    return(_mm_cmpgt_epi16(threshold, diff));
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: Clip3
+
+        Functional description:
+            CLIP3 of 16-bit lanes.
+
+------------------------------------------------------------------------------*/
+__m128i Clip3(__m128i lo, __m128i hi, __m128i value)
+{
+    return(_mm_min_epi16(_mm_max_epi16(value, lo), hi));
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: Select
+
+        Functional description:
+            Lanes of a where mask is set, of b elsewhere.
+
+------------------------------------------------------------------------------*/
+__m128i Select(__m128i mask, __m128i a, __m128i b)
+{
+    return(_mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)));
+}
+#endif /* H264DEC_SSE2 */
+
 #else /* H264DEC_OMXDL */
 
 /*------------------------------------------------------------------------------
 
-    Function: h264bsdFilterPicture
+    Function: h264bsdFilterRows
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
+          Perform deblocking filtering for macroblock rows [firstRow, lastRow)
+          of a picture. Filter does not copy the original picture anywhere
+          but filtering is performed directly on the original image.
+          Parameters controlling the filtering process are computed based on
+          information in macroblock structures of the filtered macroblock,
+          macroblock above and macroblock on the left of the filtered one.
+
+          Rows have to be filtered in order, each row modifies the bottom
+          lines of pixels of the row above. Intra prediction of a row reads
+          the unfiltered last line of pixels of the row above it, so a row
+          can be filtered as soon as the row below it has been decoded.
 
         Inputs:
           image         pointer to image to be filtered
           mb            pointer to macroblock data structure of the top-left
                         macroblock of the picture
+          firstRow      first macroblock row to filter
+          lastRow       macroblock row after the last one to filter
 
         Outputs:
           image         filtered image stored here
@@ -1763,9 +2136,11 @@ void FilterChroma(
 ------------------------------------------------------------------------------*/
 
 /*lint --e{550} Symbol not accessed */
-void h264bsdFilterPicture(
+void h264bsdFilterRows(
   image_t *image,
-  mbStorage_t *mb)
+  mbStorage_t *mb,
+  u32 firstRow,
+  u32 lastRow)
 {
 
 /* Variables */
@@ -1794,9 +2169,12 @@ void h264bsdFilterPicture(
     data = image->data;
     picSizeInMbs = picWidthInMbs * image->height;
 
-    pMb = mb;
+    ASSERT(firstRow <= lastRow);
+    ASSERT(lastRow <= image->height);
+
+    pMb = mb + firstRow * picWidthInMbs;
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    for (mbRow = firstRow, mbCol = 0; mbRow < lastRow; pMb++)
     {
         flags = GetMbFilteringFlags(pMb);
 
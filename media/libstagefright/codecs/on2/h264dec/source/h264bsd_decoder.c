@@ -24,6 +24,7 @@
      4. Local function prototypes
      5. Functions
           h264bsdInit
+          h264bsdSetFilterThread
           h264bsdDecode
           h264bsdShutdown
           h264bsdCurrentImage
@@ -35,6 +36,7 @@
           h264bsdVideoRange
           h264bsdMatrixCoefficients
           h264bsdCroppingParams
+          h264bsdDpbSize
 
 ------------------------------------------------------------------------------*/
 
@@ -54,6 +56,7 @@
 #include "h264bsd_dpb.h"
 #include "h264bsd_deblocking.h"
 #include "h264bsd_conceal.h"
+#include "h264bsd_filter_thread.h"
 
 /*------------------------------------------------------------------------------
     2. External compiler flags
@@ -111,6 +114,48 @@ u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering)
     return HANTRO_OK;
 }
 
+/*------------------------------------------------------------------------------
+
+    Function name: h264bsdSetFilterThread
+
+        Functional description:
+            Enable or disable deblocking of pictures on a separate thread,
+            overlapped with the decoding of the picture. The output is the
+            same either way, except for concealed pictures. Shall not be
+            called while a picture is being decoded.
+
+        Inputs:
+            enable      HANTRO_TRUE to deblock on a separate thread
+
+        Outputs:
+            pStorage    filterThread created or released
+
+        Returns:
+            HANTRO_OK       success
+            HANTRO_NOK      failed to create the thread
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdSetFilterThread(storage_t *pStorage, u32 enable)
+{
+
+/* Code */
+
+    ASSERT(pStorage);
+    ASSERT(!pStorage->picStarted);
+
+    if (enable && pStorage->filterThread == NULL)
+        return(h264bsdInitFilterThread(&pStorage->filterThread));
+
+    if (!enable && pStorage->filterThread != NULL)
+    {
+        h264bsdShutdownFilterThread(pStorage->filterThread);
+        pStorage->filterThread = NULL;
+    }
+
+    return(HANTRO_OK);
+}
+
 /*------------------------------------------------------------------------------
 
     Function: h264bsdDecode
@@ -238,6 +283,10 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                 return (H264BSD_ERROR);
             }
 
+            /* concealment reads and writes macroblocks of the picture */
+            if (pStorage->filterThread)
+                h264bsdFilterThreadSync(pStorage->filterThread);
+
             if (!pStorage->validSliceInAccessUnit)
             {
                 pStorage->currImage->data =
@@ -420,6 +469,9 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                     }
                     pStorage->currImage->data =
                         h264bsdAllocateDpbImage(pStorage->dpb);
+                    if (pStorage->filterThread)
+                        h264bsdFilterThreadStart(pStorage->filterThread,
+                            pStorage->currImage, pStorage->mb);
                 }
 
                 /* store slice header to storage if successfully decoded */
@@ -448,6 +500,8 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                 if (tmp != HANTRO_OK)
                 {
                     EPRINT("SLICE_DATA");
+                    if (pStorage->filterThread)
+                        h264bsdFilterThreadSync(pStorage->filterThread);
                     h264bsdMarkSliceCorrupted(pStorage,
                         pStorage->sliceHeader->firstMbInSlice);
                     return(H264BSD_ERROR);
@@ -471,7 +525,11 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
 
     if (picReady)
     {
-        h264bsdFilterPicture(pStorage->currImage, pStorage->mb);
+        if (pStorage->filterThread)
+            h264bsdFilterThreadFinish(pStorage->filterThread,
+                pStorage->currImage, pStorage->mb);
+        else
+            h264bsdFilterPicture(pStorage->currImage, pStorage->mb);
 
         h264bsdResetStorage(pStorage);
 
@@ -541,6 +599,9 @@ void h264bsdShutdown(storage_t *pStorage)
 
     ASSERT(pStorage);
 
+    h264bsdShutdownFilterThread(pStorage->filterThread);
+    pStorage->filterThread = NULL;
+
     for (i = 0; i < MAX_NUM_SEQ_PARAM_SETS; i++)
     {
         if (pStorage->sps[i])
@@ -959,3 +1020,32 @@ u32 h264bsdProfile(storage_t *pStorage)
         return 0;
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdDpbSize
+
+        Functional description:
+            Get the number of pictures the DPB holds for reference and
+            display reordering with the active SPS, not counting the one
+            being decoded
+
+        Inputs:
+            pStorage    pointer to storage structure
+
+        Returns:
+            DPB size
+            0 if parameters sets not yet activated
+
+------------------------------------------------------------------------------*/
+u32 h264bsdDpbSize(storage_t *pStorage)
+{
+    if (pStorage->activeSps == NULL)
+        return 0;
+
+    /* see h264bsdInitDpb */
+    if (h264bsdNoReordering(pStorage))
+        return MAX(pStorage->activeSps->numRefFrames, 1);
+    else
+        return pStorage->activeSps->maxDpbSize;
+}
+
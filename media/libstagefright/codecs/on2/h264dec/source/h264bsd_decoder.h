@@ -58,6 +58,7 @@ enum {
 ------------------------------------------------------------------------------*/
 
 u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering);
+u32 h264bsdSetFilterThread(storage_t *pStorage, u32 enable);
 u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
     u32 *readBytes);
 void h264bsdShutdown(storage_t *pStorage);
@@ -78,6 +79,7 @@ u32 h264bsdCheckValidParamSets(storage_t *pStorage);
 void h264bsdFlushBuffer(storage_t *pStorage);
 
 u32 h264bsdProfile(storage_t *pStorage);
+u32 h264bsdDpbSize(storage_t *pStorage);
 
 #endif /* #ifdef H264SWDEC_DECODER_H */
 
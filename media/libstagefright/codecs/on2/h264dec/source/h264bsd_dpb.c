@@ -45,6 +45,9 @@
           OutputPicture
           h264bsdDpbOutputPicture
           h264bsdFlushDpb
+          h264bsdSetDpbExtPics
+          h264bsdDpbPicInUse
+          h264bsdReleaseDpbExtPics
           h264bsdFreeDpb
 
 ------------------------------------------------------------------------------*/
@@ -114,6 +117,12 @@ static u32 OutputPicture(dpbStorage_t *dpb);
 
 static void ShellSort(dpbPicture_t *pPic, u32 num);
 
+static u32 IsDpbData(dpbStorage_t *dpb, const u8 *data);
+
+static u8* UnassignedDpbData(dpbStorage_t *dpb);
+
+static void SelectDpbImage(dpbStorage_t *dpb);
+
 /*------------------------------------------------------------------------------
 
     Function: ComparePictures
@@ -887,10 +896,150 @@ u8* h264bsdAllocateDpbImage(dpbStorage_t *dpb)
 
     dpb->currentOut = dpb->buffer + dpb->dpbSize;
 
+    /* data pointers of the buffer positions are a permutation of the
+     * allocated pictures unless application pictures have been used */
+    if (dpb->numExtPics || !IsDpbData(dpb, dpb->currentOut->data))
+        SelectDpbImage(dpb);
+
     return(dpb->currentOut->data);
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: IsDpbData
+
+        Functional description:
+            Function to check if a data pointer points to one of the pictures
+            allocated by the DPB (as opposed to the application).
+
+------------------------------------------------------------------------------*/
+
+static u32 IsDpbData(dpbStorage_t *dpb, const u8 *data)
+{
+
+/* Variables */
+
+    u32 i;
+
+/* Code */
+
+    for (i = 0; i <= dpb->dpbSize; i++)
+        if (ALIGN(dpb->buffer[i].pAllocatedData, 16) == data)
+            return(HANTRO_TRUE);
+
+    return(HANTRO_FALSE);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: UnassignedDpbData
+
+        Functional description:
+            Function to find an allocated picture that is not the data of
+            any buffer position. There is one for each buffer position that
+            has an application picture as its data.
+
+        Returns:
+            pointer to the picture, NULL if all are assigned
+
+------------------------------------------------------------------------------*/
+
+static u8* UnassignedDpbData(dpbStorage_t *dpb)
+{
+
+/* Variables */
+
+    u32 i, j;
+    u8 *data;
+
+/* Code */
+
+    for (i = 0; i <= dpb->dpbSize; i++)
+    {
+        data = ALIGN(dpb->buffer[i].pAllocatedData, 16);
+        for (j = 0; j <= dpb->dpbSize; j++)
+            if (dpb->buffer[j].data == data)
+                break;
+        if (j > dpb->dpbSize)
+            return(data);
+    }
+
+    return(NULL);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: SelectDpbImage
+
+        Functional description:
+            Function to choose the memory for the current picture, i.e. the
+            data of buffer position dpbSize. The first application picture
+            not holding a picture needed for reference or display is
+            preferred. Otherwise the current picture is decoded into memory
+            allocated by the DPB. Data pointers of the buffer positions are
+            kept distinct; a position not in use may be left pointing to an
+            application picture, which is never accessed through it.
+
+------------------------------------------------------------------------------*/
+
+static void SelectDpbImage(dpbStorage_t *dpb)
+{
+
+/* Variables */
+
+    u32 i;
+    u8 *data, *tmp;
+
+/* Code */
+
+    data = NULL;
+
+    if (dpb->extPicSize >= dpb->picSizeInMbs*384 + 32)
+    {
+        for (i = 0; i < dpb->numExtPics; i++)
+            if (!h264bsdDpbPicInUse(dpb, dpb->extPics[i]))
+            {
+                data = dpb->extPics[i];
+                break;
+            }
+    }
+
+    if (data == NULL)
+    {
+        if (IsDpbData(dpb, dpb->currentOut->data))
+            return;
+
+        data = UnassignedDpbData(dpb);
+        if (data == NULL)
+        {
+            for (i = 0; i < dpb->dpbSize; i++)
+                if (IsDpbData(dpb, dpb->buffer[i].data) &&
+                    !h264bsdDpbPicInUse(dpb, dpb->buffer[i].data))
+                {
+                    data = dpb->buffer[i].data;
+                    break;
+                }
+        }
+        ASSERT(data);
+        if (data == NULL)
+            return;
+    }
+
+    /* exchange with a buffer position not in use already pointing to it */
+    tmp = dpb->currentOut->data;
+    for (i = 0; i < dpb->dpbSize; i++)
+        if (dpb->buffer[i].data == data)
+        {
+            dpb->buffer[i].data = tmp;
+            break;
+        }
+    dpb->currentOut->data = data;
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: SlidingWindowRefPicMarking
@@ -1006,6 +1155,9 @@ u32 h264bsdInitDpb(
         dpb->dpbSize         = dpbSize;
     dpb->maxFrameNum         = maxFrameNum;
     dpb->noReordering        = noReordering;
+    dpb->picSizeInMbs        = picSizeInMbs;
+    dpb->numExtPics          = 0;
+    dpb->currentOut          = NULL;
     dpb->fullness            = 0;
     dpb->numRefFrames        = 0;
     dpb->prevRefFrameNum     = 0;
@@ -1511,6 +1663,142 @@ void h264bsdFlushDpb(dpbStorage_t *dpb)
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdSetDpbExtPics
+
+        Functional description:
+            Function to set the pictures provided by the application for
+            decoding. Pictures shall be 16-byte aligned and picSize shall be
+            at least picture size + 32 bytes (see h264bsdInitDpb) for the
+            pictures to be used, others are ignored. Replaces the previous
+            set; pictures of the previous set still needed for reference or
+            display keep being used for them until no longer needed, so the
+            application shall keep them valid until h264bsdDpbPicInUse
+            returns false or h264bsdReleaseDpbExtPics is called. The set is
+            emptied when the DPB is re-initialized.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdSetDpbExtPics(dpbStorage_t *dpb, u8 **pics, u32 numPics,
+    u32 picSize)
+{
+
+/* Variables */
+
+    u32 i;
+
+/* Code */
+
+    ASSERT(dpb);
+    ASSERT(pics || !numPics);
+
+    dpb->numExtPics = 0;
+    dpb->extPicSize = picSize;
+
+    for (i = 0; i < numPics && dpb->numExtPics < MAX_NUM_EXT_PICS; i++)
+        if (pics[i] && ALIGN(pics[i], 16) == pics[i])
+            dpb->extPics[dpb->numExtPics++] = pics[i];
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdDpbPicInUse
+
+        Functional description:
+            Function to check if the picture pointed by data is held in the
+            DPB for reference or display, or is waiting in the output buffer.
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdDpbPicInUse(dpbStorage_t *dpb, const u8 *data)
+{
+
+/* Variables */
+
+    u32 i;
+
+/* Code */
+
+    ASSERT(dpb);
+
+    if (dpb->buffer == NULL)
+        return(HANTRO_FALSE);
+
+    for (i = 0; i <= dpb->dpbSize; i++)
+        if (dpb->buffer[i].data == data &&
+            (IS_REFERENCE(dpb->buffer[i]) || dpb->buffer[i].toBeDisplayed))
+            return(HANTRO_TRUE);
+
+    for (i = dpb->outIndex; i < dpb->numOut; i++)
+        if (dpb->outBuf[i].data == data)
+            return(HANTRO_TRUE);
+
+    return(HANTRO_FALSE);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdReleaseDpbExtPics
+
+        Functional description:
+            Function to stop using application provided pictures. Pictures
+            still needed for reference or display are copied to memory
+            allocated by the DPB, after which the application may free or
+            overwrite all of them. If picInProgress is set, the current
+            picture is partially decoded and is copied as well; its new data
+            pointer is then dpb->currentOut->data.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdReleaseDpbExtPics(dpbStorage_t *dpb, u32 picInProgress)
+{
+
+/* Variables */
+
+    u32 i, j, pending;
+    u8 *data, *tmp;
+
+/* Code */
+
+    ASSERT(dpb);
+
+    dpb->numExtPics = 0;
+
+    if (dpb->buffer == NULL)
+        return;
+
+    for (i = 0; i <= dpb->dpbSize; i++)
+    {
+        data = dpb->buffer[i].data;
+        if (IsDpbData(dpb, data))
+            continue;
+
+        tmp = UnassignedDpbData(dpb);
+        ASSERT(tmp);
+        if (tmp == NULL)
+            return;
+
+        pending = HANTRO_FALSE;
+        for (j = dpb->outIndex; j < dpb->numOut; j++)
+            if (dpb->outBuf[j].data == data)
+            {
+                dpb->outBuf[j].data = tmp;
+                pending = HANTRO_TRUE;
+            }
+
+        /* contents of non-existing pictures are never accessed */
+        if (IS_EXISTING(dpb->buffer[i]) || dpb->buffer[i].toBeDisplayed ||
+            pending || (picInProgress && dpb->buffer + i == dpb->currentOut))
+            H264SwDecMemcpy(tmp, data, dpb->picSizeInMbs*384);
+
+        dpb->buffer[i].data = tmp;
+    }
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: h264bsdFreeDpb
@@ -40,6 +40,9 @@
     2. Module defines
 ------------------------------------------------------------------------------*/
 
+/* maximum number of application provided picture buffers */
+#define MAX_NUM_EXT_PICS 32
+
 /*------------------------------------------------------------------------------
     3. Data types
 ------------------------------------------------------------------------------*/
@@ -92,6 +95,12 @@ typedef struct {
     u32 lastContainsMmco5;
     u32 noReordering;
     u32 flushed;
+    u32 picSizeInMbs;
+    /* picture buffers provided by the application, used for decoding
+     * instead of the ones in 'buffer' when not holding a picture */
+    u8 *extPics[MAX_NUM_EXT_PICS];
+    u32 numExtPics;
+    u32 extPicSize;
 } dpbStorage_t;
 
 /*------------------------------------------------------------------------------
@@ -143,6 +152,13 @@ dpbOutPicture_t* h264bsdDpbOutputPicture(dpbStorage_t *dpb);
 
 void h264bsdFlushDpb(dpbStorage_t *dpb);
 
+void h264bsdSetDpbExtPics(dpbStorage_t *dpb, u8 **pics, u32 numPics,
+    u32 picSize);
+
+u32 h264bsdDpbPicInUse(dpbStorage_t *dpb, const u8 *data);
+
+void h264bsdReleaseDpbExtPics(dpbStorage_t *dpb, u32 picInProgress);
+
 void h264bsdFreeDpb(dpbStorage_t *dpb);
 
 #endif /* #ifdef H264SWDEC_DPB_H */
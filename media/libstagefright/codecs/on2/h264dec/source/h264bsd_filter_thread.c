@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Table of contents
+
+     1. Include headers
+     2. External compiler flags
+     3. Module defines
+     4. Local function prototypes
+     5. Functions
+          h264bsdInitFilterThread
+          h264bsdShutdownFilterThread
+          h264bsdFilterThreadStart
+          h264bsdFilterThreadMbDecoded
+          h264bsdFilterThreadSync
+          h264bsdFilterThreadFinish
+          FilterThreadLoop
+
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+    1. Include headers
+------------------------------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include "h264bsd_filter_thread.h"
+#include "h264bsd_deblocking.h"
+#include "h264bsd_util.h"
+
+/*------------------------------------------------------------------------------
+    2. External compiler flags
+--------------------------------------------------------------------------------
+
+--------------------------------------------------------------------------------
+    3. Module defines
+------------------------------------------------------------------------------*/
+
+/* Deblocking of a picture runs on its own thread one macroblock row behind
+ * the decoding of the picture: row N is filtered once rows 0..N+1 have been
+ * decoded, see h264bsdFilterRows. The rows still left when the picture is
+ * complete are filtered on the decoding thread. Decoding of the next picture
+ * needs this one as a reference, so there is no overlap between pictures. */
+struct filterThread
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t workCond;    /* rowsReady or exit changed */
+    pthread_cond_t doneCond;    /* rowsFiltered changed */
+    u32 exit;
+
+    /* picture being decoded, set by h264bsdFilterThreadStart */
+    u32 started;
+    image_t *image;
+    mbStorage_t *mb;
+    u32 picSizeInMbs;
+
+    /* only accessed by the decoding thread: the macroblocks before nextMb
+     * in raster scan order have all been decoded */
+    u32 nextMb;
+
+    u32 rowsReady;              /* rows that may be filtered */
+    u32 rowsFiltered;           /* rows filtered by the thread */
+};
+
+/*------------------------------------------------------------------------------
+    4. Local function prototypes
+------------------------------------------------------------------------------*/
+
+static void *FilterThreadLoop(void *arg);
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInitFilterThread
+
+        Functional description:
+            Create the deblocking filter thread of a decoder instance.
+
+        Outputs:
+            ppThread    pointer to the thread is stored here, NULL on failure
+
+        Returns:
+            HANTRO_OK       success
+            HANTRO_NOK      failed to allocate memory or create the thread
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdInitFilterThread(filterThread_t **ppThread)
+{
+
+/* Variables */
+
+    filterThread_t *pThread;
+
+/* Code */
+
+    ASSERT(ppThread);
+
+    *ppThread = NULL;
+
+    ALLOCATE(pThread, 1, filterThread_t);
+    if (pThread == NULL)
+        return(HANTRO_NOK);
+
+    H264SwDecMemset(pThread, 0, sizeof(filterThread_t));
+
+    pthread_mutex_init(&pThread->lock, NULL);
+    pthread_cond_init(&pThread->workCond, NULL);
+    pthread_cond_init(&pThread->doneCond, NULL);
+
+    if (pthread_create(&pThread->thread, NULL, FilterThreadLoop, pThread))
+    {
+        pthread_cond_destroy(&pThread->doneCond);
+        pthread_cond_destroy(&pThread->workCond);
+        pthread_mutex_destroy(&pThread->lock);
+        FREE(pThread);
+        return(HANTRO_NOK);
+    }
+
+    *ppThread = pThread;
+
+    return(HANTRO_OK);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdShutdownFilterThread
+
+        Functional description:
+            Stop the deblocking filter thread, after it has filtered the rows
+            it was given, and free it.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdShutdownFilterThread(filterThread_t *pThread)
+{
+
+/* Code */
+
+    if (pThread == NULL)
+        return;
+
+    pthread_mutex_lock(&pThread->lock);
+    pThread->exit = HANTRO_TRUE;
+    pthread_cond_signal(&pThread->workCond);
+    pthread_mutex_unlock(&pThread->lock);
+
+    pthread_join(pThread->thread, NULL);
+
+    pthread_cond_destroy(&pThread->doneCond);
+    pthread_cond_destroy(&pThread->workCond);
+    pthread_mutex_destroy(&pThread->lock);
+
+    FREE(pThread);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadStart
+
+        Functional description:
+            Called when decoding of a new picture starts. The previous
+            picture has normally been finished already, the thread is waited
+            for in case it was abandoned.
+
+        Inputs:
+            image       image being decoded
+            mb          macroblock storage of the picture
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadStart(filterThread_t *pThread, image_t *image,
+    mbStorage_t *mb)
+{
+
+/* Code */
+
+    ASSERT(pThread);
+    ASSERT(image);
+    ASSERT(mb);
+
+    h264bsdFilterThreadSync(pThread);
+
+    pthread_mutex_lock(&pThread->lock);
+    pThread->started = HANTRO_TRUE;
+    pThread->image = image;
+    pThread->mb = mb;
+    pThread->picSizeInMbs = image->width * image->height;
+    pThread->nextMb = 0;
+    pThread->rowsReady = 0;
+    pThread->rowsFiltered = 0;
+    pthread_mutex_unlock(&pThread->lock);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadMbDecoded
+
+        Functional description:
+            Called by the decoding thread after each decoded macroblock. Hands
+            the rows above the last completely decoded one to the thread.
+            Slices may arrive in any order and slice groups may be used, so
+            only the leading macroblocks that have all been decoded count.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadMbDecoded(filterThread_t *pThread)
+{
+
+/* Variables */
+
+    u32 nextMb, rowsDecoded;
+
+/* Code */
+
+    ASSERT(pThread);
+
+    if (!pThread->started)
+        return;
+
+    nextMb = pThread->nextMb;
+    while (nextMb < pThread->picSizeInMbs && pThread->mb[nextMb].decoded)
+        nextMb++;
+    if (nextMb == pThread->nextMb)
+        return;
+    pThread->nextMb = nextMb;
+
+    rowsDecoded = nextMb / pThread->image->width;
+    /* rowsReady is only written by this thread, no need to lock to read it */
+    if (rowsDecoded >= 2 && rowsDecoded - 1 > pThread->rowsReady)
+    {
+        pthread_mutex_lock(&pThread->lock);
+        pThread->rowsReady = rowsDecoded - 1;
+        pthread_cond_signal(&pThread->workCond);
+        pthread_mutex_unlock(&pThread->lock);
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadSync
+
+        Functional description:
+            Wait until the thread has filtered all the rows it was given. Must
+            be called before the decoding thread modifies any already decoded
+            macroblock of the picture, e.g. for error concealment.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadSync(filterThread_t *pThread)
+{
+
+/* Code */
+
+    ASSERT(pThread);
+
+    pthread_mutex_lock(&pThread->lock);
+    while (pThread->rowsFiltered < pThread->rowsReady)
+        pthread_cond_wait(&pThread->doneCond, &pThread->lock);
+    pthread_mutex_unlock(&pThread->lock);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadFinish
+
+        Functional description:
+            Complete deblocking of the current picture: wait for the thread
+            and filter the remaining rows on the calling thread. A picture
+            that was only concealed was never started and is filtered whole.
+
+        Inputs:
+            image       image to be filtered
+            mb          macroblock storage of the picture
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadFinish(filterThread_t *pThread, image_t *image,
+    mbStorage_t *mb)
+{
+
+/* Variables */
+
+    u32 firstRow;
+
+/* Code */
+
+    ASSERT(pThread);
+
+    h264bsdFilterThreadSync(pThread);
+
+    firstRow = 0;
+    if (pThread->started)
+    {
+        ASSERT(pThread->image == image && pThread->mb == mb);
+        firstRow = pThread->rowsFiltered;
+    }
+
+    h264bsdFilterRows(image, mb, firstRow, image->height);
+
+    pthread_mutex_lock(&pThread->lock);
+    pThread->started = HANTRO_FALSE;
+    pThread->rowsReady = 0;
+    pThread->rowsFiltered = 0;
+    pthread_mutex_unlock(&pThread->lock);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterThreadLoop
+
+        Functional description:
+            Body of the deblocking filter thread. Filters the rows handed to it
+            in order, as many at a time as are ready.
+
+------------------------------------------------------------------------------*/
+
+static void *FilterThreadLoop(void *arg)
+{
+
+/* Variables */
+
+    filterThread_t *pThread = (filterThread_t *)arg;
+    u32 firstRow, lastRow;
+
+/* Code */
+
+    pthread_mutex_lock(&pThread->lock);
+    for (;;)
+    {
+        if (pThread->rowsFiltered < pThread->rowsReady)
+        {
+            firstRow = pThread->rowsFiltered;
+            lastRow = pThread->rowsReady;
+            pthread_mutex_unlock(&pThread->lock);
+
+            h264bsdFilterRows(pThread->image, pThread->mb, firstRow, lastRow);
+
+            pthread_mutex_lock(&pThread->lock);
+            pThread->rowsFiltered = lastRow;
+            pthread_cond_signal(&pThread->doneCond);
+        }
+        else if (pThread->exit)
+        {
+            break;
+        }
+        else
+        {
+            pthread_cond_wait(&pThread->workCond, &pThread->lock);
+        }
+    }
+    pthread_mutex_unlock(&pThread->lock);
+
+    return NULL;
+
+}
+
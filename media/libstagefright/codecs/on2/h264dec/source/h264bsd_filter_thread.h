@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Table of contents
+
+    1. Include headers
+    2. Module defines
+    3. Data types
+    4. Function prototypes
+
+------------------------------------------------------------------------------*/
+
+#ifndef H264SWDEC_FILTER_THREAD_H
+#define H264SWDEC_FILTER_THREAD_H
+
+/*------------------------------------------------------------------------------
+    1. Include headers
+------------------------------------------------------------------------------*/
+
+#include "basetype.h"
+#include "h264bsd_image.h"
+#include "h264bsd_macroblock_layer.h"
+
+/*------------------------------------------------------------------------------
+    2. Module defines
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+    3. Data types
+------------------------------------------------------------------------------*/
+
+/* deblocking filter thread, defined in h264bsd_filter_thread.c */
+typedef struct filterThread filterThread_t;
+
+/*------------------------------------------------------------------------------
+    4. Function prototypes
+------------------------------------------------------------------------------*/
+
+u32 h264bsdInitFilterThread(filterThread_t **ppThread);
+void h264bsdShutdownFilterThread(filterThread_t *pThread);
+
+void h264bsdFilterThreadStart(filterThread_t *pThread, image_t *image,
+    mbStorage_t *mb);
+void h264bsdFilterThreadMbDecoded(filterThread_t *pThread);
+void h264bsdFilterThreadSync(filterThread_t *pThread);
+void h264bsdFilterThreadFinish(filterThread_t *pThread, image_t *image,
+    mbStorage_t *mb);
+
+#endif /* #ifdef H264SWDEC_FILTER_THREAD_H */
+
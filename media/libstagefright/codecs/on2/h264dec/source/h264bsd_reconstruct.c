@@ -449,6 +449,15 @@ static void PredictChroma(
     chromaPartHeight = partHeight >> 1;
     ref = refPic->data + 256 * refPic->width * refPic->height;
 
+#ifdef H264DEC_SSE2
+    /* 2-pixel wide partitions are left to the C functions */
+    if ((xFrac || yFrac) && chromaPartWidth > 2)
+    {
+        h264bsdInterpolateChromaSse2(ref, mbPartChroma, xInt, yInt, width,
+                height, xFrac, yFrac, chromaPartWidth, chromaPartHeight);
+    }
+    else
+#endif /* H264DEC_SSE2 */
     if (xFrac && yFrac)
     {
         h264bsdInterpolateChromaHorVer(ref, mbPartChroma, xInt, yInt, width,
@@ -1790,6 +1799,18 @@ void h264bsdInterpolateMidHorQuarter(
 
 }
 
+#ifdef H264DEC_SSE2
+/* predict luma with the SSE2 versions of the functions above, they give
+ * identical results, see h264bsd_reconstruct_sse2.c */
+#define h264bsdInterpolateVerHalf       h264bsdInterpolateVerHalfSse2
+#define h264bsdInterpolateVerQuarter    h264bsdInterpolateVerQuarterSse2
+#define h264bsdInterpolateHorHalf       h264bsdInterpolateHorHalfSse2
+#define h264bsdInterpolateHorQuarter    h264bsdInterpolateHorQuarterSse2
+#define h264bsdInterpolateHorVerQuarter h264bsdInterpolateHorVerQuarterSse2
+#define h264bsdInterpolateMidHalf       h264bsdInterpolateMidHalfSse2
+#define h264bsdInterpolateMidVerQuarter h264bsdInterpolateMidVerQuarterSse2
+#define h264bsdInterpolateMidHorQuarter h264bsdInterpolateMidHorQuarterSse2
+#endif /* H264DEC_SSE2 */
 
 /*------------------------------------------------------------------------------
 
@@ -0,0 +1,803 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Table of contents
+
+     1. Include headers
+     2. External compiler flags
+     3. Module defines
+     4. Local function prototypes
+     5. Functions
+          h264bsdInterpolateVerHalfSse2
+          h264bsdInterpolateVerQuarterSse2
+          h264bsdInterpolateHorHalfSse2
+          h264bsdInterpolateHorQuarterSse2
+          h264bsdInterpolateHorVerQuarterSse2
+          h264bsdInterpolateMidHalfSse2
+          h264bsdInterpolateMidVerQuarterSse2
+          h264bsdInterpolateMidHorQuarterSse2
+          h264bsdInterpolateChromaSse2
+          GetRefBlock
+          LoadPels
+          LoadWide
+          StorePels
+          Tap6
+          HorTap
+          VerTap
+          Round5
+          MidTap
+
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+    1. Include headers
+------------------------------------------------------------------------------*/
+
+#include <string.h>
+#include <emmintrin.h>
+
+#include "basetype.h"
+#include "h264bsd_reconstruct.h"
+#include "h264bsd_util.h"
+
+/*------------------------------------------------------------------------------
+    2. External compiler flags
+--------------------------------------------------------------------------------
+
+--------------------------------------------------------------------------------
+    3. Module defines
+------------------------------------------------------------------------------*/
+
+/* SSE2 versions of the luma interpolation functions of h264bsd_reconstruct.c,
+ * used by h264bsdPredictSamples when H264DEC_SSE2 is defined. The arguments
+ * and the results are exactly those of the C functions.
+ *
+ * A partition is processed in columns of 8 pixels, or one column of 4 for
+ * 4-pixel wide partitions, with the intermediate values in 16-bit lanes. Only
+ * the pixels the C functions read are loaded, so the reference block can be
+ * at the very end of the picture buffer. The 6-tap sum of 8-bit samples
+ * (E - 5F + 20G + 20H - 5I + J) fits in 16 bits, the second pass of 'j' over
+ * those sums is done in 32 bits.
+ *
+ * Chroma interpolation of 4- and 8-pixel wide partitions is done here too,
+ * one row at a time. The rest of the decoder is still C on x86: the 2-pixel
+ * wide chroma partitions, vertical and 4-pixel deblocking edges, intra
+ * prediction and the inverse transform. */
+
+/*------------------------------------------------------------------------------
+    4. Local function prototypes
+------------------------------------------------------------------------------*/
+
+static u8 *GetRefBlock(u8 *ref, u8 *fill, i32 x0, i32 y0, u32 *width,
+    u32 height, u32 blockWidth, u32 blockHeight);
+static __m128i LoadPels(const u8 *ptr, u32 n);
+static __m128i LoadWide(const u8 *ptr, u32 n);
+static void StorePels(u8 *ptr, __m128i pels, u32 n);
+static __m128i Tap6(__m128i e, __m128i f, __m128i g, __m128i h,
+    __m128i i, __m128i j);
+static __m128i HorTap(const u8 *ptr, u32 n);
+static __m128i VerTap(const u8 *ptr, u32 width, u32 n);
+static __m128i Round5(__m128i sum);
+static __m128i MidTap(const i16 *ptr);
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateVerHalfSse2
+
+        Functional description:
+          SSE2 version of h264bsdInterpolateVerHalf, pixel position 'h'.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdInterpolateVerHalfSse2(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight)
+{
+    u32 p1[21*21/4+1];
+    u32 x, y, n;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    ref = GetRefBlock(ref, (u8*)p1, x0, y0, &width, height,
+        partWidth, partHeight+5);
+
+    n = MIN(partWidth, 8);
+    for (y = 0; y < partHeight; y++, ref += width, mb += 16)
+        for (x = 0; x < partWidth; x += 8)
+            StorePels(mb + x, Round5(VerTap(ref + x, width, n)), n);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateVerQuarterSse2
+
+        Functional description:
+          SSE2 version of h264bsdInterpolateVerQuarter, pixel position 'd'
+          or 'n'.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdInterpolateVerQuarterSse2(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 verOffset)    /* 0 for pixel d, 1 for pixel n */
+{
+    u32 p1[21*21/4+1];
+    u32 x, y, n;
+    u8 *ptrInt;
+    __m128i half;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    ref = GetRefBlock(ref, (u8*)p1, x0, y0, &width, height,
+        partWidth, partHeight+5);
+
+    /* integer sample G or M */
+    ptrInt = ref + (2 + verOffset) * width;
+
+    n = MIN(partWidth, 8);
+    for (y = 0; y < partHeight; y++, ref += width, ptrInt += width, mb += 16)
+    {
+        for (x = 0; x < partWidth; x += 8)
+        {
+            half = Round5(VerTap(ref + x, width, n));
+            StorePels(mb + x, _mm_avg_epu8(half, LoadPels(ptrInt + x, n)), n);
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateHorHalfSse2
+
+        Functional description:
+          SSE2 version of h264bsdInterpolateHorHalf, pixel position 'b'.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdInterpolateHorHalfSse2(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight)
+{
+    u32 p1[21*21/4+1];
+    u32 x, y, n;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    ref = GetRefBlock(ref, (u8*)p1, x0, y0, &width, height,
+        partWidth+5, partHeight);
+
+    n = MIN(partWidth, 8);
+    for (y = 0; y < partHeight; y++, ref += width, mb += 16)
+        for (x = 0; x < partWidth; x += 8)
+            StorePels(mb + x, Round5(HorTap(ref + x, n)), n);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateHorQuarterSse2
+
+        Functional description:
+          SSE2 version of h264bsdInterpolateHorQuarter, pixel position 'a'
+          or 'c'.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdInterpolateHorQuarterSse2(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 horOffset)    /* 0 for pixel a, 1 for pixel c */
+{
+    u32 p1[21*21/4+1];
+    u32 x, y, n;
+    __m128i half;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    ref = GetRefBlock(ref, (u8*)p1, x0, y0, &width, height,
+        partWidth+5, partHeight);
+
+    n = MIN(partWidth, 8);
+    for (y = 0; y < partHeight; y++, ref += width, mb += 16)
+    {
+        for (x = 0; x < partWidth; x += 8)
+        {
+            half = Round5(HorTap(ref + x, n));
+            StorePels(mb + x,
+                _mm_avg_epu8(half, LoadPels(ref + x + 2 + horOffset, n)), n);
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateHorVerQuarterSse2
+
+        Functional description:
+          SSE2 version of h264bsdInterpolateHorVerQuarter, pixel position
+          'e', 'g', 'p' or 'r'.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdInterpolateHorVerQuarterSse2(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 horVerOffset) /* 0 for pixel e, 1 for pixel g,
+                       2 for pixel p, 3 for pixel r */
+{
+    u32 p1[21*21/4+1];
+    u32 x, y, n;
+    u8 *ptrHor, *ptrVer;
+    __m128i hor, ver;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    ref = GetRefBlock(ref, (u8*)p1, x0, y0, &width, height,
+        partWidth+5, partHeight+5);
+
+    /* horizontal half sample 'b' or 's' from row of G or M */
+    ptrHor = ref + (2 + (horVerOffset >> 1)) * width;
+    /* vertical half sample 'h' or 'm' from column of G or H */
+    ptrVer = ref + 2 + (horVerOffset & 0x1);
+
+    n = MIN(partWidth, 8);
+    for (y = 0; y < partHeight; y++)
+    {
+        for (x = 0; x < partWidth; x += 8)
+        {
+            hor = Round5(HorTap(ptrHor + x, n));
+            ver = Round5(VerTap(ptrVer + x, width, n));
+            StorePels(mb + x, _mm_avg_epu8(hor, ver), n);
+        }
+        ptrHor += width;
+        ptrVer += width;
+        mb += 16;
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateMidHalfSse2
+
+        Functional description:
+          SSE2 version of h264bsdInterpolateMidHalf, pixel position 'j'.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdInterpolateMidHalfSse2(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight)
+{
+    u32 p1[21*21/4+1];
+    u32 x, y, n;
+    /* unclipped horizontal half samples, rows of 16 */
+    i16 table[21*16];
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    ref = GetRefBlock(ref, (u8*)p1, x0, y0, &width, height,
+        partWidth+5, partHeight+5);
+
+    n = MIN(partWidth, 8);
+    for (y = 0; y < partHeight+5; y++, ref += width)
+        for (x = 0; x < partWidth; x += 8)
+            _mm_storeu_si128((__m128i*)(table + 16*y + x), HorTap(ref + x, n));
+
+    for (y = 0; y < partHeight; y++, mb += 16)
+        for (x = 0; x < partWidth; x += 8)
+            StorePels(mb + x, MidTap(table + 16*y + x), n);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateMidVerQuarterSse2
+
+        Functional description:
+          SSE2 version of h264bsdInterpolateMidVerQuarter, pixel position 'f'
+          or 'q'.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdInterpolateMidVerQuarterSse2(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 verOffset)    /* 0 for pixel f, 1 for pixel q */
+{
+    u32 p1[21*21/4+1];
+    u32 x, y, n;
+    i16 table[21*16];
+    const i16 *ptrHalf;
+    __m128i half;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    ref = GetRefBlock(ref, (u8*)p1, x0, y0, &width, height,
+        partWidth+5, partHeight+5);
+
+    n = MIN(partWidth, 8);
+    for (y = 0; y < partHeight+5; y++, ref += width)
+        for (x = 0; x < partWidth; x += 8)
+            _mm_storeu_si128((__m128i*)(table + 16*y + x), HorTap(ref + x, n));
+
+    /* 'b' or 's' is the rounded value of the table row of G or M */
+    ptrHalf = table + 16*(2 + verOffset);
+    for (y = 0; y < partHeight; y++, ptrHalf += 16, mb += 16)
+    {
+        for (x = 0; x < partWidth; x += 8)
+        {
+            half = Round5(_mm_loadu_si128((const __m128i*)(ptrHalf + x)));
+            StorePels(mb + x, _mm_avg_epu8(half, MidTap(table + 16*y + x)), n);
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateMidHorQuarterSse2
+
+        Functional description:
+          SSE2 version of h264bsdInterpolateMidHorQuarter, pixel position 'i'
+          or 'k'.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdInterpolateMidHorQuarterSse2(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 horOffset)    /* 0 for pixel i, 1 for pixel k */
+{
+    u32 p1[21*21/4+1];
+    u32 x, y, n;
+    i16 table[21*16];
+    u8 *ptrVer;
+    __m128i half;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    ref = GetRefBlock(ref, (u8*)p1, x0, y0, &width, height,
+        partWidth+5, partHeight+5);
+
+    /* 'h' or 'm' from the column of G or H */
+    ptrVer = ref + 2 + horOffset;
+
+    n = MIN(partWidth, 8);
+    for (y = 0; y < partHeight+5; y++, ref += width)
+        for (x = 0; x < partWidth; x += 8)
+            _mm_storeu_si128((__m128i*)(table + 16*y + x), HorTap(ref + x, n));
+
+    for (y = 0; y < partHeight; y++, ptrVer += width, mb += 16)
+    {
+        for (x = 0; x < partWidth; x += 8)
+        {
+            half = Round5(VerTap(ptrVer + x, width, n));
+            StorePels(mb + x, _mm_avg_epu8(half, MidTap(table + 16*y + x)), n);
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateChromaSse2
+
+        Functional description:
+          SSE2 version of h264bsdInterpolateChromaHor, h264bsdInterpolateChromaVer
+          and h264bsdInterpolateChromaHorVer for 4- and 8-pixel wide
+          partitions. All three are the bilinear sum
+          (A*a + B*b + C*c + D*d + 32) >> 6 with the weights A..D adding up
+          to 64, zero weights for the fractions that are zero.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdInterpolateChromaSse2(
+  u8 *ref,
+  u8 *predPartChroma,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 xFrac,
+  u32 yFrac,
+  u32 chromaPartWidth,
+  u32 chromaPartHeight)
+{
+    u8 block[9*9];
+    u32 comp, y, n, scan;
+    u8 *ptr, *cbr;
+    __m128i wA, wB, wC, wD, round, sum, zero;
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(predPartChroma);
+    ASSERT(chromaPartWidth == 4 || chromaPartWidth == 8);
+    ASSERT(chromaPartHeight);
+    ASSERT(xFrac < 8);
+    ASSERT(yFrac < 8);
+
+    wA = _mm_set1_epi16((i16)((8 - xFrac) * (8 - yFrac)));
+    wB = _mm_set1_epi16((i16)(xFrac * (8 - yFrac)));
+    wC = _mm_set1_epi16((i16)((8 - xFrac) * yFrac));
+    wD = _mm_set1_epi16((i16)(xFrac * yFrac));
+    round = _mm_set1_epi16(32);
+    zero = _mm_setzero_si128();
+
+    n = chromaPartWidth;
+    for (comp = 0; comp <= 1; comp++, ref += width * height)
+    {
+        /* the column right of and the row below the partition are only
+         * read, and so overfilled, for a non-zero fraction, like the C
+         * functions do */
+        scan = width;
+        ptr = GetRefBlock(ref, block, x0, y0, &scan, height,
+            chromaPartWidth + (xFrac ? 1 : 0),
+            chromaPartHeight + (yFrac ? 1 : 0));
+        cbr = predPartChroma + comp * 8 * 8;
+
+        /* at most 64 * 255 + 32, fits the 16-bit lanes */
+        for (y = chromaPartHeight; y; y--, ptr += scan, cbr += 8)
+        {
+            sum = _mm_add_epi16(round,
+                _mm_mullo_epi16(LoadWide(ptr, n), wA));
+            if (xFrac)
+                sum = _mm_add_epi16(sum,
+                    _mm_mullo_epi16(LoadWide(ptr + 1, n), wB));
+            if (yFrac)
+            {
+                sum = _mm_add_epi16(sum,
+                    _mm_mullo_epi16(LoadWide(ptr + scan, n), wC));
+                if (xFrac)
+                    sum = _mm_add_epi16(sum,
+                        _mm_mullo_epi16(LoadWide(ptr + scan + 1, n), wD));
+            }
+            sum = _mm_srli_epi16(sum, 6);
+            StorePels(cbr, _mm_packus_epi16(sum, zero), n);
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: GetRefBlock
+
+        Functional description:
+          Return pointer to the top-left corner of a blockWidth x blockHeight
+          block of the reference picture. Same as the beginning of the C
+          interpolation functions: if the block is not completely inside the
+          picture, it is overfilled to 'fill' and width is set to its scan
+          length.
+
+------------------------------------------------------------------------------*/
+
+static u8 *GetRefBlock(u8 *ref, u8 *fill, i32 x0, i32 y0, u32 *width,
+    u32 height, u32 blockWidth, u32 blockHeight)
+{
+
+/* Code */
+
+    if ((x0 < 0) || ((u32)x0+blockWidth > *width) ||
+        (y0 < 0) || ((u32)y0+blockHeight > height))
+    {
+        h264bsdFillBlock(ref, fill, x0, y0, *width, height,
+                blockWidth, blockHeight, blockWidth);
+
+        *width = blockWidth;
+        return(fill);
+    }
+
+    return(ref + (u32)y0 * *width + (u32)x0);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: LoadPels
+
+        Functional description:
+          Load n (4 or 8) pixels to the low 8-bit lanes of a register.
+
+------------------------------------------------------------------------------*/
+
+static __m128i LoadPels(const u8 *ptr, u32 n)
+{
+
+/* Variables */
+
+    __m128i pels;
+    i32 tmp;
+
+/* Code */
+
+    if (n == 8)
+        pels = _mm_loadl_epi64((const __m128i*)ptr);
+    else
+    {
+        memcpy(&tmp, ptr, 4);
+        pels = _mm_cvtsi32_si128(tmp);
+    }
+
+    return(pels);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: LoadWide
+
+        Functional description:
+          Load n (4 or 8) pixels to the 16-bit lanes of a register, the
+          lanes above n are zero.
+
+------------------------------------------------------------------------------*/
+
+static __m128i LoadWide(const u8 *ptr, u32 n)
+{
+
+/* Code */
+
+    return(_mm_unpacklo_epi8(LoadPels(ptr, n), _mm_setzero_si128()));
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: StorePels
+
+        Functional description:
+          Store n (4 or 8) pixels from the low 8-bit lanes of a register.
+
+------------------------------------------------------------------------------*/
+
+static void StorePels(u8 *ptr, __m128i pels, u32 n)
+{
+
+/* Variables */
+
+    i32 tmp;
+
+/* Code */
+
+    if (n == 8)
+        _mm_storel_epi64((__m128i*)ptr, pels);
+    else
+    {
+        tmp = _mm_cvtsi128_si32(pels);
+        memcpy(ptr, &tmp, 4);
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: Tap6
+
+        Functional description:
+          6-tap filter E - 5F + 20G + 20H - 5I + J in 16-bit lanes.
+
+------------------------------------------------------------------------------*/
+
+static __m128i Tap6(__m128i e, __m128i f, __m128i g, __m128i h,
+    __m128i i, __m128i j)
+{
+
+/* Variables */
+
+    __m128i gh, fi;
+
+/* Code */
+
+    gh = _mm_add_epi16(g, h);
+    fi = _mm_add_epi16(f, i);
+    /* 20(G+H) - 5(F+I) = 5(4(G+H) - (F+I)) */
+    gh = _mm_sub_epi16(_mm_slli_epi16(gh, 2), fi);
+    gh = _mm_add_epi16(gh, _mm_slli_epi16(gh, 2));
+
+    return(_mm_add_epi16(gh, _mm_add_epi16(e, j)));
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: HorTap
+
+        Functional description:
+          Unclipped horizontal 6-tap sums of n pixels, ptr points to E of the
+          first one.
+
+------------------------------------------------------------------------------*/
+
+static __m128i HorTap(const u8 *ptr, u32 n)
+{
+
+/* Code */
+
+    return(Tap6(LoadWide(ptr, n), LoadWide(ptr+1, n), LoadWide(ptr+2, n),
+                LoadWide(ptr+3, n), LoadWide(ptr+4, n), LoadWide(ptr+5, n)));
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: VerTap
+
+        Functional description:
+          Unclipped vertical 6-tap sums of n pixels, ptr points to E of the
+          first one.
+
+------------------------------------------------------------------------------*/
+
+static __m128i VerTap(const u8 *ptr, u32 width, u32 n)
+{
+
+/* Code */
+
+    return(Tap6(LoadWide(ptr, n), LoadWide(ptr+width, n),
+                LoadWide(ptr+2*width, n), LoadWide(ptr+3*width, n),
+                LoadWide(ptr+4*width, n), LoadWide(ptr+5*width, n)));
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: Round5
+
+        Functional description:
+          Half sample from a 6-tap sum, clip((sum + 16) >> 5), packed to the
+          low 8-bit lanes.
+
+------------------------------------------------------------------------------*/
+
+static __m128i Round5(__m128i sum)
+{
+
+/* Code */
+
+    sum = _mm_srai_epi16(_mm_add_epi16(sum, _mm_set1_epi16(16)), 5);
+
+    return(_mm_packus_epi16(sum, sum));
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: MidTap
+
+        Functional description:
+          Sample 'j' of 8 pixels, clip((j1 + 512) >> 10) where j1 is the
+          vertical 6-tap sum of the horizontal sums in six rows of 16 starting
+          at ptr. Packed to the low 8-bit lanes.
+
+------------------------------------------------------------------------------*/
+
+static __m128i MidTap(const i16 *ptr)
+{
+
+/* Variables */
+
+    __m128i r0, r1, r2, r3, r4, r5;
+    __m128i c01, c23, c45, round, lo, hi;
+
+/* Code */
+
+    c01 = _mm_set_epi16(-5, 1, -5, 1, -5, 1, -5, 1);
+    c23 = _mm_set1_epi16(20);
+    c45 = _mm_set_epi16(1, -5, 1, -5, 1, -5, 1, -5);
+    round = _mm_set1_epi32(512);
+
+    r0 = _mm_loadu_si128((const __m128i*)(ptr));
+    r1 = _mm_loadu_si128((const __m128i*)(ptr + 16));
+    r2 = _mm_loadu_si128((const __m128i*)(ptr + 32));
+    r3 = _mm_loadu_si128((const __m128i*)(ptr + 48));
+    r4 = _mm_loadu_si128((const __m128i*)(ptr + 64));
+    r5 = _mm_loadu_si128((const __m128i*)(ptr + 80));
+
+    lo = _mm_add_epi32(
+        _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r0, r1), c01),
+                      _mm_madd_epi16(_mm_unpacklo_epi16(r2, r3), c23)),
+        _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r4, r5), c45), round));
+    hi = _mm_add_epi32(
+        _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r0, r1), c01),
+                      _mm_madd_epi16(_mm_unpackhi_epi16(r2, r3), c23)),
+        _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r4, r5), c45), round));
+
+    lo = _mm_packs_epi32(_mm_srai_epi32(lo, 10), _mm_srai_epi32(hi, 10));
+
+    return(_mm_packus_epi16(lo, lo));
+
+}
+
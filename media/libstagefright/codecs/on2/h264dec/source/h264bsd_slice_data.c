@@ -195,6 +195,9 @@ u32 h264bsdDecodeSliceData(strmData_t *pStrmData, storage_t *pStorage,
         if (pStorage->mb[currMbAddr].decoded == 1)
             mbCount++;
 
+        if (pStorage->filterThread)
+            h264bsdFilterThreadMbDecoded(pStorage->filterThread);
+
         /* keep on processing as long as there is stream data left or
          * processing of macroblocks to be skipped based on the last skipRun is
          * not finished */
@@ -27,6 +27,7 @@
           h264bsdStoreSeqParamSet
           h264bsdStorePicParamSet
           h264bsdActivateParamSets
+          h264bsdNoReordering
           h264bsdResetStorage
           h264bsdIsStartOfPicture
           h264bsdIsEndOfPicture
@@ -355,18 +356,7 @@ u32 h264bsdActivateParamSets(storage_t *pStorage, u32 ppsId, u32 isIdr)
             pStorage->activeSps->picWidthInMbs,
             pStorage->picSizeInMbs);
 
-        /* dpb output reordering disabled if
-         * 1) application set noReordering flag
-         * 2) POC type equal to 2
-         * 3) num_reorder_frames in vui equal to 0 */
-        if ( pStorage->noReordering ||
-             pStorage->activeSps->picOrderCntType == 2 ||
-             (pStorage->activeSps->vuiParametersPresentFlag &&
-              pStorage->activeSps->vuiParameters->bitstreamRestrictionFlag &&
-              !pStorage->activeSps->vuiParameters->numReorderFrames) )
-            flag = HANTRO_TRUE;
-        else
-            flag = HANTRO_FALSE;
+        flag = h264bsdNoReordering(pStorage);
 
         tmp = h264bsdResetDpb(pStorage->dpb,
             pStorage->activeSps->picWidthInMbs *
@@ -417,6 +407,49 @@ u32 h264bsdActivateParamSets(storage_t *pStorage, u32 ppsId, u32 isIdr)
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdNoReordering
+
+        Functional description:
+            Check if output reordering is disabled for the active sequence
+            parameter set. This is the case if
+            1) application set noReordering flag
+            2) POC type equal to 2
+            3) num_reorder_frames in vui equal to 0
+            The DPB then only stores reference pictures and outputs all the
+            pictures immediately.
+
+        Inputs:
+            pStorage    pointer to storage structure
+
+        Returns:
+            HANTRO_TRUE     reordering disabled
+            HANTRO_FALSE    reordering enabled or no active SPS
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdNoReordering(storage_t *pStorage)
+{
+
+/* Code */
+
+    ASSERT(pStorage);
+
+    if (pStorage->activeSps == NULL)
+        return(HANTRO_FALSE);
+
+    if ( pStorage->noReordering ||
+         pStorage->activeSps->picOrderCntType == 2 ||
+         (pStorage->activeSps->vuiParametersPresentFlag &&
+          pStorage->activeSps->vuiParameters->bitstreamRestrictionFlag &&
+          !pStorage->activeSps->vuiParameters->numReorderFrames) )
+        return(HANTRO_TRUE);
+    else
+        return(HANTRO_FALSE);
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: h264bsdResetStorage
@@ -42,6 +42,7 @@
 #include "h264bsd_seq_param_set.h"
 #include "h264bsd_dpb.h"
 #include "h264bsd_pic_order_cnt.h"
+#include "h264bsd_filter_thread.h"
 
 /*------------------------------------------------------------------------------
     2. Module defines
@@ -146,6 +147,10 @@ typedef struct
                               HEADERS_RDY to the user */
     u32 intraConcealmentFlag; /* 0 gray picture for corrupted intra
                                  1 previous frame used if available */
+
+    /* deblocking filter thread, NULL if the picture is filtered after it
+     * has been decoded */
+    filterThread_t *filterThread;
 } storage_t;
 
 /*------------------------------------------------------------------------------
@@ -169,6 +174,7 @@ u32 h264bsdCheckAccessUnitBoundary(
   u32 *accessUnitBoundaryFlag);
 
 u32 h264bsdValidParamSets(storage_t *pStorage);
+u32 h264bsdNoReordering(storage_t *pStorage);
 
 #endif /* #ifdef H264SWDEC_STORAGE_H */
 
@@ -22,13 +22,37 @@
 #include <media/stagefright/ColorConverter.h>
 #include <media/stagefright/MediaErrors.h>
 
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define COLOR_CONVERTER_AVX2
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace android {
 
+// Frames are split into bands of rows for threads only above this many
+// pixels per band, below that starting a thread costs more than it saves.
+static const size_t kMinPixelsPerBand = 256 * 1024;
+static const size_t kMaxNumBands = 4;
+
 ColorConverter::ColorConverter(
         OMX_COLOR_FORMATTYPE from, OMX_COLOR_FORMATTYPE to)
     : mSrcFormat(from),
       mDstFormat(to),
-      mClip(NULL) {
+      mClip(NULL),
+      mMaxThreads(1) {
+    setSrcColorSpace(kColorMatrixBT601, false /* fullRange */);
 }
 
 ColorConverter::~ColorConverter() {
@@ -37,13 +61,16 @@ ColorConverter::~ColorConverter() {
 }
 
 bool ColorConverter::isValid() const {
-    if (mDstFormat != OMX_COLOR_Format16bitRGB565) {
+    if (mDstFormat != OMX_COLOR_Format16bitRGB565
+            && mDstFormat != kColorFormatRGBA8888) {
         return false;
     }
 
     switch (mSrcFormat) {
-        case OMX_COLOR_FormatYUV420Planar:
         case OMX_COLOR_FormatCbYCrY:
+            return mDstFormat == OMX_COLOR_Format16bitRGB565;
+
+        case OMX_COLOR_FormatYUV420Planar:
         case OMX_QCOM_COLOR_FormatYVU420SemiPlanar:
         case OMX_COLOR_FormatYUV420SemiPlanar:
         case OMX_TI_COLOR_FormatYUV420PackedSemiPlanar:
@@ -54,6 +81,28 @@ bool ColorConverter::isValid() const {
     }
 }
 
+void ColorConverter::setSrcColorSpace(ColorMatrix matrix, bool fullRange) {
+    // The BT.601 limited range values are the ones this class always used,
+    // the others are rounded from the same formulas: for limited range
+    // Y' is scaled by 255/219 and Cb, Cr by 255/224.
+    static const Coefficients kCoefficients[2][2] = {
+        {   // BT.601: Kr = 0.299, Kb = 0.114
+            { 16, 298, 409, 100, 208, 517 },
+            {  0, 256, 359,  88, 183, 454 },
+        },
+        {   // BT.709: Kr = 0.2126, Kb = 0.0722
+            { 16, 298, 459,  55, 136, 541 },
+            {  0, 256, 403,  48, 120, 475 },
+        },
+    };
+
+    mCoefficients = kCoefficients[matrix == kColorMatrixBT709][fullRange];
+}
+
+void ColorConverter::setMaxThreads(size_t maxThreads) {
+    mMaxThreads = maxThreads;
+}
+
 ColorConverter::BitmapParams::BitmapParams(
         void *bits,
         size_t width, size_t height,
@@ -85,7 +134,8 @@ status_t ColorConverter::convert(
         size_t dstWidth, size_t dstHeight,
         size_t dstCropLeft, size_t dstCropTop,
         size_t dstCropRight, size_t dstCropBottom) {
-    if (mDstFormat != OMX_COLOR_Format16bitRGB565) {
+    if (mDstFormat != OMX_COLOR_Format16bitRGB565
+            && mDstFormat != kColorFormatRGBA8888) {
         return ERROR_UNSUPPORTED;
     }
 
@@ -132,6 +182,26 @@ status_t ColorConverter::convert(
     return err;
 }
 
+// static
+size_t ColorConverter::ScaleFactor(
+        const BitmapParams &src, const BitmapParams &dst) {
+    // Rounding down makes several factors give the same size, try the
+    // largest for each dimension.
+    size_t candidates[2] = {
+        src.cropWidth() / dst.cropWidth(),
+        src.cropHeight() / dst.cropHeight(),
+    };
+    for (size_t i = 0; i < 2; ++i) {
+        size_t scale = candidates[i];
+        if (scale != 0
+                && src.cropWidth() / scale == dst.cropWidth()
+                && src.cropHeight() / scale == dst.cropHeight()) {
+            return scale;
+        }
+    }
+    return 0;
+}
+
 status_t ColorConverter::convertCbYCrY(
         const BitmapParams &src, const BitmapParams &dst) {
     // XXX Untested
@@ -140,7 +210,8 @@ status_t ColorConverter::convertCbYCrY(
 
     if (!((src.mCropLeft & 1) == 0
         && src.cropWidth() == dst.cropWidth()
-        && src.cropHeight() == dst.cropHeight())) {
+        && src.cropHeight() == dst.cropHeight())
+        || mDstFormat != OMX_COLOR_Format16bitRGB565) {
         return ERROR_UNSUPPORTED;
     }
 
@@ -198,17 +269,11 @@ status_t ColorConverter::convertCbYCrY(
 
 status_t ColorConverter::convertYUV420Planar(
         const BitmapParams &src, const BitmapParams &dst) {
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
+    size_t scale = ScaleFactor(src, dst);
+    if (!((src.mCropLeft & 1) == 0 && scale != 0)) {
         return ERROR_UNSUPPORTED;
     }
 
-    uint8_t *kAdjustedClip = initClip();
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
     const uint8_t *src_y =
         (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
 
@@ -219,90 +284,59 @@ status_t ColorConverter::convertYUV420Planar(
     const uint8_t *src_v =
         src_u + (src.mWidth / 2) * (src.mHeight / 2);
 
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            // B = 1.164 * (Y - 16) + 2.018 * (U - 128)
-            // G = 1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128)
-            // R = 1.164 * (Y - 16) + 1.596 * (V - 128)
-
-            // B = 298/256 * (Y - 16) + 517/256 * (U - 128)
-            // G = .................. - 208/256 * (V - 128) - 100/256 * (U - 128)
-            // R = .................. + 409/256 * (V - 128)
-
-            // min_B = (298 * (- 16) + 517 * (- 128)) / 256 = -277
-            // min_G = (298 * (- 16) - 208 * (255 - 128) - 100 * (255 - 128)) / 256 = -172
-            // min_R = (298 * (- 16) + 409 * (- 128)) / 256 = -223
-
-            // max_B = (298 * (255 - 16) + 517 * (255 - 128)) / 256 = 534
-            // max_G = (298 * (255 - 16) - 208 * (- 128) - 100 * (- 128)) / 256 = 432
-            // max_R = (298 * (255 - 16) + 409 * (255 - 128)) / 256 = 481
-
-            // clip range -278 .. 535
-
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed u = (signed)src_u[x / 2] - 128;
-            signed v = (signed)src_v[x / 2] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
+    YUV420Layout layout;
+    layout.mY = src_y;
+    layout.mU = src_u;
+    layout.mV = src_v;
+    layout.mYStride = src.mWidth;
+    layout.mChromaStride = src.mWidth / 2;
+    layout.mChromaStep = 1;
+    layout.mWidth = dst.cropWidth();
+    layout.mHeight = dst.cropHeight();
+    layout.mScale = scale;
+    layout.mSwapRB = false;
+
+    return convertYUV420(layout, dst);
+}
 
-        src_y += src.mWidth;
+status_t ColorConverter::convertQCOMYUV420SemiPlanar(
+        const BitmapParams &src, const BitmapParams &dst) {
+    size_t scale = ScaleFactor(src, dst);
+    if (!((src.mCropLeft & 1) == 0 && scale != 0)) {
+        return ERROR_UNSUPPORTED;
+    }
 
-        if (y & 1) {
-            src_u += src.mWidth / 2;
-            src_v += src.mWidth / 2;
-        }
+    const uint8_t *src_y =
+        (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
 
-        dst_ptr += dst.mWidth;
-    }
+    const uint8_t *src_u =
+        (const uint8_t *)src_y + src.mWidth * src.mHeight
+        + src.mCropTop * src.mWidth + src.mCropLeft;
 
-    return OK;
+    YUV420Layout layout;
+    layout.mY = src_y;
+    layout.mU = src_u;
+    layout.mV = src_u + 1;
+    layout.mYStride = src.mWidth;
+    layout.mChromaStride = src.mWidth;
+    layout.mChromaStep = 2;
+    layout.mWidth = dst.cropWidth();
+    layout.mHeight = dst.cropHeight();
+    layout.mScale = scale;
+    layout.mSwapRB = true;
+
+    return convertYUV420(layout, dst);
 }
 
-status_t ColorConverter::convertQCOMYUV420SemiPlanar(
+status_t ColorConverter::convertYUV420SemiPlanar(
         const BitmapParams &src, const BitmapParams &dst) {
-    uint8_t *kAdjustedClip = initClip();
+    // XXX Untested
 
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
+    size_t scale = ScaleFactor(src, dst);
+    if (!((src.mCropLeft & 1) == 0 && scale != 0)) {
         return ERROR_UNSUPPORTED;
     }
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
     const uint8_t *src_y =
         (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
 
@@ -310,205 +344,597 @@ status_t ColorConverter::convertQCOMYUV420SemiPlanar(
         (const uint8_t *)src_y + src.mWidth * src.mHeight
         + src.mCropTop * src.mWidth + src.mCropLeft;
 
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
+    YUV420Layout layout;
+    layout.mY = src_y;
+    layout.mU = src_u + 1;
+    layout.mV = src_u;
+    layout.mYStride = src.mWidth;
+    layout.mChromaStride = src.mWidth;
+    layout.mChromaStep = 2;
+    layout.mWidth = dst.cropWidth();
+    layout.mHeight = dst.cropHeight();
+    layout.mScale = scale;
+    layout.mSwapRB = true;
+
+    return convertYUV420(layout, dst);
+}
 
-            signed u = (signed)src_u[x & ~1] - 128;
-            signed v = (signed)src_u[(x & ~1) + 1] - 128;
+status_t ColorConverter::convertTIYUV420PackedSemiPlanar(
+        const BitmapParams &src, const BitmapParams &dst) {
+    size_t scale = ScaleFactor(src, dst);
+    if (!((src.mCropLeft & 1) == 0 && scale != 0)) {
+        return ERROR_UNSUPPORTED;
+    }
 
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
+    const uint8_t *src_y = (const uint8_t *)src.mBits;
 
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
+    const uint8_t *src_u =
+        (const uint8_t *)src_y + src.mWidth * (src.mHeight - src.mCropTop / 2);
 
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
+    YUV420Layout layout;
+    layout.mY = src_y;
+    layout.mU = src_u;
+    layout.mV = src_u + 1;
+    layout.mYStride = src.mWidth;
+    layout.mChromaStride = src.mWidth;
+    layout.mChromaStep = 2;
+    layout.mWidth = dst.cropWidth();
+    layout.mHeight = dst.cropHeight();
+    layout.mScale = scale;
+    layout.mSwapRB = false;
+
+    return convertYUV420(layout, dst);
+}
 
-            uint32_t rgb1 =
-                ((kAdjustedClip[b1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[r1] >> 3);
+////////////////////////////////////////////////////////////////////////////////
+
+// One row of a YUV 4:2:0 conversion. The row kernels below handle as many
+// pixels as they can from |x| on in steps of their vector width and return
+// where they stopped, convertRow finishes the rest.
+//
+// All of them compute, for each pixel,
+//     R = (cy * (Y - yOffset) + vToR * (V - 128)) >> 8
+//     G = (cy * (Y - yOffset) - uToG * (U - 128) - vToG * (V - 128)) >> 8
+//     B = (cy * (Y - yOffset) + uToB * (U - 128)) >> 8
+// clamped to [0, 255]. The arithmetic shift only differs from the division
+// by 256 this class used to do for negative values, which clamp to 0 either
+// way, so RGB565 output is unchanged.
+struct RowArgs {
+    const uint8_t *mY;
+    const uint8_t *mU;
+    const uint8_t *mV;
+    size_t mChromaStep;
+    size_t mWidth;
+    uint8_t *mDst;
+    bool mRGBA;
+    bool mSwapRB;
+
+    int16_t mYOffset;
+    int16_t mY2RGB;
+    int16_t mVToR;
+    int16_t mUToG;
+    int16_t mVToG;
+    int16_t mUToB;
+};
+
+static inline void writePixel(
+        const RowArgs &args, size_t x, uint8_t r, uint8_t g, uint8_t b) {
+    if (args.mSwapRB) {
+        uint8_t tmp = r;
+        r = b;
+        b = tmp;
+    }
 
-            uint32_t rgb2 =
-                ((kAdjustedClip[b2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[r2] >> 3);
+    if (args.mRGBA) {
+        uint8_t *out = args.mDst + x * 4;
+        out[0] = r;
+        out[1] = g;
+        out[2] = b;
+        out[3] = 0xff;
+    } else {
+        ((uint16_t *)args.mDst)[x] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+    }
+}
 
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
+static void convertRowScalar(
+        const RowArgs &args, size_t x, const uint8_t *kAdjustedClip) {
+    for (; x < args.mWidth; x += 2) {
+        signed u = (signed)args.mU[(x / 2) * args.mChromaStep] - 128;
+        signed v = (signed)args.mV[(x / 2) * args.mChromaStep] - 128;
+
+        signed u_b = u * args.mUToB;
+        signed u_g = -u * args.mUToG;
+        signed v_g = -v * args.mVToG;
+        signed v_r = v * args.mVToR;
+
+        signed tmp1 = ((signed)args.mY[x] - args.mYOffset) * args.mY2RGB;
+        writePixel(args, x,
+                kAdjustedClip[(tmp1 + v_r) >> 8],
+                kAdjustedClip[(tmp1 + v_g + u_g) >> 8],
+                kAdjustedClip[(tmp1 + u_b) >> 8]);
+
+        if (x + 1 < args.mWidth) {
+            signed tmp2 = ((signed)args.mY[x + 1] - args.mYOffset) * args.mY2RGB;
+            writePixel(args, x + 1,
+                    kAdjustedClip[(tmp2 + v_r) >> 8],
+                    kAdjustedClip[(tmp2 + v_g + u_g) >> 8],
+                    kAdjustedClip[(tmp2 + u_b) >> 8]);
         }
+    }
+}
 
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
-        }
+#if defined(__SSE2__)
 
-        dst_ptr += dst.mWidth;
-    }
+// Two 16-bit coefficients repeated over the register, |lo| in the even lanes.
+static inline __m128i coeffPair(int16_t lo, int16_t hi) {
+    return _mm_set_epi16(hi, lo, hi, lo, hi, lo, hi, lo);
+}
 
-    return OK;
+static inline __m128i load4Bytes(const uint8_t *ptr) {
+    int32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return _mm_cvtsi32_si128(value);
 }
 
-status_t ColorConverter::convertYUV420SemiPlanar(
-        const BitmapParams &src, const BitmapParams &dst) {
-    // XXX Untested
+// (a * ca + b * cb) >> 8 for eight pixels.
+static inline __m128i multiplyAdd(
+        __m128i a, __m128i b, __m128i coeffs) {
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), coeffs);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), coeffs);
+    return _mm_packs_epi32(_mm_srai_epi32(lo, 8), _mm_srai_epi32(hi, 8));
+}
 
-    uint8_t *kAdjustedClip = initClip();
+static size_t convertRowSSE2(const RowArgs &args, size_t x) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(255);
+    const __m128i yOffset = _mm_set1_epi16(args.mYOffset);
+    const __m128i chromaOffset = _mm_set1_epi16(128);
+    const __m128i lowHalves = _mm_set1_epi32(0xffff);
+    const __m128i alpha = _mm_set1_epi16((int16_t)0xff00);
+
+    const __m128i coeffR = coeffPair(args.mY2RGB, args.mVToR);
+    const __m128i coeffB = coeffPair(args.mY2RGB, args.mUToB);
+    const __m128i coeffG = coeffPair(args.mY2RGB, -args.mUToG);
+    const __m128i coeffGV = coeffPair(-args.mVToG, 0);
+
+    const uint8_t *chroma = args.mU < args.mV ? args.mU : args.mV;
+
+    for (; x + 8 <= args.mWidth; x += 8) {
+        __m128i y = _mm_loadl_epi64((const __m128i *)(args.mY + x));
+        y = _mm_sub_epi16(_mm_unpacklo_epi8(y, zero), yOffset);
+
+        // Chroma of pixels x .. x + 7, each sample twice.
+        __m128i u, v;
+        if (args.mChromaStep == 1) {
+            u = load4Bytes(args.mU + x / 2);
+            u = _mm_unpacklo_epi8(_mm_unpacklo_epi8(u, u), zero);
+            v = load4Bytes(args.mV + x / 2);
+            v = _mm_unpacklo_epi8(_mm_unpacklo_epi8(v, v), zero);
+        } else {
+            __m128i c = _mm_loadl_epi64((const __m128i *)(chroma + x));
+            c = _mm_unpacklo_epi8(c, zero);
+
+            __m128i first = _mm_and_si128(c, lowHalves);
+            first = _mm_or_si128(first, _mm_slli_epi32(first, 16));
+            __m128i second = _mm_srli_epi32(c, 16);
+            second = _mm_or_si128(second, _mm_slli_epi32(second, 16));
+
+            if (chroma == args.mU) {
+                u = first;
+                v = second;
+            } else {
+                u = second;
+                v = first;
+            }
+        }
+        u = _mm_sub_epi16(u, chromaOffset);
+        v = _mm_sub_epi16(v, chromaOffset);
+
+        __m128i r = multiplyAdd(y, v, coeffR);
+        __m128i b = multiplyAdd(y, u, coeffB);
+
+        // The V term of green goes in as a second pair with a zero.
+        __m128i gLo = _mm_madd_epi16(_mm_unpacklo_epi16(y, u), coeffG);
+        __m128i gHi = _mm_madd_epi16(_mm_unpackhi_epi16(y, u), coeffG);
+        gLo = _mm_add_epi32(gLo, _mm_madd_epi16(_mm_unpacklo_epi16(v, zero), coeffGV));
+        gHi = _mm_add_epi32(gHi, _mm_madd_epi16(_mm_unpackhi_epi16(v, zero), coeffGV));
+        __m128i g = _mm_packs_epi32(_mm_srai_epi32(gLo, 8), _mm_srai_epi32(gHi, 8));
+
+        r = _mm_min_epi16(_mm_max_epi16(r, zero), max);
+        g = _mm_min_epi16(_mm_max_epi16(g, zero), max);
+        b = _mm_min_epi16(_mm_max_epi16(b, zero), max);
+
+        if (args.mSwapRB) {
+            __m128i tmp = r;
+            r = b;
+            b = tmp;
+        }
 
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
+        if (args.mRGBA) {
+            __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+            __m128i ba = _mm_or_si128(b, alpha);
+            __m128i *out = (__m128i *)(args.mDst + x * 4);
+            _mm_storeu_si128(out, _mm_unpacklo_epi16(rg, ba));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rg, ba));
+        } else {
+            __m128i rgb = _mm_or_si128(
+                    _mm_slli_epi16(_mm_srli_epi16(r, 3), 11),
+                    _mm_slli_epi16(_mm_srli_epi16(g, 2), 5));
+            rgb = _mm_or_si128(rgb, _mm_srli_epi16(b, 3));
+            _mm_storeu_si128((__m128i *)(args.mDst + x * 2), rgb);
+        }
     }
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_y =
-        (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
-
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
-        + src.mCropTop * src.mWidth + src.mCropLeft;
+    return x;
+}
 
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
+#endif  // __SSE2__
+
+#if defined(COLOR_CONVERTER_AVX2)
+
+// Same as convertRowSSE2 for sixteen pixels at a time, only called if the
+// CPU has AVX2.
+__attribute__((target("avx2")))
+static size_t convertRowAVX2(const RowArgs &args, size_t x) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(255);
+    const __m256i yOffset = _mm256_set1_epi16(args.mYOffset);
+    const __m256i chromaOffset = _mm256_set1_epi16(128);
+    const __m256i lowHalves = _mm256_set1_epi32(0xffff);
+    const __m256i alpha = _mm256_set1_epi16((int16_t)0xff00);
+
+    const __m256i coeffR = _mm256_set1_epi32(
+            (uint16_t)args.mY2RGB | ((uint32_t)(uint16_t)args.mVToR << 16));
+    const __m256i coeffB = _mm256_set1_epi32(
+            (uint16_t)args.mY2RGB | ((uint32_t)(uint16_t)args.mUToB << 16));
+    const __m256i coeffG = _mm256_set1_epi32(
+            (uint16_t)args.mY2RGB | ((uint32_t)(uint16_t)-args.mUToG << 16));
+    const __m256i coeffGV = _mm256_set1_epi32((uint16_t)-args.mVToG);
+
+    const uint8_t *chroma = args.mU < args.mV ? args.mU : args.mV;
+
+    for (; x + 16 <= args.mWidth; x += 16) {
+        __m256i y = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)(args.mY + x)));
+        y = _mm256_sub_epi16(y, yOffset);
+
+        __m256i u, v;
+        if (args.mChromaStep == 1) {
+            __m128i u8 = _mm_loadl_epi64((const __m128i *)(args.mU + x / 2));
+            u = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u8, u8));
+            __m128i v8 = _mm_loadl_epi64((const __m128i *)(args.mV + x / 2));
+            v = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v8, v8));
+        } else {
+            __m256i c = _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i *)(chroma + x)));
+
+            __m256i first = _mm256_and_si256(c, lowHalves);
+            first = _mm256_or_si256(first, _mm256_slli_epi32(first, 16));
+            __m256i second = _mm256_srli_epi32(c, 16);
+            second = _mm256_or_si256(second, _mm256_slli_epi32(second, 16));
+
+            if (chroma == args.mU) {
+                u = first;
+                v = second;
+            } else {
+                u = second;
+                v = first;
+            }
+        }
+        u = _mm256_sub_epi16(u, chromaOffset);
+        v = _mm256_sub_epi16(v, chromaOffset);
+
+        // Unpacking and packing again both work within 128-bit lanes, so the
+        // pixels come out in order.
+        __m256i rLo = _mm256_madd_epi16(_mm256_unpacklo_epi16(y, v), coeffR);
+        __m256i rHi = _mm256_madd_epi16(_mm256_unpackhi_epi16(y, v), coeffR);
+        __m256i bLo = _mm256_madd_epi16(_mm256_unpacklo_epi16(y, u), coeffB);
+        __m256i bHi = _mm256_madd_epi16(_mm256_unpackhi_epi16(y, u), coeffB);
+        __m256i gLo = _mm256_madd_epi16(_mm256_unpacklo_epi16(y, u), coeffG);
+        __m256i gHi = _mm256_madd_epi16(_mm256_unpackhi_epi16(y, u), coeffG);
+        gLo = _mm256_add_epi32(
+                gLo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v, zero), coeffGV));
+        gHi = _mm256_add_epi32(
+                gHi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v, zero), coeffGV));
+
+        __m256i r = _mm256_packs_epi32(
+                _mm256_srai_epi32(rLo, 8), _mm256_srai_epi32(rHi, 8));
+        __m256i g = _mm256_packs_epi32(
+                _mm256_srai_epi32(gLo, 8), _mm256_srai_epi32(gHi, 8));
+        __m256i b = _mm256_packs_epi32(
+                _mm256_srai_epi32(bLo, 8), _mm256_srai_epi32(bHi, 8));
+
+        r = _mm256_min_epi16(_mm256_max_epi16(r, zero), max);
+        g = _mm256_min_epi16(_mm256_max_epi16(g, zero), max);
+        b = _mm256_min_epi16(_mm256_max_epi16(b, zero), max);
+
+        if (args.mSwapRB) {
+            __m256i tmp = r;
+            r = b;
+            b = tmp;
+        }
 
-            signed v = (signed)src_u[x & ~1] - 128;
-            signed u = (signed)src_u[(x & ~1) + 1] - 128;
+        if (args.mRGBA) {
+            __m256i rg = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+            __m256i ba = _mm256_or_si256(b, alpha);
+            __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+            __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+            __m256i *out = (__m256i *)(args.mDst + x * 4);
+            _mm256_storeu_si256(out, _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+        } else {
+            __m256i rgb = _mm256_or_si256(
+                    _mm256_slli_epi16(_mm256_srli_epi16(r, 3), 11),
+                    _mm256_slli_epi16(_mm256_srli_epi16(g, 2), 5));
+            rgb = _mm256_or_si256(rgb, _mm256_srli_epi16(b, 3));
+            _mm256_storeu_si256((__m256i *)(args.mDst + x * 2), rgb);
+        }
+    }
 
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
+    return x;
+}
 
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
+static bool HaveAVX2() {
+    static bool haveAVX2 = __builtin_cpu_supports("avx2");
+    return haveAVX2;
+}
 
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
+#endif  // COLOR_CONVERTER_AVX2
 
-            uint32_t rgb1 =
-                ((kAdjustedClip[b1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[r1] >> 3);
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
 
-            uint32_t rgb2 =
-                ((kAdjustedClip[b2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[r2] >> 3);
+static inline int16x8_t widenChroma(uint8x8_t c) {
+    return vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(c)), vdupq_n_s16(128));
+}
 
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
+static size_t convertRowNEON(const RowArgs &args, size_t x) {
+    const int16x8_t yOffset = vdupq_n_s16(args.mYOffset);
+    const uint8x8_t alpha = vdup_n_u8(0xff);
+
+    const uint8_t *chroma = args.mU < args.mV ? args.mU : args.mV;
+
+    for (; x + 8 <= args.mWidth; x += 8) {
+        int16x8_t y = vsubq_s16(
+                vreinterpretq_s16_u16(vmovl_u8(vld1_u8(args.mY + x))), yOffset);
+
+        // Chroma of pixels x .. x + 7, each sample twice.
+        uint8x8_t u8, v8;
+        if (args.mChromaStep == 1) {
+            uint32_t u4, v4;
+            memcpy(&u4, args.mU + x / 2, sizeof(u4));
+            memcpy(&v4, args.mV + x / 2, sizeof(v4));
+            u8 = vreinterpret_u8_u32(vdup_n_u32(u4));
+            u8 = vzip_u8(u8, u8).val[0];
+            v8 = vreinterpret_u8_u32(vdup_n_u32(v4));
+            v8 = vzip_u8(v8, v8).val[0];
+        } else {
+            uint8x8_t c = vld1_u8(chroma + x);
+            uint8x8x2_t pairs = vtrn_u8(c, c);
+            if (chroma == args.mU) {
+                u8 = pairs.val[0];
+                v8 = pairs.val[1];
             } else {
-                dst_ptr[x] = rgb1;
+                u8 = pairs.val[1];
+                v8 = pairs.val[0];
             }
         }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
+        int16x8_t u = widenChroma(u8);
+        int16x8_t v = widenChroma(v8);
+
+        int32x4_t yLo = vmull_n_s16(vget_low_s16(y), args.mY2RGB);
+        int32x4_t yHi = vmull_n_s16(vget_high_s16(y), args.mY2RGB);
+
+        int32x4_t rLo = vmlal_n_s16(yLo, vget_low_s16(v), args.mVToR);
+        int32x4_t rHi = vmlal_n_s16(yHi, vget_high_s16(v), args.mVToR);
+        int32x4_t gLo = vmlsl_n_s16(yLo, vget_low_s16(u), args.mUToG);
+        int32x4_t gHi = vmlsl_n_s16(yHi, vget_high_s16(u), args.mUToG);
+        gLo = vmlsl_n_s16(gLo, vget_low_s16(v), args.mVToG);
+        gHi = vmlsl_n_s16(gHi, vget_high_s16(v), args.mVToG);
+        int32x4_t bLo = vmlal_n_s16(yLo, vget_low_s16(u), args.mUToB);
+        int32x4_t bHi = vmlal_n_s16(yHi, vget_high_s16(u), args.mUToB);
+
+        uint8x8_t r = vqmovun_s16(
+                vcombine_s16(vshrn_n_s32(rLo, 8), vshrn_n_s32(rHi, 8)));
+        uint8x8_t g = vqmovun_s16(
+                vcombine_s16(vshrn_n_s32(gLo, 8), vshrn_n_s32(gHi, 8)));
+        uint8x8_t b = vqmovun_s16(
+                vcombine_s16(vshrn_n_s32(bLo, 8), vshrn_n_s32(bHi, 8)));
+
+        if (args.mSwapRB) {
+            uint8x8_t tmp = r;
+            r = b;
+            b = tmp;
         }
 
-        dst_ptr += dst.mWidth;
+        if (args.mRGBA) {
+            uint8x8x4_t rgba;
+            rgba.val[0] = r;
+            rgba.val[1] = g;
+            rgba.val[2] = b;
+            rgba.val[3] = alpha;
+            vst4_u8(args.mDst + x * 4, rgba);
+        } else {
+            uint16x8_t rgb = vshll_n_u8(r, 8);
+            rgb = vsriq_n_u16(rgb, vshll_n_u8(g, 8), 5);
+            rgb = vsriq_n_u16(rgb, vshll_n_u8(b, 8), 11);
+            vst1q_u16((uint16_t *)(args.mDst + x * 2), rgb);
+        }
     }
 
-    return OK;
+    return x;
 }
 
-status_t ColorConverter::convertTIYUV420PackedSemiPlanar(
-        const BitmapParams &src, const BitmapParams &dst) {
-    uint8_t *kAdjustedClip = initClip();
+#endif  // __ARM_NEON__ || __ARM_NEON
 
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
+static void convertRow(const RowArgs &args, const uint8_t *kAdjustedClip) {
+    size_t x = 0;
+
+#if defined(COLOR_CONVERTER_AVX2)
+    if (HaveAVX2()) {
+        x = convertRowAVX2(args, x);
     }
+#endif
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
+#if defined(__SSE2__)
+    x = convertRowSSE2(args, x);
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    x = convertRowNEON(args, x);
+#endif
 
-    const uint8_t *src_y = (const uint8_t *)src.mBits;
+    convertRowScalar(args, x, kAdjustedClip);
+}
 
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * (src.mHeight - src.mCropTop / 2);
+struct ColorConverter::Band {
+    ColorConverter *mConverter;
+    const YUV420Layout *mLayout;
+    const BitmapParams *mDst;
+    size_t mFirstRow;
+    size_t mNumRows;
+    pthread_t mThread;
+};
 
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
+// static
+void *ColorConverter::BandThreadWrapper(void *me) {
+    Band *band = static_cast<Band *>(me);
 
-            signed u = (signed)src_u[x & ~1] - 128;
-            signed v = (signed)src_u[(x & ~1) + 1] - 128;
+    band->mConverter->convertYUV420Rows(
+            *band->mLayout, *band->mDst, band->mFirstRow, band->mNumRows);
 
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
+    return NULL;
+}
 
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
+status_t ColorConverter::convertYUV420(
+        const YUV420Layout &layout, const BitmapParams &dst) {
+    // Allocated here, before any band thread uses it.
+    initClip();
 
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
+    size_t numBands = mMaxThreads;
+    if (numBands == 0) {
+        long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+        numBands = numCPUs > 0 ? numCPUs : 1;
+    }
+    if (numBands > kMaxNumBands) {
+        numBands = kMaxNumBands;
+    }
+    size_t maxBandsForSize = layout.mWidth * layout.mHeight / kMinPixelsPerBand;
+    if (numBands > maxBandsForSize) {
+        numBands = maxBandsForSize;
+    }
 
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
+    if (numBands <= 1) {
+        convertYUV420Rows(layout, dst, 0, layout.mHeight);
+        return OK;
+    }
 
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
+    // Bands start on even rows so that no two share a row of chroma.
+    size_t rowsPerBand = ((layout.mHeight + numBands - 1) / numBands + 1) & ~1;
+
+    Band bands[kMaxNumBands];
+    size_t numStarted = 0;
+    for (size_t i = 0; i < numBands; ++i) {
+        Band *band = &bands[i];
+        band->mConverter = this;
+        band->mLayout = &layout;
+        band->mDst = &dst;
+        band->mFirstRow = i * rowsPerBand;
+        band->mNumRows = 0;
+        if (band->mFirstRow < layout.mHeight) {
+            band->mNumRows = layout.mHeight - band->mFirstRow;
+            if (band->mNumRows > rowsPerBand) {
+                band->mNumRows = rowsPerBand;
             }
         }
+    }
 
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
+    // The first band is converted on the calling thread, as is any band a
+    // thread could not be started for.
+    for (size_t i = 1; i < numBands; ++i) {
+        Band *band = &bands[i];
+        if (band->mNumRows == 0) {
+            break;
         }
+        if (pthread_create(&band->mThread, NULL, BandThreadWrapper, band) != 0) {
+            break;
+        }
+        ++numStarted;
+    }
 
-        dst_ptr += dst.mWidth;
+    convertYUV420Rows(layout, dst, bands[0].mFirstRow, bands[0].mNumRows);
+    for (size_t i = numStarted + 1; i < numBands; ++i) {
+        convertYUV420Rows(layout, dst, bands[i].mFirstRow, bands[i].mNumRows);
+    }
+
+    for (size_t i = 1; i <= numStarted; ++i) {
+        pthread_join(bands[i].mThread, NULL);
     }
 
     return OK;
 }
 
+void ColorConverter::convertYUV420Rows(
+        const YUV420Layout &layout, const BitmapParams &dst,
+        size_t firstRow, size_t numRows) {
+    const uint8_t *kAdjustedClip = initClip();
+
+    size_t bytesPerPixel = mDstFormat == kColorFormatRGBA8888 ? 4 : 2;
+
+    RowArgs args;
+    args.mChromaStep = layout.mChromaStep;
+    args.mWidth = layout.mWidth;
+    args.mRGBA = mDstFormat == kColorFormatRGBA8888;
+    args.mSwapRB = layout.mSwapRB;
+    args.mYOffset = mCoefficients.mYOffset;
+    args.mY2RGB = mCoefficients.mY;
+    args.mVToR = mCoefficients.mVToR;
+    args.mUToG = mCoefficients.mUToG;
+    args.mVToG = mCoefficients.mVToG;
+    args.mUToB = mCoefficients.mUToB;
+
+    // Scaling down gathers the samples of each row that are converted into
+    // |row| first, so that the row kernels see a contiguous row.
+    size_t scale = layout.mScale;
+    size_t chromaWidth = (layout.mWidth + 1) / 2;
+    uint8_t *row = NULL;
+    if (scale > 1) {
+        row = new uint8_t[layout.mWidth + 2 * chromaWidth];
+        args.mChromaStep = 1;
+    }
+
+    for (size_t y = firstRow; y < firstRow + numRows; ++y) {
+        size_t srcRow = y * scale;
+        args.mY = layout.mY + srcRow * layout.mYStride;
+        args.mU = layout.mU + (srcRow / 2) * layout.mChromaStride;
+        args.mV = layout.mV + (srcRow / 2) * layout.mChromaStride;
+        args.mDst = (uint8_t *)dst.mBits
+            + ((dst.mCropTop + y) * dst.mWidth + dst.mCropLeft) * bytesPerPixel;
+
+        if (row != NULL) {
+            uint8_t *u = row + layout.mWidth;
+            uint8_t *v = u + chromaWidth;
+            for (size_t x = 0; x < layout.mWidth; ++x) {
+                row[x] = args.mY[x * scale];
+            }
+            // Pixel pair i is pixel 2 * i * scale of the source, whose
+            // chroma is that of source pair i * scale.
+            for (size_t i = 0; i < chromaWidth; ++i) {
+                u[i] = args.mU[i * scale * layout.mChromaStep];
+                v[i] = args.mV[i * scale * layout.mChromaStep];
+            }
+            args.mY = row;
+            args.mU = u;
+            args.mV = v;
+        }
+
+        convertRow(args, kAdjustedClip);
+    }
+
+    delete[] row;
+}
+
 uint8_t *ColorConverter::initClip() {
-    static const signed kClipMin = -278;
-    static const signed kClipMax = 535;
+    // Wide enough for every supported color space, see setSrcColorSpace.
+    static const signed kClipMin = -384;
+    static const signed kClipMax = 640;
 
     if (mClip == NULL) {
         mClip = new uint8_t[kClipMax - kClipMin + 1];
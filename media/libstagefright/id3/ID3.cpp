@@ -56,14 +56,15 @@ private:
     DISALLOW_EVIL_CONSTRUCTORS(MemorySource);
 };
 
-ID3::ID3(const sp<DataSource> &source, bool ignoreV1, off64_t offset)
+ID3::ID3(const sp<DataSource> &source, bool ignoreV1, off64_t offset,
+        bool metaDataOnly)
     : mIsValid(false),
       mData(NULL),
       mSize(0),
       mFirstFrameOffset(0),
       mVersion(ID3_UNKNOWN),
       mRawSize(0) {
-    mIsValid = parseV2(source, offset);
+    mIsValid = parseV2(source, offset, metaDataOnly);
 
     if (!mIsValid && !ignoreV1) {
         mIsValid = parseV1(source);
@@ -79,7 +80,7 @@ ID3::ID3(const uint8_t *data, size_t size, bool ignoreV1)
       mRawSize(0) {
     sp<MemorySource> source = new MemorySource(data, size);
 
-    mIsValid = parseV2(source, 0);
+    mIsValid = parseV2(source, 0, false /* metaDataOnly */);
 
     if (!mIsValid && !ignoreV1) {
         mIsValid = parseV1(source);
@@ -115,7 +116,8 @@ bool ID3::ParseSyncsafeInteger(const uint8_t encoded[4], size_t *x) {
     return true;
 }
 
-bool ID3::parseV2(const sp<DataSource> &source, off64_t offset) {
+bool ID3::parseV2(
+        const sp<DataSource> &source, off64_t offset, bool metaDataOnly) {
 struct id3_header {
     char id[3];
     uint8_t version_major;
@@ -176,20 +178,29 @@ struct id3_header {
         return false;
     }
 
-    mData = (uint8_t *)malloc(size);
+    // Without unsynchronization or an extended header applying to the whole
+    // tag, the frames can be read one at a time.
+    if (metaDataOnly && !(header.flags & 0xc0)
+            && readFramesWithoutPictures(
+                source, offset + sizeof(header), size, header.version_major)) {
+        mRawSize = size + sizeof(header);
+        size = mSize;
+    } else {
+        mData = (uint8_t *)malloc(size);
 
-    if (mData == NULL) {
-        return false;
-    }
+        if (mData == NULL) {
+            return false;
+        }
 
-    mSize = size;
-    mRawSize = mSize + sizeof(header);
+        mSize = size;
+        mRawSize = mSize + sizeof(header);
 
-    if (source->readAt(offset + sizeof(header), mData, mSize) != (ssize_t)mSize) {
-        free(mData);
-        mData = NULL;
+        if (source->readAt(offset + sizeof(header), mData, mSize) != (ssize_t)mSize) {
+            free(mData);
+            mData = NULL;
 
-        return false;
+            return false;
+        }
     }
 
     if (header.version_major == 4) {
@@ -307,6 +318,85 @@ struct id3_header {
     return true;
 }
 
+// Reads the frames of the |size| bytes of tag at |offset| except for the
+// pictures. Gives up, leaving it to the caller to read the whole tag, on
+// anything the frame iterator and removeUnsynchronizationV2_4() would not take
+// as it comes.
+bool ID3::readFramesWithoutPictures(
+        const sp<DataSource> &source, off64_t offset, size_t size,
+        uint8_t majorVersion) {
+    size_t headerSize = (majorVersion == 2) ? 6 : 10;
+
+    uint8_t *data = (uint8_t *)malloc(size);
+    if (data == NULL) {
+        return false;
+    }
+
+    size_t readOffset = 0;
+    size_t writeOffset = 0;
+    while (readOffset + headerSize <= size) {
+        uint8_t *frame = &data[writeOffset];
+        if (source->readAt(offset + readOffset, frame, headerSize)
+                != (ssize_t)headerSize) {
+            free(data);
+            return false;
+        }
+
+        if (!memcmp(frame, "\0\0\0\0", majorVersion == 2 ? 3 : 4)) {
+            // Padding.
+            break;
+        }
+
+        size_t frameSize;
+        if (majorVersion == 2) {
+            frameSize = (frame[3] << 16) | (frame[4] << 8) | frame[5];
+        } else if (majorVersion == 3) {
+            frameSize = U32_AT(&frame[4]);
+        } else if (!ParseSyncsafeInteger(&frame[4], &frameSize)) {
+            free(data);
+            return false;
+        }
+
+        if (frameSize > size - readOffset - headerSize) {
+            free(data);
+            return false;
+        }
+
+        bool isPicture = (majorVersion == 2)
+            ? !memcmp(frame, "PIC", 3) : !memcmp(frame, "APIC", 4);
+
+        if (!isPicture) {
+            if (source->readAt(
+                        offset + readOffset + headerSize, &frame[headerSize],
+                        frameSize) != (ssize_t)frameSize) {
+                free(data);
+                return false;
+            }
+            writeOffset += headerSize + frameSize;
+        }
+
+        readOffset += headerSize + frameSize;
+    }
+
+    // Reading the whole tag fails if the file is cut short, so must this.
+    uint8_t lastByte;
+    if (size > 0 && source->readAt(offset + size - 1, &lastByte, 1) != 1) {
+        free(data);
+        return false;
+    }
+
+    // Leave what follows the frames looking like padding, as it does when
+    // the tag is read whole.
+    if (writeOffset < size) {
+        data[writeOffset] = 0;
+    }
+
+    mData = data;
+    mSize = writeOffset;
+
+    return true;
+}
+
 void ID3::removeUnsynchronization() {
     for (size_t i = 0; i + 1 < mSize; ++i) {
         if (mData[i] == 0xff && mData[i + 1] == 0x00) {
@@ -349,6 +439,9 @@ bool ID3::removeUnsynchronizationV2_4(bool iTunesHack) {
         if (flags & 1) {
             // Strip data length indicator
 
+            if (dataSize < 4) {
+                return false;
+            }
             memmove(&mData[offset + 10], &mData[offset + 14], mSize - offset - 14);
             mSize -= 4;
             dataSize -= 4;
@@ -371,8 +464,11 @@ bool ID3::removeUnsynchronizationV2_4(bool iTunesHack) {
                 }
                 mData[writeOffset++] = mData[readOffset++];
             }
-            // move the remaining data following this frame
-            memmove(&mData[writeOffset], &mData[readOffset], oldSize - readOffset);
+            // move the remaining data following this frame, if any; a last
+            // frame ending in 0xff 0x00 leaves readOffset past the end.
+            if (readOffset < oldSize) {
+                memmove(&mData[writeOffset], &mData[readOffset], oldSize - readOffset);
+            }
 
             flags &= ~2;
         }
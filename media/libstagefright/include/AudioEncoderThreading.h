@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUDIO_ENCODER_THREADING_H_
+
+#define AUDIO_ENCODER_THREADING_H_
+
+#include <OMX_Core.h>
+
+namespace android {
+
+// Threading of a software audio encoder, returned by getExtensionIndex for
+// this name. Can only be set in the Loaded state.
+//
+// With more than one thread the encoder splits its input into segments of
+// nSegmentFrames frames and encodes several segments at once, each on its own
+// encoder instance with the same settings. Output is still in order, but
+// lags the input by up to a segment, so this is meant for throughput rather
+// than low latency.
+//
+// Off unless requested: segments are joined by re-encoding a few frames of
+// pre-roll, and the bit reservoir is not carried across the joins, so the
+// output differs from single-threaded encoding at every segment boundary.
+#define AUDIO_ENCODER_THREADING_EXTENSION \
+        "OMX.google.android.index.audioEncoderThreading"
+
+struct AudioEncoderThreadingParams {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+
+    // Number of threads the encoder may use, 0 for one per online CPU and 1
+    // (the default) to encode on the component thread.
+    OMX_U32 nNumThreads;
+
+    // Frames per segment, 0 for the component's default. Read back to get
+    // the value in effect.
+    OMX_U32 nSegmentFrames;
+};
+
+}  // namespace android
+
+#endif  // AUDIO_ENCODER_THREADING_H_
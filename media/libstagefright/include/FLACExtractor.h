@@ -28,8 +28,9 @@ class FLACParser;
 class FLACExtractor : public MediaExtractor {
 
 public:
-    // Extractor assumes ownership of source
-    FLACExtractor(const sp<DataSource> &source);
+    // Extractor assumes ownership of source. A metadata-only extractor
+    // leaves the pictures out of the file's metadata.
+    FLACExtractor(const sp<DataSource> &source, bool metaDataOnly = false);
 
     virtual size_t countTracks();
     virtual sp<MediaSource> getTrack(size_t index);
@@ -43,6 +44,7 @@ protected:
 private:
     sp<DataSource> mDataSource;
     sp<FLACParser> mParser;
+    bool mMetaDataOnly;
     status_t mInitCheck;
     sp<MetaData> mFileMetadata;
 
@@ -35,7 +35,10 @@ struct ID3 {
         ID3_V2_4,
     };
 
-    ID3(const sp<DataSource> &source, bool ignoreV1 = false, off64_t offset = 0);
+    // A metadata-only tag leaves out the pictures and, where it can, does
+    // not read them either.
+    ID3(const sp<DataSource> &source, bool ignoreV1 = false, off64_t offset = 0,
+            bool metaDataOnly = false);
     ID3(const uint8_t *data, size_t size, bool ignoreV1 = false);
     ~ID3();
 
@@ -86,7 +89,10 @@ private:
     size_t mRawSize;
 
     bool parseV1(const sp<DataSource> &source);
-    bool parseV2(const sp<DataSource> &source, off64_t offset);
+    bool parseV2(const sp<DataSource> &source, off64_t offset, bool metaDataOnly);
+    bool readFramesWithoutPictures(
+            const sp<DataSource> &source, off64_t offset, size_t size,
+            uint8_t majorVersion);
     void removeUnsynchronization();
     bool removeUnsynchronizationV2_4(bool iTunesHack);
 
@@ -30,8 +30,10 @@ class String8;
 
 class MP3Extractor : public MediaExtractor {
 public:
-    // Extractor assumes ownership of "source".
-    MP3Extractor(const sp<DataSource> &source, const sp<AMessage> &meta);
+    // Extractor assumes ownership of "source". A metadata-only extractor
+    // leaves the album art out of the file's metadata.
+    MP3Extractor(const sp<DataSource> &source, const sp<AMessage> &meta,
+            bool metaDataOnly = false);
 
     virtual size_t countTracks();
     virtual sp<MediaSource> getTrack(size_t index);
@@ -43,6 +45,7 @@ private:
     status_t mInitCheck;
 
     sp<DataSource> mDataSource;
+    bool mMetaDataOnly;
     off64_t mFirstFramePos;
     sp<MetaData> mMeta;
     uint32_t mFixedHeader;
@@ -49,8 +49,9 @@ struct Trex {
 
 class MPEG4Extractor : public MediaExtractor {
 public:
-    // Extractor assumes ownership of "source".
-    MPEG4Extractor(const sp<DataSource> &source);
+    // Extractor assumes ownership of "source". A metadata-only extractor
+    // does not load the sample tables and cannot provide its tracks.
+    MPEG4Extractor(const sp<DataSource> &source, bool metaDataOnly = false);
 
     virtual size_t countTracks();
     virtual sp<MediaSource> getTrack(size_t index);
@@ -79,6 +80,8 @@ private:
         sp<SampleTable> sampleTable;
         bool includes_expensive_metadata;
         bool skipTrack;
+        // The sample table boxes found so far, see kSampleTableBoxes.
+        uint32_t sampleTableBoxes;
     };
 
     Vector<SidxEntry> mSidxEntries;
@@ -89,6 +92,7 @@ private:
     Vector<Trex> mTrex;
 
     sp<DataSource> mDataSource;
+    bool mMetaDataOnly;
     status_t mInitCheck;
     bool mHasVideo;
     uint32_t mHeaderTimescale;
@@ -111,7 +115,7 @@ private:
     status_t updateAudioTrackInfoFromESDS_MPEG4Audio(
             const void *esds_data, size_t esds_size);
 
-    static status_t verifyTrack(Track *track);
+    status_t verifyTrack(Track *track);
 
     struct SINF {
         SINF *next;
@@ -116,6 +116,9 @@ public:
             OMX_U32 range_offset, OMX_U32 range_length,
             OMX_U32 flags, OMX_TICKS timestamp);
 
+    virtual status_t submitBuffers(
+            node_id node, const Vector<BufferOp> &ops);
+
     virtual status_t getExtensionIndex(
             node_id node,
             const char *parameter_name,
@@ -31,7 +31,9 @@ struct MyVorbisExtractor;
 struct OggSource;
 
 struct OggExtractor : public MediaExtractor {
-    OggExtractor(const sp<DataSource> &source);
+    // A metadata-only extractor does not index the pages for seeking and
+    // leaves the album art out of the file's metadata.
+    OggExtractor(const sp<DataSource> &source, bool metaDataOnly = false);
 
     virtual size_t countTracks();
     virtual sp<MediaSource> getTrack(size_t index);
@@ -59,7 +61,8 @@ bool SniffOgg(
         sp<AMessage> *);
 
 void parseVorbisComment(
-        const sp<MetaData> &fileMeta, const char *comment, size_t commentLength);
+        const sp<MetaData> &fileMeta, const char *comment, size_t commentLength,
+        bool metaDataOnly = false);
 
 }  // namespace android
 
@@ -82,6 +82,11 @@ public:
             uint32_t start_sample_index, uint32_t *sample_index,
             uint32_t flags);
 
+    // The first sync sample at or after |start_sample_index|, or
+    // ERROR_END_OF_STREAM if there is none.
+    status_t findNextSyncSample(
+            uint32_t start_sample_index, uint32_t *sample_index);
+
     status_t findThumbnailSample(uint32_t *sample_index);
 
 protected:
@@ -38,6 +38,10 @@ struct SimpleSoftOMXComponent : public SoftOMXComponent {
 
     virtual void prepareForDestruction();
 
+    virtual OMX_ERRORTYPE processBuffers(
+            OMX_BUFFERHEADERTYPE **inputs, size_t numInputs,
+            OMX_BUFFERHEADERTYPE **outputs, size_t numOutputs);
+
     void onMessageReceived(const sp<AMessage> &msg);
 
 protected:
@@ -141,6 +145,8 @@ private:
 
     void checkTransitions();
 
+    OMX_U32 queueBuffer(OMX_BUFFERHEADERTYPE *header, bool isInput);
+
     DISALLOW_EVIL_CONSTRUCTORS(SimpleSoftOMXComponent);
 };
 
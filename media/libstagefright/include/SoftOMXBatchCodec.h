@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SOFT_OMX_BATCH_CODEC_H_
+
+#define SOFT_OMX_BATCH_CODEC_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Errors.h>
+#include <utils/RefBase.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include <OMX_Component.h>
+
+namespace android {
+
+struct ABuffer;
+struct SoftOMXComponent;
+struct SoftOMXPlugin;
+
+// Runs one of the software codecs in the calling process for offline work
+// (transcoding, thumbnailing, tests) without going through IOMX, ACodec or
+// the component's own message queue: buffers are handed over and returned
+// synchronously on the calling thread, many at a time.
+//
+// Usage: init(), optionally getParameter()/setParameter() as one would in the
+// Loaded state, start(), any number of process() calls, stop().
+struct SoftOMXBatchCodec : public RefBase {
+    SoftOMXBatchCodec();
+
+    status_t init(const char *componentName);
+
+    OMX_ERRORTYPE getParameter(OMX_INDEXTYPE index, OMX_PTR params);
+    OMX_ERRORTYPE setParameter(OMX_INDEXTYPE index, const OMX_PTR params);
+
+    status_t start();
+
+    // Feeds each of |inputs| to the codec as one input buffer and appends all
+    // output produced to |outputs|. Recognized input meta data are "timeUs"
+    // and "csd" (codec specific data), output buffers carry "timeUs" and,
+    // on the last one, "eos". Pass |eos| with the final inputs to drain the
+    // codec; without it, output for the trailing inputs may only be returned
+    // by a later call.
+    status_t process(
+            const Vector<sp<ABuffer> > &inputs, bool eos,
+            Vector<sp<ABuffer> > *outputs);
+
+    status_t stop();
+
+protected:
+    virtual ~SoftOMXBatchCodec();
+
+private:
+    struct BufferInfo {
+        OMX_BUFFERHEADERTYPE *mHeader;
+        bool mOwnedByUs;
+    };
+
+    Mutex mLock;
+    Condition mCondition;
+
+    SoftOMXPlugin *mPlugin;
+    OMX_COMPONENTTYPE *mHandle;
+    SoftOMXComponent *mComponent;
+
+    OMX_STATETYPE mState;
+    Vector<BufferInfo> mBuffers[2];
+
+    bool mPendingCommand;
+    OMX_COMMANDTYPE mPendingCmd;
+    OMX_U32 mPendingParam;
+    bool mPortSettingsChanged;
+    bool mSawOutputEOS;
+    status_t mError;
+
+    // Output collected by FillBufferDone during process().
+    Vector<sp<ABuffer> > *mOutputs;
+
+    static OMX_CALLBACKTYPE kCallbacks;
+
+    status_t sendCommand(OMX_COMMANDTYPE cmd, OMX_U32 param);
+    status_t waitForCommand();
+    status_t allocateBuffers(OMX_U32 portIndex);
+    status_t freeBuffers(OMX_U32 portIndex);
+    status_t waitForBuffersReturned(OMX_U32 portIndex);
+    status_t reconfigureOutputPort();
+
+    size_t countOwnedByUs(OMX_U32 portIndex) const;
+    BufferInfo *findBuffer(OMX_U32 portIndex, OMX_BUFFERHEADERTYPE *header);
+
+    void onEvent(OMX_EVENTTYPE event, OMX_U32 data1, OMX_U32 data2);
+    void onEmptyBufferDone(OMX_BUFFERHEADERTYPE *header);
+    void onFillBufferDone(OMX_BUFFERHEADERTYPE *header);
+
+    static OMX_ERRORTYPE OnEvent(
+            OMX_IN OMX_HANDLETYPE hComponent,
+            OMX_IN OMX_PTR pAppData,
+            OMX_IN OMX_EVENTTYPE eEvent,
+            OMX_IN OMX_U32 nData1,
+            OMX_IN OMX_U32 nData2,
+            OMX_IN OMX_PTR pEventData);
+
+    static OMX_ERRORTYPE OnEmptyBufferDone(
+            OMX_IN OMX_HANDLETYPE hComponent,
+            OMX_IN OMX_PTR pAppData,
+            OMX_IN OMX_BUFFERHEADERTYPE *pBuffer);
+
+    static OMX_ERRORTYPE OnFillBufferDone(
+            OMX_IN OMX_HANDLETYPE hComponent,
+            OMX_IN OMX_PTR pAppData,
+            OMX_IN OMX_BUFFERHEADERTYPE *pBuffer);
+
+    DISALLOW_EVIL_CONSTRUCTORS(SoftOMXBatchCodec);
+};
+
+}  // namespace android
+
+#endif  // SOFT_OMX_BATCH_CODEC_H_
@@ -40,6 +40,14 @@ struct SoftOMXComponent : public RefBase {
 
     virtual void prepareForDestruction() {}
 
+    // For in-process clients only: hands |inputs| and |outputs| to the
+    // component as emptyThisBuffer/fillThisBuffer would, then runs the codec
+    // on the calling thread until it makes no further progress. All buffer
+    // done callbacks this triggers are made before returning.
+    virtual OMX_ERRORTYPE processBuffers(
+            OMX_BUFFERHEADERTYPE **inputs, size_t numInputs,
+            OMX_BUFFERHEADERTYPE **outputs, size_t numOutputs);
+
 protected:
     virtual ~SoftOMXComponent();
 
@@ -40,6 +40,9 @@ struct StagefrightMetadataRetriever : public MediaMetadataRetrieverInterface {
     virtual status_t setDataSource(int fd, int64_t offset, int64_t length);
 
     virtual VideoFrame *getFrameAtTime(int64_t timeUs, int option);
+    virtual status_t getFramesAtTimes(
+            const int64_t *timesUs, size_t numTimes, int option,
+            int32_t maxWidth, int32_t maxHeight, VideoFrame **frames);
     virtual MediaAlbumArt *extractAlbumArt();
     virtual const char *extractMetadata(int keyCode);
 
@@ -48,11 +51,20 @@ private:
     sp<DataSource> mSource;
     sp<MediaExtractor> mExtractor;
 
+    // Whether mExtractor was created with MediaExtractor::kMetaDataOnly,
+    // which is enough for extractMetadata().
+    bool mMetaDataOnly;
+
+    // Identifies the file for the thumbnail cache, empty if it is not a
+    // local file and frames are not cached.
+    String8 mSourceId;
+
     bool mParsedMetaData;
     KeyedVector<int, String8> mMetaData;
     MediaAlbumArt *mAlbumArt;
 
     void parseMetaData();
+    status_t createFullExtractor();
 
     StagefrightMetadataRetriever(const StagefrightMetadataRetriever &);
 
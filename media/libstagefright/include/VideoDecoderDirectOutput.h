@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIDEO_DECODER_DIRECT_OUTPUT_H_
+
+#define VIDEO_DECODER_DIRECT_OUTPUT_H_
+
+#include <OMX_Core.h>
+
+namespace android {
+
+// Lets a software video decoder decode straight into its output buffers
+// instead of copying every picture out of memory of its own. Returned by
+// getExtensionIndex for this name, can only be set in the Loaded state.
+// Disabled by default; ACodec enables it when the format has "direct-output".
+//
+// With direct output a picture the client holds may still be used by the
+// decoder as a reference for pictures decoded later, so the client must
+// treat the contents of output buffers as read-only. The decoder may also
+// ask for more output buffers than it would otherwise.
+#define VIDEO_DECODER_DIRECT_OUTPUT_EXTENSION \
+        "OMX.google.android.index.videoDecoderDirectOutput"
+
+struct VideoDecoderDirectOutputParams {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+
+    OMX_BOOL bEnable;
+};
+
+}  // namespace android
+
+#endif  // VIDEO_DECODER_DIRECT_OUTPUT_H_
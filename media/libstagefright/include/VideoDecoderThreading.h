@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIDEO_DECODER_THREADING_H_
+
+#define VIDEO_DECODER_THREADING_H_
+
+#include <OMX_Core.h>
+
+namespace android {
+
+// Threading of a software video decoder, returned by getExtensionIndex for
+// this name. As a parameter it can only be set in the Loaded state, as a
+// config the thread settings (but not nDecodeAhead) can be changed while
+// decoding; they take effect before the next input buffer is decoded.
+#define VIDEO_DECODER_THREADING_EXTENSION \
+        "OMX.google.android.index.videoDecoderThreading"
+
+struct VideoDecoderThreadingParams {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+
+    // Number of threads the decoder may use, 0 for one per online CPU.
+    OMX_U32 nNumCores;
+
+    // Choose the number of threads from the frame size, never more than
+    // nNumCores. Re-evaluated when the frame size changes.
+    OMX_BOOL bAutoTune;
+
+    // Number of buffers on each port, i.e. how far input can run ahead of the
+    // output consumed by the client. 0 for the component's default. Read back
+    // to get the values in effect.
+    OMX_U32 nDecodeAhead;
+};
+
+}  // namespace android
+
+#endif  // VIDEO_DECODER_THREADING_H_
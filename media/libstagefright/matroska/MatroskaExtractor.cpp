@@ -580,7 +580,17 @@ status_t MatroskaSource::read(
         }
     }
 
+    bool syncFramesOnly = options != NULL && options->getSyncFramesOnly();
+
     while (mPendingFrames.empty()) {
+        if (syncFramesOnly && !mBlockIter.eos()
+                && !mBlockIter.block()->IsKey()) {
+            // Only the block header has been parsed, its frames are never
+            // read.
+            mBlockIter.advance();
+            continue;
+        }
+
         status_t err = readBlock();
 
         if (err != OK) {
@@ -693,10 +703,12 @@ status_t MatroskaSource::read(
 
 ////////////////////////////////////////////////////////////////////////////////
 
-MatroskaExtractor::MatroskaExtractor(const sp<DataSource> &source)
+MatroskaExtractor::MatroskaExtractor(
+        const sp<DataSource> &source, bool metaDataOnly)
     : mDataSource(source),
       mReader(new DataSourceReader(mDataSource)),
       mSegment(NULL),
+      mMetaDataOnly(metaDataOnly),
       mExtractedThumbnails(false),
       mIsWebm(false),
       mSeekPreRollNs(0) {
@@ -727,7 +739,7 @@ MatroskaExtractor::MatroskaExtractor(const sp<DataSource> &source)
 
     // from mkvparser::Segment::Load(), but stop at first cluster
     ret = mSegment->ParseHeaders();
-    if (ret == 0) {
+    if (ret == 0 && !mMetaDataOnly) {
         long len;
         ret = mSegment->LoadCluster(pos, len);
         if (ret >= 1) {
@@ -769,7 +781,7 @@ size_t MatroskaExtractor::countTracks() {
 }
 
 sp<MediaSource> MatroskaExtractor::getTrack(size_t index) {
-    if (index >= mTracks.size()) {
+    if (index >= mTracks.size() || mMetaDataOnly) {
         return NULL;
     }
 
@@ -783,7 +795,7 @@ sp<MetaData> MatroskaExtractor::getTrackMetaData(
     }
 
     if ((flags & kIncludeExtensiveMetaData) && !mExtractedThumbnails
-            && !isLiveStreaming()) {
+            && !isLiveStreaming() && !mMetaDataOnly) {
         findThumbnails();
         mExtractedThumbnails = true;
     }
@@ -33,7 +33,10 @@ struct DataSourceReader;
 struct MatroskaSource;
 
 struct MatroskaExtractor : public MediaExtractor {
-    MatroskaExtractor(const sp<DataSource> &source);
+    // A metadata-only extractor stops at the first cluster instead of
+    // loading it, does not look for thumbnails and cannot provide its
+    // tracks.
+    MatroskaExtractor(const sp<DataSource> &source, bool metaDataOnly = false);
 
     virtual size_t countTracks();
 
@@ -69,6 +72,7 @@ private:
     sp<DataSource> mDataSource;
     DataSourceReader *mReader;
     mkvparser::Segment *mSegment;
+    bool mMetaDataOnly;
     bool mExtractedThumbnails;
     bool mIsLiveStreaming;
     bool mIsWebm;
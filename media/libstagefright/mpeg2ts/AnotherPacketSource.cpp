@@ -43,7 +43,8 @@ AnotherPacketSource::AnotherPacketSource(const sp<MetaData> &meta)
       mEOSResult(OK),
       mLatestEnqueuedMeta(NULL),
       mLatestDequeuedMeta(NULL),
-      mQueuedDiscontinuityCount(0) {
+      mQueuedDiscontinuityCount(0),
+      mSyncFramesOnly(false) {
     setFormat(meta);
 }
 
@@ -183,6 +184,29 @@ status_t AnotherPacketSource::read(
     return mEOSResult;
 }
 
+void AnotherPacketSource::setSyncFramesOnly(bool syncFramesOnly) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (syncFramesOnly == mSyncFramesOnly) {
+        return;
+    }
+
+    mSyncFramesOnly = syncFramesOnly;
+    if (!syncFramesOnly) {
+        return;
+    }
+
+    List<sp<ABuffer> >::iterator it = mBuffers.begin();
+    while (it != mBuffers.end()) {
+        int32_t isSync;
+        if ((*it)->meta()->findInt32("isSync", &isSync) && !isSync) {
+            it = mBuffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 bool AnotherPacketSource::wasFormatChange(
         int32_t discontinuityType) const {
     if (mIsAudio) {
@@ -209,6 +233,13 @@ void AnotherPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
     ALOGV("queueAccessUnit timeUs=%" PRIi64 " us (%.2f secs)", mLastQueuedTimeUs, mLastQueuedTimeUs / 1E6);
 
     Mutex::Autolock autoLock(mLock);
+
+    int32_t isSync;
+    if (mSyncFramesOnly
+            && buffer->meta()->findInt32("isSync", &isSync) && !isSync) {
+        return;
+    }
+
     mBuffers.push_back(buffer);
     mCondition.signal();
 
@@ -64,6 +64,10 @@ struct AnotherPacketSource : public MediaSource {
 
     status_t dequeueAccessUnit(sp<ABuffer> *buffer);
 
+    // While set, access units marked as not being sync frames ("isSync" of
+    // 0) are dropped as they are queued, and those already queued go too.
+    void setSyncFramesOnly(bool syncFramesOnly);
+
     bool isFinished(int64_t duration) const;
 
     sp<AMessage> getLatestEnqueuedMeta();
@@ -86,6 +90,7 @@ private:
     sp<AMessage> mLatestDequeuedMeta;
 
     size_t  mQueuedDiscontinuityCount;
+    bool mSyncFramesOnly;
 
     bool wasFormatChange(int32_t discontinuityType) const;
     int64_t getBufferedDurationUs_l(status_t *finalResult);
@@ -968,6 +968,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
     const uint8_t *nalStart;
     size_t nalSize;
     bool foundSlice = false;
+    bool foundIDR = false;
     while ((err = getNextNALUnit(&data, &size, &nalStart, &nalSize)) == OK) {
         if (nalSize == 0) continue;
 
@@ -1011,6 +1012,10 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
 
                 unsigned nalType = mBuffer->data()[pos.nalOffset] & 0x1f;
 
+                if (nalType == 5) {
+                    foundIDR = true;
+                }
+
                 if (nalType == 6) {
                     sp<ABuffer> sei = new ABuffer(pos.nalSize);
                     memcpy(sei->data(), mBuffer->data() + pos.nalOffset, pos.nalSize);
@@ -1052,6 +1057,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
             CHECK_GE(timeUs, 0ll);
 
             accessUnit->meta()->setInt64("timeUs", timeUs);
+            accessUnit->meta()->setInt32("isSync", foundIDR);
 
             if (mFormat == NULL) {
                 mFormat = MakeAVCCodecSpecificData(accessUnit);
@@ -1184,6 +1190,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGVideo() {
     size_t size = mBuffer->size();
 
     bool sawPictureStart = false;
+    bool isIntraPicture = false;
     int pprevStartCode = -1;
     int prevStartCode = -1;
     int currentStartCode = -1;
@@ -1254,6 +1261,11 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGVideo() {
 
             if (!sawPictureStart) {
                 sawPictureStart = true;
+
+                // picture_coding_type follows the 10 bit temporal_reference.
+                if (offset + 5 < size) {
+                    isIntraPicture = ((data[offset + 5] >> 3) & 7) == 1;
+                }
             } else {
                 sp<ABuffer> accessUnit = new ABuffer(offset);
                 memcpy(accessUnit->data(), data, offset);
@@ -1270,6 +1282,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGVideo() {
                 offset = 0;
 
                 accessUnit->meta()->setInt64("timeUs", timeUs);
+                accessUnit->meta()->setInt32("isSync", isIntraPicture);
 
                 ALOGV("returning MPEG video access unit at time %" PRId64 " us",
                       timeUs);
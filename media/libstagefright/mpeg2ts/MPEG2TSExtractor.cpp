@@ -91,6 +91,12 @@ status_t MPEG2TSSource::read(
         return ERROR_UNSUPPORTED;
     }
 
+    if (options != NULL) {
+        // Applied before feeding more data, access units that are not
+        // wanted are dropped as soon as the parser has them.
+        mImpl->setSyncFramesOnly(options->getSyncFramesOnly());
+    }
+
     status_t finalResult;
     while (!mImpl->hasBufferAvailable(&finalResult)) {
         if (finalResult != OK) {
@@ -11,6 +11,7 @@ LOCAL_SRC_FILES:=                     \
         OMXMaster.cpp                 \
         OMXNodeInstance.cpp           \
         SimpleSoftOMXComponent.cpp    \
+        SoftOMXBatchCodec.cpp         \
         SoftOMXComponent.cpp          \
         SoftOMXPlugin.cpp             \
         SoftVideoDecoderOMXComponent.cpp \
@@ -60,24 +60,41 @@ private:
 struct OMX::CallbackDispatcher : public RefBase {
     CallbackDispatcher(OMXNodeInstance *owner);
 
+    // An EMPTY_BUFFER_DONE may be held back for a little while, so that it
+    // reaches an observer in another process together with the
+    // FILL_BUFFER_DONE that follows it, see isDeferrable_l().
     void post(const omx_message &msg);
 
+    // Keep count of the buffers the component holds. Buffers are counted in
+    // before they are handed over, as they may come back before the call
+    // returns, and counted out again if the component refuses them.
+    void onBuffersQueued(size_t numInput, size_t numOutput);
+    void onBuffersRejected(size_t numInput, size_t numOutput);
+
     bool loop();
 
 protected:
     virtual ~CallbackDispatcher();
 
 private:
+    static const nsecs_t kMaxDeferralNs = 2000000ll;
+
     Mutex mLock;
 
     OMXNodeInstance *mOwner;
     bool mDone;
+    bool mBatches;
+    bool mRealTimeQueued;
+    size_t mInputBuffersHeld;
+    size_t mOutputBuffersHeld;
     Condition mQueueChanged;
     List<omx_message> mQueue;
 
     sp<CallbackDispatcherThread> mThread;
 
-    void dispatch(const omx_message &msg);
+    void dispatch(const List<omx_message> &messages);
+
+    bool isDeferrable_l(const omx_message &msg);
 
     CallbackDispatcher(const CallbackDispatcher &);
     CallbackDispatcher &operator=(const CallbackDispatcher &);
@@ -85,7 +102,14 @@ private:
 
 OMX::CallbackDispatcher::CallbackDispatcher(OMXNodeInstance *owner)
     : mOwner(owner),
-      mDone(false) {
+      mDone(false),
+      mRealTimeQueued(false),
+      mInputBuffersHeld(0),
+      mOutputBuffersHeld(0) {
+    // Holding messages back only pays when delivering them is a binder
+    // transaction.
+    mBatches = owner->observer()->asBinder()->localBinder() == NULL;
+
     mThread = new CallbackDispatcherThread(this);
     mThread->run("OMXCallbackDisp", ANDROID_PRIORITY_FOREGROUND);
 }
@@ -108,24 +132,74 @@ OMX::CallbackDispatcher::~CallbackDispatcher() {
     }
 }
 
+void OMX::CallbackDispatcher::onBuffersQueued(
+        size_t numInput, size_t numOutput) {
+    Mutex::Autolock autoLock(mLock);
+
+    mInputBuffersHeld += numInput;
+    mOutputBuffersHeld += numOutput;
+}
+
+void OMX::CallbackDispatcher::onBuffersRejected(
+        size_t numInput, size_t numOutput) {
+    Mutex::Autolock autoLock(mLock);
+
+    mInputBuffersHeld = mInputBuffersHeld > numInput
+        ? mInputBuffersHeld - numInput : 0;
+    mOutputBuffersHeld = mOutputBuffersHeld > numOutput
+        ? mOutputBuffersHeld - numOutput : 0;
+}
+
+bool OMX::CallbackDispatcher::isDeferrable_l(const omx_message &msg) {
+    // Buffers the component returns on its own, such as those of a surface
+    // input, were never counted in. Clamping errs towards not deferring.
+    if (msg.type == omx_message::EMPTY_BUFFER_DONE) {
+        if (mInputBuffersHeld > 0) {
+            --mInputBuffersHeld;
+        }
+    } else if (msg.type == omx_message::FILL_BUFFER_DONE) {
+        if (mOutputBuffersHeld > 0) {
+            --mOutputBuffersHeld;
+        }
+    }
+
+    // Holding an input buffer back is only free while the component has
+    // other input to work on and an output buffer to return, which then
+    // carries it along. Otherwise the client may be waiting for exactly this
+    // buffer before anything else can happen.
+    return mBatches
+        && msg.type == omx_message::EMPTY_BUFFER_DONE
+        && mInputBuffersHeld > 0
+        && mOutputBuffersHeld > 0;
+}
+
 void OMX::CallbackDispatcher::post(const omx_message &msg) {
     Mutex::Autolock autoLock(mLock);
 
+    if (!isDeferrable_l(msg)) {
+        mRealTimeQueued = true;
+    }
+
     mQueue.push_back(msg);
-    mQueueChanged.signal();
+
+    // A message held back only needs to wake the loop into waiting for
+    // the rest.
+    if (mRealTimeQueued || mQueue.size() == 1) {
+        mQueueChanged.signal();
+    }
 }
 
-void OMX::CallbackDispatcher::dispatch(const omx_message &msg) {
+void OMX::CallbackDispatcher::dispatch(const List<omx_message> &messages) {
     if (mOwner == NULL) {
         ALOGV("Would have dispatched a message to a node that's already gone.");
         return;
     }
-    mOwner->onMessage(msg);
+    mOwner->onMessages(messages);
 }
 
 bool OMX::CallbackDispatcher::loop() {
     for (;;) {
-        omx_message msg;
+        List<omx_message> messages;
 
         {
             Mutex::Autolock autoLock(mLock);
@@ -133,15 +207,26 @@ bool OMX::CallbackDispatcher::loop() {
                 mQueueChanged.wait(mLock);
             }
 
+            nsecs_t deadline = systemTime() + kMaxDeferralNs;
+            while (!mDone && !mRealTimeQueued) {
+                nsecs_t remaining = deadline - systemTime();
+                if (remaining <= 0
+                        || mQueueChanged.waitRelative(mLock, remaining)
+                                == TIMED_OUT) {
+                    break;
+                }
+            }
+
             if (mDone) {
                 break;
             }
 
-            msg = *mQueue.begin();
-            mQueue.erase(mQueue.begin());
+            messages = mQueue;
+            mQueue.clear();
+            mRealTimeQueued = false;
         }
 
-        dispatch(msg);
+        dispatch(messages);
     }
 
     return false;
@@ -401,7 +486,17 @@ status_t OMX::freeBuffer(node_id node, OMX_U32 port_index, buffer_id buffer) {
 }
 
 status_t OMX::fillBuffer(node_id node, buffer_id buffer) {
-    return findInstance(node)->fillBuffer(buffer);
+    sp<OMX::CallbackDispatcher> callbackDispatcher = findDispatcher(node);
+    if (callbackDispatcher != NULL) {
+        callbackDispatcher->onBuffersQueued(0 /* numInput */, 1 /* numOutput */);
+    }
+
+    status_t err = findInstance(node)->fillBuffer(buffer);
+
+    if (err != OK && callbackDispatcher != NULL) {
+        callbackDispatcher->onBuffersRejected(0 /* numInput */, 1 /* numOutput */);
+    }
+    return err;
 }
 
 status_t OMX::emptyBuffer(
@@ -409,8 +504,68 @@ status_t OMX::emptyBuffer(
         buffer_id buffer,
         OMX_U32 range_offset, OMX_U32 range_length,
         OMX_U32 flags, OMX_TICKS timestamp) {
-    return findInstance(node)->emptyBuffer(
+    sp<OMX::CallbackDispatcher> callbackDispatcher = findDispatcher(node);
+    if (callbackDispatcher != NULL) {
+        callbackDispatcher->onBuffersQueued(1 /* numInput */, 0 /* numOutput */);
+    }
+
+    status_t err = findInstance(node)->emptyBuffer(
             buffer, range_offset, range_length, flags, timestamp);
+
+    if (err != OK && callbackDispatcher != NULL) {
+        callbackDispatcher->onBuffersRejected(1 /* numInput */, 0 /* numOutput */);
+    }
+    return err;
+}
+
+status_t OMX::submitBuffers(
+        node_id node, const Vector<BufferOp> &ops) {
+    OMXNodeInstance *instance = findInstance(node);
+    sp<OMX::CallbackDispatcher> callbackDispatcher = findDispatcher(node);
+
+    size_t numInput = 0;
+    size_t numOutput = 0;
+    for (size_t i = 0; i < ops.size(); ++i) {
+        if (ops[i].mType == BufferOp::FILL) {
+            ++numOutput;
+        } else if (ops[i].mType == BufferOp::EMPTY) {
+            ++numInput;
+        }
+    }
+    if (callbackDispatcher != NULL) {
+        callbackDispatcher->onBuffersQueued(numInput, numOutput);
+    }
+
+    for (size_t i = 0; i < ops.size(); ++i) {
+        const BufferOp &op = ops[i];
+
+        status_t err;
+        if (op.mType == BufferOp::FILL) {
+            err = instance->fillBuffer(op.mBuffer);
+            if (err == OK) {
+                --numOutput;
+            }
+        } else if (op.mType == BufferOp::EMPTY) {
+            err = instance->emptyBuffer(
+                    op.mBuffer, op.mRangeOffset, op.mRangeLength,
+                    op.mFlags, op.mTimestamp);
+            if (err == OK) {
+                --numInput;
+            }
+        } else {
+            err = BAD_VALUE;
+        }
+
+        if (err != OK) {
+            // This one and the ones after it never reached the component.
+            if (callbackDispatcher != NULL) {
+                callbackDispatcher->onBuffersRejected(numInput, numOutput);
+            }
+            return err;
+        }
+    }
+
+    return OK;
 }
 
 status_t OMX::getExtensionIndex(
@@ -1159,7 +1159,31 @@ status_t OMXNodeInstance::setInternalOption(
     }
 }
 
-void OMXNodeInstance::onMessage(const omx_message &msg) {
+void OMXNodeInstance::onMessages(const List<omx_message> &messages) {
+    List<omx_message> forwarded;
+
+    for (List<omx_message>::const_iterator it = messages.begin();
+            it != messages.end(); ++it) {
+        omx_message msg = *it;
+        if (handleMessage(msg)) {
+            forwarded.push_back(msg);
+        }
+    }
+
+    if (forwarded.empty()) {
+        return;
+    }
+
+    if (++forwarded.begin() == forwarded.end()) {
+        mObserver->onMessage(*forwarded.begin());
+    } else {
+        mObserver->onMessages(forwarded);
+    }
+}
+
+// Returns whether the observer is to be told about "msg", which may be
+// updated for it.
+bool OMXNodeInstance::handleMessage(omx_message &msg) {
     const sp<GraphicBufferSource>& bufferSource(getGraphicBufferSource());
 
     if (msg.type == omx_message::FILL_BUFFER_DONE) {
@@ -1185,10 +1209,7 @@ void OMXNodeInstance::onMessage(const omx_message &msg) {
             // fix up the buffer info (especially timestamp) if needed
             bufferSource->codecBufferFilled(buffer);
 
-            omx_message newMsg = msg;
-            newMsg.u.extended_buffer_data.timestamp = buffer->nTimeStamp;
-            mObserver->onMessage(newMsg);
-            return;
+            msg.u.extended_buffer_data.timestamp = buffer->nTimeStamp;
         }
     } else if (msg.type == omx_message::EMPTY_BUFFER_DONE) {
         OMX_BUFFERHEADERTYPE *buffer =
@@ -1209,11 +1230,11 @@ void OMXNodeInstance::onMessage(const omx_message &msg) {
             // know that anyone asked to have the buffer emptied and will
             // be very confused.
             bufferSource->codecBufferEmptied(buffer);
-            return;
+            return false;
         }
     }
 
-    mObserver->onMessage(msg);
+    return true;
 }
 
 void OMXNodeInstance::onObserverDied(OMXMaster *master) {
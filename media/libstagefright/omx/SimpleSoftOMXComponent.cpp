@@ -354,39 +354,89 @@ void SimpleSoftOMXComponent::onMessageReceived(const sp<AMessage> &msg) {
 
             CHECK(mState == OMX_StateExecuting && mTargetState == mState);
 
-            bool found = false;
-            size_t portIndex = (kWhatEmptyThisBuffer == msgType)?
-                    header->nInputPortIndex: header->nOutputPortIndex;
-            PortInfo *port = &mPorts.editItemAt(portIndex);
+            onQueueFilled(
+                    queueBuffer(header, msgType == kWhatEmptyThisBuffer));
+            break;
+        }
+
+        default:
+            TRESPASS();
+            break;
+    }
+}
+
+OMX_U32 SimpleSoftOMXComponent::queueBuffer(
+        OMX_BUFFERHEADERTYPE *header, bool isInput) {
+    OMX_U32 portIndex =
+        isInput ? header->nInputPortIndex : header->nOutputPortIndex;
+    CHECK_LT(portIndex, mPorts.size());
 
-            for (size_t j = 0; j < port->mBuffers.size(); ++j) {
-                BufferInfo *buffer = &port->mBuffers.editItemAt(j);
+    PortInfo *port = &mPorts.editItemAt(portIndex);
 
-                if (buffer->mHeader == header) {
-                    CHECK(!buffer->mOwnedByUs);
+    for (size_t j = 0; j < port->mBuffers.size(); ++j) {
+        BufferInfo *buffer = &port->mBuffers.editItemAt(j);
 
-                    buffer->mOwnedByUs = true;
+        if (buffer->mHeader == header) {
+            CHECK(!buffer->mOwnedByUs);
 
-                    CHECK((msgType == kWhatEmptyThisBuffer
-                            && port->mDef.eDir == OMX_DirInput)
-                            || (port->mDef.eDir == OMX_DirOutput));
+            buffer->mOwnedByUs = true;
 
-                    port->mQueue.push_back(buffer);
-                    onQueueFilled(portIndex);
+            CHECK((isInput && port->mDef.eDir == OMX_DirInput)
+                    || (port->mDef.eDir == OMX_DirOutput));
 
-                    found = true;
-                    break;
-                }
+            port->mQueue.push_back(buffer);
+
+            return portIndex;
+        }
+    }
+
+    TRESPASS();
+    return portIndex;
+}
+
+OMX_ERRORTYPE SimpleSoftOMXComponent::processBuffers(
+        OMX_BUFFERHEADERTYPE **inputs, size_t numInputs,
+        OMX_BUFFERHEADERTYPE **outputs, size_t numOutputs) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mState != OMX_StateExecuting || mTargetState != mState) {
+        return OMX_ErrorIncorrectStateOperation;
+    }
+
+    for (size_t i = 0; i < numInputs; ++i) {
+        queueBuffer(inputs[i], true /* isInput */);
+    }
+    for (size_t i = 0; i < numOutputs; ++i) {
+        queueBuffer(outputs[i], false /* isInput */);
+    }
+
+    // Codecs return from onQueueFilled once they run out of either input or
+    // output buffers, or have to wait for the client (e.g. after a port
+    // settings change). Keep going for as long as that consumes buffers.
+    size_t numQueued = 0;
+    for (size_t i = 0; i < mPorts.size(); ++i) {
+        numQueued += mPorts.itemAt(i).mQueue.size();
+    }
+
+    for (;;) {
+        for (size_t i = 0; i < mPorts.size(); ++i) {
+            if (!mPorts.itemAt(i).mQueue.empty()) {
+                onQueueFilled(i);
             }
+        }
 
-            CHECK(found);
-            break;
+        size_t stillQueued = 0;
+        for (size_t i = 0; i < mPorts.size(); ++i) {
+            stillQueued += mPorts.itemAt(i).mQueue.size();
         }
 
-        default:
-            TRESPASS();
+        if (stillQueued == 0 || stillQueued >= numQueued) {
             break;
+        }
+        numQueued = stillQueued;
     }
+
+    return OMX_ErrorNone;
 }
 
 void SimpleSoftOMXComponent::onSendCommand(
@@ -0,0 +1,614 @@
+/*
+ * Copyright (C) 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SoftOMXBatchCodec"
+#include <utils/Log.h>
+
+#include "include/SoftOMXBatchCodec.h"
+
+#include "SoftOMXPlugin.h"
+#include "include/SoftOMXComponent.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace android {
+
+static const OMX_U32 kPortIndexInput = 0;
+static const OMX_U32 kPortIndexOutput = 1;
+
+template<class T>
+static void InitOMXParams(T *params) {
+    params->nSize = sizeof(T);
+    params->nVersion.s.nVersionMajor = 1;
+    params->nVersion.s.nVersionMinor = 0;
+    params->nVersion.s.nRevision = 0;
+    params->nVersion.s.nStep = 0;
+}
+
+// static
+OMX_CALLBACKTYPE SoftOMXBatchCodec::kCallbacks = {
+    &OnEvent, &OnEmptyBufferDone, &OnFillBufferDone
+};
+
+SoftOMXBatchCodec::SoftOMXBatchCodec()
+    : mPlugin(NULL),
+      mHandle(NULL),
+      mComponent(NULL),
+      mState(OMX_StateLoaded),
+      mPendingCommand(false),
+      mPendingCmd(OMX_CommandStateSet),
+      mPendingParam(0),
+      mPortSettingsChanged(false),
+      mSawOutputEOS(false),
+      mError(OK),
+      mOutputs(NULL) {
+}
+
+SoftOMXBatchCodec::~SoftOMXBatchCodec() {
+    if (mHandle != NULL) {
+        if (mState != OMX_StateLoaded) {
+            stop();
+        }
+
+        mPlugin->destroyComponentInstance(mHandle);
+        mHandle = NULL;
+        mComponent = NULL;
+    }
+
+    delete mPlugin;
+    mPlugin = NULL;
+}
+
+status_t SoftOMXBatchCodec::init(const char *componentName) {
+    CHECK(mHandle == NULL);
+
+    mPlugin = new SoftOMXPlugin;
+
+    OMX_ERRORTYPE err = mPlugin->makeComponentInstance(
+            componentName, &kCallbacks, this, &mHandle);
+
+    if (err != OMX_ErrorNone) {
+        ALOGE("unable to instantiate %s (err %d)", componentName, err);
+        mHandle = NULL;
+        return NAME_NOT_FOUND;
+    }
+
+    mComponent = (SoftOMXComponent *)mHandle->pComponentPrivate;
+
+    return OK;
+}
+
+OMX_ERRORTYPE SoftOMXBatchCodec::getParameter(
+        OMX_INDEXTYPE index, OMX_PTR params) {
+    return OMX_GetParameter(mHandle, index, params);
+}
+
+OMX_ERRORTYPE SoftOMXBatchCodec::setParameter(
+        OMX_INDEXTYPE index, const OMX_PTR params) {
+    CHECK_EQ((int)mState, (int)OMX_StateLoaded);
+    return OMX_SetParameter(mHandle, index, params);
+}
+
+status_t SoftOMXBatchCodec::start() {
+    CHECK(mHandle != NULL);
+    CHECK_EQ((int)mState, (int)OMX_StateLoaded);
+
+    status_t err = sendCommand(OMX_CommandStateSet, OMX_StateIdle);
+
+    if (err == OK) {
+        err = allocateBuffers(kPortIndexInput);
+    }
+    if (err == OK) {
+        err = allocateBuffers(kPortIndexOutput);
+    }
+    if (err == OK) {
+        err = waitForCommand();
+    }
+    if (err != OK) {
+        return err;
+    }
+    mState = OMX_StateIdle;
+
+    err = sendCommand(OMX_CommandStateSet, OMX_StateExecuting);
+    if (err == OK) {
+        err = waitForCommand();
+    }
+    if (err != OK) {
+        return err;
+    }
+    mState = OMX_StateExecuting;
+
+    return OK;
+}
+
+status_t SoftOMXBatchCodec::stop() {
+    status_t err = OK;
+
+    if (mState == OMX_StateExecuting) {
+        // The component returns all buffers before completing the transition.
+        err = sendCommand(OMX_CommandStateSet, OMX_StateIdle);
+        if (err == OK) {
+            err = waitForCommand();
+        }
+        if (err != OK) {
+            return err;
+        }
+        mState = OMX_StateIdle;
+    }
+
+    if (mState == OMX_StateIdle) {
+        err = sendCommand(OMX_CommandStateSet, OMX_StateLoaded);
+        if (err == OK) {
+            err = freeBuffers(kPortIndexInput);
+        }
+        if (err == OK) {
+            err = freeBuffers(kPortIndexOutput);
+        }
+        if (err == OK) {
+            err = waitForCommand();
+        }
+        if (err != OK) {
+            return err;
+        }
+        mState = OMX_StateLoaded;
+    }
+
+    return OK;
+}
+
+status_t SoftOMXBatchCodec::process(
+        const Vector<sp<ABuffer> > &inputs, bool eos,
+        Vector<sp<ABuffer> > *outputs) {
+    CHECK_EQ((int)mState, (int)OMX_StateExecuting);
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mOutputs = outputs;
+    }
+
+    Vector<OMX_BUFFERHEADERTYPE *> inHeaders;
+    Vector<OMX_BUFFERHEADERTYPE *> outHeaders;
+
+    size_t numQueued = 0;
+    bool signalledEOS = false;
+    status_t err = OK;
+
+    for (;;) {
+        bool portSettingsChanged;
+        {
+            Mutex::Autolock autoLock(mLock);
+            err = mError;
+            portSettingsChanged = mPortSettingsChanged;
+        }
+
+        if (err != OK) {
+            break;
+        }
+
+        if (portSettingsChanged) {
+            err = reconfigureOutputPort();
+            if (err != OK) {
+                break;
+            }
+            continue;
+        }
+
+        inHeaders.clear();
+        outHeaders.clear();
+
+        size_t numOutputs;
+        size_t numFreeInputs;
+        {
+            Mutex::Autolock autoLock(mLock);
+
+            Vector<BufferInfo> &inBuffers = mBuffers[kPortIndexInput];
+            for (size_t i = 0; i < inBuffers.size(); ++i) {
+                BufferInfo *info = &inBuffers.editItemAt(i);
+                if (!info->mOwnedByUs) {
+                    continue;
+                }
+
+                OMX_BUFFERHEADERTYPE *header = info->mHeader;
+
+                if (numQueued < inputs.size()) {
+                    const sp<ABuffer> &buffer = inputs.itemAt(numQueued);
+
+                    if (buffer->size() > header->nAllocLen) {
+                        ALOGE("input buffer of %zu bytes exceeds %u",
+                                buffer->size(), header->nAllocLen);
+                        err = BAD_VALUE;
+                        break;
+                    }
+
+                    int64_t timeUs = 0ll;
+                    buffer->meta()->findInt64("timeUs", &timeUs);
+
+                    int32_t isCSD;
+                    uint32_t flags = 0;
+                    if (buffer->meta()->findInt32("csd", &isCSD) && isCSD) {
+                        flags |= OMX_BUFFERFLAG_CODECCONFIG;
+                    }
+
+                    ++numQueued;
+                    if (eos && numQueued == inputs.size()) {
+                        flags |= OMX_BUFFERFLAG_EOS;
+                        signalledEOS = true;
+                    }
+
+                    memcpy(header->pBuffer, buffer->data(), buffer->size());
+                    header->nOffset = 0;
+                    header->nFilledLen = buffer->size();
+                    header->nTimeStamp = timeUs;
+                    header->nFlags = flags;
+                } else if (eos && !signalledEOS) {
+                    header->nOffset = 0;
+                    header->nFilledLen = 0;
+                    header->nTimeStamp = 0;
+                    header->nFlags = OMX_BUFFERFLAG_EOS;
+                    signalledEOS = true;
+                } else {
+                    break;
+                }
+
+                info->mOwnedByUs = false;
+                inHeaders.push(header);
+            }
+
+            Vector<BufferInfo> &outBuffers = mBuffers[kPortIndexOutput];
+            for (size_t i = 0; i < outBuffers.size(); ++i) {
+                BufferInfo *info = &outBuffers.editItemAt(i);
+                if (!info->mOwnedByUs) {
+                    continue;
+                }
+
+                // So that a buffer handed back unused, e.g. on a port
+                // disable, isn't mistaken for output.
+                info->mHeader->nOffset = 0;
+                info->mHeader->nFilledLen = 0;
+                info->mHeader->nFlags = 0;
+
+                info->mOwnedByUs = false;
+                outHeaders.push(info->mHeader);
+            }
+
+            numOutputs = outputs->size();
+            numFreeInputs = countOwnedByUs(kPortIndexInput);
+        }
+
+        if (err != OK) {
+            break;
+        }
+
+        OMX_ERRORTYPE omxErr = mComponent->processBuffers(
+                inHeaders.editArray(), inHeaders.size(),
+                outHeaders.editArray(), outHeaders.size());
+
+        if (omxErr != OMX_ErrorNone) {
+            ALOGE("processBuffers failed (err %d)", omxErr);
+            err = UNKNOWN_ERROR;
+            break;
+        }
+
+        Mutex::Autolock autoLock(mLock);
+
+        if (mError != OK || mPortSettingsChanged) {
+            continue;
+        }
+
+        if (eos && mSawOutputEOS) {
+            break;
+        }
+
+        bool progress = outputs->size() > numOutputs
+                || countOwnedByUs(kPortIndexInput) > numFreeInputs;
+
+        // Without EOS, stop once the codec sits on what it has been given;
+        // it may hold back input until it sees more.
+        if (!eos && numQueued == inputs.size() && !progress) {
+            break;
+        }
+
+        if (!progress && inHeaders.isEmpty()) {
+            ALOGE("codec stalled with %zu of %zu input buffers queued",
+                    numQueued, inputs.size());
+            err = UNKNOWN_ERROR;
+            break;
+        }
+    }
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mOutputs = NULL;
+    }
+
+    if (err == OK && eos) {
+        // Leave the codec ready for the next stream.
+        err = sendCommand(OMX_CommandFlush, OMX_ALL);
+        if (err == OK) {
+            err = waitForCommand();
+        }
+
+        Mutex::Autolock autoLock(mLock);
+        mSawOutputEOS = false;
+    }
+
+    return err;
+}
+
+status_t SoftOMXBatchCodec::sendCommand(OMX_COMMANDTYPE cmd, OMX_U32 param) {
+    {
+        Mutex::Autolock autoLock(mLock);
+        CHECK(!mPendingCommand);
+
+        mPendingCommand = true;
+        mPendingCmd = cmd;
+        mPendingParam = param;
+    }
+
+    OMX_ERRORTYPE err = OMX_SendCommand(mHandle, cmd, param, NULL);
+
+    if (err != OMX_ErrorNone) {
+        Mutex::Autolock autoLock(mLock);
+        mPendingCommand = false;
+        return UNKNOWN_ERROR;
+    }
+
+    return OK;
+}
+
+status_t SoftOMXBatchCodec::waitForCommand() {
+    Mutex::Autolock autoLock(mLock);
+
+    while (mPendingCommand && mError == OK) {
+        mCondition.wait(mLock);
+    }
+
+    return mError;
+}
+
+status_t SoftOMXBatchCodec::allocateBuffers(OMX_U32 portIndex) {
+    OMX_PARAM_PORTDEFINITIONTYPE def;
+    InitOMXParams(&def);
+    def.nPortIndex = portIndex;
+
+    if (OMX_GetParameter(mHandle, OMX_IndexParamPortDefinition, &def)
+            != OMX_ErrorNone) {
+        return UNKNOWN_ERROR;
+    }
+
+    if (!def.bEnabled) {
+        return OK;
+    }
+
+    for (OMX_U32 i = 0; i < def.nBufferCountActual; ++i) {
+        OMX_BUFFERHEADERTYPE *header;
+        OMX_ERRORTYPE err = OMX_AllocateBuffer(
+                mHandle, &header, portIndex, NULL, def.nBufferSize);
+
+        if (err != OMX_ErrorNone) {
+            ALOGE("allocating buffer %u on port %u failed (err %d)",
+                    i, portIndex, err);
+            return NO_MEMORY;
+        }
+
+        Mutex::Autolock autoLock(mLock);
+
+        BufferInfo info;
+        info.mHeader = header;
+        info.mOwnedByUs = true;
+        mBuffers[portIndex].push(info);
+    }
+
+    return OK;
+}
+
+status_t SoftOMXBatchCodec::freeBuffers(OMX_U32 portIndex) {
+    Vector<BufferInfo> buffers;
+    {
+        Mutex::Autolock autoLock(mLock);
+        buffers = mBuffers[portIndex];
+        mBuffers[portIndex].clear();
+    }
+
+    status_t err = OK;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        CHECK(buffers.itemAt(i).mOwnedByUs);
+
+        if (OMX_FreeBuffer(mHandle, portIndex, buffers.itemAt(i).mHeader)
+                != OMX_ErrorNone) {
+            err = UNKNOWN_ERROR;
+        }
+    }
+
+    return err;
+}
+
+status_t SoftOMXBatchCodec::waitForBuffersReturned(OMX_U32 portIndex) {
+    Mutex::Autolock autoLock(mLock);
+
+    while (mError == OK
+            && countOwnedByUs(portIndex) < mBuffers[portIndex].size()) {
+        mCondition.wait(mLock);
+    }
+
+    return mError;
+}
+
+status_t SoftOMXBatchCodec::reconfigureOutputPort() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mPortSettingsChanged = false;
+    }
+
+    status_t err = sendCommand(OMX_CommandPortDisable, kPortIndexOutput);
+    if (err == OK) {
+        err = waitForBuffersReturned(kPortIndexOutput);
+    }
+    if (err == OK) {
+        err = freeBuffers(kPortIndexOutput);
+    }
+    if (err == OK) {
+        err = waitForCommand();
+    }
+    if (err != OK) {
+        return err;
+    }
+
+    err = sendCommand(OMX_CommandPortEnable, kPortIndexOutput);
+    if (err == OK) {
+        err = allocateBuffers(kPortIndexOutput);
+    }
+    if (err == OK) {
+        err = waitForCommand();
+    }
+
+    return err;
+}
+
+size_t SoftOMXBatchCodec::countOwnedByUs(OMX_U32 portIndex) const {
+    const Vector<BufferInfo> &buffers = mBuffers[portIndex];
+
+    size_t n = 0;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        if (buffers.itemAt(i).mOwnedByUs) {
+            ++n;
+        }
+    }
+
+    return n;
+}
+
+SoftOMXBatchCodec::BufferInfo *SoftOMXBatchCodec::findBuffer(
+        OMX_U32 portIndex, OMX_BUFFERHEADERTYPE *header) {
+    Vector<BufferInfo> &buffers = mBuffers[portIndex];
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        BufferInfo *info = &buffers.editItemAt(i);
+        if (info->mHeader == header) {
+            CHECK(!info->mOwnedByUs);
+            return info;
+        }
+    }
+
+    TRESPASS();
+    return NULL;
+}
+
+void SoftOMXBatchCodec::onEvent(
+        OMX_EVENTTYPE event, OMX_U32 data1, OMX_U32 data2) {
+    Mutex::Autolock autoLock(mLock);
+
+    switch (event) {
+        case OMX_EventCmdComplete:
+        {
+            if (mPendingCommand
+                    && data1 == (OMX_U32)mPendingCmd
+                    && data2 == mPendingParam) {
+                mPendingCommand = false;
+                mCondition.broadcast();
+            }
+            break;
+        }
+
+        case OMX_EventError:
+        {
+            ALOGE("codec reported error 0x%x", data1);
+            mError = UNKNOWN_ERROR;
+            mCondition.broadcast();
+            break;
+        }
+
+        case OMX_EventPortSettingsChanged:
+        {
+            if (data1 == kPortIndexOutput
+                    && (data2 == 0
+                        || data2 == OMX_IndexParamPortDefinition)) {
+                mPortSettingsChanged = true;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void SoftOMXBatchCodec::onEmptyBufferDone(OMX_BUFFERHEADERTYPE *header) {
+    Mutex::Autolock autoLock(mLock);
+
+    findBuffer(kPortIndexInput, header)->mOwnedByUs = true;
+    mCondition.broadcast();
+}
+
+void SoftOMXBatchCodec::onFillBufferDone(OMX_BUFFERHEADERTYPE *header) {
+    Mutex::Autolock autoLock(mLock);
+
+    findBuffer(kPortIndexOutput, header)->mOwnedByUs = true;
+    mCondition.broadcast();
+
+    bool isEOS = (header->nFlags & OMX_BUFFERFLAG_EOS) != 0;
+    if (mOutputs == NULL || (header->nFilledLen == 0 && !isEOS)) {
+        return;
+    }
+
+    sp<ABuffer> buffer = new ABuffer(header->nFilledLen);
+    memcpy(buffer->data(),
+           header->pBuffer + header->nOffset,
+           header->nFilledLen);
+
+    buffer->meta()->setInt64("timeUs", header->nTimeStamp);
+    if (isEOS) {
+        buffer->meta()->setInt32("eos", true);
+        mSawOutputEOS = true;
+    }
+
+    mOutputs->push(buffer);
+}
+
+// static
+OMX_ERRORTYPE SoftOMXBatchCodec::OnEvent(
+        OMX_IN OMX_HANDLETYPE /* hComponent */,
+        OMX_IN OMX_PTR pAppData,
+        OMX_IN OMX_EVENTTYPE eEvent,
+        OMX_IN OMX_U32 nData1,
+        OMX_IN OMX_U32 nData2,
+        OMX_IN OMX_PTR /* pEventData */) {
+    static_cast<SoftOMXBatchCodec *>(pAppData)->onEvent(eEvent, nData1, nData2);
+    return OMX_ErrorNone;
+}
+
+// static
+OMX_ERRORTYPE SoftOMXBatchCodec::OnEmptyBufferDone(
+        OMX_IN OMX_HANDLETYPE /* hComponent */,
+        OMX_IN OMX_PTR pAppData,
+        OMX_IN OMX_BUFFERHEADERTYPE *pBuffer) {
+    static_cast<SoftOMXBatchCodec *>(pAppData)->onEmptyBufferDone(pBuffer);
+    return OMX_ErrorNone;
+}
+
+// static
+OMX_ERRORTYPE SoftOMXBatchCodec::OnFillBufferDone(
+        OMX_IN OMX_HANDLETYPE /* hComponent */,
+        OMX_IN OMX_PTR pAppData,
+        OMX_IN OMX_BUFFERHEADERTYPE *pBuffer) {
+    static_cast<SoftOMXBatchCodec *>(pAppData)->onFillBufferDone(pBuffer);
+    return OMX_ErrorNone;
+}
+
+}  // namespace android
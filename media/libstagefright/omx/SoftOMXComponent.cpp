@@ -81,6 +81,12 @@ OMX_ERRORTYPE SoftOMXComponent::initCheck() const {
     return OMX_ErrorNone;
 }
 
+OMX_ERRORTYPE SoftOMXComponent::processBuffers(
+        OMX_BUFFERHEADERTYPE ** /* inputs */, size_t /* numInputs */,
+        OMX_BUFFERHEADERTYPE ** /* outputs */, size_t /* numOutputs */) {
+    return OMX_ErrorNotImplemented;
+}
+
 const char *SoftOMXComponent::name() const {
     return mName.c_str();
 }
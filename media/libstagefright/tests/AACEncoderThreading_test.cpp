@@ -0,0 +1,212 @@
+/*
+ * Copyright 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AACEncoderThreading_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+#include <math.h>
+
+#include <binder/ProcessState.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <utils/Vector.h>
+
+#include <OMX_Audio.h>
+
+namespace android {
+
+// 5.1 at 48 kHz, the case segment-parallel encoding is meant for.
+static const int32_t kSampleRate = 48000;
+static const int32_t kNumChannels = 6;
+static const int32_t kBitRate = 64000 * kNumChannels;
+static const int32_t kSeconds = 20;
+static const int32_t kSegmentFrames = 32;
+static const size_t kSamplesPerFrame = 1024;
+
+class AACEncoderThreadingTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        ProcessState::self()->startThreadPool();
+
+        mLooper = new ALooper;
+        mLooper->start();
+    }
+
+    virtual void TearDown() {
+        mLooper->stop();
+    }
+
+    // A few partials per channel drifting in pitch plus some noise, so that
+    // the rate control has to spread bits unevenly over time.
+    static void generatePCM(int64_t firstFrame, size_t numFrames, int16_t *out) {
+        for (size_t i = 0; i < numFrames; ++i) {
+            double t = (double)(firstFrame + i) / kSampleRate;
+            for (int32_t ch = 0; ch < kNumChannels; ++ch) {
+                double f = 110.0 * (ch + 1) * (1.0 + 0.1 * sin(0.3 * t));
+                double v = 0.3 * sin(2 * M_PI * f * t)
+                        + 0.15 * sin(2 * M_PI * 3.01 * f * t);
+
+                uint32_t x = (uint32_t)((firstFrame + i) * 2654435761u + ch * 40503u);
+                x ^= x >> 15;
+                x *= 2246822519u;
+                x ^= x >> 13;
+                v += 0.02 * ((double)(x & 0xffff) / 32768.0 - 1.0);
+
+                *out++ = (int16_t)(v * 32767);
+            }
+        }
+    }
+
+    // Encodes kSeconds of generated PCM on |numThreads| and returns the size
+    // of each access unit, in order.
+    void encode(int32_t numThreads, Vector<size_t> *sizes) {
+        static const int64_t kTimeout = 10000ll;
+
+        sp<AMessage> format = new AMessage;
+        format->setString("mime", MEDIA_MIMETYPE_AUDIO_AAC);
+        format->setInt32("sample-rate", kSampleRate);
+        format->setInt32("channel-count", kNumChannels);
+        format->setInt32("bitrate", kBitRate);
+        format->setInt32("aac-profile", OMX_AUDIO_AACObjectLC);
+        format->setInt32("encode-thread-count", numThreads);
+        format->setInt32("encode-segment-frames", kSegmentFrames);
+
+        sp<MediaCodec> codec = MediaCodec::CreateByComponentName(
+                mLooper, "OMX.google.aac.encoder");
+        ASSERT_TRUE(codec != NULL);
+        ASSERT_EQ(OK, codec->configure(
+                    format, NULL /* surface */, NULL /* crypto */,
+                    MediaCodec::CONFIGURE_FLAG_ENCODE));
+        ASSERT_EQ(OK, codec->start());
+
+        Vector<sp<ABuffer> > inBuffers;
+        ASSERT_EQ(OK, codec->getInputBuffers(&inBuffers));
+
+        size_t bytesPerFrame = kNumChannels * sizeof(int16_t);
+        int64_t totalFrames = (int64_t)kSeconds * kSampleRate;
+        int64_t framesQueued = 0;
+
+        bool signalledInputEOS = false;
+        bool sawOutputEOS = false;
+        while (!sawOutputEOS) {
+            size_t index;
+            status_t err;
+            if (!signalledInputEOS
+                    && codec->dequeueInputBuffer(&index, 0ll) == OK) {
+                const sp<ABuffer> &buffer = inBuffers.itemAt(index);
+
+                size_t numFrames = buffer->capacity() / bytesPerFrame;
+                if (numFrames > (size_t)(totalFrames - framesQueued)) {
+                    numFrames = totalFrames - framesQueued;
+                }
+                generatePCM(framesQueued, numFrames, (int16_t *)buffer->base());
+                int64_t timeUs = framesQueued * 1000000ll / kSampleRate;
+                framesQueued += numFrames;
+
+                uint32_t flags = 0;
+                if (framesQueued == totalFrames) {
+                    flags = MediaCodec::BUFFER_FLAG_EOS;
+                    signalledInputEOS = true;
+                }
+                ASSERT_EQ(OK, codec->queueInputBuffer(
+                            index, 0 /* offset */, numFrames * bytesPerFrame,
+                            timeUs, flags));
+            }
+
+            size_t offset;
+            size_t size;
+            int64_t presentationTimeUs;
+            uint32_t flags;
+            err = codec->dequeueOutputBuffer(
+                    &index, &offset, &size, &presentationTimeUs, &flags,
+                    signalledInputEOS ? kTimeout : 0ll);
+            if (err == OK) {
+                if (size > 0 && !(flags & MediaCodec::BUFFER_FLAG_CODECCONFIG)) {
+                    sizes->push(size);
+                }
+                ASSERT_EQ(OK, codec->releaseOutputBuffer(index));
+                sawOutputEOS = (flags & MediaCodec::BUFFER_FLAG_EOS) != 0;
+            } else if (err != INFO_OUTPUT_BUFFERS_CHANGED
+                    && err != INFO_FORMAT_CHANGED) {
+                ASSERT_EQ(-EAGAIN, err);
+            }
+        }
+
+        ASSERT_EQ(OK, codec->release());
+    }
+
+    // How far the bitrate of kSegmentFrames frames centered on each segment
+    // boundary strays from the configured one, at worst.
+    static double worstBoundaryDeviation(const Vector<size_t> &sizes) {
+        static const double kWindowSeconds =
+            (double)kSegmentFrames * kSamplesPerFrame / kSampleRate;
+
+        double worst = 0;
+        for (size_t boundary = kSegmentFrames;
+                boundary + kSegmentFrames / 2 <= sizes.size();
+                boundary += kSegmentFrames) {
+            size_t numBytes = 0;
+            for (size_t i = boundary - kSegmentFrames / 2;
+                    i < boundary + kSegmentFrames / 2; ++i) {
+                numBytes += sizes.itemAt(i);
+            }
+            double deviation = fabs(numBytes * 8 / kWindowSeconds - kBitRate) / kBitRate;
+            if (deviation > worst) {
+                worst = deviation;
+            }
+        }
+        return worst;
+    }
+
+    sp<ALooper> mLooper;
+};
+
+TEST_F(AACEncoderThreadingTest, BitrateHoldsAcrossSegmentBoundaries) {
+    Vector<size_t> single, parallel;
+    encode(1, &single);
+    encode(4, &parallel);
+
+    ASSERT_GT(single.size(), (size_t)(4 * kSegmentFrames));
+    ASSERT_EQ(single.size(), parallel.size());
+
+    size_t singleBytes = 0, parallelBytes = 0;
+    for (size_t i = 0; i < single.size(); ++i) {
+        singleBytes += single.itemAt(i);
+        parallelBytes += parallel.itemAt(i);
+    }
+
+    // Every segment runs the same rate control at the same bitrate, so the
+    // stream as a whole keeps to it.
+    EXPECT_NEAR(1.0, (double)parallelBytes / singleBytes, 0.02);
+
+    // Around the joins, where the bit reservoir starts over, the bitrate
+    // strays no further from the configured one than the single encoder's
+    // does over the same stretches.
+    double singleDeviation = worstBoundaryDeviation(single);
+    double parallelDeviation = worstBoundaryDeviation(parallel);
+    ALOGI("worst deviation at segment boundaries: %.1f%% on one thread, "
+            "%.1f%% on four", singleDeviation * 100, parallelDeviation * 100);
+    EXPECT_LE(parallelDeviation, singleDeviation + 0.05);
+}
+
+}  // namespace android
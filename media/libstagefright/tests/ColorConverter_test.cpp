@@ -0,0 +1,117 @@
+/*
+ * Copyright 2015 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ColorConverter_test"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/ColorConverter.h>
+#include <media/stagefright/MediaErrors.h>
+
+namespace android {
+
+static const OMX_COLOR_FORMATTYPE kSrcFormats[] = {
+    OMX_COLOR_FormatYUV420Planar,
+    OMX_COLOR_FormatYUV420SemiPlanar,
+    OMX_QCOM_COLOR_FormatYVU420SemiPlanar,
+    OMX_TI_COLOR_FormatYUV420PackedSemiPlanar,
+};
+
+static const OMX_COLOR_FORMATTYPE kDstFormats[] = {
+    OMX_COLOR_Format16bitRGB565,
+    kColorFormatRGBA8888,
+};
+
+class ColorConverterTest : public ::testing::Test {
+protected:
+    // Converts a generated frame of |width| x |height| cropped by |cropLeft|
+    // and |cropTop| on the left and top, to a destination |scale| times
+    // smaller, on one thread and on |maxThreads|, and expects the same
+    // bytes from both.
+    void expectSameOnThreads(
+            size_t width, size_t height, size_t cropLeft, size_t cropTop,
+            size_t scale, size_t maxThreads) {
+        size_t cropWidth = (width - cropLeft) / scale * scale;
+        size_t cropHeight = (height - cropTop) / scale * scale;
+        size_t dstWidth = cropWidth / scale;
+        size_t dstHeight = cropHeight / scale;
+
+        uint8_t *src = new uint8_t[width * height * 3 / 2];
+        uint32_t seed = 1;
+        for (size_t i = 0; i < width * height * 3 / 2; ++i) {
+            seed = seed * 1103515245 + 12345;
+            src[i] = (uint8_t)(seed >> 16);
+        }
+
+        for (size_t f = 0; f < ARRAY_SIZE(kSrcFormats); ++f) {
+            for (size_t d = 0; d < ARRAY_SIZE(kDstFormats); ++d) {
+                size_t dstSize = dstWidth * dstHeight
+                    * (kDstFormats[d] == kColorFormatRGBA8888 ? 4 : 2);
+
+                uint8_t *single = new uint8_t[dstSize];
+                uint8_t *threaded = new uint8_t[dstSize];
+                memset(single, 0xa5, dstSize);
+                memset(threaded, 0x5a, dstSize);
+
+                ColorConverter converter(kSrcFormats[f], kDstFormats[d]);
+                ASSERT_TRUE(converter.isValid());
+
+                for (int pass = 0; pass < 2; ++pass) {
+                    converter.setMaxThreads(pass == 0 ? 1 : maxThreads);
+                    EXPECT_EQ(OK, converter.convert(
+                                src, width, height, cropLeft, cropTop,
+                                cropLeft + cropWidth - 1, cropTop + cropHeight - 1,
+                                pass == 0 ? single : threaded, dstWidth, dstHeight,
+                                0, 0, dstWidth - 1, dstHeight - 1));
+                }
+
+                EXPECT_EQ(0, memcmp(single, threaded, dstSize))
+                        << "format " << f << " to " << d << ", " << width << "x"
+                        << height << ", scale " << scale << ", "
+                        << maxThreads << " threads";
+
+                delete[] threaded;
+                delete[] single;
+            }
+        }
+
+        delete[] src;
+    }
+};
+
+TEST_F(ColorConverterTest, ThreadedMatchesSingle) {
+    // Large enough for the converter to split into its most bands.
+    expectSameOnThreads(1920, 1088, 0, 0, 1, 0);
+    expectSameOnThreads(1920, 1088, 0, 0, 1, 2);
+    expectSameOnThreads(1920, 1088, 0, 0, 1, 3);
+    expectSameOnThreads(1920, 1088, 0, 0, 1, 4);
+}
+
+TEST_F(ColorConverterTest, ThreadedMatchesSingleUnevenBands) {
+    // Bands start on even rows, the last one gets whatever is left over.
+    expectSameOnThreads(1280, 1078, 0, 0, 1, 3);
+    expectSameOnThreads(1920, 1082, 0, 0, 1, 4);
+}
+
+TEST_F(ColorConverterTest, ThreadedMatchesSingleCroppedAndScaled) {
+    expectSameOnThreads(1920, 1088, 16, 8, 1, 4);
+    expectSameOnThreads(3840, 2176, 0, 0, 2, 4);
+}
+
+}  // namespace android
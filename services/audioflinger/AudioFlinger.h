@@ -491,6 +491,7 @@ private:
     class OffloadThread;
     class DuplicatingThread;
     class AsyncCallbackThread;
+    class EffectChainWorker;
     class Track;
     class RecordTrack;
     class EffectModule;
@@ -728,6 +728,30 @@ bool AudioFlinger::EffectModule::isEnabled() const
     }
 }
 
+// Implementations reviewed to hold no state outside the instance.  Effect libraries can share
+// state between all their instances, as the LVM bundle does, and there is no descriptor flag
+// saying they don't, so any other effect keeps its chain processing serially.
+static const effect_uuid_t kConcurrencySafeEffects[] = {
+    // downmix
+    { 0x93f04452, 0xe4fe, 0x41cc, 0x91f9, { 0xe4, 0x75, 0xb6, 0xd1, 0xd6, 0x9f } },
+    // loudness enhancer
+    { 0xfa415329, 0x2034, 0x4bea, 0xb5dc, { 0x5b, 0x38, 0x1c, 0x8d, 0x1e, 0x2c } },
+    // NXP insert environmental reverb
+    { 0xc7a511a0, 0xa3bb, 0x11df, 0x860e, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
+    // NXP insert preset reverb
+    { 0x172cdf00, 0xa3bc, 0x11df, 0xa72f, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
+};
+
+bool AudioFlinger::EffectModule::isConcurrencySafe() const
+{
+    for (size_t i = 0; i < sizeof(kConcurrencySafeEffects) / sizeof(effect_uuid_t); i++) {
+        if (memcmp(&mDescriptor.uuid, &kConcurrencySafeEffects[i], sizeof(effect_uuid_t)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool AudioFlinger::EffectModule::isProcessEnabled() const
 {
     if (mStatus != NO_ERROR) {
@@ -1454,7 +1478,10 @@ void AudioFlinger::EffectHandle::dumpToBuffer(char* buffer, size_t size)
 
 AudioFlinger::EffectChain::EffectChain(ThreadBase *thread,
                                         int sessionId)
-    : mThread(thread), mSessionId(sessionId), mActiveTrackCnt(0), mTrackCnt(0), mTailBufferCount(0),
+    : mThread(thread), mSessionId(sessionId), mInBuffer(NULL), mOutBuffer(NULL),
+      mPrivateOutBuffer(NULL), mPrivateOutSamples(0), mSharedOutBuffer(NULL),
+      mPrivateOutWritten(false),
+      mActiveTrackCnt(0), mTrackCnt(0), mTailBufferCount(0),
       mOwnInBuffer(false), mVolumeCtrlIdx(-1), mLeftVolume(UINT_MAX), mRightVolume(UINT_MAX),
       mNewLeftVolume(UINT_MAX), mNewRightVolume(UINT_MAX), mForceVolume(false), mIsForLPATrack(false)
 {
@@ -1471,6 +1498,7 @@ AudioFlinger::EffectChain::~EffectChain()
     if (mOwnInBuffer) {
         delete mInBuffer;
     }
+    delete[] mPrivateOutBuffer;
 
 }
 
@@ -1602,12 +1630,71 @@ void AudioFlinger::EffectChain::process_l()
         for (size_t i = 0; i < size; i++) {
             mEffects[i]->process();
         }
+        // idle chains leave the private output buffer cleared, see accumulatePrivateOutBuffer_l()
+        mPrivateOutWritten = mPrivateOutBuffer != NULL && size != 0;
     }
     for (size_t i = 0; i < size; i++) {
         mEffects[i]->updateState();
     }
 }
 
+// Must be called with EffectChain::mLock locked
+bool AudioFlinger::EffectChain::isParallelizable_l() const
+{
+    if (mSessionId <= AUDIO_SESSION_OUTPUT_MIX || !mOwnInBuffer || mIsForLPATrack ||
+            mEffects.size() == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < mEffects.size(); i++) {
+        if (!mEffects[i]->isConcurrencySafe()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Must be called with EffectChain::mLock locked
+void AudioFlinger::EffectChain::setPrivateOutBuffer_l(size_t numSamples)
+{
+    if (numSamples == mPrivateOutSamples) {
+        return;
+    }
+    int16_t *sharedOutBuffer = mPrivateOutBuffer != NULL ? mSharedOutBuffer : mOutBuffer;
+    int16_t *oldOutBuffer = mOutBuffer;
+    delete[] mPrivateOutBuffer;
+    mPrivateOutBuffer = NULL;
+    mPrivateOutSamples = 0;
+    mSharedOutBuffer = NULL;
+    mPrivateOutWritten = false;
+    mOutBuffer = sharedOutBuffer;
+    if (numSamples != 0) {
+        mPrivateOutBuffer = new int16_t[numSamples];
+        memset(mPrivateOutBuffer, 0, numSamples * sizeof(int16_t));
+        mPrivateOutSamples = numSamples;
+        mSharedOutBuffer = sharedOutBuffer;
+        mOutBuffer = mPrivateOutBuffer;
+    }
+    // only the last insert effect writes to the chain output buffer
+    size_t size = mEffects.size();
+    if (size != 0 && mEffects[size - 1]->outBuffer() == oldOutBuffer) {
+        mEffects[size - 1]->setOutBuffer(mOutBuffer);
+        mEffects[size - 1]->configure();
+    }
+}
+
+// Must be called with EffectChain::mLock locked
+void AudioFlinger::EffectChain::accumulatePrivateOutBuffer_l()
+{
+    if (!mPrivateOutWritten || mSharedOutBuffer == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < mPrivateOutSamples; i++) {
+        mSharedOutBuffer[i] = clamp16((int32_t)mSharedOutBuffer[i] + (int32_t)mPrivateOutBuffer[i]);
+    }
+    memset(mPrivateOutBuffer, 0, mPrivateOutSamples * sizeof(int16_t));
+    mPrivateOutWritten = false;
+}
+
 // addEffect_l() must be called with PlaybackThread::mLock held
 status_t AudioFlinger::EffectChain::addEffect_l(const sp<EffectModule>& effect)
 {
@@ -124,6 +124,9 @@ public:
     void             unlock() { mLock.unlock(); }
     bool             isOffloadable() const
                         { return (mDescriptor.flags & EFFECT_FLAG_OFFLOAD_SUPPORTED) != 0; }
+    // Whether the implementation is known to keep all its state in the instance, so that
+    // it may process concurrently with instances of the same library in other sessions.
+    bool             isConcurrencySafe() const;
     status_t         setOffloaded(bool offloaded, audio_io_handle_t io);
     bool             isOffloaded() const;
     void             addEffectToHal_l();
@@ -305,12 +308,30 @@ public:
         return mInBuffer;
     }
     void setOutBuffer(int16_t *buffer) {
-        mOutBuffer = buffer;
+        if (mPrivateOutBuffer != NULL) {
+            mSharedOutBuffer = buffer;
+        } else {
+            mOutBuffer = buffer;
+        }
     }
     int16_t *outBuffer() const {
         return mOutBuffer;
     }
 
+    // A chain for an individual session that owns its input buffer only shares its output
+    // buffer with other chains, and so can be processed concurrently with them if its output
+    // is first accumulated into a private buffer and all its effects are concurrency safe.
+    // See PlaybackThread::processEffectChains_l().
+    bool isParallelizable_l() const;
+    // Redirect the chain output to a private buffer of numSamples samples, or back to the
+    // shared output buffer if numSamples is 0.  Reconfigures the last effect as needed.
+    void setPrivateOutBuffer_l(size_t numSamples);
+    bool hasPrivateOutBuffer() const { return mPrivateOutBuffer != NULL; }
+    // Accumulate the private output buffer onto the shared output buffer, and clear it.
+    // Does nothing if the chain did not process since the last call.
+    // Chains must be accumulated in the same order they would be processed serially.
+    void accumulatePrivateOutBuffer_l();
+
     void incTrackCnt() { android_atomic_inc(&mTrackCnt); }
     void decTrackCnt() { android_atomic_dec(&mTrackCnt); }
     int32_t trackCnt() const { return android_atomic_acquire_load(&mTrackCnt); }
@@ -385,7 +406,11 @@ protected:
     Vector< sp<EffectModule> > mEffects; // list of effect modules
     int mSessionId;             // audio session ID
     int16_t *mInBuffer;         // chain input buffer
-    int16_t *mOutBuffer;        // chain output buffer
+    int16_t *mOutBuffer;        // chain output buffer, mPrivateOutBuffer if not NULL
+    int16_t *mPrivateOutBuffer; // private output buffer for concurrent processing, or NULL
+    size_t mPrivateOutSamples;  // number of samples in mPrivateOutBuffer
+    int16_t *mSharedOutBuffer;  // output buffer shared with other chains, if mPrivateOutBuffer
+    bool mPrivateOutWritten;    // mPrivateOutBuffer was written since last accumulated
 
     // 'volatile' here means these are accessed with atomic operations instead of mutex
     volatile int32_t mActiveTrackCnt;    // number of active tracks connected
@@ -168,6 +168,10 @@ void FastCapture::onWork()
                 AudioBufferProvider::kInvalidPTS);
         ATRACE_END();
         dumpState->mReadSequence++;
+        if (framesRead != (ssize_t) frameCount) {
+            logWriter->logEvent(FAST_EVENT_SHORT_READ, (int32_t) frameCount,
+                    (int32_t) framesRead);
+        }
         if (framesRead >= 0) {
             LOG_ALWAYS_FATAL_IF((size_t) framesRead > frameCount);
             totalNativeFramesRead += framesRead;
@@ -219,4 +223,22 @@ FastCaptureDumpState::~FastCaptureDumpState()
 {
 }
 
+void FastCaptureDumpState::dump(int fd) const
+{
+    if (mCommand == FastCaptureState::INITIAL) {
+        dprintf(fd, "  FastCapture not initialized\n");
+        return;
+    }
+    double measuredWarmupMs = (mMeasuredWarmupTs.tv_sec * 1000.0) +
+            (mMeasuredWarmupTs.tv_nsec / 1000000.0);
+    double periodSec = mSampleRate != 0 ? (double) mFrameCount / (double) mSampleRate : 0.0;
+    dprintf(fd, "  FastCapture command=%#x readSequence=%u framesRead=%u readErrors=%u\n"
+                "              underruns=%u overruns=%u sampleRate=%u frameCount=%zu\n"
+                "              measuredWarmup=%.3g ms, warmupCycles=%u period=%.2f ms\n",
+                mCommand, mReadSequence, mFramesRead, mReadErrors,
+                mUnderruns, mOverruns, mSampleRate, mFrameCount,
+                measuredWarmupMs, mWarmupCycles, periodSec * 1e3);
+    dumpHistograms(fd, "FastCapture");
+}
+
 }   // namespace android
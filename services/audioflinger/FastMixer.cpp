@@ -376,6 +376,8 @@ void FastMixer::onWork()
             FastTrackDump *ftDump = &dumpState->mTracks[i];
             FastTrackUnderruns underruns = ftDump->mUnderruns;
             if (framesReady < frameCount) {
+                logWriter->logEvent(FAST_EVENT_TRACK_UNDERRUN, i, (int32_t) framesReady,
+                        (int32_t) frameCount);
                 if (framesReady == 0) {
                     underruns.mBitFields.mEmpty++;
                     underruns.mBitFields.mMostRecent = UNDERRUN_EMPTY;
@@ -429,6 +431,10 @@ void FastMixer::onWork()
         ssize_t framesWritten = outputSink->write(buffer, frameCount);
         ATRACE_END();
         dumpState->mWriteSequence++;
+        if (framesWritten != (ssize_t) frameCount) {
+            logWriter->logEvent(FAST_EVENT_SHORT_WRITE, (int32_t) frameCount,
+                    (int32_t) framesWritten);
+        }
         if (framesWritten >= 0) {
             ALOG_ASSERT((size_t) framesWritten <= frameCount);
             totalNativeFramesWritten += framesWritten;
@@ -456,6 +462,24 @@ void FastMixer::onWork()
     }
 }
 
+void FastMixer::onUnderrun()
+{
+    const FastMixerState * const current = (const FastMixerState *) this->current;
+    FastMixerDumpState * const dumpState = (FastMixerDumpState *) this->dumpState;
+    // attribute the late cycle to every track that was mixed, and note which of those were
+    // themselves starved, to help find whether a client or the mixer itself was at fault
+    unsigned currentTrackMask = current->mTrackMask;
+    while (currentTrackMask != 0) {
+        int i = __builtin_ctz(currentTrackMask);
+        currentTrackMask &= ~(1 << i);
+        FastTrackDump *ftDump = &dumpState->mTracks[i];
+        ftDump->mLateCycles++;
+        if (ftDump->mUnderruns.mBitFields.mMostRecent != UNDERRUN_FULL) {
+            ftDump->mLateCyclesStarved++;
+        }
+    }
+}
+
 FastMixerDumpState::FastMixerDumpState(
 #ifdef FAST_MIXER_STATISTICS
         uint32_t samplingN
@@ -638,6 +662,7 @@ void FastMixerDumpState::dump(int fd) const
         delete[] tail;
     }
 #endif
+    dumpHistograms(fd, "FastMixer");
     // The active track mask and track states are updated non-atomically.
     // So if we relied on isActive to decide whether to display,
     // then we might display an obsolete track or omit an active track.
@@ -646,7 +671,7 @@ void FastMixerDumpState::dump(int fd) const
     uint32_t trackMask = mTrackMask;
     dprintf(fd, "  Fast tracks: kMaxFastTracks=%u activeMask=%#x\n",
             FastMixerState::kMaxFastTracks, trackMask);
-    dprintf(fd, "  Index Active Full Partial Empty  Recent Ready\n");
+    dprintf(fd, "  Index Active Full Partial Empty  Recent Ready  Late Starved\n");
     for (uint32_t i = 0; i < FastMixerState::kMaxFastTracks; ++i, trackMask >>= 1) {
         bool isActive = trackMask & 1;
         const FastTrackDump *ftDump = &mTracks[i];
@@ -666,11 +691,12 @@ void FastMixerDumpState::dump(int fd) const
             mostRecent = "?";
             break;
         }
-        dprintf(fd, "  %5u %6s %4u %7u %5u %7s %5zu\n", i, isActive ? "yes" : "no",
+        dprintf(fd, "  %5u %6s %4u %7u %5u %7s %5zu %5u %7u\n", i, isActive ? "yes" : "no",
                 (underruns.mBitFields.mFull) & UNDERRUN_MASK,
                 (underruns.mBitFields.mPartial) & UNDERRUN_MASK,
                 (underruns.mBitFields.mEmpty) & UNDERRUN_MASK,
-                mostRecent, ftDump->mFramesReady);
+                mostRecent, ftDump->mFramesReady,
+                ftDump->mLateCycles, ftDump->mLateCyclesStarved);
     }
 }
 
@@ -51,6 +51,7 @@ private:
     virtual bool isSubClassCommand(FastThreadState::Command command);
     virtual void onStateChange();
     virtual void onWork();
+    virtual void onUnderrun();
 
     // FIXME these former local variables need comments and to be renamed to have "m" prefix
     static const FastMixerState initial;
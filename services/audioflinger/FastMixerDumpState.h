@@ -50,10 +50,15 @@ private:
 
 // Represents the dump state of a fast track
 struct FastTrackDump {
-    FastTrackDump() : mFramesReady(0) { }
+    FastTrackDump() : mFramesReady(0), mLateCycles(0), mLateCyclesStarved(0) { }
     /*virtual*/ ~FastTrackDump() { }
     FastTrackUnderruns mUnderruns;
     size_t mFramesReady;        // most recent value only; no long-term statistics kept
+    // Correlation of this track with FastMixer cycle underruns (FastThreadDumpState::mUnderruns).
+    // Not reset for new tracks, similar to mUnderruns.
+    uint32_t mLateCycles;       // cycle underruns while this track was active
+    uint32_t mLateCyclesStarved; // subset of mLateCycles where this track's most recent
+                                // framesReady() was a partial or empty underrun
 };
 
 // The FastMixerDumpState keeps a cache of FastMixer statistics that can be logged by dumpsys.
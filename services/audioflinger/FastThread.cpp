@@ -39,6 +39,8 @@ FastThread::FastThread() : Thread(false /*canCallJava*/),
     /* oldTs({0, 0}), */
     oldTsValid(false),
     sleepNs(-1),
+    /* wakeTs({0, 0}), */
+    wakeTsValid(false),
     periodNs(0),
     underrunNs(0),
     overrunNs(0),
@@ -71,6 +73,8 @@ FastThread::FastThread() : Thread(false /*canCallJava*/),
 {
     oldTs.tv_sec = 0;
     oldTs.tv_nsec = 0;
+    wakeTs.tv_sec = 0;
+    wakeTs.tv_nsec = 0;
     measuredWarmupTs.tv_sec = 0;
     measuredWarmupTs.tv_nsec = 0;
 }
@@ -93,6 +97,16 @@ bool FastThread::threadLoop()
                 sched_yield();
             }
         }
+        // wake-up lateness is measured from the end of the previous cycle, when sleep began
+        int64_t latenessNs = -1;
+        wakeTsValid = !clock_gettime(CLOCK_MONOTONIC, &wakeTs);
+        if (wakeTsValid && oldTsValid && sleepNs > 0) {
+            latenessNs = (wakeTs.tv_sec - oldTs.tv_sec) * 1000000000LL +
+                    (wakeTs.tv_nsec - oldTs.tv_nsec) - sleepNs;
+            if (latenessNs < 0) {
+                latenessNs = 0;
+            }
+        }
         // default to long sleep for next cycle
         sleepNs = FAST_DEFAULT_NS;
 
@@ -243,18 +257,15 @@ bool FastThread::threadLoop()
                 if (isWarm) {
                     if (sec > 0 || nsec > underrunNs) {
                         ATRACE_NAME("underrun");
-                        // FIXME only log occasionally
-                        ALOGV("underrun: time since last cycle %d.%03ld sec",
-                                (int) sec, nsec / 1000000L);
+                        logWriter->logEvent(FAST_EVENT_UNDERRUN, (int32_t) sec, (int32_t) nsec);
                         dumpState->mUnderruns++;
+                        onUnderrun();
                         ignoreNextOverrun = true;
                     } else if (nsec < overrunNs) {
                         if (ignoreNextOverrun) {
                             ignoreNextOverrun = false;
                         } else {
-                            // FIXME only log occasionally
-                            ALOGV("overrun: time since last cycle %d.%03ld sec",
-                                    (int) sec, nsec / 1000000L);
+                            logWriter->logEvent(FAST_EVENT_OVERRUN, (int32_t) nsec);
                             dumpState->mOverruns++;
                         }
                         // This forces a minimum cycle time. It:
@@ -268,6 +279,24 @@ bool FastThread::threadLoop()
                         ignoreNextOverrun = false;
                     }
                 }
+                if (isWarm) {
+                    uint32_t cycleNs = nsec;
+                    if (sec > 0) {
+                        cycleNs = sec < 4 ? cycleNs + (uint32_t) sec * 1000000000u : 0xFFFFFFFF;
+                    }
+                    dumpState->mCycleNs.sample(cycleNs);
+                    if (wakeTsValid) {
+                        // onWork() is the dominant part, but this also includes poll() etc.
+                        int64_t workNs = (newTs.tv_sec - wakeTs.tv_sec) * 1000000000LL +
+                                (newTs.tv_nsec - wakeTs.tv_nsec);
+                        dumpState->mWorkNs.sample(workNs <= 0 ? 0 :
+                                workNs < 0xFFFFFFFFLL ? (uint32_t) workNs : 0xFFFFFFFF);
+                    }
+                    if (latenessNs >= 0) {
+                        dumpState->mLatenessNs.sample(latenessNs < 0xFFFFFFFFLL ?
+                                (uint32_t) latenessNs : 0xFFFFFFFF);
+                    }
+                }
 #ifdef FAST_MIXER_STATISTICS
                 if (isWarm) {
                     // advance the FIFO queue bounds
@@ -26,6 +26,17 @@
 
 namespace android {
 
+// Ids of the binary events FastMixer and FastCapture log with NBLog::Writer::logEvent() from
+// their cycle, which must not format strings.  "dumpsys media.log" prints them as
+// "#<id> @<time> <args>"; keep ids stable for tools reading the --binary export.
+enum FastThreadEvent {
+    FAST_EVENT_UNDERRUN = 1,    // cycle late: seconds, nanoseconds since previous cycle
+    FAST_EVENT_OVERRUN,         // cycle early: nanoseconds since previous cycle
+    FAST_EVENT_SHORT_WRITE,     // FastMixer: frames requested, frames written or error
+    FAST_EVENT_TRACK_UNDERRUN,  // FastMixer: fast track index, frames ready, frames needed
+    FAST_EVENT_SHORT_READ,      // FastCapture: frames requested, frames read or error
+};
+
 // FastThread is the common abstract base class of FastMixer and FastCapture
 class FastThread : public Thread {
 
@@ -47,6 +58,8 @@ protected:
     virtual bool isSubClassCommand(FastThreadState::Command command) = 0;
     virtual void onStateChange() = 0;
     virtual void onWork() = 0;
+    // called after dumpState->mUnderruns is incremented for a late cycle
+    virtual void onUnderrun() { }
 
     // FIXME these former local variables need comments and to be renamed to have an "m" prefix
     const FastThreadState *previous;
@@ -54,6 +67,8 @@ protected:
     struct timespec oldTs;
     bool oldTsValid;
     long sleepNs;   // -1: busy wait, 0: sched_yield, > 0: nanosleep
+    struct timespec wakeTs;     // clock_gettime(CLOCK_MONOTONIC) on return from sleep
+    bool wakeTsValid;
     long periodNs;      // expected period; the time required to render one mix buffer
     long underrunNs;    // underrun likely when write cycle is greater than this value
     long overrunNs;     // overrun likely when write cycle is less than this value
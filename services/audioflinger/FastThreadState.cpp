@@ -15,6 +15,8 @@
  */
 
 #include "Configuration.h"
+#include <stdio.h>
+#include <unistd.h>
 #include "FastThreadState.h"
 
 namespace android {
@@ -46,4 +48,115 @@ FastThreadDumpState::~FastThreadDumpState()
 {
 }
 
+void FastThreadDumpState::dumpHistograms(int fd, const char *name) const
+{
+    static const struct {
+        const char *mLabel;
+        const FastThreadHistogram FastThreadDumpState::*mHistogram;
+    } kHistograms[] = {
+        { "cycle",    &FastThreadDumpState::mCycleNs },
+        { "work",     &FastThreadDumpState::mWorkNs },
+        { "lateness", &FastThreadDumpState::mLatenessNs },
+    };
+    dprintf(fd, "  %s histograms in ms (lifetime, log-linear, +/-%u%%):\n"
+                "    %-8s %10s %7s %7s %7s %7s %7s\n", name,
+                100 / FastThreadHistogram::kSubBuckets,
+                "", "samples", "p50", "p90", "p99", "p99.9", "max");
+    for (size_t i = 0; i < sizeof(kHistograms) / sizeof(kHistograms[0]); ++i) {
+        const FastThreadHistogram& histogram = this->*kHistograms[i].mHistogram;
+        dprintf(fd, "    %-8s %10u %7.2f %7.2f %7.2f %7.2f %7.2f\n",
+                kHistograms[i].mLabel, histogram.total(),
+                histogram.percentile(50.0) * 1e-6, histogram.percentile(90.0) * 1e-6,
+                histogram.percentile(99.0) * 1e-6, histogram.percentile(99.9) * 1e-6,
+                histogram.percentile(100.0) * 1e-6);
+    }
+}
+
+void FastThreadDumpState::dumpHistogramSnapshot(int fd, const char *name) const
+{
+    HistogramSnapshot snapshot;
+    snapshot.mMagic = kHistogramSnapshotMagic;
+    snapshot.mVersion = kHistogramSnapshotVersion;
+    snapshot.mSubBucketBits = FastThreadHistogram::kSubBucketBits;
+    snapshot.mNumHistograms = 3;
+    snapshot.mBuckets = FastThreadHistogram::kBuckets;
+    snapshot.mUnderruns = mUnderruns;
+    snapshot.mOverruns = mOverruns;
+    memcpy(snapshot.mCount[0], mCycleNs.mCount, sizeof(snapshot.mCount[0]));
+    memcpy(snapshot.mCount[1], mWorkNs.mCount, sizeof(snapshot.mCount[1]));
+    memcpy(snapshot.mCount[2], mLatenessNs.mCount, sizeof(snapshot.mCount[2]));
+
+    static const char kHex[] = "0123456789abcdef";
+    const uint8_t *bytes = (const uint8_t *) &snapshot;
+    char line[2 * sizeof(snapshot) + 1];
+    for (size_t i = 0; i < sizeof(snapshot); ++i) {
+        line[2 * i] = kHex[bytes[i] >> 4];
+        line[2 * i + 1] = kHex[bytes[i] & 0xF];
+    }
+    line[2 * sizeof(snapshot)] = '\0';
+    dprintf(fd, "  %s histogram snapshot: %s\n", name, line);
+}
+
+// ---------------------------------------------------------------------------
+
+/*static*/
+uint32_t FastThreadHistogram::bucketOf(uint32_t ns)
+{
+    if (ns < kSubBuckets) {
+        return ns;
+    }
+    uint32_t exponent = 31 - __builtin_clz(ns);
+    uint32_t mantissa = (ns >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return ((exponent - kSubBucketBits + 1) << kSubBucketBits) + mantissa;
+}
+
+/*static*/
+uint32_t FastThreadHistogram::lowerBound(uint32_t bucket)
+{
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    uint32_t exponent = (bucket >> kSubBucketBits) + kSubBucketBits - 1;
+    uint32_t mantissa = bucket & (kSubBuckets - 1);
+    return (kSubBuckets + mantissa) << (exponent - kSubBucketBits);
+}
+
+/*static*/
+uint32_t FastThreadHistogram::upperBound(uint32_t bucket)
+{
+    return bucket + 1 < kBuckets ? lowerBound(bucket + 1) - 1 : 0xFFFFFFFF;
+}
+
+uint32_t FastThreadHistogram::total() const
+{
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < kBuckets; ++i) {
+        total += mCount[i];
+    }
+    return total;
+}
+
+uint32_t FastThreadHistogram::percentile(double p) const
+{
+    uint32_t n = total();
+    if (n == 0) {
+        return 0;
+    }
+    // rank of the requested sample, 1-based
+    double rank = p * n / 100.0;
+    uint32_t seen = 0;
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < kBuckets; ++i) {
+        if (mCount[i] == 0) {
+            continue;
+        }
+        seen += mCount[i];
+        last = i;
+        if (seen >= rank) {
+            break;
+        }
+    }
+    return upperBound(last);
+}
+
 }   // namespace android
@@ -19,6 +19,7 @@
 
 #include "Configuration.h"
 #include <stdint.h>
+#include <string.h>
 #include <media/nbaio/NBLog.h>
 
 namespace android {
@@ -49,6 +50,33 @@ struct FastThreadState {
 };  // struct FastThreadState
 
 
+// Fixed-size log-linear histogram of durations in nanoseconds, always enabled.
+// Values less than kSubBuckets have a bucket each.  Above that, each power of 2 is divided
+// into kSubBuckets buckets of equal width, so the relative error of a bucket is at most
+// 1/kSubBuckets.  Only the fast thread writes, and each counter is a native word updated
+// without barriers; as with the rest of the dump state, readers should work on a copy.
+struct FastThreadHistogram {
+    static const uint32_t kSubBucketBits = 3;
+    static const uint32_t kSubBuckets = 1 << kSubBucketBits;
+    static const uint32_t kBuckets = (32 - kSubBucketBits + 1) * kSubBuckets;
+
+    FastThreadHistogram() { clear(); }
+
+    void        clear() { memset(mCount, 0, sizeof(mCount)); }
+    void        sample(uint32_t ns) { mCount[bucketOf(ns)]++; }
+
+    static uint32_t bucketOf(uint32_t ns);
+    static uint32_t lowerBound(uint32_t bucket);    // smallest value counted in bucket
+    static uint32_t upperBound(uint32_t bucket);    // largest value counted in bucket
+
+    uint32_t    total() const;
+    // returns upper bound of the bucket containing the given percentile in [0, 100],
+    // or 0 if there are no samples
+    uint32_t    percentile(double p) const;
+
+    uint32_t    mCount[kBuckets];
+};
+
 // FIXME extract common part of comment at FastMixerDumpState
 struct FastThreadDumpState {
     FastThreadDumpState();
@@ -60,6 +88,33 @@ struct FastThreadDumpState {
     struct timespec mMeasuredWarmupTs;  // measured warmup time
     uint32_t mWarmupCycles;     // number of loop cycles required to warmup
 
+    // Histograms collected for the lifetime of the thread while warm, independent of the
+    // sampled statistics below, so memory use does not depend on the sampling window.
+    FastThreadHistogram mCycleNs;       // wall clock time between consecutive cycles
+    FastThreadHistogram mWorkNs;        // wall clock time from wake-up to end of cycle
+    FastThreadHistogram mLatenessNs;    // wake-up time in excess of the requested sleep
+
+    // Output percentile summaries of the histograms; name identifies the thread type.
+    // As with dump(), should only be called on a stable copy.
+    void    dumpHistograms(int fd, const char *name) const;
+    // Output the histograms as a single line of hex-encoded HistogramSnapshot,
+    // so fleet tools can aggregate them from a bug report.
+    void    dumpHistogramSnapshot(int fd, const char *name) const;
+
+    // Binary layout of the histogram snapshot, in host byte order.
+    struct HistogramSnapshot {
+        uint32_t mMagic;            // kHistogramSnapshotMagic
+        uint16_t mVersion;          // kHistogramSnapshotVersion
+        uint8_t  mSubBucketBits;    // FastThreadHistogram::kSubBucketBits
+        uint8_t  mNumHistograms;    // 3: cycle, work, lateness
+        uint32_t mBuckets;          // FastThreadHistogram::kBuckets
+        uint32_t mUnderruns;
+        uint32_t mOverruns;
+        uint32_t mCount[3][FastThreadHistogram::kBuckets];
+    } __attribute__((packed));
+    static const uint32_t kHistogramSnapshotMagic = 0x48544146;  // "FATH" in little endian
+    static const uint16_t kHistogramSnapshotVersion = 1;
+
 #ifdef FAST_MIXER_STATISTICS
     // Recently collected samples of per-cycle monotonic time, thread CPU time, and CPU frequency.
     // kSamplingN is max size of sampling frame (statistics), and must be a power of 2 <= 0x8000.
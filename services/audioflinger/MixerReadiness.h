@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MIXER_READINESS_H
+#define ANDROID_AUDIO_MIXER_READINESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+
+// How MixerThread::prepareTracks_l() decides whether a normal (not fast) track is mixed in a
+// cycle, whether it underran, and whether the mixer as a whole is ready.  Kept free of thread
+// and track state so that tests/test-playback-harness runs the same rules off the device.
+class MixerReadiness {
+public:
+    // mixerWasReady: whether the mixer was ready during the previous cycle, ignoring fast tracks
+    explicit MixerReadiness(bool mixerWasReady)
+        : mMixerWasReady(mixerWasReady), mAnyTrackReady(false), mAnyTrackNotReady(false) { }
+
+    // Frames a track at trackSampleRate must have ready to fill one mix buffer of
+    // mixerFrameCount frames at mixerSampleRate.  unreleasedFrames are frames already consumed
+    // but not yet released by the resampler, which the track's framesReady() still includes.
+    static size_t desiredFrames(size_t mixerFrameCount, uint32_t mixerSampleRate,
+            uint32_t trackSampleRate, size_t unreleasedFrames) {
+        if (trackSampleRate == mixerSampleRate) {
+            return mixerFrameCount;
+        }
+        // +1 for rounding and +1 for additional sample needed for interpolation
+        return (mixerFrameCount * trackSampleRate) / mixerSampleRate + 1 + 1 + unreleasedFrames;
+    }
+
+    // Frames the track needs to be mixed this cycle.  A full buffer is only required of a
+    // streaming track that keeps playing, and only if the mixer was ready during the previous
+    // cycle, to enable draining the buffer in case the client app does not call stop() and
+    // relies on underrun to stop.
+    size_t minFrames(size_t desiredFrames, bool streamingAndPlaying) const {
+        return streamingAndPlaying && mMixerWasReady ? desiredFrames : 1;
+    }
+
+    // Whether a track that is not mixed this cycle counts as an underrun.
+    static bool isUnderrun(size_t framesReady, size_t desiredFrames, bool stopped, bool paused) {
+        return framesReady < desiredFrames && !stopped && !paused;
+    }
+
+    // Record a track that is mixed this cycle, or one that is not but is given more chances
+    // to fill a buffer.
+    void trackReady() { mAnyTrackReady = true; }
+    void trackNotReady() { mAnyTrackNotReady = true; }
+
+    // If one track is ready, the mixer is ready if it was not ready during the previous cycle
+    // or no other track is not ready.  If one track is not ready, the mixer is not ready if it
+    // was ready during the previous cycle or no other track is ready.
+    bool isMixerReady() const {
+        return mAnyTrackReady && !(mMixerWasReady && mAnyTrackNotReady);
+    }
+    // Whether there is at least one active track, ready or not.
+    bool isMixerEnabled() const {
+        return mAnyTrackReady || mAnyTrackNotReady;
+    }
+
+private:
+    const bool mMixerWasReady;
+    bool mAnyTrackReady;
+    bool mAnyTrackNotReady;
+};
+
+}   // namespace android
+
+#endif  // ANDROID_AUDIO_MIXER_READINESS_H
@@ -65,6 +65,8 @@ public:
             int16_t     *mainBuffer() const { return mMainBuffer; }
             int         auxEffectId() const { return mAuxEffectId; }
     virtual status_t    getTimestamp(AudioTimestamp& timestamp);
+            status_t    getLatchedTimestamp_l(PlaybackThread *playbackThread,
+                                AudioTimestamp& timestamp);
             void        signal();
 
 // implement FastMixerState::VolumeProvider interface
@@ -47,6 +47,7 @@
 #include "Configuration.h"
 #include <math.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
 #include <cutils/properties.h>
 #include <media/AudioParameter.h>
@@ -80,6 +81,7 @@
 #include "AudioMixer.h"
 #include "FastMixer.h"
 #include "FastCapture.h"
+#include "MixerReadiness.h"
 #include "ServiceUtilities.h"
 #include "SchedulingPolicyService.h"
 
@@ -350,6 +352,37 @@ static const size_t kRecordThreadReadOnlyHeapSize = 0x2000;
 
 // ----------------------------------------------------------------------------
 
+// "dumpsys media.audio_flinger --histograms" appends a hex-encoded binary snapshot of the
+// fast thread histograms, see FastThreadDumpState::HistogramSnapshot
+static bool wantsHistogramSnapshot(const Vector<String16>& args)
+{
+    static const String16 sHistograms("--histograms");
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == sHistograms) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether effect chains of different sessions may be processed concurrently, see
+// PlaybackThread::processEffectChains_l().  Disabled unless property af.parallel_effects
+// is 1 and there is more than one CPU: it costs a handoff to the worker thread and an extra
+// accumulate pass per chain every mix period, which only pays off with several heavy chains.
+static bool sParallelEffectChains = false;
+
+static pthread_once_t sParallelEffectChainsOnce = PTHREAD_ONCE_INIT;
+
+static void sParallelEffectChainsInit()
+{
+    char value[PROPERTY_VALUE_MAX];
+    bool enabled = false;
+    if (property_get("af.parallel_effects", value, NULL) > 0) {
+        enabled = atoi(value) == 1;
+    }
+    sParallelEffectChains = enabled && sysconf(_SC_NPROCESSORS_ONLN) > 1;
+}
+
 static pthread_once_t sFastTrackMultiplierOnce = PTHREAD_ONCE_INIT;
 
 static void sFastTrackMultiplierInit()
@@ -1190,6 +1223,7 @@ sp<AudioFlinger::EffectHandle> AudioFlinger::ThreadBase::createEffect_l(
                 goto Exit;
             }
             effectCreated = true;
+            invalidateEffectChainsPlan_l();
 
             effect->setDevice(mAudioFlinger->mLPASessionId == sessionId ? mAudioFlinger->mDirectDevice:mOutDevice);
             effect->setDevice(mInDevice);
@@ -1219,6 +1253,7 @@ Exit:
         Mutex::Autolock _l(mLock);
         if (effectCreated) {
             chain->removeEffect_l(effect);
+            invalidateEffectChainsPlan_l();
         }
         if (effectRegistered) {
             AudioSystem::unregisterEffect(effect->id());
@@ -1283,6 +1318,7 @@ status_t AudioFlinger::ThreadBase::addEffect_l(const sp<EffectModule>& effect)
         }
         return status;
     }
+    invalidateEffectChainsPlan_l();
 
     effect->setDevice(mOutDevice);
     effect->setDevice(mInDevice);
@@ -1304,6 +1340,7 @@ void AudioFlinger::ThreadBase::removeEffect_l(const sp<EffectModule>& effect) {
 
     sp<EffectChain> chain = effect->chain().promote();
     if (chain != 0) {
+        invalidateEffectChainsPlan_l();
         // remove effect chain if removing last effect
         if (chain->removeEffect_l(effect) == 0) {
             removeEffectChain_l(chain);
@@ -1403,6 +1440,8 @@ AudioFlinger::PlaybackThread::PlaybackThread(const sp<AudioFlinger>& audioFlinge
         mWriteAckSequence(0),
         mDrainSequence(0),
         mSignalPending(false),
+        mEffectChainsPlanValid(false),
+        mUseEffectChainWorker(false),
         mScreenState(AudioFlinger::mScreenState),
         // index 0 is reserved for normal mixer's submix
         mFastTrackAvailMask(((1 << FastMixerState::kMaxFastTracks) - 1) & ~1),
@@ -2149,6 +2188,8 @@ void AudioFlinger::PlaybackThread::readOutputParameters_l()
     // Note that mLock is not held when readOutputParameters_l() is called from the constructor
     // but in this case nothing is done below as no audio sessions have effect yet so it doesn't
     // matter.
+    // private chain output buffers are sized from mNormalFrameCount
+    invalidateEffectChainsPlan_l();
     // create a copy of mEffectChains as calling moveEffectChain_l() can reorder some effect chains
     Vector< sp<EffectChain> > effectChains = mEffectChains;
     for (size_t i = 0; i < effectChains.size(); i ++) {
@@ -2517,6 +2558,11 @@ status_t AudioFlinger::PlaybackThread::addEffectChain_l(const sp<EffectChain>& c
         }
     }
     chain->setThread(this);
+    // the chain may have been processed concurrently on its previous thread
+    chain->lock();
+    chain->setPrivateOutBuffer_l(0);
+    chain->unlock();
+    invalidateEffectChainsPlan_l();
     chain->setInBuffer(buffer, ownsBuffer);
     chain->setOutBuffer(reinterpret_cast<int16_t*>(mEffectBufferEnabled
             ? mEffectBuffer : mSinkBuffer));
@@ -2552,6 +2598,7 @@ size_t AudioFlinger::PlaybackThread::removeEffectChain_l(const sp<EffectChain>&
     for (size_t i = 0; i < mEffectChains.size(); i++) {
         if (chain == mEffectChains[i]) {
             mEffectChains.removeAt(i);
+            invalidateEffectChainsPlan_l();
             // detach all active tracks from the chain
             for (size_t i = 0 ; i < mActiveTracks.size() ; ++i) {
                 sp<Track> track = mActiveTracks[i].promote();
@@ -2694,6 +2741,7 @@ bool AudioFlinger::PlaybackThread::threadLoop()
                 mLatchQ = mLatchD;
                 mLatchDValid = false;
                 mLatchQValid = true;
+                publishTimestamps_l();
             }
 
             saveOutputTracks();
@@ -2781,6 +2829,10 @@ bool AudioFlinger::PlaybackThread::threadLoop()
             // during mixing and effect process as the audio buffers could be deleted
             // or modified if an effect is created or deleted
             lockEffectChains_l(effectChains);
+            // redirecting chain outputs reconfigures effects, which must be done under mLock
+            if (!mEffectChainsPlanValid && mType != OFFLOAD) {
+                updateEffectChainsPlan_l(effectChains);
+            }
         } // mLock scope ends
 
         if (mBytesRemaining == 0) {
@@ -2825,11 +2877,7 @@ bool AudioFlinger::PlaybackThread::threadLoop()
 
             // only process effects if we're going to write
             if (sleepTime == 0 && mType != OFFLOAD) {
-                for (size_t i = 0; i < effectChains.size(); i ++) {
-                    if (effectChains[i] != mAudioFlinger->mLPAEffectChain) {
-                        effectChains[i]->process_l();
-                  }
-               }
+                processEffectChains_l(effectChains);
             }
         }
         // Process effect chains for offloaded thread even if no audio
@@ -2923,6 +2971,12 @@ bool AudioFlinger::PlaybackThread::threadLoop()
 
     threadLoop_exit();
 
+    if (mEffectChainWorker != 0) {
+        mEffectChainWorker->exit();
+        mEffectChainWorker->join();
+        mEffectChainWorker.clear();
+    }
+
     if (!mStandby) {
         threadLoop_standby();
         mStandby = true;
@@ -2942,6 +2996,85 @@ bool AudioFlinger::PlaybackThread::threadLoop()
     return false;
 }
 
+// Process the effect chains for one mix period.
+// Chains for individual sessions that own their input buffer only share the output buffer.
+// When there are at least two such chains, they are split between this thread and
+// mEffectChainWorker, and each accumulates into a private output buffer.  These are then added
+// to the shared output buffer in the original chain order, interleaved with processing of the
+// remaining chains, which gives the same result as processing all chains serially.
+// Must be called with all chains locked, see lockEffectChains_l(), and the plan up to date,
+// see updateEffectChainsPlan_l().
+void AudioFlinger::PlaybackThread::processEffectChains_l(
+        const Vector< sp<EffectChain> >& effectChains)
+{
+    size_t size = effectChains.size();
+    if (mUseEffectChainWorker) {
+        mEffectChainWorker->process();
+        for (size_t i = 0; i < mLocalEffectChains.size(); i++) {
+            if (mLocalEffectChains[i]->hasPrivateOutBuffer()) {
+                mLocalEffectChains[i]->process_l();
+            }
+        }
+        mEffectChainWorker->waitUntilProcessed();
+    }
+    for (size_t i = 0; i < size; i++) {
+        const sp<EffectChain>& chain = effectChains[i];
+        if (chain == mAudioFlinger->mLPAEffectChain) {
+            continue;
+        }
+        if (chain->hasPrivateOutBuffer()) {
+            chain->accumulatePrivateOutBuffer_l();
+        } else {
+            chain->process_l();
+        }
+    }
+}
+
+// Must be called with mLock held and all chains locked, see lockEffectChains_l().
+// Reconfigures the last effect of chains whose output buffer changes.
+void AudioFlinger::PlaybackThread::updateEffectChainsPlan_l(
+        const Vector< sp<EffectChain> >& effectChains)
+{
+    pthread_once(&sParallelEffectChainsOnce, sParallelEffectChainsInit);
+
+    size_t size = effectChains.size();
+    size_t numParallel = 0;
+    mEffectChainsPlanValid = true;
+    for (size_t i = 0; i < size; i++) {
+        const sp<EffectChain>& chain = effectChains[i];
+        if (chain != mAudioFlinger->mLPAEffectChain && chain->isParallelizable_l()) {
+            numParallel++;
+        }
+    }
+    mUseEffectChainWorker = sParallelEffectChains && numParallel >= 2;
+
+    // alternate parallelizable chains between this thread and the worker
+    Vector<EffectChain *> workerChains;
+    mLocalEffectChains.clear();
+    for (size_t i = 0; i < size; i++) {
+        const sp<EffectChain>& chain = effectChains[i];
+        if (mUseEffectChainWorker && chain != mAudioFlinger->mLPAEffectChain &&
+                chain->isParallelizable_l()) {
+            chain->setPrivateOutBuffer_l(mNormalFrameCount * mChannelCount);
+            if (mLocalEffectChains.size() > workerChains.size()) {
+                workerChains.add(chain.get());
+            } else {
+                mLocalEffectChains.add(chain.get());
+            }
+        } else if (chain != mAudioFlinger->mLPAEffectChain) {
+            chain->setPrivateOutBuffer_l(0);
+        }
+    }
+    if (mUseEffectChainWorker && mEffectChainWorker == 0) {
+        mEffectChainWorker = new EffectChainWorker();
+    }
+    if (mEffectChainWorker != 0) {
+        mEffectChainWorker->setChains(workerChains);
+    }
+    ALOGV("updateEffectChainsPlan_l() %zu chains, %zu on this thread, %zu on worker",
+            size, mLocalEffectChains.size(), workerChains.size());
+}
+
 // removeTracks_l() must be called with ThreadBase::mLock held
 void AudioFlinger::PlaybackThread::removeTracks_l(const Vector< sp<Track> >& tracksToRemove)
 {
@@ -2985,6 +3118,31 @@ status_t AudioFlinger::PlaybackThread::getTimestamp_l(AudioTimestamp& timestamp)
     return INVALID_OPERATION;
 }
 
+// Clients read these from the control block instead of calling IAudioTrack::getTimestamp().
+void AudioFlinger::PlaybackThread::publishTimestamps_l()
+{
+    AudioTimestampState state;
+    state.mLatencyMs = latency_l();
+    size_t size = mActiveTracks.size();
+    for (size_t i = 0; i < size; i++) {
+        sp<Track> t = mActiveTracks[i].promote();
+        // fast tracks are excluded for the same reason as in Track::getTimestamp()
+        if (t == 0 || t->isFastTrack()) {
+            continue;
+        }
+        // read before the timestamp is computed, under the same lock
+        state.mGeneration = t->mAudioTrackServerProxy->getTimestampGeneration();
+        AudioTimestamp timestamp;
+        if (t->getLatchedTimestamp_l(this, timestamp) != NO_ERROR) {
+            continue;
+        }
+        state.mPosition = timestamp.mPosition;
+        state.mTimeNs = timestamp.mTime.tv_sec * 1000000000LL + timestamp.mTime.tv_nsec;
+        state.mUnderrunFrames = t->mAudioTrackServerProxy->getUnderrunFrames();
+        t->mAudioTrackServerProxy->setTimestamp(state);
+    }
+}
+
 status_t AudioFlinger::PlaybackThread::createAudioPatch_l(const struct audio_patch *patch,
                                                           audio_patch_handle_t *handle)
 {
@@ -3434,6 +3592,7 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
 {
 
     mixer_state mixerStatus = MIXER_IDLE;
+    MixerReadiness readiness(mMixerStatusIgnoringFastTracks == MIXER_TRACKS_READY);
     // find out which tracks need to be processed
     size_t count = mActiveTracks.size();
     size_t mixedTracks = 0;
@@ -3640,33 +3799,12 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
         // The first time a track is added we wait
         // for all its buffers to be filled before processing it
         int name = track->name();
-        // make sure that we have enough frames to mix one full buffer.
-        // enforce this condition only once to enable draining the buffer in case the client
-        // app does not call stop() and relies on underrun to stop:
-        // hence the test on (mMixerStatus == MIXER_TRACKS_READY) meaning the track was mixed
-        // during last round
-        size_t desiredFrames;
+        // make sure that we have enough frames to mix one full buffer, see MixerReadiness
         uint32_t sr = track->sampleRate();
-        if (sr == mSampleRate) {
-            desiredFrames = mNormalFrameCount;
-        } else {
-            // +1 for rounding and +1 for additional sample needed for interpolation
-            desiredFrames = (mNormalFrameCount * sr) / mSampleRate + 1 + 1;
-            // add frames already consumed but not yet released by the resampler
-            // because mAudioTrackServerProxy->framesReady() will include these frames
-            desiredFrames += mAudioMixer->getUnreleasedFrames(track->name());
-#if 0
-            // the minimum track buffer size is normally twice the number of frames necessary
-            // to fill one buffer and the resampler should not leave more than one buffer worth
-            // of unreleased frames after each pass, but just in case...
-            ALOG_ASSERT(desiredFrames <= cblk->frameCount_);
-#endif
-        }
-        uint32_t minFrames = 1;
-        if ((track->sharedBuffer() == 0) && !track->isStopped() && !track->isPausing() &&
-                (mMixerStatusIgnoringFastTracks == MIXER_TRACKS_READY)) {
-            minFrames = desiredFrames;
-        }
+        size_t desiredFrames = MixerReadiness::desiredFrames(mNormalFrameCount, mSampleRate, sr,
+                sr == mSampleRate ? 0 : mAudioMixer->getUnreleasedFrames(track->name()));
+        size_t minFrames = readiness.minFrames(desiredFrames,
+                (track->sharedBuffer() == 0) && !track->isStopped() && !track->isPausing());
 
         size_t framesReady = track->framesReady();
         if ((framesReady >= minFrames) && track->isReady() &&
@@ -3860,15 +3998,10 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
             // reset retry count
             track->mRetryCount = kMaxTrackRetries;
 
-            // If one track is ready, set the mixer ready if:
-            //  - the mixer was not ready during previous round OR
-            //  - no other track is not ready
-            if (mMixerStatusIgnoringFastTracks != MIXER_TRACKS_READY ||
-                    mixerStatus != MIXER_TRACKS_ENABLED) {
-                mixerStatus = MIXER_TRACKS_READY;
-            }
+            readiness.trackReady();
         } else {
-            if (framesReady < desiredFrames && !track->isStopped() && !track->isPaused()) {
+            if (MixerReadiness::isUnderrun(framesReady, desiredFrames, track->isStopped(),
+                    track->isPaused())) {
                 track->mAudioTrackServerProxy->tallyUnderrunFrames(desiredFrames);
             }
             // clear effect chain input buffer if an active track underruns to avoid sending
@@ -3902,12 +4035,8 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
                     // indicate to client process that the track was disabled because of underrun;
                     // it will then automatically call start() when data is available
                     android_atomic_or(CBLK_DISABLED, &cblk->mFlags);
-                // If one track is not ready, mark the mixer also not ready if:
-                //  - the mixer was ready during previous round OR
-                //  - no other track is ready
-                } else if (mMixerStatusIgnoringFastTracks == MIXER_TRACKS_READY ||
-                                mixerStatus != MIXER_TRACKS_READY) {
-                    mixerStatus = MIXER_TRACKS_ENABLED;
+                } else {
+                    readiness.trackNotReady();
                 }
             }
 #ifdef HW_ACC_EFFECTS
@@ -3999,6 +4128,12 @@ track_is_ready: ;
         memset(mSinkBuffer, 0, mNormalFrameCount * mFrameSize);
     }
 
+    if (readiness.isMixerReady()) {
+        mixerStatus = MIXER_TRACKS_READY;
+    } else if (readiness.isMixerEnabled()) {
+        mixerStatus = MIXER_TRACKS_ENABLED;
+    }
+
     // if any fast tracks, then status is ready
     mMixerStatusIgnoringFastTracks = mixerStatus;
     if (fastTracks > 0) {
@@ -4178,6 +4313,9 @@ void AudioFlinger::MixerThread::dumpInternals(int fd, const Vector<String16>& ar
     // Make a non-atomic copy of fast mixer dump state so it won't change underneath us
     const FastMixerDumpState copy(mFastMixerDumpState);
     copy.dump(fd);
+    if (hasFastMixer() && wantsHistogramSnapshot(args)) {
+        copy.dumpHistogramSnapshot(fd, "FastMixer");
+    }
 
 #ifdef STATE_QUEUE_DUMP
     // Similar for state queue
@@ -4828,6 +4966,81 @@ void AudioFlinger::AsyncCallbackThread::resetDraining()
     }
 }
 
+// ----------------------------------------------------------------------------
+
+AudioFlinger::EffectChainWorker::EffectChainWorker()
+    :   Thread(false /*canCallJava*/),
+        mProcessPending(false)
+{
+}
+
+AudioFlinger::EffectChainWorker::~EffectChainWorker()
+{
+}
+
+void AudioFlinger::EffectChainWorker::onFirstRef()
+{
+    run("Effect Worker", ANDROID_PRIORITY_URGENT_AUDIO);
+}
+
+bool AudioFlinger::EffectChainWorker::threadLoop()
+{
+    while (!exitPending()) {
+        {
+            Mutex::Autolock _l(mLock);
+            while (!(mProcessPending || exitPending())) {
+                mWaitWorkCV.wait(mLock);
+            }
+            if (exitPending()) {
+                break;
+            }
+        }
+        // mChains is only modified by setChains() while no processing is pending.
+        // The chains are locked by the PlaybackThread for the duration of the processing.
+        for (size_t i = 0; i < mChains.size(); i++) {
+            if (mChains[i]->hasPrivateOutBuffer()) {
+                mChains[i]->process_l();
+            }
+        }
+        {
+            Mutex::Autolock _l(mLock);
+            mProcessPending = false;
+            mWaitDoneCV.signal();
+        }
+    }
+    return false;
+}
+
+void AudioFlinger::EffectChainWorker::exit()
+{
+    ALOGV("EffectChainWorker::exit");
+    Mutex::Autolock _l(mLock);
+    requestExit();
+    mWaitWorkCV.broadcast();
+}
+
+void AudioFlinger::EffectChainWorker::setChains(const Vector<EffectChain *>& chains)
+{
+    Mutex::Autolock _l(mLock);
+    ALOG_ASSERT(!mProcessPending);
+    mChains = chains;
+}
+
+void AudioFlinger::EffectChainWorker::process()
+{
+    Mutex::Autolock _l(mLock);
+    mProcessPending = true;
+    mWaitWorkCV.signal();
+}
+
+void AudioFlinger::EffectChainWorker::waitUntilProcessed()
+{
+    Mutex::Autolock _l(mLock);
+    while (mProcessPending && !exitPending()) {
+        mWaitDoneCV.wait(mLock);
+    }
+}
+
 
 // ----------------------------------------------------------------------------
 AudioFlinger::OffloadThread::OffloadThread(const sp<AudioFlinger>& audioFlinger,
@@ -5710,6 +5923,7 @@ reacquire_wakelock:
         // This is needed for compress offload voip and encode usecases.
         int32_t rear = mRsmpInRear % mRsmpInFramesP2;
         ssize_t framesRead;
+        nsecs_t readTimeNs;     // capture time of the most recent frame read
 
         // If an NBAIO source is present, use it to read the normal capture's data
         if (mPipeSource != 0) {
@@ -5754,6 +5968,7 @@ reacquire_wakelock:
             }
         }
         rear = mRsmpInRear += framesRead;
+        readTimeNs = systemTime();
 
         size = activeTracks.size();
         // loop over each active track
@@ -5965,6 +6180,16 @@ reacquire_wakelock:
                 break;
             }
 
+            // Publish the capture time of the most recent frame delivered to the client.
+            // Frames read but not yet consumed by this track were captured after that frame.
+            AudioTimestampState state;
+            state.mGeneration = activeTrack->mServerProxy->getTimestampGeneration();
+            state.mPosition = activeTrack->mCblk->mServer;
+            state.mTimeNs = readTimeNs -
+                    ((int64_t) (rear - activeTrack->mRsmpInFront) * 1000000000LL) / mSampleRate;
+            state.mLatencyMs = (mFrameCount * 1000) / mSampleRate;
+            state.mUnderrunFrames = 0;
+            activeTrack->mServerProxy->setTimestamp(state);
         }
 
 unlock:
@@ -6347,6 +6572,14 @@ void AudioFlinger::RecordThread::dumpInternals(int fd, const Vector<String16>& a
     }
     dprintf(fd, "  Fast capture thread: %s\n", hasFastCapture() ? "yes" : "no");
     dprintf(fd, "  Fast track available: %s\n", mFastTrackAvail ? "yes" : "no");
+    if (hasFastCapture()) {
+        // Make a non-atomic copy of fast capture dump state so it won't change underneath us
+        const FastCaptureDumpState copy(mFastCaptureDumpState);
+        copy.dump(fd);
+        if (wantsHistogramSnapshot(args)) {
+            copy.dumpHistogramSnapshot(fd, "FastCapture");
+        }
+    }
 
     dumpBase(fd, args);
 }
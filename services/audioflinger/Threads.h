@@ -302,6 +302,8 @@ public:
     virtual     status_t addEffectChain_l(const sp<EffectChain>& chain) = 0;
                 // remove an effect chain from the chain list (mEffectChains)
     virtual     size_t removeEffectChain_l(const sp<EffectChain>& chain) = 0;
+                // called when an effect chain is added, removed or changes its effects or buffers
+    virtual     void invalidateEffectChainsPlan_l() { }
                 // lock all effect chains Mutexes. Must be called before releasing the
                 // ThreadBase mutex before processing the mixer and effects. This guarantees the
                 // integrity of the chains during the process.
@@ -501,6 +503,11 @@ protected:
     virtual     mixer_state prepareTracks_l(Vector< sp<Track> > *tracksToRemove) = 0;
                 void        removeTracks_l(const Vector< sp<Track> >& tracksToRemove);
 
+                // process the effect chains for one mix period; all chains must be locked
+                void        processEffectChains_l(const Vector< sp<EffectChain> >& effectChains);
+                // rebuild the plan for processEffectChains_l(); mLock and all chains must be locked
+                void        updateEffectChainsPlan_l(const Vector< sp<EffectChain> >& effectChains);
+
                 void        writeCallback();
                 void        resetWriteBlocked(uint32_t sequence);
                 void        drainCallback();
@@ -581,6 +588,7 @@ public:
 
                 virtual status_t addEffectChain_l(const sp<EffectChain>& chain);
                 virtual size_t removeEffectChain_l(const sp<EffectChain>& chain);
+                virtual void invalidateEffectChainsPlan_l() { mEffectChainsPlanValid = false; }
                 virtual uint32_t hasAudioSession(int sessionId) const;
                 virtual uint32_t getStrategyForSession_l(int sessionId);
 
@@ -599,6 +607,9 @@ public:
 
                 status_t    getTimestamp_l(AudioTimestamp& timestamp);
 
+                // Publish the latched timestamp to the shared memory of each active track
+                void        publishTimestamps_l();
+
                 void        addPatchTrack(const sp<PatchTrack>& track);
                 void        deletePatchTrack(const sp<PatchTrack>& track);
 
@@ -799,6 +810,15 @@ private:
     bool                            mSignalPending;
     sp<AsyncCallbackThread>         mCallbackThread;
 
+    // Execution plan for processEffectChains_l(), rebuilt by threadLoop() under mLock after
+    // invalidateEffectChainsPlan_l().  Raw pointers are only dereferenced while the
+    // threadLoop()'s locked copy of mEffectChains holds a reference.
+    bool                            mEffectChainsPlanValid;
+    Vector<EffectChain *>           mLocalEffectChains;     // processed concurrently by this
+                                                            // thread, subset of plan
+    bool                            mUseEffectChainWorker;  // whether the plan uses the worker
+    sp<EffectChainWorker>           mEffectChainWorker;     // created on first use
+
 private:
     // The HAL output sink is treated as non-blocking, but current implementation is blocking
     sp<NBAIO_Sink>          mOutputSink;
@@ -1006,6 +1026,38 @@ private:
     Mutex                      mLock;
 };
 
+// Processes a subset of the effect chains of a PlaybackThread concurrently with the
+// PlaybackThread itself, see PlaybackThread::processEffectChains_l()
+class EffectChainWorker : public Thread {
+public:
+
+    EffectChainWorker();
+
+    virtual             ~EffectChainWorker();
+
+    // Thread virtuals
+    virtual bool        threadLoop();
+
+    // RefBase
+    virtual void        onFirstRef();
+
+            void        exit();
+            // Set the chains to process, which must be locked by the caller of process()
+            // and stay referenced until waitUntilProcessed() returns.
+            void        setChains(const Vector<EffectChain *>& chains);
+            // Start processing the chains on the worker, and return immediately
+            void        process();
+            // Wait until the processing started by process() is complete
+            void        waitUntilProcessed();
+
+private:
+    Vector<EffectChain *>      mChains;
+    bool                       mProcessPending;
+    Condition                  mWaitWorkCV;
+    Condition                  mWaitDoneCV;
+    Mutex                      mLock;
+};
+
 class DuplicatingThread : public MixerThread {
 public:
     DuplicatingThread(const sp<AudioFlinger>& audioFlinger, MixerThread* mainThread,
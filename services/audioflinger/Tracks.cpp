@@ -944,55 +944,63 @@ status_t AudioFlinger::PlaybackThread::Track::getTimestamp(AudioTimestamp& times
     Mutex::Autolock _l(thread->mLock);
     PlaybackThread *playbackThread = (PlaybackThread *)thread.get();
     if (!isOffloaded() && !isDirect()) {
-        if (!playbackThread->mLatchQValid) {
-            mPreviousValid = false;
-            return INVALID_OPERATION;
-        }
-        uint32_t unpresentedFrames =
-                ((int64_t) playbackThread->mLatchQ.mUnpresentedFrames * mSampleRate) /
-                playbackThread->mSampleRate;
-        // FIXME Since we're using a raw pointer as the key, it is theoretically possible
-        //       for a brand new track to share the same address as a recently destroyed
-        //       track, and thus for us to get the frames released of the wrong track.
-        //       It is unlikely that we would be able to call getTimestamp() so quickly
-        //       right after creating a new track.  Nevertheless, the index here should
-        //       be changed to something that is unique.  Or use a completely different strategy.
-        ssize_t i = playbackThread->mLatchQ.mFramesReleased.indexOfKey(this);
-        uint32_t framesWritten = i >= 0 ?
-                playbackThread->mLatchQ.mFramesReleased[i] :
-                mAudioTrackServerProxy->framesReleased();
-        bool checkPreviousTimestamp = mPreviousValid && framesWritten >= mPreviousFramesWritten;
-        if (framesWritten < unpresentedFrames) {
-            mPreviousValid = false;
-            return INVALID_OPERATION;
-        }
-        mPreviousFramesWritten = framesWritten;
-        uint32_t position = framesWritten - unpresentedFrames;
-        struct timespec time = playbackThread->mLatchQ.mTimestamp.mTime;
-        if (checkPreviousTimestamp) {
-            if (time.tv_sec < mPreviousTimestamp.mTime.tv_sec ||
-                    (time.tv_sec == mPreviousTimestamp.mTime.tv_sec &&
-                    time.tv_nsec < mPreviousTimestamp.mTime.tv_nsec)) {
-                ALOGW("Time is going backwards");
-            }
-            // position can bobble slightly as an artifact; this hides the bobble
-            static const uint32_t MINIMUM_POSITION_DELTA = 8u;
-            if ((position <= mPreviousTimestamp.mPosition) ||
-                    (position - mPreviousTimestamp.mPosition) < MINIMUM_POSITION_DELTA) {
-                position = mPreviousTimestamp.mPosition;
-                time = mPreviousTimestamp.mTime;
-            }
-        }
-        timestamp.mPosition = position;
-        timestamp.mTime = time;
-        mPreviousTimestamp = timestamp;
-        mPreviousValid = true;
-        return NO_ERROR;
+        return getLatchedTimestamp_l(playbackThread, timestamp);
     }
 
     return playbackThread->getTimestamp_l(timestamp);
 }
 
+// Called with the thread lock held, by getTimestamp() and by the thread loop
+// when publishing the timestamp to shared memory.
+status_t AudioFlinger::PlaybackThread::Track::getLatchedTimestamp_l(
+        PlaybackThread *playbackThread, AudioTimestamp& timestamp)
+{
+    if (!playbackThread->mLatchQValid) {
+        mPreviousValid = false;
+        return INVALID_OPERATION;
+    }
+    uint32_t unpresentedFrames =
+            ((int64_t) playbackThread->mLatchQ.mUnpresentedFrames * mSampleRate) /
+            playbackThread->mSampleRate;
+    // FIXME Since we're using a raw pointer as the key, it is theoretically possible
+    //       for a brand new track to share the same address as a recently destroyed
+    //       track, and thus for us to get the frames released of the wrong track.
+    //       It is unlikely that we would be able to call getTimestamp() so quickly
+    //       right after creating a new track.  Nevertheless, the index here should
+    //       be changed to something that is unique.  Or use a completely different strategy.
+    ssize_t i = playbackThread->mLatchQ.mFramesReleased.indexOfKey(this);
+    uint32_t framesWritten = i >= 0 ?
+            playbackThread->mLatchQ.mFramesReleased[i] :
+            mAudioTrackServerProxy->framesReleased();
+    bool checkPreviousTimestamp = mPreviousValid && framesWritten >= mPreviousFramesWritten;
+    if (framesWritten < unpresentedFrames) {
+        mPreviousValid = false;
+        return INVALID_OPERATION;
+    }
+    mPreviousFramesWritten = framesWritten;
+    uint32_t position = framesWritten - unpresentedFrames;
+    struct timespec time = playbackThread->mLatchQ.mTimestamp.mTime;
+    if (checkPreviousTimestamp) {
+        if (time.tv_sec < mPreviousTimestamp.mTime.tv_sec ||
+                (time.tv_sec == mPreviousTimestamp.mTime.tv_sec &&
+                time.tv_nsec < mPreviousTimestamp.mTime.tv_nsec)) {
+            ALOGW("Time is going backwards");
+        }
+        // position can bobble slightly as an artifact; this hides the bobble
+        static const uint32_t MINIMUM_POSITION_DELTA = 8u;
+        if ((position <= mPreviousTimestamp.mPosition) ||
+                (position - mPreviousTimestamp.mPosition) < MINIMUM_POSITION_DELTA) {
+            position = mPreviousTimestamp.mPosition;
+            time = mPreviousTimestamp.mTime;
+        }
+    }
+    timestamp.mPosition = position;
+    timestamp.mTime = time;
+    mPreviousTimestamp = timestamp;
+    mPreviousValid = true;
+    return NO_ERROR;
+}
+
 status_t AudioFlinger::PlaybackThread::Track::attachAuxEffect(int EffectId)
 {
     status_t status = DEAD_OBJECT;
@@ -34,6 +34,67 @@ LOCAL_MODULE_TAGS := tests
 
 include $(BUILD_EXECUTABLE)
 
+#
+# NBLog unit test
+#
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libutils \
+	libcutils \
+	libstlport \
+	libbinder \
+	libnbaio
+
+LOCAL_STATIC_LIBRARIES := \
+	libgtest \
+	libgtest_main
+
+LOCAL_C_INCLUDES := \
+	bionic \
+	bionic/libstdc++/include \
+	external/gtest/include \
+	external/stlport/stlport
+
+LOCAL_SRC_FILES := \
+	nblog_tests.cpp
+
+LOCAL_MODULE := nblog_tests
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_EXECUTABLE)
+
+#
+# shared timestamp unit test
+#
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libutils \
+	libcutils \
+	libstlport \
+	libmedia
+
+LOCAL_STATIC_LIBRARIES := \
+	libgtest \
+	libgtest_main
+
+LOCAL_C_INCLUDES := \
+	bionic \
+	bionic/libstdc++/include \
+	external/gtest/include \
+	external/stlport/stlport
+
+LOCAL_SRC_FILES := \
+	timestamp_tests.cpp
+
+LOCAL_MODULE := timestamp_tests
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_EXECUTABLE)
+
 #
 # audio mixer test tool
 #
@@ -71,3 +132,111 @@ LOCAL_MODULE:= test-mixer
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_EXECUTABLE)
+
+#
+# playback harness tool
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	test-playback-harness.cpp \
+	../AudioMixer.cpp.arm \
+
+LOCAL_C_INCLUDES := \
+	bionic \
+	bionic/libstdc++/include \
+	external/stlport/stlport \
+	$(call include-path-for, audio-effects) \
+	$(call include-path-for, audio-utils) \
+	frameworks/av/services/audioflinger
+
+LOCAL_STATIC_LIBRARIES := \
+	libsndfile
+
+LOCAL_SHARED_LIBRARIES := \
+	libstlport \
+	libeffects \
+	libnbaio \
+	libcommon_time_client \
+	libaudioresampler \
+	libaudioutils \
+	libmedia \
+	libdl \
+	libcutils \
+	libutils \
+	liblog
+
+LOCAL_MODULE:= test-playback-harness
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+#
+# playback harness tool, host build
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	test-playback-harness.cpp \
+	../AudioMixer.cpp \
+	../AudioResampler.cpp \
+	../AudioResamplerCubic.cpp \
+	../AudioResamplerSinc.cpp \
+	../AudioResamplerDyn.cpp \
+	../../../media/libmedia/AudioTrackShared.cpp \
+	../../../media/libnbaio/NBLog.cpp \
+	../../../media/libnbaio/roundup.c \
+	../../../media/libeffects/factory/EffectsFactory.c
+
+LOCAL_C_INCLUDES := \
+	$(call include-path-for, audio-effects) \
+	$(call include-path-for, audio-utils) \
+	frameworks/av/services/audioflinger \
+	frameworks/av/media/libeffects/factory
+
+LOCAL_STATIC_LIBRARIES := \
+	libsndfile \
+	libaudioutils \
+	libcommon_time_client \
+	libbinder \
+	libcutils \
+	libutils \
+	liblog
+
+LOCAL_LDLIBS := -ldl -lpthread -lrt
+
+LOCAL_MODULE:= test-playback-harness
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+#
+# effect bundle benchmark tool
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	effect_bundle_benchmark.cpp
+
+LOCAL_C_INCLUDES := \
+	bionic \
+	bionic/libstdc++/include \
+	external/stlport/stlport \
+	$(call include-path-for, audio-effects) \
+	$(call include-path-for, audio-utils)
+
+LOCAL_SHARED_LIBRARIES := \
+	libstlport \
+	libaudioutils \
+	libdl \
+	libcutils \
+	libutils \
+	liblog
+
+LOCAL_MODULE:= effect_bundle_benchmark
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
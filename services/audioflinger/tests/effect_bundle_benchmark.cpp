@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include <audio_utils/primitives.h>
+#include <hardware/audio_effect.h>
+
+/* Drives N audio sessions, each with an equalizer and bass boost from the LVM effect bundle,
+ * the way AudioFlinger::EffectChain does for per-application effects.  Reports the time per
+ * mix period when the chains are processed serially, and when they are split between two
+ * threads with private output buffers as in PlaybackThread::processEffectChains_l().
+ * The outputs of both modes are compared to verify they are identical.
+ */
+
+static const char *kBundlePath = "/system/lib/soundfx/libbundlewrapper.so";
+
+static const effect_uuid_t kEqualizerUuid =
+        {0xce772f20, 0x847d, 0x11df, 0xbb17, {0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b}};
+static const effect_uuid_t kBassBoostUuid =
+        {0x8631f300, 0x72e2, 0x11df, 0xb57e, {0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b}};
+
+static void usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-n sessions] [-f frames] [-p periods] [-s sample-rate]\n", name);
+    fprintf(stderr, "    -n    number of sessions, default 4, at most 16\n");
+    fprintf(stderr, "    -f    frames per mix period, default 1024\n");
+    fprintf(stderr, "    -p    number of mix periods, default 1000\n");
+    fprintf(stderr, "    -s    sample rate, default 48000\n");
+}
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct Session {
+    effect_handle_t mEqualizer;
+    effect_handle_t mBassBoost;
+    std::vector<int16_t> mInBuffer;         // session mix, processed in place by the equalizer
+    std::vector<int16_t> mPrivateOutBuffer; // bass boost output when processed concurrently
+};
+
+static int configure(effect_handle_t handle, int16_t *in, int16_t *out,
+        uint32_t sampleRate, size_t frameCount)
+{
+    effect_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.inputCfg.buffer.frameCount = frameCount;
+    config.inputCfg.buffer.s16 = in;
+    config.inputCfg.samplingRate = sampleRate;
+    config.inputCfg.channels = AUDIO_CHANNEL_OUT_STEREO;
+    config.inputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
+    config.inputCfg.accessMode = EFFECT_BUFFER_ACCESS_READ;
+    config.inputCfg.mask = EFFECT_CONFIG_ALL;
+    config.outputCfg = config.inputCfg;
+    config.outputCfg.buffer.s16 = out;
+    config.outputCfg.accessMode = in != out ?
+            EFFECT_BUFFER_ACCESS_ACCUMULATE : EFFECT_BUFFER_ACCESS_WRITE;
+    int reply = 0;
+    uint32_t replySize = sizeof(reply);
+    int status = (*handle)->command(handle, EFFECT_CMD_SET_CONFIG, sizeof(config), &config,
+            &replySize, &reply);
+    if (status == 0) {
+        replySize = sizeof(reply);
+        status = (*handle)->command(handle, EFFECT_CMD_ENABLE, 0, NULL, &replySize, &reply);
+    }
+    return status != 0 ? status : reply;
+}
+
+// Create and configure an equalizer and bass boost for each session.  The bass boost, last in
+// the chain, accumulates into out, or into the session private buffer if usePrivateOutBuffer.
+static int createSessions(audio_effect_library_t *desc, std::vector<Session>& sessions,
+        int firstSessionId, int16_t *out, bool usePrivateOutBuffer, uint32_t sampleRate,
+        size_t frameCount)
+{
+    for (size_t i = 0; i < sessions.size(); i++) {
+        Session& session = sessions[i];
+        session.mInBuffer.resize(frameCount * 2);
+        session.mPrivateOutBuffer.resize(frameCount * 2);
+        int sessionId = firstSessionId + i;
+        if (desc->create_effect(&kEqualizerUuid, sessionId, 0, &session.mEqualizer) != 0 ||
+                desc->create_effect(&kBassBoostUuid, sessionId, 0, &session.mBassBoost) != 0) {
+            fprintf(stderr, "failed to create effects for session %d\n", sessionId);
+            return -1;
+        }
+        int16_t *in = &session.mInBuffer[0];
+        if (configure(session.mEqualizer, in, in, sampleRate, frameCount) != 0 ||
+                configure(session.mBassBoost, in,
+                        usePrivateOutBuffer ? &session.mPrivateOutBuffer[0] : out,
+                        sampleRate, frameCount) != 0) {
+            fprintf(stderr, "failed to configure effects for session %d\n", sessionId);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void processSession(Session& session, int16_t *out)
+{
+    audio_buffer_t in, inPlace, bassOut;
+    size_t frameCount = session.mInBuffer.size() / 2;
+    in.frameCount = inPlace.frameCount = bassOut.frameCount = frameCount;
+    in.s16 = inPlace.s16 = &session.mInBuffer[0];
+    bassOut.s16 = out;
+    (*session.mEqualizer)->process(session.mEqualizer, &in, &inPlace);
+    (*session.mBassBoost)->process(session.mBassBoost, &in, &bassOut);
+}
+
+static void fillSessionInput(std::vector<Session>& sessions, int period)
+{
+    for (size_t i = 0; i < sessions.size(); i++) {
+        std::vector<int16_t>& buffer = sessions[i].mInBuffer;
+        for (size_t j = 0; j < buffer.size(); j++) {
+            buffer[j] = (int16_t) (((j + period * 7 + i * 131) * 2654435761u) >> 20);
+        }
+    }
+}
+
+struct WorkerArgs {
+    std::vector<Session> *mSessions;
+    pthread_mutex_t mLock;
+    pthread_cond_t mCond;
+    bool mPending;
+    bool mExit;
+};
+
+static void *workerLoop(void *arg)
+{
+    WorkerArgs *args = (WorkerArgs *) arg;
+    std::vector<Session>& sessions = *args->mSessions;
+    for (;;) {
+        pthread_mutex_lock(&args->mLock);
+        while (!args->mPending && !args->mExit) {
+            pthread_cond_wait(&args->mCond, &args->mLock);
+        }
+        bool exit = args->mExit;
+        pthread_mutex_unlock(&args->mLock);
+        if (exit) {
+            break;
+        }
+        // odd sessions run on the worker
+        for (size_t i = 1; i < sessions.size(); i += 2) {
+            processSession(sessions[i], &sessions[i].mPrivateOutBuffer[0]);
+        }
+        pthread_mutex_lock(&args->mLock);
+        args->mPending = false;
+        pthread_cond_broadcast(&args->mCond);
+        pthread_mutex_unlock(&args->mLock);
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    const char* const progname = argv[0];
+    size_t numSessions = 4;
+    size_t frameCount = 1024;
+    int periods = 1000;
+    uint32_t sampleRate = 48000;
+    for (int ch; (ch = getopt(argc, argv, "n:f:p:s:")) != -1;) {
+        switch (ch) {
+        case 'n':
+            numSessions = atoi(optarg);
+            break;
+        case 'f':
+            frameCount = atoi(optarg);
+            break;
+        case 'p':
+            periods = atoi(optarg);
+            break;
+        case 's':
+            sampleRate = atoi(optarg);
+            break;
+        default:
+            usage(progname);
+            return EXIT_FAILURE;
+        }
+    }
+    if (numSessions == 0 || frameCount == 0 || periods <= 0) {
+        usage(progname);
+        return EXIT_FAILURE;
+    }
+
+    void *library = dlopen(kBundlePath, RTLD_NOW);
+    if (library == NULL) {
+        fprintf(stderr, "dlopen %s failed: %s\n", kBundlePath, dlerror());
+        return EXIT_FAILURE;
+    }
+    audio_effect_library_t *desc = (audio_effect_library_t *) dlsym(library,
+            AUDIO_EFFECT_LIBRARY_INFO_SYM_AS_STR);
+    if (desc == NULL || desc->tag != AUDIO_EFFECT_LIBRARY_TAG) {
+        fprintf(stderr, "invalid effect library %s\n", kBundlePath);
+        return EXIT_FAILURE;
+    }
+
+    // separate effect instances for each mode, so both start from the same state
+    size_t numSamples = frameCount * 2;
+    std::vector<Session> serialSessions(numSessions), sessions(numSessions);
+    std::vector<int16_t> serialOut(numSamples), parallelOut(numSamples);
+    if (createSessions(desc, serialSessions, 1, &serialOut[0], false, sampleRate,
+                frameCount) != 0 ||
+            createSessions(desc, sessions, 1 + numSessions, NULL, true, sampleRate,
+                frameCount) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    // serial: every chain accumulates directly into the shared output
+    int64_t serialNs = 0;
+    std::vector<int16_t> serialLast;
+    for (int period = 0; period < periods; period++) {
+        memset(&serialOut[0], 0, numSamples * sizeof(int16_t));
+        fillSessionInput(serialSessions, period);
+        int64_t start = nowNs();
+        for (size_t i = 0; i < numSessions; i++) {
+            processSession(serialSessions[i], &serialOut[0]);
+        }
+        serialNs += nowNs() - start;
+    }
+    serialLast = serialOut;
+
+    // parallel: split between this thread and a worker
+    WorkerArgs args;
+    args.mSessions = &sessions;
+    pthread_mutex_init(&args.mLock, NULL);
+    pthread_cond_init(&args.mCond, NULL);
+    args.mPending = false;
+    args.mExit = false;
+    pthread_t worker;
+    pthread_create(&worker, NULL, workerLoop, &args);
+    int64_t parallelNs = 0;
+    for (int period = 0; period < periods; period++) {
+        memset(&parallelOut[0], 0, numSamples * sizeof(int16_t));
+        fillSessionInput(sessions, period);
+        int64_t start = nowNs();
+        pthread_mutex_lock(&args.mLock);
+        args.mPending = true;
+        pthread_cond_broadcast(&args.mCond);
+        pthread_mutex_unlock(&args.mLock);
+        for (size_t i = 0; i < numSessions; i += 2) {
+            processSession(sessions[i], &sessions[i].mPrivateOutBuffer[0]);
+        }
+        pthread_mutex_lock(&args.mLock);
+        while (args.mPending) {
+            pthread_cond_wait(&args.mCond, &args.mLock);
+        }
+        pthread_mutex_unlock(&args.mLock);
+        // accumulate in session order, as serial processing would
+        for (size_t i = 0; i < numSessions; i++) {
+            int16_t *priv = &sessions[i].mPrivateOutBuffer[0];
+            for (size_t j = 0; j < numSamples; j++) {
+                parallelOut[j] = clamp16((int32_t) parallelOut[j] + (int32_t) priv[j]);
+            }
+            memset(priv, 0, numSamples * sizeof(int16_t));
+        }
+        parallelNs += nowNs() - start;
+    }
+    pthread_mutex_lock(&args.mLock);
+    args.mExit = true;
+    pthread_cond_broadcast(&args.mCond);
+    pthread_mutex_unlock(&args.mLock);
+    pthread_join(worker, NULL);
+
+    double periodUs = frameCount * 1e6 / sampleRate;
+    printf("%zu sessions, %zu frames per period (%.0f us), %d periods\n",
+            numSessions, frameCount, periodUs, periods);
+    printf("serial:   %8.1f us per period, %5.1f%% of period\n",
+            serialNs * 1e-3 / periods, serialNs * 1e-1 / periods / periodUs);
+    printf("parallel: %8.1f us per period, %5.1f%% of period\n",
+            parallelNs * 1e-3 / periods, parallelNs * 1e-1 / periods / periodUs);
+    bool same = memcmp(&serialLast[0], &parallelOut[0], numSamples * sizeof(int16_t)) == 0;
+    printf("last period output %s\n", same ? "identical" : "DIFFERS");
+
+    for (size_t i = 0; i < numSessions; i++) {
+        desc->release_effect(serialSessions[i].mBassBoost);
+        desc->release_effect(serialSessions[i].mEqualizer);
+        desc->release_effect(sessions[i].mBassBoost);
+        desc->release_effect(sessions[i].mEqualizer);
+    }
+    dlclose(library);
+    return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audioflinger_nblog_tests"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <cutils/log.h>
+#include <gtest/gtest.h>
+#include <media/nbaio/NBLog.h>
+
+using android::NBLog;
+
+static const size_t kLogSize = 64 * 1024;
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// read back everything the reader has not yet consumed, in the compact export format
+static void exportToVector(NBLog::Reader& reader, std::vector<uint8_t>& out)
+{
+    FILE *file = tmpfile();
+    ASSERT_TRUE(file != NULL);
+    ASSERT_EQ(reader.exportBinary(fileno(file)), android::NO_ERROR);
+    long size = ftell(file);
+    ASSERT_GE(size, (long) sizeof(NBLog::ExportHeader));
+    out.resize(size);
+    rewind(file);
+    ASSERT_EQ(fread(&out[0], 1, size, file), (size_t) size);
+    fclose(file);
+}
+
+TEST(audioflinger_nblog, binary_round_trip) {
+    std::vector<uint8_t> shared(NBLog::Timeline::sharedSize(kLogSize));
+    NBLog::Writer writer(kLogSize, &shared[0]);
+    NBLog::Reader reader(kLogSize, &shared[0]);
+
+    writer.logEvent(1);
+    writer.logEvent(2, -7, 42);
+    writer.log("text");
+    writer.logEvent(3, 1, 2, 3, 4);
+
+    std::vector<uint8_t> exported;
+    exportToVector(reader, exported);
+
+    NBLog::ExportHeader header;
+    memcpy(&header, &exported[0], sizeof(header));
+    EXPECT_EQ(header.mMagic, NBLog::kExportMagic);
+    EXPECT_EQ(header.mVersion, NBLog::kExportVersion);
+    EXPECT_EQ(header.mLost, 0u);
+    ASSERT_EQ(header.mHeaderSize + header.mLength, exported.size());
+
+    // walk the entries as an offline tool would
+    static const int32_t expectedArgs[][4] = { {0}, {-7, 42}, {0}, {1, 2, 3, 4} };
+    static const uint16_t expectedIds[] = { 1, 2, 0, 3 };
+    static const size_t expectedArgc[] = { 0, 2, 0, 4 };
+    size_t entry = 0;
+    int64_t prevTimeNs = 0;
+    for (size_t i = header.mHeaderSize; i < exported.size(); ++entry) {
+        uint8_t event = exported[i];
+        uint8_t length = exported[i + 1];
+        ASSERT_LT(entry, sizeof(expectedIds) / sizeof(expectedIds[0]));
+        ASSERT_EQ(exported[i + 2 + length], length);
+        if (expectedIds[entry] == 0) {
+            // the string event, which is not binary
+            EXPECT_EQ(length, 4);
+            EXPECT_EQ(memcmp(&exported[i + 2], "text", 4), 0);
+        } else {
+            // BinaryEvent is private, so decode the documented layout directly
+            int64_t timeNs;
+            uint16_t id;
+            memcpy(&timeNs, &exported[i + 2], sizeof(timeNs));
+            memcpy(&id, &exported[i + 2 + 8], sizeof(id));
+            uint8_t argc = exported[i + 2 + 10];
+            EXPECT_EQ(id, expectedIds[entry]);
+            ASSERT_EQ(argc, expectedArgc[entry]);
+            ASSERT_EQ(length, 12 + argc * sizeof(int32_t));
+            EXPECT_GE(timeNs, prevTimeNs);
+            prevTimeNs = timeNs;
+            for (size_t k = 0; k < argc; ++k) {
+                int32_t arg;
+                memcpy(&arg, &exported[i + 2 + 12 + k * sizeof(int32_t)], sizeof(arg));
+                EXPECT_EQ(arg, expectedArgs[entry][k]);
+            }
+        }
+        (void) event;
+        i += length + 3;
+    }
+    EXPECT_EQ(entry, sizeof(expectedIds) / sizeof(expectedIds[0]));
+
+    // everything was consumed by the export
+    exportToVector(reader, exported);
+    memcpy(&header, &exported[0], sizeof(header));
+    EXPECT_EQ(header.mLength, 0u);
+}
+
+TEST(audioflinger_nblog, binary_wraparound) {
+    std::vector<uint8_t> shared(NBLog::Timeline::sharedSize(256));
+    NBLog::Writer writer(256, &shared[0]);
+    NBLog::Reader reader(256, &shared[0]);
+
+    for (int i = 0; i < 100; ++i) {
+        writer.logEvent(7, i);
+    }
+    std::vector<uint8_t> exported;
+    exportToVector(reader, exported);
+    NBLog::ExportHeader header;
+    memcpy(&header, &exported[0], sizeof(header));
+    EXPECT_GT(header.mLost, 0u);
+    ASSERT_GT(header.mLength, 0u);
+
+    // the newest entries survive and are intact
+    int32_t last;
+    memcpy(&last, &exported[exported.size() - 1 - sizeof(int32_t)], sizeof(last));
+    EXPECT_EQ(last, 99);
+}
+
+TEST(audioflinger_nblog, export_error) {
+    std::vector<uint8_t> shared(NBLog::Timeline::sharedSize(kLogSize));
+    NBLog::Writer writer(kLogSize, &shared[0]);
+    NBLog::Reader reader(kLogSize, &shared[0]);
+
+    writer.logEvent(1, 2);
+    // a failed export must say so, whatever errno was left behind
+    int fd = open("/dev/null", O_RDONLY);
+    ASSERT_GE(fd, 0);
+    android::status_t status = reader.exportBinary(fd);
+    close(fd);
+    EXPECT_LT(status, 0);
+}
+
+// not a pass/fail test: reports the per-call cost of each logging method on this device
+TEST(audioflinger_nblog, timing) {
+    static const int kTrials = 100000;
+    std::vector<uint8_t> shared(NBLog::Timeline::sharedSize(kLogSize));
+    NBLog::Writer writer(kLogSize, &shared[0]);
+    NBLog::LockedWriter lockedWriter(kLogSize, &shared[0]);
+
+    int64_t start = nowNs();
+    for (int i = 0; i < kTrials; ++i) {
+        writer.logf("underrun track %d frames %d", i, 256);
+    }
+    int64_t logfNs = nowNs() - start;
+
+    start = nowNs();
+    for (int i = 0; i < kTrials; ++i) {
+        writer.logEvent(1, i, 256);
+    }
+    int64_t eventNs = nowNs() - start;
+
+    start = nowNs();
+    for (int i = 0; i < kTrials; ++i) {
+        lockedWriter.logEvent(1, i, 256);
+    }
+    int64_t lockedEventNs = nowNs() - start;
+
+    printf("logf:                  %6.1f ns per call\n", (double) logfNs / kTrials);
+    printf("logEvent:              %6.1f ns per call\n", (double) eventNs / kTrials);
+    printf("LockedWriter logEvent: %6.1f ns per call\n", (double) lockedEventNs / kTrials);
+}
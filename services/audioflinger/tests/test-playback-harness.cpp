@@ -0,0 +1,653 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <new>
+#include <vector>
+#include <audio_utils/primitives.h>
+#include <audio_utils/sndfile.h>
+#include <hardware/audio.h>
+#include <media/AudioBufferProvider.h>
+#include <private/media/AudioTrackShared.h>
+#include "AudioMixer.h"
+#include "MixerReadiness.h"
+#include "test_utils.h"
+
+/* Offline playback harness.
+ *
+ * Runs the normal mixer cycle (prepare tracks, mix, write to the HAL) against
+ * a simulated audio_stream_out, with each track fed through a real
+ * audio_track_cblk_t shared by an AudioTrackClientProxy and an
+ * AudioTrackServerProxy, exactly as between AudioTrack and AudioFlinger.
+ * Tracks are prepared with MixerReadiness, the rules MixerThread::prepareTracks_l()
+ * applies to normal tracks, and mixed by the real AudioMixer.
+ *
+ * By default the simulated HAL is clocked by a virtual timer, so a run is
+ * deterministic and completes as fast as the host can mix; with -r the HAL
+ * blocks on CLOCK_MONOTONIC like a real device, and wake-up jitter is measured.
+ *
+ * The report covers mixer CPU per cycle, wake-up jitter, HAL and track underruns,
+ * and end-to-end latency from client write to presentation at the simulated HAL.
+ */
+
+using namespace android;
+
+static void usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-r] [-s sample-rate] [-f mixer-frames] [-b hal-periods]"
+                    " [-t track-frames] [-p client-period-ms] [-l every,delay-ms]"
+                    " [-d seconds] [-u max-underruns]"
+                    " (<input-file> | <command>)+\n", name);
+    fprintf(stderr, "    -r    clock the simulated HAL from CLOCK_MONOTONIC (default virtual)\n");
+    fprintf(stderr, "    -s    mixer sample-rate\n");
+    fprintf(stderr, "    -f    mixer frames per cycle\n");
+    fprintf(stderr, "    -b    number of mixer periods buffered by the simulated HAL\n");
+    fprintf(stderr, "    -t    frames in each track's shared buffer\n");
+    fprintf(stderr, "    -p    interval between client writes, in milliseconds\n");
+    fprintf(stderr, "    -l    delay every N-th client write by the given milliseconds\n");
+    fprintf(stderr, "    -d    duration of the run in seconds\n");
+    fprintf(stderr, "    -u    exit with failure if total track underruns exceed this\n");
+    fprintf(stderr, "    <input-file> is a WAV file, pcm16\n");
+    fprintf(stderr, "    <command> can be 'sine:<channels>,<frequency>,<samplerate>'\n");
+    fprintf(stderr, "                     'chirp:<channels>,<samplerate>'\n");
+}
+
+static inline int64_t systemTimeNs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Collects one measurement per event, in nanoseconds, and prints a summary.
+class Series {
+public:
+    void add(int64_t ns) { mSamples.push_back(ns); }
+
+    size_t size() const { return mSamples.size(); }
+
+    int64_t sum() const {
+        int64_t total = 0;
+        for (size_t i = 0; i < mSamples.size(); ++i) {
+            total += mSamples[i];
+        }
+        return total;
+    }
+
+    void print(const char *name) {
+        if (mSamples.empty()) {
+            printf("  %-14s n/a\n", name);
+            return;
+        }
+        std::sort(mSamples.begin(), mSamples.end());
+        const size_t n = mSamples.size();
+        printf("  %-14s min %8.3f  mean %8.3f  p99 %8.3f  max %8.3f ms  (n=%zu)\n", name,
+                mSamples[0] * 1e-6, (double) sum() / n * 1e-6,
+                mSamples[std::min(n - 1, n * 99 / 100)] * 1e-6, mSamples[n - 1] * 1e-6, n);
+    }
+
+private:
+    std::vector<int64_t> mSamples;
+};
+
+// ----------------------------------------------------------------------------
+
+// Simulated HAL output stream.  The kernel buffer holds a fixed number of frames
+// which are consumed at the nominal sample rate from the first write onwards.
+// write() blocks until there is room, either by advancing the virtual clock or by
+// sleeping until the deadline on CLOCK_MONOTONIC.
+struct SimulatedStreamOut {
+    struct audio_stream_out stream;     // must be first
+
+    uint32_t    mSampleRate;
+    size_t      mFrameSize;
+    size_t      mPeriodFrames;
+    size_t      mCapacity;              // frames held by the simulated kernel buffer
+    bool        mRealtime;
+
+    int64_t     mNow;                   // virtual clock in ns, or last real wake-up time
+    bool        mStarted;
+    int64_t     mStartNs;               // time at which frame mStartFrame began to play
+    uint64_t    mStartFrame;
+    uint64_t    mWritten;               // total frames accepted by write()
+    uint32_t    mGlitches;              // times the kernel buffer ran dry
+    Series      mJitter;                // realtime only: actual wake-up minus deadline
+
+    SimulatedStreamOut(uint32_t sampleRate, size_t frameSize, size_t periodFrames,
+            size_t periods, bool realtime);
+
+    int64_t now() {
+        if (mRealtime) {
+            mNow = systemTimeNs(CLOCK_MONOTONIC);
+        }
+        return mNow;
+    }
+
+    // frames played by the given time, not limited to the frames written
+    uint64_t framesPlayedAt(int64_t ns) const {
+        if (!mStarted || ns <= mStartNs) {
+            return mStartFrame;
+        }
+        return mStartFrame + (uint64_t) (ns - mStartNs) * mSampleRate / 1000000000LL;
+    }
+
+    // time at which the given frame will be presented, assuming no further glitches
+    int64_t presentationTimeNs(uint64_t frame) const {
+        return mStartNs + (int64_t) ((frame - mStartFrame) * 1000000000LL / mSampleRate);
+    }
+
+    void sleepUntil(int64_t deadline) {
+        if (!mRealtime) {
+            mNow = deadline;
+            return;
+        }
+        struct timespec ts;
+        ts.tv_sec = deadline / 1000000000LL;
+        ts.tv_nsec = deadline % 1000000000LL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+        mNow = systemTimeNs(CLOCK_MONOTONIC);
+        mJitter.add(mNow - deadline);
+    }
+
+    ssize_t write(const void* buffer __unused, size_t bytes) {
+        const size_t frames = bytes / mFrameSize;
+        int64_t ns = now();
+        if (!mStarted) {
+            mStarted = true;
+            mStartNs = ns;
+            mStartFrame = mWritten;
+        } else if (framesPlayedAt(ns) > mWritten) {
+            // the mixer was late and the kernel buffer ran dry; playback restarts now
+            mGlitches++;
+            mStartNs = ns;
+            mStartFrame = mWritten;
+        }
+        if (mWritten + frames - framesPlayedAt(ns) > mCapacity) {
+            const uint64_t frame = mWritten + frames - mCapacity;
+            sleepUntil(presentationTimeNs(frame));
+        }
+        mWritten += frames;
+        return bytes;
+    }
+
+    static SimulatedStreamOut *from(const struct audio_stream *stream) {
+        return (SimulatedStreamOut *) stream;
+    }
+
+    static SimulatedStreamOut *from(const struct audio_stream_out *stream) {
+        return (SimulatedStreamOut *) stream;
+    }
+
+    static uint32_t out_get_sample_rate(const struct audio_stream *stream) {
+        return from(stream)->mSampleRate;
+    }
+
+    static size_t out_get_buffer_size(const struct audio_stream *stream) {
+        return from(stream)->mPeriodFrames * from(stream)->mFrameSize;
+    }
+
+    static audio_channel_mask_t out_get_channels(const struct audio_stream *stream __unused) {
+        return AUDIO_CHANNEL_OUT_STEREO;
+    }
+
+    static audio_format_t out_get_format(const struct audio_stream *stream __unused) {
+        return AUDIO_FORMAT_PCM_16_BIT;
+    }
+
+    static int out_standby(struct audio_stream *stream __unused) {
+        return 0;
+    }
+
+    static uint32_t out_get_latency(const struct audio_stream_out *stream) {
+        return from(stream)->mCapacity * 1000 / from(stream)->mSampleRate;
+    }
+
+    static ssize_t out_write(struct audio_stream_out *stream, const void* buffer, size_t bytes) {
+        return from(stream)->write(buffer, bytes);
+    }
+
+    static int out_get_render_position(const struct audio_stream_out *stream,
+            uint32_t *dsp_frames) {
+        SimulatedStreamOut *out = from(stream);
+        *dsp_frames = (uint32_t) std::min(out->framesPlayedAt(out->now()), out->mWritten);
+        return 0;
+    }
+
+    static int out_get_presentation_position(const struct audio_stream_out *stream,
+            uint64_t *frames, struct timespec *timestamp) {
+        SimulatedStreamOut *out = from(stream);
+        const int64_t ns = out->now();
+        *frames = std::min(out->framesPlayedAt(ns), out->mWritten);
+        timestamp->tv_sec = ns / 1000000000LL;
+        timestamp->tv_nsec = ns % 1000000000LL;
+        return 0;
+    }
+};
+
+SimulatedStreamOut::SimulatedStreamOut(uint32_t sampleRate, size_t frameSize,
+        size_t periodFrames, size_t periods, bool realtime)
+    : mSampleRate(sampleRate), mFrameSize(frameSize), mPeriodFrames(periodFrames),
+      mCapacity(periodFrames * periods), mRealtime(realtime),
+      mNow(0), mStarted(false), mStartNs(0), mStartFrame(0), mWritten(0), mGlitches(0)
+{
+    memset(&stream, 0, sizeof(stream));
+    stream.common.get_sample_rate = out_get_sample_rate;
+    stream.common.get_buffer_size = out_get_buffer_size;
+    stream.common.get_channels = out_get_channels;
+    stream.common.get_format = out_get_format;
+    stream.common.standby = out_standby;
+    stream.get_latency = out_get_latency;
+    stream.write = out_write;
+    stream.get_render_position = out_get_render_position;
+    stream.get_presentation_position = out_get_presentation_position;
+    now();
+}
+
+// ----------------------------------------------------------------------------
+
+// One streaming track.  The control block and data are allocated together as
+// AudioFlinger does for a client track.  The client side copies from a signal
+// provider, looping it, and the server side is the mixer's buffer provider.
+class HarnessTrack : public AudioBufferProvider {
+public:
+    HarnessTrack(SignalProvider *source, size_t frameCount);
+    virtual ~HarnessTrack();
+
+    // AudioBufferProvider interface, as PlaybackThread::Track
+    virtual status_t getNextBuffer(AudioBufferProvider::Buffer* buffer, int64_t pts);
+    virtual void releaseBuffer(AudioBufferProvider::Buffer* buffer);
+
+    // Non-blocking client write of up to the given frames; returns frames written.
+    size_t write(size_t frames);
+
+    SignalProvider * const          mSource;
+    const size_t                    mFrameCount;
+    const size_t                    mFrameSize;
+    audio_track_cblk_t*             mCblk;
+    sp<AudioTrackClientProxy>       mClientProxy;
+    sp<AudioTrackServerProxy>       mServerProxy;
+    int32_t                         mName;          // mixer track name
+
+    // client schedule
+    uint32_t                        mWriteIndex;    // client writes scheduled so far
+    size_t                          mPending;       // frames scheduled but not yet written
+    uint64_t                        mClientFrames;  // total frames written by client
+
+    // server state
+    bool                            mStarted;       // filled once, as Track::isReady()
+    uint32_t                        mUnderrunCycles;
+
+    struct Marker {
+        uint64_t    mFrame;     // client position after a write
+        int64_t     mNs;        // time of that write
+    };
+    std::deque<Marker>              mMarkers;
+    Series                          mLatency;
+};
+
+HarnessTrack::HarnessTrack(SignalProvider *source, size_t frameCount)
+    : mSource(source),
+      mFrameCount(frameCount),
+      mFrameSize(source->getNumChannels() * sizeof(int16_t)),
+      mCblk(NULL), mName(-1),
+      mWriteIndex(0), mPending(0), mClientFrames(0),
+      mStarted(false), mUnderrunCycles(0)
+{
+    const size_t size = sizeof(audio_track_cblk_t) + frameCount * mFrameSize;
+    mCblk = (audio_track_cblk_t *) calloc(1, size);
+    new(mCblk) audio_track_cblk_t();
+    void *buffers = (char *) mCblk + sizeof(audio_track_cblk_t);
+    mClientProxy = new AudioTrackClientProxy(mCblk, buffers, frameCount, mFrameSize);
+    mServerProxy = new AudioTrackServerProxy(mCblk, buffers, frameCount, mFrameSize,
+            false /*clientInServer*/, source->getSampleRate());
+}
+
+HarnessTrack::~HarnessTrack()
+{
+    mClientProxy.clear();
+    mServerProxy.clear();
+    mCblk->~audio_track_cblk_t();
+    free(mCblk);
+}
+
+status_t HarnessTrack::getNextBuffer(AudioBufferProvider::Buffer* buffer, int64_t pts __unused)
+{
+    ServerProxy::Buffer buf;
+    size_t desiredFrames = buffer->frameCount;
+    buf.mFrameCount = desiredFrames;
+    status_t status = mServerProxy->obtainBuffer(&buf);
+    buffer->frameCount = buf.mFrameCount;
+    buffer->raw = buf.mRaw;
+    if (buf.mFrameCount == 0) {
+        mServerProxy->tallyUnderrunFrames(desiredFrames);
+    }
+    return status;
+}
+
+void HarnessTrack::releaseBuffer(AudioBufferProvider::Buffer* buffer)
+{
+    ServerProxy::Buffer buf;
+    buf.mFrameCount = buffer->frameCount;
+    buf.mRaw = buffer->raw;
+    buffer->frameCount = 0;
+    buffer->raw = NULL;
+    mServerProxy->releaseBuffer(&buf);
+}
+
+size_t HarnessTrack::write(size_t frames)
+{
+    size_t written = 0;
+    while (written < frames) {
+        Proxy::Buffer buf;
+        buf.mFrameCount = frames - written;
+        if (mClientProxy->obtainBuffer(&buf, &ClientProxy::kNonBlocking) != NO_ERROR) {
+            break;
+        }
+        const size_t obtained = buf.mFrameCount;
+        size_t copied = 0;
+        while (copied < obtained) {
+            AudioBufferProvider::Buffer src;
+            src.frameCount = obtained - copied;
+            if (mSource->getNextBuffer(&src) != NO_ERROR) {
+                mSource->reset();   // loop the input
+                continue;
+            }
+            memcpy((char *) buf.mRaw + copied * mFrameSize, src.raw, src.frameCount * mFrameSize);
+            copied += src.frameCount;
+            mSource->releaseBuffer(&src);
+        }
+        mClientProxy->releaseBuffer(&buf);
+        written += obtained;
+    }
+    return written;
+}
+
+// ----------------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    const char* const progname = argv[0];
+    bool realtime = false;
+    uint32_t outputSampleRate = 48000;
+    size_t mixerFrameCount = 960;
+    size_t halPeriods = 2;
+    size_t trackFrameCount = 0;
+    uint32_t clientPeriodMs = 20;
+    uint32_t lateEvery = 0;
+    uint32_t lateDelayMs = 0;
+    double seconds = 10;
+    long maxUnderruns = -1;
+    std::vector<SignalProvider> Providers;
+
+    for (int ch; (ch = getopt(argc, argv, "rs:f:b:t:p:l:d:u:")) != -1;) {
+        switch (ch) {
+        case 'r':
+            realtime = true;
+            break;
+        case 's':
+            outputSampleRate = atoi(optarg);
+            break;
+        case 'f':
+            mixerFrameCount = atoi(optarg);
+            break;
+        case 'b':
+            halPeriods = atoi(optarg);
+            break;
+        case 't':
+            trackFrameCount = atoi(optarg);
+            break;
+        case 'p':
+            clientPeriodMs = atoi(optarg);
+            break;
+        case 'l': {
+            std::vector<int> v;
+            if (parseCSV(optarg, v) != 2 || v[0] <= 0) {
+                fprintf(stderr, "incorrect syntax for -l option\n");
+                return EXIT_FAILURE;
+            }
+            lateEvery = v[0];
+            lateDelayMs = v[1];
+            } break;
+        case 'd':
+            seconds = atof(optarg);
+            break;
+        case 'u':
+            maxUnderruns = atol(optarg);
+            break;
+        case '?':
+        default:
+            usage(progname);
+            return EXIT_FAILURE;
+        }
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (argc == 0 || outputSampleRate == 0 || mixerFrameCount == 0 || halPeriods == 0
+            || clientPeriodMs == 0) {
+        usage(progname);
+        return EXIT_FAILURE;
+    }
+    if ((unsigned)argc > AudioMixer::MAX_NUM_TRACKS) {
+        fprintf(stderr, "too many tracks: %d > %u", argc, AudioMixer::MAX_NUM_TRACKS);
+        return EXIT_FAILURE;
+    }
+    if (trackFrameCount == 0) {
+        trackFrameCount = mixerFrameCount * 4;
+    }
+
+    // create providers for each track
+    Providers.resize(argc);
+    for (int i = 0; i < argc; ++i) {
+        static const char chirp[] = "chirp:";
+        static const char sine[] = "sine:";
+        static const double kSeconds = 1;
+        std::vector<int> v;
+
+        if (!strncmp(argv[i], chirp, strlen(chirp))) {
+            if (parseCSV(argv[i] + strlen(chirp), v) == 2) {
+                Providers[i].setChirp<int16_t>(v[0], 0, v[1]/2, v[1], kSeconds);
+            }
+        } else if (!strncmp(argv[i], sine, strlen(sine))) {
+            if (parseCSV(argv[i] + strlen(sine), v) == 3) {
+                Providers[i].setSine<int16_t>(v[0], v[1], v[2], kSeconds);
+            }
+        } else {
+            Providers[i].setFile<short>(argv[i]);
+        }
+        if (Providers[i].getNumFrames() == 0 || Providers[i].getNumChannels() == 0
+                || Providers[i].getNumChannels() > 2) {
+            fprintf(stderr, "malformed or unsupported input '%s'\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // the simulated HAL and the mix buffer, pcm16 stereo as the primary output
+    const size_t outputFrameSize = 2 * sizeof(int16_t);
+    SimulatedStreamOut *output = new SimulatedStreamOut(outputSampleRate, outputFrameSize,
+            mixerFrameCount, halPeriods, realtime);
+    struct audio_stream_out *stream = &output->stream;
+    const size_t mixBufferSize = stream->common.get_buffer_size(&stream->common);
+    void *mixBuffer = NULL;
+    (void) posix_memalign(&mixBuffer, 32, mixBufferSize);
+    memset(mixBuffer, 0, mixBufferSize);
+
+    // create the mixer and the tracks
+    AudioMixer *mixer = new AudioMixer(mixerFrameCount, outputSampleRate);
+    float f = AudioMixer::UNITY_GAIN_FLOAT / Providers.size(); // normalize volume by # tracks
+    std::vector<HarnessTrack *> Tracks;
+    for (size_t i = 0; i < Providers.size(); ++i) {
+        HarnessTrack *track = new HarnessTrack(&Providers[i], trackFrameCount);
+        uint32_t channelMask = audio_channel_out_mask_from_count(Providers[i].getNumChannels());
+        track->mName = mixer->getTrackName(channelMask,
+                AUDIO_FORMAT_PCM_16_BIT, AUDIO_SESSION_OUTPUT_MIX);
+        ALOG_ASSERT(track->mName >= 0);
+        mixer->setBufferProvider(track->mName, track);
+        mixer->setParameter(track->mName, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
+                mixBuffer);
+        mixer->setParameter(track->mName, AudioMixer::TRACK, AudioMixer::MIXER_FORMAT,
+                (void *)(uintptr_t)AUDIO_FORMAT_PCM_16_BIT);
+        mixer->setParameter(track->mName, AudioMixer::TRACK, AudioMixer::FORMAT,
+                (void *)(uintptr_t)AUDIO_FORMAT_PCM_16_BIT);
+        mixer->setParameter(track->mName, AudioMixer::TRACK, AudioMixer::MIXER_CHANNEL_MASK,
+                (void *)(uintptr_t)AUDIO_CHANNEL_OUT_STEREO);
+        mixer->setParameter(track->mName, AudioMixer::TRACK, AudioMixer::CHANNEL_MASK,
+                (void *)(uintptr_t)channelMask);
+        mixer->setParameter(track->mName, AudioMixer::RESAMPLE, AudioMixer::SAMPLE_RATE,
+                (void *)(uintptr_t)Providers[i].getSampleRate());
+        mixer->setParameter(track->mName, AudioMixer::VOLUME, AudioMixer::VOLUME0, &f);
+        mixer->setParameter(track->mName, AudioMixer::VOLUME, AudioMixer::VOLUME1, &f);
+        Tracks.push_back(track);
+    }
+
+    Series mixerCpu;
+    const int64_t periodNs = (int64_t) mixerFrameCount * 1000000000LL / outputSampleRate;
+    const int64_t clientPeriodNs = clientPeriodMs * 1000000LL;
+    const int64_t startNs = output->now();
+    const int64_t durationNs = (int64_t) (seconds * 1e9);
+    size_t cycles = 0;
+    bool mixerReady = false;    // as mMixerStatusIgnoringFastTracks == MIXER_TRACKS_READY
+
+    for (;;) {
+        const int64_t now = output->now();
+        if (now - startNs >= durationNs) {
+            break;
+        }
+
+        // Clients: issue every write that is due.  Writes are serviced at mixer cycle
+        // granularity, and a write that does not fit stays pending, as a blocked client.
+        for (size_t i = 0; i < Tracks.size(); ++i) {
+            HarnessTrack *track = Tracks[i];
+            const size_t clientFrames = (size_t) ((int64_t) track->mSource->getSampleRate()
+                    * clientPeriodMs / 1000);
+            for (;;) {
+                int64_t due = startNs + track->mWriteIndex * clientPeriodNs;
+                if (lateEvery != 0 && track->mWriteIndex % lateEvery == lateEvery - 1) {
+                    due += lateDelayMs * 1000000LL;
+                }
+                if (due > now) {
+                    break;
+                }
+                track->mPending += clientFrames;
+                track->mWriteIndex++;
+            }
+            const size_t written = track->write(track->mPending);
+            if (written > 0) {
+                track->mPending -= written;
+                track->mClientFrames += written;
+                HarnessTrack::Marker marker = { track->mClientFrames, now };
+                track->mMarkers.push_back(marker);
+            }
+        }
+
+        // prepareTracks_l() and the mix.  Tracks keep playing and are never removed, so
+        // the retry count that ends a starved track does not apply.
+        const int64_t cpuStartNs = systemTimeNs(CLOCK_THREAD_CPUTIME_ID);
+        MixerReadiness readiness(mixerReady);
+        for (size_t i = 0; i < Tracks.size(); ++i) {
+            HarnessTrack *track = Tracks[i];
+            const uint32_t sr = track->mSource->getSampleRate();
+            const size_t desiredFrames = MixerReadiness::desiredFrames(mixerFrameCount,
+                    outputSampleRate, sr,
+                    sr == outputSampleRate ? 0 : mixer->getUnreleasedFrames(track->mName));
+            const size_t minFrames = readiness.minFrames(desiredFrames,
+                    true /*streamingAndPlaying*/);
+            const size_t framesReady = track->mServerProxy->framesReady();
+            if (!track->mStarted && framesReady >= track->mFrameCount) {
+                track->mStarted = true;
+            }
+            if (framesReady >= minFrames && track->mStarted) {
+                mixer->enable(track->mName);
+                readiness.trackReady();
+            } else {
+                if (MixerReadiness::isUnderrun(framesReady, desiredFrames,
+                        false /*stopped*/, false /*paused*/)) {
+                    track->mServerProxy->tallyUnderrunFrames(desiredFrames);
+                    if (track->mStarted) {
+                        track->mUnderrunCycles++;
+                    }
+                }
+                mixer->disable(track->mName);
+                readiness.trackNotReady();
+            }
+        }
+        // threadLoop() only mixes when the tracks are ready, otherwise it writes silence
+        mixerReady = readiness.isMixerReady();
+        if (mixerReady) {
+            mixer->process(AudioBufferProvider::kInvalidPTS);
+        } else {
+            memset(mixBuffer, 0, mixBufferSize);
+        }
+        mixerCpu.add(systemTimeNs(CLOCK_THREAD_CPUTIME_ID) - cpuStartNs);
+
+        // threadLoop_write(); blocks until the simulated HAL has room
+        (void) stream->write(stream, mixBuffer, mixBufferSize);
+        cycles++;
+
+        // End-to-end latency: every client write that has now been consumed by the
+        // server will be presented no later than the end of this mix buffer.
+        const int64_t presentNs = output->presentationTimeNs(output->mWritten);
+        for (size_t i = 0; i < Tracks.size(); ++i) {
+            HarnessTrack *track = Tracks[i];
+            const uint64_t released = track->mServerProxy->framesReleased();
+            while (!track->mMarkers.empty() && track->mMarkers.front().mFrame <= released) {
+                track->mLatency.add(presentNs - track->mMarkers.front().mNs);
+                track->mMarkers.pop_front();
+            }
+        }
+    }
+
+    printf("%s clock, %u Hz, %zu frames per cycle (%.3f ms), %zu HAL periods, %zu cycles\n",
+            realtime ? "realtime" : "virtual", outputSampleRate, mixerFrameCount,
+            periodNs * 1e-6, halPeriods, cycles);
+    mixerCpu.print("mixer cpu");
+    if (cycles > 0) {
+        printf("  %-14s %.2f%% of one core\n", "mixer load",
+                100. * mixerCpu.sum() / ((double) cycles * periodNs));
+    }
+    output->mJitter.print("wake jitter");
+    printf("  %-14s %u\n", "HAL underruns", output->mGlitches);
+
+    long totalUnderruns = 0;
+    for (size_t i = 0; i < Tracks.size(); ++i) {
+        HarnessTrack *track = Tracks[i];
+        printf("track %zu: %s, %u Hz, %u channels, %u underrun cycles, %u underrun frames\n",
+                i, argv[i], track->mSource->getSampleRate(), track->mSource->getNumChannels(),
+                track->mUnderrunCycles, track->mServerProxy->getUnderrunFrames());
+        track->mLatency.print("latency");
+        totalUnderruns += track->mUnderrunCycles;
+    }
+
+    for (size_t i = 0; i < Tracks.size(); ++i) {
+        mixer->deleteTrackName(Tracks[i]->mName);
+        delete Tracks[i];
+    }
+    delete mixer;
+    delete output;
+    free(mixBuffer);
+
+    if (maxUnderruns >= 0 && totalUnderruns > maxUnderruns) {
+        fprintf(stderr, "%ld track underruns exceed limit of %ld\n", totalUnderruns, maxUnderruns);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audioflinger_timestamp_tests"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <new>
+#include <cutils/log.h>
+#include <gtest/gtest.h>
+#include <private/media/AudioTrackShared.h>
+
+using namespace android;
+
+static const size_t kFrameCount = 1024;
+static const size_t kFrameSize = 4;
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// A control block and buffer shared by one client proxy and one server proxy,
+// as AudioFlinger allocates them for a streaming AudioTrack.
+class SharedTrack {
+public:
+    SharedTrack() {
+        mCblk = (audio_track_cblk_t *) calloc(1, sizeof(audio_track_cblk_t)
+                + kFrameCount * kFrameSize);
+        new(mCblk) audio_track_cblk_t();
+        void *buffers = (char *) mCblk + sizeof(audio_track_cblk_t);
+        mServer = new AudioTrackServerProxy(mCblk, buffers, kFrameCount, kFrameSize);
+        mClient = new AudioTrackClientProxy(mCblk, buffers, kFrameCount, kFrameSize);
+    }
+
+    ~SharedTrack() {
+        mClient.clear();
+        mServer.clear();
+        mCblk->~audio_track_cblk_t();
+        free(mCblk);
+    }
+
+    audio_track_cblk_t*         mCblk;
+    sp<AudioTrackServerProxy>   mServer;
+    sp<AudioTrackClientProxy>   mClient;
+};
+
+// all fields are derived from one counter, so that a torn read is detectable;
+// the generation is read first, as the thread loop does
+static AudioTimestampState makeState(const SharedTrack& track, uint32_t n)
+{
+    AudioTimestampState state;
+    state.mGeneration = track.mServer->getTimestampGeneration();
+    state.mPosition = n * 960;
+    state.mLatencyMs = n % 100;
+    state.mTimeNs = n * 20000000LL;
+    state.mUnderrunFrames = n * 3;
+    return state;
+}
+
+static bool isConsistent(const AudioTimestampState& state)
+{
+    uint32_t n = state.mPosition / 960;
+    return state.mPosition == n * 960 && state.mLatencyMs == n % 100
+            && state.mTimeNs == n * 20000000LL && state.mUnderrunFrames == n * 3;
+}
+
+TEST(audioflinger_timestamp, not_published) {
+    SharedTrack track;
+    AudioTimestampState state;
+    EXPECT_EQ(track.mClient->getTimestamp(&state), WOULD_BLOCK);
+}
+
+TEST(audioflinger_timestamp, publish_and_read) {
+    SharedTrack track;
+    AudioTimestampState state;
+
+    track.mServer->setTimestamp(makeState(track, 7));
+    ASSERT_EQ(track.mClient->getTimestamp(&state), NO_ERROR);
+    EXPECT_EQ(state.mPosition, 7u * 960);
+    EXPECT_EQ(state.mTimeNs, 7 * 20000000LL);
+    EXPECT_EQ(state.mLatencyMs, 7u);
+    EXPECT_EQ(state.mUnderrunFrames, 21u);
+
+    // no new publish: the client still returns the most recent value
+    ASSERT_EQ(track.mClient->getTimestamp(&state), NO_ERROR);
+    EXPECT_EQ(state.mPosition, 7u * 960);
+
+    track.mServer->setTimestamp(makeState(track, 8));
+    ASSERT_EQ(track.mClient->getTimestamp(&state), NO_ERROR);
+    EXPECT_EQ(state.mPosition, 8u * 960);
+}
+
+// AudioTrack::stop() then start(): nothing published before either transition may be returned,
+// even a value the client had not yet observed when it stopped.
+TEST(audioflinger_timestamp, restart_after_stop) {
+    SharedTrack track;
+    AudioTimestampState state;
+
+    track.mServer->setTimestamp(makeState(track, 7));
+    ASSERT_EQ(track.mClient->getTimestamp(&state), NO_ERROR);
+    track.mServer->setTimestamp(makeState(track, 8));
+
+    // stop
+    track.mClient->invalidateTimestamp();
+    EXPECT_EQ(track.mClient->getTimestamp(&state), WOULD_BLOCK);
+
+    // start; the position restarts in the server's time base
+    track.mClient->invalidateTimestamp();
+    EXPECT_EQ(track.mClient->getTimestamp(&state), WOULD_BLOCK);
+
+    track.mServer->setTimestamp(makeState(track, 1));
+    ASSERT_EQ(track.mClient->getTimestamp(&state), NO_ERROR);
+    EXPECT_EQ(state.mPosition, 1u * 960);
+}
+
+// AudioTrack::pause(), flush() then start()
+TEST(audioflinger_timestamp, restart_after_flush) {
+    SharedTrack track;
+    AudioTimestampState state;
+
+    track.mServer->setTimestamp(makeState(track, 20));
+    ASSERT_EQ(track.mClient->getTimestamp(&state), NO_ERROR);
+
+    // pause
+    track.mClient->invalidateTimestamp();
+    // the server publishes once more for a period mixed before it saw the pause,
+    // but reads the new generation; that value is current as of the pause
+    track.mServer->setTimestamp(makeState(track, 21));
+    ASSERT_EQ(track.mClient->getTimestamp(&state), NO_ERROR);
+    EXPECT_EQ(state.mPosition, 21u * 960);
+
+    // flush
+    track.mClient->flush();
+    track.mClient->invalidateTimestamp();
+    EXPECT_EQ(track.mClient->getTimestamp(&state), WOULD_BLOCK);
+
+    // start
+    track.mClient->invalidateTimestamp();
+    EXPECT_EQ(track.mClient->getTimestamp(&state), WOULD_BLOCK);
+    track.mServer->setTimestamp(makeState(track, 2));
+    ASSERT_EQ(track.mClient->getTimestamp(&state), NO_ERROR);
+    EXPECT_EQ(state.mPosition, 2u * 960);
+}
+
+// A timestamp the server started computing before a transition is published after it:
+// it carries the old generation and must not be returned.
+TEST(audioflinger_timestamp, computed_before_transition) {
+    SharedTrack track;
+    AudioTimestampState state;
+
+    track.mServer->setTimestamp(makeState(track, 7));
+    ASSERT_EQ(track.mClient->getTimestamp(&state), NO_ERROR);
+
+    AudioTimestampState stale = makeState(track, 8);
+    // flush
+    track.mClient->flush();
+    track.mClient->invalidateTimestamp();
+    track.mServer->setTimestamp(stale);
+    EXPECT_EQ(track.mClient->getTimestamp(&state), WOULD_BLOCK);
+
+    track.mServer->setTimestamp(makeState(track, 1));
+    ASSERT_EQ(track.mClient->getTimestamp(&state), NO_ERROR);
+    EXPECT_EQ(state.mPosition, 1u * 960);
+}
+
+struct PublisherArgs {
+    SharedTrack*    mTrack;
+    volatile bool   mDone;
+};
+
+static void *publisher(void *arg)
+{
+    PublisherArgs *args = (PublisherArgs *) arg;
+    for (uint32_t n = 1; !args->mDone; n++) {
+        args->mTrack->mServer->setTimestamp(makeState(*args->mTrack, n));
+        // much faster than a real thread loop, but leaves the reader a window
+        usleep(20);
+    }
+    return NULL;
+}
+
+// The server publishes continuously while the client reads; no read may be torn,
+// and the client must never go back to an older value.
+TEST(audioflinger_timestamp, concurrent_reads_are_consistent) {
+    SharedTrack track;
+    PublisherArgs args = { &track, false };
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, NULL, publisher, &args), 0);
+
+    uint32_t previous = 0;
+    size_t reads = 0;
+    const int64_t endNs = nowNs() + 500000000LL;
+    while (nowNs() < endNs) {
+        AudioTimestampState state;
+        if (track.mClient->getTimestamp(&state) != NO_ERROR) {
+            continue;
+        }
+        reads++;
+        ASSERT_TRUE(isConsistent(state)) << "torn read at position " << state.mPosition;
+        ASSERT_GE(state.mPosition, previous);
+        previous = state.mPosition;
+    }
+    args.mDone = true;
+    pthread_join(thread, NULL);
+    EXPECT_GT(reads, 0u);
+}
+
+// Reading the shared timestamp costs a few loads, compared with tens of microseconds
+// for the IAudioTrack::getTimestamp() binder round-trip it replaces.
+TEST(audioflinger_timestamp, poll_cost) {
+    SharedTrack track;
+    static const int kPolls = 1000000;
+    AudioTimestampState state;
+
+    // unchanged value: the common case when the client polls more often than once per period
+    track.mServer->setTimestamp(makeState(track, 1));
+    int64_t start = nowNs();
+    for (int i = 0; i < kPolls; i++) {
+        (void) track.mClient->getTimestamp(&state);
+    }
+    double unchangedNs = (double) (nowNs() - start) / kPolls;
+
+    // new value on every poll
+    start = nowNs();
+    for (int i = 0; i < kPolls; i++) {
+        track.mServer->setTimestamp(makeState(track, i));
+        (void) track.mClient->getTimestamp(&state);
+    }
+    double changedNs = (double) (nowNs() - start) / kPolls;
+
+    printf("getTimestamp from shared memory: %.1f ns unchanged, %.1f ns with publish\n",
+            unchangedNs, changedNs);
+    EXPECT_LT(unchangedNs, 1000.);
+    EXPECT_LT(changedNs, 1000.);
+}
@@ -18,6 +18,7 @@
 //#define LOG_NDEBUG 0
 
 #include <sys/mman.h>
+#include <unistd.h>
 #include <utils/Log.h>
 #include <binder/PermissionCache.h>
 #include <media/nbaio/NBLog.h>
@@ -54,7 +55,7 @@ void MediaLogService::unregisterWriter(const sp<IMemory>& shared)
     }
 }
 
-status_t MediaLogService::dump(int fd, const Vector<String16>& args __unused)
+status_t MediaLogService::dump(int fd, const Vector<String16>& args)
 {
     // FIXME merge with similar but not identical code at services/audioflinger/ServiceUtilities.cpp
     static const String16 sDump("android.permission.DUMP");
@@ -71,6 +72,32 @@ status_t MediaLogService::dump(int fd, const Vector<String16>& args __unused)
         Mutex::Autolock _l(mLock);
         namedReaders = mNamedReaders;
     }
+
+    // "dumpsys media.log --binary" writes, for each writer, its name as a NUL-padded
+    // kMaxName byte field followed by the output of NBLog::Reader::exportBinary()
+    static const String16 sBinary("--binary");
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == sBinary) {
+            if (fd < 0) {
+                return BAD_VALUE;
+            }
+            for (size_t j = 0; j < namedReaders.size(); j++) {
+                const NamedReader& namedReader = namedReaders[j];
+                char name[NamedReader::kMaxName];
+                memset(name, 0, sizeof(name));
+                strlcpy(name, namedReader.name(), sizeof(name));
+                if (write(fd, name, sizeof(name)) != (ssize_t) sizeof(name)) {
+                    return -errno;
+                }
+                status_t status = namedReader.reader()->exportBinary(fd);
+                if (status != NO_ERROR) {
+                    return status;
+                }
+            }
+            return NO_ERROR;
+        }
+    }
+
     for (size_t i = 0; i < namedReaders.size(); i++) {
         const NamedReader& namedReader = namedReaders[i];
         if (fd >= 0) {
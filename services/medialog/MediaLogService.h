@@ -52,9 +52,9 @@ private:
         ~NamedReader() { }
         const sp<NBLog::Reader>&  reader() const { return mReader; }
         const char*               name() const { return mName; }
+        static const size_t kMaxName = 32;
     private:
         sp<NBLog::Reader>   mReader;
-        static const size_t kMaxName = 32;
         char                mName[kMaxName];
     };
     Vector<NamedReader> mNamedReaders;